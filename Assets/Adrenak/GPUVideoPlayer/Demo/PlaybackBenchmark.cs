@@ -0,0 +1,501 @@
+﻿using System;
+using System.Collections;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using System.Text;
+using UnityEngine;
+using Debug = UnityEngine.Debug;
+
+namespace Adrenak.GPUVideoPlayer.Demo {
+	/// <summary>
+	/// Plays one video through the handle based plugin api, with no UI, then writes load time, time to
+	/// first frame, frame rate, state message latency, seek latency and teardown time as json.
+	/// The seeks land as <see cref="seekMode"/> says, to compare exact and keyframe seeks. Then
+	/// <see cref="stepCount"/> frames are stepped back and forth to report the frame cache hit rate.
+	/// With a <see cref="playlist"/> the videos are appended after the seeks and each one is
+	/// played into the next to measure the gap between them. With <see cref="adaptive"/> the path is an
+	/// HLS or DASH manifest, and stalls, bitrate switches and segment downloads are reported too; a
+	/// static ladder served from a local http server makes the numbers repeatable offline.
+	/// With <see cref="readAheadMegabytes"/> local files are read ahead, and the waits on the disk are
+	/// reported; run it against a file on a network share with and without to compare rebuffering.
+	/// With a <see cref="clipFolder"/> nothing is played: up to <see cref="clipCount"/> clips in it are
+	/// loaded one after another, first as files and then out of a bundle packed from the folder, and
+	/// the time until each one is Opened is reported for both, with the time to pack and probe them.
+	/// With a <see cref="playerCount"/> nothing is played either: that many players are created at
+	/// once, starting with no media device pooled, and the time each creation took, the devices made
+	/// for them and the process's video memory with all of them alive are reported. Run it with 1, 8
+	/// and 32 to see what another player costs. Then a player is made, given 1080p textures and
+	/// released that many times over, to report how long the textures take with the pool warm.
+	/// In a player build -benchmarkPath, -benchmarkPlaylist (paths separated by ;), -benchmarkAdaptive,
+	/// -benchmarkSeekMode, -benchmarkFrameCache (megabytes), -benchmarkReadAhead (megabytes),
+	/// -benchmarkClips, -benchmarkPlayers and -benchmarkOutput override the fields, so it can run
+	/// unattended with -batchmode.
+	/// </summary>
+	public class PlaybackBenchmark : MonoBehaviour {
+		public string path;
+		public float playSeconds = 10;
+		public int seekCount = 20;
+		public float seekInterval = 0.25f;
+		[Tooltip("Keyframe modes only apply to local MP4 / MOV files")]
+		public GPUVideoPlayer.SeekMode seekMode = GPUVideoPlayer.SeekMode.Exact;
+		[Tooltip("Frames stepped back one at a time after the seeks, then forward again")]
+		public int stepCount = 30;
+		[Tooltip("Megabytes of decoded frames kept around the playhead for the steps, 0 steps without a cache")]
+		public int frameCacheMegabytes = 256;
+		[Tooltip("Megabytes of local files read ahead of playback, 0 reads them through the mapped view")]
+		public int readAheadMegabytes;
+		[Tooltip("Played after path, each from a second before the end of the previous one")]
+		public string[] playlist = new string[0];
+		[Tooltip("path is an HLS or DASH manifest")]
+		public bool adaptive;
+		public Plugin.AdaptiveSettings adaptiveSettings;
+		[Tooltip("Folder of short clips, loaded as files and out of a bundle instead of playing path")]
+		public string clipFolder;
+		public int clipCount = 500;
+		[Tooltip("Players created at once instead of playing path, 0 plays path")]
+		public int playerCount;
+		[Tooltip("Relative paths go under Application.persistentDataPath")]
+		public string outputFile = "playback-benchmark.json";
+		public bool quitWhenDone = true;
+
+		const float k_Timeout = 30;
+		static readonly string[] k_ClipExtensions = { ".mp4", ".m4v", ".mov", ".mkv", ".webm", ".wmv", ".avi", ".ts", ".m2ts", ".3gp" };
+
+		readonly Plugin.StateChangedMessage[] m_Events = new Plugin.StateChangedMessage[16];
+		UInt32 m_Handle;
+		Int32 m_RenderEventId;
+		Description m_Description;
+		bool m_Opened;
+		bool m_Failed;
+		int m_ItemChanges;
+
+		IEnumerator Start() {
+			path = GetArgument("-benchmarkPath", path);
+			outputFile = GetArgument("-benchmarkOutput", outputFile);
+			var playlistArgument = GetArgument("-benchmarkPlaylist", null);
+			if (playlistArgument != null)
+				playlist = playlistArgument.Split(new[] { ';' }, StringSplitOptions.RemoveEmptyEntries);
+			adaptive |= Array.IndexOf(Environment.GetCommandLineArgs(), "-benchmarkAdaptive") >= 0;
+			var seekModeArgument = GetArgument("-benchmarkSeekMode", null);
+			if (seekModeArgument != null)
+				seekMode = (GPUVideoPlayer.SeekMode)Enum.Parse(typeof(GPUVideoPlayer.SeekMode), seekModeArgument, true);
+			frameCacheMegabytes = int.Parse(GetArgument("-benchmarkFrameCache", frameCacheMegabytes.ToString()), CultureInfo.InvariantCulture);
+			readAheadMegabytes = int.Parse(GetArgument("-benchmarkReadAhead", readAheadMegabytes.ToString()), CultureInfo.InvariantCulture);
+			clipFolder = GetArgument("-benchmarkClips", clipFolder);
+			playerCount = int.Parse(GetArgument("-benchmarkPlayers", playerCount.ToString()), CultureInfo.InvariantCulture);
+			StartCoroutine(RenderLoop());
+
+			if (playerCount > 0) {
+				RunPlayers();
+				yield break;
+			}
+
+			if (!string.IsNullOrEmpty(clipFolder)) {
+				yield return StartCoroutine(RunClips());
+				yield break;
+			}
+
+			var clock = Stopwatch.StartNew();
+			if (Plugin.PlayerCreate(null, out m_Handle) != 0) {
+				Finish("Could not create media playback");
+				yield break;
+			}
+			if (Plugin.PlayerGetRenderEventId(m_Handle, 1, out m_RenderEventId) != 0)
+				m_RenderEventId = 0;
+			Plugin.PlayerSetSeekMode(m_Handle, (uint)seekMode);
+			Plugin.PlayerSetFrameCacheBudget(m_Handle, (long)frameCacheMegabytes * 1024 * 1024);
+			Plugin.PlayerSetReadAhead(m_Handle, (long)readAheadMegabytes * 1024 * 1024, 0);
+
+			// load: until the Opened message reaches script
+			var loadStart = clock.Elapsed;
+			var loaded = adaptive
+				? Plugin.PlayerLoadAdaptiveContent(m_Handle, path, ref adaptiveSettings)
+				: Plugin.PlayerLoadContent(m_Handle, path);
+			if (loaded != 0) {
+				Finish("Could not load path");
+				yield break;
+			}
+			yield return StartCoroutine(WaitFor(() => m_Opened));
+			if (!m_Opened) {
+				Finish("Could not open " + path);
+				yield break;
+			}
+			var loadTime = clock.Elapsed - loadStart;
+
+			// time to first frame: from Play until a decoded frame was copied into the output ring
+			var playStart = clock.Elapsed;
+			var nativeTexture = IntPtr.Zero;
+			if (Plugin.PlayerPlay(m_Handle) != 0 ||
+				Plugin.PlayerCreatePlaybackTexture(m_Handle, m_Description.width, m_Description.height, out nativeTexture) != 0) {
+				Finish("Could not play");
+				yield break;
+			}
+			yield return StartCoroutine(WaitFor(() => ReadStats(false).framesCopied > 0));
+			var firstFrameTime = clock.Elapsed - playStart;
+
+			// the reset clears the startup counters and starts the interval the frame rate is measured over
+			var startup = ReadStats(true);
+			var startupAdaptive = ReadAdaptiveStats();
+			yield return new WaitForSeconds(playSeconds);
+			var steady = ReadStats(false);
+
+			// the index is read in the background while the video opens, 0 if it isn't indexed
+			UInt32 keyframeCount;
+			if (Plugin.PlayerGetKeyframeTimes(m_Handle, null, 0, out keyframeCount) != 0)
+				keyframeCount = 0;
+
+			var random = new System.Random(seekCount);
+			for (var i = 0; i < seekCount && m_Description.isSeekable != 0; i++) {
+				Plugin.PlayerSetPosition(m_Handle, (long)(random.NextDouble() * m_Description.duration));
+				yield return new WaitForSeconds(seekInterval);
+			}
+			yield return new WaitForSeconds(1);
+			var run = ReadStats(false);
+			var runAdaptive = ReadAdaptiveStats();
+			Plugin.ReadAheadStats readAhead;
+			if (Plugin.PlayerGetReadAheadStats(m_Handle, out readAhead, false) != 0)
+				readAhead = new Plugin.ReadAheadStats();
+
+			// the first step back decodes the group of pictures before it, the rest should hit the cache
+			Plugin.FrameCacheStats frameCache;
+			Plugin.PlayerGetFrameCacheStats(m_Handle, out frameCache, true);
+			for (var i = 0; i < stepCount * 2 && m_Description.isSeekable != 0; i++) {
+				Plugin.PlayerStepFrames(m_Handle, i < stepCount ? -1 : 1);
+				yield return new WaitForSeconds(seekInterval);
+			}
+			Plugin.PlayerGetFrameCacheStats(m_Handle, out frameCache, false);
+			Plugin.PlayerPlay(m_Handle);
+
+			// item gap: from the last frame of an item to the first frame of the next
+			for (var i = 0; i < playlist.Length; i++) {
+				if (Plugin.PlayerPlaylistAppend(m_Handle, playlist[i]) != 0) {
+					Finish("Could not append " + playlist[i]);
+					yield break;
+				}
+			}
+			// the list also reports the item LoadContent started with
+			var firstChange = m_ItemChanges;
+			for (var i = 0; i < playlist.Length; i++) {
+				long duration;
+				if (Plugin.PlayerGetDuration(m_Handle, out duration) == 0 && duration > 10000000)
+					Plugin.PlayerSetPosition(m_Handle, duration - 10000000);
+				var changes = i + 1;
+				yield return StartCoroutine(WaitFor(() => m_ItemChanges - firstChange >= changes && ReadStats(false).itemChangeCount >= (ulong)changes));
+			}
+			var items = ReadStats(false);
+
+			var teardownStart = clock.Elapsed;
+			Plugin.PlayerRelease(m_Handle);
+			m_Handle = 0;
+			var teardownTime = clock.Elapsed - teardownStart;
+
+			var json = new StringBuilder();
+			json.Append("{\n");
+			json.AppendFormat("  \"path\": \"{0}\",\n", path.Replace("\\", "\\\\").Replace("\"", "\\\""));
+			json.AppendFormat("  \"width\": {0},\n  \"height\": {1},\n", m_Description.width, m_Description.height);
+			AppendMs(json, "loadMs", loadTime.Ticks);
+			AppendMs(json, "loadToOpenMs", startup.loadToOpen);
+			AppendMs(json, "timeToFirstFrameMs", firstFrameTime.Ticks);
+			AppendMs(json, "openToFirstFrameMs", startup.openToFirstFrame);
+			json.AppendFormat(CultureInfo.InvariantCulture, "  \"framesPerSecond\": {0:0.##},\n", steady.interval > 0 ? steady.framesCopied * 1e7 / steady.interval : 0);
+			json.AppendFormat("  \"framesCopied\": {0},\n  \"framesDropped\": {1},\n  \"copyFailures\": {2},\n", steady.framesCopied, steady.framesDropped, steady.copyFailures);
+			AppendMs(json, "copyAvgMs", steady.copyTimeAvg);
+			AppendMs(json, "copyP99Ms", steady.copyTimeP99);
+			json.AppendFormat("  \"eventCount\": {0},\n", run.eventCount);
+			AppendMs(json, "eventLatencyAvgMs", run.eventLatencyAvg);
+			AppendMs(json, "eventLatencyP99Ms", run.eventLatencyP99);
+			AppendMs(json, "eventLatencyMaxMs", run.eventLatencyMax);
+			json.AppendFormat("  \"seekMode\": \"{0}\",\n  \"keyframeCount\": {1},\n", seekMode, keyframeCount);
+			json.AppendFormat("  \"seekCount\": {0},\n", run.seekCount);
+			AppendMs(json, "seekToFirstFrameAvgMs", run.seekToFirstFrameAvg);
+			AppendMs(json, "seekToFirstFrameP99Ms", run.seekToFirstFrameP99);
+			AppendMs(json, "seekToFirstFrameMaxMs", run.seekToFirstFrameMax);
+			json.AppendFormat("  \"frameCacheBytes\": {0},\n  \"frameCacheSlots\": {1},\n", frameCache.bytes, frameCache.slots);
+			json.AppendFormat("  \"stepHits\": {0},\n  \"stepMisses\": {1},\n", frameCache.hits, frameCache.misses);
+			json.AppendFormat(CultureInfo.InvariantCulture, "  \"stepHitRate\": {0:0.###},\n", frameCache.hits + frameCache.misses > 0 ? (double)frameCache.hits / (frameCache.hits + frameCache.misses) : 0);
+			json.AppendFormat("  \"rebufferCount\": {0},\n", run.rebufferCount);
+			AppendMs(json, "rebufferAvgMs", run.rebufferTimeAvg);
+			AppendMs(json, "rebufferMaxMs", run.rebufferTimeMax);
+			if (adaptive) {
+				json.AppendFormat("  \"bitrateCount\": {0},\n  \"startupBitrate\": {1},\n", startupAdaptive.bitrateCount, startupAdaptive.playbackBitrate);
+				json.AppendFormat("  \"finalBitrate\": {0},\n  \"bitrateSwitches\": {1},\n", runAdaptive.playbackBitrate, runAdaptive.bitrateSwitches);
+				json.AppendFormat("  \"segmentsDownloaded\": {0},\n  \"bytesDownloaded\": {1},\n  \"downloadFailures\": {2},\n", runAdaptive.segmentsDownloaded, runAdaptive.bytesDownloaded, runAdaptive.downloadFailures);
+				AppendMs(json, "timeToFirstByteAvgMs", runAdaptive.timeToFirstByteAvg);
+				AppendMs(json, "segmentDownloadAvgMs", runAdaptive.downloadTimeAvg);
+			}
+			if (readAheadMegabytes > 0) {
+				json.AppendFormat("  \"readAheadWindow\": {0},\n  \"readAheadPrefetched\": {1},\n  \"readAheadErrors\": {2},\n", readAhead.window, readAhead.bytesPrefetched, readAhead.readErrors);
+				json.AppendFormat("  \"readAheadUnderruns\": {0},\n", readAhead.underrunCount);
+				AppendMs(json, "readAheadUnderrunAvgMs", readAhead.underrunTimeAvg);
+				AppendMs(json, "readAheadUnderrunMaxMs", readAhead.underrunTimeMax);
+				json.AppendFormat("  \"readAheadSeeks\": {0},\n", readAhead.seeks);
+				AppendMs(json, "readAheadSeekFillAvgMs", readAhead.seekFillTimeAvg);
+				AppendMs(json, "readAheadSeekFillMaxMs", readAhead.seekFillTimeMax);
+			}
+			json.AppendFormat("  \"itemChangeCount\": {0},\n", items.itemChangeCount);
+			AppendMs(json, "itemGapAvgMs", items.itemGapAvg);
+			AppendMs(json, "itemGapP99Ms", items.itemGapP99);
+			AppendMs(json, "itemGapMaxMs", items.itemGapMax);
+			AppendMs(json, "teardownMs", teardownTime.Ticks, true);
+			json.Append("}\n");
+
+			var outputPath = Path.Combine(Application.persistentDataPath, outputFile);
+			File.WriteAllText(outputPath, json.ToString());
+			Debug.Log("Playback benchmark written to " + outputPath + "\n" + json);
+			Finish(null);
+		}
+
+		IEnumerator RunClips() {
+			var folder = Path.GetFullPath(clipFolder).TrimEnd('\\', '/');
+			var names = new System.Collections.Generic.List<string>();
+			foreach (var file in Directory.GetFiles(folder, "*", SearchOption.AllDirectories)) {
+				if (names.Count < clipCount && Array.IndexOf(k_ClipExtensions, Path.GetExtension(file).ToLowerInvariant()) >= 0)
+					names.Add(file.Substring(folder.Length + 1).Replace('\\', '/'));
+			}
+			if (names.Count == 0) {
+				Finish("No clips in " + folder);
+				yield break;
+			}
+			if (Plugin.PlayerCreate(null, out m_Handle) != 0) {
+				Finish("Could not create media playback");
+				yield break;
+			}
+
+			var clock = Stopwatch.StartNew();
+			var bundlePath = Path.Combine(Application.temporaryCachePath, "benchmark.vbundle");
+			if (Plugin.PlayerPackBundle(folder, bundlePath) != 0) {
+				Finish("Could not pack " + folder);
+				yield break;
+			}
+			var packTime = clock.Elapsed;
+
+			// probe: what opening each clip would find out, read from the bundle's index
+			clock = Stopwatch.StartNew();
+			for (var i = 0; i < names.Count; i++) {
+				Plugin.BundleClip clip;
+				if (Plugin.PlayerGetBundleClip(bundlePath, names[i], out clip) != 0) {
+					Finish("Could not find " + names[i] + " in the bundle");
+					yield break;
+				}
+			}
+			var probeTime = clock.Elapsed;
+
+			var fileTimes = new long[names.Count];
+			var bundleTimes = new long[names.Count];
+			for (var pass = 0; pass < 2; pass++) {
+				var times = pass == 0 ? fileTimes : bundleTimes;
+				for (var i = 0; i < names.Count; i++) {
+					m_Opened = false;
+					m_Failed = false;
+					var loadStart = clock.Elapsed;
+					var loaded = pass == 0
+						? Plugin.PlayerLoadContent(m_Handle, Path.Combine(folder, names[i]))
+						: Plugin.PlayerLoadContentFromBundle(m_Handle, bundlePath, names[i]);
+					if (loaded != 0) {
+						Finish("Could not load " + names[i]);
+						yield break;
+					}
+					yield return StartCoroutine(WaitFor(() => m_Opened));
+					if (!m_Opened) {
+						Finish("Could not open " + names[i]);
+						yield break;
+					}
+					times[i] = (clock.Elapsed - loadStart).Ticks;
+				}
+			}
+			Plugin.PlayerRelease(m_Handle);
+			m_Handle = 0;
+			Plugin.PlayerCloseBundle(bundlePath);
+
+			var json = new StringBuilder();
+			json.Append("{\n");
+			json.AppendFormat("  \"clipFolder\": \"{0}\",\n", folder.Replace("\\", "\\\\").Replace("\"", "\\\""));
+			json.AppendFormat("  \"clipCount\": {0},\n  \"bundleBytes\": {1},\n", names.Count, new FileInfo(bundlePath).Length);
+			AppendMs(json, "packMs", packTime.Ticks);
+			AppendMs(json, "bundleProbeMs", probeTime.Ticks);
+			AppendTimes(json, "fileOpen", fileTimes);
+			AppendTimes(json, "bundleOpen", bundleTimes, true);
+			json.Append("}\n");
+
+			var outputPath = Path.Combine(Application.persistentDataPath, outputFile);
+			File.WriteAllText(outputPath, json.ToString());
+			Debug.Log("Playback benchmark written to " + outputPath + "\n" + json);
+			Finish(null);
+		}
+
+		void RunPlayers() {
+			// the first player pays for the media device, the rest share it
+			Plugin.PlayerTrimDevices();
+
+			var handles = new UInt32[playerCount];
+			var createTimes = new long[playerCount];
+			var clock = Stopwatch.StartNew();
+			for (var i = 0; i < playerCount; i++) {
+				var createStart = clock.Elapsed;
+				if (Plugin.PlayerCreate(null, out handles[i]) != 0) {
+					ReleasePlayers(handles);
+					Finish("Could not create player " + i);
+					return;
+				}
+				createTimes[i] = (clock.Elapsed - createStart).Ticks;
+			}
+			Plugin.DeviceStats devices;
+			Plugin.PlayerGetDeviceStats(out devices);
+
+			var releaseStart = clock.Elapsed;
+			ReleasePlayers(handles);
+			var releaseTime = clock.Elapsed - releaseStart;
+			Plugin.DeviceStats released;
+			Plugin.PlayerGetDeviceStats(out released);
+
+			// reloads, the way GPUVideoPlayer.Load makes a new player and textures each time.
+			// The first one creates the output textures, the rest find them pooled
+			Plugin.PlayerClearTexturePool();
+			Plugin.TexturePoolStats poolStart;
+			Plugin.PlayerGetTexturePoolStats(out poolStart);
+			var textureTimes = new long[playerCount];
+			for (var i = 0; i < playerCount; i++) {
+				UInt32 handle;
+				if (Plugin.PlayerCreate(null, out handle) != 0) {
+					Finish("Could not create player " + i);
+					return;
+				}
+				var textureStart = clock.Elapsed;
+				var texture = IntPtr.Zero;
+				var created = Plugin.PlayerCreatePlaybackTexture(handle, 1920, 1080, out texture);
+				textureTimes[i] = (clock.Elapsed - textureStart).Ticks;
+				Plugin.PlayerRelease(handle);
+				if (created != 0) {
+					Finish("Could not create textures for player " + i);
+					return;
+				}
+			}
+			Plugin.TexturePoolStats pool;
+			Plugin.PlayerGetTexturePoolStats(out pool);
+
+			var json = new StringBuilder();
+			json.Append("{\n");
+			json.AppendFormat("  \"playerCount\": {0},\n", playerCount);
+			AppendMs(json, "firstCreateMs", createTimes[0]);
+			AppendTimes(json, "create", createTimes);
+			AppendMs(json, "releaseAllMs", releaseTime.Ticks);
+			json.AppendFormat("  \"devicesCreated\": {0},\n  \"deviceReuses\": {1},\n", devices.creations, devices.reuses);
+			AppendMs(json, "deviceCreateMaxMs", devices.createTimeMax);
+			json.AppendFormat("  \"videoMemoryBytes\": {0},\n  \"videoMemoryReleasedBytes\": {1},\n", devices.videoMemoryUsage, released.videoMemoryUsage);
+			AppendMs(json, "firstTextureCreateMs", textureTimes[0]);
+			AppendTimes(json, "textureCreate", textureTimes);
+			json.AppendFormat("  \"texturePoolHits\": {0},\n  \"texturePoolMisses\": {1},\n", pool.hits - poolStart.hits, pool.misses - poolStart.misses);
+			json.AppendFormat("  \"texturePoolBytes\": {0}\n", pool.bytes);
+			json.Append("}\n");
+
+			var outputPath = Path.Combine(Application.persistentDataPath, outputFile);
+			File.WriteAllText(outputPath, json.ToString());
+			Debug.Log("Playback benchmark written to " + outputPath + "\n" + json);
+			Finish(null);
+		}
+
+		static void ReleasePlayers(UInt32[] handles) {
+			for (var i = 0; i < handles.Length; i++) {
+				if (handles[i] != 0)
+					Plugin.PlayerRelease(handles[i]);
+				handles[i] = 0;
+			}
+		}
+
+		// total, average and p99 of times in 1/10^7 seconds
+		static void AppendTimes(StringBuilder json, string name, long[] times, bool last = false) {
+			var sorted = (long[])times.Clone();
+			Array.Sort(sorted);
+			long total = 0;
+			foreach (var time in sorted)
+				total += time;
+			AppendMs(json, name + "TotalMs", total);
+			AppendMs(json, name + "AvgMs", total / sorted.Length);
+			AppendMs(json, name + "P99Ms", sorted[Math.Min(sorted.Length - 1, sorted.Length * 99 / 100)], last);
+		}
+
+		IEnumerator RenderLoop() {
+			while (true) {
+				yield return new WaitForEndOfFrame();
+				Plugin.SetTimeFromUnity(Time.timeSinceLevelLoad);
+				if (m_Handle != 0)
+					GL.IssuePluginEvent(Plugin.GetRenderEventFunc(), m_RenderEventId);
+			}
+		}
+
+		void Update() {
+			UInt32 count;
+			do {
+				if (m_Handle == 0 || Plugin.PlayerDrainEvents(m_Handle, m_Events, (uint)m_Events.Length, out count) != 0)
+					return;
+
+				for (var i = 0; i < count; i++) {
+					// 1 is Opened, 3 is Failed, 5 is ItemChanged, see GPUVideoPlayer.StateType
+					if (m_Events[i].type == 1) {
+						m_Description = m_Events[i].description;
+						m_Opened = true;
+					}
+					else if (m_Events[i].type == 3)
+						m_Failed = true;
+					else if (m_Events[i].type == 5)
+						m_ItemChanges++;
+				}
+			} while (count == m_Events.Length);
+		}
+
+		IEnumerator WaitFor(Func<bool> done) {
+			var start = Time.realtimeSinceStartup;
+			while (!m_Failed && !done() && Time.realtimeSinceStartup - start < k_Timeout)
+				yield return null;
+		}
+
+		Plugin.PlaybackStats ReadStats(bool reset) {
+			Plugin.PlaybackStats stats;
+			if (m_Handle == 0 || Plugin.PlayerGetPlaybackStats(m_Handle, out stats, reset) != 0)
+				stats = new Plugin.PlaybackStats();
+			return stats;
+		}
+
+		Plugin.AdaptiveStats ReadAdaptiveStats() {
+			Plugin.AdaptiveStats stats;
+			if (!adaptive || m_Handle == 0 || Plugin.PlayerGetAdaptiveStats(m_Handle, out stats, false) != 0)
+				stats = new Plugin.AdaptiveStats();
+			return stats;
+		}
+
+		// stats are in 1/10^7 seconds, the report is in milliseconds
+		static void AppendMs(StringBuilder json, string name, long ticks, bool last = false) {
+			json.AppendFormat(CultureInfo.InvariantCulture, "  \"{0}\": {1:0.###}{2}\n", name, ticks / 10000.0, last ? "" : ",");
+		}
+
+		static string GetArgument(string name, string fallback) {
+			var args = Environment.GetCommandLineArgs();
+			for (var i = 0; i < args.Length - 1; i++) {
+				if (args[i] == name)
+					return args[i + 1];
+			}
+			return fallback;
+		}
+
+		void Finish(string error) {
+			if (error != null)
+				Debug.LogError("[PlaybackBenchmark] " + error);
+
+			if (m_Handle != 0) {
+				Plugin.PlayerRelease(m_Handle);
+				m_Handle = 0;
+			}
+
+			if (quitWhenDone)
+				Application.Quit();
+		}
+
+		void OnDisable() {
+			if (m_Handle != 0) {
+				Plugin.PlayerRelease(m_Handle);
+				m_Handle = 0;
+			}
+		}
+	}
+}
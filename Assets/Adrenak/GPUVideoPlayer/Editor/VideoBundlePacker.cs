@@ -0,0 +1,59 @@
+﻿using System;
+using System.IO;
+using UnityEditor;
+using UnityEngine;
+
+namespace Adrenak.GPUVideoPlayer.Editor {
+	/// <summary>
+	/// Packs a folder of clips into one bundle for <see cref="GPUVideoPlayer.LoadFromBundle"/>, written
+	/// next to the folder as folder.vbundle. Keep the folder itself out of StreamingAssets so the clips
+	/// don't ship twice. From the command line:
+	/// -batchmode -executeMethod Adrenak.GPUVideoPlayer.Editor.VideoBundlePacker.PackFromCommandLine
+	/// -bundleInput folder -bundleOutput bundle
+	/// </summary>
+	public static class VideoBundlePacker {
+		[MenuItem("Assets/GPUVideoPlayer/Pack Video Bundle")]
+		static void PackSelected() {
+			var folder = AssetDatabase.GetAssetPath(Selection.activeObject);
+			if (!Pack(folder, folder.TrimEnd('/') + ".vbundle"))
+				return;
+			AssetDatabase.Refresh();
+		}
+
+		[MenuItem("Assets/GPUVideoPlayer/Pack Video Bundle", true)]
+		static bool CanPackSelected() {
+			return Selection.activeObject != null && AssetDatabase.IsValidFolder(AssetDatabase.GetAssetPath(Selection.activeObject));
+		}
+
+		public static void PackFromCommandLine() {
+			var folder = GetArgument("-bundleInput");
+			var bundle = GetArgument("-bundleOutput");
+			if (folder == null || bundle == null) {
+				Debug.LogError("[VideoBundlePacker] -bundleInput and -bundleOutput are both needed");
+				EditorApplication.Exit(1);
+				return;
+			}
+			EditorApplication.Exit(Pack(folder, bundle) ? 0 : 1);
+		}
+
+		public static bool Pack(string folder, string bundle) {
+			// the packer is native, it runs in the editor's copy of the plugin
+			var result = Plugin.PlayerPackBundle(Path.GetFullPath(folder), Path.GetFullPath(bundle));
+			if (result != 0) {
+				Debug.LogError("[VideoBundlePacker] Could not pack " + folder + ": 0x" + result.ToString("X8"));
+				return false;
+			}
+			Debug.Log("[VideoBundlePacker] Packed " + folder + " into " + bundle);
+			return true;
+		}
+
+		static string GetArgument(string name) {
+			var args = Environment.GetCommandLineArgs();
+			for (var i = 0; i < args.Length - 1; i++) {
+				if (args[i] == name)
+					return args[i + 1];
+			}
+			return null;
+		}
+	}
+}
@@ -1,9 +1,9 @@
-﻿using System;
-using System.Collections;
-using UnityEngine;
+﻿using System;
+using System.Collections;
+using UnityEngine;
 
 namespace Adrenak.GPUVideoPlayer {
-	public class GPUVideoPlayer : MonoBehaviour {
+	public class GPUVideoPlayer : MonoBehaviour {
 		public enum State {
 			Idle,
 			Loaded,
@@ -12,26 +12,107 @@ namespace Adrenak.GPUVideoPlayer {
 			Paused,
 			Stopped,
 			Ended
-		}
-
-		Plugin.StateChangedCallback m_NativeCallback;
+		}
+
+		/// <summary>
+		/// Layout of the texture(s) the plugin writes video frames into
+		/// </summary>
+		public enum OutputFormat {
+			/// <summary>32bpp rgb, sampled directly through <see cref="MediaTexture"/></summary>
+			BGRA = 0,
+			/// <summary>8 bit luma + chroma planes, sample with <see cref="ApplyPlanarMaterial"/></summary>
+			NV12,
+			/// <summary>10 bit luma + chroma planes, sample with <see cref="ApplyPlanarMaterial"/></summary>
+			P010
+		}
+
+		/// <summary>
+		/// What decodes the video
+		/// </summary>
+		public enum DecodeBackend {
+			/// <summary>Hardware when Unity renders with Direct3D 11, the WARP device otherwise (eg. -nographics)</summary>
+			Auto = 0,
+			/// <summary>The gpu Unity renders with</summary>
+			Hardware,
+			/// <summary>Media Foundation's decoders on a Direct3D 11 WARP device, rendered on the cpu so no gpu is needed.
+			/// <see cref="MediaTexture"/> can't be displayed, read frames with <see cref="TryAcquireReadbackFrame"/></summary>
+			WarpDevice
+		}
+
+		/// <summary>
+		/// What plays after the last item of the playlist
+		/// </summary>
+		public enum PlaylistRepeat {
+			/// <summary>Playback ends</summary>
+			None = 0,
+			/// <summary>The first item again</summary>
+			All,
+			/// <summary>The current item loops and the playlist doesn't move on</summary>
+			One
+		}
+
+		/// <summary>
+		/// Where a seek lands. The keyframe modes only apply to local MP4 / MOV files, whose
+		/// keyframes are indexed in the background when they are loaded; other videos seek exactly
+		/// </summary>
+		public enum SeekMode {
+			/// <summary>The exact time, decoding from the keyframe before it</summary>
+			Exact = 0,
+			/// <summary>The closest keyframe, the fastest seek for scrubbing</summary>
+			NearestKeyframe,
+			/// <summary>The last keyframe at or before the time</summary>
+			PreviousKeyframe
+		}
+
+		// state messages are queued natively and drained on the main thread in Update
+		readonly Plugin.StateChangedMessage[] m_Events = new Plugin.StateChangedMessage[16];
+		UInt32 m_Handle;
+
+		// every player's status, fetched with one call the first time it is read each frame
+		static Plugin.PlaybackStatus[] s_Status = new Plugin.PlaybackStatus[4];
+		static UInt32 s_StatusCount;
+		static int s_StatusFrame = -1;
+		Int32 m_RenderEventId;
+		IntPtr m_NativeTexture;
+		IntPtr m_NativeChromaTexture;
+		static bool s_ThumbnailCacheSet;
 
 		/// <summary>
 		/// Returns the <see cref="Description"/> data for the media being played
-		/// </summary>
+		/// </summary>
 		public Description MediaDescription {
 			get { return m_Description; }
-		}
+		}
 		Description m_Description;
 
 		/// <summary>
 		/// Returns a reference of the Texture2D object on which the video frames is updated
-		/// </summary>
+		/// </summary>
 		public Texture2D MediaTexture {
 			get { return m_Texture; }
-		}
+		}
 		Texture2D m_Texture;
 
+		/// <summary>
+		/// The chroma plane when <see cref="outputFormat"/> is NV12 or P010, null otherwise
+		/// </summary>
+		public Texture2D MediaChromaTexture {
+			get { return m_ChromaTexture; }
+		}
+		Texture2D m_ChromaTexture;
+
+		/// <summary>
+		/// Position, duration, rate, buffered range and the time of the frame on screen as of this
+		/// frame. All times are in 1/10^7 seconds
+		/// </summary>
+		public Plugin.PlaybackStatus Status {
+			get {
+				Plugin.PlaybackStatus status;
+				TryGetStatus(out status);
+				return status;
+			}
+		}
+
 		/// <summary>
 		/// The current state of the video player
 		/// </summary>
@@ -41,9 +122,67 @@ namespace Adrenak.GPUVideoPlayer {
 		State m_State;
 
 		public StateUnityEvent onStateChanged = new StateUnityEvent();
-
-		[Header("Auto Play Configuration")]
-		public bool autoPlay;
+
+		/// <summary>
+		/// Invoked with the playlist index when playback moves to another item
+		/// </summary>
+		public ItemUnityEvent onItemChanged = new ItemUnityEvent();
+
+		/// <summary>
+		/// Invoked when an adaptive stream switches to another bitrate
+		/// </summary>
+		public BitrateUnityEvent onBitrateChanged = new BitrateUnityEvent();
+
+		/// <summary>
+		/// Invoked for each media segment an adaptive stream downloads
+		/// </summary>
+		public SegmentUnityEvent onSegmentDownloaded = new SegmentUnityEvent();
+
+		/// <summary>
+		/// Invoked as <see cref="GenerateThumbnails"/> fills in more of the atlas
+		/// </summary>
+		public ThumbnailUnityEvent onThumbnailProgress = new ThumbnailUnityEvent();
+
+		/// <summary>
+		/// Invoked once <see cref="GenerateThumbnails"/> is done, hresult is 0 when every thumbnail decoded
+		/// </summary>
+		public ThumbnailUnityEvent onThumbnailsCompleted = new ThumbnailUnityEvent();
+
+		/// <summary>
+		/// Invoked when the video changes size mid stream. When the texture was created at the video's size,
+		/// <see cref="MediaTexture"/> is a new one of the new size by then, to be assigned to materials again
+		/// </summary>
+		public ResolutionUnityEvent onResolutionChanged = new ResolutionUnityEvent();
+
+		[Header("Output Configuration")]
+		[Tooltip("Planar formats skip the per frame conversion to 32bpp, but need the YUVPlanar shader to display")]
+		public OutputFormat outputFormat = OutputFormat.BGRA;
+		public bool fullRangeVideo;
+		public DecodeBackend decodeBackend = DecodeBackend.Auto;
+
+		[Header("Playlist Configuration")]
+		public PlaylistRepeat playlistRepeat = PlaylistRepeat.None;
+		[Tooltip("Seconds before the end of an item the next one starts opening and decoding. 0 uses the system default")]
+		public float playlistPrefetchTime;
+
+		[Header("Seek Configuration")]
+		[Tooltip("Keyframe modes skip decoding up to the exact time, long GOP video seeks much faster")]
+		public SeekMode seekMode = SeekMode.Exact;
+		[Tooltip("Video memory in megabytes for decoded frames around the playhead, so StepFrames back and forth skips decoding. 0 disables the cache")]
+		public int frameCacheMegabytes;
+
+		[Header("Read Ahead Configuration")]
+		[Tooltip("Megabytes of local files read ahead of playback by a thread of their own, for slow or network disks. Takes effect on the next load")]
+		public int readAheadMegabytes;
+		[Tooltip("Seconds of local files read ahead of playback, at the file's average bitrate. Wins over megabytes once the file has opened")]
+		public float readAheadSeconds;
+
+		[Header("Adaptive Streaming Configuration")]
+		[Tooltip("Used by LoadAdaptive. Bitrates in bits per second, times in 1/10^7 seconds, 0 keeps the stream's default")]
+		public Plugin.AdaptiveSettings adaptiveSettings;
+
+		[Header("Auto Play Configuration")]
+		public bool autoPlay;
 		public string autoPath;
 
 		// ================================================
@@ -53,26 +192,233 @@ namespace Adrenak.GPUVideoPlayer {
 		/// <summary>
 		/// Loads the video at the given path (or URL)
 		/// </summary>
-		/// <param name="path"></param>
+		/// <param name="path"></param>
 		public void Load(string path) {
-			m_NativeCallback = new Plugin.StateChangedCallback(HandleStateChange);
-
-			if (Plugin.CreateMediaPlayback(m_NativeCallback) != 0)
-				LogError("Could not create media playback");
+			if (!CreatePlayer())
+				return;
 
-			if (Plugin.LoadContent(path) != 0)
+			if (Plugin.PlayerLoadContent(m_Handle, path) != 0)
 				LogError("Could not load path");
 		}
+
+		/// <summary>
+		/// Loads an HLS (.m3u8) or DASH (.mpd) stream with the bitrate and buffer policy in
+		/// <see cref="adaptiveSettings"/>. The manifest is downloaded in the background,
+		/// <see cref="MediaState"/> turns Loaded or Failed once it is parsed
+		/// </summary>
+		/// <param name="manifestURL"></param>
+		public void LoadAdaptive(string manifestURL) {
+			if (!CreatePlayer())
+				return;
+
+			if (Plugin.PlayerLoadAdaptiveContent(m_Handle, manifestURL, ref adaptiveSettings) != 0)
+				LogError("Could not load manifest");
+		}
+
+		/// <summary>
+		/// Loads a clip packed into a bundle by the Video Bundle menu (or <see cref="PackBundle"/>). The
+		/// bundle is opened once and its index kept, so loading a clip from it opens and probes no file
+		/// </summary>
+		/// <param name="bundlePath">The bundle, relative paths are under <see cref="Application.streamingAssetsPath"/></param>
+		/// <param name="name">The clip's path relative to the folder packed, '/' separated</param>
+		public void LoadFromBundle(string bundlePath, string name) {
+			if (!CreatePlayer())
+				return;
+
+			if (Plugin.PlayerLoadContentFromBundle(m_Handle, GetBundlePath(bundlePath), name) != 0)
+				LogError("Could not load " + name + " from the bundle");
+		}
+
+		/// <summary>
+		/// Packs every video file under a folder into one bundle for <see cref="LoadFromBundle"/>
+		/// </summary>
+		/// <param name="folder"></param>
+		/// <param name="bundlePath">Replaced once the new bundle is written</param>
+		/// <returns>Whether the bundle was written</returns>
+		public static bool PackBundle(string folder, string bundlePath) {
+			return Plugin.PlayerPackBundle(folder, GetBundlePath(bundlePath)) == 0;
+		}
+
+		/// <summary>
+		/// Gets the size, duration and keyframe count of a clip in a bundle without opening it
+		/// </summary>
+		/// <param name="bundlePath"></param>
+		/// <param name="name"></param>
+		/// <param name="clip"></param>
+		/// <returns>Whether the bundle holds the clip</returns>
+		public static bool GetBundleClip(string bundlePath, string name, out Plugin.BundleClip clip) {
+			return Plugin.PlayerGetBundleClip(GetBundlePath(bundlePath), name, out clip) == 0;
+		}
+
+		/// <summary>
+		/// Lets go of a bundle's index and mapping. Players playing from it keep it until they load something else
+		/// </summary>
+		/// <param name="bundlePath"></param>
+		public static void CloseBundle(string bundlePath) {
+			Plugin.PlayerCloseBundle(GetBundlePath(bundlePath));
+		}
+
+		static string GetBundlePath(string bundlePath) {
+			if (string.IsNullOrEmpty(bundlePath) || System.IO.Path.IsPathRooted(bundlePath))
+				return bundlePath;
+			return System.IO.Path.Combine(Application.streamingAssetsPath, bundlePath);
+		}
+
+		/// <summary>
+		/// Gets the bitrate ladder position, measured bandwidth, bitrate switches and segment download
+		/// times of a stream loaded with <see cref="LoadAdaptive"/>
+		/// </summary>
+		/// <param name="stats">The counters, durations in 1/10^7 seconds</param>
+		/// <param name="reset">Start counting again after reading</param>
+		/// <returns>Whether the stats could be read</returns>
+		public bool GetAdaptiveStats(out Plugin.AdaptiveStats stats, bool reset = false) {
+			if (Plugin.PlayerGetAdaptiveStats(m_Handle, out stats, reset) != 0) {
+				LogError("Could not get adaptive stats");
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Adds a video to the end of the playlist started by <see cref="Load"/>. It is opened ahead
+		/// of its turn and plays on from the previous one without a gap, into the same textures
+		/// </summary>
+		/// <param name="path"></param>
+		/// <returns>Whether the video could be added</returns>
+		public bool Append(string path) {
+			if (Plugin.PlayerPlaylistAppend(m_Handle, path) != 0) {
+				LogError("Could not append to the playlist");
+				return false;
+			}
+			s_StatusFrame = -1;
+			return true;
+		}
+
+		/// <summary>
+		/// Adds a video to the playlist at the given index
+		/// </summary>
+		/// <param name="index"></param>
+		/// <param name="path"></param>
+		/// <returns>Whether the video could be added</returns>
+		public bool Insert(int index, string path) {
+			if (index < 0 || Plugin.PlayerPlaylistInsert(m_Handle, (uint)index, path) != 0) {
+				LogError("Could not insert into the playlist");
+				return false;
+			}
+			s_StatusFrame = -1;
+			return true;
+		}
+
+		/// <summary>
+		/// Removes the video at the given index from the playlist. Removing the current one moves on to the next
+		/// </summary>
+		/// <param name="index"></param>
+		/// <returns>Whether the video could be removed</returns>
+		public bool RemoveAt(int index) {
+			if (index < 0 || Plugin.PlayerPlaylistRemove(m_Handle, (uint)index) != 0) {
+				LogError("Could not remove from the playlist");
+				return false;
+			}
+			s_StatusFrame = -1;
+			return true;
+		}
+
+		/// <summary>
+		/// Jumps to the video at the given index of the playlist
+		/// </summary>
+		/// <param name="index"></param>
+		/// <returns>Whether the jump was successful</returns>
+		public bool MoveTo(int index) {
+			if (index < 0 || Plugin.PlayerPlaylistMoveTo(m_Handle, (uint)index) != 0) {
+				LogError("Could not move to playlist item " + index);
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Changes what plays after the last item, see <see cref="playlistRepeat"/>
+		/// </summary>
+		/// <param name="repeat"></param>
+		/// <returns>Whether the setting was applied</returns>
+		public bool SetPlaylistRepeat(PlaylistRepeat repeat) {
+			playlistRepeat = repeat;
+			if (m_Handle != 0 && Plugin.PlayerSetPlaylistRepeat(m_Handle, (uint)repeat) != 0) {
+				LogError("Could not set the playlist repeat mode");
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Starts opening the video at the given path (or URL) in the background. The next
+		/// <see cref="Load"/> of the same path, by any player, starts from the opened source
+		/// </summary>
+		/// <param name="path"></param>
+		/// <returns>Whether the preload could be started</returns>
+		public static bool Preload(string path) {
+			return Plugin.PlayerPreloadContent(path) >= 0;
+		}
+
+		/// <summary>
+		/// Gets how many preloaded sources are held, their estimated size and how often
+		/// <see cref="Load"/> found its path preloaded
+		/// </summary>
+		/// <param name="stats">The counters</param>
+		/// <returns>Whether the stats could be read</returns>
+		public static bool GetPreloadStats(out Plugin.PreloadStats stats) {
+			return Plugin.PlayerGetPreloadStats(out stats) == 0;
+		}
+
+		/// <summary>
+		/// Gets how many media devices the players share, how often a player found its adapter's
+		/// device already made, and the process's video memory use
+		/// </summary>
+		/// <param name="stats">The counters</param>
+		/// <returns>Whether the stats could be read</returns>
+		public static bool GetDeviceStats(out Plugin.DeviceStats stats) {
+			return Plugin.PlayerGetDeviceStats(out stats) == 0;
+		}
+
+		/// <summary>
+		/// Gets how many output textures are pooled and how often a player found its textures there
+		/// instead of creating them
+		/// </summary>
+		/// <param name="stats">The counters</param>
+		/// <returns>Whether the stats could be read</returns>
+		public static bool GetTexturePoolStats(out Plugin.TexturePoolStats stats) {
+			return Plugin.PlayerGetTexturePoolStats(out stats) == 0;
+		}
+
+		/// <summary>
+		/// Sets how many megabytes of output textures are kept for the next player of the same size and
+		/// format. 0 frees them when their player is done with them
+		/// </summary>
+		/// <param name="megabytes"></param>
+		/// <returns>Whether the budget was applied</returns>
+		public static bool SetTexturePoolBudget(int megabytes) {
+			return Plugin.PlayerSetTexturePoolBudget((long)megabytes * 1024 * 1024) == 0;
+		}
+
+		/// <summary>
+		/// Releases the media devices no player is using, eg. when no video will play for a while.
+		/// The next player made creates its device again
+		/// </summary>
+		/// <returns>How many devices were released</returns>
+		public static int TrimDevices() {
+			return (int)Plugin.PlayerTrimDevices();
+		}
+
 		/// <summary>
 		/// Plays (or resumes) the video playback.
 		/// </summary>
-		/// <returns>Whether the play attempts was successful</returns>
+		/// <returns>Whether the play attempts was successful</returns>
 		public bool Play() {
-			if (Plugin.Play() != 0) {
+			if (Plugin.PlayerPlay(m_Handle) != 0) {
 				LogError("Cannot play video");
 				return false;
 			}
-			if (m_Texture == null && CreateTexture(m_Description.width, m_Description.height)) {
+			if (m_NativeTexture == IntPtr.Zero && CreateTexture(m_Description.width, m_Description.height)) {
 				ChangeState(State.Playing);
 				return true;
 			}
@@ -82,9 +428,9 @@ namespace Adrenak.GPUVideoPlayer {
 		/// <summary>
 		/// Pauses the video playback
 		/// </summary>
-		/// <returns>Whether the pause attempt was successful</returns>
+		/// <returns>Whether the pause attempt was successful</returns>
 		public bool Pause() {
-			if (Plugin.Pause() != 0) {
+			if (Plugin.PlayerPause(m_Handle) != 0) {
 				LogError("Could not pause");
 				return false;
 			}
@@ -95,9 +441,9 @@ namespace Adrenak.GPUVideoPlayer {
 		/// <summary>
 		/// Stops the video playback and unloads the video
 		/// </summary>
-		/// <returns>Whether the stop attempt was successful</returns>
+		/// <returns>Whether the stop attempt was successful</returns>
 		public bool Stop() {
-			if (Plugin.Stop() != 0) {
+			if (Plugin.PlayerStop(m_Handle) != 0) {
 				LogError("Could not stop the video");
 				return false;
 			}
@@ -110,14 +456,14 @@ namespace Adrenak.GPUVideoPlayer {
 		/// <summary>
 		/// Returns the rate of playback. Eg. 1x
 		/// </summary>
-		/// <returns>The playback rate. -1 if there was an error</returns>
+		/// <returns>The playback rate. -1 if there was an error</returns>
 		public double GetPlaybackRate() {
-			double rate;
-			if (Plugin.GetPlaybackRate(out rate) != 0) {
+			Plugin.PlaybackStatus status;
+			if (!TryGetStatus(out status)) {
 				LogError("Could not get playback rate");
 				return -1;
 			}
-			return rate;
+			return status.rate;
 		}
 
         /// <summary>
@@ -126,27 +472,28 @@ namespace Adrenak.GPUVideoPlayer {
         /// <param name="rate">The playback rate</param>
         public void SetPlaybackRate(float rate)
         {
-            Plugin.SetPlaybackRate(rate);
+            Plugin.PlayerSetPlaybackRate(m_Handle, rate);
+            s_StatusFrame = -1;
         }
 
 		/// <summary>
 		/// Gets the duration of the video. In 1/10^7 seconds. So a 60 second video will return 600000000
 		/// </summary>
-		/// <returns>The duration of the video</returns>
+		/// <returns>The duration of the video</returns>
 		public long GetDuration() {
-			long duration;
-			if (Plugin.GetDuration(out duration) != 0) {
+			Plugin.PlaybackStatus status;
+			if (!TryGetStatus(out status)) {
 				LogError("Could not get duration");
 				return -1;
 			}
-			return duration;
+			return status.duration;
 		}
 
 		/// <summary>
 		/// Sets the position of the video player to the ratio set. Eg. .5f would set it to halfway
 		/// </summary>
 		/// <param name="percent"></param>
-		/// <returns>Whether the seek attempt was successful</returns>
+		/// <returns>Whether the seek attempt was successful</returns>
 		public bool SeekByRatio(float percent) {
 			if (percent < 0 || percent > 1) {
 				LogError("Passed percentage value cannot be higher than 1");
@@ -160,26 +507,320 @@ namespace Adrenak.GPUVideoPlayer {
 		/// Sets the position of the video player to the time given. Time is in 1/10^7 second units. So 600000000 will set it to 60 seconds since the start of the video
 		/// </summary>
 		/// <param name="position"></param>
-		/// <returns>Whether the seek attempt was successful</returns>
+		/// <returns>Whether the seek attempt was successful</returns>
 		public bool SeekByTime(long position) {
-			if (Plugin.SetPosition(position) != 0) {
+			if (Plugin.PlayerSetPosition(m_Handle, position) != 0) {
 				LogError("Could not set position");
 				return false;
 			}
+			s_StatusFrame = -1;
+			return true;
+		}
+
+		/// <summary>
+		/// Changes where <see cref="SeekByTime"/> and <see cref="SeekByRatio"/> land, see <see cref="seekMode"/>
+		/// </summary>
+		/// <param name="mode"></param>
+		/// <returns>Whether the mode was applied</returns>
+		public bool SetSeekMode(SeekMode mode) {
+			seekMode = mode;
+			if (m_Handle != 0 && Plugin.PlayerSetSeekMode(m_Handle, (uint)mode) != 0) {
+				LogError("Could not set the seek mode");
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Gets the keyframe times of the current item in 1/10^7 seconds, eg. to snap a scrub bar to.
+		/// Empty for videos that aren't local MP4 / MOV files
+		/// </summary>
+		/// <param name="times">Sorted ascending</param>
+		/// <returns>False while the item is still being indexed, or if the times couldn't be read</returns>
+		public bool GetKeyframeTimes(out long[] times) {
+			times = new long[0];
+
+			UInt32 count;
+			var result = Plugin.PlayerGetKeyframeTimes(m_Handle, null, 0, out count);
+			if (result == 1)
+				return false;
+
+			var buffer = new long[count];
+			if (result != 0 || (count > 0 && Plugin.PlayerGetKeyframeTimes(m_Handle, buffer, (uint)buffer.Length, out count) != 0)) {
+				LogError("Could not get keyframe times");
+				return false;
+			}
+
+			// the item may have changed in between
+			if (count < buffer.Length)
+				Array.Resize(ref buffer, (int)count);
+			times = buffer;
+			return true;
+		}
+
+		/// <summary>
+		/// Pauses and moves the given number of frames forward, or backward when negative.
+		/// Frames in the cache (<see cref="frameCacheMegabytes"/>) are shown without decoding,
+		/// others are decoded from the keyframe before them and cached on the way
+		/// </summary>
+		/// <param name="frames"></param>
+		/// <returns>Whether the step was started</returns>
+		public bool StepFrames(int frames) {
+			if (Plugin.PlayerStepFrames(m_Handle, frames) != 0) {
+				LogError("Could not step frames");
+				return false;
+			}
+			s_StatusFrame = -1;
+			return true;
+		}
+
+		/// <summary>
+		/// Resizes the decoded frame cache, see <see cref="frameCacheMegabytes"/>. Cached frames are dropped
+		/// </summary>
+		/// <param name="megabytes"></param>
+		/// <returns>Whether the cache could be made</returns>
+		public bool SetFrameCacheSize(int megabytes) {
+			frameCacheMegabytes = megabytes;
+			if (m_Handle != 0 && Plugin.PlayerSetFrameCacheBudget(m_Handle, (long)megabytes * 1024 * 1024) != 0) {
+				LogError("Could not set the frame cache size");
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Gets the size of the decoded frame cache and how many steps it served
+		/// </summary>
+		/// <param name="stats"></param>
+		/// <param name="reset">Whether to start counting hits and misses again</param>
+		/// <returns>Whether the stats could be read</returns>
+		public bool GetFrameCacheStats(out Plugin.FrameCacheStats stats, bool reset = false) {
+			if (Plugin.PlayerGetFrameCacheStats(m_Handle, out stats, reset) != 0) {
+				LogError("Could not get frame cache stats");
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Reads local files ahead of playback on a thread of their own, so a slow or uneven disk
+		/// (a network share) doesn't stall decoding. See <see cref="readAheadMegabytes"/> and
+		/// <see cref="readAheadSeconds"/>, both 0 turns it off. Files being read ahead are resized,
+		/// turning it on or off takes effect on the next load
+		/// </summary>
+		/// <param name="megabytes"></param>
+		/// <param name="seconds"></param>
+		/// <returns>Whether the window could be set</returns>
+		public bool SetReadAhead(int megabytes, float seconds) {
+			readAheadMegabytes = megabytes;
+			readAheadSeconds = seconds;
+			if (m_Handle != 0 && Plugin.PlayerSetReadAhead(m_Handle, (long)megabytes * 1024 * 1024, (long)(seconds * 10000000)) != 0) {
+				LogError("Could not set read ahead");
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Gets how much of the files is read ahead and how often playback still had to wait for the disk
+		/// </summary>
+		/// <param name="stats"></param>
+		/// <param name="reset">Whether to start counting again</param>
+		/// <returns>Whether the stats could be read</returns>
+		public bool GetReadAheadStats(out Plugin.ReadAheadStats stats, bool reset = false) {
+			if (Plugin.PlayerGetReadAheadStats(m_Handle, out stats, reset) != 0) {
+				LogError("Could not get read ahead stats");
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Decodes thumbnails spread evenly over a video into one texture atlas, for a scrub bar. The
+		/// video is opened apart from the one playing and decoded in the background, reporting through
+		/// <see cref="onThumbnailProgress"/> and <see cref="onThumbnailsCompleted"/>. Completed atlases
+		/// of local files are kept under <see cref="Application.temporaryCachePath"/>, so asking again
+		/// for the same file and size completes right away
+		/// </summary>
+		/// <param name="path">Usually the video loaded in this player</param>
+		/// <param name="count">Number of thumbnails, each at the keyframe before its time</param>
+		/// <param name="width">Size of a cell, thumbnails keep their aspect ratio within it</param>
+		/// <param name="height"></param>
+		/// <returns>Whether generating was started</returns>
+		public bool GenerateThumbnails(string path, int count, int width, int height) {
+			if (!s_ThumbnailCacheSet) {
+				Plugin.PlayerSetThumbnailCacheDirectory(System.IO.Path.Combine(Application.temporaryCachePath, "Thumbnails"));
+				s_ThumbnailCacheSet = true;
+			}
+
+			if (Plugin.PlayerGenerateThumbnails(m_Handle, path, (uint)count, (uint)width, (uint)height) != 0) {
+				LogError("Could not generate thumbnails");
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Gets the thumbnails decoded so far. Cells still being decoded are black
+		/// </summary>
+		/// <param name="texture">A snapshot of the atlas, call again after progress to see more of it.
+		/// Null for players on the WARP device</param>
+		/// <param name="info">Layout of the atlas</param>
+		/// <param name="times">Time of each thumbnail in 1/10^7 seconds, -1 until decoded</param>
+		/// <returns>Whether the thumbnails could be read</returns>
+		public bool GetThumbnails(out Texture2D texture, out Plugin.Thumbnails info, out long[] times) {
+			texture = null;
+			times = new long[0];
+
+			if (Plugin.PlayerGetThumbnails(m_Handle, out info, null, 0, null, 0) != 0) {
+				LogError("Could not get thumbnails");
+				return false;
+			}
+
+			var buffer = new long[info.count];
+			if (Plugin.PlayerGetThumbnails(m_Handle, out info, null, 0, buffer, (uint)buffer.Length) != 0) {
+				LogError("Could not get thumbnail times");
+				return false;
+			}
+			times = buffer;
+
+			if (IsOnWarpDevice)
+				return true;
+
+			var nativeTexture = IntPtr.Zero;
+			if (Plugin.PlayerCreateThumbnailTexture(m_Handle, out nativeTexture) != 0 || nativeTexture == IntPtr.Zero) {
+				LogError("Could not create thumbnail texture");
+				return false;
+			}
+
+			texture = Texture2D.CreateExternalTexture((int)info.width, (int)info.height, TextureFormat.RGBA32, false, false, nativeTexture);
+			return texture != null;
+		}
+
+		/// <summary>
+		/// Copies the thumbnails decoded so far into memory, eg. for players on the WARP device or to save them
+		/// </summary>
+		/// <param name="pixels">The atlas, 32bpp bgra, top row first</param>
+		/// <param name="info">Layout of the atlas</param>
+		/// <returns>Whether the thumbnails could be read</returns>
+		public bool GetThumbnailPixels(out byte[] pixels, out Plugin.Thumbnails info) {
+			pixels = new byte[0];
+
+			if (Plugin.PlayerGetThumbnails(m_Handle, out info, null, 0, null, 0) != 0) {
+				LogError("Could not get thumbnails");
+				return false;
+			}
+
+			var buffer = new byte[info.width * info.height * 4];
+			if (Plugin.PlayerGetThumbnails(m_Handle, out info, buffer, (uint)buffer.Length, null, 0) != 0) {
+				LogError("Could not get thumbnail pixels");
+				return false;
+			}
+			pixels = buffer;
 			return true;
 		}
 
 		/// <summary>
 		/// Gets the current position of the video player in 1/10^7 seconds. 
 		/// </summary>
-		/// <returns></returns>
+		/// <returns></returns>
 		public long GetPosition() {
-			long position;
-			if (Plugin.GetPosition(out position) != 0) {
+			Plugin.PlaybackStatus status;
+			if (!TryGetStatus(out status)) {
 				LogError("Could not get position");
 				return -1;
 			}
-			return position;
+			return status.position;
+		}
+
+		/// <summary>
+		/// Starts or stops copying decoded frames into cpu memory. Frames show up a frame or two
+		/// after they are displayed, the render thread never waits for them.
+		/// </summary>
+		/// <param name="enabled">Whether frames should be read back</param>
+		/// <returns>Whether the call was successful</returns>
+		public bool SetReadbackEnabled(bool enabled) {
+			if (Plugin.PlayerSetReadbackEnabled(m_Handle, enabled) != 0) {
+				LogError("Could not change readback");
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Gets the newest frame read back since the last call. The frame memory is owned by the
+		/// plugin and stays valid until it is passed to <see cref="ReleaseReadbackFrame"/>
+		/// </summary>
+		/// <param name="frame">The mapped frame, with its presentation time in 1/10^7 seconds</param>
+		/// <returns>Whether a new frame was available</returns>
+		public bool TryAcquireReadbackFrame(out Plugin.ReadbackFrame frame) {
+			return Plugin.PlayerAcquireReadbackFrame(m_Handle, out frame) == 0 && frame.data != IntPtr.Zero;
+		}
+
+		/// <summary>
+		/// Hands a frame from <see cref="TryAcquireReadbackFrame"/> back to the plugin
+		/// </summary>
+		/// <param name="frame">The frame to release</param>
+		public void ReleaseReadbackFrame(Plugin.ReadbackFrame frame) {
+			Plugin.PlayerReleaseReadbackFrame(m_Handle, frame.frameId);
+		}
+
+		/// <summary>
+		/// Gets how many frames were shown, repeated because the decoder was late, or dropped since
+		/// the player was created. Frames are paced against the time passed to Plugin.SetTimeFromUnity
+		/// </summary>
+		/// <param name="stats">The counters</param>
+		/// <returns>Whether the stats could be read</returns>
+		public bool GetPresentationStats(out Plugin.PresentationStats stats) {
+			if (Plugin.PlayerGetPresentationStats(m_Handle, out stats) != 0) {
+				LogError("Could not get presentation stats");
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Gets the decoder side counters: frames decoded, copied and dropped, copy times and how long
+		/// opening and seeking took to produce a frame
+		/// </summary>
+		/// <param name="stats">The counters, durations in 1/10^7 seconds</param>
+		/// <param name="reset">Start a new interval after reading, to compute rates between calls</param>
+		/// <returns>Whether the stats could be read</returns>
+		public bool GetPlaybackStats(out Plugin.PlaybackStats stats, bool reset = false) {
+			if (Plugin.PlayerGetPlaybackStats(m_Handle, out stats, reset) != 0) {
+				LogError("Could not get playback stats");
+				return false;
+			}
+			return true;
+		}
+
+		/// <summary>
+		/// Sets up a material using the Adrenak/GPUVideoPlayer/YUVPlanar shader to display planar output
+		/// </summary>
+		/// <param name="material">The material to configure</param>
+		public void ApplyPlanarMaterial(Material material) {
+			if (material == null)
+				return;
+
+			material.mainTexture = m_Texture;
+			material.SetTexture("_ChromaTex", m_ChromaTexture);
+
+			// pick the matrix the way most encoders do when the stream doesn't say
+			var matrix = "YUV_BT601";
+			if (outputFormat == OutputFormat.P010 && m_Description.height > 1080)
+				matrix = "YUV_BT2020";
+			else if (m_Description.height >= 720)
+				matrix = "YUV_BT709";
+
+			foreach (var keyword in new[] { "YUV_BT601", "YUV_BT709", "YUV_BT2020" })
+				material.DisableKeyword(keyword);
+			material.EnableKeyword(matrix);
+
+			if (fullRangeVideo) material.EnableKeyword("YUV_FULL_RANGE");
+			else material.DisableKeyword("YUV_FULL_RANGE");
+
+			if (outputFormat == OutputFormat.P010) material.EnableKeyword("YUV_10BIT");
+			else material.DisableKeyword("YUV_10BIT");
 		}
 
 		// ================================================
@@ -194,31 +835,142 @@ namespace Adrenak.GPUVideoPlayer {
 			while (true) {
 				yield return new WaitForEndOfFrame();
 				Plugin.SetTimeFromUnity(Time.timeSinceLevelLoad);
-				GL.IssuePluginEvent(Plugin.GetRenderEventFunc(), 1);
+				if (m_Handle != 0)
+					GL.IssuePluginEvent(Plugin.GetRenderEventFunc(), m_RenderEventId);
 			}
 
-		}
-
+		}
+
+		void Update() {
+			DrainEvents();
+
+			if (m_Texture == null)
+				return;
+
+			// the plugin rotates through several output textures, follow the one it last latched
+			var nativeTexture = IntPtr.Zero;
+			var nativeChromaTexture = IntPtr.Zero;
+			if (Plugin.PlayerGetPlaybackPlanes(m_Handle, out nativeTexture, out nativeChromaTexture) != 0 || nativeTexture == IntPtr.Zero)
+				return;
+
+			if (nativeTexture != m_NativeTexture) {
+				m_Texture.UpdateExternalTexture(nativeTexture);
+				m_NativeTexture = nativeTexture;
+			}
+
+			if (m_ChromaTexture != null && nativeChromaTexture != IntPtr.Zero && nativeChromaTexture != m_NativeChromaTexture) {
+				m_ChromaTexture.UpdateExternalTexture(nativeChromaTexture);
+				m_NativeChromaTexture = nativeChromaTexture;
+			}
+		}
+
 		bool CreateTexture(uint width, uint height) {
+			if (outputFormat != OutputFormat.BGRA)
+				return CreatePlanarTextures(width, height);
+
 			var nativeTexture = IntPtr.Zero;
-			if (Plugin.CreatePlaybackTexture((uint)width, (uint)height, out nativeTexture) != 0) {
+			if (Plugin.PlayerCreatePlaybackTexture(m_Handle, (uint)width, (uint)height, out nativeTexture) != 0) {
 				LogError("Could not create playback texture");
 				return false;
 			}
+			m_NativeTexture = nativeTexture;
+			return CreateExternalTextures(width, height);
+		}
 
-			m_Texture = Texture2D.CreateExternalTexture((int)width, (int)height, TextureFormat.RGBA32, false, false, nativeTexture);
-			if (m_Texture == null) {
+		bool CreatePlanarTextures(uint width, uint height) {
+			var nativeTexture = IntPtr.Zero;
+			var nativeChromaTexture = IntPtr.Zero;
+			if (Plugin.PlayerCreatePlaybackTextureEx(m_Handle, width, height, (uint)outputFormat, out nativeTexture, out nativeChromaTexture) != 0) {
+				LogError("Could not create planar playback texture");
+				return false;
+			}
+			m_NativeTexture = nativeTexture;
+			m_NativeChromaTexture = nativeChromaTexture;
+			return CreateExternalTextures(width, height);
+		}
+
+		// wraps m_NativeTexture (and m_NativeChromaTexture) for Unity, at the size the plugin made them
+		bool CreateExternalTextures(uint width, uint height) {
+			if (IsOnWarpDevice)
+				return true;
+
+			if (outputFormat == OutputFormat.BGRA) {
+				m_Texture = Texture2D.CreateExternalTexture((int)width, (int)height, TextureFormat.RGBA32, false, false, m_NativeTexture);
+				if (m_Texture == null) {
+					LogError("Could not create external texture");
+					return false;
+				}
+				return true;
+			}
+
+			var is10Bit = outputFormat == OutputFormat.P010;
+			m_Texture = Texture2D.CreateExternalTexture((int)width, (int)height, is10Bit ? TextureFormat.R16 : TextureFormat.Alpha8, false, true, m_NativeTexture);
+			m_ChromaTexture = Texture2D.CreateExternalTexture((int)width / 2, (int)height / 2, is10Bit ? TextureFormat.RGHalf : TextureFormat.RG16, false, true, m_NativeChromaTexture);
+			if (m_Texture == null || m_ChromaTexture == null) {
 				LogError("Could not create external texture");
 				return false;
 			}
 			return true;
-		}
-
+		}
+
+		// WARP players decode on a device of their own, Unity can't sample their textures
+		bool IsOnWarpDevice {
+			get {
+				return decodeBackend == DecodeBackend.WarpDevice ||
+					(decodeBackend == DecodeBackend.Auto && SystemInfo.graphicsDeviceType != UnityEngine.Rendering.GraphicsDeviceType.Direct3D11);
+			}
+		}
+
 		void Unload() {
-			Plugin.ReleaseMediaPlayback();
+			if (m_Handle != 0) {
+				Plugin.PlayerRelease(m_Handle);
+				m_Handle = 0;
+				m_RenderEventId = 0;
+			}
 			m_Texture = null;
-		}
-
+			m_ChromaTexture = null;
+			m_NativeTexture = IntPtr.Zero;
+			m_NativeChromaTexture = IntPtr.Zero;
+		}
+
+		bool TryGetStatus(out Plugin.PlaybackStatus status) {
+			status = new Plugin.PlaybackStatus();
+			if (m_Handle == 0)
+				return false;
+
+			if (s_StatusFrame != Time.frameCount) {
+				var count = Plugin.PlayerGetCount();
+				if (s_Status.Length < count)
+					s_Status = new Plugin.PlaybackStatus[count];
+
+				if (Plugin.PlayerGetAllStatus(s_Status, (uint)s_Status.Length, out s_StatusCount) < 0)
+					s_StatusCount = 0;
+				s_StatusFrame = Time.frameCount;
+			}
+
+			for (var i = 0; i < s_StatusCount; i++) {
+				if (s_Status[i].handle == m_Handle) {
+					status = s_Status[i];
+					return true;
+				}
+			}
+
+			// created after this frame's snapshot
+			return Plugin.PlayerGetStatus(m_Handle, out status) == 0;
+		}
+
+		void DrainEvents() {
+			UInt32 count;
+			do {
+				if (m_Handle == 0 || Plugin.PlayerDrainEvents(m_Handle, m_Events, (uint)m_Events.Length, out count) != 0)
+					return;
+
+				// handling Ended unloads the player, the rest of the batch belongs to it
+				for (var i = 0; i < count && m_Handle != 0; i++)
+					HandleStateChange(m_Events[i]);
+			} while (count == m_Events.Length);
+		}
+
 		void HandleStateChange(Plugin.StateChangedMessage args) {
 			var stateType = (StateType)Enum.ToObject(typeof(StateType), args.type);
 
@@ -230,6 +982,43 @@ namespace Adrenak.GPUVideoPlayer {
 				case StateType.Failed:
 					ChangeState(State.Failed);
 					break;
+				case StateType.ItemChanged:
+					s_StatusFrame = -1;
+					onItemChanged.Invoke((int)args.itemIndex);
+					break;
+				case StateType.BitrateChanged:
+					onBitrateChanged.Invoke(args.bitrate);
+					break;
+				case StateType.SegmentDownloaded:
+					onSegmentDownloaded.Invoke(args.download);
+					break;
+				case StateType.ThumbnailProgress:
+					onThumbnailProgress.Invoke(args.thumbnails);
+					break;
+				case StateType.ThumbnailsCompleted:
+					onThumbnailsCompleted.Invoke(args.thumbnails);
+					break;
+				case StateType.ResolutionChanged:
+					m_Description.width = args.resolution.width;
+					m_Description.height = args.resolution.height;
+
+					// the plugin resized its output, Update keeps following the latched frame as before.
+					// The old textures are destroyed, their native ones are released once Unity samples the new
+					if (args.resolution.resized != 0 && m_NativeTexture != IntPtr.Zero) {
+						var nativeTexture = IntPtr.Zero;
+						var nativeChromaTexture = IntPtr.Zero;
+						if (Plugin.PlayerGetPlaybackPlanes(m_Handle, out nativeTexture, out nativeChromaTexture) == 0 && nativeTexture != IntPtr.Zero) {
+							var oldTexture = m_Texture;
+							var oldChromaTexture = m_ChromaTexture;
+							m_NativeTexture = nativeTexture;
+							m_NativeChromaTexture = nativeChromaTexture;
+							CreateExternalTextures(args.resolution.width, args.resolution.height);
+							if (oldTexture != null) Destroy(oldTexture);
+							if (oldChromaTexture != null) Destroy(oldChromaTexture);
+						}
+					}
+					onResolutionChanged.Invoke(args.resolution);
+					break;
 				case StateType.StateChanged:
 					var playbackState = (PlaybackState)Enum.ToObject(typeof(PlaybackState), args.state);
 					if (playbackState == PlaybackState.Ended) {
@@ -240,15 +1029,35 @@ namespace Adrenak.GPUVideoPlayer {
 			}
 		}
 
+		bool CreatePlayer() {
+			Unload();
+
+			if (Plugin.PlayerCreateEx(null, (uint)decodeBackend, out m_Handle) != 0) {
+				LogError("Could not create media playback");
+				return false;
+			}
+
+			// render events only latch this player's frames
+			if (Plugin.PlayerGetRenderEventId(m_Handle, 1, out m_RenderEventId) != 0)
+				m_RenderEventId = 0;
+
+			Plugin.PlayerSetPlaylistRepeat(m_Handle, (uint)playlistRepeat);
+			Plugin.PlayerSetPlaylistPrefetchTime(m_Handle, (long)(playlistPrefetchTime * 10000000));
+			Plugin.PlayerSetSeekMode(m_Handle, (uint)seekMode);
+			Plugin.PlayerSetFrameCacheBudget(m_Handle, (long)frameCacheMegabytes * 1024 * 1024);
+			Plugin.PlayerSetReadAhead(m_Handle, (long)readAheadMegabytes * 1024 * 1024, (long)(readAheadSeconds * 10000000));
+			return true;
+		}
+
 		void OnDisable() {
 			Unload();
-		}
-
+		}
+
 		void ChangeState(State state) {
 			m_State = state;
 			onStateChanged.Invoke(m_State);
-		}
-
+		}
+
 		void LogError(object error) {
 			Debug.LogError("[GPUVideoPlayer] " + error);
 		}
@@ -261,8 +1070,15 @@ namespace Adrenak.GPUVideoPlayer {
 			Opened,
 			StateChanged,
 			Failed,
-		}
-
+			PositionChanged,
+			ItemChanged,
+			BitrateChanged,
+			SegmentDownloaded,
+			ThumbnailProgress,
+			ThumbnailsCompleted,
+			ResolutionChanged,
+		}
+
 		enum PlaybackState {
 			None = 0,
 			Opening,
@@ -270,6 +1086,6 @@ namespace Adrenak.GPUVideoPlayer {
 			Playing,
 			Paused,
 			Ended
-		}
-	}
-}
+		}
+	}
+}
@@ -19,6 +19,263 @@ namespace Adrenak.GPUVideoPlayer {
 
 			[FieldOffset(4)]
 			public Int64 position;
+
+			[FieldOffset(4)]
+			public UInt32 itemIndex;
+
+			[FieldOffset(4)]
+			public BitrateChange bitrate;
+
+			[FieldOffset(4)]
+			public SegmentDownload download;
+
+			[FieldOffset(4)]
+			public ThumbnailProgress thumbnails;
+
+			[FieldOffset(4)]
+			public ResolutionChange resolution;
+		};
+
+		// adaptive streams, bits per second
+		[Serializable]
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct BitrateChange {
+			public UInt32 oldBitrate;
+			public UInt32 newBitrate;
+			public UInt32 audioOnly;
+		};
+
+		// adaptive streams, one media segment. Times since the request in 1/10^7 seconds, -1 when not measured
+		[Serializable]
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct SegmentDownload {
+			public UInt32 bytes;
+			public Int64 timeToFirstByte;
+			public Int64 downloadTime;
+		};
+
+		// PlayerGenerateThumbnails progress, hresult is E_PENDING (0x8000000A) until the last event
+		[Serializable]
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct ThumbnailProgress {
+			public UInt32 completed;
+			public UInt32 count;
+			public Int32 hresult;
+		};
+
+		// the video changed size mid stream. resized is 1 when the output moved to the new size,
+		// PlayerGetPlaybackPlanes returns its textures from then on, 0 when it kept its size
+		[Serializable]
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct ResolutionChange {
+			public UInt32 width;
+			public UInt32 height;
+			public UInt32 resized;
+		};
+
+		// PlayerGetThumbnails, the atlas is width x height 32bpp bgra, count cells of cellWidth x cellHeight
+		// in rows of columns, top row first
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct Thumbnails {
+			public UInt32 count;
+			public UInt32 completed;
+			public UInt32 columns;
+			public UInt32 rows;
+			public UInt32 cellWidth;
+			public UInt32 cellHeight;
+			public UInt32 width;
+			public UInt32 height;
+			public Int32 hresult;
+			public UInt32 fromCache;
+		};
+
+		// cpu readable frame from PlayerAcquireReadbackFrame, data stays valid until PlayerReleaseReadbackFrame
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct ReadbackFrame {
+			public IntPtr data;
+			public UInt32 rowPitch;
+			public UInt32 width;
+			public UInt32 height;
+			public UInt32 format;
+			public Int64 timestamp;
+			public UInt64 frameId;
+		};
+
+		// frame pacing counters from PlayerGetPresentationStats, times in 1/10^7 seconds
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct PresentationStats {
+			public UInt64 framesPresented;
+			public UInt64 framesRepeated;
+			public UInt64 framesDropped;
+			public UInt64 resyncs;
+			public Int64 frameDuration;
+			public Int64 displayInterval;
+		};
+
+		// per player snapshot from PlayerGetAllStatus, times in 1/10^7 seconds
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct PlaybackStatus {
+			public UInt32 handle;
+			public UInt32 version;
+			public UInt16 state;
+			public UInt16 reserved;
+			public Int32 lastError;
+			public UInt32 width;
+			public UInt32 height;
+			public Int64 position;
+			public Int64 duration;
+			public Double rate;
+			public Int64 bufferedStart;
+			public Int64 bufferedEnd;
+			public Int64 lastFramePts;
+			public UInt32 itemIndex;
+			public UInt32 itemCount;
+		};
+
+		// hot path counters from PlayerGetPlaybackStats, durations in 1/10^7 seconds
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct PlaybackStats {
+			public Int64 interval;
+			public UInt64 framesAvailable;
+			public UInt64 framesCopied;
+			public UInt64 framesDropped;
+			public UInt64 copyFailures;
+			public Int64 copyTimeMin;
+			public Int64 copyTimeAvg;
+			public Int64 copyTimeMax;
+			public Int64 copyTimeP99;
+			public Int64 loadToOpen;
+			public Int64 openToFirstFrame;
+			public UInt64 seekCount;
+			public Int64 seekToFirstFrameAvg;
+			public Int64 seekToFirstFrameMax;
+			public Int64 seekToFirstFrameP99;
+			public UInt64 eventCount;
+			public Int64 eventLatencyAvg;
+			public Int64 eventLatencyMax;
+			public Int64 eventLatencyP99;
+			public UInt64 itemChangeCount;
+			public Int64 itemGapAvg;
+			public Int64 itemGapMax;
+			public Int64 itemGapP99;
+			public UInt64 rebufferCount;
+			public Int64 rebufferTimeAvg;
+			public Int64 rebufferTimeMax;
+		};
+
+		// PlayerLoadAdaptiveContent policy, zeros keep the stream's defaults. Bitrates in bits per second
+		// snap to the closest rung of the ladder, times are in 1/10^7 seconds
+		[Serializable]
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct AdaptiveSettings {
+			public UInt32 initialBitrate;
+			public UInt32 minBitrate;
+			public UInt32 maxBitrate;
+			public Int64 desiredLiveOffset;
+			public Int64 desiredSeekableWindow;
+			public Double bitrateHeadroomRatio;
+			public Double downgradeTriggerRatio;
+		};
+
+		// download side of an adaptive stream from PlayerGetAdaptiveStats, durations in 1/10^7 seconds
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct AdaptiveStats {
+			public UInt32 bitrateCount;
+			public UInt32 playbackBitrate;
+			public UInt32 downloadBitrate;
+			public UInt32 inboundBitsPerSecond;
+			public UInt64 bitrateSwitches;
+			public UInt64 segmentsDownloaded;
+			public UInt64 bytesDownloaded;
+			public UInt64 downloadFailures;
+			public Int64 timeToFirstByteAvg;
+			public Int64 timeToFirstByteP99;
+			public Int64 downloadTimeAvg;
+			public Int64 downloadTimeP99;
+		};
+
+		// PlayerGetPreloadStats, shared by every player. Costs are estimated bytes
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct PreloadStats {
+			public UInt32 entries;
+			public UInt32 maxEntries;
+			public Int64 cost;
+			public Int64 capacity;
+			public UInt64 hits;
+			public UInt64 misses;
+			public UInt64 evictions;
+			public UInt64 failures;
+		};
+
+		// PlayerGetFrameCacheStats, sizes in bytes. Hit rate is hits / (hits + misses)
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct FrameCacheStats {
+			public Int64 budget;
+			public Int64 bytes;
+			public UInt32 slots;
+			public UInt32 frames;
+			public UInt64 hits;
+			public UInt64 misses;
+			public UInt64 framesCached;
+			public UInt64 evictions;
+		};
+
+		// PlayerGetReadAheadStats, sizes in bytes summed over the items read ahead, times in 1/10^7 seconds
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct ReadAheadStats {
+			public UInt32 buffers;
+			public UInt32 reserved;
+			public UInt64 window;
+			public UInt64 bufferedAhead;
+			public UInt64 bufferedBehind;
+			public UInt64 bytesRead;
+			public UInt64 bytesPrefetched;
+			public UInt64 seeks;
+			public UInt64 readErrors;
+			public UInt64 underrunCount;
+			public Int64 underrunTimeAvg;
+			public Int64 underrunTimeMax;
+			public UInt64 seekFillCount;
+			public Int64 seekFillTimeAvg;
+			public Int64 seekFillTimeMax;
+		};
+
+		// PlayerGetDeviceStats, times in 1/10^7 seconds. The memory is the whole process's on the
+		// adapters, unity's included, compare it before and after creating players
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct DeviceStats {
+			public UInt32 devices;
+			public UInt32 references;
+			public UInt64 creations;
+			public UInt64 reuses;
+			public Int64 createTimeAvg;
+			public Int64 createTimeMax;
+			public UInt64 videoMemoryUsage;
+		};
+
+		// PlayerGetTexturePoolStats, sizes in bytes. Hits and misses count output textures, 4 per CreatePlaybackTexture
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct TexturePoolStats {
+			public UInt32 entries;
+			public UInt32 reserved;
+			public Int64 bytes;
+			public Int64 budget;
+			public UInt64 hits;
+			public UInt64 misses;
+			public UInt64 evictions;
+		};
+
+		// PlayerGetBundleClip, what opening the clip would find out. Width and height 0 for
+		// containers that aren't probed when packed, times in 1/10^7 seconds
+		[StructLayout(LayoutKind.Sequential, Pack = 4)]
+		public struct BundleClip {
+			public UInt32 width;
+			public UInt32 height;
+			public Int64 duration;
+			public Int64 frameDuration;
+			public UInt32 keyframeCount;
+			public UInt32 reserved;
+			public UInt64 size;
 		};
 
 		public delegate void StateChangedCallback(StateChangedMessage args);
@@ -35,6 +292,9 @@ namespace Adrenak.GPUVideoPlayer {
 		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "LoadContent")]
 		public static extern long LoadContent([MarshalAs(UnmanagedType.BStr)] string sourceURL);
 
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PreloadContent")]
+		public static extern long PreloadContent([MarshalAs(UnmanagedType.BStr)] string sourceURL);
+
 		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "Play")]
 		public static extern long Play();
 
@@ -59,6 +319,208 @@ namespace Adrenak.GPUVideoPlayer {
 		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "SetPosition")]
 		public static extern long SetPosition(Int64 position);
 
+		// Handle based api, one native player per handle
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerCreate")]
+		public static extern long PlayerCreate(StateChangedCallback callback, out UInt32 handle);
+
+		// backend: 0 auto, 1 hardware, 2 WARP device (no gpu needed, frames come back through readback)
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerCreateEx")]
+		public static extern long PlayerCreateEx(StateChangedCallback callback, UInt32 backend, out UInt32 handle);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerRelease")]
+		public static extern long PlayerRelease(UInt32 handle);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerCreatePlaybackTexture")]
+		public static extern long PlayerCreatePlaybackTexture(UInt32 handle, UInt32 width, UInt32 height, out System.IntPtr playbackTexture);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerLoadContent")]
+		public static extern long PlayerLoadContent(UInt32 handle, [MarshalAs(UnmanagedType.BStr)] string sourceURL);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerPlay")]
+		public static extern long PlayerPlay(UInt32 handle);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerPause")]
+		public static extern long PlayerPause(UInt32 handle);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerStop")]
+		public static extern long PlayerStop(UInt32 handle);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetPosition")]
+		public static extern long PlayerGetPosition(UInt32 handle, out Int64 position);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetDuration")]
+		public static extern long PlayerGetDuration(UInt32 handle, out Int64 duration);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetPlaybackRate")]
+		public static extern long PlayerGetPlaybackRate(UInt32 handle, out Double rate);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetPlaybackRate")]
+		public static extern long PlayerSetPlaybackRate(UInt32 handle, Double rate);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetPosition")]
+		public static extern long PlayerSetPosition(UInt32 handle, Int64 position);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetPlaybackTexture")]
+		public static extern long PlayerGetPlaybackTexture(UInt32 handle, out System.IntPtr playbackTexture);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerCreatePlaybackTextureEx")]
+		public static extern long PlayerCreatePlaybackTextureEx(UInt32 handle, UInt32 width, UInt32 height, UInt32 format, out System.IntPtr playbackTexture, out System.IntPtr chromaTexture);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetPlaybackPlanes")]
+		public static extern long PlayerGetPlaybackPlanes(UInt32 handle, out System.IntPtr playbackTexture, out System.IntPtr chromaTexture);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetReadbackEnabled")]
+		public static extern long PlayerSetReadbackEnabled(UInt32 handle, [MarshalAs(UnmanagedType.Bool)] bool enabled);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerAcquireReadbackFrame")]
+		public static extern long PlayerAcquireReadbackFrame(UInt32 handle, out ReadbackFrame frame);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerReleaseReadbackFrame")]
+		public static extern long PlayerReleaseReadbackFrame(UInt32 handle, UInt64 frameId);
+
+		// op: 0 latches every player, 1 only the given one
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetRenderEventId")]
+		public static extern long PlayerGetRenderEventId(UInt32 handle, UInt32 op, out Int32 eventId);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetPresentationStats")]
+		public static extern long PlayerGetPresentationStats(UInt32 handle, out PresentationStats stats);
+
+		// players created with a null callback queue their state messages until drained
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerDrainEvents")]
+		public static extern long PlayerDrainEvents(UInt32 handle, [Out] StateChangedMessage[] events, UInt32 capacity, out UInt32 count);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetStatus")]
+		public static extern long PlayerGetStatus(UInt32 handle, out PlaybackStatus status);
+
+		// returns 1 (S_FALSE) when the array was too small for every player
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetAllStatus")]
+		public static extern long PlayerGetAllStatus([Out] PlaybackStatus[] status, UInt32 capacity, out UInt32 count);
+
+		// timestamped native events (load, open, frames, copies, seeks, state changes) for chrome://tracing
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetTraceEnabled")]
+		public static extern void PlayerSetTraceEnabled(bool enabled);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerWriteTrace")]
+		public static extern long PlayerWriteTrace([MarshalAs(UnmanagedType.BStr)] string path);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetPlaybackStats")]
+		public static extern long PlayerGetPlaybackStats(UInt32 handle, out PlaybackStats stats, bool reset);
+
+		// playlists, PlayerLoadContent starts one with a single item
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerPlaylistAppend")]
+		public static extern long PlayerPlaylistAppend(UInt32 handle, [MarshalAs(UnmanagedType.BStr)] string sourceURL);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerPlaylistInsert")]
+		public static extern long PlayerPlaylistInsert(UInt32 handle, UInt32 index, [MarshalAs(UnmanagedType.BStr)] string sourceURL);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerPlaylistRemove")]
+		public static extern long PlayerPlaylistRemove(UInt32 handle, UInt32 index);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerPlaylistMoveTo")]
+		public static extern long PlayerPlaylistMoveTo(UInt32 handle, UInt32 index);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetPlaylistRepeat")]
+		public static extern long PlayerSetPlaylistRepeat(UInt32 handle, UInt32 repeat);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetPlaylistPrefetchTime")]
+		public static extern long PlayerSetPlaylistPrefetchTime(UInt32 handle, Int64 prefetchTime);
+
+		// HLS / DASH manifests, Opened or Failed follows once the manifest is loaded
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerLoadAdaptiveContent")]
+		public static extern long PlayerLoadAdaptiveContent(UInt32 handle, [MarshalAs(UnmanagedType.BStr)] string manifestURL, ref AdaptiveSettings settings);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetAdaptiveStats")]
+		public static extern long PlayerGetAdaptiveStats(UInt32 handle, out AdaptiveStats stats, bool reset);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetSeekMode")]
+		public static extern long PlayerSetSeekMode(UInt32 handle, UInt32 mode);
+
+		// returns 1 (S_FALSE) while the item is still being indexed, count is the total, pass null to size the array
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetKeyframeTimes")]
+		public static extern long PlayerGetKeyframeTimes(UInt32 handle, [Out] Int64[] times, UInt32 capacity, out UInt32 count);
+
+		// negative frames step backwards, playback is left paused
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerStepFrames")]
+		public static extern long PlayerStepFrames(UInt32 handle, Int32 frames);
+
+		// bytes of video memory for decoded frames around the playhead, 0 (default) disables the cache
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetFrameCacheBudget")]
+		public static extern long PlayerSetFrameCacheBudget(UInt32 handle, Int64 budget);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetFrameCacheStats")]
+		public static extern long PlayerGetFrameCacheStats(UInt32 handle, out FrameCacheStats stats, bool reset);
+
+		// local files loaded after this are read ahead by a thread of their own. Window in bytes, or in
+		// 1/10^7 seconds at the file's average bitrate once opened. Both 0 (default) turns it off
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetReadAhead")]
+		public static extern long PlayerSetReadAhead(UInt32 handle, Int64 window, Int64 duration);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetReadAheadStats")]
+		public static extern long PlayerGetReadAheadStats(UInt32 handle, out ReadAheadStats stats, bool reset);
+
+		// decodes count thumbnails of width x height spread over the video in the background, or reads them
+		// back from the cache directory. Replaces the player's previous thumbnails
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGenerateThumbnails")]
+		public static extern long PlayerGenerateThumbnails(UInt32 handle, [MarshalAs(UnmanagedType.BStr)] string sourceURL, UInt32 count, UInt32 width, UInt32 height);
+
+		// pass null pixels and times to only get the info
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetThumbnails")]
+		public static extern long PlayerGetThumbnails(UInt32 handle, out Thumbnails info, [Out] byte[] pixels, UInt32 size, [Out] Int64[] times, UInt32 capacity);
+
+		// snapshot of the atlas as it is now, valid until the next call or the player is released
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerCreateThumbnailTexture")]
+		public static extern long PlayerCreateThumbnailTexture(UInt32 handle, out IntPtr playbackTexture);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetThumbnailCacheDirectory")]
+		public static extern long PlayerSetThumbnailCacheDirectory([MarshalAs(UnmanagedType.BStr)] string path);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetCount")]
+		public static extern UInt32 PlayerGetCount();
+
+		// opens a source in the background, the next PlayerLoadContent of the same url by any player picks it up
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerPreloadContent")]
+		public static extern long PlayerPreloadContent([MarshalAs(UnmanagedType.BStr)] string sourceURL);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetPreloadLimits")]
+		public static extern long PlayerSetPreloadLimits(Int64 capacity, UInt32 maxEntries);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerClearPreloads")]
+		public static extern void PlayerClearPreloads();
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetPreloadStats")]
+		public static extern long PlayerGetPreloadStats(out PreloadStats stats);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetDeviceStats")]
+		public static extern long PlayerGetDeviceStats(out DeviceStats stats);
+
+		// players share their adapter's media device, which stays around for the next player until trimmed
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerTrimDevices")]
+		public static extern UInt32 PlayerTrimDevices();
+
+		// bytes of output textures kept for the next player of the same size and format, 256mb by default
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerSetTexturePoolBudget")]
+		public static extern long PlayerSetTexturePoolBudget(Int64 budget);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerClearTexturePool")]
+		public static extern void PlayerClearTexturePool();
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetTexturePoolStats")]
+		public static extern long PlayerGetTexturePoolStats(out TexturePoolStats stats);
+
+		// packs every video file under the directory into one bundle, names are the paths relative to it
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerPackBundle")]
+		public static extern long PlayerPackBundle([MarshalAs(UnmanagedType.BStr)] string directory, [MarshalAs(UnmanagedType.BStr)] string bundlePath);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerGetBundleClip")]
+		public static extern long PlayerGetBundleClip([MarshalAs(UnmanagedType.BStr)] string bundlePath, [MarshalAs(UnmanagedType.BStr)] string name, out BundleClip clip);
+
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerCloseBundle")]
+		public static extern long PlayerCloseBundle([MarshalAs(UnmanagedType.BStr)] string bundlePath);
+
+		// the bundle stays open after the first load from it, later loads only look the clip up
+		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "PlayerLoadContentFromBundle")]
+		public static extern long PlayerLoadContentFromBundle(UInt32 handle, [MarshalAs(UnmanagedType.BStr)] string bundlePath, [MarshalAs(UnmanagedType.BStr)] string name);
+
 		// Unity plugin
 		[DllImport("MediaPlayback", CallingConvention = CallingConvention.StdCall, EntryPoint = "SetTimeFromUnity")]
 		public static extern void SetTimeFromUnity(float t);
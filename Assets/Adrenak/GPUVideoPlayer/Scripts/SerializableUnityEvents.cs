@@ -1,7 +1,22 @@
-﻿using System;
-using UnityEngine.Events;
-
+﻿using System;
+using UnityEngine.Events;
+
 namespace Adrenak.GPUVideoPlayer {
 	[Serializable]
-	public class StateUnityEvent : UnityEvent<GPUVideoPlayer.State> { }
-}
+	public class StateUnityEvent : UnityEvent<GPUVideoPlayer.State> { }
+
+	[Serializable]
+	public class ItemUnityEvent : UnityEvent<int> { }
+
+	[Serializable]
+	public class BitrateUnityEvent : UnityEvent<Plugin.BitrateChange> { }
+
+	[Serializable]
+	public class SegmentUnityEvent : UnityEvent<Plugin.SegmentDownload> { }
+
+	[Serializable]
+	public class ThumbnailUnityEvent : UnityEvent<Plugin.ThumbnailProgress> { }
+
+	[Serializable]
+	public class ResolutionUnityEvent : UnityEvent<Plugin.ResolutionChange> { }
+}
@@ -0,0 +1,65 @@
+﻿// Combines the luma and chroma planes of NV12 / P010 playback output into rgb.
+// Must match YuvConversion.h in the native plugin.
+Shader "Adrenak/GPUVideoPlayer/YUVPlanar" {
+	Properties {
+		_MainTex ("Luma", 2D) = "black" {}
+		_ChromaTex ("Chroma", 2D) = "gray" {}
+	}
+
+	SubShader {
+		Tags { "RenderType" = "Opaque" "Queue" = "Geometry" }
+
+		Pass {
+			CGPROGRAM
+			#pragma vertex vert_img
+			#pragma fragment frag
+			#pragma multi_compile YUV_BT601 YUV_BT709 YUV_BT2020
+			#pragma multi_compile _ YUV_FULL_RANGE
+			#pragma multi_compile _ YUV_10BIT
+			#include "UnityCG.cginc"
+
+			sampler2D _MainTex;
+			sampler2D _ChromaTex;
+
+#if defined(YUV_10BIT)
+			// P010 keeps the 10 bit code in the high bits of a 16 bit unorm
+			#define YUV_SAMPLE_SCALE (65535.0 / 64.0 / 1023.0)
+			#define YUV_MAX_CODE 1023.0
+			#define YUV_DEPTH_SCALE 4.0
+#else
+			#define YUV_SAMPLE_SCALE 1.0
+			#define YUV_MAX_CODE 255.0
+			#define YUV_DEPTH_SCALE 1.0
+#endif
+
+#if defined(YUV_BT709)
+			static const float4 YUV_COEFFICIENTS = float4(1.5748, 0.187324, 0.468124, 1.8556);
+#elif defined(YUV_BT2020)
+			static const float4 YUV_COEFFICIENTS = float4(1.4746, 0.164553, 0.571353, 1.8814);
+#else
+			static const float4 YUV_COEFFICIENTS = float4(1.402, 0.344136, 0.714136, 1.772);
+#endif
+
+			fixed4 frag(v2f_img i) : SV_Target {
+				float y = tex2D(_MainTex, i.uv).r * YUV_SAMPLE_SCALE;
+				float2 c = tex2D(_ChromaTex, i.uv).rg * YUV_SAMPLE_SCALE - (128.0 * YUV_DEPTH_SCALE / YUV_MAX_CODE);
+
+#if !defined(YUV_FULL_RANGE)
+				y = (y - 16.0 * YUV_DEPTH_SCALE / YUV_MAX_CODE) * (YUV_MAX_CODE / (219.0 * YUV_DEPTH_SCALE));
+				c = c * (YUV_MAX_CODE / (224.0 * YUV_DEPTH_SCALE));
+#endif
+
+				// c.x = Cb, c.y = Cr
+				float3 rgb;
+				rgb.r = y + YUV_COEFFICIENTS.x * c.y;
+				rgb.g = y - YUV_COEFFICIENTS.y * c.x - YUV_COEFFICIENTS.z * c.y;
+				rgb.b = y + YUV_COEFFICIENTS.w * c.x;
+
+				return fixed4(saturate(rgb), 1);
+			}
+			ENDCG
+		}
+	}
+
+	Fallback Off
+}
@@ -0,0 +1,405 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// portable, built without the precompiled header
+#include "BundleIndex.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // header fields
+    const size_t HeaderMagic = 0;
+    const size_t HeaderVersion = 4;
+    const size_t HeaderCount = 8;
+    const size_t HeaderStringsSize = 12;
+    const size_t HeaderKeyframeCount = 16;
+    const size_t HeaderIndexSize = 24;
+
+    // entry fields
+    const size_t EntryNameOffset = 0;
+    const size_t EntryNameLength = 4;
+    const size_t EntryContentTypeOffset = 8;
+    const size_t EntryContentTypeLength = 12;
+    const size_t EntryDataOffset = 16;
+    const size_t EntryDataSize = 24;
+    const size_t EntryWidth = 32;
+    const size_t EntryHeight = 36;
+    const size_t EntryDuration = 40;
+    const size_t EntryFrameDuration = 48;
+    const size_t EntryKeyframeIndex = 56;
+    const size_t EntryKeyframeCount = 60;
+
+    // clip data is copied through this much at a time
+    const size_t CopySize = 1024 * 1024;
+
+    inline uint32_t ReadU32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0])
+            | (static_cast<uint32_t>(p[1]) << 8)
+            | (static_cast<uint32_t>(p[2]) << 16)
+            | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline uint64_t ReadU64(const uint8_t* p)
+    {
+        return static_cast<uint64_t>(ReadU32(p)) | (static_cast<uint64_t>(ReadU32(p + 4)) << 32);
+    }
+
+    inline void WriteU32(uint8_t* p, uint32_t value)
+    {
+        p[0] = static_cast<uint8_t>(value);
+        p[1] = static_cast<uint8_t>(value >> 8);
+        p[2] = static_cast<uint8_t>(value >> 16);
+        p[3] = static_cast<uint8_t>(value >> 24);
+    }
+
+    inline void WriteU64(uint8_t* p, uint64_t value)
+    {
+        WriteU32(p, static_cast<uint32_t>(value));
+        WriteU32(p + 4, static_cast<uint32_t>(value >> 32));
+    }
+
+    uint64_t AlignData(uint64_t offset)
+    {
+        return (offset + VIDEO_BUNDLE_DATA_ALIGNMENT - 1) / VIDEO_BUNDLE_DATA_ALIGNMENT * VIDEO_BUNDLE_DATA_ALIGNMENT;
+    }
+
+    int CompareNames(const char* pLeft, size_t leftLength, const char* pRight, size_t rightLength)
+    {
+        const int result = memcmp(pLeft, pRight, (leftLength < rightLength) ? leftLength : rightLength);
+        if (0 != result)
+        {
+            return result;
+        }
+
+        return (leftLength < rightLength) ? -1 : ((leftLength > rightLength) ? 1 : 0);
+    }
+
+    // zeros up to the next page, so the next clip starts on one
+    bool WritePadding(IVideoBundleWriter* pWriter, uint64_t* pOffset)
+    {
+        static const uint8_t zeros[VIDEO_BUNDLE_DATA_ALIGNMENT] = {};
+
+        const uint64_t padding = AlignData(*pOffset) - *pOffset;
+        if (0 != padding && !pWriter->Write(zeros, static_cast<size_t>(padding)))
+        {
+            return false;
+        }
+
+        *pOffset += padding;
+
+        return true;
+    }
+}
+
+CVideoBundleIndex::CVideoBundleIndex()
+    : m_count(0)
+    , m_pEntries(nullptr)
+    , m_pKeyframes(nullptr)
+    , m_pStrings(nullptr)
+{
+}
+
+bool CVideoBundleIndex::Attach(
+    const uint8_t* pView,
+    uint64_t size)
+{
+    m_count = 0;
+
+    if (nullptr == pView || size < VIDEO_BUNDLE_HEADER_SIZE
+        || VIDEO_BUNDLE_MAGIC != ReadU32(pView + HeaderMagic)
+        || VIDEO_BUNDLE_VERSION != ReadU32(pView + HeaderVersion))
+    {
+        return false;
+    }
+
+    // the three tables end where the header says the index does, sizes are
+    // checked one at a time so none of the sums can overflow
+    const uint64_t count = ReadU32(pView + HeaderCount);
+    const uint64_t stringsSize = ReadU32(pView + HeaderStringsSize);
+    const uint64_t keyframeCount = ReadU64(pView + HeaderKeyframeCount);
+    const uint64_t indexSize = ReadU64(pView + HeaderIndexSize);
+    if (indexSize > size || indexSize < VIDEO_BUNDLE_HEADER_SIZE
+        || count > (indexSize - VIDEO_BUNDLE_HEADER_SIZE) / VIDEO_BUNDLE_ENTRY_SIZE
+        || keyframeCount > (indexSize - VIDEO_BUNDLE_HEADER_SIZE - count * VIDEO_BUNDLE_ENTRY_SIZE) / sizeof(int64_t)
+        || VIDEO_BUNDLE_HEADER_SIZE + count * VIDEO_BUNDLE_ENTRY_SIZE + keyframeCount * sizeof(int64_t) + stringsSize != indexSize)
+    {
+        return false;
+    }
+
+    const uint8_t* pEntries = pView + VIDEO_BUNDLE_HEADER_SIZE;
+    const uint8_t* pKeyframes = pEntries + count * VIDEO_BUNDLE_ENTRY_SIZE;
+    const uint8_t* pStrings = pKeyframes + keyframeCount * sizeof(int64_t);
+
+    const char* pPreviousName = nullptr;
+    size_t previousLength = 0;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const uint8_t* pEntry = pEntries + i * VIDEO_BUNDLE_ENTRY_SIZE;
+
+        const uint64_t nameOffset = ReadU32(pEntry + EntryNameOffset);
+        const uint64_t nameLength = ReadU32(pEntry + EntryNameLength);
+        const uint64_t contentTypeOffset = ReadU32(pEntry + EntryContentTypeOffset);
+        const uint64_t contentTypeLength = ReadU32(pEntry + EntryContentTypeLength);
+        const uint64_t dataOffset = ReadU64(pEntry + EntryDataOffset);
+        const uint64_t dataSize = ReadU64(pEntry + EntryDataSize);
+        const uint64_t keyframeIndex = ReadU32(pEntry + EntryKeyframeIndex);
+        const uint64_t clipKeyframes = ReadU32(pEntry + EntryKeyframeCount);
+
+        if (0 == nameLength
+            || nameOffset > stringsSize || nameLength > stringsSize - nameOffset
+            || contentTypeOffset > stringsSize || contentTypeLength > stringsSize - contentTypeOffset
+            || keyframeIndex > keyframeCount || clipKeyframes > keyframeCount - keyframeIndex
+            || dataOffset < indexSize || dataOffset > size || dataSize > size - dataOffset)
+        {
+            return false;
+        }
+
+        // sorted and unique, or the binary search could miss
+        const char* pName = reinterpret_cast<const char*>(pStrings + nameOffset);
+        if (nullptr != pPreviousName && CompareNames(pPreviousName, previousLength, pName, static_cast<size_t>(nameLength)) >= 0)
+        {
+            return false;
+        }
+
+        pPreviousName = pName;
+        previousLength = static_cast<size_t>(nameLength);
+    }
+
+    m_count = static_cast<uint32_t>(count);
+    m_pEntries = pEntries;
+    m_pKeyframes = pKeyframes;
+    m_pStrings = pStrings;
+
+    return true;
+}
+
+bool CVideoBundleIndex::GetClip(
+    uint32_t index,
+    VIDEO_BUNDLE_CLIP* pClip) const
+{
+    if (index >= m_count || nullptr == pClip)
+    {
+        return false;
+    }
+
+    // in range, Attach checked every entry
+    const uint8_t* pEntry = m_pEntries + static_cast<size_t>(index) * VIDEO_BUNDLE_ENTRY_SIZE;
+
+    pClip->name = reinterpret_cast<const char*>(m_pStrings + ReadU32(pEntry + EntryNameOffset));
+    pClip->nameLength = ReadU32(pEntry + EntryNameLength);
+    pClip->contentType = reinterpret_cast<const char*>(m_pStrings + ReadU32(pEntry + EntryContentTypeOffset));
+    pClip->contentTypeLength = ReadU32(pEntry + EntryContentTypeLength);
+    pClip->offset = ReadU64(pEntry + EntryDataOffset);
+    pClip->size = ReadU64(pEntry + EntryDataSize);
+    pClip->width = ReadU32(pEntry + EntryWidth);
+    pClip->height = ReadU32(pEntry + EntryHeight);
+    pClip->duration = static_cast<int64_t>(ReadU64(pEntry + EntryDuration));
+    pClip->frameDuration = static_cast<int64_t>(ReadU64(pEntry + EntryFrameDuration));
+    pClip->keyframeCount = ReadU32(pEntry + EntryKeyframeCount);
+    pClip->keyframes = m_pKeyframes + static_cast<size_t>(ReadU32(pEntry + EntryKeyframeIndex)) * sizeof(int64_t);
+
+    return true;
+}
+
+bool CVideoBundleIndex::Find(
+    const char* pName,
+    size_t nameLength,
+    VIDEO_BUNDLE_CLIP* pClip) const
+{
+    if (nullptr == pName || nullptr == pClip)
+    {
+        return false;
+    }
+
+    uint32_t first = 0;
+    uint32_t last = m_count;
+    while (first < last)
+    {
+        const uint32_t middle = first + (last - first) / 2;
+        const uint8_t* pEntry = m_pEntries + static_cast<size_t>(middle) * VIDEO_BUNDLE_ENTRY_SIZE;
+
+        const int result = CompareNames(
+            reinterpret_cast<const char*>(m_pStrings + ReadU32(pEntry + EntryNameOffset)),
+            ReadU32(pEntry + EntryNameLength),
+            pName,
+            nameLength);
+        if (0 == result)
+        {
+            return GetClip(middle, pClip);
+        }
+
+        if (result < 0)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+
+    return false;
+}
+
+void CVideoBundleIndex::GetKeyframeTimes(
+    const VIDEO_BUNDLE_CLIP& clip,
+    std::vector<int64_t>* pTimes)
+{
+    pTimes->resize(clip.keyframeCount);
+    for (uint32_t i = 0; i < clip.keyframeCount; i++)
+    {
+        (*pTimes)[i] = static_cast<int64_t>(ReadU64(clip.keyframes + static_cast<size_t>(i) * sizeof(int64_t)));
+    }
+}
+
+bool WriteVideoBundle(
+    std::vector<VIDEO_BUNDLE_INPUT>* pInputs,
+    IVideoBundleWriter* pWriter)
+{
+    if (nullptr == pInputs || nullptr == pWriter || pInputs->size() > UINT32_MAX / VIDEO_BUNDLE_ENTRY_SIZE)
+    {
+        return false;
+    }
+
+    std::vector<VIDEO_BUNDLE_INPUT>& inputs = *pInputs;
+    std::sort(inputs.begin(), inputs.end(), [](const VIDEO_BUNDLE_INPUT& left, const VIDEO_BUNDLE_INPUT& right)
+    {
+        return CompareNames(left.name.data(), left.name.size(), right.name.data(), right.name.size()) < 0;
+    });
+
+    // probe every clip first, the index goes in front of the data
+    std::vector<MP4_VIDEO_INFO> infos(inputs.size());
+    std::vector<int64_t> keyframes;
+    std::vector<uint32_t> keyframeIndexes(inputs.size());
+    std::string strings;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        const VIDEO_BUNDLE_INPUT& input = inputs[i];
+        if (nullptr == input.pReader || input.name.empty()
+            || (i > 0 && input.name == inputs[i - 1].name))
+        {
+            return false;
+        }
+
+        // anything that isn't an mp4 / mov is packed as it is, with nothing known about it
+        std::vector<int64_t> times;
+        if (!ReadMp4VideoInfo(input.pReader, &infos[i], &times))
+        {
+            times.clear();
+        }
+
+        if (keyframes.size() + times.size() > UINT32_MAX)
+        {
+            return false;
+        }
+
+        keyframeIndexes[i] = static_cast<uint32_t>(keyframes.size());
+        keyframes.insert(keyframes.end(), times.begin(), times.end());
+
+        strings += input.name;
+        strings += input.contentType;
+        if (strings.size() > UINT32_MAX)
+        {
+            return false;
+        }
+    }
+
+    const uint64_t indexSize = VIDEO_BUNDLE_HEADER_SIZE
+        + inputs.size() * VIDEO_BUNDLE_ENTRY_SIZE
+        + keyframes.size() * sizeof(int64_t)
+        + strings.size();
+
+    std::vector<uint8_t> index(static_cast<size_t>(indexSize));
+    uint8_t* pHeader = index.data();
+    WriteU32(pHeader + HeaderMagic, VIDEO_BUNDLE_MAGIC);
+    WriteU32(pHeader + HeaderVersion, VIDEO_BUNDLE_VERSION);
+    WriteU32(pHeader + HeaderCount, static_cast<uint32_t>(inputs.size()));
+    WriteU32(pHeader + HeaderStringsSize, static_cast<uint32_t>(strings.size()));
+    WriteU64(pHeader + HeaderKeyframeCount, keyframes.size());
+    WriteU64(pHeader + HeaderIndexSize, indexSize);
+
+    uint8_t* pKeyframes = pHeader + VIDEO_BUNDLE_HEADER_SIZE + inputs.size() * VIDEO_BUNDLE_ENTRY_SIZE;
+    for (size_t i = 0; i < keyframes.size(); i++)
+    {
+        WriteU64(pKeyframes + i * sizeof(int64_t), static_cast<uint64_t>(keyframes[i]));
+    }
+
+    uint8_t* pStrings = pKeyframes + keyframes.size() * sizeof(int64_t);
+    if (!strings.empty())
+    {
+        memcpy(pStrings, strings.data(), strings.size());
+    }
+
+    uint32_t stringOffset = 0;
+    uint64_t dataOffset = AlignData(indexSize);
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        const VIDEO_BUNDLE_INPUT& input = inputs[i];
+        const MP4_VIDEO_INFO& info = infos[i];
+        const uint64_t dataSize = input.pReader->GetSize();
+        const uint32_t keyframeCount = ((i + 1 < inputs.size()) ? keyframeIndexes[i + 1] : static_cast<uint32_t>(keyframes.size())) - keyframeIndexes[i];
+
+        uint8_t* pEntry = pHeader + VIDEO_BUNDLE_HEADER_SIZE + i * VIDEO_BUNDLE_ENTRY_SIZE;
+        WriteU32(pEntry + EntryNameOffset, stringOffset);
+        WriteU32(pEntry + EntryNameLength, static_cast<uint32_t>(input.name.size()));
+        stringOffset += static_cast<uint32_t>(input.name.size());
+        WriteU32(pEntry + EntryContentTypeOffset, stringOffset);
+        WriteU32(pEntry + EntryContentTypeLength, static_cast<uint32_t>(input.contentType.size()));
+        stringOffset += static_cast<uint32_t>(input.contentType.size());
+        WriteU64(pEntry + EntryDataOffset, dataOffset);
+        WriteU64(pEntry + EntryDataSize, dataSize);
+        WriteU32(pEntry + EntryWidth, info.width);
+        WriteU32(pEntry + EntryHeight, info.height);
+        WriteU64(pEntry + EntryDuration, static_cast<uint64_t>(info.duration));
+        WriteU64(pEntry + EntryFrameDuration, static_cast<uint64_t>(info.frameDuration));
+        WriteU32(pEntry + EntryKeyframeIndex, keyframeIndexes[i]);
+        WriteU32(pEntry + EntryKeyframeCount, keyframeCount);
+
+        dataOffset = AlignData(dataOffset + dataSize);
+    }
+
+    uint64_t offset = 0;
+    if (!pWriter->Write(index.data(), index.size()))
+    {
+        return false;
+    }
+
+    offset += index.size();
+
+    // the clips, each padded to the next page
+    std::vector<uint8_t> buffer(CopySize);
+    for (const VIDEO_BUNDLE_INPUT& input : inputs)
+    {
+        if (!WritePadding(pWriter, &offset))
+        {
+            return false;
+        }
+
+        const uint64_t dataSize = input.pReader->GetSize();
+        for (uint64_t copied = 0; copied < dataSize; )
+        {
+            const size_t size = (dataSize - copied < buffer.size()) ? static_cast<size_t>(dataSize - copied) : buffer.size();
+            if (!input.pReader->Read(copied, buffer.data(), size) || !pWriter->Write(buffer.data(), size))
+            {
+                return false;
+            }
+
+            copied += size;
+        }
+
+        offset += dataSize;
+    }
+
+    return true;
+}
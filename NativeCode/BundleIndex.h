@@ -0,0 +1,112 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include "KeyframeIndex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A bundle packs many short clips into one file, so opening one is a lookup
+// in an index read once instead of a file open and a container probe per
+// clip. What a probe would find out (size, duration, keyframes) is worked
+// out when the bundle is written. Little endian throughout:
+//
+//   header      VIDEO_BUNDLE_HEADER_SIZE bytes
+//   entries     VIDEO_BUNDLE_ENTRY_SIZE bytes per clip, sorted by name
+//   keyframes   int64 times of every clip in turn, 100ns
+//   strings     names and content types, utf-8, not terminated
+//   data        each clip's file as it was, starting on a page
+//
+// Everything before the data is the index. It is read in place, out of the
+// same mapped view the clips are played from.
+
+#define VIDEO_BUNDLE_MAGIC 0x42505647      // "GVPB"
+#define VIDEO_BUNDLE_VERSION 1
+
+#define VIDEO_BUNDLE_HEADER_SIZE 32
+#define VIDEO_BUNDLE_ENTRY_SIZE 64
+
+// clips start on a page, so the pages of one don't hold the end of another
+#define VIDEO_BUNDLE_DATA_ALIGNMENT 4096
+
+typedef struct _VIDEO_BUNDLE_CLIP
+{
+    const char* name;           // into the index, '/' separated relative path
+    size_t nameLength;
+    const char* contentType;
+    size_t contentTypeLength;
+    uint64_t offset;            // of the clip's file in the bundle
+    uint64_t size;
+    uint32_t width;             // 0 for containers that aren't probed, see MP4_VIDEO_INFO
+    uint32_t height;
+    int64_t duration;
+    int64_t frameDuration;
+    uint32_t keyframeCount;
+    const uint8_t* keyframes;   // keyframeCount little endian int64, see GetKeyframeTimes
+} VIDEO_BUNDLE_CLIP;
+
+// the index of a bundle mapped into memory. Only pointers into the view are
+// kept, the view has to outlive it.
+class CVideoBundleIndex
+{
+public:
+    CVideoBundleIndex();
+
+    // checks the header and every entry against the size of the view, once,
+    // so lookups don't have to. False if it isn't a bundle or is cut short.
+    bool Attach(const uint8_t* pView, uint64_t size);
+
+    uint32_t GetCount() const
+    {
+        return m_count;
+    }
+
+    bool GetClip(uint32_t index, VIDEO_BUNDLE_CLIP* pClip) const;
+
+    // binary search on the name, compared bytewise
+    bool Find(const char* pName, size_t nameLength, VIDEO_BUNDLE_CLIP* pClip) const;
+
+    static void GetKeyframeTimes(const VIDEO_BUNDLE_CLIP& clip, std::vector<int64_t>* pTimes);
+
+private:
+    uint32_t m_count;
+    const uint8_t* m_pEntries;
+    const uint8_t* m_pKeyframes;
+    const uint8_t* m_pStrings;
+};
+
+// where WriteVideoBundle writes to, front to back
+class IVideoBundleWriter
+{
+public:
+    virtual ~IVideoBundleWriter() {}
+
+    virtual bool Write(const void* pData, size_t size) = 0;
+};
+
+typedef struct _VIDEO_BUNDLE_INPUT
+{
+    std::string name;           // utf-8, unique within the bundle
+    std::string contentType;
+    IKeyframeIndexReader* pReader;
+} VIDEO_BUNDLE_INPUT;
+
+// writes the inputs as a bundle, sorting them by name. MP4 / MOV files are
+// probed for their size, duration and keyframes, other containers are packed
+// without. False on a duplicate or empty name, or a failed read or write.
+bool WriteVideoBundle(
+    std::vector<VIDEO_BUNDLE_INPUT>* pInputs,
+    IVideoBundleWriter* pWriter);
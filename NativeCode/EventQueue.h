@@ -0,0 +1,138 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Bounded lock-free queue of plain records. Any number of threads push (the
+// media foundation workers), one thread drains (unity's main thread). Each
+// cell carries a sequence number that says whether it is free for the push
+// at that position or holds the record the pop at that position wants, so
+// producers only contend on one counter and never wait on each other.
+//
+// A full queue drops the new record and counts it instead of blocking the
+// producer.
+template <typename T, uint32_t Capacity>
+class CEventQueue
+{
+    static_assert(Capacity >= 2 && 0 == (Capacity & (Capacity - 1)), "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "records are copied across threads and into script");
+
+public:
+    CEventQueue()
+        : m_pushPosition(0)
+        , m_popPosition(0)
+        , m_dropped(0)
+    {
+        for (uint32_t i = 0; i < Capacity; ++i)
+        {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // any thread, false if the queue was full and the record was dropped
+    bool TryPush(const T& record)
+    {
+        size_t position = m_pushPosition.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = m_cells[position & Mask];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (0 == diff)
+            {
+                if (m_pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.record = record;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // the drain has not caught up with this cell yet
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                position = m_pushPosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // consumer thread, false if nothing is queued
+    bool TryPop(T* pRecord)
+    {
+        size_t position = m_popPosition.load(std::memory_order_relaxed);
+        Cell& cell = m_cells[position & Mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (sequence != position + 1)
+        {
+            // empty, or the producer that owns this cell has not finished writing it
+            return false;
+        }
+
+        *pRecord = cell.record;
+        cell.sequence.store(position + Capacity, std::memory_order_release);
+        m_popPosition.store(position + 1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    // consumer thread, copies up to capacity records in push order and returns how many
+    uint32_t Drain(T* pRecords, uint32_t capacity)
+    {
+        if (nullptr == pRecords)
+        {
+            return 0;
+        }
+
+        uint32_t count = 0;
+        while (count < capacity && TryPop(&pRecords[count]))
+        {
+            ++count;
+        }
+
+        return count;
+    }
+
+    uint64_t Dropped() const
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    static const size_t Mask = Capacity - 1;
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T record;
+    };
+
+    // padded rather than alignas, the queue lives inside heap allocated com objects.
+    // Keeps producers and the consumer off each other's cache lines.
+    static const size_t CacheLine = 64;
+
+    Cell m_cells[Capacity];
+    char m_pad0[CacheLine];
+    std::atomic<size_t> m_pushPosition;
+    char m_pad1[CacheLine - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_popPosition;
+    char m_pad2[CacheLine - sizeof(std::atomic<size_t>)];
+    std::atomic<uint64_t> m_dropped;
+};
@@ -0,0 +1,310 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Which slot of a set of decoded frames holds which presentation time, for
+// stepping through frames without decoding them again. The owner keeps one
+// texture per slot and copies frames in and out; this only does the
+// bookkeeping, so it is not locked - the owner calls it under its own lock.
+//
+// Frames are kept sorted by time. Stepping n frames from the one on screen
+// walks n neighbours, and misses if two of them are further apart than one
+// and a half frame durations (a frame in between was never cached). When
+// full, the frame farthest from the playhead makes room.
+class CFrameCache
+{
+public:
+    static const int InvalidSlot = -1;
+
+    typedef struct _STATS
+    {
+        uint32_t slots;
+        uint32_t frames;
+        uint64_t hits;          // steps served from the cache
+        uint64_t misses;        // steps that had to decode
+        uint64_t inserts;
+        uint64_t evictions;
+    } STATS;
+
+    CFrameCache()
+        : m_slotCount(0)
+        , m_frameDuration(0)
+        , m_hits(0)
+        , m_misses(0)
+        , m_inserts(0)
+        , m_evictions(0)
+    {
+    }
+
+    // drops every frame, the counters keep going
+    void Reset(uint32_t slotCount)
+    {
+        m_slotCount = slotCount;
+        m_frames.clear();
+        m_frames.reserve(slotCount);
+        m_writing.assign(slotCount, false);
+        m_frameDuration = 0;
+    }
+
+    void Clear()
+    {
+        Reset(m_slotCount);
+    }
+
+    uint32_t SlotCount() const
+    {
+        return m_slotCount;
+    }
+
+    // known from the container, otherwise the smallest gap between cached frames is used
+    void SetFrameDuration(int64_t duration)
+    {
+        m_frameDuration = (duration > 0) ? duration : 0;
+    }
+
+    // 0 until it is known
+    int64_t GetFrameDuration() const
+    {
+        if (0 != m_frameDuration)
+        {
+            return m_frameDuration;
+        }
+
+        int64_t smallest = 0;
+        for (size_t i = 1; i < m_frames.size(); ++i)
+        {
+            const int64_t gap = m_frames[i].timestamp - m_frames[i - 1].timestamp;
+            if (gap > 0 && (0 == smallest || gap < smallest))
+            {
+                smallest = gap;
+            }
+        }
+
+        return smallest;
+    }
+
+    // slot to copy the frame at timestamp into: the one already holding that
+    // time, a free one, or the one farthest from playhead. InvalidSlot when
+    // the new frame would be the farthest itself.
+    int BeginInsert(int64_t timestamp, int64_t playhead)
+    {
+        if (0 == m_slotCount)
+        {
+            return InvalidSlot;
+        }
+
+        size_t index = 0;
+        if (FindNearest(timestamp, &index))
+        {
+            return TakeSlot(index);
+        }
+
+        if (m_frames.size() + CountWriting() < m_slotCount)
+        {
+            for (uint32_t slot = 0; slot < m_slotCount; ++slot)
+            {
+                if (!m_writing[slot] && !IsCached(slot))
+                {
+                    m_writing[slot] = true;
+                    return static_cast<int>(slot);
+                }
+            }
+        }
+
+        if (m_frames.empty())
+        {
+            return InvalidSlot;
+        }
+
+        // the sorted ends are the only candidates for farthest
+        const size_t last = m_frames.size() - 1;
+        const int64_t front = Distance(m_frames[0].timestamp, playhead);
+        const int64_t back = Distance(m_frames[last].timestamp, playhead);
+        const size_t farthest = (front > back) ? 0 : last;
+        if (Distance(timestamp, playhead) >= ((front > back) ? front : back))
+        {
+            return InvalidSlot;
+        }
+
+        ++m_evictions;
+
+        return TakeSlot(farthest);
+    }
+
+    // the copy into slot finished, or failed and the slot is free again
+    void EndInsert(int slot, int64_t timestamp, bool succeeded)
+    {
+        if (slot < 0 || static_cast<uint32_t>(slot) >= m_slotCount || !m_writing[slot])
+        {
+            return;
+        }
+
+        m_writing[slot] = false;
+        if (!succeeded)
+        {
+            return;
+        }
+
+        size_t index = 0;
+        while (index < m_frames.size() && m_frames[index].timestamp < timestamp)
+        {
+            ++index;
+        }
+
+        Frame frame = { timestamp, slot };
+        m_frames.insert(m_frames.begin() + index, frame);
+        ++m_inserts;
+    }
+
+    // slot and time of the frame steps frames after (before, when negative)
+    // the one at timestamp, InvalidSlot on a miss. Counts a hit or a miss.
+    int Find(int64_t timestamp, int32_t steps, int64_t* pTimestamp)
+    {
+        size_t index = 0;
+        const int64_t duration = GetFrameDuration();
+        if (0 == duration || !FindNearest(timestamp, &index))
+        {
+            ++m_misses;
+            return InvalidSlot;
+        }
+
+        const int64_t maxGap = duration + duration / 2;
+        const int direction = (steps < 0) ? -1 : 1;
+        for (int32_t remaining = (steps < 0) ? -steps : steps; remaining > 0; --remaining)
+        {
+            if ((direction < 0 && 0 == index) || (direction > 0 && index + 1 >= m_frames.size()))
+            {
+                ++m_misses;
+                return InvalidSlot;
+            }
+
+            const size_t next = index + direction;
+            const int64_t gap = Distance(m_frames[next].timestamp, m_frames[index].timestamp);
+            if (gap > maxGap)
+            {
+                ++m_misses;
+                return InvalidSlot;
+            }
+
+            index = next;
+        }
+
+        ++m_hits;
+        *pTimestamp = m_frames[index].timestamp;
+
+        return m_frames[index].slot;
+    }
+
+    STATS GetStats(bool reset)
+    {
+        STATS stats;
+        stats.slots = m_slotCount;
+        stats.frames = static_cast<uint32_t>(m_frames.size());
+        stats.hits = m_hits;
+        stats.misses = m_misses;
+        stats.inserts = m_inserts;
+        stats.evictions = m_evictions;
+
+        if (reset)
+        {
+            m_hits = 0;
+            m_misses = 0;
+            m_inserts = 0;
+            m_evictions = 0;
+        }
+
+        return stats;
+    }
+
+private:
+    struct Frame
+    {
+        int64_t timestamp;
+        int slot;
+    };
+
+    static int64_t Distance(int64_t a, int64_t b)
+    {
+        return (a > b) ? a - b : b - a;
+    }
+
+    // the cached frame within half a frame of timestamp
+    bool FindNearest(int64_t timestamp, size_t* pIndex) const
+    {
+        const int64_t duration = GetFrameDuration();
+        const int64_t tolerance = (0 != duration) ? duration / 2 : 0;
+
+        bool found = false;
+        int64_t best = 0;
+        for (size_t i = 0; i < m_frames.size(); ++i)
+        {
+            const int64_t distance = Distance(m_frames[i].timestamp, timestamp);
+            if (distance <= tolerance && (!found || distance < best))
+            {
+                found = true;
+                best = distance;
+                *pIndex = i;
+            }
+        }
+
+        return found;
+    }
+
+    // removes the frame from the sorted list and hands its slot to a writer
+    int TakeSlot(size_t index)
+    {
+        const int slot = m_frames[index].slot;
+        m_frames.erase(m_frames.begin() + index);
+        m_writing[slot] = true;
+
+        return slot;
+    }
+
+    bool IsCached(uint32_t slot) const
+    {
+        for (size_t i = 0; i < m_frames.size(); ++i)
+        {
+            if (static_cast<uint32_t>(m_frames[i].slot) == slot)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    uint32_t CountWriting() const
+    {
+        uint32_t count = 0;
+        for (uint32_t slot = 0; slot < m_slotCount; ++slot)
+        {
+            count += m_writing[slot] ? 1 : 0;
+        }
+
+        return count;
+    }
+
+    uint32_t m_slotCount;
+    std::vector<Frame> m_frames;        // sorted by timestamp
+    std::vector<bool> m_writing;        // slots handed out by BeginInsert
+    int64_t m_frameDuration;
+
+    uint64_t m_hits;
+    uint64_t m_misses;
+    uint64_t m_inserts;
+    uint64_t m_evictions;
+};
@@ -0,0 +1,310 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <cstdint>
+#include <mutex>
+
+// Ownership state machine for a ring of output surfaces shared between one
+// producer (the decoder) and one consumer (the render thread).
+//
+//     Free -> Writing -> Ready -> Reading -> Free
+//
+// The producer never blocks: when no slot is free it reclaims the oldest
+// Ready slot (drop-oldest). The consumer always moves to the newest Ready
+// slot and discards anything older. The slot being read is never handed to
+// the producer, so with three or more slots both sides always make progress.
+class CFrameRing
+{
+public:
+    enum class SlotState : uint8_t
+    {
+        Free = 0,
+        Writing,
+        Ready,
+        Reading,
+    };
+
+    static const uint32_t MaxSlots = 8;
+    static const int InvalidSlot = -1;
+
+    explicit CFrameRing(uint32_t slotCount = 3)
+    {
+        Reset(slotCount);
+    }
+
+    void Reset(uint32_t slotCount)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        m_slotCount = (slotCount < 1) ? 1 : (slotCount > MaxSlots) ? MaxSlots : slotCount;
+        for (uint32_t i = 0; i < MaxSlots; ++i)
+        {
+            m_slots[i] = Slot();
+        }
+
+        m_readingSlot = InvalidSlot;
+        m_nextSequence = 1;
+        m_framesWritten = 0;
+        m_framesLatched = 0;
+        m_framesDropped = 0;
+    }
+
+    uint32_t SlotCount() const
+    {
+        return m_slotCount;
+    }
+
+    // producer: returns the slot to write into, or InvalidSlot if every slot is owned
+    int BeginWrite()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        int oldestReady = InvalidSlot;
+        for (uint32_t i = 0; i < m_slotCount; ++i)
+        {
+            if (SlotState::Free == m_slots[i].state)
+            {
+                m_slots[i].state = SlotState::Writing;
+                return static_cast<int>(i);
+            }
+
+            if (SlotState::Ready == m_slots[i].state
+                && (InvalidSlot == oldestReady || m_slots[i].sequence < m_slots[oldestReady].sequence))
+            {
+                oldestReady = static_cast<int>(i);
+            }
+        }
+
+        if (InvalidSlot != oldestReady)
+        {
+            // consumer never saw this frame
+            m_slots[oldestReady].state = SlotState::Writing;
+            ++m_framesDropped;
+        }
+
+        return oldestReady;
+    }
+
+    // producer: publishes the slot, timestamp is carried through to the consumer
+    void EndWrite(int slot, int64_t timestamp)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (!IsValid(slot) || SlotState::Writing != m_slots[slot].state)
+        {
+            return;
+        }
+
+        m_slots[slot].state = SlotState::Ready;
+        m_slots[slot].sequence = m_nextSequence++;
+        m_slots[slot].timestamp = timestamp;
+        ++m_framesWritten;
+    }
+
+    // producer: the write failed, slot goes back to the free list
+    void CancelWrite(int slot)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (IsValid(slot) && SlotState::Writing == m_slots[slot].state)
+        {
+            m_slots[slot].state = SlotState::Free;
+        }
+    }
+
+    // consumer: claims the newest Ready slot, or InvalidSlot when nothing new arrived.
+    // The claimed slot is marked Reading right away so the producer cannot reclaim
+    // it; call EndLatch to commit or roll back once the consumer side sync is done.
+    int BeginLatch()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        int newest = InvalidSlot;
+        for (uint32_t i = 0; i < m_slotCount; ++i)
+        {
+            if (SlotState::Ready == m_slots[i].state
+                && (InvalidSlot == newest || m_slots[i].sequence > m_slots[newest].sequence))
+            {
+                newest = static_cast<int>(i);
+            }
+        }
+
+        if (InvalidSlot != newest)
+        {
+            m_slots[newest].state = SlotState::Reading;
+        }
+
+        return newest;
+    }
+
+    struct ReadyFrame
+    {
+        int slot;
+        uint64_t sequence;
+        int64_t timestamp;
+    };
+
+    // consumer: snapshot of the Ready slots, oldest first, for callers that pick
+    // a frame themselves instead of taking the newest
+    uint32_t GetReadyFrames(ReadyFrame* pFrames, uint32_t capacity) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < m_slotCount && count < capacity; ++i)
+        {
+            if (SlotState::Ready != m_slots[i].state)
+            {
+                continue;
+            }
+
+            uint32_t insert = count++;
+            while (insert > 0 && pFrames[insert - 1].sequence > m_slots[i].sequence)
+            {
+                pFrames[insert] = pFrames[insert - 1];
+                --insert;
+            }
+
+            pFrames[insert].slot = static_cast<int>(i);
+            pFrames[insert].sequence = m_slots[i].sequence;
+            pFrames[insert].timestamp = m_slots[i].timestamp;
+        }
+
+        return count;
+    }
+
+    // consumer: as BeginLatch for a frame from GetReadyFrames, fails if the
+    // producer reclaimed the slot in between
+    bool BeginLatchFrame(const ReadyFrame& frame)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (!IsValid(frame.slot) || SlotState::Ready != m_slots[frame.slot].state
+            || frame.sequence != m_slots[frame.slot].sequence)
+        {
+            return false;
+        }
+
+        m_slots[frame.slot].state = SlotState::Reading;
+
+        return true;
+    }
+
+    // consumer: on commit the previous Reading slot and any older Ready slots are freed,
+    // returns the slot that was being read before (InvalidSlot if none)
+    int EndLatch(int slot, bool commit)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (!IsValid(slot) || SlotState::Reading != m_slots[slot].state)
+        {
+            return InvalidSlot;
+        }
+
+        if (!commit)
+        {
+            m_slots[slot].state = SlotState::Ready;
+            return InvalidSlot;
+        }
+
+        int previous = m_readingSlot;
+        if (IsValid(previous) && previous != slot)
+        {
+            m_slots[previous].state = SlotState::Free;
+        }
+
+        for (uint32_t i = 0; i < m_slotCount; ++i)
+        {
+            if (SlotState::Ready == m_slots[i].state && m_slots[i].sequence < m_slots[slot].sequence)
+            {
+                m_slots[i].state = SlotState::Free;
+                ++m_framesDropped;
+            }
+        }
+
+        m_readingSlot = slot;
+        ++m_framesLatched;
+
+        return previous;
+    }
+
+    // consumer: marks a slot as already held for reading, used for the initial surface
+    void SetReadingSlot(int slot)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (!IsValid(slot) || SlotState::Free != m_slots[slot].state)
+        {
+            return;
+        }
+
+        if (IsValid(m_readingSlot))
+        {
+            m_slots[m_readingSlot].state = SlotState::Free;
+        }
+
+        m_slots[slot].state = SlotState::Reading;
+        m_readingSlot = slot;
+    }
+
+    int ReadingSlot() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        return m_readingSlot;
+    }
+
+    SlotState GetState(int slot) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        return IsValid(slot) ? m_slots[slot].state : SlotState::Free;
+    }
+
+    int64_t GetTimestamp(int slot) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        return IsValid(slot) ? m_slots[slot].timestamp : 0;
+    }
+
+    uint64_t FramesWritten() const { std::lock_guard<std::mutex> lock(m_lock); return m_framesWritten; }
+    uint64_t FramesLatched() const { std::lock_guard<std::mutex> lock(m_lock); return m_framesLatched; }
+    uint64_t FramesDropped() const { std::lock_guard<std::mutex> lock(m_lock); return m_framesDropped; }
+
+private:
+    struct Slot
+    {
+        Slot() : state(SlotState::Free), sequence(0), timestamp(0) {}
+
+        SlotState state;
+        uint64_t sequence;
+        int64_t timestamp;
+    };
+
+    bool IsValid(int slot) const
+    {
+        return slot >= 0 && static_cast<uint32_t>(slot) < m_slotCount && static_cast<uint32_t>(slot) < MaxSlots;
+    }
+
+private:
+    mutable std::mutex m_lock;
+    Slot m_slots[MaxSlots];
+    uint32_t m_slotCount;
+    int m_readingSlot;
+    uint64_t m_nextSequence;
+    uint64_t m_framesWritten;
+    uint64_t m_framesLatched;
+    uint64_t m_framesDropped;
+};
@@ -0,0 +1,246 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+// A handle packs a slot index and the generation of that slot:
+//     bits  0..15 - slot index + 1 (so a zero handle is never valid)
+//     bits 16..31 - slot generation, bumped every time the slot is freed
+// A stale handle to a reused slot fails lookup instead of hitting the new owner.
+template <typename T>
+class CHandleTable
+{
+public:
+    static const uint32_t InvalidHandle = 0;
+    static const uint32_t MaxSlots = 0xFFFF;
+
+    explicit CHandleTable(uint32_t reserve = 64)
+    {
+        m_slots.reserve(reserve);
+        m_freeList.reserve(reserve);
+    }
+
+    // stores value in a free slot, returns false when the table is full
+    bool Insert(T value, uint32_t* pHandle)
+    {
+        if (nullptr == pHandle)
+        {
+            return false;
+        }
+
+        *pHandle = InvalidHandle;
+
+        std::unique_lock<std::shared_mutex> lock(m_lock);
+
+        uint32_t index = 0;
+        if (!m_freeList.empty())
+        {
+            index = m_freeList.back();
+            m_freeList.pop_back();
+        }
+        else
+        {
+            if (m_slots.size() >= MaxSlots)
+            {
+                return false;
+            }
+
+            index = static_cast<uint32_t>(m_slots.size());
+            m_slots.emplace_back();
+        }
+
+        Slot& slot = m_slots[index];
+        slot.value = std::move(value);
+        slot.inUse = true;
+
+        ++m_count;
+
+        *pHandle = MakeHandle(index, slot.generation);
+
+        return true;
+    }
+
+    // copies the value out under a shared lock, so callers never hold the table lock
+    bool Lookup(uint32_t handle, T* pValue) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+
+        const Slot* pSlot = Resolve(handle);
+        if (nullptr == pSlot)
+        {
+            return false;
+        }
+
+        if (nullptr != pValue)
+        {
+            *pValue = pSlot->value;
+        }
+
+        return true;
+    }
+
+    // as Lookup, for callers that only kept the bits of a handle selected by mask.
+    // The mask has to cover the index bits, the generation is compared on the masked bits only.
+    bool LookupMasked(uint32_t maskedHandle, uint32_t mask, T* pValue, uint32_t* pHandle) const
+    {
+        if (0xFFFF != (mask & 0xFFFF) || 0 == (maskedHandle & 0xFFFF))
+        {
+            return false;
+        }
+
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+
+        uint32_t index = IndexOf(maskedHandle);
+        if (index >= m_slots.size() || !m_slots[index].inUse)
+        {
+            return false;
+        }
+
+        uint32_t handle = MakeHandle(index, m_slots[index].generation);
+        if ((handle & mask) != (maskedHandle & mask))
+        {
+            return false;
+        }
+
+        if (nullptr != pValue)
+        {
+            *pValue = m_slots[index].value;
+        }
+
+        if (nullptr != pHandle)
+        {
+            *pHandle = handle;
+        }
+
+        return true;
+    }
+
+    // frees the slot and hands the value back, so it can be destroyed outside the lock
+    bool Remove(uint32_t handle, T* pValue)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_lock);
+
+        Slot* pSlot = const_cast<Slot*>(Resolve(handle));
+        if (nullptr == pSlot)
+        {
+            return false;
+        }
+
+        T value = std::move(pSlot->value);
+        pSlot->value = T();
+        pSlot->inUse = false;
+        pSlot->generation = NextGeneration(pSlot->generation);
+
+        m_freeList.push_back(IndexOf(handle));
+        --m_count;
+
+        lock.unlock();
+
+        if (nullptr != pValue)
+        {
+            *pValue = std::move(value);
+        }
+
+        return true;
+    }
+
+    // snapshots all live entries, then calls fn(handle, value) without the lock held
+    template <typename Fn>
+    void ForEach(Fn fn) const
+    {
+        std::vector<std::pair<uint32_t, T>> entries;
+        {
+            std::shared_lock<std::shared_mutex> lock(m_lock);
+
+            entries.reserve(m_count);
+            for (uint32_t i = 0; i < m_slots.size(); ++i)
+            {
+                if (m_slots[i].inUse)
+                {
+                    entries.emplace_back(MakeHandle(i, m_slots[i].generation), m_slots[i].value);
+                }
+            }
+        }
+
+        for (auto& entry : entries)
+        {
+            fn(entry.first, entry.second);
+        }
+    }
+
+    uint32_t Count() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_lock);
+
+        return m_count;
+    }
+
+    static uint32_t IndexOf(uint32_t handle)
+    {
+        return (handle & 0xFFFF) - 1;
+    }
+
+private:
+    struct Slot
+    {
+        Slot() : value(), generation(1), inUse(false) {}
+
+        T value;
+        uint16_t generation;
+        bool inUse;
+    };
+
+    static uint32_t MakeHandle(uint32_t index, uint16_t generation)
+    {
+        return (static_cast<uint32_t>(generation) << 16) | (index + 1);
+    }
+
+    static uint16_t NextGeneration(uint16_t generation)
+    {
+        // skip 0 on wrap, keeps every issued handle non-zero in the high word
+        return (generation == 0xFFFF) ? 1 : static_cast<uint16_t>(generation + 1);
+    }
+
+    const Slot* Resolve(uint32_t handle) const
+    {
+        if (InvalidHandle == handle || 0 == (handle & 0xFFFF))
+        {
+            return nullptr;
+        }
+
+        uint32_t index = IndexOf(handle);
+        if (index >= m_slots.size())
+        {
+            return nullptr;
+        }
+
+        const Slot& slot = m_slots[index];
+        if (!slot.inUse || slot.generation != static_cast<uint16_t>(handle >> 16))
+        {
+            return nullptr;
+        }
+
+        return &slot;
+    }
+
+private:
+    mutable std::shared_mutex m_lock;
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeList;
+    uint32_t m_count = 0;
+};
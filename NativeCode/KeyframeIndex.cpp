@@ -0,0 +1,504 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// portable, built without the precompiled header
+#include "KeyframeIndex.h"
+
+#include <cstring>
+
+namespace
+{
+    const int64_t TicksPerSecond = 10000000;
+
+    inline uint32_t BoxType(const char (&name)[5])
+    {
+        return (static_cast<uint32_t>(static_cast<uint8_t>(name[0])) << 24)
+            | (static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 16)
+            | (static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 8)
+            | static_cast<uint32_t>(static_cast<uint8_t>(name[3]));
+    }
+
+    inline uint32_t ReadU32(const uint8_t* p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24)
+            | (static_cast<uint32_t>(p[1]) << 16)
+            | (static_cast<uint32_t>(p[2]) << 8)
+            | static_cast<uint32_t>(p[3]);
+    }
+
+    inline uint64_t ReadU64(const uint8_t* p)
+    {
+        return (static_cast<uint64_t>(ReadU32(p)) << 32) | ReadU32(p + 4);
+    }
+
+    // a box inside a buffer already read into memory
+    typedef struct _BOX
+    {
+        uint32_t type;
+        const uint8_t* data;    // payload, past the header
+        size_t size;
+    } BOX;
+
+    // walks the boxes of a payload, false at the end or on a malformed box
+    class CBoxIterator
+    {
+    public:
+        CBoxIterator(const uint8_t* data, size_t size)
+            : m_data(data)
+            , m_size(size)
+            , m_offset(0)
+        {
+        }
+
+        bool Next(BOX* pBox)
+        {
+            if (m_size - m_offset < 8)
+            {
+                return false;
+            }
+
+            const uint8_t* p = m_data + m_offset;
+            uint64_t boxSize = ReadU32(p);
+            size_t headerSize = 8;
+            if (1 == boxSize)
+            {
+                if (m_size - m_offset < 16)
+                {
+                    return false;
+                }
+
+                boxSize = ReadU64(p + 8);
+                headerSize = 16;
+            }
+            else if (0 == boxSize)
+            {
+                boxSize = m_size - m_offset;
+            }
+
+            if (boxSize < headerSize || boxSize > m_size - m_offset)
+            {
+                return false;
+            }
+
+            pBox->type = ReadU32(p + 4);
+            pBox->data = p + headerSize;
+            pBox->size = static_cast<size_t>(boxSize) - headerSize;
+
+            m_offset += static_cast<size_t>(boxSize);
+
+            return true;
+        }
+
+        bool Find(uint32_t type, BOX* pBox)
+        {
+            while (Next(pBox))
+            {
+                if (type == pBox->type)
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+    private:
+        const uint8_t* m_data;
+        size_t m_size;
+        size_t m_offset;
+    };
+
+    bool FindChild(const BOX& parent, uint32_t type, BOX* pBox)
+    {
+        CBoxIterator it(parent.data, parent.size);
+        return it.Find(type, pBox);
+    }
+
+    // full boxes whose payload is a version / flags word, an entry count and
+    // entryCount entries of entrySize bytes
+    bool GetTable(const BOX& box, size_t entrySize, const uint8_t** ppEntries, uint32_t* pCount)
+    {
+        if (box.size < 8)
+        {
+            return false;
+        }
+
+        const uint32_t count = ReadU32(box.data + 4);
+        if (count > (box.size - 8) / entrySize)
+        {
+            return false;
+        }
+
+        *ppEntries = box.data + 8;
+        *pCount = count;
+
+        return true;
+    }
+
+    // time in a track's timescale to 100ns, rounded up
+    int64_t ToTicks(int64_t time, uint32_t timescale)
+    {
+        if (time <= 0)
+        {
+            return 0;
+        }
+
+        const int64_t seconds = time / timescale;
+        const int64_t remainder = time % timescale;
+
+        return seconds * TicksPerSecond + (remainder * TicksPerSecond + timescale - 1) / timescale;
+    }
+
+    typedef struct _TRACK_EDIT
+    {
+        int64_t mediaTime;      // media time presentation starts at, track timescale
+        int64_t delay;          // empty edits before it, 100ns
+    } TRACK_EDIT;
+
+    // only the start of the edit list matters for seeking, later edits that
+    // cut or repeat parts of the track are not followed
+    void ReadEdit(const BOX& trak, uint32_t movieTimescale, TRACK_EDIT* pEdit)
+    {
+        pEdit->mediaTime = 0;
+        pEdit->delay = 0;
+
+        BOX edts;
+        BOX elst;
+        if (!FindChild(trak, BoxType("edts"), &edts) || !FindChild(edts, BoxType("elst"), &elst) || elst.size < 4)
+        {
+            return;
+        }
+
+        const bool wide = (1 == elst.data[0]);
+        const size_t entrySize = wide ? 20 : 12;
+
+        const uint8_t* entries = nullptr;
+        uint32_t count = 0;
+        if (!GetTable(elst, entrySize, &entries, &count))
+        {
+            return;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const uint8_t* entry = entries + i * entrySize;
+            const int64_t duration = wide ? static_cast<int64_t>(ReadU64(entry)) : ReadU32(entry);
+            const int64_t mediaTime = wide ? static_cast<int64_t>(ReadU64(entry + 8)) : static_cast<int32_t>(ReadU32(entry + 4));
+
+            if (-1 == mediaTime)
+            {
+                if (0 != movieTimescale)
+                {
+                    pEdit->delay += ToTicks(duration, movieTimescale);
+                }
+                continue;
+            }
+
+            pEdit->mediaTime = mediaTime;
+            break;
+        }
+    }
+
+    bool IsVideoTrack(const BOX& mdia)
+    {
+        // version / flags, pre_defined, then the handler type
+        BOX hdlr;
+        return FindChild(mdia, BoxType("hdlr"), &hdlr)
+            && hdlr.size >= 12
+            && BoxType("vide") == ReadU32(hdlr.data + 8);
+    }
+
+    uint32_t ReadTimescale(const BOX& box)
+    {
+        // mvhd and mdhd both put it after the creation and modification times
+        if (box.size < 4)
+        {
+            return 0;
+        }
+
+        const size_t offset = (1 == box.data[0]) ? 20 : 12;
+        return (box.size >= offset + 4) ? ReadU32(box.data + offset) : 0;
+    }
+
+    // in the box's timescale, right after it. All ones is unknown.
+    int64_t ReadDuration(const BOX& box)
+    {
+        if (box.size < 4)
+        {
+            return 0;
+        }
+
+        if (1 == box.data[0])
+        {
+            const uint64_t duration = (box.size >= 32) ? ReadU64(box.data + 24) : 0;
+            return (UINT64_MAX == duration) ? 0 : static_cast<int64_t>(duration & INT64_MAX);
+        }
+
+        const uint32_t duration = (box.size >= 20) ? ReadU32(box.data + 16) : 0;
+        return (UINT32_MAX == duration) ? 0 : duration;
+    }
+
+    // tkhd ends with the presented width and height, 16.16 fixed point, in either version
+    void ReadTrackSize(const BOX& trak, uint32_t* pWidth, uint32_t* pHeight)
+    {
+        *pWidth = 0;
+        *pHeight = 0;
+
+        BOX tkhd;
+        if (!FindChild(trak, BoxType("tkhd"), &tkhd) || tkhd.size < 84)
+        {
+            return;
+        }
+
+        *pWidth = ReadU32(tkhd.data + tkhd.size - 8) >> 16;
+        *pHeight = ReadU32(tkhd.data + tkhd.size - 4) >> 16;
+    }
+
+    bool ReadTrackKeyframes(const BOX& trak, uint32_t movieTimescale, std::vector<int64_t>* pTimes, int64_t* pFrameDuration)
+    {
+        BOX mdia;
+        BOX mdhd;
+        BOX minf;
+        BOX stbl;
+        BOX stts;
+        if (!FindChild(trak, BoxType("mdia"), &mdia)
+            || !IsVideoTrack(mdia)
+            || !FindChild(mdia, BoxType("mdhd"), &mdhd)
+            || !FindChild(mdia, BoxType("minf"), &minf)
+            || !FindChild(minf, BoxType("stbl"), &stbl)
+            || !FindChild(stbl, BoxType("stts"), &stts))
+        {
+            return false;
+        }
+
+        const uint32_t timescale = ReadTimescale(mdhd);
+        if (0 == timescale)
+        {
+            return false;
+        }
+
+        const uint8_t* timeEntries = nullptr;
+        uint32_t timeCount = 0;
+        if (!GetTable(stts, 8, &timeEntries, &timeCount))
+        {
+            return false;
+        }
+
+        // without stss every sample is a sync sample
+        BOX stss;
+        const uint8_t* syncEntries = nullptr;
+        uint32_t syncCount = 0;
+        const bool allSync = !FindChild(stbl, BoxType("stss"), &stss);
+        if (!allSync && !GetTable(stss, 4, &syncEntries, &syncCount))
+        {
+            return false;
+        }
+
+        // composition offsets are signed in version 1 and, in practice, in
+        // version 0 files written by encoders that use b-frames too
+        BOX ctts;
+        const uint8_t* offsetEntries = nullptr;
+        uint32_t offsetCount = 0;
+        if (FindChild(stbl, BoxType("ctts"), &ctts) && !GetTable(ctts, 8, &offsetEntries, &offsetCount))
+        {
+            return false;
+        }
+
+        TRACK_EDIT edit;
+        ReadEdit(trak, movieTimescale, &edit);
+
+        pTimes->clear();
+        pTimes->reserve(allSync ? 0 : syncCount);
+
+        // the delta of the stts entry covering the most samples, rounded to nearest
+        uint32_t mostSamples = 0;
+        *pFrameDuration = 0;
+        for (uint32_t i = 0; i < timeCount; i++)
+        {
+            const uint32_t samples = ReadU32(timeEntries + i * 8);
+            if (samples > mostSamples)
+            {
+                mostSamples = samples;
+                *pFrameDuration = (static_cast<int64_t>(ReadU32(timeEntries + i * 8 + 4)) * TicksPerSecond + timescale / 2) / timescale;
+            }
+        }
+
+        // one pass over the samples in decode order, the sync sample numbers
+        // are 1-based and ascending
+        uint32_t sample = 1;
+        uint32_t syncIndex = 0;
+        uint32_t offsetIndex = 0;
+        uint32_t offsetLeft = (offsetCount > 0) ? ReadU32(offsetEntries) : 0;
+        int64_t decodeTime = 0;
+
+        for (uint32_t i = 0; i < timeCount && (allSync || syncIndex < syncCount); i++)
+        {
+            const uint32_t samples = ReadU32(timeEntries + i * 8);
+            const uint32_t delta = ReadU32(timeEntries + i * 8 + 4);
+
+            for (uint32_t j = 0; j < samples; j++, sample++, decodeTime += delta)
+            {
+                while (0 == offsetLeft && offsetIndex + 1 < offsetCount)
+                {
+                    offsetIndex++;
+                    offsetLeft = ReadU32(offsetEntries + offsetIndex * 8);
+                }
+
+                int64_t offset = 0;
+                if (offsetLeft > 0)
+                {
+                    offset = static_cast<int32_t>(ReadU32(offsetEntries + offsetIndex * 8 + 4));
+                    offsetLeft--;
+                }
+
+                while (!allSync && syncIndex < syncCount && ReadU32(syncEntries + syncIndex * 4) < sample)
+                {
+                    syncIndex++;
+                }
+
+                if (!allSync && (syncIndex >= syncCount || ReadU32(syncEntries + syncIndex * 4) != sample))
+                {
+                    continue;
+                }
+
+                const int64_t presentationTime = decodeTime + offset - edit.mediaTime;
+                pTimes->push_back(edit.delay + ToTicks(presentationTime, timescale));
+            }
+        }
+
+        std::sort(pTimes->begin(), pTimes->end());
+        pTimes->erase(std::unique(pTimes->begin(), pTimes->end()), pTimes->end());
+
+        return true;
+    }
+
+    // finds moov among the top level boxes and reads it into memory
+    bool ReadMoov(IKeyframeIndexReader* pReader, std::vector<uint8_t>* pMoov)
+    {
+        const uint64_t fileSize = pReader->GetSize();
+
+        uint64_t offset = 0;
+        while (fileSize - offset >= 8)
+        {
+            uint8_t header[16];
+            if (!pReader->Read(offset, header, 8))
+            {
+                return false;
+            }
+
+            uint64_t boxSize = ReadU32(header);
+            uint64_t headerSize = 8;
+            if (1 == boxSize)
+            {
+                if (fileSize - offset < 16 || !pReader->Read(offset + 8, header + 8, 8))
+                {
+                    return false;
+                }
+
+                boxSize = ReadU64(header + 8);
+                headerSize = 16;
+            }
+            else if (0 == boxSize)
+            {
+                boxSize = fileSize - offset;
+            }
+
+            if (boxSize < headerSize || boxSize > fileSize - offset)
+            {
+                return false;
+            }
+
+            if (BoxType("moov") == ReadU32(header + 4))
+            {
+                const uint64_t payloadSize = boxSize - headerSize;
+                if (payloadSize > KEYFRAME_INDEX_MAX_MOOV_SIZE)
+                {
+                    return false;
+                }
+
+                pMoov->resize(static_cast<size_t>(payloadSize));
+                return pMoov->empty() || pReader->Read(offset + headerSize, pMoov->data(), pMoov->size());
+            }
+
+            offset += boxSize;
+        }
+
+        return false;
+    }
+}
+
+bool ReadMp4KeyframeTimes(
+    IKeyframeIndexReader* pReader,
+    std::vector<int64_t>* pTimes,
+    int64_t* pFrameDuration)
+{
+    if (nullptr == pFrameDuration)
+    {
+        return false;
+    }
+
+    MP4_VIDEO_INFO info;
+    const bool succeeded = ReadMp4VideoInfo(pReader, &info, pTimes);
+
+    *pFrameDuration = info.frameDuration;
+
+    return succeeded;
+}
+
+bool ReadMp4VideoInfo(
+    IKeyframeIndexReader* pReader,
+    MP4_VIDEO_INFO* pInfo,
+    std::vector<int64_t>* pTimes)
+{
+    if (nullptr == pInfo)
+    {
+        return false;
+    }
+
+    memset(pInfo, 0, sizeof(*pInfo));
+
+    if (nullptr == pReader || nullptr == pTimes)
+    {
+        return false;
+    }
+
+    pTimes->clear();
+
+    std::vector<uint8_t> moovData;
+    if (!ReadMoov(pReader, &moovData))
+    {
+        return false;
+    }
+
+    BOX moov = { BoxType("moov"), moovData.data(), moovData.size() };
+
+    // the edit list durations are in the movie timescale
+    BOX mvhd;
+    const bool hasMvhd = FindChild(moov, BoxType("mvhd"), &mvhd);
+    const uint32_t movieTimescale = hasMvhd ? ReadTimescale(mvhd) : 0;
+    if (0 != movieTimescale)
+    {
+        pInfo->duration = ToTicks(ReadDuration(mvhd), movieTimescale);
+    }
+
+    CBoxIterator it(moov.data, moov.size);
+    BOX trak;
+    while (it.Find(BoxType("trak"), &trak))
+    {
+        if (ReadTrackKeyframes(trak, movieTimescale, pTimes, &pInfo->frameDuration))
+        {
+            ReadTrackSize(trak, &pInfo->width, &pInfo->height);
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,160 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Presentation times of the keyframes (sync samples) of an MP4 / MOV file,
+// so a seek can land on one and skip decoding the rest of its group of
+// pictures. Only the sample tables in moov are read: stss for which samples
+// are sync, stts and ctts for their times, elst for where presentation
+// starts. Fragmented files keep their samples in moof boxes and come back
+// empty, they are seeked exactly.
+
+// the moov of a long file is a few mb, anything far past that isn't an index
+#define KEYFRAME_INDEX_MAX_MOOV_SIZE (256 * 1024 * 1024)
+
+class IKeyframeIndexReader
+{
+public:
+    virtual ~IKeyframeIndexReader() {}
+
+    // false if fewer than size bytes could be read at offset
+    virtual bool Read(uint64_t offset, void* buffer, size_t size) = 0;
+
+    virtual uint64_t GetSize() = 0;
+};
+
+// keyframe times of the first video track in 100ns units, sorted and
+// rounded up, so a seek to one never starts decoding a group of pictures
+// early. The frame duration is the one most samples have, 0 if there are
+// none. False if the file isn't an MP4 / MOV or has no video track.
+bool ReadMp4KeyframeTimes(
+    IKeyframeIndexReader* pReader,
+    std::vector<int64_t>* pTimes,
+    int64_t* pFrameDuration);
+
+typedef struct _MP4_VIDEO_INFO
+{
+    uint32_t width;             // first video track as presented, 0 if unknown
+    uint32_t height;
+    int64_t duration;           // 100ns, of the whole movie, 0 if unknown
+    int64_t frameDuration;      // as ReadMp4KeyframeTimes
+} MP4_VIDEO_INFO;
+
+// ReadMp4KeyframeTimes plus the video's size and duration, out of the same
+// read of moov. For indexes written ahead of time, see BundleIndex.h.
+bool ReadMp4VideoInfo(
+    IKeyframeIndexReader* pReader,
+    MP4_VIDEO_INFO* pInfo,
+    std::vector<int64_t>* pTimes);
+
+// built once on a worker thread while the item is opening, then read only.
+// Until it is ready, or when it came back empty, every snap returns the
+// time it was given.
+class CKeyframeIndex
+{
+public:
+    CKeyframeIndex()
+        : m_ready(false)
+        , m_frameDuration(0)
+    {
+    }
+
+    void SetTimes(std::vector<int64_t>&& times, int64_t frameDuration)
+    {
+        if (m_ready.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        m_times = std::move(times);
+        m_frameDuration = frameDuration;
+        m_ready.store(true, std::memory_order_release);
+    }
+
+    bool IsReady() const
+    {
+        return m_ready.load(std::memory_order_acquire);
+    }
+
+    size_t GetCount() const
+    {
+        return IsReady() ? m_times.size() : 0;
+    }
+
+    // 100ns, 0 until ready or if unknown
+    int64_t GetFrameDuration() const
+    {
+        return IsReady() ? m_frameDuration : 0;
+    }
+
+    // copies up to capacity times and returns how many there are in total
+    size_t GetTimes(int64_t* pTimes, size_t capacity) const
+    {
+        const size_t count = GetCount();
+        const size_t copied = (count < capacity) ? count : capacity;
+        if (nullptr != pTimes && copied > 0)
+        {
+            std::copy(m_times.begin(), m_times.begin() + copied, pTimes);
+        }
+
+        return count;
+    }
+
+    // last keyframe at or before time, the first one before any
+    int64_t SnapPrevious(int64_t time) const
+    {
+        if (0 == GetCount())
+        {
+            return time;
+        }
+
+        auto it = std::upper_bound(m_times.begin(), m_times.end(), time);
+        return (it == m_times.begin()) ? *it : *(it - 1);
+    }
+
+    // closest keyframe either side of time, the earlier one on a tie
+    int64_t SnapNearest(int64_t time) const
+    {
+        if (0 == GetCount())
+        {
+            return time;
+        }
+
+        auto it = std::lower_bound(m_times.begin(), m_times.end(), time);
+        if (it == m_times.end())
+        {
+            return *(it - 1);
+        }
+
+        if (it == m_times.begin() || *it == time)
+        {
+            return *it;
+        }
+
+        const int64_t after = *it;
+        const int64_t before = *(it - 1);
+        return (after - time < time - before) ? after : before;
+    }
+
+private:
+    std::atomic<bool> m_ready;
+    std::vector<int64_t> m_times;
+    int64_t m_frameDuration;
+};
@@ -0,0 +1,278 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Values found by key and charged a cost, the least recently used ones are
+// evicted while the total is over capacity or there are too many entries.
+// Entries also get an id, so whoever inserted one can find that exact entry
+// again after the key was reused.
+//
+// Evicted and removed values are handed back to the caller instead of being
+// destroyed under the lock, so releasing them may take locks of its own.
+template <typename Key, typename T>
+class CLruCache
+{
+public:
+    typedef struct _STATS
+    {
+        uint32_t entries;
+        int64_t cost;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+    } STATS;
+
+    CLruCache(int64_t capacity, uint32_t maxEntries)
+        : m_capacity(capacity)
+        , m_maxEntries(maxEntries)
+        , m_cost(0)
+        , m_nextId(1)
+        , m_hits(0)
+        , m_misses(0)
+        , m_evictions(0)
+    {
+    }
+
+    void SetLimits(int64_t capacity, uint32_t maxEntries, std::vector<T>* pEvicted)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        m_capacity = capacity;
+        m_maxEntries = maxEntries;
+
+        Trim(pEvicted);
+    }
+
+    // newest entry, returns its id. 0 if the value alone is over capacity, it is evicted right away
+    uint64_t Insert(const Key& key, T value, int64_t cost, std::vector<T>* pEvicted)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (cost > m_capacity)
+        {
+            pEvicted->push_back(std::move(value));
+            ++m_evictions;
+            return 0;
+        }
+
+        Entry entry;
+        entry.key = key;
+        entry.value = std::move(value);
+        entry.cost = cost;
+        entry.id = m_nextId++;
+
+        m_entries.push_front(std::move(entry));
+        m_cost += cost;
+
+        uint64_t id = m_entries.front().id;
+        Trim(pEvicted);
+
+        return id;
+    }
+
+    // marks the key as used, without counting a hit
+    bool Touch(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto it = FindKey(key);
+        if (m_entries.end() == it)
+        {
+            return false;
+        }
+
+        m_entries.splice(m_entries.begin(), m_entries, it);
+
+        return true;
+    }
+
+    // removes the entry for key and hands its value over, counts a hit or a miss
+    bool Take(const Key& key, T* pValue)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto it = FindKey(key);
+        if (m_entries.end() == it)
+        {
+            ++m_misses;
+            return false;
+        }
+
+        ++m_hits;
+        *pValue = std::move(it->value);
+        m_cost -= it->cost;
+        m_entries.erase(it);
+
+        return true;
+    }
+
+    // copies the value of an entry that is still cached
+    bool Find(uint64_t id, T* pValue) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto it = FindId(id);
+        if (m_entries.end() == it)
+        {
+            return false;
+        }
+
+        *pValue = it->value;
+
+        return true;
+    }
+
+    bool SetCost(uint64_t id, int64_t cost, std::vector<T>* pEvicted)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto it = FindId(id);
+        if (m_entries.end() == it)
+        {
+            return false;
+        }
+
+        m_cost += cost - it->cost;
+        it->cost = cost;
+        Trim(pEvicted);
+
+        return true;
+    }
+
+    bool Remove(uint64_t id, T* pValue)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto it = FindId(id);
+        if (m_entries.end() == it)
+        {
+            return false;
+        }
+
+        *pValue = std::move(it->value);
+        m_cost -= it->cost;
+        m_entries.erase(it);
+
+        return true;
+    }
+
+    void Clear(std::vector<T>* pRemoved)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        for (auto& entry : m_entries)
+        {
+            pRemoved->push_back(std::move(entry.value));
+        }
+
+        m_entries.clear();
+        m_cost = 0;
+    }
+
+    void GetStats(STATS* pStats) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        pStats->entries = static_cast<uint32_t>(m_entries.size());
+        pStats->cost = m_cost;
+        pStats->hits = m_hits;
+        pStats->misses = m_misses;
+        pStats->evictions = m_evictions;
+    }
+
+private:
+    struct Entry
+    {
+        Key key;
+        T value;
+        int64_t cost;
+        uint64_t id;
+    };
+
+    typedef typename std::list<Entry>::iterator Iterator;
+    typedef typename std::list<Entry>::const_iterator ConstIterator;
+
+    // a handful of entries, a linear search beats keeping an index in sync
+    Iterator FindKey(const Key& key)
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if (it->key == key)
+            {
+                return it;
+            }
+        }
+
+        return m_entries.end();
+    }
+
+    Iterator FindId(uint64_t id)
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if (it->id == id)
+            {
+                return it;
+            }
+        }
+
+        return m_entries.end();
+    }
+
+    ConstIterator FindId(uint64_t id) const
+    {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if (it->id == id)
+            {
+                return it;
+            }
+        }
+
+        return m_entries.end();
+    }
+
+    // lock held, oldest first
+    void Trim(std::vector<T>* pEvicted)
+    {
+        while (!m_entries.empty() && (m_cost > m_capacity || m_entries.size() > m_maxEntries))
+        {
+            Entry& oldest = m_entries.back();
+
+            pEvicted->push_back(std::move(oldest.value));
+            m_cost -= oldest.cost;
+            ++m_evictions;
+
+            m_entries.pop_back();
+        }
+    }
+
+private:
+    mutable std::mutex m_lock;
+    std::list<Entry> m_entries;     // most recently used first
+
+    int64_t m_capacity;
+    uint32_t m_maxEntries;
+    int64_t m_cost;
+    uint64_t m_nextId;
+
+    uint64_t m_hits;
+    uint64_t m_misses;
+    uint64_t m_evictions;
+};
@@ -0,0 +1,484 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "MappedByteStream.h"
+
+#include <shlwapi.h>
+
+using namespace Microsoft::WRL;
+
+// bytes a read read, carried to EndRead as the object of its async result
+DECLARE_INTERFACE_IID_(IMappedReadResult, IUnknown, "6a2e9003-9c82-4ca5-a53d-09a62c8da282")
+{
+    STDMETHOD_(ULONG, GetBytesRead)() PURE;
+};
+
+class CMappedReadResult
+    : public RuntimeClass
+    < RuntimeClassFlags<ClassicCom>
+    , IMappedReadResult>
+{
+public:
+    CMappedReadResult(ULONG cbRead)
+        : m_cbRead(cbRead)
+    {
+    }
+
+    // IMappedReadResult
+    IFACEMETHODIMP_(ULONG) GetBytesRead()
+    {
+        return m_cbRead;
+    }
+
+private:
+    ULONG m_cbRead;
+};
+
+// no c++ objects to unwind here, a page of the view that can't be read in
+// (a network share gone away, a bad sector) raises an exception instead of
+// returning an error
+static HRESULT CopyFromView(
+    _Out_writes_bytes_(size) BYTE* pDestination,
+    _In_reads_bytes_(size) const BYTE* pSource,
+    _In_ size_t size)
+{
+    __try
+    {
+        memcpy(pDestination, pSource, size);
+    }
+    __except (EXCEPTION_IN_PAGE_ERROR == GetExceptionCode() ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT InvokeReadCallback(
+    HRESULT hrRead,
+    ULONG cbRead,
+    IMFAsyncCallback* pCallback,
+    IUnknown* punkState)
+{
+    NULL_CHK(pCallback);
+
+    ComPtr<IMappedReadResult> spReadResult = Make<CMappedReadResult>(cbRead);
+    NULL_CHK_HR(spReadResult, E_OUTOFMEMORY);
+
+    ComPtr<IMFAsyncResult> spResult;
+    IFR(MFCreateAsyncResult(spReadResult.Get(), pCallback, punkState, &spResult));
+    IFR(spResult->SetStatus(hrRead));
+
+    return MFInvokeCallback(spResult.Get());
+}
+
+_Use_decl_annotations_
+HRESULT GetReadCallbackResult(
+    IMFAsyncResult* pResult,
+    ULONG* pcbRead)
+{
+    NULL_CHK(pResult);
+    NULL_CHK(pcbRead);
+
+    *pcbRead = 0;
+
+    IFR(pResult->GetStatus());
+
+    ComPtr<IUnknown> spObject;
+    IFR(pResult->GetObject(&spObject));
+
+    ComPtr<IMappedReadResult> spReadResult;
+    IFR(spObject.As(&spReadResult));
+
+    *pcbRead = spReadResult->GetBytesRead();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+LPCWSTR GetMappedContentType(
+    LPCWSTR pszPath)
+{
+    static const struct
+    {
+        LPCWSTR pszExtension;
+        LPCWSTR pszContentType;
+    } c_contentTypes[] =
+    {
+        { L".mp4", L"video/mp4" },
+        { L".m4v", L"video/mp4" },
+        { L".mov", L"video/quicktime" },
+        { L".mkv", L"video/x-matroska" },
+        { L".webm", L"video/webm" },
+        { L".wmv", L"video/x-ms-wmv" },
+        { L".avi", L"video/avi" },
+        { L".ts", L"video/mp2t" },
+        { L".m2ts", L"video/mp2t" },
+        { L".3gp", L"video/3gpp" },
+    };
+
+    LPCWSTR pszExtension = PathFindExtensionW(pszPath);
+    for (const auto& entry : c_contentTypes)
+    {
+        if (0 == _wcsicmp(pszExtension, entry.pszExtension))
+        {
+            return entry.pszContentType;
+        }
+    }
+
+    return nullptr;
+}
+
+_Use_decl_annotations_
+HRESULT CreateMappedByteStream(
+    LPCWSTR pszPath,
+    MappedReadPolicy policy,
+    IMFByteStream** ppByteStream)
+{
+    NULL_CHK(pszPath);
+    NULL_CHK(ppByteStream);
+
+    *ppByteStream = nullptr;
+
+    ComPtr<CMappedByteStream> spByteStream;
+    IFR(MakeAndInitialize<CMappedByteStream>(&spByteStream, pszPath, policy));
+
+    *ppByteStream = spByteStream.Detach();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CreateMappedByteStream(
+    const std::shared_ptr<void>& spViewOwner,
+    const BYTE* pData,
+    UINT64 size,
+    MappedReadPolicy policy,
+    IMFByteStream** ppByteStream)
+{
+    NULL_CHK(ppByteStream);
+
+    *ppByteStream = nullptr;
+
+    ComPtr<CMappedByteStream> spByteStream;
+    IFR(MakeAndInitialize<CMappedByteStream>(&spByteStream, spViewOwner, pData, size, policy));
+
+    *ppByteStream = spByteStream.Detach();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+CMappedByteStream::CMappedByteStream()
+    : m_pView(nullptr)
+    , m_closed(false)
+{
+}
+
+_Use_decl_annotations_
+CMappedByteStream::~CMappedByteStream()
+{
+    if (nullptr != m_pView && nullptr == m_spViewOwner)
+    {
+        UnmapViewOfFile(m_pView);
+        m_pView = nullptr;
+    }
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::RuntimeClassInitialize(
+    LPCWSTR pszPath,
+    MappedReadPolicy policy)
+{
+    NULL_CHK(pszPath);
+
+    Wrappers::FileHandle file(CreateFileW(
+        pszPath,
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr));
+    if (!file.IsValid())
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file.Get(), &size))
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    // an empty file can't be mapped
+    if (0 == size.QuadPart)
+        IFR(MF_E_INVALID_FILE_FORMAT);
+
+    if (sizeof(void*) < 8 && size.QuadPart > MAPPED_BYTE_STREAM_MAX_VIEW_32BIT)
+        IFR(HRESULT_FROM_WIN32(ERROR_NOT_ENOUGH_MEMORY));
+
+    // the view keeps the file open, neither handle is needed once it is mapped
+    Wrappers::HandleT<Wrappers::HandleTraits::HANDLENullTraits> mapping(
+        CreateFileMappingW(file.Get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!mapping.IsValid())
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    m_pView = static_cast<const BYTE*>(MapViewOfFile(mapping.Get(), FILE_MAP_READ, 0, 0, 0));
+    if (nullptr == m_pView)
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    m_reader.Attach(m_pView, static_cast<uint64_t>(size.QuadPart), policy, 0);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::RuntimeClassInitialize(
+    const std::shared_ptr<void>& spViewOwner,
+    const BYTE* pData,
+    UINT64 size,
+    MappedReadPolicy policy)
+{
+    NULL_CHK(spViewOwner);
+    NULL_CHK(pData);
+
+    m_spViewOwner = spViewOwner;
+    m_pView = pData;
+
+    m_reader.Attach(m_pView, size, policy, 0);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::GetCapabilities(
+    DWORD* pdwCapabilities)
+{
+    NULL_CHK(pdwCapabilities);
+
+    *pdwCapabilities = MFBYTESTREAM_IS_READABLE | MFBYTESTREAM_IS_SEEKABLE | MFBYTESTREAM_DOES_NOT_USE_NETWORK;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::GetLength(
+    QWORD* pqwLength)
+{
+    NULL_CHK(pqwLength);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    *pqwLength = m_reader.GetSize();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::SetLength(
+    QWORD /*qwLength*/)
+{
+    return E_ACCESSDENIED;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::GetCurrentPosition(
+    QWORD* pqwPosition)
+{
+    NULL_CHK(pqwPosition);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    *pqwPosition = m_reader.GetPosition();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::SetCurrentPosition(
+    QWORD qwPosition)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (m_closed)
+        IFR(MF_E_SHUTDOWN);
+
+    if (!m_reader.SetPosition(qwPosition))
+        IFR(E_INVALIDARG);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::IsEndOfStream(
+    BOOL* pfEndOfStream)
+{
+    NULL_CHK(pfEndOfStream);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    *pfEndOfStream = m_reader.IsEnd() ? TRUE : FALSE;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::Read(
+    BYTE* pb,
+    ULONG cb,
+    ULONG* pcbRead)
+{
+    NULL_CHK(pb);
+    NULL_CHK(pcbRead);
+
+    *pcbRead = 0;
+
+    const BYTE* pData = nullptr;
+    size_t read = 0;
+    CMappedReader::RANGE hint;
+    bool hasHint = false;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (m_closed)
+            IFR(MF_E_SHUTDOWN);
+
+        pData = m_reader.Read(cb, &read);
+        hasHint = m_reader.TakeHint(&hint);
+    }
+
+    // the view doesn't change, only the position needs the lock. The pages
+    // are asked for first, a random read hints the ones it is about to copy.
+    if (hasHint)
+    {
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = const_cast<BYTE*>(m_pView + hint.offset);
+        range.NumberOfBytes = static_cast<SIZE_T>(hint.size);
+        if (!PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0))
+        {
+            LOG_RESULT(HRESULT_FROM_WIN32(GetLastError()));
+        }
+    }
+
+    if (0 != read)
+    {
+        IFR(CopyFromView(pb, pData, read));
+    }
+
+    *pcbRead = static_cast<ULONG>(read);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::BeginRead(
+    BYTE* pb,
+    ULONG cb,
+    IMFAsyncCallback* pCallback,
+    IUnknown* punkState)
+{
+    NULL_CHK(pb);
+    NULL_CHK(pCallback);
+
+    // the pages are read in by the copy itself, there is nothing to wait on
+    // that a work queue would hide
+    ULONG cbRead = 0;
+    HRESULT hrRead = Read(pb, cb, &cbRead);
+
+    return InvokeReadCallback(hrRead, cbRead, pCallback, punkState);
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::EndRead(
+    IMFAsyncResult* pResult,
+    ULONG* pcbRead)
+{
+    return GetReadCallbackResult(pResult, pcbRead);
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::Write(
+    const BYTE* /*pb*/,
+    ULONG /*cb*/,
+    ULONG* /*pcbWritten*/)
+{
+    return E_ACCESSDENIED;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::BeginWrite(
+    const BYTE* /*pb*/,
+    ULONG /*cb*/,
+    IMFAsyncCallback* /*pCallback*/,
+    IUnknown* /*punkState*/)
+{
+    return E_ACCESSDENIED;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::EndWrite(
+    IMFAsyncResult* /*pResult*/,
+    ULONG* /*pcbWritten*/)
+{
+    return E_ACCESSDENIED;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::Seek(
+    MFBYTESTREAM_SEEK_ORIGIN seekOrigin,
+    LONGLONG llSeekOffset,
+    DWORD /*dwSeekFlags*/,
+    QWORD* pqwCurrentPosition)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (m_closed)
+        IFR(MF_E_SHUTDOWN);
+
+    LONGLONG position = llSeekOffset;
+    if (msoCurrent == seekOrigin)
+    {
+        position += static_cast<LONGLONG>(m_reader.GetPosition());
+    }
+
+    if (position < 0 || !m_reader.SetPosition(static_cast<uint64_t>(position)))
+        IFR(E_INVALIDARG);
+
+    if (nullptr != pqwCurrentPosition)
+    {
+        *pqwCurrentPosition = m_reader.GetPosition();
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::Flush()
+{
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMappedByteStream::Close()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    m_closed = true;
+
+    return S_OK;
+}
@@ -0,0 +1,131 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "MappedReader.h"
+
+// A read only media foundation byte stream over a local file mapped into
+// memory as a whole, see CMappedReader. Reads are copied once, from the view
+// into the caller's buffer, with no file handle or buffering of its own in
+// between; the hints are passed to PrefetchVirtualMemory so the pages are
+// read in ahead of the copies.
+
+// 32 bit processes can't find the address space for larger views, those
+// files are opened the usual way
+#define MAPPED_BYTE_STREAM_MAX_VIEW_32BIT (512 * 1024 * 1024)
+
+// the container media foundation should expect for a file's extension, null
+// for extensions that aren't read through a mapped view
+LPCWSTR GetMappedContentType(
+    _In_ LPCWSTR pszPath);
+
+// completes a BeginRead of a byte stream with the result of its read, for
+// its EndRead to take with GetReadCallbackResult
+HRESULT InvokeReadCallback(
+    _In_ HRESULT hrRead,
+    _In_ ULONG cbRead,
+    _In_ IMFAsyncCallback* pCallback,
+    _In_opt_ IUnknown* punkState);
+
+HRESULT GetReadCallbackResult(
+    _In_ IMFAsyncResult* pResult,
+    _Out_ ULONG* pcbRead);
+
+HRESULT CreateMappedByteStream(
+    _In_ LPCWSTR pszPath,
+    _In_ MappedReadPolicy policy,
+    _COM_Outptr_ IMFByteStream** ppByteStream);
+
+// a range of a view mapped by someone else, eg. a clip in a bundle. The
+// stream holds on to spViewOwner, which keeps the view mapped.
+HRESULT CreateMappedByteStream(
+    _In_ const std::shared_ptr<void>& spViewOwner,
+    _In_reads_bytes_(size) const BYTE* pData,
+    _In_ UINT64 size,
+    _In_ MappedReadPolicy policy,
+    _COM_Outptr_ IMFByteStream** ppByteStream);
+
+class CMappedByteStream
+    : public Microsoft::WRL::RuntimeClass
+    < Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>
+    , IMFByteStream
+    , Microsoft::WRL::FtmBase>
+{
+public:
+    CMappedByteStream();
+    ~CMappedByteStream();
+
+    HRESULT RuntimeClassInitialize(
+        _In_ LPCWSTR pszPath,
+        _In_ MappedReadPolicy policy);
+
+    HRESULT RuntimeClassInitialize(
+        _In_ const std::shared_ptr<void>& spViewOwner,
+        _In_reads_bytes_(size) const BYTE* pData,
+        _In_ UINT64 size,
+        _In_ MappedReadPolicy policy);
+
+    // IMFByteStream
+    IFACEMETHOD(GetCapabilities)(
+        _Out_ DWORD* pdwCapabilities);
+    IFACEMETHOD(GetLength)(
+        _Out_ QWORD* pqwLength);
+    IFACEMETHOD(SetLength)(
+        _In_ QWORD qwLength);
+    IFACEMETHOD(GetCurrentPosition)(
+        _Out_ QWORD* pqwPosition);
+    IFACEMETHOD(SetCurrentPosition)(
+        _In_ QWORD qwPosition);
+    IFACEMETHOD(IsEndOfStream)(
+        _Out_ BOOL* pfEndOfStream);
+    IFACEMETHOD(Read)(
+        _Out_writes_bytes_to_(cb, *pcbRead) BYTE* pb,
+        _In_ ULONG cb,
+        _Out_ ULONG* pcbRead);
+    IFACEMETHOD(BeginRead)(
+        _Out_writes_bytes_(cb) BYTE* pb,
+        _In_ ULONG cb,
+        _In_ IMFAsyncCallback* pCallback,
+        _In_opt_ IUnknown* punkState);
+    IFACEMETHOD(EndRead)(
+        _In_ IMFAsyncResult* pResult,
+        _Out_ ULONG* pcbRead);
+    IFACEMETHOD(Write)(
+        _In_reads_bytes_(cb) const BYTE* pb,
+        _In_ ULONG cb,
+        _Out_ ULONG* pcbWritten);
+    IFACEMETHOD(BeginWrite)(
+        _In_reads_bytes_(cb) const BYTE* pb,
+        _In_ ULONG cb,
+        _In_ IMFAsyncCallback* pCallback,
+        _In_opt_ IUnknown* punkState);
+    IFACEMETHOD(EndWrite)(
+        _In_ IMFAsyncResult* pResult,
+        _Out_ ULONG* pcbWritten);
+    IFACEMETHOD(Seek)(
+        _In_ MFBYTESTREAM_SEEK_ORIGIN seekOrigin,
+        _In_ LONGLONG llSeekOffset,
+        _In_ DWORD dwSeekFlags,
+        _Out_opt_ QWORD* pqwCurrentPosition);
+    IFACEMETHOD(Flush)();
+    IFACEMETHOD(Close)();
+
+private:
+    // the view is kept until release, a read can still be copying out of it when the stream is closed.
+    // With an owner it is only a range of the owner's view, the owner unmaps it.
+    const BYTE* m_pView;
+    std::shared_ptr<void> m_spViewOwner;
+
+    std::mutex m_lock;
+    CMappedReader m_reader;
+    bool m_closed;
+};
@@ -0,0 +1,252 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <cstddef>
+#include <cstdint>
+
+// Reads of a local file mapped into memory as a whole. The owner maps the
+// file and pages it in; this only serves reads straight out of the view and
+// says which range of it the OS should start paging in ahead of them, so it
+// is not locked - the owner calls it under its own lock.
+//
+// Sequential reads are playback, front to back with the odd seek. Each hint
+// covers a read ahead window past the reads and the next one is issued once
+// the reads are within half a window of its end, so paging overlaps with
+// decoding. A seek outside the window starts it again from where it lands.
+//
+// Random reads are indexing and thumbnails jumping around the file. Only the
+// pages a read touches are hinted, anything further would be wasted, but as
+// one request instead of a page fault per page.
+//
+// Sequential hints are rounded out to MAPPED_READ_HINT_ALIGNMENT, the large
+// page size, so they are paged in as long runs. Random ones only to
+// MAPPED_READ_RANDOM_ALIGNMENT, paging in 2mb for a small read costs more
+// than the faults it saves.
+
+#define MAPPED_READ_HINT_ALIGNMENT (2 * 1024 * 1024)
+#define MAPPED_READ_RANDOM_ALIGNMENT (64 * 1024)
+
+// sequential reads, a couple of seconds of 8K video
+#define MAPPED_READ_AHEAD_DEFAULT (32 * 1024 * 1024)
+
+enum class MappedReadPolicy : uint32_t
+{
+    MappedReadPolicy_Sequential = 0,
+    MappedReadPolicy_Random,
+};
+
+class CMappedReader
+{
+public:
+    typedef struct _RANGE
+    {
+        uint64_t offset;
+        uint64_t size;
+    } RANGE;
+
+    typedef struct _STATS
+    {
+        uint64_t reads;
+        uint64_t bytesRead;
+        uint64_t seeks;         // positions set anywhere but where the last read ended
+        uint64_t hints;
+        uint64_t hintBytes;
+    } STATS;
+
+    CMappedReader()
+        : m_pView(nullptr)
+        , m_size(0)
+        , m_policy(MappedReadPolicy::MappedReadPolicy_Sequential)
+        , m_readAhead(MAPPED_READ_AHEAD_DEFAULT)
+        , m_position(0)
+        , m_hintStart(0)
+        , m_hintEnd(0)
+        , m_hint()
+        , m_hasHint(false)
+        , m_stats()
+    {
+    }
+
+    // readAhead only applies to sequential reads, 0 for the default
+    void Attach(const uint8_t* pView, uint64_t size, MappedReadPolicy policy, uint64_t readAhead)
+    {
+        m_pView = pView;
+        m_size = (nullptr != pView) ? size : 0;
+        m_policy = policy;
+        m_readAhead = AlignUp((0 != readAhead) ? readAhead : MAPPED_READ_AHEAD_DEFAULT);
+        m_position = 0;
+        m_hintStart = 0;
+        m_hintEnd = 0;
+        m_hasHint = false;
+    }
+
+    uint64_t GetSize() const
+    {
+        return m_size;
+    }
+
+    uint64_t GetPosition() const
+    {
+        return m_position;
+    }
+
+    bool IsEnd() const
+    {
+        return m_position >= m_size;
+    }
+
+    // false past the end of the view
+    bool SetPosition(uint64_t position)
+    {
+        if (position > m_size)
+        {
+            return false;
+        }
+
+        if (position != m_position)
+        {
+            ++m_stats.seeks;
+
+            // the window stays if the reads land in it, a new one starts at the next read if not
+            if (MappedReadPolicy::MappedReadPolicy_Sequential == m_policy
+                && (position < m_hintStart || position >= m_hintEnd))
+            {
+                m_hintStart = AlignDown(position);
+                m_hintEnd = m_hintStart;
+            }
+        }
+
+        m_position = position;
+
+        return true;
+    }
+
+    // up to size bytes at the position, read in place - the pointer is into
+    // the view, nothing is copied. Moves the position past them. *pRead is 0
+    // at the end.
+    const uint8_t* Read(size_t size, size_t* pRead)
+    {
+        const uint64_t available = m_size - m_position;
+        const size_t read = (size < available) ? size : static_cast<size_t>(available);
+
+        *pRead = read;
+        if (0 == read)
+        {
+            return nullptr;
+        }
+
+        const uint8_t* pData = m_pView + m_position;
+        UpdateHint(m_position, m_position + read);
+
+        m_position += read;
+        ++m_stats.reads;
+        m_stats.bytesRead += read;
+
+        return pData;
+    }
+
+    // the range the last read wants paged in, once
+    bool TakeHint(RANGE* pHint)
+    {
+        if (!m_hasHint)
+        {
+            return false;
+        }
+
+        *pHint = m_hint;
+        m_hasHint = false;
+
+        return true;
+    }
+
+    void GetStats(STATS* pStats) const
+    {
+        *pStats = m_stats;
+    }
+
+private:
+    void UpdateHint(uint64_t start, uint64_t end)
+    {
+        uint64_t hintStart = 0;
+        uint64_t hintEnd = 0;
+        if (MappedReadPolicy::MappedReadPolicy_Random == m_policy)
+        {
+            // the pages this read touches, if the last hint didn't cover them
+            if (start >= m_hintStart && end <= m_hintEnd)
+            {
+                return;
+            }
+
+            hintStart = start - (start % MAPPED_READ_RANDOM_ALIGNMENT);
+            hintEnd = end + MAPPED_READ_RANDOM_ALIGNMENT - 1;
+            hintEnd -= hintEnd % MAPPED_READ_RANDOM_ALIGNMENT;
+            m_hintStart = hintStart;
+        }
+        else if (end > m_hintEnd)
+        {
+            // reads outran the window, or the first read after a seek
+            hintStart = AlignDown(start);
+            hintEnd = AlignUp(end + m_readAhead);
+            m_hintStart = hintStart;
+        }
+        else if (m_hintEnd - end < m_readAhead / 2)
+        {
+            // half a window left, extend it
+            hintStart = m_hintEnd;
+            hintEnd = AlignUp(end + m_readAhead);
+        }
+        else
+        {
+            return;
+        }
+
+        hintEnd = (hintEnd < m_size) ? hintEnd : m_size;
+        m_hintEnd = hintEnd;
+        if (hintEnd <= hintStart)
+        {
+            return;
+        }
+
+        m_hint.offset = hintStart;
+        m_hint.size = hintEnd - hintStart;
+        m_hasHint = true;
+
+        ++m_stats.hints;
+        m_stats.hintBytes += m_hint.size;
+    }
+
+    static uint64_t AlignDown(uint64_t value)
+    {
+        return value - (value % MAPPED_READ_HINT_ALIGNMENT);
+    }
+
+    static uint64_t AlignUp(uint64_t value)
+    {
+        return AlignDown(value + MAPPED_READ_HINT_ALIGNMENT - 1);
+    }
+
+    const uint8_t* m_pView;
+    uint64_t m_size;
+    MappedReadPolicy m_policy;
+    uint64_t m_readAhead;
+    uint64_t m_position;
+
+    // the range hinted so far, reads in it need no new hint
+    uint64_t m_hintStart;
+    uint64_t m_hintEnd;
+    RANGE m_hint;
+    bool m_hasHint;
+
+    STATS m_stats;
+};
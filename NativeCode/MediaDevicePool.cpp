@@ -0,0 +1,233 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "MediaDevicePool.h"
+#include "MediaHelpers.h"
+
+#include <chrono>
+
+using namespace Microsoft::WRL;
+
+// keyed by adapter luid, devices are created under the lock so players racing
+// to create the first one on an adapter end up sharing it
+static std::mutex s_deviceLock;
+static std::map<UINT64, std::shared_ptr<CMediaDevice>> s_devices;
+static ComPtr<ID3D11Device> s_warpDevice;
+static UINT64 s_deviceCreations = 0;
+static UINT64 s_deviceReuses = 0;
+static INT64 s_deviceCreateTime = 0;
+static INT64 s_deviceCreateTimeMax = 0;
+
+static INT64 Now()
+{
+    return std::chrono::duration_cast<std::chrono::duration<INT64, std::ratio<1, 10000000>>>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static UINT64 GetAdapterKey(
+    _In_ const LUID& luid)
+{
+    return (static_cast<UINT64>(static_cast<UINT32>(luid.HighPart)) << 32) | luid.LowPart;
+}
+
+_Use_decl_annotations_
+CMediaDevice::CMediaDevice()
+    : m_device(nullptr)
+    , m_deviceManager(nullptr)
+{
+}
+
+_Use_decl_annotations_
+CMediaDevice::~CMediaDevice()
+{
+    if (nullptr != m_deviceManager)
+    {
+        m_deviceManager.Reset();
+
+        MFUnlockDXGIDeviceManager();
+    }
+
+    m_device.Reset();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaDevice::Initialize(
+    IDXGIAdapter* pAdapter)
+{
+    NULL_CHK(pAdapter);
+
+    ComPtr<ID3D11Device> spDevice;
+    IFR(CreateMediaDevice(pAdapter, &spDevice));
+
+    // lock the shared dxgi device manager, MFUnlockDXGIDeviceManager in the destructor.
+    // There is one per process, with devices on two adapters the last one created wins
+    UINT uiResetToken;
+    ComPtr<IMFDXGIDeviceManager> spDeviceManager;
+    IFR(MFLockDXGIDeviceManager(&uiResetToken, &spDeviceManager));
+
+    // associate the device with the manager
+    HRESULT hr = spDeviceManager->ResetDevice(spDevice.Get(), uiResetToken);
+    if (FAILED(hr))
+    {
+        spDeviceManager.Reset();
+        MFUnlockDXGIDeviceManager();
+
+        IFR(hr);
+    }
+
+    m_device = spDevice;
+    m_deviceManager = spDeviceManager;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+bool CMediaDevice::IsRemoved() const
+{
+    return nullptr == m_device || S_OK != m_device->GetDeviceRemovedReason();
+}
+
+_Use_decl_annotations_
+HRESULT AcquireMediaDevice(
+    IDXGIAdapter* pAdapter,
+    std::shared_ptr<CMediaDevice>* pDevice)
+{
+    NULL_CHK(pAdapter);
+    NULL_CHK(pDevice);
+
+    pDevice->reset();
+
+    DXGI_ADAPTER_DESC desc;
+    IFR(pAdapter->GetDesc(&desc));
+
+    UINT64 key = GetAdapterKey(desc.AdapterLuid);
+
+    // released outside the lock, players still on it keep it until they are released
+    std::shared_ptr<CMediaDevice> spRemoved;
+
+    std::lock_guard<std::mutex> lock(s_deviceLock);
+
+    auto it = s_devices.find(key);
+    if (it != s_devices.end())
+    {
+        if (!it->second->IsRemoved())
+        {
+            s_deviceReuses++;
+
+            *pDevice = it->second;
+
+            return S_OK;
+        }
+
+        Log(Log_Level_Warning, L"media device removed, creating another");
+
+        spRemoved = it->second;
+        s_devices.erase(it);
+    }
+
+    INT64 start = Now();
+
+    auto spDevice = std::make_shared<CMediaDevice>();
+    IFR(spDevice->Initialize(pAdapter));
+
+    INT64 createTime = Now() - start;
+    s_deviceCreations++;
+    s_deviceCreateTime += createTime;
+    s_deviceCreateTimeMax = (createTime > s_deviceCreateTimeMax) ? createTime : s_deviceCreateTimeMax;
+
+    s_devices[key] = spDevice;
+    *pDevice = spDevice;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT AcquireWarpDevice(
+    ID3D11Device** ppDevice)
+{
+    NULL_CHK(ppDevice);
+
+    *ppDevice = nullptr;
+
+    std::lock_guard<std::mutex> lock(s_deviceLock);
+
+    if (nullptr == s_warpDevice || S_OK != s_warpDevice->GetDeviceRemovedReason())
+    {
+        ComPtr<ID3D11Device> spDevice;
+        IFR(CreateWarpDevice(&spDevice));
+
+        s_warpDevice = spDevice;
+    }
+
+    return s_warpDevice.CopyTo(ppDevice);
+}
+
+UINT32 TrimMediaDevices()
+{
+    std::vector<std::shared_ptr<CMediaDevice>> idle;
+    ComPtr<ID3D11Device> spWarpDevice;
+
+    {
+        std::lock_guard<std::mutex> lock(s_deviceLock);
+
+        spWarpDevice.Swap(s_warpDevice);
+
+        for (auto it = s_devices.begin(); it != s_devices.end();)
+        {
+            // only the pool's reference left
+            if (1 == it->second.use_count())
+            {
+                idle.push_back(it->second);
+                it = s_devices.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    return static_cast<UINT32>(idle.size());
+}
+
+_Use_decl_annotations_
+void GetMediaDeviceStats(
+    PLAYBACK_DEVICE_STATS* pStats)
+{
+    ZeroMemory(pStats, sizeof(*pStats));
+
+    std::lock_guard<std::mutex> lock(s_deviceLock);
+
+    pStats->devices = static_cast<UINT32>(s_devices.size());
+    pStats->creations = s_deviceCreations;
+    pStats->reuses = s_deviceReuses;
+    pStats->createTimeAvg = (s_deviceCreations > 0) ? s_deviceCreateTime / static_cast<INT64>(s_deviceCreations) : 0;
+    pStats->createTimeMax = s_deviceCreateTimeMax;
+
+    for (auto& entry : s_devices)
+    {
+        pStats->references += static_cast<UINT32>(entry.second.use_count() - 1);
+
+        // the process's usage of the adapter, unity's device and textures included
+        ComPtr<IDXGIDevice> spDXGIDevice;
+        ComPtr<IDXGIAdapter> spAdapter;
+        ComPtr<IDXGIAdapter3> spAdapter3;
+        DXGI_QUERY_VIDEO_MEMORY_INFO info;
+        if (SUCCEEDED(entry.second->GetDevice()->QueryInterface(IID_PPV_ARGS(&spDXGIDevice)))
+            && SUCCEEDED(spDXGIDevice->GetAdapter(&spAdapter))
+            && SUCCEEDED(spAdapter.As(&spAdapter3))
+            && SUCCEEDED(spAdapter3->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info)))
+        {
+            pStats->videoMemoryUsage += info.CurrentUsage;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// Media devices shared by every player on the same adapter. Creating a d3d
+// device with video support takes tens of milliseconds and megabytes of video
+// memory, so a player only takes a reference on its adapter's device, and the
+// device stays pooled when the last player lets go, for the next one. Idle
+// devices are released by TrimMediaDevices, and a removed device is replaced
+// on the next acquire.
+
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_DEVICE_STATS
+{
+    UINT32 devices;             // pooled media devices, one per adapter
+    UINT32 references;          // players holding one
+    UINT64 creations;           // acquires that created a device
+    UINT64 reuses;              // acquires that found one pooled
+    INT64 createTimeAvg;        // 100ns, of the creations
+    INT64 createTimeMax;
+    UINT64 videoMemoryUsage;    // bytes of local video memory the process uses on the pooled adapters
+} PLAYBACK_DEVICE_STATS;
+#pragma pack(pop)
+
+class CMediaDevice
+{
+public:
+    CMediaDevice();
+    ~CMediaDevice();
+
+    // creates the device and makes it the one the shared dxgi device manager hands
+    // to media foundation, locking the manager for the life of the device
+    HRESULT Initialize(
+        _In_ IDXGIAdapter* pAdapter);
+
+    ID3D11Device* GetDevice() const
+    {
+        return m_device.Get();
+    }
+
+    bool IsRemoved() const;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D11Device> m_device;
+    Microsoft::WRL::ComPtr<IMFDXGIDeviceManager> m_deviceManager;
+};
+
+// the pooled device of the adapter, creating it on first use
+HRESULT AcquireMediaDevice(
+    _In_ IDXGIAdapter* pAdapter,
+    _Out_ std::shared_ptr<CMediaDevice>* pDevice);
+
+// the WARP device PlaybackBackend_WarpDevice players use in place of unity's, one for all of them
+// so their output textures can be pooled too, see CTexturePool
+HRESULT AcquireWarpDevice(
+    _COM_Outptr_ ID3D11Device** ppDevice);
+
+// releases the devices no player holds, returns how many. The WARP
+// device is dropped too, players using it keep their reference
+UINT32 TrimMediaDevices();
+
+void GetMediaDeviceStats(
+    _Out_ PLAYBACK_DEVICE_STATS* pStats);
@@ -13,6 +13,13 @@
 
 #include "pch.h"
 #include "MediaHelpers.h"
+#include "MappedByteStream.h"
+#include "ReadAheadByteStream.h"
+#include "VideoBundle.h"
+
+#include <shlwapi.h>
+#include <string>
+#pragma comment(lib, "shlwapi")
 
 using namespace ABI::Windows::Graphics::DirectX::Direct3D11;
 using namespace ABI::Windows::Media::Core;
@@ -42,6 +49,30 @@ inline bool SdkLayersAvailable()
 }
 #endif
 
+// local files read through a byte stream of our own, see CMappedByteStream and CReadAheadByteStream
+static HRESULT CreateMediaSourceFromByteStream(
+    _In_ IMFByteStream* pByteStream,
+    _In_ LPCWSTR pszContentType,
+    _COM_Outptr_ IMediaSource2** ppMediaSource)
+{
+    *ppMediaSource = nullptr;
+
+    ComPtr<ABI::Windows::Storage::Streams::IRandomAccessStream> spStream;
+    IFR(MFCreateStreamOnMFByteStreamEx(pByteStream, IID_PPV_ARGS(&spStream)));
+
+    ComPtr<IMediaSourceStatics> spMediaSourceStatics;
+    IFR(ABI::Windows::Foundation::GetActivationFactory(
+        Wrappers::HStringReference(RuntimeClass_Windows_Media_Core_MediaSource).Get(),
+        &spMediaSourceStatics));
+
+    IFR(spMediaSourceStatics->CreateFromStream(
+        spStream.Get(),
+        Wrappers::HStringReference(pszContentType).Get(),
+        ppMediaSource));
+
+    return S_OK;
+}
+
 _Use_decl_annotations_
 HRESULT CreateMediaSource(
     LPCWSTR pszUrl,
@@ -52,6 +83,30 @@ HRESULT CreateMediaSource(
 
     *ppMediaSource = nullptr;
 
+    // local files skip the uri file stack. Anything the mapped view can't
+    // open, eg. a file too large to map in a 32 bit process, still can be.
+    std::wstring path;
+    if (GetLocalPath(pszUrl, &path))
+    {
+        LPCWSTR pszContentType = GetMappedContentType(path.c_str());
+        if (nullptr != pszContentType)
+        {
+            ComPtr<IMFByteStream> spByteStream;
+            HRESULT hr = CreateMappedByteStream(path.c_str(), MappedReadPolicy::MappedReadPolicy_Sequential, &spByteStream);
+            if (SUCCEEDED(hr))
+            {
+                hr = CreateMediaSourceFromByteStream(spByteStream.Get(), pszContentType, ppMediaSource);
+            }
+
+            if (SUCCEEDED(hr))
+            {
+                return S_OK;
+            }
+
+            LOG_RESULT(hr);
+        }
+    }
+
     // convert the uri
     Microsoft::WRL::ComPtr<ABI::Windows::Foundation::IUriRuntimeClassFactory> spUriFactory;
     IFR(ABI::Windows::Foundation::GetActivationFactory(
@@ -79,6 +134,106 @@ HRESULT CreateMediaSource(
     return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT CreateReadAheadMediaSource(
+    LPCWSTR pszUrl,
+    UINT64 window,
+    const std::shared_ptr<CReadAheadCounters>& spCounters,
+    IMediaSource2** ppMediaSource,
+    std::shared_ptr<CReadAheadBuffer>* pBuffer)
+{
+    NULL_CHK(pszUrl);
+    NULL_CHK(ppMediaSource);
+    NULL_CHK(pBuffer);
+
+    *ppMediaSource = nullptr;
+    pBuffer->reset();
+
+    std::wstring path;
+    LPCWSTR pszContentType = nullptr;
+    if (GetLocalPath(pszUrl, &path))
+    {
+        pszContentType = GetMappedContentType(path.c_str());
+    }
+
+    if (nullptr == pszContentType)
+    {
+        IFR(CreateMediaSource(pszUrl, ppMediaSource));
+
+        return S_FALSE;
+    }
+
+    // a file that can't be read ahead still opens the way CreateMediaSource opens it
+    ComPtr<IMFByteStream> spByteStream;
+    std::shared_ptr<CReadAheadBuffer> spBuffer;
+    HRESULT hr = CreateReadAheadByteStream(path.c_str(), window, spCounters, &spByteStream, &spBuffer);
+    if (SUCCEEDED(hr))
+    {
+        hr = CreateMediaSourceFromByteStream(spByteStream.Get(), pszContentType, ppMediaSource);
+        if (FAILED(hr))
+        {
+            LOG_RESULT(spByteStream->Close());
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        LOG_RESULT(hr);
+
+        IFR(CreateMediaSource(pszUrl, ppMediaSource));
+
+        return S_FALSE;
+    }
+
+    *pBuffer = spBuffer;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CreateBundleMediaSource(
+    LPCWSTR pszBundlePath,
+    LPCWSTR pszName,
+    IMediaSource2** ppMediaSource,
+    std::shared_ptr<CKeyframeIndex>* pKeyframes)
+{
+    NULL_CHK(ppMediaSource);
+    NULL_CHK(pKeyframes);
+
+    *ppMediaSource = nullptr;
+    pKeyframes->reset();
+
+    std::shared_ptr<CVideoBundle> spBundle;
+    IFR(OpenVideoBundle(pszBundlePath, &spBundle));
+
+    VIDEO_BUNDLE_CLIP clip;
+    IFR(spBundle->FindClip(pszName, &clip));
+
+    // the content type stands in for the probe, nothing is sniffed
+    const std::wstring contentType(clip.contentType, clip.contentType + clip.contentTypeLength);
+    if (contentType.empty())
+        IFR(MF_E_UNSUPPORTED_BYTESTREAM_TYPE);
+
+    // the stream keeps the bundle mapped, closing it doesn't cut this clip off
+    ComPtr<IMFByteStream> spByteStream;
+    IFR(CreateMappedByteStream(spBundle, spBundle->GetView() + clip.offset, clip.size, MappedReadPolicy::MappedReadPolicy_Sequential, &spByteStream));
+
+    ComPtr<IMediaSource2> spMediaSource2;
+    IFR(CreateMediaSourceFromByteStream(spByteStream.Get(), contentType.c_str(), &spMediaSource2));
+
+    // times packed with the clip, an empty index for containers that weren't probed
+    std::vector<int64_t> times;
+    CVideoBundleIndex::GetKeyframeTimes(clip, &times);
+
+    auto spKeyframes = std::make_shared<CKeyframeIndex>();
+    spKeyframes->SetTimes(std::move(times), clip.frameDuration);
+
+    *ppMediaSource = spMediaSource2.Detach();
+    *pKeyframes = spKeyframes;
+
+    return S_OK;
+}
+
 _Use_decl_annotations_
 HRESULT CreateAdaptiveMediaSource(
     LPCWSTR pszManifestLocation,
@@ -122,6 +277,29 @@ HRESULT CreateAdaptiveMediaSource(
     return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT CreateMediaSourceFromAdaptiveSource(
+    IAdaptiveMediaSource* pAdaptiveSource,
+    IMediaSource2** ppMediaSource)
+{
+    NULL_CHK(pAdaptiveSource);
+    NULL_CHK(ppMediaSource);
+
+    *ppMediaSource = nullptr;
+
+    ComPtr<IMediaSourceStatics> spMediaSourceStatics;
+    IFR(ABI::Windows::Foundation::GetActivationFactory(
+        Wrappers::HStringReference(RuntimeClass_Windows_Media_Core_MediaSource).Get(),
+        &spMediaSourceStatics));
+
+    ComPtr<IMediaSource2> spMediaSource2;
+    IFR(spMediaSourceStatics->CreateFromAdaptiveMediaSource(pAdaptiveSource, &spMediaSource2));
+
+    *ppMediaSource = spMediaSource2.Detach();
+
+    return S_OK;
+}
+
 _Use_decl_annotations_
 HRESULT CreateMediaPlaybackItem(
     _In_ IMediaSource2* pMediaSource,
@@ -142,43 +320,216 @@ HRESULT CreateMediaPlaybackItem(
 }
 
 _Use_decl_annotations_
-HRESULT CreatePlaylistSource(
-    IMediaSource2* pSource,
-    IMediaPlaybackSource** ppMediaPlaybackSource)
+HRESULT CreatePlaylist(
+    IMediaPlaybackItem* pItem,
+    IMediaPlaybackList** ppPlaybackList)
 {
-    NULL_CHK(pSource);
-    NULL_CHK(ppMediaPlaybackSource);
+    NULL_CHK(pItem);
+    NULL_CHK(ppPlaybackList);
 
-    *ppMediaPlaybackSource = nullptr;
+    *ppPlaybackList = nullptr;
 
     ComPtr<IMediaPlaybackList> spPlaylist;
     IFR(Windows::Foundation::ActivateInstance(
         Wrappers::HStringReference(RuntimeClass_Windows_Media_Playback_MediaPlaybackList).Get(),
         &spPlaylist));
 
+    ComPtr<ABI::Windows::Foundation::Collections::IVector<MediaPlaybackItem*>> spItemsVector;
+    IFR(GetPlaylistItems(spPlaylist.Get(), &spItemsVector));
+
+    // add to the list
+    IFR(spItemsVector->Append(pItem));
+
+    *ppPlaybackList = spPlaylist.Detach();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT GetPlaylistItems(
+    IMediaPlaybackList* pPlaybackList,
+    ABI::Windows::Foundation::Collections::IVector<MediaPlaybackItem*>** ppItems)
+{
+    NULL_CHK(pPlaybackList);
+    NULL_CHK(ppItems);
+
+    *ppItems = nullptr;
+
     // get the iterator for playlist
     ComPtr<ABI::Windows::Foundation::Collections::IObservableVector<MediaPlaybackItem*>> spItems;
-    IFR(spPlaylist->get_Items(&spItems));
+    IFR(pPlaybackList->get_Items(&spItems));
 
     ComPtr<ABI::Windows::Foundation::Collections::IVector<MediaPlaybackItem*>> spItemsVector;
     IFR(spItems.As(&spItemsVector));
 
-    // create playbackitem from source
-    ComPtr<IMediaPlaybackItem> spItem;
-    IFR(CreateMediaPlaybackItem(pSource, &spItem));
+    *ppItems = spItemsVector.Detach();
 
-    // add to the list
-    IFR(spItemsVector->Append(spItem.Get()));
+    return S_OK;
+}
 
-    // convert to playbackSource
-    ComPtr<IMediaPlaybackSource> spMediaPlaybackSource;
-    IFR(spPlaylist.As(&spMediaPlaybackSource));
+_Use_decl_annotations_
+bool GetLocalPath(
+    LPCWSTR pszContentLocation,
+    std::wstring* pPath)
+{
+    if (!PathIsURLW(pszContentLocation))
+    {
+        *pPath = pszContentLocation;
+        return true;
+    }
 
-    *ppMediaPlaybackSource = spMediaPlaybackSource.Detach();
+    if (!UrlIsFileUrlW(pszContentLocation))
+    {
+        return false;
+    }
+
+    WCHAR szPath[MAX_PATH * 4];
+    DWORD length = ARRAYSIZE(szPath);
+    if (FAILED(PathCreateFromUrlW(pszContentLocation, szPath, &length, 0)))
+    {
+        return false;
+    }
+
+    *pPath = szPath;
+
+    return true;
+}
+
+_Use_decl_annotations_
+HRESULT ReadKeyframeTimes(
+    LPCWSTR pszPath,
+    std::vector<int64_t>* pTimes,
+    int64_t* pFrameDuration)
+{
+    NULL_CHK(pszPath);
+    NULL_CHK(pTimes);
+    NULL_CHK(pFrameDuration);
+
+    pTimes->clear();
+    *pFrameDuration = 0;
+
+    CFileKeyframeIndexReader reader;
+    IFR(reader.Open(pszPath));
+
+    if (!ReadMp4KeyframeTimes(&reader, pTimes, pFrameDuration))
+    {
+        pTimes->clear();
+        *pFrameDuration = 0;
+        return S_FALSE;
+    }
 
     return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT StartKeyframeIndex(
+    LPCWSTR pszContentLocation,
+    std::shared_ptr<CKeyframeIndex>* pIndex)
+{
+    NULL_CHK(pszContentLocation);
+    NULL_CHK(pIndex);
+
+    pIndex->reset();
+
+    std::wstring path;
+    if (!GetLocalPath(pszContentLocation, &path))
+    {
+        return S_FALSE;
+    }
+
+    auto spIndex = std::make_shared<CKeyframeIndex>();
+
+    ComPtr<ABI::Windows::System::Threading::IThreadPoolStatics> spThreadPool;
+    IFR(ABI::Windows::Foundation::GetActivationFactory(
+        Microsoft::WRL::Wrappers::HStringReference(RuntimeClass_Windows_System_Threading_ThreadPool).Get(),
+        &spThreadPool));
+
+    // the work item holds the index, not the player, so it may outlive either
+    auto workItem = Callback<ABI::Windows::System::Threading::IWorkItemHandler>(
+        [spIndex, path](_In_ ABI::Windows::Foundation::IAsyncAction*) -> HRESULT
+    {
+        // a file that can't be read or parsed still completes the index, empty
+        std::vector<int64_t> times;
+        int64_t frameDuration = 0;
+        ReadKeyframeTimes(path.c_str(), &times, &frameDuration);
+
+        spIndex->SetTimes(std::move(times), frameDuration);
+
+        return S_OK;
+    });
+
+    ComPtr<ABI::Windows::Foundation::IAsyncAction> spAction;
+    IFR(spThreadPool->RunAsync(workItem.Get(), &spAction));
+
+    *pIndex = spIndex;
+
+    return S_OK;
+}
+
+static HRESULT GetPropertyValueStatics(
+    _COM_Outptr_ ABI::Windows::Foundation::IPropertyValueStatics** ppStatics)
+{
+    return ABI::Windows::Foundation::GetActivationFactory(
+        Wrappers::HStringReference(RuntimeClass_Windows_Foundation_PropertyValue).Get(),
+        ppStatics);
+}
+
+_Use_decl_annotations_
+HRESULT CreateUInt32Reference(
+    UINT32 value,
+    ABI::Windows::Foundation::IReference<UINT32>** ppReference)
+{
+    NULL_CHK(ppReference);
+
+    *ppReference = nullptr;
+
+    ComPtr<ABI::Windows::Foundation::IPropertyValueStatics> spStatics;
+    IFR(GetPropertyValueStatics(&spStatics));
+
+    ComPtr<IInspectable> spValue;
+    IFR(spStatics->CreateUInt32(value, &spValue));
+
+    return spValue.CopyTo(ppReference);
+}
+
+_Use_decl_annotations_
+HRESULT CreateDoubleReference(
+    DOUBLE value,
+    ABI::Windows::Foundation::IReference<DOUBLE>** ppReference)
+{
+    NULL_CHK(ppReference);
+
+    *ppReference = nullptr;
+
+    ComPtr<ABI::Windows::Foundation::IPropertyValueStatics> spStatics;
+    IFR(GetPropertyValueStatics(&spStatics));
+
+    ComPtr<IInspectable> spValue;
+    IFR(spStatics->CreateDouble(value, &spValue));
+
+    return spValue.CopyTo(ppReference);
+}
+
+_Use_decl_annotations_
+HRESULT CreateTimeSpanReference(
+    INT64 value,
+    ABI::Windows::Foundation::IReference<ABI::Windows::Foundation::TimeSpan>** ppReference)
+{
+    NULL_CHK(ppReference);
+
+    *ppReference = nullptr;
+
+    ComPtr<ABI::Windows::Foundation::IPropertyValueStatics> spStatics;
+    IFR(GetPropertyValueStatics(&spStatics));
+
+    ABI::Windows::Foundation::TimeSpan timeSpan = { value };
+
+    ComPtr<IInspectable> spValue;
+    IFR(spStatics->CreateTimeSpan(timeSpan, &spValue));
+
+    return spValue.CopyTo(ppReference);
+}
+
 _Use_decl_annotations_
 HRESULT GetSurfaceFromTexture(
     ID3D11Texture2D* pTexture,
@@ -311,3 +662,49 @@ HRESULT CreateMediaDevice(
 
     return S_OK;
 }
+
+_Use_decl_annotations_
+HRESULT CreateWarpDevice(
+    ID3D11Device** ppDevice)
+{
+    NULL_CHK(ppDevice);
+
+    *ppDevice = nullptr;
+
+    D3D_FEATURE_LEVEL featureLevel;
+    D3D_FEATURE_LEVEL featureLevels[] =
+    {
+        D3D_FEATURE_LEVEL_11_1,
+        D3D_FEATURE_LEVEL_11_0,
+        D3D_FEATURE_LEVEL_10_1,
+        D3D_FEATURE_LEVEL_10_0,
+    };
+
+    ComPtr<ID3D11Device> spDevice;
+    ComPtr<ID3D11DeviceContext> spContext;
+
+    // the media device is created on the same (WARP) adapter, see RuntimeClassInitialize,
+    // so media foundation picks its software decoders and the output textures stay shareable
+    IFR(D3D11CreateDevice(
+        nullptr,
+        D3D_DRIVER_TYPE_WARP,
+        0,
+        D3D11_CREATE_DEVICE_VIDEO_SUPPORT | D3D11_CREATE_DEVICE_BGRA_SUPPORT,
+        featureLevels,
+        ARRAYSIZE(featureLevels),
+        D3D11_SDK_VERSION,
+        &spDevice,
+        &featureLevel,
+        &spContext));
+
+    // latched from the render thread while the media threads copy into the same textures
+    ComPtr<ID3D10Multithread> spMultithread;
+    if (SUCCEEDED(spContext.As(&spMultithread)))
+    {
+        spMultithread->SetMultithreadProtected(TRUE);
+    }
+
+    *ppDevice = spDevice.Detach();
+
+    return S_OK;
+}
@@ -19,6 +19,11 @@
 #include <windows.media.streaming.adaptive.h>
 #include <windows.graphics.directx.direct3d11.interop.h>
 
+#include "KeyframeIndex.h"
+#include "ReadAheadBuffer.h"
+
+#include <string>
+
 typedef ABI::Windows::Foundation::IAsyncOperation<ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSourceCreationResult*> ICreateAdaptiveMediaSourceOperation;
 typedef ABI::Windows::Foundation::IAsyncOperationCompletedHandler<ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSourceCreationResult*> ICreateAdaptiveMediaSourceResultHandler;
 
@@ -31,17 +36,148 @@ HRESULT CreateMediaSource(
     _In_ LPCWSTR pszUrl,
     _COM_Outptr_ ABI::Windows::Media::Core::IMediaSource2** ppMediaSource);
 
+// CreateMediaSource with local files read ahead of the demuxer, see
+// CReadAheadByteStream. S_FALSE and no buffer for anything else, which is
+// opened as CreateMediaSource would.
+HRESULT CreateReadAheadMediaSource(
+    _In_ LPCWSTR pszUrl,
+    _In_ UINT64 window,
+    _In_ const std::shared_ptr<CReadAheadCounters>& spCounters,
+    _COM_Outptr_ ABI::Windows::Media::Core::IMediaSource2** ppMediaSource,
+    _Out_ std::shared_ptr<CReadAheadBuffer>* pBuffer);
+
+// a clip of a bundle read straight out of the bundle's view, see
+// VideoBundle.h, and its keyframe times from the bundle's index, ready
+HRESULT CreateBundleMediaSource(
+    _In_ LPCWSTR pszBundlePath,
+    _In_ LPCWSTR pszName,
+    _COM_Outptr_ ABI::Windows::Media::Core::IMediaSource2** ppMediaSource,
+    _Out_ std::shared_ptr<CKeyframeIndex>* pKeyframes);
+
 HRESULT CreateAdaptiveMediaSource(
     _In_ LPCWSTR pszManifestLocation,
     _In_ IAdaptiveMediaSourceCompletedCallback* pCallback);
 
+HRESULT CreateMediaSourceFromAdaptiveSource(
+    _In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource* pAdaptiveSource,
+    _COM_Outptr_ ABI::Windows::Media::Core::IMediaSource2** ppMediaSource);
+
 HRESULT CreateMediaPlaybackItem(
     _In_ ABI::Windows::Media::Core::IMediaSource2* pMediaSource,
     _COM_Outptr_ ABI::Windows::Media::Playback::IMediaPlaybackItem** ppMediaPlaybackItem);
 
-HRESULT CreatePlaylistSource(
-    _In_ ABI::Windows::Media::Core::IMediaSource2* pSource,
-    _COM_Outptr_ ABI::Windows::Media::Playback::IMediaPlaybackSource** ppMediaPlaybackSource);
+HRESULT CreatePlaylist(
+    _In_ ABI::Windows::Media::Playback::IMediaPlaybackItem* pItem,
+    _COM_Outptr_ ABI::Windows::Media::Playback::IMediaPlaybackList** ppPlaybackList);
+
+HRESULT GetPlaylistItems(
+    _In_ ABI::Windows::Media::Playback::IMediaPlaybackList* pPlaybackList,
+    _COM_Outptr_ ABI::Windows::Foundation::Collections::IVector<ABI::Windows::Media::Playback::MediaPlaybackItem*>** ppItems);
+
+// plain paths as they are, file: urls converted, false for anything else
+bool GetLocalPath(
+    _In_ LPCWSTR pszContentLocation,
+    _Out_ std::wstring* pPath);
+
+// reads the file with positioned reads, nothing else moves its file pointer.
+// For the keyframe index, and the clips a bundle is packed from.
+class CFileKeyframeIndexReader : public IKeyframeIndexReader
+{
+public:
+    CFileKeyframeIndexReader()
+        : m_size(0)
+    {
+    }
+
+    HRESULT Open(
+        _In_ LPCWSTR pszPath)
+    {
+        m_file.Attach(CreateFileW(
+            pszPath,
+            GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_DELETE,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr));
+        if (!m_file.IsValid())
+        {
+            IFR(HRESULT_FROM_WIN32(GetLastError()));
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file.Get(), &size))
+        {
+            IFR(HRESULT_FROM_WIN32(GetLastError()));
+        }
+
+        m_size = static_cast<uint64_t>(size.QuadPart);
+
+        return S_OK;
+    }
+
+    // IKeyframeIndexReader
+    bool Read(uint64_t offset, void* buffer, size_t size) override
+    {
+        BYTE* pBuffer = static_cast<BYTE*>(buffer);
+        while (size > 0)
+        {
+            OVERLAPPED overlapped;
+            ZeroMemory(&overlapped, sizeof(overlapped));
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            const DWORD toRead = (size > MAXDWORD) ? MAXDWORD : static_cast<DWORD>(size);
+            DWORD read = 0;
+            if (!ReadFile(m_file.Get(), pBuffer, toRead, &read, &overlapped) || 0 == read)
+            {
+                return false;
+            }
+
+            pBuffer += read;
+            offset += read;
+            size -= read;
+        }
+
+        return true;
+    }
+
+    uint64_t GetSize() override
+    {
+        return m_size;
+    }
+
+private:
+    Microsoft::WRL::Wrappers::FileHandle m_file;
+    uint64_t m_size;
+};
+
+// keyframe times of a local mp4 / mov, see ReadMp4KeyframeTimes. S_FALSE and
+// no times if the file isn't one.
+HRESULT ReadKeyframeTimes(
+    _In_ LPCWSTR pszPath,
+    _Out_ std::vector<int64_t>* pTimes,
+    _Out_ int64_t* pFrameDuration);
+
+// starts reading the keyframe times of a local mp4 / mov on the thread pool,
+// the index is ready once they are read. S_FALSE and no index for urls that
+// aren't files.
+HRESULT StartKeyframeIndex(
+    _In_ LPCWSTR pszContentLocation,
+    _Out_ std::shared_ptr<CKeyframeIndex>* pIndex);
+
+// boxed values for the nullable (IReference) properties
+HRESULT CreateUInt32Reference(
+    _In_ UINT32 value,
+    _COM_Outptr_ ABI::Windows::Foundation::IReference<UINT32>** ppReference);
+
+HRESULT CreateDoubleReference(
+    _In_ DOUBLE value,
+    _COM_Outptr_ ABI::Windows::Foundation::IReference<DOUBLE>** ppReference);
+
+HRESULT CreateTimeSpanReference(
+    _In_ INT64 value,
+    _COM_Outptr_ ABI::Windows::Foundation::IReference<ABI::Windows::Foundation::TimeSpan>** ppReference);
 
 HRESULT GetSurfaceFromTexture(
     _In_ ID3D11Texture2D* pTexture,
@@ -54,3 +190,7 @@ HRESULT GetTextureFromSurface(
 HRESULT CreateMediaDevice(
     _In_opt_ IDXGIAdapter* pDXGIAdapter,
     _COM_Outptr_ ID3D11Device** ppDevice);
+
+// WARP device standing in for unity's device when decoding without a gpu
+HRESULT CreateWarpDevice(
+    _COM_Outptr_ ID3D11Device** ppDevice);
@@ -12,44 +12,95 @@
 #include "pch.h"
 #include "MediaPlayerPlayback.h"
 #include "MediaHelpers.h"
+#include "PreloadCache.h"
 
 using namespace Microsoft::WRL;
 using namespace ABI::Windows::Graphics::DirectX::Direct3D11;
 using namespace ABI::Windows::Media;
 using namespace ABI::Windows::Media::Core;
 using namespace ABI::Windows::Media::Playback;
+using namespace ABI::Windows::Media::Streaming::Adaptive;
 using namespace Windows::Foundation;
 
+CTexturePool<CMediaPlayerPlayback::OutputSlot> CMediaPlayerPlayback::s_texturePool(PLAYBACK_TEXTURE_POOL_BUDGET);
+
+class CMediaPlayerPlayback::COutputSlotAllocator : public ITexturePoolAllocator<CMediaPlayerPlayback::OutputSlot>
+{
+public:
+    COutputSlotAllocator(_In_ CMediaPlayerPlayback* pPlayback)
+        : m_pPlayback(pPlayback)
+        , m_result(S_OK)
+    {
+    }
+
+    // the key was made from the player's texture description, which CreateOutputSlot uses
+    bool Allocate(const TEXTURE_POOL_KEY& key, OutputSlot* pSlot) override
+    {
+        UNREFERENCED_PARAMETER(key);
+
+        m_result = m_pPlayback->CreateOutputSlot(pSlot);
+
+        return SUCCEEDED(m_result);
+    }
+
+    HRESULT GetResult() const
+    {
+        return m_result;
+    }
+
+private:
+    CMediaPlayerPlayback* m_pPlayback;
+    HRESULT m_result;
+};
+
 _Use_decl_annotations_
 HRESULT CMediaPlayerPlayback::CreateMediaPlayback(
     UnityGfxRenderer apiType, 
     IUnityInterfaces* pUnityInterfaces,
+    PlaybackBackend backend,
     StateChangedCallback fnCallback,
     IMediaPlayerPlayback** ppMediaPlayback)
 {
     Log(Log_Level_Info, L"CMediaPlayerPlayback::CreateMediaPlayback()");
 
-    NULL_CHK(pUnityInterfaces);
-    NULL_CHK(fnCallback);
+    // fnCallback is optional, see DrainEvents
     NULL_CHK(ppMediaPlayback);
 
     *ppMediaPlayback = nullptr;
 
-    if (apiType == kUnityGfxRendererD3D11)
+    if (PlaybackBackend::PlaybackBackend_Auto == backend)
+    {
+        backend = (apiType == kUnityGfxRendererD3D11) ? PlaybackBackend::PlaybackBackend_Hardware : PlaybackBackend::PlaybackBackend_WarpDevice;
+    }
+
+    ComPtr<ID3D11Device> spDevice;
+    if (PlaybackBackend::PlaybackBackend_Hardware == backend)
     {
+        NULL_CHK(pUnityInterfaces);
+
+        if (apiType != kUnityGfxRendererD3D11)
+            IFR(E_INVALIDARG);
+
         IUnityGraphicsD3D11* d3d = pUnityInterfaces->Get<IUnityGraphicsD3D11>();
         NULL_CHK_HR(d3d, E_INVALIDARG);
 
-        ComPtr<CMediaPlayerPlayback> spMediaPlayback(nullptr);
-        IFR(MakeAndInitialize<CMediaPlayerPlayback>(&spMediaPlayback, fnCallback, d3d->GetDevice()));
-
-        *ppMediaPlayback = spMediaPlayback.Detach();
+        spDevice = d3d->GetDevice();
+    }
+    else if (PlaybackBackend::PlaybackBackend_WarpDevice == backend)
+    {
+        // no gpu, or none unity shares. Same player and events, only the devices differ
+        IFR(AcquireWarpDevice(&spDevice));
     }
     else
     {
         IFR(E_INVALIDARG);
     }
 
+    ComPtr<CMediaPlayerPlayback> spMediaPlayback(nullptr);
+    IFR(MakeAndInitialize<CMediaPlayerPlayback>(&spMediaPlayback, fnCallback, backend, spDevice.Get()));
+
+    *ppMediaPlayback = spMediaPlayback.Detach();
+
     return S_OK;
 }
 
@@ -58,26 +109,53 @@ _Use_decl_annotations_
 CMediaPlayerPlayback::CMediaPlayerPlayback()
     : m_d3dDevice(nullptr)
     , m_mediaDevice(nullptr)
+    , m_backend(PlaybackBackend::PlaybackBackend_Hardware)
     , m_fnStateCallback(nullptr)
     , m_mediaPlayer(nullptr)
     , m_mediaPlaybackSession(nullptr)
-    , m_primaryTexture(nullptr)
-    , m_primaryTextureSRV(nullptr)
-    , m_primarySharedHandle(INVALID_HANDLE_VALUE)
-    , m_primaryMediaTexture(nullptr)
-    , m_primaryMediaSurface(nullptr)
+    , m_videoSize(0)
+    , m_outputFormat(PlaybackOutputFormat::PlaybackOutputFormat_BGRA8)
+    , m_outputSlotCount(0)
+    , m_outputKey()
+    , m_outputSlotSize(0)
+    , m_frameRing(PLAYBACK_OUTPUT_SLOTS)
+    , m_readingSlotAcquired(false)
+    , m_frameTimestamp(0)
+    , m_frameWriting(false)
+    , m_readbackEnabled(false)
+    , m_readback(nullptr)
+    , m_readbackRing(PLAYBACK_READBACK_SLOTS)
+    , m_presentationClock(0)
+    , m_hasPresentationClock(false)
+    , m_playlist(nullptr)
+    , m_playlistRepeat(PlaylistRepeat::PlaylistRepeat_None)
+    , m_playlistPrefetchTime(0)
+    , m_currentKeyframeItem(nullptr)
+    , m_seekMode(PlaybackSeekMode::PlaybackSeekMode_Exact)
+    , m_frameCacheBudget(0)
+    , m_displayedTime(0)
+    , m_stepTarget(0)
+    , m_stepWalking(false)
+    , m_stepResync(false)
+    , m_readAheadWindow(0)
+    , m_readAheadDuration(0)
+    , m_readAheadCounters(std::make_shared<CReadAheadCounters>())
 {
+    static std::atomic<UINT32> s_nextTraceId(1);
+    m_traceId = s_nextTraceId++;
 }
 
 _Use_decl_annotations_
 CMediaPlayerPlayback::~CMediaPlayerPlayback()
 {
+    ReleaseThumbnails();
+
+    ReleaseReadback();
+
     ReleaseTextures();
 
     ReleaseMediaPlayer();
 
-    MFUnlockDXGIDeviceManager();
-
     ReleaseResources();
 }
 
@@ -85,11 +163,11 @@ CMediaPlayerPlayback::~CMediaPlayerPlayback()
 _Use_decl_annotations_
 HRESULT CMediaPlayerPlayback::RuntimeClassInitialize(
     StateChangedCallback fnCallback,
+    PlaybackBackend backend,
     ID3D11Device* pDevice)
 {
     Log(Log_Level_Info, L"CMediaPlayerPlayback::RuntimeClassInitialize()");
 
-    NULL_CHK(fnCallback);
     NULL_CHK(pDevice);
 
     // ref count passed in device
@@ -102,26 +180,19 @@ HRESULT CMediaPlayerPlayback::RuntimeClassInitialize(
     ComPtr<IDXGIAdapter> spAdapter;
     IFR(spDXGIDevice->GetAdapter(&spAdapter));
 
-    // create dx device for media pipeline
-    ComPtr<ID3D11Device> spMediaDevice;
-    IFR(CreateMediaDevice(spAdapter.Get(), &spMediaDevice));
-
-    // lock the shared dxgi device manager
-    // will keep lock open for the life of object
-    //     call MFUnlockDXGIDeviceManager when unloading
-    UINT uiResetToken;
-    ComPtr<IMFDXGIDeviceManager> spDeviceManager;
-    IFR(MFLockDXGIDeviceManager(&uiResetToken, &spDeviceManager));
-
-    // associtate the device with the manager
-    IFR(spDeviceManager->ResetDevice(spMediaDevice.Get(), uiResetToken));
+    // dx device for media pipeline, the adapter's pooled one with the shared
+    // dxgi device manager already associated, created by the first player on it
+    std::shared_ptr<CMediaDevice> spSharedMediaDevice;
+    IFR(AcquireMediaDevice(spAdapter.Get(), &spSharedMediaDevice));
 
     // create media plyaer object
     IFR(CreateMediaPlayer());
 
     m_fnStateCallback = fnCallback;
+    m_backend = backend;
     m_d3dDevice.Attach(spDevice.Detach());
-    m_mediaDevice.Attach(spMediaDevice.Detach());
+    m_mediaDevice = spSharedMediaDevice->GetDevice();
+    m_sharedMediaDevice = spSharedMediaDevice;
 
     return S_OK;
 }
@@ -131,6 +202,17 @@ HRESULT CMediaPlayerPlayback::CreatePlaybackTexture(
     UINT32 width,
     UINT32 height, 
     void** ppvTexture)
+{
+    return CreatePlaybackTextureEx(width, height, PlaybackOutputFormat::PlaybackOutputFormat_BGRA8, ppvTexture, nullptr);
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::CreatePlaybackTextureEx(
+    UINT32 width,
+    UINT32 height,
+    PlaybackOutputFormat format,
+    void** ppvTexture,
+    void** ppvChromaTexture)
 {
     NULL_CHK(ppvTexture);
 
@@ -138,18 +220,60 @@ HRESULT CMediaPlayerPlayback::CreatePlaybackTexture(
         IFR(E_INVALIDARG);
 
     *ppvTexture = nullptr;
+    if (nullptr != ppvChromaTexture)
+    {
+        *ppvChromaTexture = nullptr;
+    }
+
+    DXGI_FORMAT dxgiFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
+    switch (format)
+    {
+    case PlaybackOutputFormat::PlaybackOutputFormat_BGRA8:
+        break;
+    case PlaybackOutputFormat::PlaybackOutputFormat_NV12:
+        dxgiFormat = DXGI_FORMAT_NV12;
+        break;
+    case PlaybackOutputFormat::PlaybackOutputFormat_P010:
+        dxgiFormat = DXGI_FORMAT_P010;
+        break;
+    default:
+        IFR(E_INVALIDARG);
+    }
 
-    // create the video texture description based on texture format
-    m_textureDesc = CD3D11_TEXTURE2D_DESC(DXGI_FORMAT_B8G8R8A8_UNORM, width, height);
-    m_textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
-    m_textureDesc.MipLevels = 1;
-    m_textureDesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
-    m_textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    if (PlaybackOutputFormat::PlaybackOutputFormat_BGRA8 != format)
+    {
+        // 4:2:0 needs even dimensions and somewhere to hand back the chroma plane
+        NULL_CHK(ppvChromaTexture);
+        if ((width & 1) || (height & 1))
+            IFR(E_INVALIDARG);
+
+        // both devices have to be able to create and share the planar texture
+        UINT support = 0;
+        IFR(m_d3dDevice->CheckFormatSupport(dxgiFormat, &support));
+        if (0 == (support & D3D11_FORMAT_SUPPORT_TEXTURE2D))
+            IFR(DXGI_ERROR_UNSUPPORTED);
+
+        IFR(m_mediaDevice->CheckFormatSupport(dxgiFormat, &support));
+        if (0 == (support & D3D11_FORMAT_SUPPORT_TEXTURE2D))
+            IFR(DXGI_ERROR_UNSUPPORTED);
+    }
 
-    IFR(CreateTextures());
+    // create the video texture description based on texture format, the
+    // decoder thread reads it, so it only replaces the current one under the lock
+    CD3D11_TEXTURE2D_DESC desc(dxgiFormat, width, height);
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+    desc.MipLevels = 1;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+    desc.Usage = D3D11_USAGE_DEFAULT;
 
     ComPtr<ID3D11ShaderResourceView> spSRV;
-    IFR(m_primaryTextureSRV.CopyTo(&spSRV));
+    ComPtr<ID3D11ShaderResourceView> spChromaSRV;
+    IFR(CreateTextures(format, desc, &spSRV, &spChromaSRV));
+
+    if (nullptr != ppvChromaTexture)
+    {
+        *ppvChromaTexture = spChromaSRV.Detach();
+    }
 
     *ppvTexture = spSRV.Detach();
 
@@ -160,21 +284,42 @@ _Use_decl_annotations_
 HRESULT CMediaPlayerPlayback::LoadContent(
     LPCWSTR pszContentLocation)
 {
-    Log(Log_Level_Info, L"CMediaPlayerPlayback::LoadContent()");
+    TRACE_SCOPE("LoadContent", m_traceId);
+
+    ReleaseAdaptiveSource();
+
+    m_counters.OnLoad();
+
+    ComPtr<IMediaPlaybackItem> spPlaybackItem;
+    IFR(CreatePlaybackItem(pszContentLocation, &spPlaybackItem));
+    IFR(LoadPlaybackItem(spPlaybackItem.Get()));
+
+    IndexKeyframes(spPlaybackItem.Get(), pszContentLocation);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::LoadContentFromBundle(
+    LPCWSTR pszBundlePath,
+    LPCWSTR pszName)
+{
+    TRACE_SCOPE("LoadContentFromBundle", m_traceId);
 
-    // create the media source for content (fromUri)
+    ReleaseAdaptiveSource();
+
+    m_counters.OnLoad();
+
+    // no file to open or probe, the bundle's index has what a probe would find
     ComPtr<IMediaSource2> spMediaSource2;
-    IFR(CreateMediaSource(pszContentLocation, &spMediaSource2));
+    std::shared_ptr<CKeyframeIndex> spKeyframes;
+    IFR(CreateBundleMediaSource(pszBundlePath, pszName, &spMediaSource2, &spKeyframes));
 
     ComPtr<IMediaPlaybackItem> spPlaybackItem;
     IFR(CreateMediaPlaybackItem(spMediaSource2.Get(), &spPlaybackItem));
+    IFR(LoadPlaybackItem(spPlaybackItem.Get()));
 
-    ComPtr<IMediaPlaybackSource> spMediaPlaybackSource;
-    IFR(spPlaybackItem.As(&spMediaPlaybackSource));
-
-    ComPtr<IMediaPlayerSource2> spMediaPlayerSource;
-    IFR(m_mediaPlayer.As(&spMediaPlayerSource));
-    IFR(spMediaPlayerSource->put_Source(spMediaPlaybackSource.Get()));
+    AddKeyframes(spPlaybackItem.Get(), spKeyframes);
 
     return S_OK;
 }
@@ -182,7 +327,26 @@ HRESULT CMediaPlayerPlayback::LoadContent(
 _Use_decl_annotations_
 HRESULT CMediaPlayerPlayback::Play()
 {
-    Log(Log_Level_Info, L"CMediaPlayerPlayback::Play()");
+    TraceInstant("Play", m_traceId);
+
+    // frames stepped to from the cache left media foundation behind
+    INT64 resyncPosition = -1;
+    {
+        std::lock_guard<std::mutex> lock(m_outputLock);
+        m_stepWalking = false;
+        if (m_stepResync)
+        {
+            resyncPosition = m_displayedTime;
+            m_stepResync = false;
+        }
+    }
+
+    if (resyncPosition >= 0 && nullptr != m_mediaPlaybackSession)
+    {
+        ABI::Windows::Foundation::TimeSpan position;
+        position.Duration = resyncPosition;
+        IFR(m_mediaPlaybackSession->put_Position(position));
+    }
 
     if (nullptr != m_mediaPlayer)
     {
@@ -198,20 +362,26 @@ HRESULT CMediaPlayerPlayback::Play()
 _Use_decl_annotations_
 HRESULT CMediaPlayerPlayback::Pause()
 {
-    Log(Log_Level_Info, L"CMediaPlayerPlayback::Pause()");
+    TraceInstant("Pause", m_traceId);
 
     if (nullptr != m_mediaPlayer)
     {
         IFR(m_mediaPlayer->Pause());
     }
 
+    // the unity clock keeps running while paused, re-anchor on resume
+    ResetPresentation();
+
     return S_OK;
 }
 
 _Use_decl_annotations_
 HRESULT CMediaPlayerPlayback::Stop()
 {
-    Log(Log_Level_Info, L"CMediaPlayerPlayback::Stop()");
+    TraceInstant("Stop", m_traceId);
+
+    // first, a manifest still loading must not start playback after this
+    ReleaseAdaptiveSource();
 
     if (nullptr != m_mediaPlayer)
     {
@@ -220,13 +390,21 @@ HRESULT CMediaPlayerPlayback::Stop()
         IFR(spMediaPlayerSource->put_Source(nullptr));
     }
 
+    ReleasePlaylist();
+
+    ResetPresentation();
+
+    m_status.Update([](PLAYBACK_STATUS& status)
+    {
+        ZeroMemory(&status, sizeof(status));
+        status.rate = 1.0;
+    });
+
     return S_OK;
 }
 
 HRESULT CMediaPlayerPlayback::GetPosition(LONGLONG* position)
 {
-	Log(Log_Level_Info, L"CMediaPlayerPlayback::GetPosition()");
-
 	if (nullptr != m_mediaPlayer)
 	{
 		m_mediaPlayer->get_Position( ((ABI::Windows::Foundation::TimeSpan*) position) );
@@ -236,8 +414,6 @@ HRESULT CMediaPlayerPlayback::GetPosition(LONGLONG* position)
 
 HRESULT CMediaPlayerPlayback::GetDuration(LONGLONG* duration)
 {
-	Log(Log_Level_Info, L"CMediaPlayerPlayback::GetPosition()");
-
 	if (nullptr != m_mediaPlayer)
 	{
 		m_mediaPlaybackSession->get_NaturalDuration(((ABI::Windows::Foundation::TimeSpan*) duration));
@@ -247,7 +423,9 @@ HRESULT CMediaPlayerPlayback::GetDuration(LONGLONG* duration)
 
 HRESULT CMediaPlayerPlayback::SetPosition(LONGLONG position)
 {
-	Log(Log_Level_Info, L"CMediaPlayerPlayback::SetPosition()");
+	position = SnapToKeyframe(position);
+
+	TraceInstant("Seek", m_traceId, position);
 
 	if (nullptr != m_mediaPlaybackSession)
 	{
@@ -260,9 +438,20 @@ HRESULT CMediaPlayerPlayback::SetPosition(LONGLONG position)
 		}
 		else
 		{
+			{
+				std::lock_guard<std::mutex> lock(m_outputLock);
+				m_stepWalking = false;
+				m_stepResync = false;
+			}
+
 			ABI::Windows::Foundation::TimeSpan positionTS;
 			positionTS.Duration = position;
+			m_counters.OnSeek();
 			IFR(m_mediaPlaybackSession->put_Position(positionTS));
+
+			ResetPresentation();
+
+			m_status.Update([position](PLAYBACK_STATUS& status) { status.position = position; });
 		}
 	}
 	return S_OK;
@@ -270,8 +459,6 @@ HRESULT CMediaPlayerPlayback::SetPosition(LONGLONG position)
 
 HRESULT CMediaPlayerPlayback::GetPlaybackRate(DOUBLE* rate)
 {
-	Log(Log_Level_Info, L"CMediaPlayerPlayback::GetPlaybackRate()");
-
 	if (nullptr != m_mediaPlaybackSession)
 	{
 		m_mediaPlaybackSession->get_PlaybackRate(rate);
@@ -281,243 +468,2533 @@ HRESULT CMediaPlayerPlayback::GetPlaybackRate(DOUBLE* rate)
 
 HRESULT CMediaPlayerPlayback::SetPlaybackRate(DOUBLE rate) 
 {
-	Log(Log_Level_Info, L"CMediaPlayerPlayback::SetPlaybackRate()");
+	TraceInstant("SetPlaybackRate", m_traceId, static_cast<INT64>(rate * 1000.0));
 	if (nullptr != m_mediaPlaybackSession)
 	{
 		m_mediaPlaybackSession->put_PlaybackRate(rate);
+
+		m_status.Update([rate](PLAYBACK_STATUS& status) { status.rate = rate; });
+
+		std::lock_guard<std::mutex> lock(m_outputLock);
+		m_scheduler.SetRate(rate);
 	}
 
 	return S_OK;
 }
 
-
 _Use_decl_annotations_
-HRESULT CMediaPlayerPlayback::CreateMediaPlayer()
+HRESULT CMediaPlayerPlayback::LatchFrame()
 {
-    Log(Log_Level_Info, L"CMediaPlayerPlayback::CreateMediaPlayer()");
-
-    // create media player
-    ComPtr<IMediaPlayer> spMediaPlayer;
-    IFR(ActivateInstance(Wrappers::HStringReference(RuntimeClass_Windows_Media_Playback_MediaPlayer).Get(), &spMediaPlayer));
-
-    // setup callbacks
-    EventRegistrationToken openedEventToken;
-    auto mediaOpened = Microsoft::WRL::Callback<IMediaPlayerEventHandler>(this, &CMediaPlayerPlayback::OnOpened);
-    IFR(spMediaPlayer->add_MediaOpened(mediaOpened.Get(), &openedEventToken));
-
-    EventRegistrationToken endedEventToken;
-    auto mediaEnded = Microsoft::WRL::Callback<IMediaPlayerEventHandler>(this, &CMediaPlayerPlayback::OnEnded);
-    IFR(spMediaPlayer->add_MediaEnded(mediaEnded.Get(), &endedEventToken));
-
-    EventRegistrationToken failedEventToken;
-    auto mediaFailed = Microsoft::WRL::Callback<IFailedEventHandler>(this, &CMediaPlayerPlayback::OnFailed);
-    IFR(spMediaPlayer->add_MediaFailed(mediaFailed.Get(), &failedEventToken));
-
-    // frameserver mode is on the IMediaPlayer5 interface
-    ComPtr<IMediaPlayer5> spMediaPlayer5;
-    IFR(spMediaPlayer.As(&spMediaPlayer5));
+    std::lock_guard<std::mutex> lock(m_outputLock);
 
-    // set frameserver mode
-    IFR(spMediaPlayer5->put_IsVideoFrameServerEnabled(true));
+    if (0 == m_outputSlotCount)
+    {
+        return S_OK;
+    }
 
-    // register for frame available callback
-    EventRegistrationToken videoFrameAvailableToken;
-    auto videoFrameAvailableCallback = Microsoft::WRL::Callback<IMediaPlayerEventHandler>(this, &CMediaPlayerPlayback::OnVideoFrameAvailable);
-    IFR(spMediaPlayer5->add_VideoFrameAvailable(videoFrameAvailableCallback.Get(), &videoFrameAvailableToken));
+    INT64 timestamp = 0;
+    OutputSlot* pLatched = LatchOutputSlot(&timestamp);
+    if (nullptr != pLatched)
+    {
+        TraceInstant("Latch", m_traceId, timestamp);
+        m_status.Update([timestamp](PLAYBACK_STATUS& status) { status.lastFramePts = timestamp; });
+    }
 
-    // store the player and token
-    m_mediaPlayer.Attach(spMediaPlayer.Detach());
-    m_openedEventToken = openedEventToken;
-    m_endedEventToken = endedEventToken;
-    m_failedEventToken = failedEventToken;
-    m_videoFrameAvailableToken = videoFrameAvailableToken;
+    // draws queued before this event were the last to sample the slots of the previous
+    // size once script fetched a resized one, those of players on the WARP device are never sampled
+    if (m_outputResize.CanReleaseRetired(PlaybackBackend::PlaybackBackend_WarpDevice == m_backend))
+    {
+        ReleaseRetiredSlots(true);
+    }
 
-    IFR(AddStateChanged());
+    if (m_readbackEnabled.load())
+    {
+        UpdateReadback(pLatched, timestamp);
+    }
+    else if (nullptr != m_readback)
+    {
+        ReleaseReadback();
+    }
 
     return S_OK;
 }
 
 _Use_decl_annotations_
-void CMediaPlayerPlayback::ReleaseMediaPlayer()
+CMediaPlayerPlayback::OutputSlot* CMediaPlayerPlayback::LatchOutputSlot(
+    INT64* pTimestamp)
 {
-    Log(Log_Level_Info, L"CMediaPlayerPlayback::ReleaseMediaPlayer()");
-
-    RemoveStateChanged();
+    *pTimestamp = 0;
 
-    if (nullptr != m_mediaPlayer)
+    // first latch after the textures were created, take ownership of the initial slot
+    if (!m_readingSlotAcquired)
     {
-        ComPtr<IMediaPlayer5> spMediaPlayer5;
-        if (SUCCEEDED(m_mediaPlayer.As(&spMediaPlayer5)))
+        OutputSlot& reading = m_outputSlots[m_frameRing.ReadingSlot()];
+        HRESULT hr = reading.keyedMutex->AcquireSync(reading.syncKey, PLAYBACK_OUTPUT_SYNC_TIMEOUT_MS);
+        if (S_OK != hr)
         {
-            LOG_RESULT(spMediaPlayer5->remove_VideoFrameAvailable(m_videoFrameAvailableToken));
-
-            spMediaPlayer5.Reset();
-            spMediaPlayer5 = nullptr;
+            LOG_RESULT(FAILED(hr) ? hr : HRESULT_FROM_WIN32(WAIT_TIMEOUT));
+            return nullptr;
         }
 
-        LOG_RESULT(m_mediaPlayer->remove_MediaOpened(m_openedEventToken));
-        LOG_RESULT(m_mediaPlayer->remove_MediaEnded(m_endedEventToken));
-        LOG_RESULT(m_mediaPlayer->remove_MediaFailed(m_failedEventToken));
-
-        // stop playback
-        LOG_RESULT(Stop());
-
-        m_mediaPlayer.Reset();
-        m_mediaPlayer = nullptr;
+        m_readingSlotAcquired = true;
     }
-}
-
-_Use_decl_annotations_
-HRESULT CMediaPlayerPlayback::CreateTextures()
-{
-    if (nullptr != m_primaryTexture || nullptr != m_primaryTextureSRV)
-        ReleaseTextures();
-
-    // create staging texture on unity device
-    ComPtr<ID3D11Texture2D> spTexture;
-    IFR(m_d3dDevice->CreateTexture2D(&m_textureDesc, nullptr, &spTexture));
-
-    auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(spTexture.Get(), D3D11_SRV_DIMENSION_TEXTURE2D);
-    ComPtr<ID3D11ShaderResourceView> spSRV;
-    IFR(m_d3dDevice->CreateShaderResourceView(spTexture.Get(), &srvDesc, &spSRV));
-
-    // create shared texture from the unity texture
-    ComPtr<IDXGIResource1> spDXGIResource;
-    IFR(spTexture.As(&spDXGIResource));
 
-    HANDLE sharedHandle = INVALID_HANDLE_VALUE;
-    ComPtr<ID3D11Texture2D> spMediaTexture;
-    ComPtr<IDirect3DSurface> spMediaSurface;
-    HRESULT hr = spDXGIResource->CreateSharedHandle(
-        nullptr,
-        DXGI_SHARED_RESOURCE_READ | DXGI_SHARED_RESOURCE_WRITE,
-        L"SharedTextureHandle",
-        &sharedHandle);
-    if (SUCCEEDED(hr))
+    // paced against the unity clock once script provides it, else the newest frame
+    int slot = m_hasPresentationClock.load() ? BeginScheduledLatch() : m_frameRing.BeginLatch();
+    if (CFrameRing::InvalidSlot == slot)
     {
-        ComPtr<ID3D11Device1> spMediaDevice;
-        hr = m_mediaDevice.As(&spMediaDevice);
-        if (SUCCEEDED(hr))
-        {
-            hr = spMediaDevice->OpenSharedResource1(sharedHandle, IID_PPV_ARGS(&spMediaTexture));
-            if (SUCCEEDED(hr))
-            {
-                hr = GetSurfaceFromTexture(spMediaTexture.Get(), &spMediaSurface);
-            }
-        }
+        // no new frame, keep showing the current one
+        return nullptr;
     }
 
-    // if anything failed, clean up and return
-    if (FAILED(hr))
+    OutputSlot& latched = m_outputSlots[slot];
+    HRESULT hr = latched.keyedMutex->AcquireSync(latched.syncKey, PLAYBACK_OUTPUT_SYNC_TIMEOUT_MS);
+    if (S_OK != hr)
     {
-        if (sharedHandle != INVALID_HANDLE_VALUE)
-            CloseHandle(sharedHandle);
-
-        IFR(hr);
+        m_frameRing.EndLatch(slot, false);
+        LOG_RESULT(FAILED(hr) ? hr : HRESULT_FROM_WIN32(WAIT_TIMEOUT));
+        return nullptr;
     }
 
-    m_primaryTexture.Attach(spTexture.Detach());
-    m_primaryTextureSRV.Attach(spSRV.Detach());
+    *pTimestamp = m_frameRing.GetTimestamp(slot);
 
-    m_primarySharedHandle = sharedHandle;
-    m_primaryMediaTexture.Attach(spMediaTexture.Detach());
-    m_primaryMediaSurface.Attach(spMediaSurface.Detach());
+    int previous = m_frameRing.EndLatch(slot, true);
+    if (CFrameRing::InvalidSlot != previous)
+    {
+        // queued after any draw that still samples the previous slot,
+        // so the decoder cannot overwrite it until unity is done with it
+        OutputSlot& released = m_outputSlots[previous];
+        released.syncKey++;
+        LOG_RESULT(released.keyedMutex->ReleaseSync(released.syncKey));
+    }
 
-    return hr;
+    m_outputResize.Latch(&latched);
+
+    return &latched;
 }
 
 _Use_decl_annotations_
-void CMediaPlayerPlayback::ReleaseTextures()
+int CMediaPlayerPlayback::BeginScheduledLatch()
 {
-    Log(Log_Level_Info, L"CMediaPlayerPlayback::ReleaseTextures()");
+    CFrameRing::ReadyFrame frames[CFrameRing::MaxSlots];
+    UINT32 count = m_frameRing.GetReadyFrames(frames, CFrameRing::MaxSlots);
 
-    // primary texture
-    if (m_primarySharedHandle != INVALID_HANDLE_VALUE)
+    PRESENTATION_CANDIDATE candidates[CFrameRing::MaxSlots];
+    for (UINT32 i = 0; i < count; ++i)
     {
-        CloseHandle(m_primarySharedHandle);
-        m_primarySharedHandle = INVALID_HANDLE_VALUE;
+        candidates[i].id = frames[i].slot;
+        candidates[i].pts = frames[i].timestamp;
     }
 
-    m_primaryMediaSurface.Reset();
-    m_primaryMediaSurface = nullptr;
-
-    m_primaryMediaTexture.Reset();
-    m_primaryMediaTexture = nullptr;
-
-    m_primaryTextureSRV.Reset();
-    m_primaryTextureSRV = nullptr;
+    int selected = m_scheduler.Select(m_presentationClock.load(), candidates, count);
+    if (CPresentationScheduler::KeepCurrent == selected)
+    {
+        return CFrameRing::InvalidSlot;
+    }
 
-    m_primaryTexture.Reset();
-    m_primaryTexture = nullptr;
+    // the decoder may have reclaimed the slot since the snapshot
+    if (!m_frameRing.BeginLatchFrame(frames[selected]))
+    {
+        return CFrameRing::InvalidSlot;
+    }
 
-    ZeroMemory(&m_textureDesc, sizeof(m_textureDesc));
+    return frames[selected].slot;
 }
 
 _Use_decl_annotations_
-HRESULT CMediaPlayerPlayback::AddStateChanged()
+void CMediaPlayerPlayback::UpdateReadback(
+    OutputSlot* pLatched,
+    INT64 timestamp)
 {
-    ComPtr<IMediaPlayer3> spMediaPlayer3;
-    IFR(m_mediaPlayer.As(&spMediaPlayer3));
+    // staging copies follow the output texture when it is recreated
+    if (nullptr == m_readback || !m_readback->Matches(m_textureDesc))
+    {
+        ReleaseReadback();
 
-    ComPtr<IMediaPlaybackSession> spSession;
-    IFR(spMediaPlayer3->get_PlaybackSession(&spSession));
-	
-	EventRegistrationToken stateChangedToken;
-    auto stateChanged = Microsoft::WRL::Callback<IMediaPlaybackSessionEventHandler>(this, &CMediaPlayerPlayback::OnStateChanged);
-    IFR(spSession->add_PlaybackStateChanged(stateChanged.Get(), &stateChangedToken));
-	IFR(spSession->add_PositionChanged(stateChanged.Get(), &stateChangedToken));
-    m_stateChangedEventToken = stateChangedToken;
-	
-	m_mediaPlaybackSession.Attach(spSession.Detach());
+        std::unique_ptr<CStagingReadback> spReadback(new CStagingReadback());
+        HRESULT hr = spReadback->Initialize(m_d3dDevice.Get(), m_textureDesc, PLAYBACK_READBACK_SLOTS);
+        if (FAILED(hr))
+        {
+            LOG_RESULT(hr);
+            return;
+        }
 
-    return S_OK;
+        m_readback = std::move(spReadback);
+        m_readbackRing.Reset(m_readback.get(), PLAYBACK_READBACK_SLOTS);
+    }
+
+    // map whatever finished since the last frame before queueing the next copy,
+    // the latched texture is owned by this device until the next latch
+    m_readbackRing.Poll();
+
+    if (nullptr != pLatched)
+    {
+        m_readbackRing.Submit(pLatched->texture.Get(), timestamp);
+    }
 }
 
 _Use_decl_annotations_
-void CMediaPlayerPlayback::RemoveStateChanged()
+void CMediaPlayerPlayback::ReleaseReadback()
 {
-    // remove playback session callbacks
-    if (nullptr != m_mediaPlaybackSession)
-    {
-		LOG_RESULT(m_mediaPlaybackSession->remove_PlaybackStateChanged(m_stateChangedEventToken));
-		LOG_RESULT(m_mediaPlaybackSession->remove_PositionChanged(m_positionChangedEventToken));
-
-        m_mediaPlaybackSession.Reset();
-        m_mediaPlaybackSession = nullptr;
-    }
+    m_readbackRing.Reset(nullptr, PLAYBACK_READBACK_SLOTS);
+    m_readback.reset();
 }
 
 _Use_decl_annotations_
-void CMediaPlayerPlayback::ReleaseResources()
+HRESULT CMediaPlayerPlayback::SetReadbackEnabled(
+    BOOL enabled)
 {
-    m_fnStateCallback = nullptr;
+    Log(Log_Level_Info, L"CMediaPlayerPlayback::SetReadbackEnabled(%d)", enabled);
 
-    // release dx devices
-    m_mediaDevice.Reset();
-    m_mediaDevice = nullptr;
+    // staging textures come and go on the next LatchFrame, on the render thread
+    m_readbackEnabled.store(FALSE != enabled);
 
-    m_d3dDevice.Reset();
-    m_d3dDevice = nullptr;
+    return S_OK;
 }
 
 _Use_decl_annotations_
-HRESULT CMediaPlayerPlayback::OnVideoFrameAvailable(IMediaPlayer* sender, IInspectable* arg)
+HRESULT CMediaPlayerPlayback::AcquireReadbackFrame(
+    PLAYBACK_READBACK_FRAME* pFrame)
 {
-    ComPtr<IMediaPlayer> spMediaPlayer(sender);
+    NULL_CHK(pFrame);
 
-    ComPtr<IMediaPlayer5> spMediaPlayer5;
-    IFR(spMediaPlayer.As(&spMediaPlayer5));
+    ZeroMemory(pFrame, sizeof(*pFrame));
 
-    if (nullptr != m_primaryMediaSurface)
+    std::lock_guard<std::mutex> lock(m_outputLock);
+
+    READBACK_FRAME frame;
+    if (nullptr == m_readback || !m_readbackRing.Acquire(&frame))
+    {
+        return S_FALSE;
+    }
+
+    D3D11_TEXTURE2D_DESC desc;
+    m_readback->GetDesc(&desc);
+
+    pFrame->data = frame.pData;
+    pFrame->rowPitch = frame.rowPitch;
+    pFrame->width = desc.Width;
+    pFrame->height = desc.Height;
+    pFrame->format = PlaybackOutputFormat::PlaybackOutputFormat_BGRA8;
+    if (DXGI_FORMAT_NV12 == desc.Format)
+    {
+        pFrame->format = PlaybackOutputFormat::PlaybackOutputFormat_NV12;
+    }
+    else if (DXGI_FORMAT_P010 == desc.Format)
     {
-        IFR(spMediaPlayer5->CopyFrameToVideoSurface(m_primaryMediaSurface.Get()));
+        pFrame->format = PlaybackOutputFormat::PlaybackOutputFormat_P010;
     }
+    pFrame->timestamp = frame.timestamp;
+    pFrame->frameId = frame.frameId;
 
     return S_OK;
 }
 
 _Use_decl_annotations_
-HRESULT CMediaPlayerPlayback::OnOpened(IMediaPlayer* sender, IInspectable* args)
+HRESULT CMediaPlayerPlayback::ReleaseReadbackFrame(
+    UINT64 frameId)
+{
+    // a frame dropped by a resize or by disabling readback is already gone
+    m_readbackRing.Release(frameId);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::SetPresentationClock(
+    INT64 clock)
+{
+    m_presentationClock.store(clock);
+    m_hasPresentationClock.store(true);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::GetPresentationStats(
+    PLAYBACK_PRESENTATION_STATS* pStats)
+{
+    NULL_CHK(pStats);
+
+    std::lock_guard<std::mutex> lock(m_outputLock);
+
+    pStats->framesPresented = m_scheduler.FramesPresented();
+    pStats->framesRepeated = m_scheduler.FramesRepeated();
+    pStats->framesDropped = m_scheduler.FramesDropped();
+    pStats->resyncs = m_scheduler.Resyncs();
+    pStats->frameDuration = m_scheduler.FrameDuration();
+    pStats->displayInterval = m_scheduler.DisplayInterval();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::DrainEvents(
+    PLAYBACK_STATE* pEvents,
+    UINT32 capacity,
+    UINT32* pCount)
+{
+    NULL_CHK(pCount);
+
+    *pCount = 0;
+
+    if (0 == capacity)
+    {
+        return S_OK;
+    }
+
+    NULL_CHK(pEvents);
+
+    QueuedState queued;
+    UINT32 count = 0;
+    while (count < capacity && m_events.TryPop(&queued))
+    {
+        pEvents[count++] = queued.state;
+        m_counters.OnEventDelivered(queued.queuedAt);
+    }
+
+    *pCount = count;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::GetPlaybackStats(
+    PLAYBACK_STATS* pStats,
+    BOOL reset)
+{
+    NULL_CHK(pStats);
+
+    CPlaybackCounters::SNAPSHOT snapshot;
+    m_counters.Snapshot(&snapshot, !!reset);
+
+    ZeroMemory(pStats, sizeof(*pStats));
+    pStats->interval = snapshot.interval;
+    pStats->framesAvailable = snapshot.framesAvailable;
+    pStats->framesCopied = snapshot.framesCopied;
+    pStats->framesDropped = snapshot.framesDropped;
+    pStats->copyFailures = snapshot.copyFailures;
+    pStats->copyTimeMin = snapshot.copyTime.min;
+    pStats->copyTimeAvg = snapshot.copyTime.mean;
+    pStats->copyTimeMax = snapshot.copyTime.max;
+    pStats->copyTimeP99 = snapshot.copyTime.p99;
+    pStats->loadToOpen = snapshot.loadToOpen;
+    pStats->openToFirstFrame = snapshot.openToFirstFrame;
+    pStats->seekCount = snapshot.seekToFirstFrame.count;
+    pStats->seekToFirstFrameAvg = snapshot.seekToFirstFrame.mean;
+    pStats->seekToFirstFrameMax = snapshot.seekToFirstFrame.max;
+    pStats->seekToFirstFrameP99 = snapshot.seekToFirstFrame.p99;
+    pStats->eventCount = snapshot.eventLatency.count;
+    pStats->eventLatencyAvg = snapshot.eventLatency.mean;
+    pStats->eventLatencyMax = snapshot.eventLatency.max;
+    pStats->eventLatencyP99 = snapshot.eventLatency.p99;
+    pStats->itemChangeCount = snapshot.itemGap.count;
+    pStats->itemGapAvg = snapshot.itemGap.mean;
+    pStats->itemGapMax = snapshot.itemGap.max;
+    pStats->itemGapP99 = snapshot.itemGap.p99;
+    pStats->rebufferCount = snapshot.rebuffer.count;
+    pStats->rebufferTimeAvg = snapshot.rebuffer.mean;
+    pStats->rebufferTimeMax = snapshot.rebuffer.max;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::PlaylistAppend(
+    LPCWSTR pszContentLocation)
+{
+    NULL_CHK_HR(m_playlist, MF_E_INVALIDREQUEST);
+
+    ComPtr<IMediaPlaybackItem> spPlaybackItem;
+    IFR(CreatePlaybackItem(pszContentLocation, &spPlaybackItem));
+
+    ComPtr<ABI::Windows::Foundation::Collections::IVector<MediaPlaybackItem*>> spItems;
+    IFR(GetPlaylistItems(m_playlist.Get(), &spItems));
+    IFR(spItems->Append(spPlaybackItem.Get()));
+
+    IndexKeyframes(spPlaybackItem.Get(), pszContentLocation);
+
+    UpdatePlaylistStatus();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::PlaylistInsert(
+    UINT32 index,
+    LPCWSTR pszContentLocation)
+{
+    NULL_CHK_HR(m_playlist, MF_E_INVALIDREQUEST);
+
+    ComPtr<ABI::Windows::Foundation::Collections::IVector<MediaPlaybackItem*>> spItems;
+    IFR(GetPlaylistItems(m_playlist.Get(), &spItems));
+
+    unsigned int count = 0;
+    IFR(spItems->get_Size(&count));
+    if (index > count)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    ComPtr<IMediaPlaybackItem> spPlaybackItem;
+    IFR(CreatePlaybackItem(pszContentLocation, &spPlaybackItem));
+    IFR(spItems->InsertAt(index, spPlaybackItem.Get()));
+
+    IndexKeyframes(spPlaybackItem.Get(), pszContentLocation);
+
+    UpdatePlaylistStatus();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::PlaylistRemove(
+    UINT32 index)
+{
+    NULL_CHK_HR(m_playlist, MF_E_INVALIDREQUEST);
+
+    ComPtr<ABI::Windows::Foundation::Collections::IVector<MediaPlaybackItem*>> spItems;
+    IFR(GetPlaylistItems(m_playlist.Get(), &spItems));
+
+    unsigned int count = 0;
+    IFR(spItems->get_Size(&count));
+    if (index >= count)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    ComPtr<IMediaPlaybackItem> spPlaybackItem;
+    IFR(spItems->GetAt(index, &spPlaybackItem));
+
+    // removing the current item moves the list on to the next one
+    IFR(spItems->RemoveAt(index));
+
+    RemoveKeyframes(spPlaybackItem.Get());
+
+    UpdatePlaylistStatus();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::PlaylistMoveTo(
+    UINT32 index)
+{
+    NULL_CHK_HR(m_playlist, MF_E_INVALIDREQUEST);
+
+    TraceInstant("PlaylistMoveTo", m_traceId, index);
+
+    ComPtr<IMediaPlaybackItem> spPlaybackItem;
+    IFR(m_playlist->MoveTo(index, &spPlaybackItem));
+
+    ResetPresentation();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::SetPlaylistRepeat(
+    PlaylistRepeat repeat)
+{
+    if (repeat != PlaylistRepeat::PlaylistRepeat_None
+        && repeat != PlaylistRepeat::PlaylistRepeat_All
+        && repeat != PlaylistRepeat::PlaylistRepeat_One)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    m_playlistRepeat = repeat;
+
+    return ApplyPlaylistSettings();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::SetPlaylistPrefetchTime(
+    INT64 prefetchTime)
+{
+    if (prefetchTime < 0)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    m_playlistPrefetchTime = prefetchTime;
+
+    return ApplyPlaylistSettings();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::SetSeekMode(
+    PlaybackSeekMode mode)
+{
+    if (mode != PlaybackSeekMode::PlaybackSeekMode_Exact
+        && mode != PlaybackSeekMode::PlaybackSeekMode_NearestKeyframe
+        && mode != PlaybackSeekMode::PlaybackSeekMode_PreviousKeyframe)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    m_seekMode = mode;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::GetKeyframeTimes(
+    INT64* pTimes,
+    UINT32 capacity,
+    UINT32* pCount)
+{
+    NULL_CHK(pCount);
+
+    *pCount = 0;
+
+    std::shared_ptr<CKeyframeIndex> spKeyframes;
+    {
+        std::lock_guard<std::mutex> lock(m_keyframeLock);
+        spKeyframes = m_keyframes;
+    }
+
+    // S_FALSE while the index is still being read, no index at all is an empty one
+    if (nullptr == spKeyframes)
+    {
+        return S_OK;
+    }
+
+    if (!spKeyframes->IsReady())
+    {
+        return S_FALSE;
+    }
+
+    const size_t count = spKeyframes->GetTimes(pTimes, (nullptr != pTimes) ? capacity : 0);
+    *pCount = static_cast<UINT32>(count);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::StepFrames(
+    INT32 frames)
+{
+    NULL_CHK_HR(m_mediaPlayer, MF_E_INVALIDREQUEST);
+    NULL_CHK_HR(m_mediaPlaybackSession, MF_E_INVALIDREQUEST);
+
+    TraceInstant("StepFrames", m_traceId, frames);
+
+    if (0 == frames)
+    {
+        return S_OK;
+    }
+
+    ComPtr<IMediaPlayer5> spMediaPlayer5;
+    IFR(m_mediaPlayer.As(&spMediaPlayer5));
+
+    // stepping leaves playback paused
+    IFR(Pause());
+
+    std::shared_ptr<CKeyframeIndex> spKeyframes;
+    {
+        std::lock_guard<std::mutex> lock(m_keyframeLock);
+        spKeyframes = m_keyframes;
+    }
+
+    // decided under the lock, media foundation is called after it is released
+    INT64 seekPosition = -1;
+    bool stepForward = false;
+    bool stepBackward = false;
+    {
+        std::lock_guard<std::mutex> lock(m_outputLock);
+
+        m_stepWalking = false;
+
+        if (nullptr != spKeyframes)
+        {
+            m_frameCache.SetFrameDuration(spKeyframes->GetFrameDuration());
+        }
+
+        INT64 timestamp = 0;
+        int slot = m_frameCache.Find(m_displayedTime, frames, &timestamp);
+        if (CFrameCache::InvalidSlot != slot)
+        {
+            TraceInstant("StepHit", m_traceId, timestamp);
+            IFR(PresentCachedFrame(slot, timestamp));
+            m_stepResync = true;
+            return S_OK;
+        }
+
+        INT64 frameDuration = m_frameCache.GetFrameDuration();
+        if (0 == frameDuration)
+        {
+            frameDuration = PLAYBACK_DEFAULT_FRAME_DURATION;
+        }
+
+        INT64 target = m_displayedTime + frames * frameDuration;
+        target = (target < 0) ? 0 : target;
+
+        if (m_cacheSlots.empty())
+        {
+            // no cache, one frame is stepped by media foundation and further is a seek
+            stepForward = (1 == frames);
+            stepBackward = (-1 == frames);
+            seekPosition = (stepForward || stepBackward) ? -1 : target;
+        }
+        else
+        {
+            // decode from the keyframe before the target up to it once, caching
+            // every frame on the way, so stepping back through it is free
+            INT64 keyframe = (nullptr != spKeyframes) ? spKeyframes->SnapPrevious(target) : target;
+            keyframe = (keyframe > target) ? target : keyframe;
+
+            m_stepWalking = true;
+            m_stepTarget = target;
+
+            // going forward within the group of pictures on screen needs no seek
+            stepForward = (frames > 0 && !m_stepResync && keyframe <= m_displayedTime);
+            seekPosition = stepForward ? -1 : keyframe;
+        }
+
+        m_stepResync = false;
+    }
+
+    if (seekPosition >= 0)
+    {
+        ABI::Windows::Foundation::TimeSpan position;
+        position.Duration = seekPosition;
+        IFR(m_mediaPlaybackSession->put_Position(position));
+    }
+    else if (stepForward)
+    {
+        IFR(spMediaPlayer5->StepForwardOneFrame());
+    }
+    else if (stepBackward)
+    {
+        IFR(spMediaPlayer5->StepBackwardOneFrame());
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::SetFrameCacheBudget(
+    INT64 budget)
+{
+    if (budget < 0)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    std::unique_lock<std::mutex> lock(m_outputLock);
+    WaitForFrameWrite(lock);
+
+    m_frameCacheBudget = budget;
+
+    // otherwise made with the textures
+    if (0 != m_outputSlotCount)
+    {
+        IFR(CreateFrameCache());
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::GetFrameCacheStats(
+    PLAYBACK_FRAME_CACHE_STATS* pStats,
+    BOOL reset)
+{
+    NULL_CHK(pStats);
+
+    std::lock_guard<std::mutex> lock(m_outputLock);
+
+    CFrameCache::STATS stats = m_frameCache.GetStats(!!reset);
+
+    ZeroMemory(pStats, sizeof(*pStats));
+    pStats->budget = m_frameCacheBudget;
+    pStats->bytes = static_cast<INT64>(m_cacheSlots.size()) * GetFrameCacheSlotSize();
+    pStats->slots = stats.slots;
+    pStats->frames = stats.frames;
+    pStats->hits = stats.hits;
+    pStats->misses = stats.misses;
+    pStats->framesCached = stats.inserts;
+    pStats->evictions = stats.evictions;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::GenerateThumbnails(
+    LPCWSTR pszContentLocation,
+    UINT32 count,
+    UINT32 width,
+    UINT32 height)
+{
+    NULL_CHK(pszContentLocation);
+
+    TraceInstant("GenerateThumbnails", m_traceId, count);
+
+    ReleaseThumbnails();
+
+    // decoded on the gpu the player decodes on, through a device of its own
+    ComPtr<IDXGIDevice> spDXGIDevice;
+    ComPtr<IDXGIAdapter> spAdapter;
+    if (nullptr != m_mediaDevice && SUCCEEDED(m_mediaDevice.As(&spDXGIDevice)))
+    {
+        LOG_RESULT(spDXGIDevice->GetAdapter(&spAdapter));
+    }
+
+    // set first, a cached atlas completes inside Start
+    auto spThumbnails = std::make_shared<CThumbnailGenerator>();
+    {
+        std::lock_guard<std::mutex> lock(m_thumbnailLock);
+        m_thumbnails = spThumbnails;
+    }
+
+    // the generator is cancelled before the player is released, so it may call back into it
+    HRESULT hr = spThumbnails->Start(pszContentLocation, count, width, height, spAdapter.Get(), m_traceId,
+        [this](UINT32 completed, UINT32 total, HRESULT result)
+    {
+        PLAYBACK_STATE playbackState;
+        ZeroMemory(&playbackState, sizeof(playbackState));
+        playbackState.type = (E_PENDING == result) ? StateType::StateType_ThumbnailProgress : StateType::StateType_ThumbnailsCompleted;
+        playbackState.value.thumbnails.completed = completed;
+        playbackState.value.thumbnails.count = total;
+        playbackState.value.thumbnails.hresult = result;
+
+        PostState(playbackState);
+    });
+    if (FAILED(hr))
+    {
+        ReleaseThumbnails();
+        IFR(hr);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::GetThumbnails(
+    PLAYBACK_THUMBNAILS* pInfo,
+    BYTE* pPixels,
+    UINT32 size,
+    INT64* pTimes,
+    UINT32 capacity)
+{
+    NULL_CHK(pInfo);
+
+    std::shared_ptr<CThumbnailGenerator> spThumbnails;
+    {
+        std::lock_guard<std::mutex> lock(m_thumbnailLock);
+        spThumbnails = m_thumbnails;
+    }
+
+    NULL_CHK_HR(spThumbnails, MF_E_INVALIDREQUEST);
+
+    return spThumbnails->GetThumbnails(pInfo, pPixels, size, pTimes, capacity);
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::CreateThumbnailTexture(
+    void** ppvTexture)
+{
+    NULL_CHK(ppvTexture);
+
+    *ppvTexture = nullptr;
+
+    std::shared_ptr<CThumbnailGenerator> spThumbnails;
+    {
+        std::lock_guard<std::mutex> lock(m_thumbnailLock);
+        spThumbnails = m_thumbnails;
+    }
+
+    NULL_CHK_HR(spThumbnails, MF_E_INVALIDREQUEST);
+
+    ComPtr<ID3D11ShaderResourceView> spTextureSRV;
+    IFR(spThumbnails->CreateTexture(m_d3dDevice.Get(), &spTextureSRV));
+
+    std::lock_guard<std::mutex> lock(m_thumbnailLock);
+
+    // not AddRef'd, valid until the next GenerateThumbnails, CreateThumbnailTexture or release of the player
+    m_thumbnailSRV = spTextureSRV;
+    *ppvTexture = m_thumbnailSRV.Get();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::SetReadAhead(
+    INT64 window,
+    INT64 duration)
+{
+    if (window < 0 || duration < 0)
+    {
+        IFR(E_INVALIDARG);
+    }
+
+    TraceInstant("SetReadAhead", m_traceId, window);
+
+    // items already read ahead are resized, turning it off takes effect from the next load
+    std::vector<std::pair<std::shared_ptr<CReadAheadBuffer>, UINT64>> resized;
+    {
+        std::lock_guard<std::mutex> lock(m_readAheadLock);
+
+        m_readAheadWindow = window;
+        m_readAheadDuration = duration;
+
+        if (0 != window || 0 != duration)
+        {
+            for (const auto& entry : m_readAheadItems)
+            {
+                auto spBuffer = entry.second.buffer.lock();
+                if (nullptr != spBuffer)
+                {
+                    resized.emplace_back(spBuffer, GetReadAheadWindow(spBuffer->GetSize(), entry.second.duration));
+                }
+            }
+        }
+    }
+
+    // waits out a read in flight, not under the lock
+    for (const auto& entry : resized)
+    {
+        entry.first->SetWindow(entry.second);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::GetReadAheadStats(
+    PLAYBACK_READ_AHEAD_STATS* pStats,
+    BOOL reset)
+{
+    NULL_CHK(pStats);
+
+    CReadAheadCounters::SNAPSHOT snapshot;
+    m_readAheadCounters->Snapshot(&snapshot, !!reset);
+
+    ZeroMemory(pStats, sizeof(*pStats));
+    pStats->bytesRead = snapshot.bytesRead;
+    pStats->bytesPrefetched = snapshot.bytesPrefetched;
+    pStats->seeks = snapshot.seeks;
+    pStats->readErrors = snapshot.readErrors;
+    pStats->underrunCount = snapshot.underrun.count;
+    pStats->underrunTimeAvg = snapshot.underrun.mean;
+    pStats->underrunTimeMax = snapshot.underrun.max;
+    pStats->seekFillCount = snapshot.seekFill.count;
+    pStats->seekFillTimeAvg = snapshot.seekFill.mean;
+    pStats->seekFillTimeMax = snapshot.seekFill.max;
+
+    std::lock_guard<std::mutex> lock(m_readAheadLock);
+
+    for (const auto& entry : m_readAheadItems)
+    {
+        auto spBuffer = entry.second.buffer.lock();
+        if (nullptr == spBuffer)
+        {
+            continue;
+        }
+
+        CReadAheadBuffer::OCCUPANCY occupancy;
+        spBuffer->GetOccupancy(&occupancy);
+
+        ++pStats->buffers;
+        pStats->window += occupancy.window;
+        pStats->bufferedAhead += occupancy.ahead;
+        pStats->bufferedBehind += occupancy.behind;
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::LoadAdaptiveContent(
+    LPCWSTR pszManifestLocation,
+    const PLAYBACK_ADAPTIVE_SETTINGS* pSettings)
+{
+    TRACE_SCOPE("LoadAdaptiveContent", m_traceId);
+
+    NULL_CHK(pszManifestLocation);
+    NULL_CHK_HR(m_mediaPlayer, MF_E_INVALIDREQUEST);
+
+    PLAYBACK_ADAPTIVE_SETTINGS settings;
+    ZeroMemory(&settings, sizeof(settings));
+    if (nullptr != pSettings)
+    {
+        settings = *pSettings;
+    }
+
+    // the previous content stops now rather than when the manifest arrives
+    ReleaseAdaptiveSource();
+
+    ComPtr<IMediaPlayerSource2> spMediaPlayerSource;
+    IFR(m_mediaPlayer.As(&spMediaPlayerSource));
+    IFR(spMediaPlayerSource->put_Source(nullptr));
+
+    ReleasePlaylist();
+
+    m_counters.OnLoad();
+    m_adaptiveCounters.Reset();
+
+    ResetPresentation();
+
+    m_status.Update([](PLAYBACK_STATUS& status)
+    {
+        ZeroMemory(&status, sizeof(status));
+        status.state = PlaybackState::PlaybackState_Opening;
+        status.rate = 1.0;
+    });
+
+    ComPtr<CAdaptiveSourceRequest> spRequest;
+    IFR(MakeAndInitialize<CAdaptiveSourceRequest>(&spRequest, this, settings));
+
+    // downloads and parses the manifest, the source is played from OnAdaptiveSourceCreated
+    IFR(CreateAdaptiveMediaSource(pszManifestLocation, spRequest.Get()));
+
+    m_adaptiveRequest = spRequest;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::GetAdaptiveStats(
+    PLAYBACK_ADAPTIVE_STATS* pStats,
+    BOOL reset)
+{
+    NULL_CHK(pStats);
+
+    CAdaptiveCounters::SNAPSHOT snapshot;
+    m_adaptiveCounters.Snapshot(&snapshot, !!reset);
+
+    ZeroMemory(pStats, sizeof(*pStats));
+    pStats->bitrateSwitches = snapshot.bitrateSwitches;
+    pStats->segmentsDownloaded = snapshot.segmentsDownloaded;
+    pStats->bytesDownloaded = snapshot.bytesDownloaded;
+    pStats->downloadFailures = snapshot.downloadFailures;
+    pStats->timeToFirstByteAvg = snapshot.timeToFirstByte.mean;
+    pStats->timeToFirstByteP99 = snapshot.timeToFirstByte.p99;
+    pStats->downloadTimeAvg = snapshot.downloadTime.mean;
+    pStats->downloadTimeP99 = snapshot.downloadTime.p99;
+
+    ComPtr<IAdaptiveMediaSource> spAdaptiveSource;
+    {
+        std::lock_guard<std::mutex> lock(m_adaptiveLock);
+        spAdaptiveSource = m_adaptiveSource;
+    }
+
+    if (nullptr != spAdaptiveSource)
+    {
+        ComPtr<ABI::Windows::Foundation::Collections::IVectorView<UINT32>> spBitrates;
+        if (SUCCEEDED(spAdaptiveSource->get_AvailableBitrates(&spBitrates)))
+        {
+            LOG_RESULT(spBitrates->get_Size(&pStats->bitrateCount));
+        }
+
+        LOG_RESULT(spAdaptiveSource->get_CurrentPlaybackBitrate(&pStats->playbackBitrate));
+        LOG_RESULT(spAdaptiveSource->get_CurrentDownloadBitrate(&pStats->downloadBitrate));
+
+        UINT64 inboundBitsPerSecond = 0;
+        LOG_RESULT(spAdaptiveSource->get_InboundBitsPerSecond(&inboundBitsPerSecond));
+        pStats->inboundBitsPerSecond = (inboundBitsPerSecond > UINT32_MAX) ? UINT32_MAX : static_cast<UINT32>(inboundBitsPerSecond);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::GetStatus(
+    PLAYBACK_STATUS* pStatus)
+{
+    NULL_CHK(pStatus);
+
+    UINT32 version = 0;
+    m_status.Read(pStatus, &version);
+
+    pStatus->handle = 0;
+    pStatus->version = version;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::GetPlaybackTexture(
+    void** ppvTexture)
+{
+    NULL_CHK(ppvTexture);
+
+    return GetPlaybackPlanes(ppvTexture, nullptr);
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::GetPlaybackPlanes(
+    void** ppvTexture,
+    void** ppvChromaTexture)
+{
+    NULL_CHK(ppvTexture);
+
+    // not AddRef'd, valid until the next CreatePlaybackTexture or release of the player.
+    // Both planes come from the same slot, so luma and chroma always belong to one frame.
+    OutputSlot* pOutput = m_outputResize.Fetch();
+
+    *ppvTexture = (nullptr != pOutput) ? pOutput->textureSRV.Get() : nullptr;
+    if (nullptr != ppvChromaTexture)
+    {
+        *ppvChromaTexture = (nullptr != pOutput) ? pOutput->chromaSRV.Get() : nullptr;
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::CreateMediaPlayer()
+{
+    Log(Log_Level_Info, L"CMediaPlayerPlayback::CreateMediaPlayer()");
+
+    // create media player
+    ComPtr<IMediaPlayer> spMediaPlayer;
+    IFR(ActivateInstance(Wrappers::HStringReference(RuntimeClass_Windows_Media_Playback_MediaPlayer).Get(), &spMediaPlayer));
+
+    // setup callbacks
+    EventRegistrationToken openedEventToken;
+    auto mediaOpened = Microsoft::WRL::Callback<IMediaPlayerEventHandler>(this, &CMediaPlayerPlayback::OnOpened);
+    IFR(spMediaPlayer->add_MediaOpened(mediaOpened.Get(), &openedEventToken));
+
+    EventRegistrationToken endedEventToken;
+    auto mediaEnded = Microsoft::WRL::Callback<IMediaPlayerEventHandler>(this, &CMediaPlayerPlayback::OnEnded);
+    IFR(spMediaPlayer->add_MediaEnded(mediaEnded.Get(), &endedEventToken));
+
+    EventRegistrationToken failedEventToken;
+    auto mediaFailed = Microsoft::WRL::Callback<IFailedEventHandler>(this, &CMediaPlayerPlayback::OnFailed);
+    IFR(spMediaPlayer->add_MediaFailed(mediaFailed.Get(), &failedEventToken));
+
+    // frameserver mode is on the IMediaPlayer5 interface
+    ComPtr<IMediaPlayer5> spMediaPlayer5;
+    IFR(spMediaPlayer.As(&spMediaPlayer5));
+
+    // set frameserver mode
+    IFR(spMediaPlayer5->put_IsVideoFrameServerEnabled(true));
+
+    // register for frame available callback
+    EventRegistrationToken videoFrameAvailableToken;
+    auto videoFrameAvailableCallback = Microsoft::WRL::Callback<IMediaPlayerEventHandler>(this, &CMediaPlayerPlayback::OnVideoFrameAvailable);
+    IFR(spMediaPlayer5->add_VideoFrameAvailable(videoFrameAvailableCallback.Get(), &videoFrameAvailableToken));
+
+    // store the player and token
+    m_mediaPlayer.Attach(spMediaPlayer.Detach());
+    m_openedEventToken = openedEventToken;
+    m_endedEventToken = endedEventToken;
+    m_failedEventToken = failedEventToken;
+    m_videoFrameAvailableToken = videoFrameAvailableToken;
+
+    IFR(AddStateChanged());
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ReleaseMediaPlayer()
+{
+    Log(Log_Level_Info, L"CMediaPlayerPlayback::ReleaseMediaPlayer()");
+
+    RemoveStateChanged();
+
+    if (nullptr != m_mediaPlayer)
+    {
+        ComPtr<IMediaPlayer5> spMediaPlayer5;
+        if (SUCCEEDED(m_mediaPlayer.As(&spMediaPlayer5)))
+        {
+            LOG_RESULT(spMediaPlayer5->remove_VideoFrameAvailable(m_videoFrameAvailableToken));
+
+            spMediaPlayer5.Reset();
+            spMediaPlayer5 = nullptr;
+        }
+
+        LOG_RESULT(m_mediaPlayer->remove_MediaOpened(m_openedEventToken));
+        LOG_RESULT(m_mediaPlayer->remove_MediaEnded(m_endedEventToken));
+        LOG_RESULT(m_mediaPlayer->remove_MediaFailed(m_failedEventToken));
+
+        // stop playback
+        LOG_RESULT(Stop());
+
+        m_mediaPlayer.Reset();
+        m_mediaPlayer = nullptr;
+    }
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::CreateTextures(
+    PlaybackOutputFormat format,
+    const CD3D11_TEXTURE2D_DESC& desc,
+    ID3D11ShaderResourceView** ppTextureSRV,
+    ID3D11ShaderResourceView** ppChromaSRV)
+{
+    *ppTextureSRV = nullptr;
+    *ppChromaSRV = nullptr;
+
+    ReleaseTextures();
+
+    std::lock_guard<std::mutex> lock(m_outputLock);
+
+    m_outputFormat = format;
+    m_textureDesc = desc;
+
+    IFR(AcquireOutputSlots());
+
+    // made at the size the video opened with, the output keeps up with it
+    m_outputResize.Reset(
+        &m_outputSlots[0],
+        m_videoSize.load(),
+        (static_cast<UINT64>(m_textureDesc.Width) << 32) | m_textureDesc.Height);
+
+    // stepping works without the cache, only slower
+    LOG_RESULT(CreateFrameCache());
+
+    // unity starts out sampling slot 0, LatchFrame moves it along the ring. Taken
+    // before the lock is let go, a resize on the decoder thread replaces the slots.
+    ComPtr<ID3D11ShaderResourceView> spSRV = m_outputSlots[0].textureSRV;
+    ComPtr<ID3D11ShaderResourceView> spChromaSRV = m_outputSlots[0].chromaSRV;
+    *ppTextureSRV = spSRV.Detach();
+    *ppChromaSRV = spChromaSRV.Detach();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::AcquireOutputSlots()
+{
+    // slots a player of the same size let go of are reused, texture, views, shared handle and all
+    m_outputKey.pDevice = m_d3dDevice.Get();
+    m_outputKey.pSharedDevice = m_mediaDevice.Get();
+    m_outputKey.width = m_textureDesc.Width;
+    m_outputKey.height = m_textureDesc.Height;
+    m_outputKey.format = m_textureDesc.Format;
+    m_outputKey.bindFlags = m_textureDesc.BindFlags;
+    m_outputSlotSize = GetFrameCacheSlotSize();
+
+    COutputSlotAllocator allocator(this);
+    for (UINT32 i = 0; i < PLAYBACK_OUTPUT_SLOTS; ++i)
+    {
+        if (!s_texturePool.Acquire(m_outputKey, &allocator, &m_outputSlots[i]))
+        {
+            PoolOutputSlots(i);
+
+            IFR(allocator.GetResult());
+        }
+    }
+
+    m_outputSlotCount = PLAYBACK_OUTPUT_SLOTS;
+    m_frameRing.Reset(m_outputSlotCount);
+    m_frameRing.SetReadingSlot(0);
+    m_readingSlotAcquired = false;
+    m_scheduler.Reset();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ReleaseTextures()
+{
+    Log(Log_Level_Info, L"CMediaPlayerPlayback::ReleaseTextures()");
+
+    std::unique_lock<std::mutex> lock(m_outputLock);
+    WaitForFrameWrite(lock);
+
+    m_outputResize.Clear();
+
+    ReleaseFrameCache();
+
+    ReleaseRetiredSlots(false);
+
+    PoolOutputSlots(m_outputSlotCount);
+
+    m_outputSlotCount = 0;
+    m_frameRing.Reset(PLAYBACK_OUTPUT_SLOTS);
+    m_readingSlotAcquired = false;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::CreateOutputSlot(
+    OutputSlot* pSlot)
+{
+    NULL_CHK(pSlot);
+
+    // create staging texture on unity device
+    ComPtr<ID3D11Texture2D> spTexture;
+    IFR(m_d3dDevice->CreateTexture2D(&m_textureDesc, nullptr, &spTexture));
+
+    // planar formats get one view per plane, the plane is picked by the view format
+    DXGI_FORMAT lumaFormat = DXGI_FORMAT_UNKNOWN;
+    DXGI_FORMAT chromaFormat = DXGI_FORMAT_UNKNOWN;
+    if (PlaybackOutputFormat::PlaybackOutputFormat_NV12 == m_outputFormat)
+    {
+        lumaFormat = DXGI_FORMAT_R8_UNORM;
+        chromaFormat = DXGI_FORMAT_R8G8_UNORM;
+    }
+    else if (PlaybackOutputFormat::PlaybackOutputFormat_P010 == m_outputFormat)
+    {
+        lumaFormat = DXGI_FORMAT_R16_UNORM;
+        chromaFormat = DXGI_FORMAT_R16G16_UNORM;
+    }
+
+    auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(spTexture.Get(), D3D11_SRV_DIMENSION_TEXTURE2D, lumaFormat);
+    ComPtr<ID3D11ShaderResourceView> spSRV;
+    IFR(m_d3dDevice->CreateShaderResourceView(spTexture.Get(), &srvDesc, &spSRV));
+
+    ComPtr<ID3D11ShaderResourceView> spChromaSRV;
+    if (DXGI_FORMAT_UNKNOWN != chromaFormat)
+    {
+        auto chromaDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(spTexture.Get(), D3D11_SRV_DIMENSION_TEXTURE2D, chromaFormat);
+        IFR(m_d3dDevice->CreateShaderResourceView(spTexture.Get(), &chromaDesc, &spChromaSRV));
+    }
+
+    // create shared texture from the unity texture
+    ComPtr<IDXGIResource1> spDXGIResource;
+    IFR(spTexture.As(&spDXGIResource));
+
+    // keyed mutex on each device orders the decoder copy against unity's sampling
+    ComPtr<IDXGIKeyedMutex> spKeyedMutex;
+    IFR(spTexture.As(&spKeyedMutex));
+
+    HANDLE sharedHandle = INVALID_HANDLE_VALUE;
+    ComPtr<ID3D11Texture2D> spMediaTexture;
+    ComPtr<IDXGIKeyedMutex> spMediaKeyedMutex;
+    ComPtr<IDirect3DSurface> spMediaSurface;
+    HRESULT hr = spDXGIResource->CreateSharedHandle(
+        nullptr,
+        DXGI_SHARED_RESOURCE_READ | DXGI_SHARED_RESOURCE_WRITE,
+        nullptr,
+        &sharedHandle);
+    if (SUCCEEDED(hr))
+    {
+        ComPtr<ID3D11Device1> spMediaDevice;
+        hr = m_mediaDevice.As(&spMediaDevice);
+        if (SUCCEEDED(hr))
+        {
+            hr = spMediaDevice->OpenSharedResource1(sharedHandle, IID_PPV_ARGS(&spMediaTexture));
+            if (SUCCEEDED(hr))
+            {
+                hr = spMediaTexture.As(&spMediaKeyedMutex);
+            }
+            if (SUCCEEDED(hr))
+            {
+                hr = GetSurfaceFromTexture(spMediaTexture.Get(), &spMediaSurface);
+            }
+        }
+    }
+
+    // if anything failed, clean up and return
+    if (FAILED(hr))
+    {
+        if (sharedHandle != INVALID_HANDLE_VALUE)
+            CloseHandle(sharedHandle);
+
+        IFR(hr);
+    }
+
+    pSlot->texture.Attach(spTexture.Detach());
+    pSlot->textureSRV.Attach(spSRV.Detach());
+    pSlot->chromaSRV.Attach(spChromaSRV.Detach());
+    pSlot->keyedMutex.Attach(spKeyedMutex.Detach());
+
+    pSlot->sharedHandle = sharedHandle;
+    pSlot->mediaTexture.Attach(spMediaTexture.Detach());
+    pSlot->mediaKeyedMutex.Attach(spMediaKeyedMutex.Detach());
+    pSlot->mediaSurface.Attach(spMediaSurface.Detach());
+    pSlot->syncKey = 0;
+
+    return hr;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ReleaseOutputSlot(
+    OutputSlot* pSlot)
+{
+    if (pSlot->sharedHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(pSlot->sharedHandle);
+        pSlot->sharedHandle = INVALID_HANDLE_VALUE;
+    }
+
+    pSlot->mediaSurface.Reset();
+    pSlot->mediaKeyedMutex.Reset();
+    pSlot->mediaTexture.Reset();
+
+    pSlot->keyedMutex.Reset();
+    pSlot->chromaSRV.Reset();
+    pSlot->textureSRV.Reset();
+    pSlot->texture.Reset();
+
+    pSlot->syncKey = 0;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::PoolOutputSlots(
+    UINT32 count)
+{
+    // unity's device still holds the slot it samples, and only the render thread may release it
+    int held = m_readingSlotAcquired ? m_frameRing.ReadingSlot() : CFrameRing::InvalidSlot;
+
+    std::vector<OutputSlot> evicted;
+    for (UINT32 i = 0; i < count; ++i)
+    {
+        if (static_cast<int>(i) == held)
+        {
+            ReleaseOutputSlot(&m_outputSlots[i]);
+            continue;
+        }
+
+        // the keyed mutex is free, released with the slot's sync key
+        s_texturePool.Release(m_outputKey, std::move(m_outputSlots[i]), m_outputSlotSize, &evicted);
+        m_outputSlots[i] = OutputSlot();
+    }
+
+    for (auto& slot : evicted)
+    {
+        ReleaseOutputSlot(&slot);
+    }
+}
+
+_Use_decl_annotations_
+bool CMediaPlayerPlayback::FollowVideoSize(
+    PLAYBACK_STATE* pState)
+{
+    ZeroMemory(pState, sizeof(*pState));
+
+    const UINT64 videoSize = m_videoSize.load();
+    const UINT32 width = static_cast<UINT32>(videoSize >> 32);
+    const UINT32 height = static_cast<UINT32>(videoSize);
+
+    const OutputResizeAction action = m_outputResize.OnVideoSize(
+        videoSize,
+        PlaybackOutputFormat::PlaybackOutputFormat_BGRA8 != m_outputFormat);
+    if (OutputResizeAction::OutputResizeAction_None == action)
+    {
+        return false;
+    }
+
+    bool resize = (OutputResizeAction::OutputResizeAction_Resize == action);
+    if (resize)
+    {
+        TRACE_SCOPE("ResizeOutput", m_traceId);
+
+        // unity keeps sampling the current slot, now a retired one, until a resized frame is latched
+        m_outputResize.Retire(
+            m_outputSlots,
+            m_outputSlotCount,
+            m_readingSlotAcquired ? m_frameRing.ReadingSlot() : CFrameRing::InvalidSlot,
+            m_outputKey,
+            m_outputSlotSize);
+
+        const UINT32 previousWidth = m_textureDesc.Width;
+        const UINT32 previousHeight = m_textureDesc.Height;
+        m_textureDesc.Width = width;
+        m_textureDesc.Height = height;
+        m_readingSlotAcquired = false;
+
+        HRESULT hr = AcquireOutputSlots();
+        if (FAILED(hr))
+        {
+            // out of video memory, keep scaling into the slots there are. The ring was left as it was.
+            LOG_RESULT(hr);
+
+            m_textureDesc.Width = previousWidth;
+            m_textureDesc.Height = previousHeight;
+
+            // still following, the next size change tries again
+            int heldSlot = CFrameRing::InvalidSlot;
+            m_outputResize.Restore(m_outputSlots, &m_outputSlotCount, &heldSlot, &m_outputKey, &m_outputSlotSize);
+            m_readingSlotAcquired = (CFrameRing::InvalidSlot != heldSlot);
+            resize = false;
+        }
+        else
+        {
+            m_outputResize.Commit();
+
+            // cached frames are the old size
+            LOG_RESULT(CreateFrameCache());
+        }
+    }
+
+    pState->type = StateType::StateType_ResolutionChanged;
+    pState->value.resolution.width = width;
+    pState->value.resolution.height = height;
+    pState->value.resolution.resized = resize ? 1 : 0;
+
+    return true;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::WaitForFrameWrite(
+    std::unique_lock<std::mutex>& lock)
+{
+    m_frameWritten.wait(lock, [this]() { return !m_frameWriting; });
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ReleaseRetiredSlots(
+    bool renderThread)
+{
+    // current may still be a retired slot when no resized frame was latched, script gets none until one is
+    std::vector<OutputSlot> evicted;
+    m_outputResize.ReleaseRetired([renderThread, &evicted](OutputSlot& slot, bool held, const TEXTURE_POOL_KEY& key, INT64 slotSize)
+    {
+        if (held && !renderThread)
+        {
+            ReleaseOutputSlot(&slot);
+            return;
+        }
+
+        if (held)
+        {
+            slot.syncKey++;
+            LOG_RESULT(slot.keyedMutex->ReleaseSync(slot.syncKey));
+        }
+
+        s_texturePool.Release(key, std::move(slot), slotSize, &evicted);
+    });
+
+    for (auto& slot : evicted)
+    {
+        ReleaseOutputSlot(&slot);
+    }
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::SetTexturePoolBudget(
+    INT64 budget)
+{
+    if (budget < 0)
+        IFR(E_INVALIDARG);
+
+    std::vector<OutputSlot> evicted;
+    s_texturePool.SetBudget(budget, &evicted);
+
+    for (auto& slot : evicted)
+    {
+        ReleaseOutputSlot(&slot);
+    }
+
+    return S_OK;
+}
+
+void CMediaPlayerPlayback::ClearTexturePool()
+{
+    std::vector<OutputSlot> removed;
+    s_texturePool.Clear(&removed);
+
+    for (auto& slot : removed)
+    {
+        ReleaseOutputSlot(&slot);
+    }
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::GetTexturePoolStats(
+    PLAYBACK_TEXTURE_POOL_STATS* pStats)
+{
+    CTexturePool<OutputSlot>::STATS stats = s_texturePool.GetStats();
+
+    ZeroMemory(pStats, sizeof(*pStats));
+    pStats->entries = stats.entries;
+    pStats->bytes = stats.bytes;
+    pStats->budget = stats.budget;
+    pStats->hits = stats.hits;
+    pStats->misses = stats.misses;
+    pStats->evictions = stats.evictions;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::CreateFrameCache()
+{
+    ReleaseFrameCache();
+
+    const INT64 slotSize = GetFrameCacheSlotSize();
+    if (0 == m_frameCacheBudget || 0 == slotSize)
+    {
+        return S_OK;
+    }
+
+    INT64 slotCount = m_frameCacheBudget / slotSize;
+    slotCount = (slotCount > PLAYBACK_FRAME_CACHE_MAX_SLOTS) ? PLAYBACK_FRAME_CACHE_MAX_SLOTS : slotCount;
+
+    // frames are decoded into and copied out of these on the media device, unity never sees them
+    D3D11_TEXTURE2D_DESC desc = m_textureDesc;
+    desc.MiscFlags = 0;
+
+    HRESULT hr = S_OK;
+    for (INT64 i = 0; i < slotCount && SUCCEEDED(hr); ++i)
+    {
+        CacheSlot slot;
+        hr = m_mediaDevice->CreateTexture2D(&desc, nullptr, &slot.texture);
+        if (SUCCEEDED(hr))
+        {
+            hr = GetSurfaceFromTexture(slot.texture.Get(), &slot.surface);
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            m_cacheSlots.push_back(slot);
+        }
+    }
+
+    // out of video memory short of the budget, keep what was made
+    LOG_RESULT(hr);
+
+    m_frameCache.Reset(static_cast<UINT32>(m_cacheSlots.size()));
+
+    return (m_cacheSlots.empty() && FAILED(hr)) ? hr : S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ReleaseFrameCache()
+{
+    m_frameCache.Reset(0);
+    m_cacheSlots.clear();
+    m_stepWalking = false;
+}
+
+_Use_decl_annotations_
+INT64 CMediaPlayerPlayback::GetFrameCacheSlotSize() const
+{
+    const INT64 pixels = static_cast<INT64>(m_textureDesc.Width) * m_textureDesc.Height;
+
+    switch (m_outputFormat)
+    {
+    case PlaybackOutputFormat::PlaybackOutputFormat_NV12:
+        return pixels * 3 / 2;
+    case PlaybackOutputFormat::PlaybackOutputFormat_P010:
+        return pixels * 3;
+    default:
+        return pixels * 4;
+    }
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::PresentCachedFrame(
+    int slot,
+    INT64 timestamp)
+{
+    if (0 == m_outputSlotCount || slot < 0 || static_cast<size_t>(slot) >= m_cacheSlots.size())
+    {
+        IFR(MF_E_INVALIDREQUEST);
+    }
+
+    int outputSlot = m_frameRing.BeginWrite();
+    if (CFrameRing::InvalidSlot == outputSlot)
+    {
+        m_counters.OnFrameDropped();
+        return S_OK;
+    }
+
+    OutputSlot& output = m_outputSlots[outputSlot];
+    HRESULT hr = output.mediaKeyedMutex->AcquireSync(output.syncKey, PLAYBACK_OUTPUT_SYNC_TIMEOUT_MS);
+    if (S_OK != hr)
+    {
+        m_frameRing.CancelWrite(outputSlot);
+        IFR(FAILED(hr) ? hr : HRESULT_FROM_WIN32(WAIT_TIMEOUT));
+    }
+
+    {
+        TRACE_SCOPE_ARG("CopyCachedFrame", m_traceId, slot);
+        ComPtr<ID3D11DeviceContext> spContext;
+        m_mediaDevice->GetImmediateContext(&spContext);
+        spContext->CopyResource(output.mediaTexture.Get(), m_cacheSlots[slot].texture.Get());
+    }
+
+    output.syncKey++;
+    LOG_RESULT(output.mediaKeyedMutex->ReleaseSync(output.syncKey));
+
+    m_frameRing.EndWrite(outputSlot, timestamp);
+    m_frameTimestamp = timestamp;
+    m_displayedTime = timestamp;
+
+    // the stepped frame is shown whatever the clock says
+    m_scheduler.Reset();
+
+    m_status.Update([timestamp](PLAYBACK_STATUS& status) { status.position = timestamp; });
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::AddStateChanged()
+{
+    ComPtr<IMediaPlayer3> spMediaPlayer3;
+    IFR(m_mediaPlayer.As(&spMediaPlayer3));
+
+    ComPtr<IMediaPlaybackSession> spSession;
+    IFR(spMediaPlayer3->get_PlaybackSession(&spSession));
+	
+	EventRegistrationToken stateChangedToken;
+    auto stateChanged = Microsoft::WRL::Callback<IMediaPlaybackSessionEventHandler>(this, &CMediaPlayerPlayback::OnStateChanged);
+    IFR(spSession->add_PlaybackStateChanged(stateChanged.Get(), &stateChangedToken));
+	IFR(spSession->add_PositionChanged(stateChanged.Get(), &stateChangedToken));
+    m_stateChangedEventToken = stateChangedToken;
+
+    EventRegistrationToken naturalVideoSizeChangedToken;
+    auto naturalVideoSizeChanged = Microsoft::WRL::Callback<IMediaPlaybackSessionEventHandler>(this, &CMediaPlayerPlayback::OnNaturalVideoSizeChanged);
+    IFR(spSession->add_NaturalVideoSizeChanged(naturalVideoSizeChanged.Get(), &naturalVideoSizeChangedToken));
+    m_naturalVideoSizeChangedEventToken = naturalVideoSizeChangedToken;
+	
+	m_mediaPlaybackSession.Attach(spSession.Detach());
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::RemoveStateChanged()
+{
+    // remove playback session callbacks
+    if (nullptr != m_mediaPlaybackSession)
+    {
+		LOG_RESULT(m_mediaPlaybackSession->remove_PlaybackStateChanged(m_stateChangedEventToken));
+		LOG_RESULT(m_mediaPlaybackSession->remove_PositionChanged(m_positionChangedEventToken));
+        LOG_RESULT(m_mediaPlaybackSession->remove_NaturalVideoSizeChanged(m_naturalVideoSizeChangedEventToken));
+
+        m_mediaPlaybackSession.Reset();
+        m_mediaPlaybackSession = nullptr;
+    }
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::CreatePlaybackItem(
+    LPCWSTR pszContentLocation,
+    IMediaPlaybackItem** ppPlaybackItem)
+{
+    NULL_CHK(ppPlaybackItem);
+
+    *ppPlaybackItem = nullptr;
+
+    // a source warmed by PreloadContent skips creating and opening it here
+    ComPtr<IMediaPlaybackItem> spPlaybackItem;
+    IFR(TakePreloadedItem(pszContentLocation, &spPlaybackItem));
+    TraceInstant(nullptr != spPlaybackItem ? "PreloadHit" : "PreloadMiss", m_traceId);
+
+    if (nullptr == spPlaybackItem)
+    {
+        bool readAhead = false;
+        UINT64 window = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_readAheadLock);
+
+            // sized in time once opened, until then bytes or the default
+            readAhead = (0 != m_readAheadWindow || 0 != m_readAheadDuration);
+            window = static_cast<UINT64>(m_readAheadWindow);
+        }
+
+        // create the media source for content (fromUri)
+        ComPtr<IMediaSource2> spMediaSource2;
+        std::shared_ptr<CReadAheadBuffer> spBuffer;
+        if (readAhead)
+        {
+            IFR(CreateReadAheadMediaSource(pszContentLocation, window, m_readAheadCounters, &spMediaSource2, &spBuffer));
+        }
+        else
+        {
+            IFR(CreateMediaSource(pszContentLocation, &spMediaSource2));
+        }
+
+        IFR(CreateMediaPlaybackItem(spMediaSource2.Get(), &spPlaybackItem));
+
+        if (nullptr != spBuffer)
+        {
+            AddReadAhead(spPlaybackItem.Get(), spBuffer);
+        }
+    }
+
+    *ppPlaybackItem = spPlaybackItem.Detach();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::LoadPlaybackItem(
+    IMediaPlaybackItem* pPlaybackItem)
+{
+    ComPtr<IMediaPlaybackList> spPlaylist;
+    IFR(CreatePlaylist(pPlaybackItem, &spPlaylist));
+    IFR(SetPlaylist(spPlaylist.Get()));
+
+    ResetPresentation();
+
+    m_status.Update([](PLAYBACK_STATUS& status)
+    {
+        ZeroMemory(&status, sizeof(status));
+        status.state = PlaybackState::PlaybackState_Opening;
+        status.rate = 1.0;
+        status.itemCount = 1;
+    });
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::SetPlaylist(
+    IMediaPlaybackList* pPlaybackList)
+{
+    NULL_CHK(pPlaybackList);
+    NULL_CHK_HR(m_mediaPlayer, MF_E_INVALIDREQUEST);
+
+    ReleasePlaylist();
+
+    ComPtr<IMediaPlaybackList> spPlaylist(pPlaybackList);
+
+    EventRegistrationToken itemChangedToken;
+    auto itemChanged = Microsoft::WRL::Callback<IItemChangedEventHandler>(this, &CMediaPlayerPlayback::OnItemChanged);
+    IFR(spPlaylist->add_CurrentItemChanged(itemChanged.Get(), &itemChangedToken));
+
+    m_playlist.Attach(spPlaylist.Detach());
+    m_itemChangedEventToken = itemChangedToken;
+
+    IFR(ApplyPlaylistSettings());
+
+    ComPtr<IMediaPlaybackSource> spMediaPlaybackSource;
+    IFR(m_playlist.As(&spMediaPlaybackSource));
+
+    ComPtr<IMediaPlayerSource2> spMediaPlayerSource;
+    IFR(m_mediaPlayer.As(&spMediaPlayerSource));
+    IFR(spMediaPlayerSource->put_Source(spMediaPlaybackSource.Get()));
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ReleasePlaylist()
+{
+    if (nullptr != m_playlist)
+    {
+        LOG_RESULT(m_playlist->remove_CurrentItemChanged(m_itemChangedEventToken));
+
+        m_playlist.Reset();
+        m_playlist = nullptr;
+    }
+
+    ReleaseKeyframes();
+    ClearFrameCache();
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::ApplyPlaylistSettings()
+{
+    if (nullptr == m_playlist || nullptr == m_mediaPlayer)
+    {
+        // picked up by the next LoadContent
+        return S_OK;
+    }
+
+    IFR(m_playlist->put_AutoRepeatEnabled(m_playlistRepeat == PlaylistRepeat::PlaylistRepeat_All));
+    IFR(m_mediaPlayer->put_IsLoopingEnabled(m_playlistRepeat == PlaylistRepeat::PlaylistRepeat_One));
+
+#if defined(NTDDI_WIN10_RS1)
+    // how far ahead of its turn the next item is opened and starts decoding, needs 1607
+    ComPtr<IMediaPlaybackList2> spPlaylist2;
+    if (SUCCEEDED(m_playlist.As(&spPlaylist2)))
+    {
+        ComPtr<ABI::Windows::Foundation::IReference<ABI::Windows::Foundation::TimeSpan>> spPrefetchTime;
+        if (0 != m_playlistPrefetchTime)
+        {
+            IFR(CreateTimeSpanReference(m_playlistPrefetchTime, &spPrefetchTime));
+        }
+
+        IFR(spPlaylist2->put_MaxPrefetchTime(spPrefetchTime.Get()));
+    }
+#endif
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::UpdatePlaylistStatus()
+{
+    if (nullptr == m_playlist)
+    {
+        return;
+    }
+
+    UINT32 itemIndex = 0;
+    LOG_RESULT(m_playlist->get_CurrentItemIndex(&itemIndex));
+
+    UINT32 itemCount = 0;
+    ComPtr<ABI::Windows::Foundation::Collections::IVector<MediaPlaybackItem*>> spItems;
+    if (SUCCEEDED(GetPlaylistItems(m_playlist.Get(), &spItems)))
+    {
+        LOG_RESULT(spItems->get_Size(&itemCount));
+    }
+
+    m_status.Update([itemIndex, itemCount](PLAYBACK_STATUS& status)
+    {
+        status.itemIndex = itemIndex;
+        status.itemCount = itemCount;
+    });
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ClearFrameCache()
+{
+    std::lock_guard<std::mutex> lock(m_outputLock);
+
+    m_frameCache.Clear();
+    m_stepWalking = false;
+    m_stepResync = false;
+    m_displayedTime = 0;
+}
+
+// the item's IUnknown, the same whichever interface the list hands back
+static IUnknown* GetItemIdentity(
+    _In_opt_ IMediaPlaybackItem* pItem)
+{
+    ComPtr<IUnknown> spUnknown;
+    if (nullptr == pItem || FAILED(pItem->QueryInterface(IID_PPV_ARGS(&spUnknown))))
+    {
+        return nullptr;
+    }
+
+    // the list keeps the item alive, only the address is kept
+    return spUnknown.Get();
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::IndexKeyframes(
+    IMediaPlaybackItem* pItem,
+    LPCWSTR pszContentLocation)
+{
+    if (nullptr == GetItemIdentity(pItem))
+    {
+        return;
+    }
+
+    // S_FALSE for content that isn't a local file, seeks on it stay exact
+    std::shared_ptr<CKeyframeIndex> spKeyframes;
+    HRESULT hr = StartKeyframeIndex(pszContentLocation, &spKeyframes);
+    LOG_RESULT(hr);
+
+    AddKeyframes(pItem, spKeyframes);
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::AddKeyframes(
+    IMediaPlaybackItem* pItem,
+    const std::shared_ptr<CKeyframeIndex>& spKeyframes)
+{
+    IUnknown* pIdentity = GetItemIdentity(pItem);
+    if (nullptr == pIdentity || nullptr == spKeyframes)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_keyframeLock);
+
+    m_itemKeyframes[pIdentity] = spKeyframes;
+
+    // the list may have moved to the item before it was indexed
+    if (pIdentity == m_currentKeyframeItem)
+    {
+        m_keyframes = spKeyframes;
+    }
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::RemoveKeyframes(
+    IMediaPlaybackItem* pItem)
+{
+    IUnknown* pIdentity = GetItemIdentity(pItem);
+
+    std::lock_guard<std::mutex> lock(m_keyframeLock);
+
+    m_itemKeyframes.erase(pIdentity);
+
+    // its address may be reused by the next item created
+    if (pIdentity == m_currentKeyframeItem)
+    {
+        m_currentKeyframeItem = nullptr;
+        m_keyframes.reset();
+    }
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::SetCurrentKeyframes(
+    IMediaPlaybackItem* pItem)
+{
+    IUnknown* pIdentity = GetItemIdentity(pItem);
+
+    std::lock_guard<std::mutex> lock(m_keyframeLock);
+
+    m_currentKeyframeItem = pIdentity;
+
+    auto it = m_itemKeyframes.find(pIdentity);
+    if (it != m_itemKeyframes.end())
+    {
+        m_keyframes = it->second;
+    }
+    else
+    {
+        m_keyframes.reset();
+    }
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ReleaseKeyframes()
+{
+    std::lock_guard<std::mutex> lock(m_keyframeLock);
+
+    // a read still running on the thread pool keeps its own reference
+    m_itemKeyframes.clear();
+    m_currentKeyframeItem = nullptr;
+    m_keyframes.reset();
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::AddReadAhead(
+    IMediaPlaybackItem* pItem,
+    const std::shared_ptr<CReadAheadBuffer>& spBuffer)
+{
+    IUnknown* pIdentity = GetItemIdentity(pItem);
+    if (nullptr == pIdentity)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_readAheadLock);
+
+    // items released since, their addresses may be reused
+    for (auto it = m_readAheadItems.begin(); it != m_readAheadItems.end(); )
+    {
+        it = it->second.buffer.expired() ? m_readAheadItems.erase(it) : std::next(it);
+    }
+
+    ReadAheadItem& item = m_readAheadItems[pIdentity];
+    item.buffer = spBuffer;
+    item.duration = 0;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::SizeReadAhead(
+    IMediaPlaybackItem* pItem)
+{
+    IUnknown* pIdentity = GetItemIdentity(pItem);
+    if (nullptr == pIdentity)
+    {
+        return;
+    }
+
+    // null until the source has opened
+    ComPtr<IMediaSource2> spMediaSource;
+    ComPtr<ABI::Windows::Foundation::IReference<ABI::Windows::Foundation::TimeSpan>> spDuration;
+    ABI::Windows::Foundation::TimeSpan duration = {};
+    if (FAILED(pItem->get_Source(&spMediaSource))
+        || FAILED(spMediaSource->get_Duration(&spDuration))
+        || nullptr == spDuration
+        || FAILED(spDuration->get_Value(&duration))
+        || duration.Duration <= 0)
+    {
+        return;
+    }
+
+    std::shared_ptr<CReadAheadBuffer> spBuffer;
+    UINT64 window = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_readAheadLock);
+
+        auto it = m_readAheadItems.find(pIdentity);
+        if (it == m_readAheadItems.end() || 0 != it->second.duration)
+        {
+            return;
+        }
+
+        it->second.duration = duration.Duration;
+
+        spBuffer = it->second.buffer.lock();
+        if (nullptr == spBuffer || 0 == m_readAheadDuration)
+        {
+            return;
+        }
+
+        window = GetReadAheadWindow(spBuffer->GetSize(), duration.Duration);
+    }
+
+    spBuffer->SetWindow(window);
+}
+
+_Use_decl_annotations_
+UINT64 CMediaPlayerPlayback::GetReadAheadWindow(
+    UINT64 size,
+    INT64 duration) const
+{
+    // at the file's average bitrate, m_readAheadLock held
+    if (0 == m_readAheadDuration || 0 >= duration)
+    {
+        return static_cast<UINT64>(m_readAheadWindow);
+    }
+
+    return static_cast<UINT64>(static_cast<double>(size) * m_readAheadDuration / duration);
+}
+
+_Use_decl_annotations_
+LONGLONG CMediaPlayerPlayback::SnapToKeyframe(
+    LONGLONG position)
+{
+    const PlaybackSeekMode mode = m_seekMode;
+    if (PlaybackSeekMode::PlaybackSeekMode_Exact == mode)
+    {
+        return position;
+    }
+
+    std::shared_ptr<CKeyframeIndex> spKeyframes;
+    {
+        std::lock_guard<std::mutex> lock(m_keyframeLock);
+        spKeyframes = m_keyframes;
+    }
+
+    // not indexed, or not yet
+    if (nullptr == spKeyframes)
+    {
+        return position;
+    }
+
+    return (PlaybackSeekMode::PlaybackSeekMode_NearestKeyframe == mode)
+        ? spKeyframes->SnapNearest(position)
+        : spKeyframes->SnapPrevious(position);
+}
+
+// closest rung of the ladder at or below bitrate, at or above it for roundUp.
+// Past either end of the ladder it is the end.
+static HRESULT SnapBitrate(
+    _In_ IAdaptiveMediaSource* pAdaptiveSource,
+    _In_ UINT32 bitrate,
+    _In_ bool roundUp,
+    _Out_ UINT32* pSnapped)
+{
+    *pSnapped = 0;
+
+    ComPtr<ABI::Windows::Foundation::Collections::IVectorView<UINT32>> spBitrates;
+    IFR(pAdaptiveSource->get_AvailableBitrates(&spBitrates));
+
+    unsigned int count = 0;
+    IFR(spBitrates->get_Size(&count));
+    if (0 == count)
+    {
+        IFR(MF_E_INVALIDREQUEST);
+    }
+
+    bool found = false;
+    UINT32 best = 0;
+    UINT32 lowest = UINT32_MAX;
+    UINT32 highest = 0;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        UINT32 rung = 0;
+        IFR(spBitrates->GetAt(i, &rung));
+
+        lowest = (rung < lowest) ? rung : lowest;
+        highest = (rung > highest) ? rung : highest;
+
+        bool candidate = roundUp ? (rung >= bitrate && (!found || rung < best)) : (rung <= bitrate && (!found || rung > best));
+        if (candidate)
+        {
+            best = rung;
+            found = true;
+        }
+    }
+
+    *pSnapped = found ? best : (roundUp ? highest : lowest);
+
+    return S_OK;
+}
+
+static HRESULT ApplyAdaptiveSettings(
+    _In_ IAdaptiveMediaSource* pAdaptiveSource,
+    _In_ const PLAYBACK_ADAPTIVE_SETTINGS& settings)
+{
+    UINT32 bitrate = 0;
+
+    if (0 != settings.initialBitrate)
+    {
+        IFR(SnapBitrate(pAdaptiveSource, settings.initialBitrate, false, &bitrate));
+        IFR(pAdaptiveSource->put_InitialBitrate(bitrate));
+    }
+
+    if (0 != settings.minBitrate)
+    {
+        ComPtr<ABI::Windows::Foundation::IReference<UINT32>> spMinBitrate;
+        IFR(SnapBitrate(pAdaptiveSource, settings.minBitrate, true, &bitrate));
+        IFR(CreateUInt32Reference(bitrate, &spMinBitrate));
+        IFR(pAdaptiveSource->put_DesiredMinBitrate(spMinBitrate.Get()));
+    }
+
+    if (0 != settings.maxBitrate)
+    {
+        ComPtr<ABI::Windows::Foundation::IReference<UINT32>> spMaxBitrate;
+        IFR(SnapBitrate(pAdaptiveSource, settings.maxBitrate, false, &bitrate));
+        IFR(CreateUInt32Reference(bitrate, &spMaxBitrate));
+        IFR(pAdaptiveSource->put_DesiredMaxBitrate(spMaxBitrate.Get()));
+    }
+
+    boolean isLive = false;
+    IFR(pAdaptiveSource->get_IsLive(&isLive));
+    if (isLive && 0 != settings.desiredLiveOffset)
+    {
+        ABI::Windows::Foundation::TimeSpan liveOffset = { settings.desiredLiveOffset };
+        IFR(pAdaptiveSource->put_DesiredLiveOffset(liveOffset));
+    }
+
+#if defined(NTDDI_WIN10_RS2)
+    ComPtr<IAdaptiveMediaSource3> spAdaptiveSource3;
+    if (SUCCEEDED(pAdaptiveSource->QueryInterface(IID_PPV_ARGS(&spAdaptiveSource3))))
+    {
+        if (isLive && 0 != settings.desiredSeekableWindow)
+        {
+            ComPtr<ABI::Windows::Foundation::IReference<ABI::Windows::Foundation::TimeSpan>> spWindow;
+            IFR(CreateTimeSpanReference(settings.desiredSeekableWindow, &spWindow));
+            IFR(spAdaptiveSource3->put_DesiredSeekableWindowSize(spWindow.Get()));
+        }
+
+        ComPtr<IAdaptiveMediaSourceAdvancedSettings> spAdvancedSettings;
+        IFR(spAdaptiveSource3->get_AdvancedSettings(&spAdvancedSettings));
+
+        if (0 != settings.bitrateHeadroomRatio)
+        {
+            ComPtr<ABI::Windows::Foundation::IReference<DOUBLE>> spRatio;
+            IFR(CreateDoubleReference(settings.bitrateHeadroomRatio, &spRatio));
+            IFR(spAdvancedSettings->put_DesiredBitrateHeadroomRatio(spRatio.Get()));
+        }
+
+        if (0 != settings.downgradeTriggerRatio)
+        {
+            ComPtr<ABI::Windows::Foundation::IReference<DOUBLE>> spRatio;
+            IFR(CreateDoubleReference(settings.downgradeTriggerRatio, &spRatio));
+            IFR(spAdvancedSettings->put_BitrateDowngradeTriggerRatio(spRatio.Get()));
+        }
+    }
+#endif
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::OnAdaptiveSourceCreated(
+    ICreateAdaptiveMediaSourceOperation* pOp,
+    AsyncStatus status,
+    const PLAYBACK_ADAPTIVE_SETTINGS& settings)
+{
+    HRESULT hr = S_OK;
+
+    ComPtr<IAdaptiveMediaSourceCreationResult> spResult;
+    if (AsyncStatus::Completed == status)
+    {
+        hr = pOp->GetResults(&spResult);
+    }
+    else
+    {
+        ComPtr<ABI::Windows::Foundation::IAsyncInfo> spAsyncInfo;
+        if (SUCCEEDED(pOp->QueryInterface(IID_PPV_ARGS(&spAsyncInfo))))
+        {
+            LOG_RESULT(spAsyncInfo->get_ErrorCode(&hr));
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            hr = E_ABORT;
+        }
+    }
+
+    AdaptiveMediaSourceCreationStatus creationStatus = AdaptiveMediaSourceCreationStatus::AdaptiveMediaSourceCreationStatus_UnknownFailure;
+    if (SUCCEEDED(hr))
+    {
+        hr = spResult->get_Status(&creationStatus);
+    }
+
+    if (SUCCEEDED(hr) && AdaptiveMediaSourceCreationStatus::AdaptiveMediaSourceCreationStatus_Success != creationStatus)
+    {
+        hr = MF_E_UNSUPPORTED_FORMAT;
+
+#if defined(NTDDI_WIN10_RS1)
+        // 1607 has the http or parser error behind the status
+        ComPtr<IAdaptiveMediaSourceCreationResult2> spResult2;
+        HRESULT extendedError = S_OK;
+        if (SUCCEEDED(spResult.As(&spResult2))
+            && SUCCEEDED(spResult2->get_ExtendedError(&extendedError))
+            && FAILED(extendedError))
+        {
+            hr = extendedError;
+        }
+#endif
+    }
+
+    ComPtr<IAdaptiveMediaSource> spAdaptiveSource;
+    if (SUCCEEDED(hr))
+    {
+        hr = spResult->get_MediaSource(&spAdaptiveSource);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = SetAdaptiveSource(spAdaptiveSource.Get(), settings);
+    }
+
+    TraceInstant("AdaptiveSourceCreated", m_traceId, hr);
+
+    if (FAILED(hr))
+    {
+        LOG_RESULT_MSG(hr, L"adaptive source: ");
+
+        PLAYBACK_STATE playbackState;
+        ZeroMemory(&playbackState, sizeof(playbackState));
+        playbackState.type = StateType::StateType_Failed;
+        playbackState.value.hresult = hr;
+
+        m_status.Update([hr](PLAYBACK_STATUS& status) { status.lastError = hr; });
+
+        PostState(playbackState);
+    }
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::SetAdaptiveSource(
+    IAdaptiveMediaSource* pAdaptiveSource,
+    const PLAYBACK_ADAPTIVE_SETTINGS& settings)
+{
+    NULL_CHK(pAdaptiveSource);
+
+    IFR(ApplyAdaptiveSettings(pAdaptiveSource, settings));
+
+    {
+        std::lock_guard<std::mutex> lock(m_adaptiveLock);
+        m_adaptiveSource = pAdaptiveSource;
+    }
+
+    // tokens are only read by ReleaseAdaptiveSource, after it cancelled this request
+    auto bitrateChanged = Microsoft::WRL::Callback<IPlaybackBitrateChangedEventHandler>(this, &CMediaPlayerPlayback::OnPlaybackBitrateChanged);
+    IFR(pAdaptiveSource->add_PlaybackBitrateChanged(bitrateChanged.Get(), &m_bitrateChangedEventToken));
+
+    auto downloadCompleted = Microsoft::WRL::Callback<IDownloadCompletedEventHandler>(this, &CMediaPlayerPlayback::OnDownloadCompleted);
+    IFR(pAdaptiveSource->add_DownloadCompleted(downloadCompleted.Get(), &m_downloadCompletedEventToken));
+
+    auto downloadFailed = Microsoft::WRL::Callback<IDownloadFailedEventHandler>(this, &CMediaPlayerPlayback::OnDownloadFailed);
+    IFR(pAdaptiveSource->add_DownloadFailed(downloadFailed.Get(), &m_downloadFailedEventToken));
+
+    ComPtr<IMediaSource2> spMediaSource2;
+    IFR(CreateMediaSourceFromAdaptiveSource(pAdaptiveSource, &spMediaSource2));
+
+    ComPtr<IMediaPlaybackItem> spPlaybackItem;
+    IFR(CreateMediaPlaybackItem(spMediaSource2.Get(), &spPlaybackItem));
+
+    ComPtr<IMediaPlaybackList> spPlaylist;
+    IFR(CreatePlaylist(spPlaybackItem.Get(), &spPlaylist));
+    IFR(SetPlaylist(spPlaylist.Get()));
+
+    UpdatePlaylistStatus();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ReleaseAdaptiveSource()
+{
+    if (nullptr != m_adaptiveRequest)
+    {
+        m_adaptiveRequest->Cancel();
+        m_adaptiveRequest.Reset();
+    }
+
+    ComPtr<IAdaptiveMediaSource> spAdaptiveSource;
+    {
+        std::lock_guard<std::mutex> lock(m_adaptiveLock);
+        spAdaptiveSource.Swap(m_adaptiveSource);
+    }
+
+    if (nullptr != spAdaptiveSource)
+    {
+        LOG_RESULT(spAdaptiveSource->remove_PlaybackBitrateChanged(m_bitrateChangedEventToken));
+        LOG_RESULT(spAdaptiveSource->remove_DownloadCompleted(m_downloadCompletedEventToken));
+        LOG_RESULT(spAdaptiveSource->remove_DownloadFailed(m_downloadFailedEventToken));
+    }
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ResetPresentation()
+{
+    std::lock_guard<std::mutex> lock(m_outputLock);
+
+    m_scheduler.Reset();
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::PostState(
+    const PLAYBACK_STATE& state)
+{
+    if (m_fnStateCallback != nullptr)
+    {
+        m_fnStateCallback(state);
+    }
+    else
+    {
+        QueuedState queued;
+        queued.state = state;
+        queued.queuedAt = CPlaybackCounters::Now();
+
+        if (!m_events.TryPush(queued))
+        {
+            Log(Log_Level_Warning, L"CMediaPlayerPlayback::PostState() - event queue full, dropped type %d", static_cast<int>(state.type));
+        }
+    }
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::UpdateSessionStatus(
+    IMediaPlaybackSession* pSession)
+{
+    MediaPlaybackState state = MediaPlaybackState_None;
+    LOG_RESULT(pSession->get_PlaybackState(&state));
+
+    ABI::Windows::Foundation::TimeSpan position = {};
+    LOG_RESULT(pSession->get_Position(&position));
+
+    DOUBLE rate = 1.0;
+    LOG_RESULT(pSession->get_PlaybackRate(&rate));
+
+    INT64 bufferedStart = 0;
+    INT64 bufferedEnd = 0;
+#if defined(NTDDI_WIN10_RS4)
+    // buffered ranges need 1803, older systems leave the range at 0
+    ComPtr<IMediaPlaybackSession2> spSession2;
+    ComPtr<ABI::Windows::Foundation::Collections::IVectorView<ABI::Windows::Media::MediaTimeRange>> spRanges;
+    if (SUCCEEDED(pSession->QueryInterface(IID_PPV_ARGS(&spSession2)))
+        && SUCCEEDED(spSession2->GetBufferedRanges(&spRanges)))
+    {
+        unsigned int count = 0;
+        LOG_RESULT(spRanges->get_Size(&count));
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            ABI::Windows::Media::MediaTimeRange range = {};
+            if (SUCCEEDED(spRanges->GetAt(i, &range))
+                && range.Start.Duration <= position.Duration
+                && position.Duration <= range.End.Duration)
+            {
+                bufferedStart = range.Start.Duration;
+                bufferedEnd = range.End.Duration;
+                break;
+            }
+        }
+    }
+#endif
+
+    m_status.Update([&](PLAYBACK_STATUS& status)
+    {
+        // Ended comes from MediaEnded, the session reports Paused after it
+        if (PlaybackState::PlaybackState_Ended != status.state || MediaPlaybackState_Paused != state)
+        {
+            status.state = static_cast<PlaybackState>(state);
+        }
+        status.position = position.Duration;
+        status.rate = rate;
+        status.bufferedStart = bufferedStart;
+        status.bufferedEnd = bufferedEnd;
+    });
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ReleaseThumbnails()
+{
+    std::shared_ptr<CThumbnailGenerator> spThumbnails;
+    ComPtr<ID3D11ShaderResourceView> spTextureSRV;
+    {
+        std::lock_guard<std::mutex> lock(m_thumbnailLock);
+        spThumbnails.swap(m_thumbnails);
+        spTextureSRV.Swap(m_thumbnailSRV);
+    }
+
+    // outside the lock, a progress callback in flight may be asking for the thumbnails
+    if (nullptr != spThumbnails)
+    {
+        spThumbnails->Cancel();
+    }
+}
+
+_Use_decl_annotations_
+void CMediaPlayerPlayback::ReleaseResources()
+{
+    m_fnStateCallback = nullptr;
+
+    // release dx devices
+    m_mediaDevice.Reset();
+    m_mediaDevice = nullptr;
+
+    // the device stays pooled for the next player, see TrimMediaDevices
+    m_sharedMediaDevice.reset();
+
+    m_d3dDevice.Reset();
+    m_d3dDevice = nullptr;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::OnVideoFrameAvailable(IMediaPlayer* sender, IInspectable* arg)
+{
+    TRACE_SCOPE("FrameAvailable", m_traceId);
+
+    m_counters.OnFrameAvailable();
+
+    ComPtr<IMediaPlayer> spMediaPlayer(sender);
+
+    ComPtr<IMediaPlayer5> spMediaPlayer5;
+    IFR(spMediaPlayer.As(&spMediaPlayer5));
+
+    ABI::Windows::Foundation::TimeSpan position = {};
+    if (nullptr != m_mediaPlaybackSession)
+    {
+        LOG_RESULT(m_mediaPlaybackSession->get_Position(&position));
+    }
+
+    // the output lock is held twice, briefly: to claim the slots and to publish them. The keyed
+    // mutex wait and the copies run without it, LatchFrame on the render thread never waits on them.
+    bool caching = false;
+    bool reached = false;
+    int cacheSlot = CFrameCache::InvalidSlot;
+    ComPtr<IDirect3DSurface> spCacheSurface;
+    int slot = CFrameRing::InvalidSlot;
+    ComPtr<IDirect3DSurface> spSurface;
+    ComPtr<IDXGIKeyedMutex> spKeyedMutex;
+    UINT64 syncKey = 0;
+    PLAYBACK_STATE resized;
+    bool postResized = false;
+    {
+        std::lock_guard<std::mutex> lock(m_outputLock);
+
+        // frames decoded on the way to a step target go to the cache instead of the screen,
+        // the one that reaches it goes to both
+        if (m_stepWalking && !m_cacheSlots.empty())
+        {
+            INT64 frameDuration = m_frameCache.GetFrameDuration();
+            if (0 == frameDuration)
+            {
+                frameDuration = PLAYBACK_DEFAULT_FRAME_DURATION;
+            }
+
+            caching = true;
+            reached = (position.Duration + frameDuration / 2 >= m_stepTarget);
+            m_stepWalking = !reached;
+        }
+
+        if (!caching || reached)
+        {
+            // a stream that changed size moves to resized slots before its first frame of the new size
+            postResized = FollowVideoSize(&resized);
+
+            // every slot is owned (should not happen with 3+ slots), skip this frame
+            slot = (0 != m_outputSlotCount) ? m_frameRing.BeginWrite() : CFrameRing::InvalidSlot;
+            if (CFrameRing::InvalidSlot != slot)
+            {
+                spSurface = m_outputSlots[slot].mediaSurface;
+                spKeyedMutex = m_outputSlots[slot].mediaKeyedMutex;
+                syncKey = m_outputSlots[slot].syncKey;
+            }
+            else if (0 != m_outputSlotCount)
+            {
+                m_counters.OnFrameDropped();
+            }
+        }
+
+        // a resize recreated the cache at the new size
+        if (caching && !m_cacheSlots.empty())
+        {
+            cacheSlot = m_frameCache.BeginInsert(position.Duration, m_stepTarget);
+            if (CFrameCache::InvalidSlot != cacheSlot)
+            {
+                spCacheSurface = m_cacheSlots[cacheSlot].surface;
+            }
+        }
+
+        m_frameWriting = (nullptr != spSurface || nullptr != spCacheSurface);
+    }
+
+    // the callback may call back into the player
+    if (postResized)
+    {
+        PostState(resized);
+    }
+
+    HRESULT hrCache = MF_E_INVALIDREQUEST;
+    if (nullptr != spCacheSurface)
+    {
+        TRACE_SCOPE_ARG("CacheFrame", m_traceId, cacheSlot);
+        hrCache = spMediaPlayer5->CopyFrameToVideoSurface(spCacheSurface.Get());
+    }
+
+    HRESULT hr = S_OK;
+    if (nullptr != spSurface)
+    {
+        hr = spKeyedMutex->AcquireSync(syncKey, PLAYBACK_OUTPUT_SYNC_TIMEOUT_MS);
+        if (S_OK == hr)
+        {
+            {
+                TRACE_SCOPE_ARG("CopyFrame", m_traceId, slot);
+                INT64 copyStart = CPlaybackCounters::Now();
+                hr = spMediaPlayer5->CopyFrameToVideoSurface(spSurface.Get());
+                m_counters.OnFrameCopied(copyStart, SUCCEEDED(hr));
+            }
+
+            syncKey++;
+            LOG_RESULT(spKeyedMutex->ReleaseSync(syncKey));
+        }
+        else
+        {
+            m_counters.OnFrameDropped();
+            hr = FAILED(hr) ? hr : HRESULT_FROM_WIN32(WAIT_TIMEOUT);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_outputLock);
+
+        if (m_frameWriting)
+        {
+            m_frameWriting = false;
+            m_frameWritten.notify_all();
+        }
+
+        if (CFrameCache::InvalidSlot != cacheSlot)
+        {
+            m_frameCache.EndInsert(cacheSlot, position.Duration, SUCCEEDED(hrCache));
+        }
+
+        if (CFrameRing::InvalidSlot != slot)
+        {
+            // the key only moved on if the acquire succeeded
+            m_outputSlots[slot].syncKey = syncKey;
+
+            if (SUCCEEDED(hr))
+            {
+                // frame server mode has no frame timestamp, the session position stands in for it
+                m_frameTimestamp = CPresentationScheduler::OrderTimestamp(position.Duration, m_frameTimestamp);
+                m_frameRing.EndWrite(slot, m_frameTimestamp);
+                m_displayedTime = position.Duration;
+                m_stepResync = false;
+
+                // the stepped frame is shown whatever the clock says
+                if (reached)
+                {
+                    m_scheduler.Reset();
+                }
+
+                m_status.Update([&position](PLAYBACK_STATUS& status) { status.position = position.Duration; });
+            }
+            else
+            {
+                m_frameRing.CancelWrite(slot);
+            }
+        }
+    }
+
+    if (caching && !reached)
+    {
+        // outside the output lock, the next frame may be delivered before it returns
+        LOG_RESULT(spMediaPlayer5->StepForwardOneFrame());
+    }
+
+    IFR(hr);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::OnOpened(IMediaPlayer* sender, IInspectable* args)
 {
     ComPtr<IMediaPlayer> spMediaPlayer(sender);
 
@@ -548,8 +3025,33 @@ HRESULT CMediaPlayerPlayback::OnOpened(IMediaPlayer* sender, IInspectable* args)
     playbackState.value.description.canSeek = canSeek;
     playbackState.value.description.duration = duration.Duration;
 
-    if (m_fnStateCallback != nullptr)
-        m_fnStateCallback(playbackState);
+    TraceInstant("Opened", m_traceId, duration.Duration);
+    m_counters.OnOpened();
+
+    m_videoSize.store((static_cast<UINT64>(width) << 32) | height);
+
+    // the first item has no change of item after it opens
+    ComPtr<IMediaPlayerSource2> spMediaPlayerSource;
+    ComPtr<IMediaPlaybackSource> spSource;
+    ComPtr<IMediaPlaybackList> spPlaylist;
+    ComPtr<IMediaPlaybackItem> spCurrentItem;
+    if (SUCCEEDED(spMediaPlayer.As(&spMediaPlayerSource))
+        && SUCCEEDED(spMediaPlayerSource->get_Source(&spSource))
+        && nullptr != spSource
+        && SUCCEEDED(spSource.As(&spPlaylist))
+        && SUCCEEDED(spPlaylist->get_CurrentItem(&spCurrentItem)))
+    {
+        SizeReadAhead(spCurrentItem.Get());
+    }
+
+    m_status.Update([&](PLAYBACK_STATUS& status)
+    {
+        status.width = width;
+        status.height = height;
+        status.duration = duration.Duration;
+    });
+
+    PostState(playbackState);
 
     return S_OK;
 }
@@ -562,8 +3064,11 @@ HRESULT CMediaPlayerPlayback::OnEnded(IMediaPlayer* sender, IInspectable* args)
     playbackState.type = StateType::StateType_StateChanged;
     playbackState.value.state = PlaybackState::PlaybackState_Ended;
 
-    if (m_fnStateCallback != nullptr)
-        m_fnStateCallback(playbackState);
+    TraceInstant("Ended", m_traceId);
+
+    m_status.Update([](PLAYBACK_STATUS& status) { status.state = PlaybackState::PlaybackState_Ended; });
+
+    PostState(playbackState);
 
     return S_OK;
 }
@@ -584,8 +3089,11 @@ HRESULT CMediaPlayerPlayback::OnFailed(IMediaPlayer* sender, IMediaPlayerFailedE
     playbackState.type = StateType::StateType_Failed;
     playbackState.value.hresult = hr;
 
-    if (m_fnStateCallback != nullptr)
-        m_fnStateCallback(playbackState);
+    TraceInstant("Failed", m_traceId, hr);
+
+    m_status.Update([hr](PLAYBACK_STATUS& status) { status.lastError = hr; });
+
+    PostState(playbackState);
 
     return S_OK;
 }
@@ -605,8 +3113,244 @@ HRESULT CMediaPlayerPlayback::OnStateChanged(IMediaPlaybackSession* sender, IIns
     playbackState.value.state = static_cast<PlaybackState>(state);
 	playbackState.value.position = pos;
 
-     if (m_fnStateCallback != nullptr)
-        m_fnStateCallback(playbackState);
+    TraceInstant("StateChanged", m_traceId, state);
+
+    m_counters.OnBuffering(MediaPlaybackState::MediaPlaybackState_Buffering == state);
+
+    UpdateSessionStatus(sender);
+
+    PostState(playbackState);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::OnNaturalVideoSizeChanged(IMediaPlaybackSession* sender, IInspectable* args)
+{
+    UINT32 width = 0;
+    IFR(sender->get_NaturalVideoWidth(&width));
+
+    UINT32 height = 0;
+    IFR(sender->get_NaturalVideoHeight(&height));
+
+    TraceInstant("VideoSizeChanged", m_traceId, (static_cast<INT64>(width) << 32) | height);
+
+    // the frame path resizes the output and posts ResolutionChanged, see FollowVideoSize
+    m_videoSize.store((static_cast<UINT64>(width) << 32) | height);
+
+    m_status.Update([width, height](PLAYBACK_STATUS& status)
+    {
+        status.width = width;
+        status.height = height;
+    });
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::OnItemChanged(IMediaPlaybackList* sender, ICurrentMediaPlaybackItemChangedEventArgs* args)
+{
+    UINT32 itemIndex = 0;
+    IFR(sender->get_CurrentItemIndex(&itemIndex));
+
+    // the list reports the first item too, only a move from one item to another is a gap
+    ComPtr<IMediaPlaybackItem> spOldItem;
+    LOG_RESULT(args->get_OldItem(&spOldItem));
+
+    bool continuous = (nullptr != spOldItem);
+#if defined(NTDDI_WIN10_RS3)
+    // 1709 says why, MoveTo and skipping a failed item are not gapless transitions
+    ComPtr<ICurrentMediaPlaybackItemChangedEventArgs2> spArgs2;
+    MediaPlaybackItemChangedReason reason = MediaPlaybackItemChangedReason_EndOfStream;
+    if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&spArgs2)))
+        && SUCCEEDED(spArgs2->get_Reason(&reason)))
+    {
+        continuous = continuous && (MediaPlaybackItemChangedReason_EndOfStream == reason);
+    }
+#endif
+
+    if (continuous)
+    {
+        m_counters.OnItemChanged();
+    }
+
+    ComPtr<IMediaPlaybackItem> spNewItem;
+    LOG_RESULT(args->get_NewItem(&spNewItem));
+    SetCurrentKeyframes(spNewItem.Get());
+    SizeReadAhead(spNewItem.Get());
+    ClearFrameCache();
+
+    PLAYBACK_STATE playbackState;
+    ZeroMemory(&playbackState, sizeof(playbackState));
+    playbackState.type = StateType::StateType_ItemChanged;
+    playbackState.value.itemIndex = itemIndex;
+
+    TraceInstant("ItemChanged", m_traceId, itemIndex);
+
+    UINT32 itemCount = 0;
+    ComPtr<ABI::Windows::Foundation::Collections::IVector<MediaPlaybackItem*>> spItems;
+    if (SUCCEEDED(GetPlaylistItems(sender, &spItems)))
+    {
+        LOG_RESULT(spItems->get_Size(&itemCount));
+    }
+
+    m_status.Update([itemIndex, itemCount](PLAYBACK_STATUS& status)
+    {
+        status.itemIndex = itemIndex;
+        status.itemCount = itemCount;
+    });
+
+    PostState(playbackState);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::OnPlaybackBitrateChanged(IAdaptiveMediaSource* sender, IAdaptiveMediaSourcePlaybackBitrateChangedEventArgs* args)
+{
+    UINT32 oldBitrate = 0;
+    IFR(args->get_OldValue(&oldBitrate));
+
+    UINT32 newBitrate = 0;
+    IFR(args->get_NewValue(&newBitrate));
+
+    boolean audioOnly = false;
+    LOG_RESULT(args->get_AudioOnly(&audioOnly));
+
+    m_adaptiveCounters.OnBitrateChanged();
+
+    PLAYBACK_STATE playbackState;
+    ZeroMemory(&playbackState, sizeof(playbackState));
+    playbackState.type = StateType::StateType_BitrateChanged;
+    playbackState.value.bitrate.oldBitrate = oldBitrate;
+    playbackState.value.bitrate.newBitrate = newBitrate;
+    playbackState.value.bitrate.audioOnly = audioOnly;
+
+    TraceInstant("BitrateChanged", m_traceId, newBitrate);
+
+    PostState(playbackState);
+
+    return S_OK;
+}
+
+// -1 for times the source did not measure
+static INT64 GetTimeSpanOrDefault(
+    _In_opt_ ABI::Windows::Foundation::IReference<ABI::Windows::Foundation::TimeSpan>* pReference)
+{
+    ABI::Windows::Foundation::TimeSpan value = { -1 };
+    if (nullptr != pReference)
+    {
+        LOG_RESULT(pReference->get_Value(&value));
+    }
+
+    return value.Duration;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::OnDownloadCompleted(IAdaptiveMediaSource* sender, IAdaptiveMediaSourceDownloadCompletedEventArgs* args)
+{
+    AdaptiveMediaSourceResourceType resourceType;
+    IFR(args->get_ResourceType(&resourceType));
+
+    // manifests, init segments and keys only show up in the trace
+    if (AdaptiveMediaSourceResourceType::AdaptiveMediaSourceResourceType_MediaSegment != resourceType)
+    {
+        TraceInstant("ResourceDownloaded", m_traceId, resourceType);
+        return S_OK;
+    }
+
+    UINT64 bytes = 0;
+    INT64 timeToFirstByte = -1;
+    INT64 downloadTime = -1;
+#if defined(NTDDI_WIN10_RS2)
+    // transfer statistics need 1703, older systems only count the segments
+    ComPtr<IAdaptiveMediaSourceDownloadCompletedEventArgs2> spArgs2;
+    ComPtr<IAdaptiveMediaSourceDownloadStatistics> spStatistics;
+    if (SUCCEEDED(args->QueryInterface(IID_PPV_ARGS(&spArgs2)))
+        && SUCCEEDED(spArgs2->get_Statistics(&spStatistics))
+        && nullptr != spStatistics)
+    {
+        LOG_RESULT(spStatistics->get_ContentBytesReceivedCount(&bytes));
+
+        ComPtr<ABI::Windows::Foundation::IReference<ABI::Windows::Foundation::TimeSpan>> spTime;
+        if (SUCCEEDED(spStatistics->get_TimeToFirstByteReceived(&spTime)))
+        {
+            timeToFirstByte = GetTimeSpanOrDefault(spTime.Get());
+        }
+
+        spTime.Reset();
+        if (SUCCEEDED(spStatistics->get_TimeToLastByteReceived(&spTime)))
+        {
+            downloadTime = GetTimeSpanOrDefault(spTime.Get());
+        }
+    }
+#endif
+
+    m_adaptiveCounters.OnSegmentDownloaded(bytes, timeToFirstByte, downloadTime);
+
+    PLAYBACK_STATE playbackState;
+    ZeroMemory(&playbackState, sizeof(playbackState));
+    playbackState.type = StateType::StateType_SegmentDownloaded;
+    playbackState.value.download.bytes = (bytes > UINT32_MAX) ? UINT32_MAX : static_cast<UINT32>(bytes);
+    playbackState.value.download.timeToFirstByte = timeToFirstByte;
+    playbackState.value.download.downloadTime = downloadTime;
+
+    TraceInstant("SegmentDownloaded", m_traceId, static_cast<INT64>(bytes));
+
+    PostState(playbackState);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CMediaPlayerPlayback::OnDownloadFailed(IAdaptiveMediaSource* sender, IAdaptiveMediaSourceDownloadFailedEventArgs* args)
+{
+    AdaptiveMediaSourceResourceType resourceType;
+    IFR(args->get_ResourceType(&resourceType));
+
+    // the source retries or switches bitrate, a failure it can't recover from fails the player
+    m_adaptiveCounters.OnDownloadFailed();
+
+    TraceInstant("DownloadFailed", m_traceId, resourceType);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CAdaptiveSourceRequest::RuntimeClassInitialize(
+    CMediaPlayerPlayback* pOwner,
+    const PLAYBACK_ADAPTIVE_SETTINGS& settings)
+{
+    NULL_CHK(pOwner);
+
+    m_pOwner = pOwner;
+    m_settings = settings;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CAdaptiveSourceRequest::Cancel()
+{
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+    m_pOwner = nullptr;
+}
+
+_Use_decl_annotations_
+HRESULT CAdaptiveSourceRequest::OnAdaptiveMediaSourceCreated(
+    ICreateAdaptiveMediaSourceOperation* pOp,
+    AsyncStatus status)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+    if (nullptr != m_pOwner)
+    {
+        CMediaPlayerPlayback* pOwner = m_pOwner;
+        m_pOwner = nullptr;
+
+        pOwner->OnAdaptiveSourceCreated(pOp, status, m_settings);
+    }
 
     return S_OK;
 }
@@ -10,6 +10,44 @@
 //*********************************************************
 #pragma once
 
+#include "MediaHelpers.h"
+#include "FrameRing.h"
+#include "StagingReadback.h"
+#include "PresentationScheduler.h"
+#include "EventQueue.h"
+#include "SeqLock.h"
+#include "Trace.h"
+#include "PlaybackCounters.h"
+#include "KeyframeIndex.h"
+#include "FrameCache.h"
+#include "ThumbnailGenerator.h"
+#include "ReadAheadBuffer.h"
+#include "MediaDevicePool.h"
+#include "TexturePool.h"
+#include "OutputResize.h"
+
+// number of shared output textures per player, see CFrameRing. One is on screen,
+// one being written, the rest queue frames for the presentation scheduler.
+#define PLAYBACK_OUTPUT_SLOTS 4
+
+// how long either device waits for a slot's keyed mutex before giving up on a frame
+#define PLAYBACK_OUTPUT_SYNC_TIMEOUT_MS 10
+
+// bytes of output slots kept for the next player of the same size, see SetTexturePoolBudget
+#define PLAYBACK_TEXTURE_POOL_BUDGET (256 * 1024 * 1024)
+
+// staging textures per player for cpu readback, see CReadbackRing
+#define PLAYBACK_READBACK_SLOTS 3
+
+// state events queued per player for PlayerDrainEvents, power of two
+#define PLAYBACK_EVENT_QUEUE_SIZE 64
+
+// decoded frames kept for StepFrames, however large the budget
+#define PLAYBACK_FRAME_CACHE_MAX_SLOTS 256
+
+// 100ns, steps assume it when neither the container nor the cache tells
+#define PLAYBACK_DEFAULT_FRAME_DURATION (10000000 / 30)
+
 enum class StateType : UINT16
 {
     StateType_None = 0,
@@ -17,6 +55,43 @@ enum class StateType : UINT16
     StateType_StateChanged,
     StateType_Failed,
 	StateType_PositionChanged,
+    StateType_ItemChanged,          // a playlist moved to value.itemIndex
+    StateType_BitrateChanged,       // adaptive streams, value.bitrate
+    StateType_SegmentDownloaded,    // adaptive streams, value.download
+    StateType_ThumbnailProgress,    // GenerateThumbnails, value.thumbnails
+    StateType_ThumbnailsCompleted,  // GenerateThumbnails, value.thumbnails.hresult says if any decoded
+    StateType_ResolutionChanged,    // the video changed size mid stream, value.resolution
+};
+
+enum class PlaybackOutputFormat : UINT32
+{
+    PlaybackOutputFormat_BGRA8 = 0,
+    PlaybackOutputFormat_NV12,  // 8 bit planar, luma + interleaved chroma srv
+    PlaybackOutputFormat_P010,  // 10 bit planar, luma + interleaved chroma srv
+};
+
+// who decodes, picked once per player in CreateMediaPlayback
+enum class PlaybackBackend : UINT32
+{
+    PlaybackBackend_Auto = 0,       // hardware when unity renders with d3d11, the WARP device otherwise
+    PlaybackBackend_Hardware,       // dxva on unity's adapter, output textures usable by unity
+    PlaybackBackend_WarpDevice,     // media foundation decoders on a d3d11 WARP device, read frames back with readback
+};
+
+enum class PlaylistRepeat : UINT32
+{
+    PlaylistRepeat_None = 0,
+    PlaylistRepeat_All,             // back to the first item after the last
+    PlaylistRepeat_One,             // loops the current item
+};
+
+// where SetPosition lands. The keyframe modes need an index of the item, only
+// local mp4 / mov files get one, anything else is seeked exactly.
+enum class PlaybackSeekMode : UINT32
+{
+    PlaybackSeekMode_Exact = 0,             // decodes from the previous keyframe up to the position
+    PlaybackSeekMode_NearestKeyframe,       // scrubbing, the closest keyframe either side
+    PlaybackSeekMode_PreviousKeyframe,      // never past the position
 };
 
 enum class PlaybackState : UINT16
@@ -39,6 +114,45 @@ typedef struct _MEDIA_DESCRIPTION
 } MEDIA_DESCRIPTION;
 #pragma pack(pop)
 
+// adaptive stream events
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_BITRATE
+{
+    UINT32 oldBitrate;          // bits per second
+    UINT32 newBitrate;
+    UINT32 audioOnly;
+} PLAYBACK_BITRATE;
+
+typedef struct _PLAYBACK_DOWNLOAD
+{
+    UINT32 bytes;               // one media segment
+    INT64 timeToFirstByte;      // since the request, -1 when not reported
+    INT64 downloadTime;
+} PLAYBACK_DOWNLOAD;
+#pragma pack(pop)
+
+// thumbnail events, see CThumbnailGenerator
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_THUMBNAIL_PROGRESS
+{
+    UINT32 completed;
+    UINT32 count;
+    HRESULT hresult;
+} PLAYBACK_THUMBNAIL_PROGRESS;
+#pragma pack(pop)
+
+// the output follows the video when it was created at the video's size. Events can sit
+// in the queue past another resize, so they carry no textures: when resized is set,
+// PlayerGetPlaybackPlanes hands out the resized output's from then on.
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_RESOLUTION
+{
+    UINT32 width;
+    UINT32 height;
+    UINT32 resized;             // 0 when the output kept its size, eg. out of video memory
+} PLAYBACK_RESOLUTION;
+#pragma pack(pop)
+
 #pragma pack(push, 4)
 typedef struct _PLAYBACK_STATE
 {
@@ -48,10 +162,194 @@ typedef struct _PLAYBACK_STATE
         HRESULT hresult;
         MEDIA_DESCRIPTION description;
 		ABI::Windows::Foundation::TimeSpan position;
+        UINT32 itemIndex;
+        PLAYBACK_BITRATE bitrate;
+        PLAYBACK_DOWNLOAD download;
+        PLAYBACK_THUMBNAIL_PROGRESS thumbnails;
+        PLAYBACK_RESOLUTION resolution;
     } value;
 } PLAYBACK_STATE;
 #pragma pack(pop)
 
+// script declares the same layout as Plugin.StateChangedMessage and PlayerDrainEvents
+// copies arrays of it, so a value larger than MEDIA_DESCRIPTION would change the stride
+static_assert(sizeof(PLAYBACK_BITRATE) <= sizeof(MEDIA_DESCRIPTION), "PLAYBACK_STATE size is fixed");
+static_assert(sizeof(PLAYBACK_DOWNLOAD) <= sizeof(MEDIA_DESCRIPTION), "PLAYBACK_STATE size is fixed");
+static_assert(sizeof(PLAYBACK_THUMBNAIL_PROGRESS) <= sizeof(MEDIA_DESCRIPTION), "PLAYBACK_STATE size is fixed");
+static_assert(sizeof(PLAYBACK_RESOLUTION) <= sizeof(MEDIA_DESCRIPTION), "PLAYBACK_STATE size is fixed");
+static_assert(4 == offsetof(PLAYBACK_STATE, value) && 24 == sizeof(PLAYBACK_STATE), "must match Plugin.StateChangedMessage");
+
+// cpu readable copy of the output texture, planar formats have the chroma
+// plane right after the luma plane at the same row pitch
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_READBACK_FRAME
+{
+    void* data;
+    UINT32 rowPitch;
+    UINT32 width;
+    UINT32 height;
+    PlaybackOutputFormat format;
+    INT64 timestamp;
+    UINT64 frameId;
+} PLAYBACK_READBACK_FRAME;
+#pragma pack(pop)
+
+// frame pacing counters, see CPresentationScheduler
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_PRESENTATION_STATS
+{
+    UINT64 framesPresented;
+    UINT64 framesRepeated;      // a new frame was due but none had been decoded
+    UINT64 framesDropped;       // decoded, but never shown
+    UINT64 resyncs;
+    INT64 frameDuration;        // measured, 100ns units
+    INT64 displayInterval;
+} PLAYBACK_PRESENTATION_STATS;
+#pragma pack(pop)
+
+// everything script polls each frame, published by the media foundation threads and read
+// without taking a lock, see CSeqLock. Times in 100ns units.
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_STATUS
+{
+    UINT32 handle;              // set by PlayerGetAllStatus
+    UINT32 version;             // changes on every update
+    PlaybackState state;
+    UINT16 reserved;
+    HRESULT lastError;
+    UINT32 width;
+    UINT32 height;
+    INT64 position;
+    INT64 duration;
+    DOUBLE rate;
+    INT64 bufferedStart;        // buffered range around position, 0 when unknown
+    INT64 bufferedEnd;
+    INT64 lastFramePts;         // timestamp of the frame on screen, the position it was decoded at
+    UINT32 itemIndex;           // playlist position, LoadContent makes a playlist of one
+    UINT32 itemCount;
+} PLAYBACK_STATUS;
+#pragma pack(pop)
+
+// hot path counters, see CPlaybackCounters. Durations in 100ns units, rates are
+// deltas between two snapshots divided by interval.
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_STATS
+{
+    INT64 interval;             // since the player was created or the stats last reset
+    UINT64 framesAvailable;
+    UINT64 framesCopied;
+    UINT64 framesDropped;       // no output slot free in time
+    UINT64 copyFailures;
+    INT64 copyTimeMin;
+    INT64 copyTimeAvg;
+    INT64 copyTimeMax;
+    INT64 copyTimeP99;
+    INT64 loadToOpen;           // latest load, 0 until opened
+    INT64 openToFirstFrame;
+    UINT64 seekCount;           // seeks that reached their first frame
+    INT64 seekToFirstFrameAvg;
+    INT64 seekToFirstFrameMax;
+    INT64 seekToFirstFrameP99;
+    UINT64 eventCount;          // state events drained by script, see DrainEvents
+    INT64 eventLatencyAvg;
+    INT64 eventLatencyMax;
+    INT64 eventLatencyP99;
+    UINT64 itemChangeCount;     // playlist transitions, the gap is last frame of one item to first of the next
+    INT64 itemGapAvg;
+    INT64 itemGapMax;
+    INT64 itemGapP99;
+    UINT64 rebufferCount;       // stalls after the first frame that were not caused by a seek
+    INT64 rebufferTimeAvg;
+    INT64 rebufferTimeMax;
+} PLAYBACK_STATS;
+#pragma pack(pop)
+
+// LoadAdaptiveContent policy, zeros keep the source's own choice. Bitrates are
+// bits per second and snapped to the closest rung of the manifest's ladder.
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_ADAPTIVE_SETTINGS
+{
+    UINT32 initialBitrate;
+    UINT32 minBitrate;
+    UINT32 maxBitrate;
+    INT64 desiredLiveOffset;        // live streams, how far behind the edge playback starts, ie. the buffer
+    INT64 desiredSeekableWindow;    // live streams, how much of the past stays seekable. 1703
+    DOUBLE bitrateHeadroomRatio;    // share of the measured bandwidth left unused when switching up. 1703
+    DOUBLE downgradeTriggerRatio;   // buffer fill ratio that triggers a switch down. 1703
+} PLAYBACK_ADAPTIVE_SETTINGS;
+#pragma pack(pop)
+
+// see CAdaptiveCounters, durations in 100ns units
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_ADAPTIVE_STATS
+{
+    UINT32 bitrateCount;            // rungs in the ladder, 0 until the manifest is loaded
+    UINT32 playbackBitrate;
+    UINT32 downloadBitrate;
+    UINT32 inboundBitsPerSecond;    // measured bandwidth
+    UINT64 bitrateSwitches;
+    UINT64 segmentsDownloaded;
+    UINT64 bytesDownloaded;
+    UINT64 downloadFailures;
+    INT64 timeToFirstByteAvg;
+    INT64 timeToFirstByteP99;
+    INT64 downloadTimeAvg;
+    INT64 downloadTimeP99;
+} PLAYBACK_ADAPTIVE_STATS;
+#pragma pack(pop)
+
+// see CFrameCache
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_FRAME_CACHE_STATS
+{
+    INT64 budget;               // bytes, 0 turns the cache off
+    INT64 bytes;                // held by the slots' textures
+    UINT32 slots;
+    UINT32 frames;              // slots holding a frame
+    UINT64 hits;                // steps shown straight from the cache
+    UINT64 misses;              // steps that had to decode
+    UINT64 framesCached;
+    UINT64 evictions;
+} PLAYBACK_FRAME_CACHE_STATS;
+#pragma pack(pop)
+
+// see CReadAheadBuffer and CReadAheadCounters. Buffer sizes are summed over
+// the items still open, durations in 100ns units.
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_READ_AHEAD_STATS
+{
+    UINT32 buffers;             // items being read ahead
+    UINT32 reserved;
+    UINT64 window;
+    UINT64 bufferedAhead;       // read from the file, not yet by the demuxer
+    UINT64 bufferedBehind;
+    UINT64 bytesRead;
+    UINT64 bytesPrefetched;
+    UINT64 seeks;
+    UINT64 readErrors;
+    UINT64 underrunCount;       // reads that waited on the disk outside a seek
+    INT64 underrunTimeAvg;
+    INT64 underrunTimeMax;
+    UINT64 seekFillCount;       // reads that waited on the disk after a seek
+    INT64 seekFillTimeAvg;
+    INT64 seekFillTimeMax;
+} PLAYBACK_READ_AHEAD_STATS;
+#pragma pack(pop)
+
+// output textures kept after their player let go of them, shared by every player
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_TEXTURE_POOL_STATS
+{
+    UINT32 entries;             // output slots pooled
+    UINT32 reserved;
+    INT64 bytes;
+    INT64 budget;
+    UINT64 hits;                // slots CreatePlaybackTexture found pooled
+    UINT64 misses;              // slots it created
+    UINT64 evictions;
+} PLAYBACK_TEXTURE_POOL_STATS;
+#pragma pack(pop)
+
 extern "C" typedef void(UNITY_INTERFACE_API *StateChangedCallback)(
     _In_ PLAYBACK_STATE args);
 
@@ -61,7 +359,13 @@ extern "C" typedef void(UNITY_INTERFACE_API *PositionChangedCallback)(
 typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlayer*, IInspectable*> IMediaPlayerEventHandler;
 typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlayer*, ABI::Windows::Media::Playback::MediaPlayerFailedEventArgs*> IFailedEventHandler;
 typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlaybackSession*, IInspectable*> IMediaPlaybackSessionEventHandler;
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Playback::MediaPlaybackList*, ABI::Windows::Media::Playback::CurrentMediaPlaybackItemChangedEventArgs*> IItemChangedEventHandler;
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSource*, ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSourcePlaybackBitrateChangedEventArgs*> IPlaybackBitrateChangedEventHandler;
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSource*, ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSourceDownloadCompletedEventArgs*> IDownloadCompletedEventHandler;
+typedef ABI::Windows::Foundation::ITypedEventHandler<ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSource*, ABI::Windows::Media::Streaming::Adaptive::AdaptiveMediaSourceDownloadFailedEventArgs*> IDownloadFailedEventHandler;
 
+// the interface scripts built against the first release use, kept as it was.
+// Later additions are the interfaces below, reached with QueryInterface.
 DECLARE_INTERFACE_IID_(IMediaPlayerPlayback, IUnknown, "9669c78e-42c4-4178-a1e3-75b03d0f8c9a")
 {
     STDMETHOD(CreatePlaybackTexture)(_In_ UINT32 width, _In_ UINT32 height, _COM_Outptr_ void** ppvTexture) PURE;
@@ -76,24 +380,135 @@ DECLARE_INTERFACE_IID_(IMediaPlayerPlayback, IUnknown, "9669c78e-42c4-4178-a1e3-
 	STDMETHOD(SetPosition)(_In_ LONGLONG position) PURE;
 };
 
+// latched output, planar formats, readback and frame pacing
+DECLARE_INTERFACE_IID_(IMediaPlayerPlaybackOutput, IUnknown, "e66da6f0-170d-44dc-a021-c736d4418166")
+{
+    STDMETHOD(LatchFrame)() PURE;
+    STDMETHOD(GetPlaybackTexture)(_Outptr_result_maybenull_ void** ppvTexture) PURE;
+    STDMETHOD(CreatePlaybackTextureEx)(_In_ UINT32 width, _In_ UINT32 height, _In_ PlaybackOutputFormat format, _COM_Outptr_ void** ppvTexture, _COM_Outptr_opt_result_maybenull_ void** ppvChromaTexture) PURE;
+    STDMETHOD(GetPlaybackPlanes)(_Outptr_result_maybenull_ void** ppvTexture, _Outptr_result_maybenull_ void** ppvChromaTexture) PURE;
+    STDMETHOD(SetReadbackEnabled)(_In_ BOOL enabled) PURE;
+    STDMETHOD(AcquireReadbackFrame)(_Out_ PLAYBACK_READBACK_FRAME* pFrame) PURE;
+    STDMETHOD(ReleaseReadbackFrame)(_In_ UINT64 frameId) PURE;
+    STDMETHOD(SetPresentationClock)(_In_ INT64 clock) PURE;
+    STDMETHOD(GetPresentationStats)(_Out_ PLAYBACK_PRESENTATION_STATS* pStats) PURE;
+};
+
+// queued state events, status and counters
+DECLARE_INTERFACE_IID_(IMediaPlayerPlaybackEvents, IUnknown, "57889322-9a09-4fe0-b939-a70b476f8b2d")
+{
+    STDMETHOD(DrainEvents)(_Out_writes_to_(capacity, *pCount) PLAYBACK_STATE* pEvents, _In_ UINT32 capacity, _Out_ UINT32* pCount) PURE;
+    STDMETHOD(GetStatus)(_Out_ PLAYBACK_STATUS* pStatus) PURE;
+    STDMETHOD(GetPlaybackStats)(_Out_ PLAYBACK_STATS* pStats, _In_ BOOL reset) PURE;
+};
+
+DECLARE_INTERFACE_IID_(IMediaPlayerPlaylist, IUnknown, "acbd0db9-e02c-41c5-a6d8-01febf4aaee9")
+{
+    STDMETHOD(PlaylistAppend)(_In_ LPCWSTR pszContentLocation) PURE;
+    STDMETHOD(PlaylistInsert)(_In_ UINT32 index, _In_ LPCWSTR pszContentLocation) PURE;
+    STDMETHOD(PlaylistRemove)(_In_ UINT32 index) PURE;
+    STDMETHOD(PlaylistMoveTo)(_In_ UINT32 index) PURE;
+    STDMETHOD(SetPlaylistRepeat)(_In_ PlaylistRepeat repeat) PURE;
+    STDMETHOD(SetPlaylistPrefetchTime)(_In_ INT64 prefetchTime) PURE;
+};
+
+// HLS/DASH through AdaptiveMediaSource
+DECLARE_INTERFACE_IID_(IMediaPlayerAdaptive, IUnknown, "fa5f5f83-7c61-4789-9740-e6132b44a682")
+{
+    STDMETHOD(LoadAdaptiveContent)(_In_ LPCWSTR pszManifestLocation, _In_opt_ const PLAYBACK_ADAPTIVE_SETTINGS* pSettings) PURE;
+    STDMETHOD(GetAdaptiveStats)(_Out_ PLAYBACK_ADAPTIVE_STATS* pStats, _In_ BOOL reset) PURE;
+};
+
+// keyframe seeks and frame stepping
+DECLARE_INTERFACE_IID_(IMediaPlayerSeeking, IUnknown, "2175bddd-cbab-4a4a-8522-47e56812c322")
+{
+    STDMETHOD(SetSeekMode)(_In_ PlaybackSeekMode mode) PURE;
+    STDMETHOD(GetKeyframeTimes)(_Out_writes_to_opt_(capacity, *pCount) INT64* pTimes, _In_ UINT32 capacity, _Out_ UINT32* pCount) PURE;
+    STDMETHOD(StepFrames)(_In_ INT32 frames) PURE;
+    STDMETHOD(SetFrameCacheBudget)(_In_ INT64 budget) PURE;
+    STDMETHOD(GetFrameCacheStats)(_Out_ PLAYBACK_FRAME_CACHE_STATS* pStats, _In_ BOOL reset) PURE;
+};
+
+DECLARE_INTERFACE_IID_(IMediaPlayerThumbnails, IUnknown, "0a7c052a-1566-46d0-b92c-fdae87f1b037")
+{
+    STDMETHOD(GenerateThumbnails)(_In_ LPCWSTR pszContentLocation, _In_ UINT32 count, _In_ UINT32 width, _In_ UINT32 height) PURE;
+    STDMETHOD(GetThumbnails)(_Out_ PLAYBACK_THUMBNAILS* pInfo, _Out_writes_bytes_opt_(size) BYTE* pPixels, _In_ UINT32 size, _Out_writes_opt_(capacity) INT64* pTimes, _In_ UINT32 capacity) PURE;
+    STDMETHOD(CreateThumbnailTexture)(_Outptr_result_maybenull_ void** ppvTexture) PURE;
+};
+
+// read-ahead of local files and clips in bundles
+DECLARE_INTERFACE_IID_(IMediaPlayerSources, IUnknown, "1e825d15-d3b7-41e3-954f-a3b02fb53e87")
+{
+    STDMETHOD(SetReadAhead)(_In_ INT64 window, _In_ INT64 duration) PURE;
+    STDMETHOD(GetReadAheadStats)(_Out_ PLAYBACK_READ_AHEAD_STATS* pStats, _In_ BOOL reset) PURE;
+    STDMETHOD(LoadContentFromBundle)(_In_ LPCWSTR pszBundlePath, _In_ LPCWSTR pszName) PURE;
+};
+
+class CMediaPlayerPlayback;
+
+// One LoadAdaptiveContent. Creating the source is asynchronous and can finish
+// after the player moved on or was released, so the player cancels its request
+// instead of the request holding on to the player.
+class CAdaptiveSourceRequest
+    : public Microsoft::WRL::RuntimeClass
+    < Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>
+    , IAdaptiveMediaSourceCompletedCallback
+    , Microsoft::WRL::FtmBase>
+{
+public:
+    HRESULT RuntimeClassInitialize(
+        _In_ CMediaPlayerPlayback* pOwner,
+        _In_ const PLAYBACK_ADAPTIVE_SETTINGS& settings);
+
+    // waits for a completion in progress, nothing reaches the player after it returns
+    void Cancel();
+
+    // IAdaptiveMediaSourceCompletedCallback
+    IFACEMETHOD(OnAdaptiveMediaSourceCreated)(
+        _In_ ICreateAdaptiveMediaSourceOperation* pOp,
+        _In_ AsyncStatus status);
+
+private:
+    // recursive, a state callback run from the completion may stop the player
+    std::recursive_mutex m_lock;
+    CMediaPlayerPlayback* m_pOwner;
+    PLAYBACK_ADAPTIVE_SETTINGS m_settings;
+};
+
 class CMediaPlayerPlayback
     : public Microsoft::WRL::RuntimeClass
     < Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>
     , IMediaPlayerPlayback
+    , IMediaPlayerPlaybackOutput
+    , IMediaPlayerPlaybackEvents
+    , IMediaPlayerPlaylist
+    , IMediaPlayerAdaptive
+    , IMediaPlayerSeeking
+    , IMediaPlayerThumbnails
+    , IMediaPlayerSources
     , Microsoft::WRL::FtmBase>
 {
 public:
     static HRESULT CreateMediaPlayback(
         _In_ UnityGfxRenderer apiType, 
-        _In_ IUnityInterfaces* pUnityInterfaces, 
+        _In_opt_ IUnityInterfaces* pUnityInterfaces, 
+        _In_ PlaybackBackend backend,
         _In_ StateChangedCallback fnCallback,
         _COM_Outptr_ IMediaPlayerPlayback** ppMediaPlayback);
 
+    // slots no player uses are kept up to the budget, least recently released freed first
+    static HRESULT SetTexturePoolBudget(
+        _In_ INT64 budget);
+    static void ClearTexturePool();
+    static void GetTexturePoolStats(
+        _Out_ PLAYBACK_TEXTURE_POOL_STATS* pStats);
+
     CMediaPlayerPlayback();
     ~CMediaPlayerPlayback();
 
     HRESULT RuntimeClassInitialize(
         _In_ StateChangedCallback fnCallback,
+        _In_ PlaybackBackend backend,
         _In_ ID3D11Device* pDevice);
 
     // IMediaPlayerPlayback
@@ -113,6 +528,105 @@ public:
 	IFACEMETHOD(SetPlaybackRate(_In_ DOUBLE rate));
 	IFACEMETHOD(SetPosition(_In_ LONGLONG position));
 
+    // IMediaPlayerPlaybackOutput
+    IFACEMETHOD(LatchFrame)();
+    IFACEMETHOD(GetPlaybackTexture)(
+        _Outptr_result_maybenull_ void** ppvTexture);
+    IFACEMETHOD(CreatePlaybackTextureEx)(
+        _In_ UINT32 width,
+        _In_ UINT32 height,
+        _In_ PlaybackOutputFormat format,
+        _COM_Outptr_ void** ppvTexture,
+        _COM_Outptr_opt_result_maybenull_ void** ppvChromaTexture);
+    IFACEMETHOD(GetPlaybackPlanes)(
+        _Outptr_result_maybenull_ void** ppvTexture,
+        _Outptr_result_maybenull_ void** ppvChromaTexture);
+    IFACEMETHOD(SetReadbackEnabled)(
+        _In_ BOOL enabled);
+    IFACEMETHOD(AcquireReadbackFrame)(
+        _Out_ PLAYBACK_READBACK_FRAME* pFrame);
+    IFACEMETHOD(ReleaseReadbackFrame)(
+        _In_ UINT64 frameId);
+    IFACEMETHOD(SetPresentationClock)(
+        _In_ INT64 clock);
+    IFACEMETHOD(GetPresentationStats)(
+        _Out_ PLAYBACK_PRESENTATION_STATS* pStats);
+
+    // IMediaPlayerPlaybackEvents
+    IFACEMETHOD(DrainEvents)(
+        _Out_writes_to_(capacity, *pCount) PLAYBACK_STATE* pEvents,
+        _In_ UINT32 capacity,
+        _Out_ UINT32* pCount);
+    IFACEMETHOD(GetStatus)(
+        _Out_ PLAYBACK_STATUS* pStatus);
+    IFACEMETHOD(GetPlaybackStats)(
+        _Out_ PLAYBACK_STATS* pStats,
+        _In_ BOOL reset);
+
+    // IMediaPlayerPlaylist
+    IFACEMETHOD(PlaylistAppend)(
+        _In_ LPCWSTR pszContentLocation);
+    IFACEMETHOD(PlaylistInsert)(
+        _In_ UINT32 index,
+        _In_ LPCWSTR pszContentLocation);
+    IFACEMETHOD(PlaylistRemove)(
+        _In_ UINT32 index);
+    IFACEMETHOD(PlaylistMoveTo)(
+        _In_ UINT32 index);
+    IFACEMETHOD(SetPlaylistRepeat)(
+        _In_ PlaylistRepeat repeat);
+    IFACEMETHOD(SetPlaylistPrefetchTime)(
+        _In_ INT64 prefetchTime);
+
+    // IMediaPlayerAdaptive
+    IFACEMETHOD(LoadAdaptiveContent)(
+        _In_ LPCWSTR pszManifestLocation,
+        _In_opt_ const PLAYBACK_ADAPTIVE_SETTINGS* pSettings);
+    IFACEMETHOD(GetAdaptiveStats)(
+        _Out_ PLAYBACK_ADAPTIVE_STATS* pStats,
+        _In_ BOOL reset);
+
+    // IMediaPlayerSeeking
+    IFACEMETHOD(SetSeekMode)(
+        _In_ PlaybackSeekMode mode);
+    IFACEMETHOD(GetKeyframeTimes)(
+        _Out_writes_to_opt_(capacity, *pCount) INT64* pTimes,
+        _In_ UINT32 capacity,
+        _Out_ UINT32* pCount);
+    IFACEMETHOD(StepFrames)(
+        _In_ INT32 frames);
+    IFACEMETHOD(SetFrameCacheBudget)(
+        _In_ INT64 budget);
+    IFACEMETHOD(GetFrameCacheStats)(
+        _Out_ PLAYBACK_FRAME_CACHE_STATS* pStats,
+        _In_ BOOL reset);
+
+    // IMediaPlayerThumbnails
+    IFACEMETHOD(GenerateThumbnails)(
+        _In_ LPCWSTR pszContentLocation,
+        _In_ UINT32 count,
+        _In_ UINT32 width,
+        _In_ UINT32 height);
+    IFACEMETHOD(GetThumbnails)(
+        _Out_ PLAYBACK_THUMBNAILS* pInfo,
+        _Out_writes_bytes_opt_(size) BYTE* pPixels,
+        _In_ UINT32 size,
+        _Out_writes_opt_(capacity) INT64* pTimes,
+        _In_ UINT32 capacity);
+    IFACEMETHOD(CreateThumbnailTexture)(
+        _Outptr_result_maybenull_ void** ppvTexture);
+
+    // IMediaPlayerSources
+    IFACEMETHOD(SetReadAhead)(
+        _In_ INT64 window,
+        _In_ INT64 duration);
+    IFACEMETHOD(GetReadAheadStats)(
+        _Out_ PLAYBACK_READ_AHEAD_STATS* pStats,
+        _In_ BOOL reset);
+    IFACEMETHOD(LoadContentFromBundle)(
+        _In_ LPCWSTR pszBundlePath,
+        _In_ LPCWSTR pszName);
+
 protected:
     // Callbacks - IMediaPlayer2
     HRESULT OnOpened(
@@ -139,23 +653,195 @@ protected:
 		_In_ ABI::Windows::Media::Playback::IMediaPlaybackSession* sender,
 		_In_ IInspectable* args);
 
+    HRESULT OnNaturalVideoSizeChanged(
+        _In_ ABI::Windows::Media::Playback::IMediaPlaybackSession* sender,
+        _In_ IInspectable* args);
+
+    // Callbacks - IMediaPlaybackList
+    HRESULT OnItemChanged(
+        _In_ ABI::Windows::Media::Playback::IMediaPlaybackList* sender,
+        _In_ ABI::Windows::Media::Playback::ICurrentMediaPlaybackItemChangedEventArgs* args);
+
+    // Callbacks - IAdaptiveMediaSource
+    HRESULT OnPlaybackBitrateChanged(
+        _In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource* sender,
+        _In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourcePlaybackBitrateChangedEventArgs* args);
+    HRESULT OnDownloadCompleted(
+        _In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource* sender,
+        _In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadCompletedEventArgs* args);
+    HRESULT OnDownloadFailed(
+        _In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource* sender,
+        _In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSourceDownloadFailedEventArgs* args);
+
+private:
+    friend class CAdaptiveSourceRequest;
+
+    // m_events record, stamped so DrainEvents can measure how long script took to see it
+    struct QueuedState
+    {
+        PLAYBACK_STATE state;
+        INT64 queuedAt;
+    };
+
+    // one shared texture of the output ring, opened on both devices
+    struct OutputSlot
+    {
+        OutputSlot() : sharedHandle(INVALID_HANDLE_VALUE), syncKey(0) {}
+
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> textureSRV;   // bgra, or luma plane
+        Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> chromaSRV;    // chroma plane, planar formats only
+        Microsoft::WRL::ComPtr<IDXGIKeyedMutex> keyedMutex;
+
+        HANDLE sharedHandle;
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> mediaTexture;
+        Microsoft::WRL::ComPtr<IDXGIKeyedMutex> mediaKeyedMutex;
+        Microsoft::WRL::ComPtr<ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface> mediaSurface;
+
+        // key the mutex was last released with, the next owner acquires with it
+        UINT64 syncKey;
+    };
+
+    HRESULT CreateOutputSlot(_Inout_ OutputSlot* pSlot);
+    static void ReleaseOutputSlot(_Inout_ OutputSlot* pSlot);
+
+    // m_outputLock held, fills the ring from the texture pool for m_textureDesc
+    HRESULT AcquireOutputSlots();
+
+    // m_outputLock held, hands the first count slots to the texture pool
+    void PoolOutputSlots(_In_ UINT32 count);
+
+    // m_outputLock held, media foundation threads. Moves the output to the video's new size before
+    // a frame is written. False when there is nothing to post, the size is retried on the next frame.
+    bool FollowVideoSize(_Out_ PLAYBACK_STATE* pState);
+
+    // m_outputLock held by lock, returns once no decoder copy is in flight, see OnVideoFrameAvailable
+    void WaitForFrameWrite(_Inout_ std::unique_lock<std::mutex>& lock);
+
+    // m_outputLock held, the slots of the size before. Only the render thread may release
+    // the one unity's device holds, the other threads free it with the rest.
+    void ReleaseRetiredSlots(_In_ bool renderThread);
+
+    // CreateOutputSlot for the texture pool's misses
+    class COutputSlotAllocator;
+
+    // output slots of every player, keyed by the devices and texture description
+    static CTexturePool<OutputSlot> s_texturePool;
+
+    // a decoded frame kept for stepping, on the media device only
+    struct CacheSlot
+    {
+        Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+        Microsoft::WRL::ComPtr<ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface> surface;
+    };
+
+    // m_outputLock held
+    HRESULT CreateFrameCache();
+    void ReleaseFrameCache();
+    INT64 GetFrameCacheSlotSize() const;
+    HRESULT PresentCachedFrame(_In_ int slot, _In_ INT64 timestamp);
+
+    // render thread, m_outputLock held
+    OutputSlot* LatchOutputSlot(_Out_ INT64* pTimestamp);
+    int BeginScheduledLatch();
+    void UpdateReadback(_In_opt_ OutputSlot* pLatched, _In_ INT64 timestamp);
+    void ReleaseReadback();
+
 private:
     HRESULT CreateMediaPlayer();
     void ReleaseMediaPlayer();
 
-    HRESULT CreateTextures();
+    // replaces the output with slots made as desc, and hands back the views of the first
+    HRESULT CreateTextures(
+        _In_ PlaybackOutputFormat format,
+        _In_ const CD3D11_TEXTURE2D_DESC& desc,
+        _COM_Outptr_ ID3D11ShaderResourceView** ppTextureSRV,
+        _COM_Outptr_result_maybenull_ ID3D11ShaderResourceView** ppChromaSRV);
     void ReleaseTextures();
 
     HRESULT AddStateChanged();
     void RemoveStateChanged();
 
+    // preloaded item for the url if there is one, see PreloadCache.h
+    HRESULT CreatePlaybackItem(
+        _In_ LPCWSTR pszContentLocation,
+        _COM_Outptr_ ABI::Windows::Media::Playback::IMediaPlaybackItem** ppPlaybackItem);
+
+    // plays the item as a playlist of one, the rest of a load is the caller's
+    HRESULT LoadPlaybackItem(_In_ ABI::Windows::Media::Playback::IMediaPlaybackItem* pPlaybackItem);
+
+    // makes the list the player's source, with the repeat and prefetch settings applied
+    HRESULT SetPlaylist(_In_ ABI::Windows::Media::Playback::IMediaPlaybackList* pPlaybackList);
+    void ReleasePlaylist();
+    HRESULT ApplyPlaylistSettings();
+    void UpdatePlaylistStatus();
+
+    // drops the cached frames of the previous item or load
+    void ClearFrameCache();
+
+    // keyframe indexes of the playlist items, read on the thread pool as they are added
+    void IndexKeyframes(
+        _In_ ABI::Windows::Media::Playback::IMediaPlaybackItem* pItem,
+        _In_ LPCWSTR pszContentLocation);
+    void AddKeyframes(
+        _In_ ABI::Windows::Media::Playback::IMediaPlaybackItem* pItem,
+        _In_ const std::shared_ptr<CKeyframeIndex>& spKeyframes);
+    void RemoveKeyframes(_In_ ABI::Windows::Media::Playback::IMediaPlaybackItem* pItem);
+    void SetCurrentKeyframes(_In_opt_ ABI::Windows::Media::Playback::IMediaPlaybackItem* pItem);
+    void ReleaseKeyframes();
+    LONGLONG SnapToKeyframe(_In_ LONGLONG position);
+
+    // buffers of the items read ahead, a window in time is turned into bytes
+    // once the item's duration is known
+    void AddReadAhead(
+        _In_ ABI::Windows::Media::Playback::IMediaPlaybackItem* pItem,
+        _In_ const std::shared_ptr<CReadAheadBuffer>& spBuffer);
+    void SizeReadAhead(_In_opt_ ABI::Windows::Media::Playback::IMediaPlaybackItem* pItem);
+    UINT64 GetReadAheadWindow(_In_ UINT64 size, _In_ INT64 duration) const;
+
+    // called by CAdaptiveSourceRequest once the manifest is loaded, posts Failed if it can't play it
+    void OnAdaptiveSourceCreated(
+        _In_ ICreateAdaptiveMediaSourceOperation* pOp,
+        _In_ AsyncStatus status,
+        _In_ const PLAYBACK_ADAPTIVE_SETTINGS& settings);
+    HRESULT SetAdaptiveSource(
+        _In_ ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource* pAdaptiveSource,
+        _In_ const PLAYBACK_ADAPTIVE_SETTINGS& settings);
+    void ReleaseAdaptiveSource();
+
+    // cancels the request in progress, its progress no longer reaches PostState
+    void ReleaseThumbnails();
+
     void ReleaseResources();
 
+    void ResetPresentation();
+
+    // media foundation threads, calls the callback or queues for DrainEvents
+    void PostState(_In_ const PLAYBACK_STATE& state);
+
+    // media foundation threads, publishes the session's state, position, rate and buffered range
+    void UpdateSessionStatus(_In_ ABI::Windows::Media::Playback::IMediaPlaybackSession* pSession);
+
 private:
     Microsoft::WRL::ComPtr<ID3D11Device> m_d3dDevice;
     Microsoft::WRL::ComPtr<ID3D11Device> m_mediaDevice;
 
+    // the adapter's pooled device m_mediaDevice is, shared with the other players on it
+    std::shared_ptr<CMediaDevice> m_sharedMediaDevice;
+
+    // textures of players on the WARP device are never sampled by unity
+    PlaybackBackend m_backend;
+
+    // optional, without it events wait in m_events until script drains them
     StateChangedCallback m_fnStateCallback;
+    CEventQueue<QueuedState, PLAYBACK_EVENT_QUEUE_SIZE> m_events;
+
+    CSeqLock<PLAYBACK_STATUS> m_status;
+
+    // tells players apart in the trace, see Trace.h
+    UINT32 m_traceId;
+
+    CPlaybackCounters m_counters;
 
     Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlayer> m_mediaPlayer;
     EventRegistrationToken m_openedEventToken;
@@ -166,13 +852,94 @@ private:
     Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlaybackSession> m_mediaPlaybackSession;
 	EventRegistrationToken m_stateChangedEventToken;
 	EventRegistrationToken m_positionChangedEventToken;
+    EventRegistrationToken m_naturalVideoSizeChangedEventToken;
+
+    // width << 32 | height, as last reported by the session, see FollowVideoSize
+    std::atomic<UINT64> m_videoSize;
+
+    // every load is a playlist, so items can be added to it without switching sources
+    Microsoft::WRL::ComPtr<ABI::Windows::Media::Playback::IMediaPlaybackList> m_playlist;
+    EventRegistrationToken m_itemChangedEventToken;
+    PlaylistRepeat m_playlistRepeat;
+    INT64 m_playlistPrefetchTime;   // 100ns units, 0 leaves it to media foundation
 
+    // indexes by item identity, the current item changes on media foundation threads
+    std::mutex m_keyframeLock;
+    std::map<IUnknown*, std::shared_ptr<CKeyframeIndex>> m_itemKeyframes;
+    IUnknown* m_currentKeyframeItem;    // only compared, never dereferenced
+    std::shared_ptr<CKeyframeIndex> m_keyframes;
+    PlaybackSeekMode m_seekMode;
+
+    // LoadAdaptiveContent, the request while the manifest loads and the source after
+    Microsoft::WRL::ComPtr<CAdaptiveSourceRequest> m_adaptiveRequest;
+    std::mutex m_adaptiveLock;      // m_adaptiveSource, set from the completion thread
+    Microsoft::WRL::ComPtr<ABI::Windows::Media::Streaming::Adaptive::IAdaptiveMediaSource> m_adaptiveSource;
+    EventRegistrationToken m_bitrateChangedEventToken;
+    EventRegistrationToken m_downloadCompletedEventToken;
+    EventRegistrationToken m_downloadFailedEventToken;
+    CAdaptiveCounters m_adaptiveCounters;
+
+    // what the output slots are made as, only changed with m_outputLock held
     CD3D11_TEXTURE2D_DESC m_textureDesc;
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> m_primaryTexture;
-    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_primaryTextureSRV;
+    PlaybackOutputFormat m_outputFormat;
+
+    // guards the output slots, taken by the decoder thread and the render thread
+    std::mutex m_outputLock;
+    OutputSlot m_outputSlots[CFrameRing::MaxSlots];
+    UINT32 m_outputSlotCount;
+    TEXTURE_POOL_KEY m_outputKey;       // what the slots were made for, and go back to the pool as
+    INT64 m_outputSlotSize;
+    CFrameRing m_frameRing;
+    bool m_readingSlotAcquired;
+    INT64 m_frameTimestamp;             // last written to the ring, see CPresentationScheduler::OrderTimestamp
+
+    // the decoder copies into a claimed slot without the lock, slots are not
+    // released or recreated until the copy is published
+    bool m_frameWriting;
+    std::condition_variable m_frameWritten;
+
+    // the slot unity should sample, swapped by LatchFrame, and the slots of the
+    // previous size kept until script samples the resized ones
+    COutputResize<OutputSlot> m_outputResize;
+
+    // unity time of the frame being rendered (100ns), frames are paced against it once set
+    std::atomic<INT64> m_presentationClock;
+    std::atomic<bool> m_hasPresentationClock;
+    CPresentationScheduler m_scheduler;
+
+    // cpu readback of latched frames, staging textures are created and mapped on the render thread
+    std::atomic<bool> m_readbackEnabled;
+    std::unique_ptr<CStagingReadback> m_readback;
+    CReadbackRing m_readbackRing;
+
+    // StepFrames, under m_outputLock. Stepping to a cached frame copies it into
+    // the output ring without moving media foundation, Play catches it up.
+    CFrameCache m_frameCache;
+    std::vector<CacheSlot> m_cacheSlots;
+    INT64 m_frameCacheBudget;
+    INT64 m_displayedTime;          // frame last written to the output ring
+    INT64 m_stepTarget;
+    bool m_stepWalking;             // decoding forward frame by frame to m_stepTarget
+    bool m_stepResync;              // media foundation is not at m_displayedTime
+
+    // GenerateThumbnails, decoded apart from the player. Progress calls back
+    // from its workers, the generator is swapped out before it is cancelled.
+    std::mutex m_thumbnailLock;
+    std::shared_ptr<CThumbnailGenerator> m_thumbnails;
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_thumbnailSRV;
+
+    // SetReadAhead, local files are read ahead while either is set. The items
+    // are keyed by identity like the keyframes, the sources own the buffers.
+    struct ReadAheadItem
+    {
+        std::weak_ptr<CReadAheadBuffer> buffer;
+        INT64 duration;             // 0 until the item has opened
+    };
 
-    HANDLE m_primarySharedHandle;
-    Microsoft::WRL::ComPtr<ID3D11Texture2D> m_primaryMediaTexture;
-    Microsoft::WRL::ComPtr<ABI::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface> m_primaryMediaSurface;
+    std::mutex m_readAheadLock;
+    std::map<IUnknown*, ReadAheadItem> m_readAheadItems;
+    INT64 m_readAheadWindow;        // bytes
+    INT64 m_readAheadDuration;      // 100ns units, wins over bytes once the item's duration is known
+    std::shared_ptr<CReadAheadCounters> m_readAheadCounters;
 };
 
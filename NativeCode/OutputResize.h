@@ -0,0 +1,243 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include "FrameRing.h"
+#include "TexturePool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+// The bookkeeping of output slots that follow the video's size mid-stream. A
+// slot can be anything the owner makes, eg. a texture with its views; the
+// owner creates, pools and releases them, this decides when to resize and
+// which slots unity may still sample.
+//
+// A resize retires the slots of the previous size, unity keeps sampling the
+// current one until a slot of the new size is latched. Every resize starts a
+// generation: once script fetched a slot latched in the current one, draws
+// queued before were the last to sample the retired slots and they may go.
+// Until then a further size change waits. A resize that failed is tried
+// again at the next size.
+//
+// Only the current slot and the generations script reads are atomic, the
+// rest is called under the owner's lock.
+
+enum class OutputResizeAction : uint32_t
+{
+    OutputResizeAction_None = 0,    // nothing to report
+    OutputResizeAction_Report,      // the video changed size, the slots stay as they are
+    OutputResizeAction_Resize,      // the slots should follow, Retire them and Commit or Restore
+};
+
+template <typename T>
+class COutputResize
+{
+public:
+    static const int InvalidSlot = -1;
+
+    COutputResize()
+        : m_hasSlots(false)
+        , m_follow(false)
+        , m_outputSize(0)
+        , m_retiredCount(0)
+        , m_retiredHeldSlot(InvalidSlot)
+        , m_retiredKey()
+        , m_retiredSlotSize(0)
+        , m_generation(0)
+        , m_latchedGeneration(0)
+        , m_fetchedGeneration(0)
+        , m_pCurrent(nullptr)
+    {
+    }
+
+    // new slots made at outputSize, width << 32 | height, for a video of videoSize,
+    // 0 while it is not known yet. They follow it if they were made at its size.
+    void Reset(T* pCurrent, uint64_t videoSize, uint64_t outputSize)
+    {
+        m_hasSlots = true;
+        m_outputSize = videoSize;
+        m_follow = (videoSize == outputSize);
+        m_pCurrent.store(pCurrent);
+    }
+
+    // the slots are going, script fetches nothing from now on
+    void Clear()
+    {
+        m_hasSlots = false;
+        m_follow = false;
+        m_pCurrent.store(nullptr);
+    }
+
+    // what to do about the video's size, width << 32 | height. 4:2:0 slots need even dimensions.
+    OutputResizeAction OnVideoSize(uint64_t videoSize, bool evenOnly)
+    {
+        const uint32_t width = static_cast<uint32_t>(videoSize >> 32);
+        const uint32_t height = static_cast<uint32_t>(videoSize);
+
+        if (!m_hasSlots || videoSize == m_outputSize || 0 == width || 0 == height)
+        {
+            return OutputResizeAction::OutputResizeAction_None;
+        }
+
+        if (0 == m_outputSize)
+        {
+            // made before the video opened, its first size is no change
+            m_outputSize = videoSize;
+            return OutputResizeAction::OutputResizeAction_None;
+        }
+
+        if (m_follow && 0 != m_retiredCount)
+        {
+            // unity may still sample the size before last, frames are scaled into this one until it is retired
+            return OutputResizeAction::OutputResizeAction_None;
+        }
+
+        m_outputSize = videoSize;
+        if (!m_follow || (evenOnly && ((width & 1) || (height & 1))))
+        {
+            return OutputResizeAction::OutputResizeAction_Report;
+        }
+
+        return OutputResizeAction::OutputResizeAction_Resize;
+    }
+
+    // moves the slots out of the way of the resized ones, what they were made
+    // for goes along for the pool. heldSlot is the one unity's device holds.
+    void Retire(T* pSlots, uint32_t count, int heldSlot, const TEXTURE_POOL_KEY& key, int64_t slotSize)
+    {
+        T* pCurrent = m_pCurrent.load();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            m_retired[i] = std::move(pSlots[i]);
+            pSlots[i] = T();
+        }
+
+        m_retiredCount = count;
+        m_retiredHeldSlot = heldSlot;
+        m_retiredKey = key;
+        m_retiredSlotSize = slotSize;
+
+        if (pCurrent >= pSlots && pCurrent < pSlots + count)
+        {
+            m_pCurrent.store(&m_retired[pCurrent - pSlots]);
+        }
+    }
+
+    // the resized slots are in place, latches from now on are of the new generation
+    void Commit()
+    {
+        ++m_generation;
+    }
+
+    // the resized slots could not be made, the retired ones go back as they were
+    void Restore(T* pSlots, uint32_t* pCount, int* pHeldSlot, TEXTURE_POOL_KEY* pKey, int64_t* pSlotSize)
+    {
+        T* pCurrent = m_pCurrent.load();
+        for (uint32_t i = 0; i < m_retiredCount; ++i)
+        {
+            pSlots[i] = std::move(m_retired[i]);
+            m_retired[i] = T();
+        }
+
+        *pCount = m_retiredCount;
+        *pHeldSlot = m_retiredHeldSlot;
+        *pKey = m_retiredKey;
+        *pSlotSize = m_retiredSlotSize;
+
+        if (IsRetired(pCurrent))
+        {
+            m_pCurrent.store(pSlots + (pCurrent - m_retired));
+        }
+
+        m_retiredCount = 0;
+        m_retiredHeldSlot = InvalidSlot;
+    }
+
+    // render thread, the slot unity samples from now on
+    void Latch(T* pSlot)
+    {
+        m_pCurrent.store(pSlot);
+        m_latchedGeneration.store(m_generation);
+    }
+
+    // script, the slot to sample. The generation is read first, a slot latched
+    // after it is at worst counted as older.
+    T* Fetch()
+    {
+        const uint32_t generation = m_latchedGeneration.load();
+        T* pCurrent = m_pCurrent.load();
+        m_fetchedGeneration.store(generation);
+
+        return pCurrent;
+    }
+
+    uint32_t GetRetiredCount() const
+    {
+        return m_retiredCount;
+    }
+
+    // neverSampled for slots unity never draws with, eg. those of the WARP device
+    bool CanReleaseRetired(bool neverSampled) const
+    {
+        return 0 != m_retiredCount && (neverSampled || m_fetchedGeneration.load() == m_generation);
+    }
+
+    // hands every retired slot to release(slot, held, key, slotSize) and forgets
+    // them. Script fetches nothing rather than a released slot until the next latch.
+    template <typename F>
+    void ReleaseRetired(F release)
+    {
+        if (0 == m_retiredCount)
+        {
+            return;
+        }
+
+        if (IsRetired(m_pCurrent.load()))
+        {
+            m_pCurrent.store(nullptr);
+        }
+
+        for (uint32_t i = 0; i < m_retiredCount; ++i)
+        {
+            release(m_retired[i], static_cast<int>(i) == m_retiredHeldSlot, m_retiredKey, m_retiredSlotSize);
+            m_retired[i] = T();
+        }
+
+        m_retiredCount = 0;
+        m_retiredHeldSlot = InvalidSlot;
+    }
+
+private:
+    bool IsRetired(const T* pSlot) const
+    {
+        return pSlot >= m_retired && pSlot < m_retired + m_retiredCount;
+    }
+
+    // the slots are made at the video's size and resized with it
+    bool m_hasSlots;
+    bool m_follow;
+    uint64_t m_outputSize;          // video size last handled
+
+    T m_retired[CFrameRing::MaxSlots];
+    uint32_t m_retiredCount;
+    int m_retiredHeldSlot;
+    TEXTURE_POOL_KEY m_retiredKey;
+    int64_t m_retiredSlotSize;
+
+    uint32_t m_generation;
+    std::atomic<uint32_t> m_latchedGeneration;
+    std::atomic<uint32_t> m_fetchedGeneration;
+    std::atomic<T*> m_pCurrent;
+};
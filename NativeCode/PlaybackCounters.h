@@ -0,0 +1,524 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Reads a counter, zeroing it when the snapshot also resets. Each increment is
+// counted by exactly one snapshot, none is lost between the read and the reset.
+template <typename T>
+inline T TakeCounter(std::atomic<T>& counter, bool reset, T empty = 0)
+{
+    return reset ? counter.exchange(empty, std::memory_order_relaxed) : counter.load(std::memory_order_relaxed);
+}
+
+// Durations bucketed on a log scale with 4 steps per power of two, so any
+// percentile is within 25% of the true value. Lock free: Add is a handful of
+// relaxed atomic ops, Snapshot may see an Add half done, which is fine for stats.
+// A resetting snapshot takes every bucket, the count and the sum exactly once;
+// min and max of an Add racing it can land in either interval.
+class CLatencyHistogram
+{
+public:
+    typedef struct _SNAPSHOT
+    {
+        uint64_t count;
+        int64_t min;
+        int64_t max;
+        int64_t mean;
+        int64_t p99;
+    } SNAPSHOT;
+
+    CLatencyHistogram()
+    {
+        Reset();
+    }
+
+    void Reset()
+    {
+        for (uint32_t i = 0; i < BucketCount; ++i)
+        {
+            m_buckets[i].store(0, std::memory_order_relaxed);
+        }
+        m_count.store(0, std::memory_order_relaxed);
+        m_sum.store(0, std::memory_order_relaxed);
+        m_min.store(INT64_MAX, std::memory_order_relaxed);
+        m_max.store(0, std::memory_order_relaxed);
+    }
+
+    void Add(int64_t value)
+    {
+        if (value < 0)
+        {
+            value = 0;
+        }
+
+        m_buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+
+        int64_t current = m_min.load(std::memory_order_relaxed);
+        while (value < current && !m_min.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+
+        current = m_max.load(std::memory_order_relaxed);
+        while (value > current && !m_max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void Snapshot(SNAPSHOT* pSnapshot, bool reset)
+    {
+        uint64_t counts[BucketCount];
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < BucketCount; ++i)
+        {
+            counts[i] = TakeCounter(m_buckets[i], reset);
+            total += counts[i];
+        }
+
+        const int64_t sum = TakeCounter(m_sum, reset);
+        const int64_t min = TakeCounter(m_min, reset, INT64_MAX);
+
+        pSnapshot->count = TakeCounter(m_count, reset);
+        pSnapshot->max = TakeCounter(m_max, reset);
+        pSnapshot->min = (0 == pSnapshot->count || INT64_MAX == min) ? 0 : min;
+        pSnapshot->mean = (0 == pSnapshot->count) ? 0 : sum / static_cast<int64_t>(pSnapshot->count);
+        pSnapshot->p99 = 0;
+
+        // smallest bucket with at least 99% of the samples at or below it, reported as its upper bound
+        uint64_t rank = total - total / 100;
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < BucketCount && 0 != total; ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank)
+            {
+                int64_t upper = UpperBoundOf(i);
+                pSnapshot->p99 = (upper < pSnapshot->max) ? upper : pSnapshot->max;
+                break;
+            }
+        }
+    }
+
+private:
+    static const uint32_t SubBuckets = 4;
+    static const uint32_t BucketCount = 64 * SubBuckets;
+
+    // 0..3 are exact, after that the top three bits pick the bucket
+    static uint32_t BucketOf(int64_t value)
+    {
+        uint64_t v = static_cast<uint64_t>(value);
+        if (v < SubBuckets)
+        {
+            return static_cast<uint32_t>(v);
+        }
+
+        uint32_t msb = 63;
+        while (0 == (v >> msb))
+        {
+            --msb;
+        }
+
+        uint32_t sub = static_cast<uint32_t>(v >> (msb - 2)) & (SubBuckets - 1);
+        return (msb - 1) * SubBuckets + sub;
+    }
+
+    static int64_t UpperBoundOf(uint32_t bucket)
+    {
+        if (bucket < SubBuckets)
+        {
+            return bucket;
+        }
+
+        uint32_t msb = bucket / SubBuckets + 1;
+        uint64_t sub = bucket % SubBuckets;
+        uint64_t lower = (static_cast<uint64_t>(SubBuckets) | sub) << (msb - 2);
+        uint64_t upper = lower + (1ull << (msb - 2)) - 1;
+
+        return (upper > static_cast<uint64_t>(INT64_MAX)) ? INT64_MAX : static_cast<int64_t>(upper);
+    }
+
+private:
+    std::atomic<uint64_t> m_buckets[BucketCount];
+    std::atomic<uint64_t> m_count;
+    std::atomic<int64_t> m_sum;
+    std::atomic<int64_t> m_min;
+    std::atomic<int64_t> m_max;
+};
+
+// Hot path counters of one player. Every method is lock free and callable
+// from any thread; times are steady clock, reported in 100ns units.
+class CPlaybackCounters
+{
+public:
+    typedef struct _SNAPSHOT
+    {
+        int64_t interval;               // since creation or the last reset
+        uint64_t framesAvailable;       // VideoFrameAvailable events
+        uint64_t framesCopied;
+        uint64_t framesDropped;         // no free output slot, or its keyed mutex timed out
+        uint64_t copyFailures;
+        CLatencyHistogram::SNAPSHOT copyTime;
+        int64_t loadToOpen;             // latest, 0 until measured
+        int64_t openToFirstFrame;
+        CLatencyHistogram::SNAPSHOT seekToFirstFrame;
+        CLatencyHistogram::SNAPSHOT eventLatency;   // state event queued until script drained it
+        CLatencyHistogram::SNAPSHOT itemGap;        // last frame of a playlist item to the first of the next
+        CLatencyHistogram::SNAPSHOT rebuffer;       // stalls after the first frame that no seek asked for
+    } SNAPSHOT;
+
+    CPlaybackCounters()
+        : m_loadStart(0)
+        , m_openTime(0)
+        , m_seekStart(0)
+        , m_itemChangeStart(0)
+        , m_lastFrameTime(0)
+        , m_bufferingStart(0)
+    {
+        Reset();
+    }
+
+    static int64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::duration<int64_t, std::ratio<1, 10000000>>>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // counters and histograms only, a load or seek in flight is still measured
+    void Reset()
+    {
+        m_resetTime.store(Now(), std::memory_order_relaxed);
+        m_framesAvailable.store(0, std::memory_order_relaxed);
+        m_framesCopied.store(0, std::memory_order_relaxed);
+        m_framesDropped.store(0, std::memory_order_relaxed);
+        m_copyFailures.store(0, std::memory_order_relaxed);
+        m_copyTime.Reset();
+        m_loadToOpen.store(0, std::memory_order_relaxed);
+        m_openToFirstFrame.store(0, std::memory_order_relaxed);
+        m_seekToFirstFrame.Reset();
+        m_eventLatency.Reset();
+        m_itemGap.Reset();
+        m_rebuffer.Reset();
+    }
+
+    // reset starts the next interval in the same pass, see TakeCounter
+    void Snapshot(SNAPSHOT* pSnapshot, bool reset)
+    {
+        const int64_t now = Now();
+        pSnapshot->interval = now - TakeCounter(m_resetTime, reset, now);
+        pSnapshot->framesAvailable = TakeCounter(m_framesAvailable, reset);
+        pSnapshot->framesCopied = TakeCounter(m_framesCopied, reset);
+        pSnapshot->framesDropped = TakeCounter(m_framesDropped, reset);
+        pSnapshot->copyFailures = TakeCounter(m_copyFailures, reset);
+        m_copyTime.Snapshot(&pSnapshot->copyTime, reset);
+        pSnapshot->loadToOpen = TakeCounter(m_loadToOpen, reset);
+        pSnapshot->openToFirstFrame = TakeCounter(m_openToFirstFrame, reset);
+        m_seekToFirstFrame.Snapshot(&pSnapshot->seekToFirstFrame, reset);
+        m_eventLatency.Snapshot(&pSnapshot->eventLatency, reset);
+        m_itemGap.Snapshot(&pSnapshot->itemGap, reset);
+        m_rebuffer.Snapshot(&pSnapshot->rebuffer, reset);
+    }
+
+    void OnLoad()
+    {
+        m_openTime.store(0, std::memory_order_relaxed);
+        m_seekStart.store(0, std::memory_order_relaxed);
+        m_itemChangeStart.store(0, std::memory_order_relaxed);
+        m_lastFrameTime.store(0, std::memory_order_relaxed);
+        m_bufferingStart.store(0, std::memory_order_relaxed);
+        m_loadStart.store(Now(), std::memory_order_relaxed);
+    }
+
+    void OnOpened()
+    {
+        int64_t now = Now();
+        int64_t loadStart = m_loadStart.exchange(0, std::memory_order_relaxed);
+        if (0 != loadStart)
+        {
+            m_loadToOpen.store(now - loadStart, std::memory_order_relaxed);
+        }
+
+        m_openTime.store(now, std::memory_order_relaxed);
+    }
+
+    void OnSeek()
+    {
+        m_seekStart.store(Now(), std::memory_order_relaxed);
+    }
+
+    // a playlist moved on, the gap runs from the old item's last frame
+    void OnItemChanged()
+    {
+        int64_t lastFrame = m_lastFrameTime.load(std::memory_order_relaxed);
+        m_itemChangeStart.store(0 != lastFrame ? lastFrame : Now(), std::memory_order_relaxed);
+    }
+
+    // the session went into or out of buffering. Buffering before the first
+    // frame or while a seek is landing is expected, only the rest are stalls
+    void OnBuffering(bool buffering)
+    {
+        if (buffering)
+        {
+            if (0 != m_lastFrameTime.load(std::memory_order_relaxed)
+                && 0 == m_seekStart.load(std::memory_order_relaxed))
+            {
+                int64_t expected = 0;
+                m_bufferingStart.compare_exchange_strong(expected, Now(), std::memory_order_relaxed);
+            }
+            return;
+        }
+
+        int64_t bufferingStart = m_bufferingStart.exchange(0, std::memory_order_relaxed);
+        if (0 != bufferingStart)
+        {
+            m_rebuffer.Add(Now() - bufferingStart);
+        }
+    }
+
+    // queuedAt is the Now() taken when the event was queued
+    void OnEventDelivered(int64_t queuedAt)
+    {
+        m_eventLatency.Add(Now() - queuedAt);
+    }
+
+    void OnFrameAvailable()
+    {
+        m_framesAvailable.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void OnFrameDropped()
+    {
+        m_framesDropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // start is the Now() taken before the copy was issued
+    void OnFrameCopied(int64_t start, bool succeeded)
+    {
+        int64_t now = Now();
+
+        if (!succeeded)
+        {
+            m_copyFailures.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        m_framesCopied.fetch_add(1, std::memory_order_relaxed);
+        m_copyTime.Add(now - start);
+
+        // the exchanges make sure only the first frame after an open or seek is measured
+        int64_t openTime = m_openTime.exchange(0, std::memory_order_relaxed);
+        if (0 != openTime)
+        {
+            m_openToFirstFrame.store(now - openTime, std::memory_order_relaxed);
+        }
+
+        int64_t seekStart = m_seekStart.exchange(0, std::memory_order_relaxed);
+        if (0 != seekStart)
+        {
+            m_seekToFirstFrame.Add(now - seekStart);
+        }
+
+        int64_t itemChangeStart = m_itemChangeStart.exchange(0, std::memory_order_relaxed);
+        if (0 != itemChangeStart)
+        {
+            m_itemGap.Add(now - itemChangeStart);
+        }
+
+        m_lastFrameTime.store(now, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> m_resetTime;
+
+    std::atomic<uint64_t> m_framesAvailable;
+    std::atomic<uint64_t> m_framesCopied;
+    std::atomic<uint64_t> m_framesDropped;
+    std::atomic<uint64_t> m_copyFailures;
+    CLatencyHistogram m_copyTime;
+
+    // start of the load / open / seek whose first frame has not arrived, 0 if none
+    std::atomic<int64_t> m_loadStart;
+    std::atomic<int64_t> m_openTime;
+    std::atomic<int64_t> m_seekStart;
+    std::atomic<int64_t> m_itemChangeStart;
+    std::atomic<int64_t> m_lastFrameTime;
+    std::atomic<int64_t> m_bufferingStart;
+
+    std::atomic<int64_t> m_loadToOpen;
+    std::atomic<int64_t> m_openToFirstFrame;
+    CLatencyHistogram m_seekToFirstFrame;
+    CLatencyHistogram m_eventLatency;
+    CLatencyHistogram m_itemGap;
+    CLatencyHistogram m_rebuffer;
+};
+
+// Download side of an adaptive (HLS / DASH) stream, same rules as above.
+class CAdaptiveCounters
+{
+public:
+    typedef struct _SNAPSHOT
+    {
+        uint64_t bitrateSwitches;       // playback bitrate changes, the download side switches first
+        uint64_t segmentsDownloaded;
+        uint64_t bytesDownloaded;       // media segments only
+        uint64_t downloadFailures;      // any resource, manifests included
+        CLatencyHistogram::SNAPSHOT timeToFirstByte;
+        CLatencyHistogram::SNAPSHOT downloadTime;   // request to last byte
+    } SNAPSHOT;
+
+    CAdaptiveCounters()
+    {
+        Reset();
+    }
+
+    void Reset()
+    {
+        m_bitrateSwitches.store(0, std::memory_order_relaxed);
+        m_segmentsDownloaded.store(0, std::memory_order_relaxed);
+        m_bytesDownloaded.store(0, std::memory_order_relaxed);
+        m_downloadFailures.store(0, std::memory_order_relaxed);
+        m_timeToFirstByte.Reset();
+        m_downloadTime.Reset();
+    }
+
+    void Snapshot(SNAPSHOT* pSnapshot, bool reset)
+    {
+        pSnapshot->bitrateSwitches = TakeCounter(m_bitrateSwitches, reset);
+        pSnapshot->segmentsDownloaded = TakeCounter(m_segmentsDownloaded, reset);
+        pSnapshot->bytesDownloaded = TakeCounter(m_bytesDownloaded, reset);
+        pSnapshot->downloadFailures = TakeCounter(m_downloadFailures, reset);
+        m_timeToFirstByte.Snapshot(&pSnapshot->timeToFirstByte, reset);
+        m_downloadTime.Snapshot(&pSnapshot->downloadTime, reset);
+    }
+
+    void OnBitrateChanged()
+    {
+        m_bitrateSwitches.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // times are relative to the request, negative when the source did not report them
+    void OnSegmentDownloaded(uint64_t bytes, int64_t timeToFirstByte, int64_t downloadTime)
+    {
+        m_segmentsDownloaded.fetch_add(1, std::memory_order_relaxed);
+        m_bytesDownloaded.fetch_add(bytes, std::memory_order_relaxed);
+
+        if (timeToFirstByte >= 0)
+        {
+            m_timeToFirstByte.Add(timeToFirstByte);
+        }
+
+        if (downloadTime >= 0)
+        {
+            m_downloadTime.Add(downloadTime);
+        }
+    }
+
+    void OnDownloadFailed()
+    {
+        m_downloadFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> m_bitrateSwitches;
+    std::atomic<uint64_t> m_segmentsDownloaded;
+    std::atomic<uint64_t> m_bytesDownloaded;
+    std::atomic<uint64_t> m_downloadFailures;
+    CLatencyHistogram m_timeToFirstByte;
+    CLatencyHistogram m_downloadTime;
+};
+
+// Read ahead of one player's local files, see CReadAheadBuffer. Shared by the
+// buffers of every item it opens, so the counts outlive the items.
+class CReadAheadCounters
+{
+public:
+    typedef struct _SNAPSHOT
+    {
+        uint64_t bytesRead;             // handed to media foundation
+        uint64_t bytesPrefetched;       // read from the file by the prefetch threads
+        uint64_t seeks;                 // reads outside the buffered range, refilled from there
+        uint64_t readErrors;
+        CLatencyHistogram::SNAPSHOT underrun;   // waits for data the window should have held
+        CLatencyHistogram::SNAPSHOT seekFill;   // waits for the first data after a seek
+    } SNAPSHOT;
+
+    CReadAheadCounters()
+    {
+        Reset();
+    }
+
+    void Reset()
+    {
+        m_bytesRead.store(0, std::memory_order_relaxed);
+        m_bytesPrefetched.store(0, std::memory_order_relaxed);
+        m_seeks.store(0, std::memory_order_relaxed);
+        m_readErrors.store(0, std::memory_order_relaxed);
+        m_underrun.Reset();
+        m_seekFill.Reset();
+    }
+
+    void Snapshot(SNAPSHOT* pSnapshot, bool reset)
+    {
+        pSnapshot->bytesRead = TakeCounter(m_bytesRead, reset);
+        pSnapshot->bytesPrefetched = TakeCounter(m_bytesPrefetched, reset);
+        pSnapshot->seeks = TakeCounter(m_seeks, reset);
+        pSnapshot->readErrors = TakeCounter(m_readErrors, reset);
+        m_underrun.Snapshot(&pSnapshot->underrun, reset);
+        m_seekFill.Snapshot(&pSnapshot->seekFill, reset);
+    }
+
+    void OnRead(uint64_t bytes)
+    {
+        m_bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void OnPrefetched(uint64_t bytes)
+    {
+        m_bytesPrefetched.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void OnSeek()
+    {
+        m_seeks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void OnReadError()
+    {
+        m_readErrors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // wait is in 100ns units
+    void OnWait(int64_t wait, bool afterSeek)
+    {
+        if (afterSeek)
+        {
+            m_seekFill.Add(wait);
+        }
+        else
+        {
+            m_underrun.Add(wait);
+        }
+    }
+
+private:
+    std::atomic<uint64_t> m_bytesRead;
+    std::atomic<uint64_t> m_bytesPrefetched;
+    std::atomic<uint64_t> m_seeks;
+    std::atomic<uint64_t> m_readErrors;
+    CLatencyHistogram m_underrun;
+    CLatencyHistogram m_seekFill;
+};
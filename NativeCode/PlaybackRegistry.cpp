@@ -0,0 +1,167 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "PlaybackRegistry.h"
+#include "HandleTable.h"
+
+using namespace Microsoft::WRL;
+
+static CHandleTable<ComPtr<IMediaPlayerPlayback>> s_playbackTable;
+
+_Use_decl_annotations_
+HRESULT RegisterPlayback(
+    IMediaPlayerPlayback* pMediaPlayback,
+    HPLAYBACK* phPlayback)
+{
+    NULL_CHK(pMediaPlayback);
+    NULL_CHK(phPlayback);
+
+    *phPlayback = HPLAYBACK_INVALID;
+
+    UINT32 handle = HPLAYBACK_INVALID;
+    if (!s_playbackTable.Insert(ComPtr<IMediaPlayerPlayback>(pMediaPlayback), &handle))
+    {
+        IFR(E_OUTOFMEMORY);
+    }
+
+    *phPlayback = handle;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT UnregisterPlayback(
+    HPLAYBACK hPlayback)
+{
+    // the last reference is released here, outside of the table lock
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    if (!s_playbackTable.Remove(hPlayback, &spMediaPlayback))
+    {
+        return E_HANDLE;
+    }
+
+    spMediaPlayback.Reset();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT LookupPlayback(
+    HPLAYBACK hPlayback,
+    IMediaPlayerPlayback** ppMediaPlayback)
+{
+    NULL_CHK(ppMediaPlayback);
+
+    *ppMediaPlayback = nullptr;
+
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    if (!s_playbackTable.Lookup(hPlayback, &spMediaPlayback) || nullptr == spMediaPlayback)
+    {
+        return E_HANDLE;
+    }
+
+    *ppMediaPlayback = spMediaPlayback.Detach();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT LookupPlayback(
+    HPLAYBACK hPlayback,
+    REFIID riid,
+    void** ppv)
+{
+    NULL_CHK(ppv);
+
+    *ppv = nullptr;
+
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(LookupPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->QueryInterface(riid, ppv);
+}
+
+_Use_decl_annotations_
+HRESULT MakeRenderEventId(
+    HPLAYBACK hPlayback,
+    PlaybackRenderOp op,
+    INT32* pEventId)
+{
+    NULL_CHK(pEventId);
+
+    *pEventId = 0;
+
+    if (op >= PlaybackRenderOp::PlaybackRenderOp_Max)
+        IFR(E_INVALIDARG);
+
+    if (!s_playbackTable.Lookup(hPlayback, nullptr))
+    {
+        return E_HANDLE;
+    }
+
+    *pEventId = static_cast<INT32>((static_cast<UINT32>(op) << PLAYBACK_RENDER_OP_SHIFT) | (hPlayback & PLAYBACK_RENDER_HANDLE_MASK));
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void ParseRenderEventId(
+    INT32 eventId,
+    PlaybackRenderOp* pOp,
+    UINT32* pHandleBits)
+{
+    UINT32 bits = static_cast<UINT32>(eventId);
+
+    *pOp = static_cast<PlaybackRenderOp>((bits >> PLAYBACK_RENDER_OP_SHIFT) & PLAYBACK_RENDER_OP_MASK);
+    *pHandleBits = bits & PLAYBACK_RENDER_HANDLE_MASK;
+}
+
+_Use_decl_annotations_
+HRESULT LookupRenderEventPlayback(
+    UINT32 handleBits,
+    IMediaPlayerPlayback** ppMediaPlayback)
+{
+    NULL_CHK(ppMediaPlayback);
+
+    *ppMediaPlayback = nullptr;
+
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    if (!s_playbackTable.LookupMasked(handleBits, PLAYBACK_RENDER_HANDLE_MASK, &spMediaPlayback, nullptr) || nullptr == spMediaPlayback)
+    {
+        return E_HANDLE;
+    }
+
+    *ppMediaPlayback = spMediaPlayback.Detach();
+
+    return S_OK;
+}
+
+UINT32 GetPlaybackCount()
+{
+    return s_playbackTable.Count();
+}
+
+_Use_decl_annotations_
+void ForEachPlayback(
+    void(*fn)(HPLAYBACK hPlayback, IMediaPlayerPlayback* pMediaPlayback, void* pContext),
+    void* pContext)
+{
+    if (nullptr == fn)
+    {
+        return;
+    }
+
+    s_playbackTable.ForEach([fn, pContext](UINT32 handle, const ComPtr<IMediaPlayerPlayback>& spMediaPlayback)
+    {
+        fn(handle, spMediaPlayback.Get(), pContext);
+    });
+}
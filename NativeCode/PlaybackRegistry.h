@@ -0,0 +1,73 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "MediaPlayerPlayback.h"
+
+// opaque handle handed to script, see HandleTable.h for the layout
+typedef UINT32 HPLAYBACK;
+
+#define HPLAYBACK_INVALID 0
+
+HRESULT RegisterPlayback(
+    _In_ IMediaPlayerPlayback* pMediaPlayback,
+    _Out_ HPLAYBACK* phPlayback);
+
+HRESULT UnregisterPlayback(
+    _In_ HPLAYBACK hPlayback);
+
+HRESULT LookupPlayback(
+    _In_ HPLAYBACK hPlayback,
+    _COM_Outptr_ IMediaPlayerPlayback** ppMediaPlayback);
+
+// as above, queried for one of the other player interfaces
+HRESULT LookupPlayback(
+    _In_ HPLAYBACK hPlayback,
+    _In_ REFIID riid,
+    _COM_Outptr_ void** ppv);
+
+UINT32 GetPlaybackCount();
+
+// calls fn for every registered playback, the registry lock is not held during the call
+void ForEachPlayback(
+    _In_ void(*fn)(_In_ HPLAYBACK hPlayback, _In_ IMediaPlayerPlayback* pMediaPlayback, _In_opt_ void* pContext),
+    _In_opt_ void* pContext);
+
+// Unity render event ids, passed from script to GL.IssuePluginEvent:
+//     bits  0..27 - the low 28 bits of the player handle
+//     bits 28..30 - PlaybackRenderOp
+// Ids stay positive, and the id 1 older scripts issue is PlaybackRenderOp_LatchAll.
+enum class PlaybackRenderOp : UINT32
+{
+    PlaybackRenderOp_LatchAll = 0,  // every player, handle bits are ignored
+    PlaybackRenderOp_Latch,         // one player
+    PlaybackRenderOp_Max,
+};
+
+#define PLAYBACK_RENDER_HANDLE_MASK 0x0FFFFFFF
+#define PLAYBACK_RENDER_OP_SHIFT 28
+#define PLAYBACK_RENDER_OP_MASK 0x7
+
+HRESULT MakeRenderEventId(
+    _In_ HPLAYBACK hPlayback,
+    _In_ PlaybackRenderOp op,
+    _Out_ INT32* pEventId);
+
+void ParseRenderEventId(
+    _In_ INT32 eventId,
+    _Out_ PlaybackRenderOp* pOp,
+    _Out_ UINT32* pHandleBits);
+
+// resolves the handle bits of a render event id to a live player
+HRESULT LookupRenderEventPlayback(
+    _In_ UINT32 handleBits,
+    _COM_Outptr_ IMediaPlayerPlayback** ppMediaPlayback);
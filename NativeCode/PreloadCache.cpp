@@ -0,0 +1,180 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "PreloadCache.h"
+
+#include <string>
+
+using namespace Microsoft::WRL;
+using namespace ABI::Windows::Foundation;
+using namespace ABI::Windows::Media::Core;
+using namespace ABI::Windows::Media::MediaProperties;
+using namespace ABI::Windows::Media::Playback;
+
+// evicted items are released by the caller, outside of the cache lock
+static CPreloadLru<ComPtr<IMediaPlaybackItem>> s_preloads(PLAYBACK_PRELOAD_CAPACITY, PLAYBACK_PRELOAD_MAX_ENTRIES);
+
+// the first video track's bitrate once the source has opened and knows its tracks, 0 if unknown
+static UINT32 GetPreloadBitrate(
+    _In_ IMediaPlaybackItem* pPlaybackItem)
+{
+    ComPtr<Collections::IVectorView<VideoTrack*>> spVideoTracks;
+    UINT32 trackCount = 0;
+    if (FAILED(pPlaybackItem->get_VideoTracks(&spVideoTracks)) || FAILED(spVideoTracks->get_Size(&trackCount)) || 0 == trackCount)
+    {
+        return 0;
+    }
+
+    ComPtr<IMediaTrack> spMediaTrack;
+    ComPtr<IVideoTrack> spVideoTrack;
+    ComPtr<IVideoEncodingProperties> spProperties;
+    UINT32 bitrate = 0;
+    if (SUCCEEDED(spVideoTracks->GetAt(0, &spMediaTrack))
+        && SUCCEEDED(spMediaTrack.As(&spVideoTrack))
+        && SUCCEEDED(spVideoTrack->GetEncodingProperties(&spProperties))
+        && SUCCEEDED(spProperties->get_Bitrate(&bitrate)))
+    {
+        return bitrate;
+    }
+
+    return 0;
+}
+
+_Use_decl_annotations_
+HRESULT StartPreload(
+    LPCWSTR pszContentLocation)
+{
+    NULL_CHK(pszContentLocation);
+
+    std::wstring url(pszContentLocation);
+    if (s_preloads.Touch(url))
+    {
+        return S_FALSE;
+    }
+
+    ComPtr<IMediaSource2> spMediaSource2;
+    IFR(CreateMediaSource(pszContentLocation, &spMediaSource2));
+
+    ComPtr<IMediaPlaybackItem> spPlaybackItem;
+    IFR(CreateMediaPlaybackItem(spMediaSource2.Get(), &spPlaybackItem));
+
+    std::vector<ComPtr<IMediaPlaybackItem>> evicted;
+    UINT64 id = s_preloads.Insert(url, spPlaybackItem, &evicted);
+    if (0 == id)
+    {
+        // capacity is below a single source
+        return S_FALSE;
+    }
+
+#if defined(NTDDI_WIN10_RS2)
+    // open now, so LoadContent gets a source that has its headers parsed and
+    // its first reads done. Without OpenAsync the item still opens on put_Source.
+    ComPtr<IMediaSource4> spMediaSource4;
+    if (SUCCEEDED(spMediaSource2.As(&spMediaSource4)))
+    {
+        ComPtr<IAsyncAction> spOpenAction;
+        HRESULT hr = spMediaSource4->OpenAsync(&spOpenAction);
+        if (SUCCEEDED(hr))
+        {
+            // the handler looks the item up by id, holding it would keep evicted items alive
+            auto openedHandler = Callback<IAsyncActionCompletedHandler>(
+                [id](_In_ IAsyncAction* pAction, _In_ AsyncStatus status) -> HRESULT
+            {
+                UNREFERENCED_PARAMETER(pAction);
+
+                std::vector<ComPtr<IMediaPlaybackItem>> released;
+                ComPtr<IMediaPlaybackItem> spItem;
+                if (AsyncStatus::Completed != status)
+                {
+                    s_preloads.OnOpenFailed(id, &spItem);
+                }
+                else if (s_preloads.Find(id, &spItem))
+                {
+                    s_preloads.OnOpened(id, GetPreloadBitrate(spItem.Get()), &released);
+                }
+
+                return S_OK;
+            });
+
+            hr = spOpenAction->put_Completed(openedHandler.Get());
+        }
+
+        if (FAILED(hr))
+        {
+            ComPtr<IMediaPlaybackItem> spItem;
+            s_preloads.Remove(id, &spItem);
+            IFR(hr);
+        }
+    }
+#endif
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT TakePreloadedItem(
+    LPCWSTR pszContentLocation,
+    IMediaPlaybackItem** ppPlaybackItem)
+{
+    NULL_CHK(pszContentLocation);
+    NULL_CHK(ppPlaybackItem);
+
+    *ppPlaybackItem = nullptr;
+
+    ComPtr<IMediaPlaybackItem> spPlaybackItem;
+    if (!s_preloads.Take(std::wstring(pszContentLocation), &spPlaybackItem))
+    {
+        return S_FALSE;
+    }
+
+    *ppPlaybackItem = spPlaybackItem.Detach();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT SetPreloadLimits(
+    INT64 capacity,
+    UINT32 maxEntries)
+{
+    if (capacity < 0)
+        IFR(E_INVALIDARG);
+
+    std::vector<ComPtr<IMediaPlaybackItem>> evicted;
+    s_preloads.SetLimits(capacity, maxEntries, &evicted);
+
+    return S_OK;
+}
+
+void ClearPreloads()
+{
+    std::vector<ComPtr<IMediaPlaybackItem>> removed;
+    s_preloads.Clear(&removed);
+}
+
+_Use_decl_annotations_
+void GetPreloadStats(
+    PLAYBACK_PRELOAD_STATS* pStats)
+{
+    CPreloadLru<ComPtr<IMediaPlaybackItem>>::STATS stats;
+    s_preloads.GetStats(&stats);
+
+    ZeroMemory(pStats, sizeof(*pStats));
+    pStats->entries = stats.entries;
+    pStats->maxEntries = stats.maxEntries;
+    pStats->cost = stats.cost;
+    pStats->capacity = stats.capacity;
+    pStats->hits = stats.hits;
+    pStats->misses = stats.misses;
+    pStats->evictions = stats.evictions;
+    pStats->failures = stats.failures;
+}
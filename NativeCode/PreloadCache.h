@@ -0,0 +1,51 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "MediaHelpers.h"
+#include "PreloadLru.h"
+
+// Playback items opened ahead of LoadContent, shared by every player. An item
+// is handed to the first player that loads its url, a player can't share it.
+// The limits and cost rules are in PreloadLru.h.
+
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_PRELOAD_STATS
+{
+    UINT32 entries;
+    UINT32 maxEntries;
+    INT64 cost;                 // estimated bytes held by the cached sources
+    INT64 capacity;
+    UINT64 hits;                // LoadContent found its url preloaded
+    UINT64 misses;
+    UINT64 evictions;
+    UINT64 failures;            // preloads whose source failed to open
+} PLAYBACK_PRELOAD_STATS;
+#pragma pack(pop)
+
+// starts opening the source in the background, S_FALSE if the url is already cached
+HRESULT StartPreload(
+    _In_ LPCWSTR pszContentLocation);
+
+// S_FALSE and a null item on a miss
+HRESULT TakePreloadedItem(
+    _In_ LPCWSTR pszContentLocation,
+    _COM_Outptr_result_maybenull_ ABI::Windows::Media::Playback::IMediaPlaybackItem** ppPlaybackItem);
+
+HRESULT SetPreloadLimits(
+    _In_ INT64 capacity,
+    _In_ UINT32 maxEntries);
+
+void ClearPreloads();
+
+void GetPreloadStats(
+    _Out_ PLAYBACK_PRELOAD_STATS* pStats);
@@ -0,0 +1,134 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include "LruCache.h"
+
+#include <atomic>
+#include <string>
+
+// default limits, see SetPreloadLimits
+#define PLAYBACK_PRELOAD_CAPACITY (64 * 1024 * 1024)
+#define PLAYBACK_PRELOAD_MAX_ENTRIES 8
+
+// what an opened source is charged for its parsed headers and index, plus
+// the seconds of the stream media foundation reads ahead while opening
+#define PLAYBACK_PRELOAD_BASE_COST (1024 * 1024)
+#define PLAYBACK_PRELOAD_READ_AHEAD_SECONDS 2
+
+// bitrate of the first video track in bits per second, 0 if unknown
+inline int64_t GetPreloadCost(uint32_t bitrate)
+{
+    return PLAYBACK_PRELOAD_BASE_COST + static_cast<int64_t>(bitrate) / 8 * PLAYBACK_PRELOAD_READ_AHEAD_SECONDS;
+}
+
+// The preload rules on top of CLruCache, keyed by url. An item is charged the
+// base cost while it opens and its real cost once the open completed; the
+// completion finds it by id, so it never keeps an evicted item alive.
+template <typename T>
+class CPreloadLru
+{
+public:
+    typedef struct _STATS
+    {
+        uint32_t entries;
+        uint32_t maxEntries;
+        int64_t cost;
+        int64_t capacity;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t failures;
+    } STATS;
+
+    CPreloadLru(int64_t capacity, uint32_t maxEntries)
+        : m_cache(capacity, maxEntries)
+        , m_capacity(capacity)
+        , m_maxEntries(maxEntries)
+        , m_failures(0)
+    {
+    }
+
+    // true if url is cached already, which makes it the most recently used
+    bool Touch(const std::wstring& url)
+    {
+        return m_cache.Touch(url);
+    }
+
+    // the id the open completion reports back with, 0 if the capacity is below a single source
+    uint64_t Insert(const std::wstring& url, T item, std::vector<T>* pEvicted)
+    {
+        return m_cache.Insert(url, std::move(item), PLAYBACK_PRELOAD_BASE_COST, pEvicted);
+    }
+
+    // false if the item was evicted or taken while it opened
+    bool Find(uint64_t id, T* pItem) const
+    {
+        return m_cache.Find(id, pItem);
+    }
+
+    void OnOpened(uint64_t id, uint32_t bitrate, std::vector<T>* pEvicted)
+    {
+        m_cache.SetCost(id, GetPreloadCost(bitrate), pEvicted);
+    }
+
+    void OnOpenFailed(uint64_t id, T* pItem)
+    {
+        m_failures.fetch_add(1, std::memory_order_relaxed);
+        m_cache.Remove(id, pItem);
+    }
+
+    // the item leaves the cache, a player can't share it
+    bool Take(const std::wstring& url, T* pItem)
+    {
+        return m_cache.Take(url, pItem);
+    }
+
+    bool Remove(uint64_t id, T* pItem)
+    {
+        return m_cache.Remove(id, pItem);
+    }
+
+    void SetLimits(int64_t capacity, uint32_t maxEntries, std::vector<T>* pEvicted)
+    {
+        m_capacity.store(capacity, std::memory_order_relaxed);
+        m_maxEntries.store(maxEntries, std::memory_order_relaxed);
+        m_cache.SetLimits(capacity, maxEntries, pEvicted);
+    }
+
+    void Clear(std::vector<T>* pRemoved)
+    {
+        m_cache.Clear(pRemoved);
+    }
+
+    void GetStats(STATS* pStats) const
+    {
+        typename CLruCache<std::wstring, T>::STATS stats;
+        m_cache.GetStats(&stats);
+
+        pStats->entries = stats.entries;
+        pStats->maxEntries = m_maxEntries.load(std::memory_order_relaxed);
+        pStats->cost = stats.cost;
+        pStats->capacity = m_capacity.load(std::memory_order_relaxed);
+        pStats->hits = stats.hits;
+        pStats->misses = stats.misses;
+        pStats->evictions = stats.evictions;
+        pStats->failures = m_failures.load(std::memory_order_relaxed);
+    }
+
+private:
+    CLruCache<std::wstring, T> m_cache;
+    std::atomic<int64_t> m_capacity;
+    std::atomic<uint32_t> m_maxEntries;
+    std::atomic<uint64_t> m_failures;
+};
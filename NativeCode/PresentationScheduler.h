@@ -0,0 +1,278 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <cstdint>
+
+typedef struct _PRESENTATION_CANDIDATE
+{
+    int id;             // caller's frame id, e.g. a CFrameRing slot
+    int64_t pts;        // 100ns units
+} PRESENTATION_CANDIDATE;
+
+// Picks which decoded frame to show on each unity frame. Pure logic: the
+// caller passes the unity clock and the frames it has queued, nothing here
+// touches a device or a thread.
+//
+// The media clock is anchored to the unity clock on the first frame, then
+// advances at the playback rate. Each display shows the newest frame whose
+// pts is at or before the middle of the display interval, which gives the
+// steady 3:2 / 2:3 cadences for 24/25/30p on 60Hz and up instead of the
+// jitter of always taking the newest frame. Large gaps between the two
+// clocks (seek, stall, pause) re-anchor instead of dropping or holding.
+//
+// Frame server mode has no per-frame timestamp: the player stamps a frame with
+// the session position read in its VideoFrameAvailable callback, which trails
+// the frame's real pts by the callback latency and wobbles with it. Thresholds
+// here allow for JitterTolerance of that, and OrderTimestamp keeps such stamps
+// from running backwards between consecutive frames.
+class CPresentationScheduler
+{
+public:
+    static const int KeepCurrent = -1;
+
+    // 100ns units
+    static const int64_t DefaultFrameDuration = 333333;     // until measured, 30p
+    static const int64_t DefaultDisplayInterval = 166667;   // until measured, 60Hz
+    static const int64_t ResyncThreshold = 2000000;         // 200ms
+    static const int64_t JitterTolerance = 200000;          // 20ms, see above
+
+    CPresentationScheduler()
+    {
+        m_rate = 1.0;
+        Reset();
+        ResetStats();
+    }
+
+    // forgets the clock anchor, call on seek, pause and new content
+    void Reset()
+    {
+        m_anchored = false;
+        m_anchorClock = 0;
+        m_anchorPts = 0;
+        m_hasLastClock = false;
+        m_lastClock = 0;
+        m_hasPresented = false;
+        m_lastPts = 0;
+        m_frameDuration = DefaultFrameDuration;
+        m_frameDurationMeasured = false;
+        m_displayInterval = DefaultDisplayInterval;
+    }
+
+    void ResetStats()
+    {
+        m_framesPresented = 0;
+        m_framesRepeated = 0;
+        m_framesDropped = 0;
+        m_resyncs = 0;
+    }
+
+    // stamp for a frame written after one stamped previous. A step back within
+    // JitterTolerance is read jitter and moves forward by one tick instead,
+    // anything further back is a seek and kept.
+    static int64_t OrderTimestamp(int64_t timestamp, int64_t previous)
+    {
+        if (timestamp <= previous && previous - timestamp < JitterTolerance)
+        {
+            return previous + 1;
+        }
+
+        return timestamp;
+    }
+
+    void SetRate(double rate)
+    {
+        if (rate > 0.0 && rate != m_rate)
+        {
+            m_rate = rate;
+            m_anchored = false;
+        }
+    }
+
+    // clock is the unity time of the display in 100ns units. Candidates are the
+    // frames ready to show, any order. Returns the index of the candidate to
+    // present, or KeepCurrent to keep showing the last one.
+    int Select(int64_t clock, const PRESENTATION_CANDIDATE* pCandidates, uint32_t count)
+    {
+        UpdateDisplayInterval(clock);
+
+        if (nullptr == pCandidates)
+        {
+            count = 0;
+        }
+
+        int oldest = KeepCurrent;
+        int newest = KeepCurrent;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (m_hasPresented && pCandidates[i].pts <= m_lastPts && m_lastPts - pCandidates[i].pts < JitterTolerance)
+            {
+                // already shown, or older than what is on screen by no more than jitter
+                continue;
+            }
+
+            if (KeepCurrent == oldest || pCandidates[i].pts < pCandidates[oldest].pts)
+            {
+                oldest = static_cast<int>(i);
+            }
+            if (KeepCurrent == newest || pCandidates[i].pts > pCandidates[newest].pts)
+            {
+                newest = static_cast<int>(i);
+            }
+        }
+
+        if (!m_anchored)
+        {
+            if (KeepCurrent == oldest)
+            {
+                return KeepCurrent;
+            }
+
+            Anchor(clock, pCandidates[oldest].pts);
+        }
+
+        int64_t target = MediaTime(clock) + m_displayInterval / 2;
+
+        if (KeepCurrent != oldest)
+        {
+            // the media clock ran away from the frames, e.g. a seek or a decoder stall.
+            // Only frames further back than jitter are left to count as going backwards.
+            bool behind = pCandidates[newest].pts < target - ResyncThreshold;
+            bool ahead = pCandidates[oldest].pts > target + ResyncThreshold;
+            bool backwards = m_hasPresented && pCandidates[oldest].pts < m_lastPts;
+            if (behind || ahead || backwards)
+            {
+                Anchor(clock, pCandidates[oldest].pts);
+                target = MediaTime(clock) + m_displayInterval / 2;
+                m_hasPresented = false;
+                ++m_resyncs;
+            }
+        }
+
+        int selected = KeepCurrent;
+        for (uint32_t i = 0; KeepCurrent != oldest && i < count; ++i)
+        {
+            const PRESENTATION_CANDIDATE& c = pCandidates[i];
+            if (IsNewer(c.pts) && c.pts <= target && (KeepCurrent == selected || c.pts > pCandidates[selected].pts))
+            {
+                selected = static_cast<int>(i);
+            }
+        }
+
+        if (KeepCurrent == selected)
+        {
+            // a repeat only counts when the next frame was due, not for the
+            // planned repeats of a cadence where content is slower than the display
+            if (m_frameDurationMeasured && m_lastPts + m_frameDuration + Jitter() <= target)
+            {
+                ++m_framesRepeated;
+            }
+
+            return KeepCurrent;
+        }
+
+        uint32_t dropped = 0;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (IsNewer(pCandidates[i].pts) && pCandidates[i].pts < pCandidates[selected].pts)
+            {
+                ++dropped;
+            }
+        }
+        m_framesDropped += dropped;
+
+        int64_t pts = pCandidates[selected].pts;
+        if (m_hasPresented && 0 == dropped)
+        {
+            // smoothed, so one odd timestamp does not shift the repeat threshold
+            int64_t delta = pts - m_lastPts;
+            m_frameDuration = m_frameDurationMeasured ? (m_frameDuration * 7 + delta) / 8 : delta;
+            m_frameDurationMeasured = true;
+        }
+
+        m_lastPts = pts;
+        m_hasPresented = true;
+        ++m_framesPresented;
+
+        return selected;
+    }
+
+    bool IsAnchored() const { return m_anchored; }
+    int64_t FrameDuration() const { return m_frameDuration; }
+    int64_t DisplayInterval() const { return m_displayInterval; }
+
+    uint64_t FramesPresented() const { return m_framesPresented; }
+    uint64_t FramesRepeated() const { return m_framesRepeated; }
+    uint64_t FramesDropped() const { return m_framesDropped; }
+    uint64_t Resyncs() const { return m_resyncs; }
+
+private:
+    void Anchor(int64_t clock, int64_t pts)
+    {
+        m_anchored = true;
+        m_anchorClock = clock;
+        m_anchorPts = pts;
+    }
+
+    int64_t MediaTime(int64_t clock) const
+    {
+        return m_anchorPts + static_cast<int64_t>(static_cast<double>(clock - m_anchorClock) * m_rate);
+    }
+
+    // what a stamp may be late by without counting as a late frame, never more than half a frame
+    int64_t Jitter() const
+    {
+        return (m_frameDuration / 2 < JitterTolerance) ? m_frameDuration / 2 : JitterTolerance;
+    }
+
+    bool IsNewer(int64_t pts) const
+    {
+        return !m_hasPresented || pts > m_lastPts;
+    }
+
+    void UpdateDisplayInterval(int64_t clock)
+    {
+        if (m_hasLastClock && clock > m_lastClock)
+        {
+            int64_t delta = clock - m_lastClock;
+            if (delta < ResyncThreshold)
+            {
+                m_displayInterval = (m_displayInterval * 7 + delta) / 8;
+            }
+        }
+
+        m_hasLastClock = true;
+        m_lastClock = clock;
+    }
+
+private:
+    double m_rate;
+
+    bool m_anchored;
+    int64_t m_anchorClock;
+    int64_t m_anchorPts;
+
+    bool m_hasLastClock;
+    int64_t m_lastClock;
+    int64_t m_displayInterval;
+
+    bool m_hasPresented;
+    int64_t m_lastPts;
+    int64_t m_frameDuration;
+    bool m_frameDurationMeasured;
+
+    uint64_t m_framesPresented;
+    uint64_t m_framesRepeated;
+    uint64_t m_framesDropped;
+    uint64_t m_resyncs;
+};
@@ -0,0 +1,375 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// portable, built without the precompiled header
+#include "ReadAheadBuffer.h"
+
+#include <cstring>
+
+namespace
+{
+    uint64_t ClampWindow(uint64_t window)
+    {
+        if (0 == window)
+        {
+            return READ_AHEAD_DEFAULT_WINDOW;
+        }
+
+        window = (window > READ_AHEAD_MIN_WINDOW) ? window : READ_AHEAD_MIN_WINDOW;
+        return (window < READ_AHEAD_MAX_WINDOW) ? window : READ_AHEAD_MAX_WINDOW;
+    }
+
+    uint64_t GetBackSize(uint64_t window)
+    {
+        return window * READ_AHEAD_BACK_PERCENT / 100;
+    }
+}
+
+CReadAheadBuffer::CReadAheadBuffer()
+    : m_size(0)
+    , m_window(0)
+    , m_start(0)
+    , m_end(0)
+    , m_position(0)
+    , m_generation(0)
+    , m_chunk(READ_AHEAD_SEEK_CHUNK)
+    , m_refilling(false)
+    , m_prefetching(false)
+    , m_seekPending(false)
+    , m_failed(false)
+    , m_stopped(true)
+{
+}
+
+CReadAheadBuffer::~CReadAheadBuffer()
+{
+    Stop();
+}
+
+bool CReadAheadBuffer::Start(
+    std::unique_ptr<IReadAheadSource> source,
+    uint64_t size,
+    uint64_t window,
+    std::shared_ptr<CReadAheadCounters> spCounters)
+{
+    if (nullptr == source || nullptr == spCounters || m_thread.joinable())
+    {
+        return false;
+    }
+
+    m_source = std::move(source);
+    m_spCounters = spCounters;
+    m_size = size;
+
+    m_window = ClampWindow(window);
+    m_ring.resize(static_cast<size_t>(m_window + GetBackSize(m_window)));
+
+    ResetRange(0);
+    m_stopped = false;
+
+    m_thread = std::thread(&CReadAheadBuffer::Prefetch, this);
+
+    return true;
+}
+
+void CReadAheadBuffer::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        m_stopped = true;
+    }
+
+    m_workChanged.notify_all();
+    m_dataChanged.notify_all();
+
+    // a source read in flight is waited out, it writes into the ring
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    // reads fail from here on without touching the ring, it can go before the buffer does
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    std::vector<uint8_t>().swap(m_ring);
+    m_start = m_position;
+    m_end = m_position;
+}
+
+void CReadAheadBuffer::SetWindow(
+    uint64_t window)
+{
+    window = ClampWindow(window);
+
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    if (window == m_window || m_stopped)
+    {
+        return;
+    }
+
+    m_dataChanged.wait(lock, [this]() { return !m_prefetching; });
+
+    // what is buffered around the reads carries over, as much as the new ring holds
+    const uint64_t back = GetBackSize(window);
+    const uint64_t start = (m_position - m_start > back) ? m_position - back : m_start;
+    const uint64_t end = (m_end - m_position > window) ? m_position + window : m_end;
+
+    std::vector<uint8_t> ring(static_cast<size_t>(window + back));
+    for (uint64_t offset = start; offset < end; )
+    {
+        // runs up to where either ring wraps
+        const uint64_t from = offset % m_ring.size();
+        const uint64_t to = offset % ring.size();
+        uint64_t size = end - offset;
+        size = (size < m_ring.size() - from) ? size : m_ring.size() - from;
+        size = (size < ring.size() - to) ? size : ring.size() - to;
+
+        memcpy(ring.data() + to, m_ring.data() + from, static_cast<size_t>(size));
+        offset += size;
+    }
+
+    m_ring.swap(ring);
+    m_window = window;
+    m_start = start;
+    m_end = end;
+    ++m_generation;
+
+    m_workChanged.notify_one();
+}
+
+bool CReadAheadBuffer::Read(
+    uint64_t offset,
+    void* pBuffer,
+    size_t size,
+    size_t* pRead)
+{
+    *pRead = 0;
+
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    if (m_stopped)
+    {
+        return false;
+    }
+
+    if (offset >= m_size || 0 == size)
+    {
+        return true;
+    }
+
+    if (offset < m_start || offset > m_end)
+    {
+        m_spCounters->OnSeek();
+
+        return ReadAfterSeek(lock, offset, pBuffer, size, pRead);
+    }
+
+    // set before waiting, Trim keeps what is behind it
+    m_position = offset;
+
+    // waits count against the seek until the range has caught up with the reads
+    if (offset != m_end)
+    {
+        m_seekPending = false;
+    }
+    else
+    {
+        const bool afterSeek = m_seekPending;
+        const int64_t waitStart = CPlaybackCounters::Now();
+
+        m_workChanged.notify_one();
+        m_dataChanged.wait(lock, [this, offset]() { return m_stopped || m_failed || m_end > offset; });
+
+        m_spCounters->OnWait(CPlaybackCounters::Now() - waitStart, afterSeek);
+
+        if (m_stopped || m_end <= offset)
+        {
+            return false;
+        }
+    }
+
+    // copied under the lock, the prefetch thread can't trim it or the window be resized meanwhile
+    const uint64_t capacity = m_ring.size();
+    const uint64_t available = m_end - offset;
+    const size_t count = (size < available) ? size : static_cast<size_t>(available);
+    const size_t index = static_cast<size_t>(offset % capacity);
+    const size_t first = (count < capacity - index) ? count : static_cast<size_t>(capacity - index);
+
+    uint8_t* pDest = static_cast<uint8_t*>(pBuffer);
+    memcpy(pDest, m_ring.data() + index, first);
+    if (first < count)
+    {
+        memcpy(pDest + first, m_ring.data(), count - first);
+    }
+
+    m_position = offset + count;
+    *pRead = count;
+
+    m_spCounters->OnRead(count);
+
+    if (!m_refilling && NeedsRefill())
+    {
+        m_workChanged.notify_one();
+    }
+
+    return true;
+}
+
+bool CReadAheadBuffer::ReadAfterSeek(
+    std::unique_lock<std::mutex>& lock,
+    uint64_t offset,
+    void* pBuffer,
+    size_t size,
+    size_t* pRead)
+{
+    // the range restarts past this read and the prefetch thread reads on from
+    // there, at once if it is idle or after its read from before the seek if not
+    const uint64_t available = m_size - offset;
+    const size_t count = (size < available) ? size : static_cast<size_t>(available);
+
+    // a short read leaves a gap before the range, the next read is another seek
+    ResetRange(offset + count);
+    m_workChanged.notify_one();
+
+    const int64_t readStart = CPlaybackCounters::Now();
+
+    lock.unlock();
+
+    size_t read = 0;
+    const bool succeeded = m_source->ReadAt(offset, pBuffer, count, &read);
+
+    lock.lock();
+
+    m_spCounters->OnWait(CPlaybackCounters::Now() - readStart, true);
+
+    // nothing read before the end is the file getting shorter, as on the prefetch thread
+    if (!succeeded || 0 == read)
+    {
+        m_spCounters->OnReadError();
+        return false;
+    }
+
+    *pRead = read;
+    m_spCounters->OnRead(read);
+
+    return true;
+}
+
+void CReadAheadBuffer::GetOccupancy(
+    OCCUPANCY* pOccupancy)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    pOccupancy->window = m_window;
+    pOccupancy->ahead = m_end - m_position;
+    pOccupancy->behind = m_position - m_start;
+}
+
+void CReadAheadBuffer::Prefetch()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    while (!m_stopped)
+    {
+        if (!NeedsRefill())
+        {
+            m_refilling = false;
+            m_workChanged.wait(lock);
+            continue;
+        }
+
+        m_refilling = true;
+        Trim();
+
+        // one chunk into free space, never across the end of the ring
+        const uint64_t capacity = m_ring.size();
+        const uint64_t space = capacity - (m_end - m_start);
+        const uint64_t contiguous = capacity - (m_end % capacity);
+        uint64_t size = m_chunk;
+        size = (size < space) ? size : space;
+        size = (size < contiguous) ? size : contiguous;
+        size = (size < m_size - m_end) ? size : m_size - m_end;
+        if (0 == size)
+        {
+            m_workChanged.wait(lock);
+            continue;
+        }
+
+        const uint64_t offset = m_end;
+        const uint64_t generation = m_generation;
+        uint8_t* pDest = m_ring.data() + static_cast<size_t>(offset % capacity);
+
+        // readers only copy out of m_start to m_end, the space past it is this thread's
+        m_prefetching = true;
+        lock.unlock();
+
+        size_t read = 0;
+        const bool succeeded = m_source->ReadAt(offset, pDest, static_cast<size_t>(size), &read);
+
+        lock.lock();
+        m_prefetching = false;
+
+        // a seek while reading, the range starts elsewhere now
+        if (generation == m_generation)
+        {
+            if (succeeded && 0 != read)
+            {
+                m_end += read;
+                m_chunk = (m_chunk * 2 < READ_AHEAD_CHUNK) ? m_chunk * 2 : READ_AHEAD_CHUNK;
+                m_spCounters->OnPrefetched(read);
+            }
+            else
+            {
+                // an error, or the file got shorter. Readers fail at m_end until they seek.
+                m_failed = true;
+                m_spCounters->OnReadError();
+            }
+        }
+
+        m_dataChanged.notify_all();
+    }
+}
+
+void CReadAheadBuffer::ResetRange(
+    uint64_t offset)
+{
+    m_start = offset;
+    m_end = offset;
+    m_position = offset;
+    ++m_generation;
+    m_chunk = READ_AHEAD_SEEK_CHUNK;
+    m_refilling = true;
+    m_seekPending = true;
+    m_failed = false;
+}
+
+void CReadAheadBuffer::Trim()
+{
+    const uint64_t back = GetBackSize(m_window);
+    if (m_position > m_start + back)
+    {
+        m_start = m_position - back;
+    }
+}
+
+bool CReadAheadBuffer::NeedsRefill() const
+{
+    if (m_stopped || m_failed || m_end >= m_size)
+    {
+        return false;
+    }
+
+    // from the low watermark up to a full window
+    const uint64_t ahead = m_end - m_position;
+    return m_refilling ? (ahead < m_window) : (ahead < m_window * READ_AHEAD_LOW_WATERMARK_PERCENT / 100);
+}
@@ -0,0 +1,136 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include "PlaybackCounters.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A window of a file read ahead of its reader by a thread of its own, so a
+// slow or stalling disk (a NAS, mostly) is absorbed by the buffer instead of
+// stalling the demuxer.
+//
+// The buffer is a ring holding one contiguous range of the file: a little
+// already read, for demuxers that step back, and the window ahead of the
+// reads. The prefetch thread refills it whenever what is left ahead drops
+// below the low watermark, until the window is full again, and sleeps in
+// between. A read outside the range is a seek: it is read straight from the
+// file on the reader's thread, without waiting out a refill from before the
+// seek, and the range starts over right past it. The first refills there are
+// small, so the next reads don't wait for a full chunk either, then grow to
+// full chunks.
+
+// window used until one is set
+#define READ_AHEAD_DEFAULT_WINDOW (64 * 1024 * 1024)
+#define READ_AHEAD_MIN_WINDOW (4 * 1024 * 1024)
+#define READ_AHEAD_MAX_WINDOW (1024 * 1024 * 1024)
+
+// largest single read from the file, and the first one after a seek. Reads
+// right after a seek wait for the one in flight to finish first, so larger
+// ones cost more there than they gain.
+#define READ_AHEAD_CHUNK (1024 * 1024)
+#define READ_AHEAD_SEEK_CHUNK (256 * 1024)
+
+// refills start when less than this share of the window is left ahead
+#define READ_AHEAD_LOW_WATERMARK_PERCENT 50
+
+// share of the window kept behind the reads
+#define READ_AHEAD_BACK_PERCENT 10
+
+class IReadAheadSource
+{
+public:
+    virtual ~IReadAheadSource() {}
+
+    // up to size bytes at offset, false on an error. *pRead is only 0 at the
+    // end. Called from the prefetch thread and, after a seek, the reader's at
+    // the same time.
+    virtual bool ReadAt(uint64_t offset, void* pBuffer, size_t size, size_t* pRead) = 0;
+};
+
+class CReadAheadBuffer
+{
+public:
+    typedef struct _OCCUPANCY
+    {
+        uint64_t window;
+        uint64_t ahead;         // buffered past the last read
+        uint64_t behind;        // kept before it
+    } OCCUPANCY;
+
+    CReadAheadBuffer();
+    ~CReadAheadBuffer();
+
+    // starts the prefetch thread, which reads from the start of the file.
+    // counters may be shared with other buffers.
+    bool Start(
+        std::unique_ptr<IReadAheadSource> source,
+        uint64_t size,
+        uint64_t window,
+        std::shared_ptr<CReadAheadCounters> spCounters);
+
+    // wakes any reader, reads fail from then on. Frees the ring, the buffer
+    // can be held on to for its counts.
+    void Stop();
+
+    uint64_t GetSize() const
+    {
+        return m_size;
+    }
+
+    // keeps what is buffered around the last read that fits the new size
+    void SetWindow(uint64_t window);
+
+    // copies up to size bytes at offset, waiting for the prefetch thread if
+    // they aren't buffered yet. Reads are expected from one thread at a time.
+    // False on a read error or once stopped, *pRead is 0 at the end.
+    bool Read(uint64_t offset, void* pBuffer, size_t size, size_t* pRead);
+
+    void GetOccupancy(OCCUPANCY* pOccupancy);
+
+private:
+    void Prefetch();
+    bool ReadAfterSeek(std::unique_lock<std::mutex>& lock, uint64_t offset, void* pBuffer, size_t size, size_t* pRead);
+    void ResetRange(uint64_t offset);
+    void Trim();
+    bool NeedsRefill() const;
+
+    std::unique_ptr<IReadAheadSource> m_source;
+    std::shared_ptr<CReadAheadCounters> m_spCounters;
+    uint64_t m_size;
+
+    std::mutex m_lock;
+    std::condition_variable m_workChanged;      // wakes the prefetch thread
+    std::condition_variable m_dataChanged;      // wakes a waiting reader
+    std::thread m_thread;
+
+    // the ring, m_start to m_end of the file are at their offset modulo its size
+    std::vector<uint8_t> m_ring;
+    uint64_t m_window;
+    uint64_t m_start;
+    uint64_t m_end;
+    uint64_t m_position;        // end of the last read
+    uint64_t m_generation;      // bumped on every reset, a refill read before one is dropped
+    size_t m_chunk;
+    bool m_refilling;
+    bool m_prefetching;         // a source read is in flight, outside the lock
+    bool m_seekPending;         // the range hasn't caught up with the reads since the seek
+    bool m_failed;
+    bool m_stopped;
+};
@@ -0,0 +1,415 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "ReadAheadByteStream.h"
+#include "MappedByteStream.h"
+
+using namespace Microsoft::WRL;
+using namespace ABI::Windows::Foundation;
+using namespace ABI::Windows::System::Threading;
+
+// The file the buffer reads, with positioned reads so the prefetch thread and
+// a read after a seek don't wait on each other. Opened for overlapped io, a
+// synchronous handle would put the two in line.
+class CFileReadAheadSource
+    : public IReadAheadSource
+{
+public:
+    CFileReadAheadSource()
+        : m_size(0)
+    {
+    }
+
+    HRESULT Open(
+        _In_ LPCWSTR pszPath)
+    {
+        m_file.Attach(CreateFileW(
+            pszPath,
+            GENERIC_READ,
+            FILE_SHARE_READ | FILE_SHARE_DELETE,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr));
+        if (!m_file.IsValid())
+        {
+            IFR(HRESULT_FROM_WIN32(GetLastError()));
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file.Get(), &size))
+        {
+            IFR(HRESULT_FROM_WIN32(GetLastError()));
+        }
+
+        m_size = static_cast<uint64_t>(size.QuadPart);
+
+        return S_OK;
+    }
+
+    uint64_t GetSize() const
+    {
+        return m_size;
+    }
+
+    // IReadAheadSource
+    bool ReadAt(uint64_t offset, void* pBuffer, size_t size, size_t* pRead) override
+    {
+        *pRead = 0;
+
+        Wrappers::Event completed(CreateEventExW(nullptr, nullptr, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS));
+        if (!completed.IsValid())
+        {
+            LOG_RESULT(HRESULT_FROM_WIN32(GetLastError()));
+            return false;
+        }
+
+        OVERLAPPED overlapped;
+        ZeroMemory(&overlapped, sizeof(overlapped));
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        overlapped.hEvent = completed.Get();
+
+        // reads are a chunk or a byte stream read, never more than a DWORD.
+        // Reading at the end of the file fails with ERROR_HANDLE_EOF.
+        DWORD read = 0;
+        if ((!ReadFile(m_file.Get(), pBuffer, static_cast<DWORD>(size), nullptr, &overlapped) && ERROR_IO_PENDING != GetLastError())
+            || !GetOverlappedResult(m_file.Get(), &overlapped, &read, TRUE))
+        {
+            const DWORD error = GetLastError();
+            if (ERROR_HANDLE_EOF == error)
+            {
+                return true;
+            }
+
+            LOG_RESULT(HRESULT_FROM_WIN32(error));
+            return false;
+        }
+
+        *pRead = read;
+
+        return true;
+    }
+
+private:
+    Wrappers::FileHandle m_file;
+    uint64_t m_size;
+};
+
+_Use_decl_annotations_
+HRESULT CreateReadAheadByteStream(
+    LPCWSTR pszPath,
+    UINT64 window,
+    const std::shared_ptr<CReadAheadCounters>& spCounters,
+    IMFByteStream** ppByteStream,
+    std::shared_ptr<CReadAheadBuffer>* pBuffer)
+{
+    NULL_CHK(pszPath);
+    NULL_CHK(ppByteStream);
+    NULL_CHK(pBuffer);
+
+    *ppByteStream = nullptr;
+    pBuffer->reset();
+
+    ComPtr<CReadAheadByteStream> spByteStream;
+    IFR(MakeAndInitialize<CReadAheadByteStream>(&spByteStream, pszPath, window, spCounters));
+
+    *pBuffer = spByteStream->GetBuffer();
+    *ppByteStream = spByteStream.Detach();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+CReadAheadByteStream::CReadAheadByteStream()
+    : m_position(0)
+    , m_closed(false)
+{
+}
+
+_Use_decl_annotations_
+CReadAheadByteStream::~CReadAheadByteStream()
+{
+    if (nullptr != m_spBuffer)
+    {
+        m_spBuffer->Stop();
+    }
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::RuntimeClassInitialize(
+    LPCWSTR pszPath,
+    UINT64 window,
+    const std::shared_ptr<CReadAheadCounters>& spCounters)
+{
+    NULL_CHK(pszPath);
+    NULL_CHK_HR(spCounters, E_INVALIDARG);
+
+    std::unique_ptr<CFileReadAheadSource> source(new (std::nothrow) CFileReadAheadSource());
+    NULL_CHK_HR(source, E_OUTOFMEMORY);
+
+    IFR(source->Open(pszPath));
+
+    const uint64_t size = source->GetSize();
+
+    m_spBuffer = std::make_shared<CReadAheadBuffer>();
+    if (!m_spBuffer->Start(std::move(source), size, window, spCounters))
+    {
+        IFR(E_UNEXPECTED);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::GetCapabilities(
+    DWORD* pdwCapabilities)
+{
+    NULL_CHK(pdwCapabilities);
+
+    *pdwCapabilities = MFBYTESTREAM_IS_READABLE | MFBYTESTREAM_IS_SEEKABLE | MFBYTESTREAM_DOES_NOT_USE_NETWORK;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::GetLength(
+    QWORD* pqwLength)
+{
+    NULL_CHK(pqwLength);
+
+    *pqwLength = m_spBuffer->GetSize();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::SetLength(
+    QWORD /*qwLength*/)
+{
+    return E_ACCESSDENIED;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::GetCurrentPosition(
+    QWORD* pqwPosition)
+{
+    NULL_CHK(pqwPosition);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    *pqwPosition = m_position;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::SetCurrentPosition(
+    QWORD qwPosition)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (m_closed)
+        IFR(MF_E_SHUTDOWN);
+
+    if (qwPosition > m_spBuffer->GetSize())
+        IFR(E_INVALIDARG);
+
+    m_position = qwPosition;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::IsEndOfStream(
+    BOOL* pfEndOfStream)
+{
+    NULL_CHK(pfEndOfStream);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    *pfEndOfStream = (m_position >= m_spBuffer->GetSize()) ? TRUE : FALSE;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::Read(
+    BYTE* pb,
+    ULONG cb,
+    ULONG* pcbRead)
+{
+    NULL_CHK(pb);
+    NULL_CHK(pcbRead);
+
+    *pcbRead = 0;
+
+    std::lock_guard<std::mutex> readLock(m_readLock);
+
+    QWORD position = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (m_closed)
+            IFR(MF_E_SHUTDOWN);
+
+        position = m_position;
+    }
+
+    // Close stops the buffer, which wakes a read waiting on it
+    size_t read = 0;
+    if (!m_spBuffer->Read(position, pb, cb, &read))
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        IFR(m_closed ? MF_E_SHUTDOWN : HRESULT_FROM_WIN32(ERROR_READ_FAULT));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        // a seek while reading wins
+        if (position == m_position)
+        {
+            m_position = position + read;
+        }
+    }
+
+    *pcbRead = static_cast<ULONG>(read);
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::BeginRead(
+    BYTE* pb,
+    ULONG cb,
+    IMFAsyncCallback* pCallback,
+    IUnknown* punkState)
+{
+    NULL_CHK(pb);
+    NULL_CHK(pCallback);
+
+    ComPtr<IThreadPoolStatics> spThreadPool;
+    IFR(ABI::Windows::Foundation::GetActivationFactory(
+        Wrappers::HStringReference(RuntimeClass_Windows_System_Threading_ThreadPool).Get(),
+        &spThreadPool));
+
+    // the work item holds the stream, the callback and its state until the read completes
+    ComPtr<CReadAheadByteStream> spThis(this);
+    ComPtr<IMFAsyncCallback> spCallback(pCallback);
+    ComPtr<IUnknown> spState(punkState);
+    auto workItem = Callback<IWorkItemHandler>(
+        [spThis, pb, cb, spCallback, spState](_In_ IAsyncAction*) -> HRESULT
+    {
+        ULONG cbRead = 0;
+        HRESULT hrRead = spThis->Read(pb, cb, &cbRead);
+
+        LOG_RESULT(InvokeReadCallback(hrRead, cbRead, spCallback.Get(), spState.Get()));
+
+        return S_OK;
+    });
+    NULL_CHK_HR(workItem, E_OUTOFMEMORY);
+
+    ComPtr<IAsyncAction> spAction;
+    IFR(spThreadPool->RunWithPriorityAsync(workItem.Get(), WorkItemPriority::WorkItemPriority_High, &spAction));
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::EndRead(
+    IMFAsyncResult* pResult,
+    ULONG* pcbRead)
+{
+    return GetReadCallbackResult(pResult, pcbRead);
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::Write(
+    const BYTE* /*pb*/,
+    ULONG /*cb*/,
+    ULONG* /*pcbWritten*/)
+{
+    return E_ACCESSDENIED;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::BeginWrite(
+    const BYTE* /*pb*/,
+    ULONG /*cb*/,
+    IMFAsyncCallback* /*pCallback*/,
+    IUnknown* /*punkState*/)
+{
+    return E_ACCESSDENIED;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::EndWrite(
+    IMFAsyncResult* /*pResult*/,
+    ULONG* /*pcbWritten*/)
+{
+    return E_ACCESSDENIED;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::Seek(
+    MFBYTESTREAM_SEEK_ORIGIN seekOrigin,
+    LONGLONG llSeekOffset,
+    DWORD /*dwSeekFlags*/,
+    QWORD* pqwCurrentPosition)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (m_closed)
+        IFR(MF_E_SHUTDOWN);
+
+    LONGLONG position = llSeekOffset;
+    if (msoCurrent == seekOrigin)
+    {
+        position += static_cast<LONGLONG>(m_position);
+    }
+
+    // the buffer sees the seek at the next read, if it lands outside what is buffered
+    if (position < 0 || static_cast<QWORD>(position) > m_spBuffer->GetSize())
+        IFR(E_INVALIDARG);
+
+    m_position = static_cast<QWORD>(position);
+
+    if (nullptr != pqwCurrentPosition)
+    {
+        *pqwCurrentPosition = m_position;
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::Flush()
+{
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CReadAheadByteStream::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        m_closed = true;
+    }
+
+    // the prefetch thread and the ring go now, not with the last reference
+    m_spBuffer->Stop();
+
+    return S_OK;
+}
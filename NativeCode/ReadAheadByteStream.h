@@ -0,0 +1,107 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "ReadAheadBuffer.h"
+
+// A read only media foundation byte stream over a local file read through a
+// CReadAheadBuffer, for files on disks too slow or uneven to be read as the
+// demuxer asks (network shares, spinning disks shared with other work). The
+// mapped stream is the better choice for anything local and fast, it has no
+// thread or copy of its own.
+//
+// Reads can wait on the prefetch thread, so BeginRead runs them on the thread
+// pool instead of the caller's thread.
+
+HRESULT CreateReadAheadByteStream(
+    _In_ LPCWSTR pszPath,
+    _In_ UINT64 window,
+    _In_ const std::shared_ptr<CReadAheadCounters>& spCounters,
+    _COM_Outptr_ IMFByteStream** ppByteStream,
+    _Out_ std::shared_ptr<CReadAheadBuffer>* pBuffer);
+
+class CReadAheadByteStream
+    : public Microsoft::WRL::RuntimeClass
+    < Microsoft::WRL::RuntimeClassFlags<Microsoft::WRL::ClassicCom>
+    , IMFByteStream
+    , Microsoft::WRL::FtmBase>
+{
+public:
+    CReadAheadByteStream();
+    ~CReadAheadByteStream();
+
+    HRESULT RuntimeClassInitialize(
+        _In_ LPCWSTR pszPath,
+        _In_ UINT64 window,
+        _In_ const std::shared_ptr<CReadAheadCounters>& spCounters);
+
+    std::shared_ptr<CReadAheadBuffer> GetBuffer() const
+    {
+        return m_spBuffer;
+    }
+
+    // IMFByteStream
+    IFACEMETHOD(GetCapabilities)(
+        _Out_ DWORD* pdwCapabilities);
+    IFACEMETHOD(GetLength)(
+        _Out_ QWORD* pqwLength);
+    IFACEMETHOD(SetLength)(
+        _In_ QWORD qwLength);
+    IFACEMETHOD(GetCurrentPosition)(
+        _Out_ QWORD* pqwPosition);
+    IFACEMETHOD(SetCurrentPosition)(
+        _In_ QWORD qwPosition);
+    IFACEMETHOD(IsEndOfStream)(
+        _Out_ BOOL* pfEndOfStream);
+    IFACEMETHOD(Read)(
+        _Out_writes_bytes_to_(cb, *pcbRead) BYTE* pb,
+        _In_ ULONG cb,
+        _Out_ ULONG* pcbRead);
+    IFACEMETHOD(BeginRead)(
+        _Out_writes_bytes_(cb) BYTE* pb,
+        _In_ ULONG cb,
+        _In_ IMFAsyncCallback* pCallback,
+        _In_opt_ IUnknown* punkState);
+    IFACEMETHOD(EndRead)(
+        _In_ IMFAsyncResult* pResult,
+        _Out_ ULONG* pcbRead);
+    IFACEMETHOD(Write)(
+        _In_reads_bytes_(cb) const BYTE* pb,
+        _In_ ULONG cb,
+        _Out_ ULONG* pcbWritten);
+    IFACEMETHOD(BeginWrite)(
+        _In_reads_bytes_(cb) const BYTE* pb,
+        _In_ ULONG cb,
+        _In_ IMFAsyncCallback* pCallback,
+        _In_opt_ IUnknown* punkState);
+    IFACEMETHOD(EndWrite)(
+        _In_ IMFAsyncResult* pResult,
+        _Out_ ULONG* pcbWritten);
+    IFACEMETHOD(Seek)(
+        _In_ MFBYTESTREAM_SEEK_ORIGIN seekOrigin,
+        _In_ LONGLONG llSeekOffset,
+        _In_ DWORD dwSeekFlags,
+        _Out_opt_ QWORD* pqwCurrentPosition);
+    IFACEMETHOD(Flush)();
+    IFACEMETHOD(Close)();
+
+private:
+    std::shared_ptr<CReadAheadBuffer> m_spBuffer;
+
+    // reads one at a time, the buffer expects a single reader. Apart from
+    // m_lock so the position can be asked for while a read waits.
+    std::mutex m_readLock;
+
+    std::mutex m_lock;
+    QWORD m_position;
+    bool m_closed;
+};
@@ -0,0 +1,362 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <cstdint>
+#include <mutex>
+
+typedef struct _READBACK_MAPPING
+{
+    void* pData;
+    uint32_t rowPitch;
+} READBACK_MAPPING;
+
+typedef struct _READBACK_FRAME
+{
+    void* pData;
+    uint32_t rowPitch;
+    int64_t timestamp;
+    uint64_t frameId;           // pass back to Release
+} READBACK_FRAME;
+
+// The gpu side of the ring, one cpu readable surface per slot. Every call
+// is made from the render thread and must not block on the gpu.
+class IReadbackDevice
+{
+public:
+    enum class MapResult : uint8_t
+    {
+        Mapped = 0,
+        StillDrawing,   // copy not finished yet, try again next frame
+        Failed,
+    };
+
+    virtual ~IReadbackDevice() {}
+
+    // queues a copy of pSource into the slot's surface
+    virtual bool CopyToSlot(uint32_t slot, void* pSource) = 0;
+    virtual MapResult MapSlot(uint32_t slot, READBACK_MAPPING* pMapping) = 0;
+    virtual void UnmapSlot(uint32_t slot) = 0;
+};
+
+// Ring of readback surfaces between the render thread, which copies and maps,
+// and a client thread that reads the mapped memory.
+//
+//     Free -> Copying -> Ready -> Held -> Retired -> Free
+//
+// Submit and Poll run on the render thread and never wait: a copy goes into
+// a free slot, else over the oldest unread frame. Poll maps finished copies
+// in submit order and keeps only the newest unread frame, older ones are
+// stale and get skipped. A Held frame stays mapped until the client releases
+// it, the render thread unmaps it on the next Poll.
+class CReadbackRing
+{
+public:
+    enum class SlotState : uint8_t
+    {
+        Free = 0,
+        Copying,
+        Ready,
+        Held,
+        Retired,
+    };
+
+    static const uint32_t MaxSlots = 8;
+
+    explicit CReadbackRing(uint32_t slotCount = 3)
+        : m_pDevice(nullptr)
+        , m_nextSequence(1)
+    {
+        ResetSlots(slotCount);
+    }
+
+    // render thread: unmaps everything still mapped on the old device, pointers
+    // handed out by Acquire are invalid afterwards
+    void Reset(IReadbackDevice* pDevice, uint32_t slotCount)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        UnmapAll();
+
+        m_pDevice = pDevice;
+        ResetSlots(slotCount);
+    }
+
+    uint32_t SlotCount() const
+    {
+        return m_slotCount;
+    }
+
+    // render thread: queue a readback of pSource, false if the frame was skipped
+    bool Submit(void* pSource, int64_t timestamp)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (nullptr == m_pDevice)
+        {
+            return false;
+        }
+
+        int slot = FindFree();
+        if (InvalidSlot == slot)
+        {
+            // overwrite the oldest frame nobody has seen yet
+            slot = FindOldest(SlotState::Copying);
+            if (InvalidSlot == slot)
+            {
+                slot = FindOldest(SlotState::Ready);
+                if (InvalidSlot != slot)
+                {
+                    m_pDevice->UnmapSlot(static_cast<uint32_t>(slot));
+                }
+            }
+
+            // either the overwritten frame or, if the client holds every slot, this one
+            ++m_framesSkipped;
+            if (InvalidSlot == slot)
+            {
+                return false;
+            }
+        }
+
+        Slot& s = m_slots[slot];
+        if (!m_pDevice->CopyToSlot(static_cast<uint32_t>(slot), pSource))
+        {
+            s = Slot();
+            return false;
+        }
+
+        s.state = SlotState::Copying;
+        s.sequence = m_nextSequence++;
+        s.timestamp = timestamp;
+        s.mapping = READBACK_MAPPING();
+        ++m_framesSubmitted;
+
+        return true;
+    }
+
+    // render thread: unmaps released frames and maps finished copies,
+    // returns true if a new frame is ready for Acquire
+    bool Poll()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (nullptr == m_pDevice)
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < m_slotCount; ++i)
+        {
+            if (SlotState::Retired == m_slots[i].state)
+            {
+                m_pDevice->UnmapSlot(i);
+                m_slots[i] = Slot();
+            }
+        }
+
+        // copies complete in submit order, stop at the first one still in flight
+        for (;;)
+        {
+            int slot = FindOldest(SlotState::Copying);
+            if (InvalidSlot == slot)
+            {
+                break;
+            }
+
+            Slot& s = m_slots[slot];
+            IReadbackDevice::MapResult result = m_pDevice->MapSlot(static_cast<uint32_t>(slot), &s.mapping);
+            if (IReadbackDevice::MapResult::StillDrawing == result)
+            {
+                break;
+            }
+
+            if (IReadbackDevice::MapResult::Failed == result)
+            {
+                s = Slot();
+                ++m_framesSkipped;
+                continue;
+            }
+
+            s.state = SlotState::Ready;
+        }
+
+        int newest = FindNewest(SlotState::Ready);
+        for (uint32_t i = 0; i < m_slotCount; ++i)
+        {
+            if (SlotState::Ready == m_slots[i].state && static_cast<int>(i) != newest)
+            {
+                // stale, a newer frame is already readable
+                m_pDevice->UnmapSlot(i);
+                m_slots[i] = Slot();
+                ++m_framesSkipped;
+            }
+        }
+
+        return InvalidSlot != newest;
+    }
+
+    // any thread: takes the newest mapped frame, false if nothing new is ready.
+    // The memory stays mapped until Release, Reset or device loss.
+    bool Acquire(READBACK_FRAME* pFrame)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (nullptr == pFrame)
+        {
+            return false;
+        }
+
+        int slot = FindNewest(SlotState::Ready);
+        if (InvalidSlot == slot)
+        {
+            return false;
+        }
+
+        Slot& s = m_slots[slot];
+        s.state = SlotState::Held;
+
+        pFrame->pData = s.mapping.pData;
+        pFrame->rowPitch = s.mapping.rowPitch;
+        pFrame->timestamp = s.timestamp;
+        pFrame->frameId = s.sequence;
+        ++m_framesRead;
+
+        return true;
+    }
+
+    // any thread: gives a frame back, false if frameId is not held
+    bool Release(uint64_t frameId)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        for (uint32_t i = 0; i < m_slotCount; ++i)
+        {
+            if (SlotState::Held == m_slots[i].state && frameId == m_slots[i].sequence)
+            {
+                m_slots[i].state = SlotState::Retired;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    SlotState GetState(uint32_t slot) const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        return (slot < m_slotCount) ? m_slots[slot].state : SlotState::Free;
+    }
+
+    uint64_t FramesSubmitted() const { std::lock_guard<std::mutex> lock(m_lock); return m_framesSubmitted; }
+    uint64_t FramesRead() const { std::lock_guard<std::mutex> lock(m_lock); return m_framesRead; }
+    uint64_t FramesSkipped() const { std::lock_guard<std::mutex> lock(m_lock); return m_framesSkipped; }
+
+private:
+    static const int InvalidSlot = -1;
+
+    struct Slot
+    {
+        Slot() : state(SlotState::Free), sequence(0), timestamp(0), mapping() {}
+
+        SlotState state;
+        uint64_t sequence;
+        int64_t timestamp;
+        READBACK_MAPPING mapping;
+    };
+
+    void ResetSlots(uint32_t slotCount)
+    {
+        m_slotCount = (slotCount < 1) ? 1 : (slotCount > MaxSlots) ? MaxSlots : slotCount;
+        for (uint32_t i = 0; i < MaxSlots; ++i)
+        {
+            m_slots[i] = Slot();
+        }
+
+        // frame ids keep counting across resets, a late Release cannot hit a newer frame
+        m_framesSubmitted = 0;
+        m_framesRead = 0;
+        m_framesSkipped = 0;
+    }
+
+    void UnmapAll()
+    {
+        if (nullptr == m_pDevice)
+        {
+            return;
+        }
+
+        for (uint32_t i = 0; i < m_slotCount; ++i)
+        {
+            SlotState state = m_slots[i].state;
+            if (SlotState::Ready == state || SlotState::Held == state || SlotState::Retired == state)
+            {
+                m_pDevice->UnmapSlot(i);
+            }
+        }
+    }
+
+    int FindFree() const
+    {
+        for (uint32_t i = 0; i < m_slotCount; ++i)
+        {
+            if (SlotState::Free == m_slots[i].state)
+            {
+                return static_cast<int>(i);
+            }
+        }
+
+        return InvalidSlot;
+    }
+
+    int FindOldest(SlotState state) const
+    {
+        int found = InvalidSlot;
+        for (uint32_t i = 0; i < m_slotCount; ++i)
+        {
+            if (state == m_slots[i].state
+                && (InvalidSlot == found || m_slots[i].sequence < m_slots[found].sequence))
+            {
+                found = static_cast<int>(i);
+            }
+        }
+
+        return found;
+    }
+
+    int FindNewest(SlotState state) const
+    {
+        int found = InvalidSlot;
+        for (uint32_t i = 0; i < m_slotCount; ++i)
+        {
+            if (state == m_slots[i].state
+                && (InvalidSlot == found || m_slots[i].sequence > m_slots[found].sequence))
+            {
+                found = static_cast<int>(i);
+            }
+        }
+
+        return found;
+    }
+
+private:
+    mutable std::mutex m_lock;
+    IReadbackDevice* m_pDevice;
+    Slot m_slots[MaxSlots];
+    uint32_t m_slotCount;
+    uint64_t m_nextSequence;
+    uint64_t m_framesSubmitted;
+    uint64_t m_framesRead;
+    uint64_t m_framesSkipped;
+};
@@ -0,0 +1,121 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+// A plain record published by several writer threads and read by any thread
+// without a lock. Writers are serialized by a mutex and bump the sequence to
+// odd while they copy, readers retry until they see the same even sequence
+// before and after their copy.
+//
+// The record is stored as relaxed atomic words, so a reader racing a writer
+// copies garbage it then throws away instead of hitting a data race.
+template <typename T>
+class CSeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "records are copied word by word");
+    static_assert(0 == sizeof(T) % sizeof(uint32_t), "records are copied word by word");
+
+public:
+    CSeqLock()
+        : m_sequence(0)
+    {
+        memset(&m_pending, 0, sizeof(m_pending));
+        for (size_t i = 0; i < WordCount; ++i)
+        {
+            m_words[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // any thread, fn edits the record in place and is called with the writer lock held
+    template <typename Fn>
+    void Update(Fn fn)
+    {
+        std::lock_guard<std::mutex> lock(m_writeLock);
+
+        fn(m_pending);
+
+        uint32_t words[WordCount];
+        memcpy(words, &m_pending, sizeof(T));
+
+        uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < WordCount; ++i)
+        {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // any thread, false if a writer got in the way, the caller may retry
+    bool TryRead(T* pValue, uint32_t* pVersion = nullptr) const
+    {
+        uint32_t before = m_sequence.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            return false;
+        }
+
+        uint32_t words[WordCount];
+        for (size_t i = 0; i < WordCount; ++i)
+        {
+            words[i] = m_words[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (before != m_sequence.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        memcpy(pValue, words, sizeof(T));
+        if (nullptr != pVersion)
+        {
+            *pVersion = before / 2;
+        }
+
+        return true;
+    }
+
+    // any thread, never blocks a writer. Updates take well under a microsecond,
+    // so after a few spins the writer is most likely descheduled and we yield to it.
+    void Read(T* pValue, uint32_t* pVersion = nullptr) const
+    {
+        for (uint32_t attempt = 0; !TryRead(pValue, pVersion); ++attempt)
+        {
+            if (attempt >= SpinCount)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    static const size_t WordCount = sizeof(T) / sizeof(uint32_t);
+    static const uint32_t SpinCount = 64;
+
+    std::atomic<uint32_t> m_sequence;
+    std::atomic<uint32_t> m_words[WordCount];
+
+    std::mutex m_writeLock;
+    T m_pending;
+};
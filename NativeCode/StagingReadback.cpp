@@ -0,0 +1,136 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "StagingReadback.h"
+
+using namespace Microsoft::WRL;
+
+_Use_decl_annotations_
+CStagingReadback::CStagingReadback()
+    : m_d3dContext(nullptr)
+    , m_slotCount(0)
+{
+    ZeroMemory(&m_desc, sizeof(m_desc));
+}
+
+_Use_decl_annotations_
+CStagingReadback::~CStagingReadback()
+{
+    for (UINT32 i = 0; i < m_slotCount; ++i)
+    {
+        m_stagingTextures[i].Reset();
+    }
+
+    m_d3dContext.Reset();
+}
+
+_Use_decl_annotations_
+HRESULT CStagingReadback::Initialize(
+    ID3D11Device* pDevice,
+    const D3D11_TEXTURE2D_DESC& desc,
+    UINT32 slotCount)
+{
+    NULL_CHK(pDevice);
+
+    if (slotCount < 1 || slotCount > CReadbackRing::MaxSlots)
+        IFR(E_INVALIDARG);
+
+    CD3D11_TEXTURE2D_DESC stagingDesc(desc);
+    stagingDesc.BindFlags = 0;
+    stagingDesc.MiscFlags = 0;
+    stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    stagingDesc.Usage = D3D11_USAGE_STAGING;
+
+    ComPtr<ID3D11Texture2D> spTextures[CReadbackRing::MaxSlots];
+    for (UINT32 i = 0; i < slotCount; ++i)
+    {
+        IFR(pDevice->CreateTexture2D(&stagingDesc, nullptr, &spTextures[i]));
+    }
+
+    ComPtr<ID3D11DeviceContext> spContext;
+    pDevice->GetImmediateContext(&spContext);
+
+    for (UINT32 i = 0; i < slotCount; ++i)
+    {
+        m_stagingTextures[i].Attach(spTextures[i].Detach());
+    }
+
+    m_d3dContext.Attach(spContext.Detach());
+    m_slotCount = slotCount;
+    m_desc = desc;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+bool CStagingReadback::Matches(
+    const D3D11_TEXTURE2D_DESC& desc) const
+{
+    return 0 != m_slotCount
+        && desc.Width == m_desc.Width
+        && desc.Height == m_desc.Height
+        && desc.Format == m_desc.Format;
+}
+
+_Use_decl_annotations_
+void CStagingReadback::GetDesc(
+    D3D11_TEXTURE2D_DESC* pDesc) const
+{
+    *pDesc = m_desc;
+}
+
+bool CStagingReadback::CopyToSlot(uint32_t slot, void* pSource)
+{
+    if (slot >= m_slotCount || nullptr == pSource)
+    {
+        return false;
+    }
+
+    m_d3dContext->CopyResource(m_stagingTextures[slot].Get(), static_cast<ID3D11Texture2D*>(pSource));
+
+    return true;
+}
+
+IReadbackDevice::MapResult CStagingReadback::MapSlot(uint32_t slot, READBACK_MAPPING* pMapping)
+{
+    if (slot >= m_slotCount || nullptr == pMapping)
+    {
+        return MapResult::Failed;
+    }
+
+    // never stall the render thread, DO_NOT_WAIT fails instead of waiting for the copy
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    HRESULT hr = m_d3dContext->Map(m_stagingTextures[slot].Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+    if (DXGI_ERROR_WAS_STILL_DRAWING == hr)
+    {
+        return MapResult::StillDrawing;
+    }
+
+    if (FAILED(hr))
+    {
+        LOG_RESULT(hr);
+        return MapResult::Failed;
+    }
+
+    pMapping->pData = mapped.pData;
+    pMapping->rowPitch = mapped.RowPitch;
+
+    return MapResult::Mapped;
+}
+
+void CStagingReadback::UnmapSlot(uint32_t slot)
+{
+    if (slot < m_slotCount)
+    {
+        m_d3dContext->Unmap(m_stagingTextures[slot].Get(), 0);
+    }
+}
@@ -0,0 +1,46 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "ReadbackRing.h"
+
+// IReadbackDevice on d3d11 staging textures. Copies and maps go through the
+// immediate context, so every call has to come from unity's render thread.
+class CStagingReadback : public IReadbackDevice
+{
+public:
+    CStagingReadback();
+    ~CStagingReadback();
+
+    // desc is the output texture description, staging copies use the same size and format
+    HRESULT Initialize(
+        _In_ ID3D11Device* pDevice,
+        _In_ const D3D11_TEXTURE2D_DESC& desc,
+        _In_ UINT32 slotCount);
+
+    bool Matches(
+        _In_ const D3D11_TEXTURE2D_DESC& desc) const;
+
+    void GetDesc(
+        _Out_ D3D11_TEXTURE2D_DESC* pDesc) const;
+
+    // IReadbackDevice
+    bool CopyToSlot(uint32_t slot, void* pSource) override;
+    MapResult MapSlot(uint32_t slot, READBACK_MAPPING* pMapping) override;
+    void UnmapSlot(uint32_t slot) override;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_d3dContext;
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> m_stagingTextures[CReadbackRing::MaxSlots];
+    UINT32 m_slotCount;
+    D3D11_TEXTURE2D_DESC m_desc;
+};
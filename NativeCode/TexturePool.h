@@ -0,0 +1,128 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include "LruCache.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Sets of textures kept after their owner is done with them, for the next
+// owner asking for the same size and format. A set can be anything the
+// allocator makes, eg. a texture with its views and shared handle. Sets are
+// charged their size in bytes, the least recently released ones are freed
+// while the pool is over budget.
+
+// what a set was made for, a set only goes back out for an identical key
+typedef struct _TEXTURE_POOL_KEY
+{
+    const void* pDevice;        // created on
+    const void* pSharedDevice;  // opened on, null if not shared
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;            // DXGI_FORMAT
+    uint32_t bindFlags;
+} TEXTURE_POOL_KEY;
+
+inline bool operator==(const TEXTURE_POOL_KEY& left, const TEXTURE_POOL_KEY& right)
+{
+    return left.pDevice == right.pDevice
+        && left.pSharedDevice == right.pSharedDevice
+        && left.width == right.width
+        && left.height == right.height
+        && left.format == right.format
+        && left.bindFlags == right.bindFlags;
+}
+
+// makes the sets the pool doesn't have
+template <typename T>
+class ITexturePoolAllocator
+{
+public:
+    virtual ~ITexturePoolAllocator() {}
+
+    // false on an error, *pValue is left as it was
+    virtual bool Allocate(const TEXTURE_POOL_KEY& key, T* pValue) = 0;
+};
+
+template <typename T>
+class CTexturePool
+{
+public:
+    typedef struct _STATS
+    {
+        uint32_t entries;
+        int64_t bytes;
+        int64_t budget;
+        uint64_t hits;          // acquires handed a pooled set
+        uint64_t misses;        // acquires that had to allocate
+        uint64_t evictions;
+    } STATS;
+
+    explicit CTexturePool(int64_t budget)
+        : m_sets(budget, UINT32_MAX)
+        , m_budget(budget)
+    {
+    }
+
+    // the most recently released set for the key, or a new one from the allocator.
+    // The allocator is called without the pool locked.
+    bool Acquire(const TEXTURE_POOL_KEY& key, ITexturePoolAllocator<T>* pAllocator, T* pValue)
+    {
+        if (m_sets.Take(key, pValue))
+        {
+            return true;
+        }
+
+        return pAllocator->Allocate(key, pValue);
+    }
+
+    // keeps the set for the next acquire of its key. A set larger than the
+    // whole budget is evicted right away. Evicted sets are the caller's to free.
+    void Release(const TEXTURE_POOL_KEY& key, T value, int64_t size, std::vector<T>* pEvicted)
+    {
+        m_sets.Insert(key, std::move(value), size, pEvicted);
+    }
+
+    void SetBudget(int64_t budget, std::vector<T>* pEvicted)
+    {
+        m_budget = budget;
+        m_sets.SetLimits(budget, UINT32_MAX, pEvicted);
+    }
+
+    void Clear(std::vector<T>* pRemoved)
+    {
+        m_sets.Clear(pRemoved);
+    }
+
+    STATS GetStats() const
+    {
+        typename CLruCache<TEXTURE_POOL_KEY, T>::STATS stats;
+        m_sets.GetStats(&stats);
+
+        STATS result;
+        result.entries = stats.entries;
+        result.bytes = stats.cost;
+        result.budget = m_budget;
+        result.hits = stats.hits;
+        result.misses = stats.misses;
+        result.evictions = stats.evictions;
+
+        return result;
+    }
+
+private:
+    CLruCache<TEXTURE_POOL_KEY, T> m_sets;
+    std::atomic<int64_t> m_budget;
+};
@@ -0,0 +1,383 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// portable, built without the precompiled header
+#include "ThumbnailAtlas.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    // "MPTA", little endian
+    const uint32_t CacheMagic = 0x4154504d;
+
+    // magic, version, key, count, cell width and height, columns, rows
+    const size_t CacheHeaderSize = 4 + 4 + 8 + 4 * 5;
+
+    inline void WriteU32(uint8_t* p, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            p[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    inline void WriteU64(uint8_t* p, uint64_t value)
+    {
+        WriteU32(p, static_cast<uint32_t>(value));
+        WriteU32(p + 4, static_cast<uint32_t>(value >> 32));
+    }
+
+    inline uint32_t ReadU32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0])
+            | (static_cast<uint32_t>(p[1]) << 8)
+            | (static_cast<uint32_t>(p[2]) << 16)
+            | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    inline uint64_t ReadU64(const uint8_t* p)
+    {
+        return static_cast<uint64_t>(ReadU32(p)) | (static_cast<uint64_t>(ReadU32(p + 4)) << 32);
+    }
+}
+
+CThumbnailAtlas::CThumbnailAtlas()
+    : m_count(0)
+    , m_columns(0)
+    , m_rows(0)
+    , m_cellWidth(0)
+    , m_cellHeight(0)
+{
+}
+
+bool CThumbnailAtlas::Initialize(
+    uint32_t count,
+    uint32_t cellWidth,
+    uint32_t cellHeight)
+{
+    m_count = 0;
+    m_columns = 0;
+    m_rows = 0;
+    m_pixels.clear();
+    m_times.clear();
+
+    if (0 == count || 0 == cellWidth || 0 == cellHeight
+        || cellWidth > THUMBNAIL_ATLAS_MAX_SIZE || cellHeight > THUMBNAIL_ATLAS_MAX_SIZE)
+    {
+        return false;
+    }
+
+    // one strip when it fits, wrapped into more rows when not
+    const uint32_t maxColumns = THUMBNAIL_ATLAS_MAX_SIZE / cellWidth;
+    const uint32_t columns = (count < maxColumns) ? count : maxColumns;
+    const uint32_t rows = (count + columns - 1) / columns;
+    if (static_cast<uint64_t>(rows) * cellHeight > THUMBNAIL_ATLAS_MAX_SIZE)
+    {
+        return false;
+    }
+
+    m_count = count;
+    m_columns = columns;
+    m_rows = rows;
+    m_cellWidth = cellWidth;
+    m_cellHeight = cellHeight;
+
+    // opaque black, cells not placed yet show as such
+    m_pixels.resize(static_cast<size_t>(GetRowPitch()) * GetHeight());
+    for (size_t i = 3; i < m_pixels.size(); i += 4)
+    {
+        m_pixels[i] = 0xff;
+    }
+
+    m_times.assign(count, -1);
+
+    return true;
+}
+
+bool CThumbnailAtlas::GetCellRect(
+    uint32_t index,
+    THUMBNAIL_CELL_RECT* pRect) const
+{
+    if (index >= m_count || nullptr == pRect)
+    {
+        return false;
+    }
+
+    pRect->left = (index % m_columns) * m_cellWidth;
+    pRect->top = (index / m_columns) * m_cellHeight;
+    pRect->width = m_cellWidth;
+    pRect->height = m_cellHeight;
+
+    return true;
+}
+
+uint32_t CThumbnailAtlas::FindCell(
+    int64_t timestamp) const
+{
+    // times only grow with the index, cells not placed yet are skipped
+    uint32_t found = THUMBNAIL_INVALID_CELL;
+    for (uint32_t i = 0; i < m_count; ++i)
+    {
+        if (m_times[i] < 0)
+        {
+            continue;
+        }
+
+        if (m_times[i] > timestamp)
+        {
+            return (THUMBNAIL_INVALID_CELL == found) ? i : found;
+        }
+
+        found = i;
+    }
+
+    return found;
+}
+
+void CThumbnailAtlas::GetFitSize(
+    uint32_t width,
+    uint32_t height,
+    uint32_t* pFitWidth,
+    uint32_t* pFitHeight) const
+{
+    // whichever side is relatively longer fills the cell
+    uint32_t fitWidth = m_cellWidth;
+    uint32_t fitHeight = m_cellHeight;
+    if (0 != width && 0 != height)
+    {
+        if (static_cast<uint64_t>(width) * m_cellHeight > static_cast<uint64_t>(height) * m_cellWidth)
+        {
+            fitHeight = static_cast<uint32_t>((static_cast<uint64_t>(height) * m_cellWidth + width / 2) / width);
+        }
+        else
+        {
+            fitWidth = static_cast<uint32_t>((static_cast<uint64_t>(width) * m_cellHeight + height / 2) / height);
+        }
+    }
+
+    *pFitWidth = (0 == fitWidth) ? 1 : fitWidth;
+    *pFitHeight = (0 == fitHeight) ? 1 : fitHeight;
+}
+
+void CThumbnailAtlas::Place(
+    uint32_t index,
+    int64_t timestamp,
+    const uint8_t* pSource,
+    int32_t pitch,
+    uint32_t width,
+    uint32_t height)
+{
+    if (index >= m_count || nullptr == pSource || 0 == width || 0 == height)
+    {
+        return;
+    }
+
+    uint32_t fitWidth = 0;
+    uint32_t fitHeight = 0;
+    GetFitSize(width, height, &fitWidth, &fitHeight);
+
+    const uint32_t left = (m_cellWidth - fitWidth) / 2;
+    const uint32_t top = (m_cellHeight - fitHeight) / 2;
+    const size_t rowPitch = GetRowPitch();
+
+    uint8_t* pCell = GetCell(index);
+    for (uint32_t y = 0; y < m_cellHeight; ++y)
+    {
+        uint8_t* pRow = pCell + y * rowPitch;
+        for (uint32_t x = 0; x < m_cellWidth; ++x)
+        {
+            pRow[x * 4 + 0] = 0;
+            pRow[x * 4 + 1] = 0;
+            pRow[x * 4 + 2] = 0;
+            pRow[x * 4 + 3] = 0xff;
+        }
+    }
+
+    // box filter, each cell pixel averages the source pixels it covers. Growing
+    // a smaller picture repeats pixels instead.
+    for (uint32_t y = 0; y < fitHeight; ++y)
+    {
+        const uint32_t y0 = static_cast<uint32_t>(static_cast<uint64_t>(y) * height / fitHeight);
+        uint32_t y1 = static_cast<uint32_t>(static_cast<uint64_t>(y + 1) * height / fitHeight);
+        y1 = (y1 > y0) ? y1 : y0 + 1;
+
+        uint8_t* pOut = pCell + (top + y) * rowPitch + left * 4;
+        for (uint32_t x = 0; x < fitWidth; ++x)
+        {
+            const uint32_t x0 = static_cast<uint32_t>(static_cast<uint64_t>(x) * width / fitWidth);
+            uint32_t x1 = static_cast<uint32_t>(static_cast<uint64_t>(x + 1) * width / fitWidth);
+            x1 = (x1 > x0) ? x1 : x0 + 1;
+
+            uint64_t b = 0;
+            uint64_t g = 0;
+            uint64_t r = 0;
+            for (uint32_t sy = y0; sy < y1; ++sy)
+            {
+                const uint8_t* pIn = pSource + static_cast<ptrdiff_t>(sy) * pitch + x0 * 4;
+                for (uint32_t sx = x0; sx < x1; ++sx, pIn += 4)
+                {
+                    b += pIn[0];
+                    g += pIn[1];
+                    r += pIn[2];
+                }
+            }
+
+            const uint64_t area = static_cast<uint64_t>(y1 - y0) * (x1 - x0);
+            pOut[x * 4 + 0] = static_cast<uint8_t>((b + area / 2) / area);
+            pOut[x * 4 + 1] = static_cast<uint8_t>((g + area / 2) / area);
+            pOut[x * 4 + 2] = static_cast<uint8_t>((r + area / 2) / area);
+            pOut[x * 4 + 3] = 0xff;
+        }
+    }
+
+    m_times[index] = timestamp;
+}
+
+void CThumbnailAtlas::CopyCell(
+    const CThumbnailAtlas& source,
+    uint32_t from,
+    uint32_t to)
+{
+    if (from >= source.m_count || to >= m_count || (&source == this && from == to)
+        || source.m_cellWidth != m_cellWidth || source.m_cellHeight != m_cellHeight)
+    {
+        return;
+    }
+
+    const size_t sourcePitch = source.GetRowPitch();
+    const size_t rowPitch = GetRowPitch();
+    const uint8_t* pFrom = source.GetCell(from);
+    uint8_t* pTo = GetCell(to);
+    for (uint32_t y = 0; y < m_cellHeight; ++y)
+    {
+        memcpy(pTo + y * rowPitch, pFrom + y * sourcePitch, m_cellWidth * 4);
+    }
+
+    m_times[to] = source.m_times[from];
+}
+
+void CThumbnailAtlas::Serialize(
+    uint64_t key,
+    std::vector<uint8_t>* pData) const
+{
+    pData->resize(CacheHeaderSize + m_times.size() * 8 + m_pixels.size());
+
+    uint8_t* p = pData->data();
+    WriteU32(p, CacheMagic);
+    WriteU32(p + 4, THUMBNAIL_CACHE_VERSION);
+    WriteU64(p + 8, key);
+    WriteU32(p + 16, m_count);
+    WriteU32(p + 20, m_cellWidth);
+    WriteU32(p + 24, m_cellHeight);
+    WriteU32(p + 28, m_columns);
+    WriteU32(p + 32, m_rows);
+    p += CacheHeaderSize;
+
+    for (size_t i = 0; i < m_times.size(); ++i, p += 8)
+    {
+        WriteU64(p, static_cast<uint64_t>(m_times[i]));
+    }
+
+    if (!m_pixels.empty())
+    {
+        memcpy(p, m_pixels.data(), m_pixels.size());
+    }
+}
+
+bool CThumbnailAtlas::Deserialize(
+    uint64_t key,
+    const uint8_t* pData,
+    size_t size)
+{
+    // the size asked for must already be set up, a cache only fills it
+    if (0 == m_count || nullptr == pData || size < CacheHeaderSize)
+    {
+        return false;
+    }
+
+    if (ReadU32(pData) != CacheMagic
+        || ReadU32(pData + 4) != THUMBNAIL_CACHE_VERSION
+        || ReadU64(pData + 8) != key
+        || ReadU32(pData + 16) != m_count
+        || ReadU32(pData + 20) != m_cellWidth
+        || ReadU32(pData + 24) != m_cellHeight
+        || ReadU32(pData + 28) != m_columns
+        || ReadU32(pData + 32) != m_rows
+        || size != CacheHeaderSize + m_times.size() * 8 + m_pixels.size())
+    {
+        return false;
+    }
+
+    const uint8_t* p = pData + CacheHeaderSize;
+    for (size_t i = 0; i < m_times.size(); ++i, p += 8)
+    {
+        m_times[i] = static_cast<int64_t>(ReadU64(p));
+    }
+
+    memcpy(m_pixels.data(), p, m_pixels.size());
+
+    return true;
+}
+
+uint8_t* CThumbnailAtlas::GetCell(
+    uint32_t index)
+{
+    return const_cast<uint8_t*>(static_cast<const CThumbnailAtlas*>(this)->GetCell(index));
+}
+
+const uint8_t* CThumbnailAtlas::GetCell(
+    uint32_t index) const
+{
+    const uint32_t left = (index % m_columns) * m_cellWidth;
+    const uint32_t top = (index / m_columns) * m_cellHeight;
+
+    return m_pixels.data() + static_cast<size_t>(top) * GetRowPitch() + static_cast<size_t>(left) * 4;
+}
+
+void GetThumbnailTimes(
+    int64_t duration,
+    uint32_t count,
+    const std::vector<int64_t>& keyframes,
+    std::vector<int64_t>* pTimes)
+{
+    pTimes->resize(count);
+
+    duration = (duration > 0) ? duration : 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        int64_t time = static_cast<int64_t>((static_cast<double>(duration) * (2 * i + 1)) / (2.0 * count));
+
+        if (!keyframes.empty())
+        {
+            auto it = std::upper_bound(keyframes.begin(), keyframes.end(), time);
+            time = (it == keyframes.begin()) ? *it : *(it - 1);
+        }
+
+        (*pTimes)[i] = time;
+    }
+}
+
+uint64_t HashThumbnailKey(
+    uint64_t hash,
+    const void* pData,
+    size_t size)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(pData);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
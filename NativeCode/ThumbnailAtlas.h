@@ -0,0 +1,123 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Thumbnails of one video packed into a single 32bpp BGRA image, in rows of
+// cells left to right, for scrub bars. Each picture is scaled to fit its
+// cell with its aspect ratio kept, the rest of the cell stays black. Not
+// locked, the generator's workers fill cells under its lock.
+//
+// The atlas can be written to and read back from a flat buffer, which is
+// how the generator keeps it on disk between runs.
+
+// widest / tallest texture d3d11 can create
+#define THUMBNAIL_ATLAS_MAX_SIZE 16384
+
+// bumped whenever the layout of the cache file changes
+#define THUMBNAIL_CACHE_VERSION 1
+
+#define THUMBNAIL_KEY_SEED 14695981039346656037ull
+
+#define THUMBNAIL_INVALID_CELL 0xffffffff
+
+// where a cell is in the atlas, in pixels from its top left
+typedef struct _THUMBNAIL_CELL_RECT
+{
+    uint32_t left;
+    uint32_t top;
+    uint32_t width;
+    uint32_t height;
+} THUMBNAIL_CELL_RECT;
+
+class CThumbnailAtlas
+{
+public:
+    CThumbnailAtlas();
+
+    // false if the cells can't be laid out within THUMBNAIL_ATLAS_MAX_SIZE
+    bool Initialize(uint32_t count, uint32_t cellWidth, uint32_t cellHeight);
+
+    uint32_t GetCount() const { return m_count; }
+    uint32_t GetColumns() const { return m_columns; }
+    uint32_t GetRows() const { return m_rows; }
+    uint32_t GetCellWidth() const { return m_cellWidth; }
+    uint32_t GetCellHeight() const { return m_cellHeight; }
+    uint32_t GetWidth() const { return m_columns * m_cellWidth; }
+    uint32_t GetHeight() const { return m_rows * m_cellHeight; }
+    uint32_t GetRowPitch() const { return GetWidth() * 4; }
+
+    const uint8_t* GetPixels() const { return m_pixels.data(); }
+    size_t GetPixelsSize() const { return m_pixels.size(); }
+
+    // presentation time of the picture in each cell, 100ns, -1 until placed
+    const std::vector<int64_t>& GetTimes() const { return m_times; }
+
+    // false for an index past the last cell, the last row may be partly empty
+    bool GetCellRect(uint32_t index, THUMBNAIL_CELL_RECT* pRect) const;
+
+    // the cell to show for a scrub bar at timestamp: the last placed one at or
+    // before it, else the first placed one. THUMBNAIL_INVALID_CELL if none is.
+    uint32_t FindCell(int64_t timestamp) const;
+
+    // size a width x height picture is scaled to, to fit a cell
+    void GetFitSize(uint32_t width, uint32_t height, uint32_t* pFitWidth, uint32_t* pFitHeight) const;
+
+    // scales a 32bpp picture into the cell. pitch is negative for bottom up
+    // pictures, the first row is always the top one.
+    void Place(
+        uint32_t index,
+        int64_t timestamp,
+        const uint8_t* pSource,
+        int32_t pitch,
+        uint32_t width,
+        uint32_t height);
+
+    // copies a cell of an atlas with the same cell size, or of this one
+    // for times that land on the same keyframe
+    void CopyCell(const CThumbnailAtlas& source, uint32_t from, uint32_t to);
+
+    // key identifies the video, a cache made for another video or size reads back false
+    void Serialize(uint64_t key, std::vector<uint8_t>* pData) const;
+    bool Deserialize(uint64_t key, const uint8_t* pData, size_t size);
+
+private:
+    uint8_t* GetCell(uint32_t index);
+    const uint8_t* GetCell(uint32_t index) const;
+
+    uint32_t m_count;
+    uint32_t m_columns;
+    uint32_t m_rows;
+    uint32_t m_cellWidth;
+    uint32_t m_cellHeight;
+    std::vector<uint8_t> m_pixels;
+    std::vector<int64_t> m_times;
+};
+
+// count times spread evenly over duration, each at the middle of its share,
+// snapped back to the keyframe before it when keyframes are given
+void GetThumbnailTimes(
+    int64_t duration,
+    uint32_t count,
+    const std::vector<int64_t>& keyframes,
+    std::vector<int64_t>* pTimes);
+
+// FNV-1a, to turn a file's identity into a cache file name. Start from
+// THUMBNAIL_KEY_SEED and feed each part in turn.
+uint64_t HashThumbnailKey(
+    uint64_t hash,
+    const void* pData,
+    size_t size);
@@ -0,0 +1,859 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "ThumbnailGenerator.h"
+#include "MappedByteStream.h"
+#include "Trace.h"
+
+#include <string>
+#pragma comment(lib, "mfreadwrite")
+
+using namespace Microsoft::WRL;
+using namespace ABI::Windows::Foundation;
+using namespace ABI::Windows::System::Threading;
+
+static std::mutex s_cacheDirectoryLock;
+static std::wstring s_cacheDirectory;
+
+static std::wstring GetCacheDirectory()
+{
+    std::lock_guard<std::mutex> lock(s_cacheDirectoryLock);
+
+    if (s_cacheDirectory.empty())
+    {
+        WCHAR szTempPath[MAX_PATH + 1];
+        DWORD length = GetTempPathW(ARRAYSIZE(szTempPath), szTempPath);
+        if (0 == length || length >= ARRAYSIZE(szTempPath))
+        {
+            return std::wstring();
+        }
+
+        s_cacheDirectory = std::wstring(szTempPath) + L"MediaPlaybackThumbnails";
+    }
+
+    return s_cacheDirectory;
+}
+
+_Use_decl_annotations_
+HRESULT SetThumbnailCacheDirectory(
+    LPCWSTR pszDirectory)
+{
+    NULL_CHK(pszDirectory);
+
+    std::wstring directory(pszDirectory);
+    while (!directory.empty() && (L'\\' == directory.back() || L'/' == directory.back()))
+    {
+        directory.pop_back();
+    }
+
+    if (directory.empty())
+        IFR(E_INVALIDARG);
+
+    std::lock_guard<std::mutex> lock(s_cacheDirectoryLock);
+
+    s_cacheDirectory = directory;
+
+    return S_OK;
+}
+
+// full path, size and last write time, so an edited or replaced file misses
+static bool GetCacheKey(
+    _In_ const std::wstring& path,
+    _In_ UINT32 count,
+    _In_ UINT32 cellWidth,
+    _In_ UINT32 cellHeight,
+    _Out_ UINT64* pKey)
+{
+    WCHAR szFullPath[MAX_PATH * 4];
+    DWORD length = GetFullPathNameW(path.c_str(), ARRAYSIZE(szFullPath), szFullPath, nullptr);
+    if (0 == length || length >= ARRAYSIZE(szFullPath))
+    {
+        return false;
+    }
+
+    // paths are case insensitive
+    CharLowerBuffW(szFullPath, length);
+
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(szFullPath, GetFileExInfoStandard, &data))
+    {
+        return false;
+    }
+
+    UINT64 key = THUMBNAIL_KEY_SEED;
+    key = HashThumbnailKey(key, szFullPath, length * sizeof(WCHAR));
+    key = HashThumbnailKey(key, &data.nFileSizeHigh, sizeof(data.nFileSizeHigh));
+    key = HashThumbnailKey(key, &data.nFileSizeLow, sizeof(data.nFileSizeLow));
+    key = HashThumbnailKey(key, &data.ftLastWriteTime, sizeof(data.ftLastWriteTime));
+    key = HashThumbnailKey(key, &count, sizeof(count));
+    key = HashThumbnailKey(key, &cellWidth, sizeof(cellWidth));
+    key = HashThumbnailKey(key, &cellHeight, sizeof(cellHeight));
+
+    *pKey = key;
+
+    return true;
+}
+
+static HRESULT CreateMappedSourceReader(
+    _In_ LPCWSTR pszPath,
+    _In_ IMFAttributes* pAttributes,
+    _COM_Outptr_ IMFSourceReader** ppReader)
+{
+    *ppReader = nullptr;
+
+    ComPtr<IMFByteStream> spByteStream;
+    IFR(CreateMappedByteStream(pszPath, MappedReadPolicy::MappedReadPolicy_Random, &spByteStream));
+
+    ComPtr<IMFSourceResolver> spResolver;
+    IFR(MFCreateSourceResolver(&spResolver));
+
+    // the path is passed for its extension, the byte stream has no name the
+    // resolver could pick the container by
+    MF_OBJECT_TYPE objectType = MF_OBJECT_INVALID;
+    ComPtr<IUnknown> spObject;
+    IFR(spResolver->CreateObjectFromByteStream(
+        spByteStream.Get(),
+        pszPath,
+        MF_RESOLUTION_MEDIASOURCE | MF_RESOLUTION_READ,
+        nullptr,
+        &objectType,
+        &spObject));
+
+    ComPtr<IMFMediaSource> spSource;
+    IFR(spObject.As(&spSource));
+
+    // the reader shuts the source down when it is released
+    HRESULT hr = MFCreateSourceReaderFromMediaSource(spSource.Get(), pAttributes, ppReader);
+    if (FAILED(hr))
+    {
+        LOG_RESULT(spSource->Shutdown());
+        IFR(hr);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+CThumbnailGenerator::CThumbnailGenerator()
+    : m_traceId(0)
+    , m_cacheKey(0)
+    , m_workers(0)
+    , m_completed(0)
+    , m_notified(0)
+    , m_workersRunning(0)
+    , m_result(E_PENDING)
+    , m_workerResult(S_OK)
+    , m_fromCache(false)
+    , m_cancelled(false)
+{
+}
+
+_Use_decl_annotations_
+CThumbnailGenerator::~CThumbnailGenerator()
+{
+    m_deviceManager.Reset();
+    m_device.Reset();
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailGenerator::Start(
+    LPCWSTR pszContentLocation,
+    UINT32 count,
+    UINT32 cellWidth,
+    UINT32 cellHeight,
+    IDXGIAdapter* pAdapter,
+    UINT32 traceId,
+    ThumbnailProgressCallback fnProgress)
+{
+    NULL_CHK(pszContentLocation);
+
+    if (0 == count || count > PLAYBACK_THUMBNAIL_MAX_COUNT)
+        IFR(E_INVALIDARG);
+
+    if (!m_atlas.Initialize(count, cellWidth, cellHeight))
+        IFR(E_INVALIDARG);
+
+    m_traceId = traceId;
+    m_url = pszContentLocation;
+    m_times.assign(count, -1);
+
+    std::wstring path;
+    if (GetLocalPath(pszContentLocation, &path) && GetCacheKey(path, count, cellWidth, cellHeight, &m_cacheKey))
+    {
+        std::wstring directory = GetCacheDirectory();
+        if (!directory.empty())
+        {
+            WCHAR szName[32];
+            IFR(StringCchPrintfW(szName, ARRAYSIZE(szName), L"\\%016llx.thumbs", m_cacheKey));
+
+            m_cachePath = directory + szName;
+        }
+    }
+
+    if (ReadCache())
+    {
+        TraceInstant("ThumbnailCacheHit", m_traceId, count);
+
+        std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+        m_fnProgress = fnProgress;
+        Notify(count, S_OK);
+
+        return S_OK;
+    }
+
+    // a device of its own, so thumbnails never wait on the player's decoding
+    if (nullptr != pAdapter)
+    {
+        ComPtr<ID3D11Device> spDevice;
+        ComPtr<IMFDXGIDeviceManager> spDeviceManager;
+        UINT resetToken = 0;
+        HRESULT hr = CreateMediaDevice(pAdapter, &spDevice);
+        if (SUCCEEDED(hr))
+        {
+            hr = MFCreateDXGIDeviceManager(&resetToken, &spDeviceManager);
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            hr = spDeviceManager->ResetDevice(spDevice.Get(), resetToken);
+        }
+
+        // software decoders can still make them
+        LOG_RESULT(hr);
+        if (SUCCEEDED(hr))
+        {
+            m_device = spDevice;
+            m_deviceManager = spDeviceManager;
+        }
+    }
+
+    ComPtr<IThreadPoolStatics> spThreadPool;
+    IFR(GetActivationFactory(
+        Wrappers::HStringReference(RuntimeClass_Windows_System_Threading_ThreadPool).Get(),
+        &spThreadPool));
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+        m_fnProgress = fnProgress;
+        m_workersRunning = 1;
+    }
+
+    // the work items hold the generator, it outlives a player that cancelled it
+    auto spThis = shared_from_this();
+    auto workItem = Callback<IWorkItemHandler>(
+        [spThis](_In_ IAsyncAction*) -> HRESULT
+    {
+        HRESULT hr = MFStartup(MF_VERSION, MFSTARTUP_LITE);
+        if (SUCCEEDED(hr))
+        {
+            hr = spThis->Prepare();
+            MFShutdown();
+        }
+
+        spThis->OnWorkerDone(hr);
+
+        return S_OK;
+    });
+
+    // thumbnails are never more urgent than playback
+    ComPtr<IAsyncAction> spAction;
+    HRESULT hr = spThreadPool->RunWithPriorityAsync(workItem.Get(), WorkItemPriority::WorkItemPriority_Low, &spAction);
+    if (FAILED(hr))
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+        m_fnProgress = nullptr;
+        m_workersRunning = 0;
+        m_result = hr;
+        IFR(hr);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CThumbnailGenerator::Cancel()
+{
+    m_cancelled = true;
+
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+    m_fnProgress = nullptr;
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailGenerator::GetThumbnails(
+    PLAYBACK_THUMBNAILS* pInfo,
+    BYTE* pPixels,
+    UINT32 size,
+    INT64* pTimes,
+    UINT32 capacity)
+{
+    NULL_CHK(pInfo);
+
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+    ZeroMemory(pInfo, sizeof(*pInfo));
+    pInfo->count = m_atlas.GetCount();
+    pInfo->completed = m_completed;
+    pInfo->columns = m_atlas.GetColumns();
+    pInfo->rows = m_atlas.GetRows();
+    pInfo->cellWidth = m_atlas.GetCellWidth();
+    pInfo->cellHeight = m_atlas.GetCellHeight();
+    pInfo->width = m_atlas.GetWidth();
+    pInfo->height = m_atlas.GetHeight();
+    pInfo->hresult = m_result;
+    pInfo->fromCache = m_fromCache ? 1 : 0;
+
+    if (nullptr != pPixels)
+    {
+        if (size < m_atlas.GetPixelsSize())
+            IFR(E_INVALIDARG);
+
+        memcpy(pPixels, m_atlas.GetPixels(), m_atlas.GetPixelsSize());
+    }
+
+    if (nullptr != pTimes)
+    {
+        const std::vector<int64_t>& times = m_atlas.GetTimes();
+        const size_t copied = (capacity < times.size()) ? capacity : times.size();
+        for (size_t i = 0; i < copied; ++i)
+        {
+            pTimes[i] = times[i];
+        }
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailGenerator::CreateTexture(
+    ID3D11Device* pDevice,
+    ID3D11ShaderResourceView** ppTextureSRV)
+{
+    NULL_CHK(pDevice);
+    NULL_CHK(ppTextureSRV);
+
+    *ppTextureSRV = nullptr;
+
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+    // a snapshot, cells decoded after it need another texture
+    CD3D11_TEXTURE2D_DESC desc(
+        DXGI_FORMAT_B8G8R8A8_UNORM,
+        m_atlas.GetWidth(),
+        m_atlas.GetHeight(),
+        1,
+        1,
+        D3D11_BIND_SHADER_RESOURCE,
+        D3D11_USAGE_IMMUTABLE);
+
+    D3D11_SUBRESOURCE_DATA data;
+    data.pSysMem = m_atlas.GetPixels();
+    data.SysMemPitch = m_atlas.GetRowPitch();
+    data.SysMemSlicePitch = 0;
+
+    ComPtr<ID3D11Texture2D> spTexture;
+    IFR(pDevice->CreateTexture2D(&desc, &data, &spTexture));
+
+    auto srvDesc = CD3D11_SHADER_RESOURCE_VIEW_DESC(spTexture.Get(), D3D11_SRV_DIMENSION_TEXTURE2D);
+    IFR(pDevice->CreateShaderResourceView(spTexture.Get(), &srvDesc, ppTextureSRV));
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailGenerator::Prepare()
+{
+    TRACE_SCOPE("PrepareThumbnails", m_traceId);
+
+    ComPtr<IMFSourceReader> spReader;
+    IFR(CreateSourceReader(&spReader));
+    IFR(SetOutputType(spReader.Get()));
+
+    INT64 duration = 0;
+    PROPVARIANT value;
+    PropVariantInit(&value);
+    if (SUCCEEDED(spReader->GetPresentationAttribute(MF_SOURCE_READER_MEDIASOURCE, MF_PD_DURATION, &value))
+        && VT_UI8 == value.vt)
+    {
+        duration = static_cast<INT64>(value.uhVal.QuadPart);
+    }
+    PropVariantClear(&value);
+
+    // with the keyframes known, times that land on the same one are decoded once
+    std::vector<int64_t> keyframes;
+    int64_t frameDuration = 0;
+    std::wstring path;
+    if (GetLocalPath(m_url.c_str(), &path))
+    {
+        LOG_RESULT(ReadKeyframeTimes(path.c_str(), &keyframes, &frameDuration));
+    }
+
+    std::vector<int64_t> times;
+    GetThumbnailTimes(duration, m_atlas.GetCount(), keyframes, &times);
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+        for (UINT32 i = 0; i < times.size(); ++i)
+        {
+            if (i > 0 && times[i] == times[i - 1])
+            {
+                continue;
+            }
+
+            m_times[i] = times[i];
+            m_decodeOrder.push_back(i);
+        }
+
+        m_workers = (m_decodeOrder.size() < PLAYBACK_THUMBNAIL_WORKERS) ? static_cast<UINT32>(m_decodeOrder.size()) : PLAYBACK_THUMBNAIL_WORKERS;
+    }
+
+    IFR(RunWorkers(m_workers));
+
+    return DecodeThumbnails(0, spReader.Get());
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailGenerator::RunWorkers(
+    UINT32 workers)
+{
+    if (workers < 2)
+    {
+        return S_OK;
+    }
+
+    ComPtr<IThreadPoolStatics> spThreadPool;
+    IFR(GetActivationFactory(
+        Wrappers::HStringReference(RuntimeClass_Windows_System_Threading_ThreadPool).Get(),
+        &spThreadPool));
+
+    // the first worker is the one that prepared, it keeps its source reader
+    for (UINT32 worker = 1; worker < workers; ++worker)
+    {
+        auto spThis = shared_from_this();
+        auto workItem = Callback<IWorkItemHandler>(
+            [spThis, worker](_In_ IAsyncAction*) -> HRESULT
+        {
+            HRESULT hr = MFStartup(MF_VERSION, MFSTARTUP_LITE);
+            if (SUCCEEDED(hr))
+            {
+                ComPtr<IMFSourceReader> spReader;
+                hr = spThis->CreateSourceReader(&spReader);
+                if (SUCCEEDED(hr))
+                {
+                    hr = spThis->SetOutputType(spReader.Get());
+                }
+
+                if (SUCCEEDED(hr))
+                {
+                    hr = spThis->DecodeThumbnails(worker, spReader.Get());
+                }
+
+                spReader.Reset();
+                MFShutdown();
+            }
+
+            spThis->OnWorkerDone(hr);
+
+            return S_OK;
+        });
+
+        {
+            std::lock_guard<std::recursive_mutex> lock(m_lock);
+            ++m_workersRunning;
+        }
+
+        ComPtr<IAsyncAction> spAction;
+        HRESULT hr = spThreadPool->RunWithPriorityAsync(workItem.Get(), WorkItemPriority::WorkItemPriority_Low, &spAction);
+        if (FAILED(hr))
+        {
+            std::lock_guard<std::recursive_mutex> lock(m_lock);
+            --m_workersRunning;
+            IFR(hr);
+        }
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailGenerator::DecodeThumbnails(
+    UINT32 worker,
+    IMFSourceReader* pReader)
+{
+    // m_decodeOrder and m_workers are set before any worker starts
+    for (size_t next = worker; next < m_decodeOrder.size(); next += m_workers)
+    {
+        if (m_cancelled)
+        {
+            return S_OK;
+        }
+
+        const UINT32 index = m_decodeOrder[next];
+        TRACE_SCOPE_ARG("DecodeThumbnail", m_traceId, index);
+
+        PROPVARIANT position;
+        PropVariantInit(&position);
+        position.vt = VT_I8;
+        position.hVal.QuadPart = m_times[index];
+        IFR(pReader->SetCurrentPosition(GUID_NULL, position));
+
+        // the source lands on the keyframe at or before the position, and its
+        // frame is the first one out of the decoder
+        ComPtr<IMFSample> spSample;
+        LONGLONG timestamp = 0;
+        DWORD flags = 0;
+        while (nullptr == spSample)
+        {
+            IFR(pReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, nullptr, &flags, &timestamp, &spSample));
+            if (0 != (flags & (MF_SOURCE_READERF_ENDOFSTREAM | MF_SOURCE_READERF_ERROR)))
+            {
+                break;
+            }
+        }
+
+        // past the last frame, the cell stays black
+        if (nullptr != spSample)
+        {
+            IFR(PlaceSample(index, timestamp, pReader, spSample.Get()));
+        }
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailGenerator::CreateSourceReader(
+    IMFSourceReader** ppReader)
+{
+    NULL_CHK(ppReader);
+
+    *ppReader = nullptr;
+
+    ComPtr<IMFAttributes> spAttributes;
+    IFR(MFCreateAttributes(&spAttributes, 4));
+
+    // converts to rgb32 and scales, see SetOutputType
+    IFR(spAttributes->SetUINT32(MF_SOURCE_READER_ENABLE_ADVANCED_VIDEO_PROCESSING, TRUE));
+
+    // one frame is decoded per seek, the decoder shouldn't hold it back waiting for more
+    IFR(spAttributes->SetUINT32(MF_LOW_LATENCY, TRUE));
+
+    if (nullptr != m_deviceManager)
+    {
+        IFR(spAttributes->SetUnknown(MF_SOURCE_READER_D3D_MANAGER, m_deviceManager.Get()));
+        IFR(spAttributes->SetUINT32(MF_READWRITE_ENABLE_HARDWARE_TRANSFORMS, TRUE));
+    }
+
+    // local files are read out of a mapped view, paging in only what each seek touches
+    ComPtr<IMFSourceReader> spReader;
+    std::wstring path;
+    HRESULT hr = E_FAIL;
+    if (GetLocalPath(m_url.c_str(), &path) && nullptr != GetMappedContentType(path.c_str()))
+    {
+        hr = CreateMappedSourceReader(path.c_str(), spAttributes.Get(), &spReader);
+        LOG_RESULT(hr);
+    }
+
+    if (FAILED(hr))
+    {
+        IFR(MFCreateSourceReaderFromURL(m_url.c_str(), spAttributes.Get(), &spReader));
+    }
+
+    IFR(spReader->SetStreamSelection(static_cast<DWORD>(MF_SOURCE_READER_ALL_STREAMS), FALSE));
+    IFR(spReader->SetStreamSelection(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), TRUE));
+
+    *ppReader = spReader.Detach();
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailGenerator::SetOutputType(
+    IMFSourceReader* pReader)
+{
+    ComPtr<IMFMediaType> spNativeType;
+    IFR(pReader->GetNativeMediaType(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), 0, &spNativeType));
+
+    UINT32 width = 0;
+    UINT32 height = 0;
+    IFR(MFGetAttributeSize(spNativeType.Get(), MF_MT_FRAME_SIZE, &width, &height));
+
+    UINT32 aspectNumerator = 1;
+    UINT32 aspectDenominator = 1;
+    if (FAILED(MFGetAttributeRatio(spNativeType.Get(), MF_MT_PIXEL_ASPECT_RATIO, &aspectNumerator, &aspectDenominator))
+        || 0 == aspectNumerator || 0 == aspectDenominator)
+    {
+        aspectNumerator = 1;
+        aspectDenominator = 1;
+    }
+
+    UINT32 fitWidth = 0;
+    UINT32 fitHeight = 0;
+    m_atlas.GetFitSize(
+        static_cast<UINT32>(static_cast<UINT64>(width) * aspectNumerator / aspectDenominator),
+        height,
+        &fitWidth,
+        &fitHeight);
+
+    ComPtr<IMFMediaType> spType;
+    IFR(MFCreateMediaType(&spType));
+    IFR(spType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+    IFR(spType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_RGB32));
+    IFR(MFSetAttributeSize(spType.Get(), MF_MT_FRAME_SIZE, fitWidth, fitHeight));
+    IFR(MFSetAttributeRatio(spType.Get(), MF_MT_PIXEL_ASPECT_RATIO, 1, 1));
+
+    // the video processor scales on the way out of the decoder. If it can't,
+    // frames come out full size and the atlas scales them on the cpu.
+    HRESULT hr = pReader->SetCurrentMediaType(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), nullptr, spType.Get());
+    if (FAILED(hr))
+    {
+        IFR(spType->DeleteItem(MF_MT_FRAME_SIZE));
+        IFR(spType->DeleteItem(MF_MT_PIXEL_ASPECT_RATIO));
+        IFR(pReader->SetCurrentMediaType(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), nullptr, spType.Get()));
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CThumbnailGenerator::PlaceSample(
+    UINT32 index,
+    INT64 timestamp,
+    IMFSourceReader* pReader,
+    IMFSample* pSample)
+{
+    // the size can change with the stream, it's read for every frame
+    ComPtr<IMFMediaType> spType;
+    IFR(pReader->GetCurrentMediaType(static_cast<DWORD>(MF_SOURCE_READER_FIRST_VIDEO_STREAM), &spType));
+
+    UINT32 width = 0;
+    UINT32 height = 0;
+    IFR(MFGetAttributeSize(spType.Get(), MF_MT_FRAME_SIZE, &width, &height));
+
+    ComPtr<IMFMediaBuffer> spBuffer;
+    IFR(pSample->ConvertToContiguousBuffer(&spBuffer));
+
+    // scaled into a cell of its own, the atlas is only locked for the copy
+    CThumbnailAtlas cell;
+    if (!cell.Initialize(1, m_atlas.GetCellWidth(), m_atlas.GetCellHeight()))
+        IFR(E_UNEXPECTED);
+
+    ComPtr<IMF2DBuffer> sp2DBuffer;
+    if (SUCCEEDED(spBuffer.As(&sp2DBuffer)))
+    {
+        BYTE* pScanline0 = nullptr;
+        LONG pitch = 0;
+        IFR(sp2DBuffer->Lock2D(&pScanline0, &pitch));
+
+        cell.Place(0, timestamp, pScanline0, pitch, width, height);
+
+        LOG_RESULT(sp2DBuffer->Unlock2D());
+    }
+    else
+    {
+        // a negative default stride is a bottom up picture
+        const INT32 stride = static_cast<INT32>(MFGetAttributeUINT32(spType.Get(), MF_MT_DEFAULT_STRIDE, width * 4));
+        const UINT32 rowSize = static_cast<UINT32>((stride < 0) ? -stride : stride);
+
+        BYTE* pData = nullptr;
+        DWORD length = 0;
+        IFR(spBuffer->Lock(&pData, nullptr, &length));
+
+        if (rowSize >= width * 4 && static_cast<UINT64>(length) >= static_cast<UINT64>(rowSize) * height)
+        {
+            BYTE* pFirstRow = (stride < 0) ? pData + static_cast<size_t>(height - 1) * rowSize : pData;
+            cell.Place(0, timestamp, pFirstRow, stride, width, height);
+        }
+
+        LOG_RESULT(spBuffer->Unlock());
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+    m_atlas.CopyCell(cell, 0, index);
+    ++m_completed;
+
+    // later times that snapped to the same keyframe
+    const UINT32 count = m_atlas.GetCount();
+    for (UINT32 repeat = index + 1; repeat < count && -1 == m_times[repeat]; ++repeat)
+    {
+        m_atlas.CopyCell(m_atlas, index, repeat);
+        ++m_completed;
+    }
+
+    const UINT32 step = (count > PLAYBACK_THUMBNAIL_PROGRESS_STEPS) ? count / PLAYBACK_THUMBNAIL_PROGRESS_STEPS : 1;
+    if (m_completed < count && m_completed >= m_notified + step)
+    {
+        m_notified = m_completed;
+        Notify(m_completed, E_PENDING);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+void CThumbnailGenerator::OnWorkerDone(
+    HRESULT hr)
+{
+    LOG_RESULT(hr);
+
+    std::vector<uint8_t> cache;
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+        if (FAILED(hr) && SUCCEEDED(m_workerResult))
+        {
+            m_workerResult = hr;
+        }
+
+        if (0 != --m_workersRunning)
+        {
+            return;
+        }
+
+        if (m_cancelled)
+        {
+            m_result = E_ABORT;
+            return;
+        }
+
+        // some thumbnails are better than none, the cells that failed stay black
+        m_result = (m_completed > 0 || SUCCEEDED(m_workerResult)) ? S_OK : m_workerResult;
+
+        // only a complete atlas is worth keeping
+        if (m_completed == m_atlas.GetCount() && !m_cachePath.empty())
+        {
+            m_atlas.Serialize(m_cacheKey, &cache);
+        }
+
+        TraceInstant("ThumbnailsCompleted", m_traceId, m_completed);
+
+        Notify(m_completed, m_result);
+    }
+
+    if (!cache.empty())
+    {
+        WriteCache(cache);
+    }
+}
+
+_Use_decl_annotations_
+void CThumbnailGenerator::Notify(
+    UINT32 completed,
+    HRESULT hr)
+{
+    // m_lock held, Cancel waits for the callback to return
+    if (nullptr != m_fnProgress && !m_cancelled)
+    {
+        m_fnProgress(completed, m_atlas.GetCount(), hr);
+    }
+}
+
+_Use_decl_annotations_
+bool CThumbnailGenerator::ReadCache()
+{
+    if (m_cachePath.empty())
+    {
+        return false;
+    }
+
+    Wrappers::FileHandle file(CreateFileW(
+        m_cachePath.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr));
+    if (!file.IsValid())
+    {
+        return false;
+    }
+
+    // the header, the times and the pixels, anything larger isn't this atlas
+    LARGE_INTEGER size;
+    const UINT64 expected = m_atlas.GetPixelsSize() + static_cast<UINT64>(m_atlas.GetCount()) * 8 + 4096;
+    if (!GetFileSizeEx(file.Get(), &size) || size.QuadPart <= 0 || static_cast<UINT64>(size.QuadPart) > expected)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> data(static_cast<size_t>(size.QuadPart));
+    DWORD read = 0;
+    if (!ReadFile(file.Get(), data.data(), static_cast<DWORD>(data.size()), &read, nullptr) || read != data.size())
+    {
+        return false;
+    }
+
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+
+    if (!m_atlas.Deserialize(m_cacheKey, data.data(), data.size()))
+    {
+        return false;
+    }
+
+    m_completed = m_atlas.GetCount();
+    m_result = S_OK;
+    m_fromCache = true;
+
+    return true;
+}
+
+_Use_decl_annotations_
+void CThumbnailGenerator::WriteCache(
+    const std::vector<uint8_t>& data)
+{
+    const std::wstring directory = m_cachePath.substr(0, m_cachePath.find_last_of(L'\\'));
+    if (!CreateDirectoryW(directory.c_str(), nullptr) && ERROR_ALREADY_EXISTS != GetLastError())
+    {
+        LOG_RESULT(HRESULT_FROM_WIN32(GetLastError()));
+        return;
+    }
+
+    // written aside and moved in, a reader never sees half a file
+    const std::wstring tempPath = m_cachePath + L".tmp";
+    {
+        Wrappers::FileHandle file(CreateFileW(
+            tempPath.c_str(),
+            GENERIC_WRITE,
+            0,
+            nullptr,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            nullptr));
+        if (!file.IsValid())
+        {
+            // another request for the same video is writing it
+            return;
+        }
+
+        DWORD written = 0;
+        if (!WriteFile(file.Get(), data.data(), static_cast<DWORD>(data.size()), &written, nullptr) || written != data.size())
+        {
+            LOG_RESULT(HRESULT_FROM_WIN32(GetLastError()));
+            file.Close();
+            DeleteFileW(tempPath.c_str());
+            return;
+        }
+    }
+
+    if (!MoveFileExW(tempPath.c_str(), m_cachePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        LOG_RESULT(HRESULT_FROM_WIN32(GetLastError()));
+        DeleteFileW(tempPath.c_str());
+    }
+}
@@ -0,0 +1,130 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "MediaHelpers.h"
+#include "ThumbnailAtlas.h"
+
+#include <functional>
+#include <mfreadwrite.h>
+
+// Thumbnails for a scrub bar, decoded apart from the player that asked for
+// them: media foundation source readers on their own device, each on a
+// thread pool work item, seek to a keyframe and decode that one frame. The
+// pictures are packed into a CThumbnailAtlas, which is written to a cache
+// directory once complete. Local files are keyed by path, size and last
+// write time, so the next request for the same video is read back from it.
+
+// source readers decoding one request side by side
+#define PLAYBACK_THUMBNAIL_WORKERS 4
+
+#define PLAYBACK_THUMBNAIL_MAX_COUNT 1024
+
+// progress events per request, besides the one when it completes
+#define PLAYBACK_THUMBNAIL_PROGRESS_STEPS 16
+
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_THUMBNAILS
+{
+    UINT32 count;
+    UINT32 completed;           // cells filled so far, the rest are black
+    UINT32 columns;
+    UINT32 rows;
+    UINT32 cellWidth;
+    UINT32 cellHeight;
+    UINT32 width;               // atlas, 32bpp bgra, top row first
+    UINT32 height;
+    HRESULT hresult;            // E_PENDING while decoding, S_OK once complete
+    UINT32 fromCache;           // read back from the cache directory
+} PLAYBACK_THUMBNAILS;
+#pragma pack(pop)
+
+// worker threads, on every PLAYBACK_THUMBNAIL_PROGRESS_STEPS of the count and when done
+typedef std::function<void(UINT32 completed, UINT32 count, HRESULT hr)> ThumbnailProgressCallback;
+
+class CThumbnailGenerator : public std::enable_shared_from_this<CThumbnailGenerator>
+{
+public:
+    CThumbnailGenerator();
+    ~CThumbnailGenerator();
+
+    // reads the cache or starts the workers. pAdapter picks the gpu that
+    // decodes, software decoders are used without one.
+    HRESULT Start(
+        _In_ LPCWSTR pszContentLocation,
+        _In_ UINT32 count,
+        _In_ UINT32 cellWidth,
+        _In_ UINT32 cellHeight,
+        _In_opt_ IDXGIAdapter* pAdapter,
+        _In_ UINT32 traceId,
+        _In_ ThumbnailProgressCallback fnProgress);
+
+    // stops the workers at their next thumbnail. The callback is not called
+    // once it returns, the atlas so far can still be read.
+    void Cancel();
+
+    // pass null pixels and times to get the size of the atlas
+    HRESULT GetThumbnails(
+        _Out_ PLAYBACK_THUMBNAILS* pInfo,
+        _Out_writes_bytes_opt_(size) BYTE* pPixels,
+        _In_ UINT32 size,
+        _Out_writes_opt_(capacity) INT64* pTimes,
+        _In_ UINT32 capacity);
+
+    HRESULT CreateTexture(
+        _In_ ID3D11Device* pDevice,
+        _COM_Outptr_ ID3D11ShaderResourceView** ppTextureSRV);
+
+private:
+    // the first worker opens the source and picks the times before the others start
+    HRESULT Prepare();
+    HRESULT RunWorkers(_In_ UINT32 workers);
+    HRESULT DecodeThumbnails(_In_ UINT32 worker, _In_ IMFSourceReader* pReader);
+    HRESULT CreateSourceReader(_COM_Outptr_ IMFSourceReader** ppReader);
+    HRESULT SetOutputType(_In_ IMFSourceReader* pReader);
+    HRESULT PlaceSample(_In_ UINT32 index, _In_ INT64 timestamp, _In_ IMFSourceReader* pReader, _In_ IMFSample* pSample);
+    void OnWorkerDone(_In_ HRESULT hr);
+    void Notify(_In_ UINT32 completed, _In_ HRESULT hr);
+
+    bool ReadCache();
+    void WriteCache(_In_ const std::vector<uint8_t>& data);
+
+private:
+    UINT32 m_traceId;
+    std::wstring m_url;
+    std::wstring m_cachePath;       // empty for urls that aren't local files
+    UINT64 m_cacheKey;
+
+    Microsoft::WRL::ComPtr<IMFDXGIDeviceManager> m_deviceManager;
+    Microsoft::WRL::ComPtr<ID3D11Device> m_device;
+
+    // m_atlas and the counts, the callback is called under it so Cancel can wait it out
+    std::recursive_mutex m_lock;
+    CThumbnailAtlas m_atlas;
+    std::vector<int64_t> m_times;   // where each cell is decoded from, -1 for a repeat of the cell before
+    std::vector<UINT32> m_decodeOrder;
+    UINT32 m_workers;
+    UINT32 m_completed;
+    UINT32 m_notified;
+    UINT32 m_workersRunning;
+    HRESULT m_result;
+    HRESULT m_workerResult;         // first worker that failed
+    bool m_fromCache;
+    ThumbnailProgressCallback m_fnProgress;
+
+    std::atomic<bool> m_cancelled;
+};
+
+// where completed atlases are kept, created when first written to.
+// Defaults to a folder in the user's temp directory.
+HRESULT SetThumbnailCacheDirectory(
+    _In_ LPCWSTR pszDirectory);
@@ -0,0 +1,216 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// portable, built without the precompiled header
+#include "Trace.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> g_traceEnabled(false);
+
+namespace
+{
+    static_assert(0 == (TRACE_THREAD_CAPACITY & (TRACE_THREAD_CAPACITY - 1)), "capacity must be a power of two");
+
+    const uint64_t TraceMask = TRACE_THREAD_CAPACITY - 1;
+
+    // fields are relaxed atomics so TraceToJson can copy a ring while its
+    // thread keeps writing, torn slots are detected and dropped
+    struct TraceSlot
+    {
+        std::atomic<int64_t> timestamp;
+        std::atomic<const char*> name;
+        std::atomic<int64_t> arg;
+        std::atomic<uint32_t> id;
+        std::atomic<uint8_t> phase;
+    };
+
+    // written only by its thread. started counts writes begun, head writes finished,
+    // a reader trusts a slot only if no write started since cannot have reached it
+    struct TraceThreadBuffer
+    {
+        explicit TraceThreadBuffer(uint32_t threadIndex)
+            : thread(threadIndex)
+            , started(0)
+            , head(0)
+        {
+        }
+
+        uint32_t thread;
+        std::atomic<uint64_t> started;
+        std::atomic<uint64_t> head;
+        TraceSlot slots[TRACE_THREAD_CAPACITY];
+    };
+
+    struct TraceEvent
+    {
+        int64_t timestamp;
+        const char* name;
+        int64_t arg;
+        uint32_t id;
+        uint8_t phase;
+    };
+
+    // rings outlive their threads, the media foundation pool reuses a handful of threads
+    std::mutex s_buffersLock;
+    std::vector<std::unique_ptr<TraceThreadBuffer>> s_buffers;
+
+    thread_local TraceThreadBuffer* t_buffer = nullptr;
+
+    const std::chrono::steady_clock::time_point s_origin = std::chrono::steady_clock::now();
+
+    TraceThreadBuffer* RegisterThread()
+    {
+        std::lock_guard<std::mutex> lock(s_buffersLock);
+
+        s_buffers.emplace_back(new TraceThreadBuffer(static_cast<uint32_t>(s_buffers.size() + 1)));
+        t_buffer = s_buffers.back().get();
+
+        return t_buffer;
+    }
+
+    // copies the events still intact in one ring, oldest first
+    void CopyEvents(const TraceThreadBuffer& buffer, std::vector<TraceEvent>* pEvents)
+    {
+        uint64_t head = buffer.head.load(std::memory_order_acquire);
+        uint64_t begin = (head > TRACE_THREAD_CAPACITY) ? head - TRACE_THREAD_CAPACITY : 0;
+
+        size_t first = pEvents->size();
+        for (uint64_t i = begin; i < head; ++i)
+        {
+            const TraceSlot& slot = buffer.slots[i & TraceMask];
+
+            TraceEvent e;
+            e.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+            e.name = slot.name.load(std::memory_order_relaxed);
+            e.arg = slot.arg.load(std::memory_order_relaxed);
+            e.id = slot.id.load(std::memory_order_relaxed);
+            e.phase = slot.phase.load(std::memory_order_relaxed);
+            pEvents->push_back(e);
+        }
+
+        // the thread may have lapped us while copying. Write n reuses the slot
+        // of index n - capacity, so anything below started - capacity is suspect
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t started = buffer.started.load(std::memory_order_relaxed);
+        uint64_t valid = (started > TRACE_THREAD_CAPACITY) ? started - TRACE_THREAD_CAPACITY : 0;
+        if (valid > begin)
+        {
+            uint64_t torn = (valid < head ? valid : head) - begin;
+            pEvents->erase(pEvents->begin() + first, pEvents->begin() + first + static_cast<size_t>(torn));
+        }
+    }
+
+    void AppendEscaped(std::string* pJson, const char* text)
+    {
+        for (const char* p = text; *p != '\0'; ++p)
+        {
+            if ('"' == *p || '\\' == *p)
+            {
+                pJson->push_back('\\');
+            }
+            pJson->push_back(*p);
+        }
+    }
+}
+
+void TraceSetEnabled(bool enabled)
+{
+    g_traceEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+void TraceRecord(TracePhase phase, const char* name, uint32_t id, int64_t arg)
+{
+    TraceThreadBuffer* pBuffer = t_buffer;
+    if (nullptr == pBuffer)
+    {
+        pBuffer = RegisterThread();
+    }
+
+    int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_origin).count();
+
+    uint64_t head = pBuffer->head.load(std::memory_order_relaxed);
+    TraceSlot& slot = pBuffer->slots[head & TraceMask];
+
+    // announce the overwrite before touching the slot, see CopyEvents
+    pBuffer->started.store(head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.timestamp.store(timestamp, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.arg.store(arg, std::memory_order_relaxed);
+    slot.id.store(id, std::memory_order_relaxed);
+    slot.phase.store(static_cast<uint8_t>(phase), std::memory_order_relaxed);
+
+    pBuffer->head.store(head + 1, std::memory_order_release);
+}
+
+std::string TraceToJson()
+{
+    std::vector<std::pair<uint32_t, std::vector<TraceEvent>>> threads;
+    {
+        std::lock_guard<std::mutex> lock(s_buffersLock);
+
+        threads.reserve(s_buffers.size());
+        for (const auto& spBuffer : s_buffers)
+        {
+            threads.emplace_back(spBuffer->thread, std::vector<TraceEvent>());
+            CopyEvents(*spBuffer, &threads.back().second);
+        }
+    }
+
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    char number[128];
+
+    for (const auto& thread : threads)
+    {
+        for (const TraceEvent& e : thread.second)
+        {
+            if (nullptr == e.name)
+            {
+                continue;
+            }
+
+            json += first ? "\n" : ",\n";
+            first = false;
+
+            json += "{\"name\":\"";
+            AppendEscaped(&json, e.name);
+
+            // ts is in microseconds
+            snprintf(number, sizeof(number),
+                "\",\"ph\":\"%c\",\"ts\":%" PRId64 ".%03d,\"pid\":1,\"tid\":%u",
+                static_cast<char>(e.phase),
+                e.timestamp / 1000,
+                static_cast<int>(e.timestamp % 1000),
+                thread.first);
+            json += number;
+
+            if (static_cast<uint8_t>(TracePhase::TracePhase_Instant) == e.phase)
+            {
+                json += ",\"s\":\"t\"";
+            }
+
+            snprintf(number, sizeof(number), ",\"args\":{\"player\":%u,\"value\":%" PRId64 "}}", e.id, e.arg);
+            json += number;
+        }
+    }
+
+    json += "\n]}\n";
+
+    return json;
+}
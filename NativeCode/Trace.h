@@ -0,0 +1,92 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Timestamped begin / end / instant events in a binary ring per thread, for
+// the spots where Log would be too slow to leave on. Recording is a clock
+// read and a few stores into the calling thread's ring, no lock, no
+// formatting; TraceToJson turns the rings into chrome://tracing json later.
+//
+// Names must be string literals, only the pointer is stored.
+
+enum class TracePhase : uint8_t
+{
+    TracePhase_Begin = 'B',
+    TracePhase_End = 'E',
+    TracePhase_Instant = 'i',
+};
+
+// events per thread, older ones are overwritten
+#define TRACE_THREAD_CAPACITY 4096
+
+extern std::atomic<bool> g_traceEnabled;
+
+void TraceSetEnabled(bool enabled);
+
+void TraceRecord(TracePhase phase, const char* name, uint32_t id, int64_t arg);
+
+// chrome trace_event json of everything still in the rings
+std::string TraceToJson();
+
+inline bool TraceIsEnabled()
+{
+    return g_traceEnabled.load(std::memory_order_relaxed);
+}
+
+inline void TraceInstant(const char* name, uint32_t id, int64_t arg = 0)
+{
+    if (TraceIsEnabled())
+    {
+        TraceRecord(TracePhase::TracePhase_Instant, name, id, arg);
+    }
+}
+
+// begin on construction, end on destruction. Tracing turned on mid scope
+// records neither, so begin and end always pair up.
+class CTraceScope
+{
+public:
+    CTraceScope(const char* name, uint32_t id, int64_t arg = 0)
+        : m_name(TraceIsEnabled() ? name : nullptr)
+        , m_id(id)
+    {
+        if (nullptr != m_name)
+        {
+            TraceRecord(TracePhase::TracePhase_Begin, m_name, m_id, arg);
+        }
+    }
+
+    ~CTraceScope()
+    {
+        if (nullptr != m_name)
+        {
+            TraceRecord(TracePhase::TracePhase_End, m_name, m_id, 0);
+        }
+    }
+
+private:
+    CTraceScope(const CTraceScope&);
+    CTraceScope& operator=(const CTraceScope&);
+
+    const char* m_name;
+    uint32_t m_id;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name, id) CTraceScope TRACE_CONCAT(traceScope, __LINE__)(name, id)
+#define TRACE_SCOPE_ARG(name, id, arg) CTraceScope TRACE_CONCAT(traceScope, __LINE__)(name, id, arg)
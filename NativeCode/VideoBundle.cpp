@@ -0,0 +1,441 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+#include "VideoBundle.h"
+#include "MappedByteStream.h"
+#include "MediaHelpers.h"
+
+#include <string>
+
+using namespace Microsoft::WRL;
+
+// bundles stay mapped here between loads, keyed by their full path in lower case
+static std::mutex s_bundleLock;
+static std::map<std::wstring, std::shared_ptr<CVideoBundle>> s_bundles;
+
+// writes the bundle through a handle of its own, keeping the first error
+class CFileBundleWriter
+    : public IVideoBundleWriter
+{
+public:
+    CFileBundleWriter()
+        : m_result(S_OK)
+    {
+    }
+
+    HRESULT Create(
+        _In_ LPCWSTR pszPath)
+    {
+        m_file.Attach(CreateFileW(
+            pszPath,
+            GENERIC_WRITE,
+            0,
+            nullptr,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr));
+        if (!m_file.IsValid())
+        {
+            IFR(HRESULT_FROM_WIN32(GetLastError()));
+        }
+
+        return S_OK;
+    }
+
+    void Close()
+    {
+        m_file.Close();
+    }
+
+    HRESULT GetResult() const
+    {
+        return m_result;
+    }
+
+    // IVideoBundleWriter
+    bool Write(const void* pData, size_t size) override
+    {
+        // the index and the copies of the clips are written a megabyte or less at a time
+        DWORD written = 0;
+        if (size > MAXDWORD || !WriteFile(m_file.Get(), pData, static_cast<DWORD>(size), &written, nullptr) || written != size)
+        {
+            m_result = HRESULT_FROM_WIN32(GetLastError());
+            m_result = SUCCEEDED(m_result) ? HRESULT_FROM_WIN32(ERROR_WRITE_FAULT) : m_result;
+            return false;
+        }
+
+        return true;
+    }
+
+private:
+    Wrappers::FileHandle m_file;
+    HRESULT m_result;
+};
+
+static HRESULT ToUtf8(
+    _In_ const std::wstring& value,
+    _Out_ std::string* pValue)
+{
+    pValue->clear();
+
+    if (value.empty())
+    {
+        return S_OK;
+    }
+
+    const int length = WideCharToMultiByte(CP_UTF8, WC_ERR_INVALID_CHARS, value.c_str(), static_cast<int>(value.size()), nullptr, 0, nullptr, nullptr);
+    if (0 == length)
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    pValue->resize(static_cast<size_t>(length));
+    if (0 == WideCharToMultiByte(CP_UTF8, WC_ERR_INVALID_CHARS, value.c_str(), static_cast<int>(value.size()), &(*pValue)[0], length, nullptr, nullptr))
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    return S_OK;
+}
+
+// names in the index use '/' whatever they were packed or asked for with
+static HRESULT GetClipName(
+    _In_ LPCWSTR pszName,
+    _Out_ std::string* pName)
+{
+    std::wstring name(pszName);
+    for (auto& c : name)
+    {
+        c = (L'\\' == c) ? L'/' : c;
+    }
+
+    return ToUtf8(name, pName);
+}
+
+static HRESULT GetBundleKey(
+    _In_ LPCWSTR pszBundlePath,
+    _Out_ std::wstring* pKey)
+{
+    WCHAR szPath[MAX_PATH * 4];
+    const DWORD length = GetFullPathNameW(pszBundlePath, ARRAYSIZE(szPath), szPath, nullptr);
+    if (0 == length)
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    if (length >= ARRAYSIZE(szPath))
+        IFR(HRESULT_FROM_WIN32(ERROR_FILENAME_EXCED_RANGE));
+
+    CharLowerBuffW(szPath, length);
+    pKey->assign(szPath, length);
+
+    return S_OK;
+}
+
+struct FindHandleTraits
+    : Wrappers::HandleTraits::HANDLETraits
+{
+    static bool Close(_In_ Type h)
+    {
+        return FALSE != FindClose(h);
+    }
+};
+
+// files under directory with a container the mapped stream knows, as paths relative to it
+static HRESULT FindBundleClips(
+    _In_ const std::wstring& directory,
+    _In_ const std::wstring& relative,
+    _Inout_ std::vector<std::wstring>* pClips)
+{
+    WIN32_FIND_DATAW findData;
+    Wrappers::HandleT<FindHandleTraits> find(FindFirstFileExW(
+        (directory + L"\\" + relative + L"*").c_str(),
+        FindExInfoBasic,
+        &findData,
+        FindExSearchNameMatch,
+        nullptr,
+        FIND_FIRST_EX_LARGE_FETCH));
+    if (!find.IsValid())
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    do
+    {
+        const std::wstring name(findData.cFileName);
+        if (0 != (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            if (L"." != name && L".." != name)
+            {
+                IFR(FindBundleClips(directory, relative + name + L"\\", pClips));
+            }
+        }
+        else if (nullptr != GetMappedContentType(name.c_str()))
+        {
+            pClips->push_back(relative + name);
+        }
+    } while (FindNextFileW(find.Get(), &findData));
+
+    const DWORD error = GetLastError();
+    if (ERROR_NO_MORE_FILES != error)
+    {
+        IFR(HRESULT_FROM_WIN32(error));
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT PackVideoBundle(
+    LPCWSTR pszDirectory,
+    LPCWSTR pszBundlePath)
+{
+    NULL_CHK(pszDirectory);
+    NULL_CHK(pszBundlePath);
+
+    std::wstring directory(pszDirectory);
+    while (!directory.empty() && (L'\\' == directory.back() || L'/' == directory.back()))
+    {
+        directory.pop_back();
+    }
+
+    std::vector<std::wstring> clips;
+    IFR(FindBundleClips(directory, std::wstring(), &clips));
+    if (clips.empty())
+    {
+        IFR(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+    }
+
+    std::vector<std::unique_ptr<CFileKeyframeIndexReader>> readers;
+    std::vector<VIDEO_BUNDLE_INPUT> inputs;
+    readers.reserve(clips.size());
+    inputs.reserve(clips.size());
+    for (const auto& clip : clips)
+    {
+        const std::wstring path = directory + L"\\" + clip;
+
+        std::unique_ptr<CFileKeyframeIndexReader> reader(new (std::nothrow) CFileKeyframeIndexReader());
+        NULL_CHK_HR(reader, E_OUTOFMEMORY);
+        IFR(reader->Open(path.c_str()));
+
+        VIDEO_BUNDLE_INPUT input;
+        IFR(GetClipName(clip.c_str(), &input.name));
+        IFR(ToUtf8(GetMappedContentType(path.c_str()), &input.contentType));
+        input.pReader = reader.get();
+
+        inputs.push_back(input);
+        readers.push_back(std::move(reader));
+    }
+
+    // written next to the bundle and moved over it once complete, a failed
+    // pack leaves the previous bundle as it was
+    LOG_RESULT(CloseVideoBundle(pszBundlePath));
+
+    const std::wstring partialPath = std::wstring(pszBundlePath) + L".partial";
+
+    CFileBundleWriter writer;
+    IFR(writer.Create(partialPath.c_str()));
+
+    const bool written = WriteVideoBundle(&inputs, &writer);
+    writer.Close();
+
+    if (!written)
+    {
+        DeleteFileW(partialPath.c_str());
+
+        // a read failed if the writer didn't
+        const HRESULT hr = writer.GetResult();
+        IFR(FAILED(hr) ? hr : HRESULT_FROM_WIN32(ERROR_READ_FAULT));
+    }
+
+    if (!MoveFileExW(partialPath.c_str(), pszBundlePath, MOVEFILE_REPLACE_EXISTING))
+    {
+        const HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+        DeleteFileW(partialPath.c_str());
+        IFR(hr);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT OpenVideoBundle(
+    LPCWSTR pszBundlePath,
+    std::shared_ptr<CVideoBundle>* pBundle)
+{
+    NULL_CHK(pszBundlePath);
+    NULL_CHK(pBundle);
+
+    pBundle->reset();
+
+    std::wstring key;
+    IFR(GetBundleKey(pszBundlePath, &key));
+
+    // mapped under the lock, two players loading from a new bundle at once map it once
+    std::lock_guard<std::mutex> lock(s_bundleLock);
+
+    auto it = s_bundles.find(key);
+    if (it != s_bundles.end())
+    {
+        *pBundle = it->second;
+        return S_OK;
+    }
+
+    auto spBundle = std::make_shared<CVideoBundle>();
+    IFR(spBundle->Open(key.c_str()));
+
+    s_bundles[key] = spBundle;
+    *pBundle = spBundle;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CloseVideoBundle(
+    LPCWSTR pszBundlePath)
+{
+    NULL_CHK(pszBundlePath);
+
+    std::wstring key;
+    IFR(GetBundleKey(pszBundlePath, &key));
+
+    // unmapped outside the lock, once the last stream reading it goes
+    std::shared_ptr<CVideoBundle> spBundle;
+    {
+        std::lock_guard<std::mutex> lock(s_bundleLock);
+
+        auto it = s_bundles.find(key);
+        if (it == s_bundles.end())
+        {
+            return S_FALSE;
+        }
+
+        spBundle = it->second;
+        s_bundles.erase(it);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT GetVideoBundleClip(
+    LPCWSTR pszBundlePath,
+    LPCWSTR pszName,
+    PLAYBACK_BUNDLE_CLIP* pClip)
+{
+    NULL_CHK(pClip);
+
+    ZeroMemory(pClip, sizeof(*pClip));
+
+    std::shared_ptr<CVideoBundle> spBundle;
+    IFR(OpenVideoBundle(pszBundlePath, &spBundle));
+
+    VIDEO_BUNDLE_CLIP clip;
+    IFR(spBundle->FindClip(pszName, &clip));
+
+    pClip->width = clip.width;
+    pClip->height = clip.height;
+    pClip->duration = clip.duration;
+    pClip->frameDuration = clip.frameDuration;
+    pClip->keyframeCount = clip.keyframeCount;
+    pClip->size = clip.size;
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+CVideoBundle::CVideoBundle()
+    : m_pView(nullptr)
+{
+}
+
+_Use_decl_annotations_
+CVideoBundle::~CVideoBundle()
+{
+    if (nullptr != m_pView)
+    {
+        UnmapViewOfFile(m_pView);
+        m_pView = nullptr;
+    }
+}
+
+_Use_decl_annotations_
+HRESULT CVideoBundle::Open(
+    LPCWSTR pszPath)
+{
+    NULL_CHK(pszPath);
+
+    Wrappers::FileHandle file(CreateFileW(
+        pszPath,
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr));
+    if (!file.IsValid())
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file.Get(), &size))
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    if (size.QuadPart < VIDEO_BUNDLE_HEADER_SIZE)
+        IFR(MF_E_INVALID_FILE_FORMAT);
+
+    if (sizeof(void*) < 8 && size.QuadPart > MAPPED_BYTE_STREAM_MAX_VIEW_32BIT)
+        IFR(HRESULT_FROM_WIN32(ERROR_NOT_ENOUGH_MEMORY));
+
+    Wrappers::HandleT<Wrappers::HandleTraits::HANDLENullTraits> mapping(
+        CreateFileMappingW(file.Get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!mapping.IsValid())
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    m_pView = static_cast<const BYTE*>(MapViewOfFile(mapping.Get(), FILE_MAP_READ, 0, 0, 0));
+    if (nullptr == m_pView)
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    // the index is small and read at once, before any clip is
+    if (!m_index.Attach(m_pView, static_cast<uint64_t>(size.QuadPart)))
+    {
+        IFR(MF_E_INVALID_FILE_FORMAT);
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT CVideoBundle::FindClip(
+    LPCWSTR pszName,
+    VIDEO_BUNDLE_CLIP* pClip) const
+{
+    NULL_CHK(pszName);
+    NULL_CHK(pClip);
+
+    std::string name;
+    IFR(GetClipName(pszName, &name));
+
+    if (!m_index.Find(name.data(), name.size(), pClip))
+    {
+        IFR(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+    }
+
+    return S_OK;
+}
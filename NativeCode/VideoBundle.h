@@ -0,0 +1,78 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "BundleIndex.h"
+
+// Bundles of clips played straight out of one mapped view, see BundleIndex.h.
+// The first load from a bundle maps it and checks its index, later loads by
+// any player find it open and only look the clip up, until CloseVideoBundle.
+// Streams still reading a closed bundle keep its view.
+
+#pragma pack(push, 4)
+typedef struct _PLAYBACK_BUNDLE_CLIP
+{
+    UINT32 width;               // 0 for containers that aren't probed when packed
+    UINT32 height;
+    INT64 duration;             // 100ns
+    INT64 frameDuration;
+    UINT32 keyframeCount;
+    UINT32 reserved;
+    UINT64 size;                // bytes of the clip's file
+} PLAYBACK_BUNDLE_CLIP;
+#pragma pack(pop)
+
+class CVideoBundle
+{
+public:
+    CVideoBundle();
+    ~CVideoBundle();
+
+    HRESULT Open(
+        _In_ LPCWSTR pszPath);
+
+    // names are the paths the clips were packed from, relative to the
+    // directory packed, with either separator
+    HRESULT FindClip(
+        _In_ LPCWSTR pszName,
+        _Out_ VIDEO_BUNDLE_CLIP* pClip) const;
+
+    const BYTE* GetView() const
+    {
+        return m_pView;
+    }
+
+private:
+    const BYTE* m_pView;
+    CVideoBundleIndex m_index;
+};
+
+// packs every file under pszDirectory with a container the mapped stream
+// knows (see GetMappedContentType), replacing the bundle once it is written
+HRESULT PackVideoBundle(
+    _In_ LPCWSTR pszDirectory,
+    _In_ LPCWSTR pszBundlePath);
+
+// the open bundle at the path, mapping it if it isn't open yet
+HRESULT OpenVideoBundle(
+    _In_ LPCWSTR pszBundlePath,
+    _Out_ std::shared_ptr<CVideoBundle>* pBundle);
+
+// S_FALSE if it wasn't open
+HRESULT CloseVideoBundle(
+    _In_ LPCWSTR pszBundlePath);
+
+// what a probe of the clip would find, from the index
+HRESULT GetVideoBundleClip(
+    _In_ LPCWSTR pszBundlePath,
+    _In_ LPCWSTR pszName,
+    _Out_ PLAYBACK_BUNDLE_CLIP* pClip);
@@ -0,0 +1,236 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <cstddef>
+#include <cstdint>
+
+// CPU reference for the planar output formats. Mirrors what YUVPlanar.shader
+// does at sample time, so plane layout and matrix math can be checked without a GPU.
+
+enum class YuvMatrix : uint8_t
+{
+    YuvMatrix_BT601 = 0,
+    YuvMatrix_BT709,
+    YuvMatrix_BT2020,
+};
+
+enum class YuvRange : uint8_t
+{
+    YuvRange_Limited = 0,
+    YuvRange_Full,
+};
+
+enum class YuvPlanarFormat : uint8_t
+{
+    YuvPlanarFormat_NV12 = 0, // 8 bit luma plane, interleaved 8 bit CbCr plane at half resolution
+    YuvPlanarFormat_P010,     // as NV12 with 16 bit samples, 10 significant bits in the high bits
+};
+
+typedef struct _YUV_PLANE_LAYOUT
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytesPerSample;
+    uint32_t lumaPitch;
+    uint32_t chromaWidth;       // in CbCr pairs
+    uint32_t chromaHeight;
+    uint32_t chromaPitch;
+    size_t chromaOffset;        // from the start of the luma plane
+    size_t totalSize;
+} YUV_PLANE_LAYOUT;
+
+// pitch of 0 means tightly packed rows
+inline bool GetYuvPlaneLayout(
+    YuvPlanarFormat format,
+    uint32_t width,
+    uint32_t height,
+    uint32_t pitch,
+    YUV_PLANE_LAYOUT* pLayout)
+{
+    if (nullptr == pLayout || 0 == width || 0 == height || (width & 1) || (height & 1))
+    {
+        return false;
+    }
+
+    uint32_t bytesPerSample = (YuvPlanarFormat::YuvPlanarFormat_P010 == format) ? 2 : 1;
+    uint32_t rowBytes = width * bytesPerSample;
+    if (0 == pitch)
+    {
+        pitch = rowBytes;
+    }
+    else if (pitch < rowBytes)
+    {
+        return false;
+    }
+
+    pLayout->width = width;
+    pLayout->height = height;
+    pLayout->bytesPerSample = bytesPerSample;
+    pLayout->lumaPitch = pitch;
+    pLayout->chromaWidth = width / 2;
+    pLayout->chromaHeight = height / 2;
+    pLayout->chromaPitch = pitch;
+    pLayout->chromaOffset = static_cast<size_t>(pitch) * height;
+    pLayout->totalSize = pLayout->chromaOffset + static_cast<size_t>(pitch) * pLayout->chromaHeight;
+
+    return true;
+}
+
+// Fixed point YUV -> 8 bit RGB, Q13 so every coefficient fits in int16
+// (simd kernels multiply with 16 bit lanes and must match this bit for bit).
+//     R = (yScale * (Y - yOffset)                        + crToR * (Cr - cOffset) + round) >> 13
+//     G = (yScale * (Y - yOffset) - cbToG * (Cb - cOffset) - crToG * (Cr - cOffset) + round) >> 13
+//     B = (yScale * (Y - yOffset) + cbToB * (Cb - cOffset)                        + round) >> 13
+#define YUV_COEFFICIENT_SHIFT 13
+
+typedef struct _YUV_COEFFICIENTS
+{
+    int32_t yOffset;
+    int32_t cOffset;
+    int32_t yScale;
+    int32_t crToR;
+    int32_t cbToG;
+    int32_t crToG;
+    int32_t cbToB;
+    uint32_t bitDepth;
+} YUV_COEFFICIENTS;
+
+inline int32_t YuvRoundToFixed(double value)
+{
+    double scaled = value * (1 << YUV_COEFFICIENT_SHIFT);
+    return static_cast<int32_t>(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+}
+
+// bitDepth is the number of significant bits per sample, 8 for NV12, 10 for P010
+inline YUV_COEFFICIENTS GetYuvCoefficients(
+    YuvMatrix matrix,
+    YuvRange range,
+    uint32_t bitDepth)
+{
+    double kr = 0.299, kb = 0.114;
+    if (YuvMatrix::YuvMatrix_BT709 == matrix)
+    {
+        kr = 0.2126;
+        kb = 0.0722;
+    }
+    else if (YuvMatrix::YuvMatrix_BT2020 == matrix)
+    {
+        kr = 0.2627;
+        kb = 0.0593;
+    }
+    double kg = 1.0 - kr - kb;
+
+    double depthScale = static_cast<double>(1 << (bitDepth - 8));
+    double maxCode = static_cast<double>((1 << bitDepth) - 1);
+
+    // luma and chroma scale factors that map the input codes onto 0..255
+    double ys, cs;
+    YUV_COEFFICIENTS c;
+    c.bitDepth = bitDepth;
+    c.cOffset = 1 << (bitDepth - 1);
+    if (YuvRange::YuvRange_Limited == range)
+    {
+        c.yOffset = static_cast<int32_t>(16 * depthScale);
+        ys = 255.0 / (219.0 * depthScale);
+        cs = 255.0 / (224.0 * depthScale);
+    }
+    else
+    {
+        c.yOffset = 0;
+        ys = 255.0 / maxCode;
+        cs = 255.0 / maxCode;
+    }
+
+    c.yScale = YuvRoundToFixed(ys);
+    c.crToR = YuvRoundToFixed(cs * 2.0 * (1.0 - kr));
+    c.cbToB = YuvRoundToFixed(cs * 2.0 * (1.0 - kb));
+    c.cbToG = YuvRoundToFixed(cs * 2.0 * (1.0 - kb) * kb / kg);
+    c.crToG = YuvRoundToFixed(cs * 2.0 * (1.0 - kr) * kr / kg);
+
+    return c;
+}
+
+inline uint8_t YuvClampToByte(int32_t value)
+{
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// y, cb, cr are codes at c.bitDepth (P010 samples already shifted down by 6)
+inline void YuvToBgra(
+    const YUV_COEFFICIENTS& c,
+    int32_t y,
+    int32_t cb,
+    int32_t cr,
+    uint8_t* pBgra)
+{
+    const int32_t round = 1 << (YUV_COEFFICIENT_SHIFT - 1);
+
+    int32_t luma = c.yScale * (y - c.yOffset);
+    cb -= c.cOffset;
+    cr -= c.cOffset;
+
+    pBgra[0] = YuvClampToByte((luma + c.cbToB * cb + round) >> YUV_COEFFICIENT_SHIFT);
+    pBgra[1] = YuvClampToByte((luma - c.cbToG * cb - c.crToG * cr + round) >> YUV_COEFFICIENT_SHIFT);
+    pBgra[2] = YuvClampToByte((luma + c.crToR * cr + round) >> YUV_COEFFICIENT_SHIFT);
+    pBgra[3] = 0xFF;
+}
+
+// reference planar -> BGRA8 conversion, chroma is point sampled (no filtering),
+// which is what the shader gets with the chroma texture at half resolution and point sampling
+inline bool ConvertYuvPlanarToBgra(
+    YuvPlanarFormat format,
+    const YUV_PLANE_LAYOUT& layout,
+    const uint8_t* pSource,
+    const YUV_COEFFICIENTS& coefficients,
+    uint8_t* pDestination,
+    uint32_t destinationPitch)
+{
+    if (nullptr == pSource || nullptr == pDestination || destinationPitch < layout.width * 4)
+    {
+        return false;
+    }
+
+    const uint8_t* pChroma = pSource + layout.chromaOffset;
+    const bool wide = (YuvPlanarFormat::YuvPlanarFormat_P010 == format);
+
+    for (uint32_t row = 0; row < layout.height; ++row)
+    {
+        const uint8_t* pLumaRow = pSource + static_cast<size_t>(row) * layout.lumaPitch;
+        const uint8_t* pChromaRow = pChroma + static_cast<size_t>(row / 2) * layout.chromaPitch;
+        uint8_t* pOut = pDestination + static_cast<size_t>(row) * destinationPitch;
+
+        for (uint32_t col = 0; col < layout.width; ++col)
+        {
+            int32_t y, cb, cr;
+            if (wide)
+            {
+                const uint16_t* pY = reinterpret_cast<const uint16_t*>(pLumaRow);
+                const uint16_t* pC = reinterpret_cast<const uint16_t*>(pChromaRow);
+                y = pY[col] >> 6;
+                cb = pC[(col / 2) * 2] >> 6;
+                cr = pC[(col / 2) * 2 + 1] >> 6;
+            }
+            else
+            {
+                y = pLumaRow[col];
+                cb = pChromaRow[(col / 2) * 2];
+                cr = pChromaRow[(col / 2) * 2 + 1];
+            }
+
+            YuvToBgra(coefficients, y, cb, cr, pOut + col * 4);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,307 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// portable, built without the precompiled header
+#include "YuvKernels.h"
+
+#if defined(YUV_KERNELS_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// --------------------------------------------------------------------------
+// Scalar reference
+
+template <YuvSourceFormat Format>
+static inline void LoadYuvSample(
+    const uint8_t* pY,
+    const uint8_t* pCb,
+    const uint8_t* pCr,
+    uint32_t x,
+    int32_t* y,
+    int32_t* cb,
+    int32_t* cr)
+{
+    if (YuvSourceFormat::YuvSourceFormat_P010 == Format)
+    {
+        const uint16_t* pY16 = reinterpret_cast<const uint16_t*>(pY);
+        const uint16_t* pC16 = reinterpret_cast<const uint16_t*>(pCb);
+        *y = pY16[x] >> 6;
+        *cb = pC16[(x / 2) * 2] >> 6;
+        *cr = pC16[(x / 2) * 2 + 1] >> 6;
+    }
+    else if (YuvSourceFormat::YuvSourceFormat_NV12 == Format)
+    {
+        *y = pY[x];
+        *cb = pCb[(x / 2) * 2];
+        *cr = pCb[(x / 2) * 2 + 1];
+    }
+    else
+    {
+        *y = pY[x];
+        *cb = pCb[x / 2];
+        *cr = pCr[x / 2];
+    }
+}
+
+template <YuvSourceFormat Format, RgbDestinationFormat Destination>
+static void YuvRowScalar(
+    const uint8_t* pY,
+    const uint8_t* pCb,
+    const uint8_t* pCr,
+    uint8_t* pDestination,
+    uint32_t begin,
+    uint32_t end,
+    const YUV_COEFFICIENTS& c)
+{
+    const int32_t round = 1 << (YUV_COEFFICIENT_SHIFT - 1);
+
+    for (uint32_t x = begin; x < end; ++x)
+    {
+        int32_t y, cb, cr;
+        LoadYuvSample<Format>(pY, pCb, pCr, x, &y, &cb, &cr);
+
+        int32_t luma = c.yScale * (y - c.yOffset);
+        cb -= c.cOffset;
+        cr -= c.cOffset;
+
+        int32_t r = luma + c.crToR * cr;
+        int32_t g = luma - c.cbToG * cb - c.crToG * cr;
+        int32_t b = luma + c.cbToB * cb;
+
+        if (RgbDestinationFormat::RgbDestinationFormat_BGRA8 == Destination)
+        {
+            uint8_t* pOut = pDestination + x * 4;
+            pOut[0] = YuvClampToByte((b + round) >> YUV_COEFFICIENT_SHIFT);
+            pOut[1] = YuvClampToByte((g + round) >> YUV_COEFFICIENT_SHIFT);
+            pOut[2] = YuvClampToByte((r + round) >> YUV_COEFFICIENT_SHIFT);
+            pOut[3] = 0xFF;
+        }
+        else
+        {
+            uint16_t* pOut = reinterpret_cast<uint16_t*>(pDestination) + x * 4;
+            pOut[0] = YuvFloatToHalf(YuvFixedToUnitFloat(r));
+            pOut[1] = YuvFloatToHalf(YuvFixedToUnitFloat(g));
+            pOut[2] = YuvFloatToHalf(YuvFixedToUnitFloat(b));
+            pOut[3] = YUV_HALF_ONE;
+        }
+    }
+}
+
+YuvRowKernel GetYuvRowKernelScalar(YuvSourceFormat source, RgbDestinationFormat destination)
+{
+    const bool half = (RgbDestinationFormat::RgbDestinationFormat_RGBA16F == destination);
+
+    switch (source)
+    {
+    case YuvSourceFormat::YuvSourceFormat_NV12:
+        return half
+            ? YuvRowScalar<YuvSourceFormat::YuvSourceFormat_NV12, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowScalar<YuvSourceFormat::YuvSourceFormat_NV12, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    case YuvSourceFormat::YuvSourceFormat_I420:
+        return half
+            ? YuvRowScalar<YuvSourceFormat::YuvSourceFormat_I420, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowScalar<YuvSourceFormat::YuvSourceFormat_I420, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    case YuvSourceFormat::YuvSourceFormat_P010:
+        return half
+            ? YuvRowScalar<YuvSourceFormat::YuvSourceFormat_P010, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowScalar<YuvSourceFormat::YuvSourceFormat_P010, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    }
+
+    return nullptr;
+}
+
+// --------------------------------------------------------------------------
+// Runtime dispatch
+
+#if defined(YUV_KERNELS_X86)
+static void QueryCpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; ++i)
+    {
+        regs[i] = static_cast<uint32_t>(info[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t QueryXcr0()
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+static uint32_t DetectX86Features()
+{
+    uint32_t features = 0;
+
+    uint32_t regs[4];
+    QueryCpuid(0, 0, regs);
+    uint32_t maxLeaf = regs[0];
+
+    QueryCpuid(1, 0, regs);
+    const bool sse41 = (regs[2] & (1u << 19)) != 0;
+    const bool osxsave = (regs[2] & (1u << 27)) != 0;
+    const bool avx = (regs[2] & (1u << 28)) != 0;
+
+    if (sse41)
+    {
+        features |= 1u << static_cast<uint32_t>(YuvKernelIsa::YuvKernelIsa_SSE41);
+    }
+
+    // avx2 also needs the os to save ymm state
+    if (maxLeaf >= 7 && osxsave && avx && (QueryXcr0() & 0x6) == 0x6)
+    {
+        QueryCpuid(7, 0, regs);
+        if (regs[1] & (1u << 5))
+        {
+            features |= 1u << static_cast<uint32_t>(YuvKernelIsa::YuvKernelIsa_AVX2);
+        }
+    }
+
+    return features;
+}
+#endif
+
+static uint32_t GetSupportedIsaMask()
+{
+    static const uint32_t s_mask = []()
+    {
+        uint32_t mask = 1u << static_cast<uint32_t>(YuvKernelIsa::YuvKernelIsa_Scalar);
+#if defined(YUV_KERNELS_X86)
+        mask |= DetectX86Features();
+#elif defined(YUV_KERNELS_NEON)
+        // advanced simd is mandatory on arm64
+        mask |= 1u << static_cast<uint32_t>(YuvKernelIsa::YuvKernelIsa_NEON);
+#endif
+        return mask;
+    }();
+
+    return s_mask;
+}
+
+bool IsYuvKernelIsaSupported(YuvKernelIsa isa)
+{
+    if (YuvKernelIsa::YuvKernelIsa_Best == isa)
+    {
+        return true;
+    }
+
+    return (GetSupportedIsaMask() & (1u << static_cast<uint32_t>(isa))) != 0;
+}
+
+YuvKernelIsa GetBestYuvKernelIsa()
+{
+    static const YuvKernelIsa order[] =
+    {
+        YuvKernelIsa::YuvKernelIsa_AVX2,
+        YuvKernelIsa::YuvKernelIsa_NEON,
+        YuvKernelIsa::YuvKernelIsa_SSE41,
+    };
+
+    for (YuvKernelIsa isa : order)
+    {
+        if (IsYuvKernelIsaSupported(isa))
+        {
+            return isa;
+        }
+    }
+
+    return YuvKernelIsa::YuvKernelIsa_Scalar;
+}
+
+const char* GetYuvKernelIsaName(YuvKernelIsa isa)
+{
+    switch (isa)
+    {
+    case YuvKernelIsa::YuvKernelIsa_Scalar: return "scalar";
+    case YuvKernelIsa::YuvKernelIsa_SSE41: return "sse4.1";
+    case YuvKernelIsa::YuvKernelIsa_AVX2: return "avx2";
+    case YuvKernelIsa::YuvKernelIsa_NEON: return "neon";
+    case YuvKernelIsa::YuvKernelIsa_Best: return GetYuvKernelIsaName(GetBestYuvKernelIsa());
+    }
+
+    return "unknown";
+}
+
+YuvRowKernel GetYuvRowKernel(YuvKernelIsa isa, YuvSourceFormat source, RgbDestinationFormat destination)
+{
+    if (YuvKernelIsa::YuvKernelIsa_Best == isa)
+    {
+        isa = GetBestYuvKernelIsa();
+    }
+
+    if (!IsYuvKernelIsaSupported(isa))
+    {
+        return nullptr;
+    }
+
+    switch (isa)
+    {
+    case YuvKernelIsa::YuvKernelIsa_Scalar: return GetYuvRowKernelScalar(source, destination);
+    case YuvKernelIsa::YuvKernelIsa_SSE41: return GetYuvRowKernelSse41(source, destination);
+    case YuvKernelIsa::YuvKernelIsa_AVX2: return GetYuvRowKernelAvx2(source, destination);
+    case YuvKernelIsa::YuvKernelIsa_NEON: return GetYuvRowKernelNeon(source, destination);
+    default: break;
+    }
+
+    return nullptr;
+}
+
+bool ConvertYuvFrame(
+    const YUV_FRAME& frame,
+    const YUV_COEFFICIENTS& coefficients,
+    RgbDestinationFormat destination,
+    uint8_t* pDestination,
+    uint32_t destinationPitch,
+    YuvKernelIsa isa)
+{
+    const bool wide = (YuvSourceFormat::YuvSourceFormat_P010 == frame.format);
+    const bool planar = (YuvSourceFormat::YuvSourceFormat_I420 == frame.format);
+    const uint32_t bytesPerPixel = (RgbDestinationFormat::RgbDestinationFormat_BGRA8 == destination) ? 4 : 8;
+
+    if (nullptr == pDestination || 0 == frame.width || 0 == frame.height || (frame.width & 1) || (frame.height & 1)
+        || destinationPitch < frame.width * bytesPerPixel
+        || nullptr == frame.planes[0] || nullptr == frame.planes[1] || (planar && nullptr == frame.planes[2])
+        || coefficients.bitDepth != (wide ? 10u : 8u))
+    {
+        return false;
+    }
+
+    YuvRowKernel kernel = GetYuvRowKernel(isa, frame.format, destination);
+    if (nullptr == kernel)
+    {
+        return false;
+    }
+
+    for (uint32_t row = 0; row < frame.height; ++row)
+    {
+        const uint8_t* pY = frame.planes[0] + static_cast<size_t>(row) * frame.pitches[0];
+        const uint8_t* pCb = frame.planes[1] + static_cast<size_t>(row / 2) * frame.pitches[1];
+        const uint8_t* pCr = planar ? frame.planes[2] + static_cast<size_t>(row / 2) * frame.pitches[2] : pCb;
+
+        kernel(pY, pCb, pCr, pDestination + static_cast<size_t>(row) * destinationPitch, 0, frame.width, coefficients);
+    }
+
+    return true;
+}
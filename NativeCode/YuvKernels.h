@@ -0,0 +1,132 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <cstring>
+
+#include "YuvConversion.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define YUV_KERNELS_X86 1
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define YUV_KERNELS_NEON 1
+#endif
+
+// CPU side YUV -> RGB conversion for readback, WARP device players and thumbnails.
+// Every simd kernel produces exactly the same bytes as the scalar reference.
+
+enum class YuvSourceFormat : uint8_t
+{
+    YuvSourceFormat_NV12 = 0,   // luma plane + interleaved CbCr plane, 8 bit
+    YuvSourceFormat_I420,       // luma, Cb and Cr planes, 8 bit
+    YuvSourceFormat_P010,       // as NV12 with 16 bit samples, 10 significant bits in the high bits
+};
+
+enum class RgbDestinationFormat : uint8_t
+{
+    RgbDestinationFormat_BGRA8 = 0,
+    RgbDestinationFormat_RGBA16F,   // half floats in 0..1, alpha 1
+};
+
+enum class YuvKernelIsa : uint8_t
+{
+    YuvKernelIsa_Scalar = 0,
+    YuvKernelIsa_SSE41,
+    YuvKernelIsa_AVX2,
+    YuvKernelIsa_NEON,
+    YuvKernelIsa_Best = 0xFF,   // whatever the running cpu supports
+};
+
+typedef struct _YUV_FRAME
+{
+    YuvSourceFormat format;
+    uint32_t width;
+    uint32_t height;
+    const uint8_t* planes[3];   // NV12/P010: luma, chroma. I420: luma, Cb, Cr
+    uint32_t pitches[3];        // in bytes
+} YUV_FRAME;
+
+// Converts pixels [begin, end) of one row. pCb/pCr point at the first chroma
+// sample of the row, for interleaved formats pCr is unused.
+typedef void(*YuvRowKernel)(
+    const uint8_t* pY,
+    const uint8_t* pCb,
+    const uint8_t* pCr,
+    uint8_t* pDestination,
+    uint32_t begin,
+    uint32_t end,
+    const YUV_COEFFICIENTS& coefficients);
+
+bool IsYuvKernelIsaSupported(YuvKernelIsa isa);
+YuvKernelIsa GetBestYuvKernelIsa();
+const char* GetYuvKernelIsaName(YuvKernelIsa isa);
+
+// nullptr if the isa is not compiled in or not supported by the cpu
+YuvRowKernel GetYuvRowKernel(YuvKernelIsa isa, YuvSourceFormat source, RgbDestinationFormat destination);
+
+// coefficients must be built for the source bit depth (10 for P010, 8 otherwise)
+bool ConvertYuvFrame(
+    const YUV_FRAME& frame,
+    const YUV_COEFFICIENTS& coefficients,
+    RgbDestinationFormat destination,
+    uint8_t* pDestination,
+    uint32_t destinationPitch,
+    YuvKernelIsa isa = YuvKernelIsa::YuvKernelIsa_Best);
+
+// per isa tables, defined in YuvKernels<Isa>.cpp
+YuvRowKernel GetYuvRowKernelScalar(YuvSourceFormat source, RgbDestinationFormat destination);
+YuvRowKernel GetYuvRowKernelSse41(YuvSourceFormat source, RgbDestinationFormat destination);
+YuvRowKernel GetYuvRowKernelAvx2(YuvSourceFormat source, RgbDestinationFormat destination);
+YuvRowKernel GetYuvRowKernelNeon(YuvSourceFormat source, RgbDestinationFormat destination);
+
+// --------------------------------------------------------------------------
+// Shared by all kernels, the definition of the exact result.
+
+// 1 / (255 << YUV_COEFFICIENT_SHIFT), maps the unrounded fixed point result onto 0..1
+#define YUV_HALF_SCALE (1.0f / 2088960.0f)
+
+// (15 - 127) << 23 as two's complement, plus 0xFFF for round half up before the odd fixup
+#define YUV_HALF_REBIAS 0xC8000FFFu
+
+// float in [0, 1] to half, round to nearest even, denormals kept.
+// Branch free formulation so simd kernels can run the exact same steps.
+inline uint16_t YuvFloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (bits < (113u << 23))
+    {
+        // below the smallest normal half, let the fpu round into the denormal range
+        const uint32_t magicBits = 126u << 23;
+        float magic;
+        memcpy(&magic, &magicBits, sizeof(magic));
+
+        float shifted = value + magic;
+        memcpy(&bits, &shifted, sizeof(bits));
+        return static_cast<uint16_t>(bits - magicBits);
+    }
+
+    uint32_t mantissaOdd = (bits >> 13) & 1;
+    bits += YUV_HALF_REBIAS;
+    bits += mantissaOdd;
+    return static_cast<uint16_t>(bits >> 13);
+}
+
+inline float YuvFixedToUnitFloat(int32_t value)
+{
+    float f = static_cast<float>(value) * YUV_HALF_SCALE;
+    return (f < 0.0f) ? 0.0f : ((f > 1.0f) ? 1.0f : f);
+}
+
+#define YUV_HALF_ONE 0x3C00
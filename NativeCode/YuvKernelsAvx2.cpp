@@ -0,0 +1,273 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// portable, built without the precompiled header
+#include "YuvKernels.h"
+
+#if defined(YUV_KERNELS_X86)
+
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+#define YUV_AVX2 __attribute__((target("avx2")))
+#else
+#define YUV_AVX2
+#endif
+
+// 16 pixels per iteration, same math as YuvKernelsSse41.cpp on 256 bit registers.
+// Unpack and pack work inside 128 bit lanes, so lane 0 carries pixels 0..7 and
+// lane 1 pixels 8..15 until the final permute puts them back in memory order.
+
+namespace
+{
+    struct Avx2Constants
+    {
+        __m256i yOffset;
+        __m256i cOffset;
+        __m256i yCrToR;
+        __m256i yCbToG;
+        __m256i yCbToB;
+        __m256i crToG;
+        __m256i round;
+    };
+
+    inline int32_t PackPair(int32_t low, int32_t high)
+    {
+        return static_cast<int32_t>((static_cast<uint32_t>(static_cast<uint16_t>(high)) << 16) | static_cast<uint16_t>(low));
+    }
+
+    YUV_AVX2 inline Avx2Constants MakeConstants(const YUV_COEFFICIENTS& c)
+    {
+        Avx2Constants k;
+        k.yOffset = _mm256_set1_epi16(static_cast<int16_t>(c.yOffset));
+        k.cOffset = _mm256_set1_epi16(static_cast<int16_t>(c.cOffset));
+        k.yCrToR = _mm256_set1_epi32(PackPair(c.yScale, c.crToR));
+        k.yCbToG = _mm256_set1_epi32(PackPair(c.yScale, -c.cbToG));
+        k.yCbToB = _mm256_set1_epi32(PackPair(c.yScale, c.cbToB));
+        k.crToG = _mm256_set1_epi32(PackPair(-c.crToG, 0));
+        k.round = _mm256_set1_epi32(1 << (YUV_COEFFICIENT_SHIFT - 1));
+        return k;
+    }
+
+    template <YuvSourceFormat Format>
+    YUV_AVX2 inline void LoadPixels(
+        const uint8_t* pY,
+        const uint8_t* pCb,
+        const uint8_t* pCr,
+        uint32_t x,
+        __m256i* y,
+        __m256i* cb,
+        __m256i* cr)
+    {
+        // per lane shuffles, each lane holds 4 CbCr pairs
+        const __m256i cbMask = _mm256_setr_epi8(
+            0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13,
+            0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13);
+        const __m256i crMask = _mm256_setr_epi8(
+            2, 3, 2, 3, 6, 7, 6, 7, 10, 11, 10, 11, 14, 15, 14, 15,
+            2, 3, 2, 3, 6, 7, 6, 7, 10, 11, 10, 11, 14, 15, 14, 15);
+
+        if (YuvSourceFormat::YuvSourceFormat_P010 == Format)
+        {
+            *y = _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pY + x * 2)), 6);
+            __m256i c = _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pCb + x * 2)), 6);
+            *cb = _mm256_shuffle_epi8(c, cbMask);
+            *cr = _mm256_shuffle_epi8(c, crMask);
+        }
+        else if (YuvSourceFormat::YuvSourceFormat_NV12 == Format)
+        {
+            *y = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pY + x)));
+            __m256i c = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pCb + x)));
+            *cb = _mm256_shuffle_epi8(c, cbMask);
+            *cr = _mm256_shuffle_epi8(c, crMask);
+        }
+        else
+        {
+            *y = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pY + x)));
+
+            __m128i cbs = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pCb + x / 2)));
+            __m128i crs = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pCr + x / 2)));
+            *cb = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(cbs, cbs)), _mm_unpackhi_epi16(cbs, cbs), 1);
+            *cr = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(crs, crs)), _mm_unpackhi_epi16(crs, crs), 1);
+        }
+    }
+
+    // [0] holds pixels 0..3 | 8..11, [1] holds pixels 4..7 | 12..15
+    YUV_AVX2 inline void ComputeFixed(
+        const Avx2Constants& k,
+        __m256i y,
+        __m256i cb,
+        __m256i cr,
+        __m256i r[2],
+        __m256i g[2],
+        __m256i b[2])
+    {
+        y = _mm256_sub_epi16(y, k.yOffset);
+        cb = _mm256_sub_epi16(cb, k.cOffset);
+        cr = _mm256_sub_epi16(cr, k.cOffset);
+
+        const __m256i zero = _mm256_setzero_si256();
+
+        __m256i yCrLo = _mm256_unpacklo_epi16(y, cr);
+        __m256i yCrHi = _mm256_unpackhi_epi16(y, cr);
+        __m256i yCbLo = _mm256_unpacklo_epi16(y, cb);
+        __m256i yCbHi = _mm256_unpackhi_epi16(y, cb);
+        __m256i crLo = _mm256_unpacklo_epi16(cr, zero);
+        __m256i crHi = _mm256_unpackhi_epi16(cr, zero);
+
+        r[0] = _mm256_madd_epi16(yCrLo, k.yCrToR);
+        r[1] = _mm256_madd_epi16(yCrHi, k.yCrToR);
+        g[0] = _mm256_add_epi32(_mm256_madd_epi16(yCbLo, k.yCbToG), _mm256_madd_epi16(crLo, k.crToG));
+        g[1] = _mm256_add_epi32(_mm256_madd_epi16(yCbHi, k.yCbToG), _mm256_madd_epi16(crHi, k.crToG));
+        b[0] = _mm256_madd_epi16(yCbLo, k.yCbToB);
+        b[1] = _mm256_madd_epi16(yCbHi, k.yCbToB);
+    }
+
+    // lane 0: bytes of pixels 0..7 (twice), lane 1: pixels 8..15 (twice)
+    YUV_AVX2 inline __m256i ToBytes(const Avx2Constants& k, const __m256i v[2])
+    {
+        __m256i lo = _mm256_srai_epi32(_mm256_add_epi32(v[0], k.round), YUV_COEFFICIENT_SHIFT);
+        __m256i hi = _mm256_srai_epi32(_mm256_add_epi32(v[1], k.round), YUV_COEFFICIENT_SHIFT);
+        __m256i words = _mm256_packs_epi32(lo, hi);
+        return _mm256_packus_epi16(words, words);
+    }
+
+    // same steps as YuvFloatToHalf
+    YUV_AVX2 inline __m256i ToHalf(__m256i fixed)
+    {
+        __m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(fixed), _mm256_set1_ps(YUV_HALF_SCALE));
+        f = _mm256_min_ps(_mm256_max_ps(f, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+
+        const __m256i magic = _mm256_set1_epi32(126 << 23);
+        __m256i bits = _mm256_castps_si256(f);
+        __m256i isDenormal = _mm256_cmpgt_epi32(_mm256_set1_epi32(113 << 23), bits);
+        __m256i denormal = _mm256_sub_epi32(_mm256_castps_si256(_mm256_add_ps(f, _mm256_castsi256_ps(magic))), magic);
+
+        __m256i mantissaOdd = _mm256_and_si256(_mm256_srli_epi32(bits, 13), _mm256_set1_epi32(1));
+        __m256i normal = _mm256_add_epi32(bits, _mm256_set1_epi32(static_cast<int32_t>(YUV_HALF_REBIAS)));
+        normal = _mm256_srli_epi32(_mm256_add_epi32(normal, mantissaOdd), 13);
+
+        return _mm256_blendv_epi8(normal, denormal, isDenormal);
+    }
+
+    // lane 0: halves of pixels 0..7, lane 1: pixels 8..15
+    YUV_AVX2 inline __m256i ToHalfWords(const __m256i v[2])
+    {
+        return _mm256_packus_epi32(ToHalf(v[0]), ToHalf(v[1]));
+    }
+
+    template <YuvSourceFormat Format, RgbDestinationFormat Destination>
+    YUV_AVX2 void YuvRowAvx2(
+        const uint8_t* pY,
+        const uint8_t* pCb,
+        const uint8_t* pCr,
+        uint8_t* pDestination,
+        uint32_t begin,
+        uint32_t end,
+        const YUV_COEFFICIENTS& c)
+    {
+        YuvRowKernel scalar = GetYuvRowKernelScalar(Format, Destination);
+
+        uint32_t x = begin;
+        if ((x & 1) && x < end)
+        {
+            scalar(pY, pCb, pCr, pDestination, x, x + 1, c);
+            ++x;
+        }
+
+        const Avx2Constants k = MakeConstants(c);
+
+        for (; x + 16 <= end; x += 16)
+        {
+            __m256i y, cb, cr;
+            LoadPixels<Format>(pY, pCb, pCr, x, &y, &cb, &cr);
+
+            __m256i r[2], g[2], b[2];
+            ComputeFixed(k, y, cb, cr, r, g, b);
+
+            if (RgbDestinationFormat::RgbDestinationFormat_BGRA8 == Destination)
+            {
+                __m256i bg = _mm256_unpacklo_epi8(ToBytes(k, b), ToBytes(k, g));
+                __m256i ra = _mm256_unpacklo_epi8(ToBytes(k, r), _mm256_set1_epi8(static_cast<char>(0xFF)));
+
+                // lo: pixels 0..3 | 8..11, hi: pixels 4..7 | 12..15
+                __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+                __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+
+                __m256i* pOut = reinterpret_cast<__m256i*>(pDestination + x * 4);
+                _mm256_storeu_si256(pOut, _mm256_permute2x128_si256(lo, hi, 0x20));
+                _mm256_storeu_si256(pOut + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+            }
+            else
+            {
+                __m256i rh = ToHalfWords(r);
+                __m256i gh = ToHalfWords(g);
+                __m256i bh = ToHalfWords(b);
+                __m256i ah = _mm256_set1_epi16(YUV_HALF_ONE);
+
+                // rg/ba: pixels 0..3 | 8..11, rgHi/baHi: pixels 4..7 | 12..15
+                __m256i rg = _mm256_unpacklo_epi16(rh, gh);
+                __m256i rgHi = _mm256_unpackhi_epi16(rh, gh);
+                __m256i ba = _mm256_unpacklo_epi16(bh, ah);
+                __m256i baHi = _mm256_unpackhi_epi16(bh, ah);
+
+                __m256i p0 = _mm256_unpacklo_epi32(rg, ba);     // 0,1 | 8,9
+                __m256i p1 = _mm256_unpackhi_epi32(rg, ba);     // 2,3 | 10,11
+                __m256i p2 = _mm256_unpacklo_epi32(rgHi, baHi); // 4,5 | 12,13
+                __m256i p3 = _mm256_unpackhi_epi32(rgHi, baHi); // 6,7 | 14,15
+
+                __m256i* pOut = reinterpret_cast<__m256i*>(pDestination + x * 8);
+                _mm256_storeu_si256(pOut, _mm256_permute2x128_si256(p0, p1, 0x20));
+                _mm256_storeu_si256(pOut + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+                _mm256_storeu_si256(pOut + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+                _mm256_storeu_si256(pOut + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+            }
+        }
+
+        // finish with the 8 wide kernel, then scalar
+        if (x < end)
+        {
+            GetYuvRowKernelSse41(Format, Destination)(pY, pCb, pCr, pDestination, x, end, c);
+        }
+    }
+}
+
+YuvRowKernel GetYuvRowKernelAvx2(YuvSourceFormat source, RgbDestinationFormat destination)
+{
+    const bool half = (RgbDestinationFormat::RgbDestinationFormat_RGBA16F == destination);
+
+    switch (source)
+    {
+    case YuvSourceFormat::YuvSourceFormat_NV12:
+        return half
+            ? YuvRowAvx2<YuvSourceFormat::YuvSourceFormat_NV12, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowAvx2<YuvSourceFormat::YuvSourceFormat_NV12, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    case YuvSourceFormat::YuvSourceFormat_I420:
+        return half
+            ? YuvRowAvx2<YuvSourceFormat::YuvSourceFormat_I420, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowAvx2<YuvSourceFormat::YuvSourceFormat_I420, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    case YuvSourceFormat::YuvSourceFormat_P010:
+        return half
+            ? YuvRowAvx2<YuvSourceFormat::YuvSourceFormat_P010, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowAvx2<YuvSourceFormat::YuvSourceFormat_P010, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    }
+
+    return nullptr;
+}
+
+#else
+
+YuvRowKernel GetYuvRowKernelAvx2(YuvSourceFormat, RgbDestinationFormat)
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,202 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// portable, built without the precompiled header
+#include "YuvKernels.h"
+
+#if defined(YUV_KERNELS_NEON)
+
+#if defined(_MSC_VER)
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+
+// 8 pixels per iteration. vmull_s16 / vmlal_s16 widen to int32 exactly like the
+// scalar reference, and the structured stores do the channel interleave.
+
+namespace
+{
+    // loads 8 pixels as int16: luma, and Cb / Cr repeated for each pixel pair
+    template <YuvSourceFormat Format>
+    inline void LoadPixels(
+        const uint8_t* pY,
+        const uint8_t* pCb,
+        const uint8_t* pCr,
+        uint32_t x,
+        int16x8_t* y,
+        int16x8_t* cb,
+        int16x8_t* cr)
+    {
+        uint16x8_t cbs, crs;
+
+        if (YuvSourceFormat::YuvSourceFormat_P010 == Format)
+        {
+            *y = vreinterpretq_s16_u16(vshrq_n_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(pY) + x), 6));
+            uint16x8_t c = vshrq_n_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(pCb) + x), 6);
+            cbs = vuzp1q_u16(c, c);
+            crs = vuzp2q_u16(c, c);
+        }
+        else if (YuvSourceFormat::YuvSourceFormat_NV12 == Format)
+        {
+            *y = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pY + x)));
+            uint16x8_t c = vmovl_u8(vld1_u8(pCb + x));
+            cbs = vuzp1q_u16(c, c);
+            crs = vuzp2q_u16(c, c);
+        }
+        else
+        {
+            *y = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(pY + x)));
+
+            uint32_t cb4, cr4;
+            memcpy(&cb4, pCb + x / 2, sizeof(cb4));
+            memcpy(&cr4, pCr + x / 2, sizeof(cr4));
+            cbs = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(cb4)));
+            crs = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(cr4)));
+        }
+
+        // the low four lanes hold the chroma of the 4 pixel pairs
+        *cb = vreinterpretq_s16_u16(vzip1q_u16(cbs, cbs));
+        *cr = vreinterpretq_s16_u16(vzip1q_u16(crs, crs));
+    }
+
+    inline int16x8_t ToBytesSaturated(int32x4_t lo, int32x4_t hi)
+    {
+        return vcombine_s16(
+            vqmovn_s32(vrshrq_n_s32(lo, YUV_COEFFICIENT_SHIFT)),
+            vqmovn_s32(vrshrq_n_s32(hi, YUV_COEFFICIENT_SHIFT)));
+    }
+
+    // same steps as YuvFloatToHalf
+    inline uint16x4_t ToHalf(int32x4_t fixed)
+    {
+        float32x4_t f = vmulq_n_f32(vcvtq_f32_s32(fixed), YUV_HALF_SCALE);
+        f = vminq_f32(vmaxq_f32(f, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+
+        const uint32x4_t magic = vdupq_n_u32(126u << 23);
+        uint32x4_t bits = vreinterpretq_u32_f32(f);
+        uint32x4_t isDenormal = vcltq_u32(bits, vdupq_n_u32(113u << 23));
+        uint32x4_t denormal = vsubq_u32(vreinterpretq_u32_f32(vaddq_f32(f, vreinterpretq_f32_u32(magic))), magic);
+
+        uint32x4_t mantissaOdd = vandq_u32(vshrq_n_u32(bits, 13), vdupq_n_u32(1));
+        uint32x4_t normal = vaddq_u32(bits, vdupq_n_u32(YUV_HALF_REBIAS));
+        normal = vshrq_n_u32(vaddq_u32(normal, mantissaOdd), 13);
+
+        return vmovn_u32(vbslq_u32(isDenormal, denormal, normal));
+    }
+
+    template <YuvSourceFormat Format, RgbDestinationFormat Destination>
+    void YuvRowNeon(
+        const uint8_t* pY,
+        const uint8_t* pCb,
+        const uint8_t* pCr,
+        uint8_t* pDestination,
+        uint32_t begin,
+        uint32_t end,
+        const YUV_COEFFICIENTS& c)
+    {
+        YuvRowKernel scalar = GetYuvRowKernelScalar(Format, Destination);
+
+        // simd loads start on a chroma pair
+        uint32_t x = begin;
+        if ((x & 1) && x < end)
+        {
+            scalar(pY, pCb, pCr, pDestination, x, x + 1, c);
+            ++x;
+        }
+
+        const int16x8_t yOffset = vdupq_n_s16(static_cast<int16_t>(c.yOffset));
+        const int16x8_t cOffset = vdupq_n_s16(static_cast<int16_t>(c.cOffset));
+        const int16_t yScale = static_cast<int16_t>(c.yScale);
+        const int16_t crToR = static_cast<int16_t>(c.crToR);
+        const int16_t cbToG = static_cast<int16_t>(c.cbToG);
+        const int16_t crToG = static_cast<int16_t>(c.crToG);
+        const int16_t cbToB = static_cast<int16_t>(c.cbToB);
+
+        for (; x + 8 <= end; x += 8)
+        {
+            int16x8_t y, cb, cr;
+            LoadPixels<Format>(pY, pCb, pCr, x, &y, &cb, &cr);
+
+            y = vsubq_s16(y, yOffset);
+            cb = vsubq_s16(cb, cOffset);
+            cr = vsubq_s16(cr, cOffset);
+
+            int32x4_t lumaLo = vmull_n_s16(vget_low_s16(y), yScale);
+            int32x4_t lumaHi = vmull_n_s16(vget_high_s16(y), yScale);
+
+            int32x4_t r[2], g[2], b[2];
+            r[0] = vmlal_n_s16(lumaLo, vget_low_s16(cr), crToR);
+            r[1] = vmlal_n_s16(lumaHi, vget_high_s16(cr), crToR);
+            g[0] = vmlsl_n_s16(vmlsl_n_s16(lumaLo, vget_low_s16(cb), cbToG), vget_low_s16(cr), crToG);
+            g[1] = vmlsl_n_s16(vmlsl_n_s16(lumaHi, vget_high_s16(cb), cbToG), vget_high_s16(cr), crToG);
+            b[0] = vmlal_n_s16(lumaLo, vget_low_s16(cb), cbToB);
+            b[1] = vmlal_n_s16(lumaHi, vget_high_s16(cb), cbToB);
+
+            if (RgbDestinationFormat::RgbDestinationFormat_BGRA8 == Destination)
+            {
+                // vrshrq adds the same half step the scalar path adds before shifting
+                uint8x8x4_t bgra;
+                bgra.val[0] = vqmovun_s16(ToBytesSaturated(b[0], b[1]));
+                bgra.val[1] = vqmovun_s16(ToBytesSaturated(g[0], g[1]));
+                bgra.val[2] = vqmovun_s16(ToBytesSaturated(r[0], r[1]));
+                bgra.val[3] = vdup_n_u8(0xFF);
+                vst4_u8(pDestination + x * 4, bgra);
+            }
+            else
+            {
+                uint16x8x4_t rgba;
+                rgba.val[0] = vcombine_u16(ToHalf(r[0]), ToHalf(r[1]));
+                rgba.val[1] = vcombine_u16(ToHalf(g[0]), ToHalf(g[1]));
+                rgba.val[2] = vcombine_u16(ToHalf(b[0]), ToHalf(b[1]));
+                rgba.val[3] = vdupq_n_u16(YUV_HALF_ONE);
+                vst4q_u16(reinterpret_cast<uint16_t*>(pDestination) + x * 4, rgba);
+            }
+        }
+
+        if (x < end)
+        {
+            scalar(pY, pCb, pCr, pDestination, x, end, c);
+        }
+    }
+}
+
+YuvRowKernel GetYuvRowKernelNeon(YuvSourceFormat source, RgbDestinationFormat destination)
+{
+    const bool half = (RgbDestinationFormat::RgbDestinationFormat_RGBA16F == destination);
+
+    switch (source)
+    {
+    case YuvSourceFormat::YuvSourceFormat_NV12:
+        return half
+            ? YuvRowNeon<YuvSourceFormat::YuvSourceFormat_NV12, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowNeon<YuvSourceFormat::YuvSourceFormat_NV12, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    case YuvSourceFormat::YuvSourceFormat_I420:
+        return half
+            ? YuvRowNeon<YuvSourceFormat::YuvSourceFormat_I420, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowNeon<YuvSourceFormat::YuvSourceFormat_I420, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    case YuvSourceFormat::YuvSourceFormat_P010:
+        return half
+            ? YuvRowNeon<YuvSourceFormat::YuvSourceFormat_P010, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowNeon<YuvSourceFormat::YuvSourceFormat_P010, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    }
+
+    return nullptr;
+}
+
+#else
+
+YuvRowKernel GetYuvRowKernelNeon(YuvSourceFormat, RgbDestinationFormat)
+{
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,259 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// portable, built without the precompiled header
+#include "YuvKernels.h"
+
+#if defined(YUV_KERNELS_X86)
+
+#include <smmintrin.h>
+
+#if defined(__GNUC__)
+#define YUV_SSE41 __attribute__((target("sse4.1")))
+#else
+#define YUV_SSE41
+#endif
+
+// 8 pixels per iteration. Fixed point math runs on 16 bit pairs through
+// _mm_madd_epi16, which yields the same int32 sums as the scalar reference.
+
+namespace
+{
+    struct Sse41Constants
+    {
+        __m128i yOffset;
+        __m128i cOffset;
+        __m128i yCrToR;     // (yScale, crToR) pairs
+        __m128i yCbToG;     // (yScale, -cbToG)
+        __m128i yCbToB;     // (yScale, cbToB)
+        __m128i crToG;      // (-crToG, 0)
+        __m128i round;
+    };
+
+    inline int32_t PackPair(int32_t low, int32_t high)
+    {
+        return static_cast<int32_t>((static_cast<uint32_t>(static_cast<uint16_t>(high)) << 16) | static_cast<uint16_t>(low));
+    }
+
+    YUV_SSE41 inline Sse41Constants MakeConstants(const YUV_COEFFICIENTS& c)
+    {
+        Sse41Constants k;
+        k.yOffset = _mm_set1_epi16(static_cast<int16_t>(c.yOffset));
+        k.cOffset = _mm_set1_epi16(static_cast<int16_t>(c.cOffset));
+        k.yCrToR = _mm_set1_epi32(PackPair(c.yScale, c.crToR));
+        k.yCbToG = _mm_set1_epi32(PackPair(c.yScale, -c.cbToG));
+        k.yCbToB = _mm_set1_epi32(PackPair(c.yScale, c.cbToB));
+        k.crToG = _mm_set1_epi32(PackPair(-c.crToG, 0));
+        k.round = _mm_set1_epi32(1 << (YUV_COEFFICIENT_SHIFT - 1));
+        return k;
+    }
+
+    // loads 8 pixels as int16: luma, and Cb / Cr repeated for each pixel pair
+    template <YuvSourceFormat Format>
+    YUV_SSE41 inline void LoadPixels(
+        const uint8_t* pY,
+        const uint8_t* pCb,
+        const uint8_t* pCr,
+        uint32_t x,
+        __m128i* y,
+        __m128i* cb,
+        __m128i* cr)
+    {
+        const __m128i cbMask = _mm_setr_epi8(0, 1, 0, 1, 4, 5, 4, 5, 8, 9, 8, 9, 12, 13, 12, 13);
+        const __m128i crMask = _mm_setr_epi8(2, 3, 2, 3, 6, 7, 6, 7, 10, 11, 10, 11, 14, 15, 14, 15);
+
+        if (YuvSourceFormat::YuvSourceFormat_P010 == Format)
+        {
+            *y = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pY + x * 2)), 6);
+            __m128i c = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pCb + x * 2)), 6);
+            *cb = _mm_shuffle_epi8(c, cbMask);
+            *cr = _mm_shuffle_epi8(c, crMask);
+        }
+        else if (YuvSourceFormat::YuvSourceFormat_NV12 == Format)
+        {
+            *y = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pY + x)));
+            __m128i c = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pCb + x)));
+            *cb = _mm_shuffle_epi8(c, cbMask);
+            *cr = _mm_shuffle_epi8(c, crMask);
+        }
+        else
+        {
+            *y = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pY + x)));
+
+            int32_t cb4, cr4;
+            memcpy(&cb4, pCb + x / 2, sizeof(cb4));
+            memcpy(&cr4, pCr + x / 2, sizeof(cr4));
+            __m128i cbs = _mm_cvtepu8_epi16(_mm_cvtsi32_si128(cb4));
+            __m128i crs = _mm_cvtepu8_epi16(_mm_cvtsi32_si128(cr4));
+            *cb = _mm_unpacklo_epi16(cbs, cbs);
+            *cr = _mm_unpacklo_epi16(crs, crs);
+        }
+    }
+
+    // unrounded fixed point r, g, b for pixels 0..3 ([0]) and 4..7 ([1])
+    YUV_SSE41 inline void ComputeFixed(
+        const Sse41Constants& k,
+        __m128i y,
+        __m128i cb,
+        __m128i cr,
+        __m128i r[2],
+        __m128i g[2],
+        __m128i b[2])
+    {
+        y = _mm_sub_epi16(y, k.yOffset);
+        cb = _mm_sub_epi16(cb, k.cOffset);
+        cr = _mm_sub_epi16(cr, k.cOffset);
+
+        const __m128i zero = _mm_setzero_si128();
+
+        __m128i yCrLo = _mm_unpacklo_epi16(y, cr);
+        __m128i yCrHi = _mm_unpackhi_epi16(y, cr);
+        __m128i yCbLo = _mm_unpacklo_epi16(y, cb);
+        __m128i yCbHi = _mm_unpackhi_epi16(y, cb);
+        __m128i crLo = _mm_unpacklo_epi16(cr, zero);
+        __m128i crHi = _mm_unpackhi_epi16(cr, zero);
+
+        r[0] = _mm_madd_epi16(yCrLo, k.yCrToR);
+        r[1] = _mm_madd_epi16(yCrHi, k.yCrToR);
+        g[0] = _mm_add_epi32(_mm_madd_epi16(yCbLo, k.yCbToG), _mm_madd_epi16(crLo, k.crToG));
+        g[1] = _mm_add_epi32(_mm_madd_epi16(yCbHi, k.yCbToG), _mm_madd_epi16(crHi, k.crToG));
+        b[0] = _mm_madd_epi16(yCbLo, k.yCbToB);
+        b[1] = _mm_madd_epi16(yCbHi, k.yCbToB);
+    }
+
+    YUV_SSE41 inline __m128i ToBytes(const Sse41Constants& k, const __m128i v[2])
+    {
+        __m128i lo = _mm_srai_epi32(_mm_add_epi32(v[0], k.round), YUV_COEFFICIENT_SHIFT);
+        __m128i hi = _mm_srai_epi32(_mm_add_epi32(v[1], k.round), YUV_COEFFICIENT_SHIFT);
+        __m128i words = _mm_packs_epi32(lo, hi);
+        return _mm_packus_epi16(words, words);
+    }
+
+    // same steps as YuvFloatToHalf
+    YUV_SSE41 inline __m128i ToHalf(__m128i fixed)
+    {
+        __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(fixed), _mm_set1_ps(YUV_HALF_SCALE));
+        f = _mm_min_ps(_mm_max_ps(f, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+        const __m128i magic = _mm_set1_epi32(126 << 23);
+        __m128i bits = _mm_castps_si128(f);
+        __m128i isDenormal = _mm_cmplt_epi32(bits, _mm_set1_epi32(113 << 23));
+        __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(f, _mm_castsi128_ps(magic))), magic);
+
+        __m128i mantissaOdd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+        __m128i normal = _mm_add_epi32(bits, _mm_set1_epi32(static_cast<int32_t>(YUV_HALF_REBIAS)));
+        normal = _mm_srli_epi32(_mm_add_epi32(normal, mantissaOdd), 13);
+
+        return _mm_blendv_epi8(normal, denormal, isDenormal);
+    }
+
+    YUV_SSE41 inline __m128i ToHalfWords(const __m128i v[2])
+    {
+        return _mm_packus_epi32(ToHalf(v[0]), ToHalf(v[1]));
+    }
+
+    template <YuvSourceFormat Format, RgbDestinationFormat Destination>
+    YUV_SSE41 void YuvRowSse41(
+        const uint8_t* pY,
+        const uint8_t* pCb,
+        const uint8_t* pCr,
+        uint8_t* pDestination,
+        uint32_t begin,
+        uint32_t end,
+        const YUV_COEFFICIENTS& c)
+    {
+        YuvRowKernel scalar = GetYuvRowKernelScalar(Format, Destination);
+
+        // simd loads start on a chroma pair
+        uint32_t x = begin;
+        if ((x & 1) && x < end)
+        {
+            scalar(pY, pCb, pCr, pDestination, x, x + 1, c);
+            ++x;
+        }
+
+        const Sse41Constants k = MakeConstants(c);
+
+        for (; x + 8 <= end; x += 8)
+        {
+            __m128i y, cb, cr;
+            LoadPixels<Format>(pY, pCb, pCr, x, &y, &cb, &cr);
+
+            __m128i r[2], g[2], b[2];
+            ComputeFixed(k, y, cb, cr, r, g, b);
+
+            if (RgbDestinationFormat::RgbDestinationFormat_BGRA8 == Destination)
+            {
+                __m128i bg = _mm_unpacklo_epi8(ToBytes(k, b), ToBytes(k, g));
+                __m128i ra = _mm_unpacklo_epi8(ToBytes(k, r), _mm_set1_epi8(static_cast<char>(0xFF)));
+
+                __m128i* pOut = reinterpret_cast<__m128i*>(pDestination + x * 4);
+                _mm_storeu_si128(pOut, _mm_unpacklo_epi16(bg, ra));
+                _mm_storeu_si128(pOut + 1, _mm_unpackhi_epi16(bg, ra));
+            }
+            else
+            {
+                __m128i rh = ToHalfWords(r);
+                __m128i gh = ToHalfWords(g);
+                __m128i bh = ToHalfWords(b);
+                __m128i ah = _mm_set1_epi16(YUV_HALF_ONE);
+
+                __m128i rg = _mm_unpacklo_epi16(rh, gh);
+                __m128i rgHi = _mm_unpackhi_epi16(rh, gh);
+                __m128i ba = _mm_unpacklo_epi16(bh, ah);
+                __m128i baHi = _mm_unpackhi_epi16(bh, ah);
+
+                __m128i* pOut = reinterpret_cast<__m128i*>(pDestination + x * 8);
+                _mm_storeu_si128(pOut, _mm_unpacklo_epi32(rg, ba));
+                _mm_storeu_si128(pOut + 1, _mm_unpackhi_epi32(rg, ba));
+                _mm_storeu_si128(pOut + 2, _mm_unpacklo_epi32(rgHi, baHi));
+                _mm_storeu_si128(pOut + 3, _mm_unpackhi_epi32(rgHi, baHi));
+            }
+        }
+
+        if (x < end)
+        {
+            scalar(pY, pCb, pCr, pDestination, x, end, c);
+        }
+    }
+}
+
+YuvRowKernel GetYuvRowKernelSse41(YuvSourceFormat source, RgbDestinationFormat destination)
+{
+    const bool half = (RgbDestinationFormat::RgbDestinationFormat_RGBA16F == destination);
+
+    switch (source)
+    {
+    case YuvSourceFormat::YuvSourceFormat_NV12:
+        return half
+            ? YuvRowSse41<YuvSourceFormat::YuvSourceFormat_NV12, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowSse41<YuvSourceFormat::YuvSourceFormat_NV12, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    case YuvSourceFormat::YuvSourceFormat_I420:
+        return half
+            ? YuvRowSse41<YuvSourceFormat::YuvSourceFormat_I420, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowSse41<YuvSourceFormat::YuvSourceFormat_I420, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    case YuvSourceFormat::YuvSourceFormat_P010:
+        return half
+            ? YuvRowSse41<YuvSourceFormat::YuvSourceFormat_P010, RgbDestinationFormat::RgbDestinationFormat_RGBA16F>
+            : YuvRowSse41<YuvSourceFormat::YuvSourceFormat_P010, RgbDestinationFormat::RgbDestinationFormat_BGRA8>;
+    }
+
+    return nullptr;
+}
+
+#else
+
+YuvRowKernel GetYuvRowKernelSse41(YuvSourceFormat, RgbDestinationFormat)
+{
+    return nullptr;
+}
+
+#endif
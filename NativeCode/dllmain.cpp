@@ -12,6 +12,9 @@
 #include "pch.h"
 #include "Unity/PlatformBase.h"
 #include "MediaPlayerPlayback.h"
+#include "PlaybackRegistry.h"
+#include "PreloadCache.h"
+#include "VideoBundle.h"
 
 using namespace Microsoft::WRL;
 
@@ -19,7 +22,8 @@ static UnityGfxRenderer s_DeviceType = kUnityGfxRenderernullptr;
 static IUnityInterfaces* s_UnityInterfaces = nullptr;
 static IUnityGraphics* s_Graphics = nullptr;
 
-static ComPtr<IMediaPlayerPlayback> s_spMediaPlayback;
+// player used by the single player exports, see CreateMediaPlayback
+static std::atomic<HPLAYBACK> s_hDefaultPlayback(HPLAYBACK_INVALID);
 static float g_Time;
 
 
@@ -58,94 +62,715 @@ STDAPI DllCanUnloadNow()
 }
 
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreateMediaPlayback(_In_ StateChangedCallback fnCallback)
+// --------------------------------------------------------------------------
+// Handle based api, one entry in the playback registry per player
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerCreateEx(_In_ StateChangedCallback fnCallback, _In_ PlaybackBackend backend, _Out_ HPLAYBACK* phPlayback)
 {
+    NULL_CHK(phPlayback);
+
+    *phPlayback = HPLAYBACK_INVALID;
+
     ComPtr<IMediaPlayerPlayback> spPlayerPlayback;
-    IFR(CMediaPlayerPlayback::CreateMediaPlayback(s_DeviceType, s_UnityInterfaces, fnCallback, &spPlayerPlayback));
+    IFR(CMediaPlayerPlayback::CreateMediaPlayback(s_DeviceType, s_UnityInterfaces, backend, fnCallback, &spPlayerPlayback));
 
-    s_spMediaPlayback.Attach(spPlayerPlayback.Detach());
+    IFR(RegisterPlayback(spPlayerPlayback.Get(), phPlayback));
 
     return S_OK;
 }
 
-extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ReleaseMediaPlayback()
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerCreate(_In_ StateChangedCallback fnCallback, _Out_ HPLAYBACK* phPlayback)
+{
+    return PlayerCreateEx(fnCallback, PlaybackBackend::PlaybackBackend_Auto, phPlayback);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerRelease(_In_ HPLAYBACK hPlayback)
+{
+    return UnregisterPlayback(hPlayback);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerCreatePlaybackTexture(_In_ HPLAYBACK hPlayback, _In_ UINT32 width, _In_ UINT32 height, _COM_Outptr_ void** ppvTexture)
+{
+    NULL_CHK(ppvTexture);
+
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(LookupPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->CreatePlaybackTexture(width, height, ppvTexture);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerLoadContent(_In_ HPLAYBACK hPlayback, _In_ LPCWSTR pszContentLocation)
+{
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(LookupPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->LoadContent(pszContentLocation);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerPlay(_In_ HPLAYBACK hPlayback)
+{
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(LookupPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->Play();
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerPause(_In_ HPLAYBACK hPlayback)
+{
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(LookupPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->Pause();
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerStop(_In_ HPLAYBACK hPlayback)
+{
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(LookupPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->Stop();
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetPosition(_In_ HPLAYBACK hPlayback, _Out_ LONGLONG* position)
+{
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(LookupPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->GetPosition(position);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetDuration(_In_ HPLAYBACK hPlayback, _Out_ LONGLONG* duration)
+{
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(LookupPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->GetDuration(duration);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetPosition(_In_ HPLAYBACK hPlayback, _In_ LONGLONG position)
+{
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(LookupPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->SetPosition(position);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetPlaybackRate(_In_ HPLAYBACK hPlayback, _Out_ DOUBLE* rate)
+{
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(LookupPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->GetPlaybackRate(rate);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetPlaybackRate(_In_ HPLAYBACK hPlayback, _In_ DOUBLE rate)
+{
+    ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+    IFR(LookupPlayback(hPlayback, &spMediaPlayback));
+
+    return spMediaPlayback->SetPlaybackRate(rate);
+}
+
+// format is a PlaybackOutputFormat; planar formats return the luma plane in ppvTexture and the
+// interleaved chroma plane in ppvChromaTexture, to be combined by YUVPlanar.shader.
+// Created at the size the video opened with, the output is resized when the video changes
+// size mid stream, see StateType_ResolutionChanged. Other sizes are kept and frames scaled.
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerCreatePlaybackTextureEx(_In_ HPLAYBACK hPlayback, _In_ UINT32 width, _In_ UINT32 height, _In_ UINT32 format, _COM_Outptr_ void** ppvTexture, _COM_Outptr_opt_result_maybenull_ void** ppvChromaTexture)
+{
+    NULL_CHK(ppvTexture);
+
+    ComPtr<IMediaPlayerPlaybackOutput> spPlaybackOutput;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaybackOutput)));
+
+    return spPlaybackOutput->CreatePlaybackTextureEx(width, height, static_cast<PlaybackOutputFormat>(format), ppvTexture, ppvChromaTexture);
+}
+
+// srv unity should currently sample, changes after a render event latched a new frame.
+// The pointer is not AddRef'd and stays valid until the texture is recreated or the player released.
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetPlaybackTexture(_In_ HPLAYBACK hPlayback, _Outptr_result_maybenull_ void** ppvTexture)
+{
+    NULL_CHK(ppvTexture);
+
+    *ppvTexture = nullptr;
+
+    ComPtr<IMediaPlayerPlaybackOutput> spPlaybackOutput;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaybackOutput)));
+
+    return spPlaybackOutput->GetPlaybackTexture(ppvTexture);
+}
+
+// as PlayerGetPlaybackTexture, also returns the chroma plane of planar output
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetPlaybackPlanes(_In_ HPLAYBACK hPlayback, _Outptr_result_maybenull_ void** ppvTexture, _Outptr_result_maybenull_ void** ppvChromaTexture)
+{
+    NULL_CHK(ppvTexture);
+    NULL_CHK(ppvChromaTexture);
+
+    *ppvTexture = nullptr;
+    *ppvChromaTexture = nullptr;
+
+    ComPtr<IMediaPlayerPlaybackOutput> spPlaybackOutput;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaybackOutput)));
+
+    return spPlaybackOutput->GetPlaybackPlanes(ppvTexture, ppvChromaTexture);
+}
+
+// copies every latched frame into cpu readable memory on the render thread, without stalling it
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetReadbackEnabled(_In_ HPLAYBACK hPlayback, _In_ BOOL enabled)
+{
+    ComPtr<IMediaPlayerPlaybackOutput> spPlaybackOutput;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaybackOutput)));
+
+    return spPlaybackOutput->SetReadbackEnabled(enabled);
+}
+
+// newest frame read back since the last call, S_FALSE if there is none. frame->data stays
+// mapped until PlayerReleaseReadbackFrame(frame->frameId), the texture is recreated or readback disabled.
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerAcquireReadbackFrame(_In_ HPLAYBACK hPlayback, _Out_ PLAYBACK_READBACK_FRAME* pFrame)
+{
+    NULL_CHK(pFrame);
+
+    ComPtr<IMediaPlayerPlaybackOutput> spPlaybackOutput;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaybackOutput)));
+
+    return spPlaybackOutput->AcquireReadbackFrame(pFrame);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerReleaseReadbackFrame(_In_ HPLAYBACK hPlayback, _In_ UINT64 frameId)
+{
+    ComPtr<IMediaPlayerPlaybackOutput> spPlaybackOutput;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaybackOutput)));
+
+    return spPlaybackOutput->ReleaseReadbackFrame(frameId);
+}
+
+// event id for GL.IssuePluginEvent(GetRenderEventFunc(), id), op is a PlaybackRenderOp
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetRenderEventId(_In_ HPLAYBACK hPlayback, _In_ UINT32 op, _Out_ INT32* pEventId)
+{
+    NULL_CHK(pEventId);
+
+    return MakeRenderEventId(hPlayback, static_cast<PlaybackRenderOp>(op), pEventId);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetPresentationStats(_In_ HPLAYBACK hPlayback, _Out_ PLAYBACK_PRESENTATION_STATS* pStats)
+{
+    NULL_CHK(pStats);
+
+    ComPtr<IMediaPlayerPlaybackOutput> spPlaybackOutput;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaybackOutput)));
+
+    return spPlaybackOutput->GetPresentationStats(pStats);
+}
+
+// players created without a callback queue their state events, script drains them once a frame
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerDrainEvents(_In_ HPLAYBACK hPlayback, _Out_writes_to_(capacity, *pCount) PLAYBACK_STATE* pEvents, _In_ UINT32 capacity, _Out_ UINT32* pCount)
+{
+    NULL_CHK(pCount);
+
+    *pCount = 0;
+
+    ComPtr<IMediaPlayerPlaybackEvents> spPlaybackEvents;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaybackEvents)));
+
+    return spPlaybackEvents->DrainEvents(pEvents, capacity, pCount);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetStatus(_In_ HPLAYBACK hPlayback, _Out_ PLAYBACK_STATUS* pStatus)
+{
+    NULL_CHK(pStatus);
+
+    ComPtr<IMediaPlayerPlaybackEvents> spPlaybackEvents;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaybackEvents)));
+
+    IFR(spPlaybackEvents->GetStatus(pStatus));
+
+    pStatus->handle = hPlayback;
+
+    return S_OK;
+}
+
+typedef struct _STATUS_BUFFER
+{
+    PLAYBACK_STATUS* pStatus;
+    UINT32 capacity;
+    UINT32 count;
+    bool truncated;
+} STATUS_BUFFER;
+
+static void CopyPlaybackStatus(_In_ HPLAYBACK hPlayback, _In_ IMediaPlayerPlayback* pMediaPlayback, _In_opt_ void* pContext)
 {
-    if (s_spMediaPlayback != nullptr)
+    STATUS_BUFFER* pBuffer = static_cast<STATUS_BUFFER*>(pContext);
+    if (pBuffer->count >= pBuffer->capacity)
     {
-        s_spMediaPlayback.Reset();
-        s_spMediaPlayback = nullptr;
+        pBuffer->truncated = true;
+        return;
+    }
+
+    ComPtr<IMediaPlayerPlaybackEvents> spPlaybackEvents;
+    if (FAILED(pMediaPlayback->QueryInterface(IID_PPV_ARGS(&spPlaybackEvents))))
+    {
+        return;
+    }
+
+    PLAYBACK_STATUS* pStatus = &pBuffer->pStatus[pBuffer->count];
+    if (SUCCEEDED(spPlaybackEvents->GetStatus(pStatus)))
+    {
+        pStatus->handle = hPlayback;
+        pBuffer->count++;
     }
 }
 
-extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreatePlaybackTexture(_In_ UINT32 width, _In_ UINT32 height, _COM_Outptr_ void** ppvTexture)
+// one call per frame for every player's status, no player lock is taken.
+// Returns S_FALSE when there were more players than capacity, see PlayerGetCount.
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetAllStatus(_Out_writes_to_(capacity, *pCount) PLAYBACK_STATUS* pStatus, _In_ UINT32 capacity, _Out_ UINT32* pCount)
+{
+    NULL_CHK(pCount);
+
+    *pCount = 0;
+
+    if (0 == capacity)
+    {
+        return (0 == GetPlaybackCount()) ? S_OK : S_FALSE;
+    }
+
+    NULL_CHK(pStatus);
+
+    STATUS_BUFFER buffer = { pStatus, capacity, 0, false };
+    ForEachPlayback(CopyPlaybackStatus, &buffer);
+
+    *pCount = buffer.count;
+
+    return buffer.truncated ? S_FALSE : S_OK;
+}
+
+// reset starts a new interval right after the snapshot, for dashboards computing rates
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetPlaybackStats(_In_ HPLAYBACK hPlayback, _Out_ PLAYBACK_STATS* pStats, _In_ BOOL reset)
+{
+    NULL_CHK(pStats);
+
+    ComPtr<IMediaPlayerPlaybackEvents> spPlaybackEvents;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaybackEvents)));
+
+    return spPlaybackEvents->GetPlaybackStats(pStats, reset);
+}
+
+extern "C" UINT32 UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetCount()
+{
+    return GetPlaybackCount();
+}
+
+// --------------------------------------------------------------------------
+// Playlists. LoadContent starts a list of one, items added after it are opened
+// ahead of their turn and play on without a gap or new textures.
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerPlaylistAppend(_In_ HPLAYBACK hPlayback, _In_ LPCWSTR pszContentLocation)
+{
+    ComPtr<IMediaPlayerPlaylist> spPlaylist;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaylist)));
+
+    return spPlaylist->PlaylistAppend(pszContentLocation);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerPlaylistInsert(_In_ HPLAYBACK hPlayback, _In_ UINT32 index, _In_ LPCWSTR pszContentLocation)
+{
+    ComPtr<IMediaPlayerPlaylist> spPlaylist;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaylist)));
+
+    return spPlaylist->PlaylistInsert(index, pszContentLocation);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerPlaylistRemove(_In_ HPLAYBACK hPlayback, _In_ UINT32 index)
+{
+    ComPtr<IMediaPlayerPlaylist> spPlaylist;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaylist)));
+
+    return spPlaylist->PlaylistRemove(index);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerPlaylistMoveTo(_In_ HPLAYBACK hPlayback, _In_ UINT32 index)
+{
+    ComPtr<IMediaPlayerPlaylist> spPlaylist;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaylist)));
+
+    return spPlaylist->PlaylistMoveTo(index);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetPlaylistRepeat(_In_ HPLAYBACK hPlayback, _In_ PlaylistRepeat repeat)
+{
+    ComPtr<IMediaPlayerPlaylist> spPlaylist;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaylist)));
+
+    return spPlaylist->SetPlaylistRepeat(repeat);
+}
+
+// 100ns units, 0 goes back to the media foundation default
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetPlaylistPrefetchTime(_In_ HPLAYBACK hPlayback, _In_ INT64 prefetchTime)
+{
+    ComPtr<IMediaPlayerPlaylist> spPlaylist;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spPlaylist)));
+
+    return spPlaylist->SetPlaylistPrefetchTime(prefetchTime);
+}
+
+// --------------------------------------------------------------------------
+// Adaptive streaming (HLS / DASH). The manifest loads in the background, the
+// Opened or Failed event follows as with PlayerLoadContent.
+
+// pSettings is optional, zeros keep the source's defaults
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerLoadAdaptiveContent(_In_ HPLAYBACK hPlayback, _In_ LPCWSTR pszManifestLocation, _In_opt_ const PLAYBACK_ADAPTIVE_SETTINGS* pSettings)
+{
+    ComPtr<IMediaPlayerAdaptive> spAdaptive;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spAdaptive)));
+
+    return spAdaptive->LoadAdaptiveContent(pszManifestLocation, pSettings);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetAdaptiveStats(_In_ HPLAYBACK hPlayback, _Out_ PLAYBACK_ADAPTIVE_STATS* pStats, _In_ BOOL reset)
+{
+    NULL_CHK(pStats);
+
+    ComPtr<IMediaPlayerAdaptive> spAdaptive;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spAdaptive)));
+
+    return spAdaptive->GetAdaptiveStats(pStats, reset);
+}
+
+// --------------------------------------------------------------------------
+// Keyframe seeking, see KeyframeIndex.h. Local mp4 / mov items are indexed in
+// the background when added, the times are for snapping a scrub bar.
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetSeekMode(_In_ HPLAYBACK hPlayback, _In_ PlaybackSeekMode mode)
+{
+    ComPtr<IMediaPlayerSeeking> spSeeking;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spSeeking)));
+
+    return spSeeking->SetSeekMode(mode);
+}
+
+// S_FALSE while the current item is still being indexed. Returns the total
+// in pCount, call with no buffer to size one.
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetKeyframeTimes(_In_ HPLAYBACK hPlayback, _Out_writes_to_opt_(capacity, *pCount) INT64* pTimes, _In_ UINT32 capacity, _Out_ UINT32* pCount)
+{
+    NULL_CHK(pCount);
+
+    ComPtr<IMediaPlayerSeeking> spSeeking;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spSeeking)));
+
+    return spSeeking->GetKeyframeTimes(pTimes, capacity, pCount);
+}
+
+// --------------------------------------------------------------------------
+// Frame stepping, see CFrameCache. Steps pause playback; with a budget the
+// frames decoded on the way are kept, so stepping back over them is a copy.
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerStepFrames(_In_ HPLAYBACK hPlayback, _In_ INT32 frames)
+{
+    ComPtr<IMediaPlayerSeeking> spSeeking;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spSeeking)));
+
+    return spSeeking->StepFrames(frames);
+}
+
+// bytes of video memory for cached frames, 0 (the default) turns the cache off
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetFrameCacheBudget(_In_ HPLAYBACK hPlayback, _In_ INT64 budget)
+{
+    ComPtr<IMediaPlayerSeeking> spSeeking;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spSeeking)));
+
+    return spSeeking->SetFrameCacheBudget(budget);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetFrameCacheStats(_In_ HPLAYBACK hPlayback, _Out_ PLAYBACK_FRAME_CACHE_STATS* pStats, _In_ BOOL reset)
+{
+    NULL_CHK(pStats);
+
+    ComPtr<IMediaPlayerSeeking> spSeeking;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spSeeking)));
+
+    return spSeeking->GetFrameCacheStats(pStats, reset);
+}
+
+// --------------------------------------------------------------------------
+// Read ahead, see ReadAheadBuffer.h. Local files loaded after it is set are
+// read ahead of the demuxer by a thread of their own, for disks too slow or
+// uneven to keep up as it reads.
+
+// window in bytes, or in time (100ns units) turned into bytes at the file's
+// average bitrate once it has opened; bytes apply until then. Both 0 (the
+// default) reads files through the mapped view again from the next load.
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetReadAhead(_In_ HPLAYBACK hPlayback, _In_ INT64 window, _In_ INT64 duration)
+{
+    ComPtr<IMediaPlayerSources> spSources;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spSources)));
+
+    return spSources->SetReadAhead(window, duration);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetReadAheadStats(_In_ HPLAYBACK hPlayback, _Out_ PLAYBACK_READ_AHEAD_STATS* pStats, _In_ BOOL reset)
+{
+    NULL_CHK(pStats);
+
+    ComPtr<IMediaPlayerSources> spSources;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spSources)));
+
+    return spSources->GetReadAheadStats(pStats, reset);
+}
+
+// --------------------------------------------------------------------------
+// Bundles, see VideoBundle.h. Many short clips packed into one file with an
+// index written when packing, a load from one opens nothing and probes
+// nothing. Opened or Failed event follows as with PlayerLoadContent.
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerPackBundle(_In_ LPCWSTR pszDirectory, _In_ LPCWSTR pszBundlePath)
+{
+    return PackVideoBundle(pszDirectory, pszBundlePath);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetBundleClip(_In_ LPCWSTR pszBundlePath, _In_ LPCWSTR pszName, _Out_ PLAYBACK_BUNDLE_CLIP* pClip)
+{
+    return GetVideoBundleClip(pszBundlePath, pszName, pClip);
+}
+
+// players already playing from the bundle keep it mapped until they load something else
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerCloseBundle(_In_ LPCWSTR pszBundlePath)
+{
+    return CloseVideoBundle(pszBundlePath);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerLoadContentFromBundle(_In_ HPLAYBACK hPlayback, _In_ LPCWSTR pszBundlePath, _In_ LPCWSTR pszName)
+{
+    ComPtr<IMediaPlayerSources> spSources;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spSources)));
+
+    return spSources->LoadContentFromBundle(pszBundlePath, pszName);
+}
+
+// --------------------------------------------------------------------------
+// Thumbnails, see ThumbnailGenerator.h. Decoded on the thread pool apart from
+// the player, progress and completion arrive as state events of the player
+// that asked. Complete atlases of local files are kept in the cache directory.
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGenerateThumbnails(_In_ HPLAYBACK hPlayback, _In_ LPCWSTR pszContentLocation, _In_ UINT32 count, _In_ UINT32 width, _In_ UINT32 height)
+{
+    ComPtr<IMediaPlayerThumbnails> spThumbnails;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spThumbnails)));
+
+    return spThumbnails->GenerateThumbnails(pszContentLocation, count, width, height);
+}
+
+// pass null pixels and times to get the atlas size, pixels are 32bpp bgra top row first
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetThumbnails(_In_ HPLAYBACK hPlayback, _Out_ PLAYBACK_THUMBNAILS* pInfo, _Out_writes_bytes_opt_(size) BYTE* pPixels, _In_ UINT32 size, _Out_writes_opt_(capacity) INT64* pTimes, _In_ UINT32 capacity)
+{
+    NULL_CHK(pInfo);
+
+    ComPtr<IMediaPlayerThumbnails> spThumbnails;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spThumbnails)));
+
+    return spThumbnails->GetThumbnails(pInfo, pPixels, size, pTimes, capacity);
+}
+
+// the atlas as it is now on unity's device, for Texture2D.CreateExternalTexture
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerCreateThumbnailTexture(_In_ HPLAYBACK hPlayback, _Outptr_result_maybenull_ void** ppvTexture)
 {
     NULL_CHK(ppvTexture);
-    NULL_CHK(s_spMediaPlayback);
 
-    return s_spMediaPlayback->CreatePlaybackTexture(width, height, ppvTexture);
+    *ppvTexture = nullptr;
+
+    ComPtr<IMediaPlayerThumbnails> spThumbnails;
+    IFR(LookupPlayback(hPlayback, IID_PPV_ARGS(&spThumbnails)));
+
+    return spThumbnails->CreateThumbnailTexture(ppvTexture);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetThumbnailCacheDirectory(_In_ LPCWSTR pszDirectory)
+{
+    return SetThumbnailCacheDirectory(pszDirectory);
+}
+
+// --------------------------------------------------------------------------
+// Tracing, see Trace.h. Off until script turns it on, the file written is
+// chrome://tracing / Perfetto json.
+
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetTraceEnabled(_In_ BOOL enabled)
+{
+    TraceSetEnabled(!!enabled);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerWriteTrace(_In_ LPCWSTR pszPath)
+{
+    NULL_CHK(pszPath);
+
+    std::string json = TraceToJson();
+
+    HANDLE hFile = CreateFileW(pszPath, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (INVALID_HANDLE_VALUE == hFile)
+    {
+        IFR(HRESULT_FROM_WIN32(GetLastError()));
+    }
+
+    DWORD written = 0;
+    HRESULT hr = S_OK;
+    if (!WriteFile(hFile, json.data(), static_cast<DWORD>(json.size()), &written, nullptr))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    CloseHandle(hFile);
+
+    IFR(hr);
+
+    return S_OK;
+}
+
+// --------------------------------------------------------------------------
+// Preloading, see PreloadCache.h. Sources are opened ahead of time and handed
+// to whichever player loads the same url first.
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerPreloadContent(_In_ LPCWSTR pszContentLocation)
+{
+    return StartPreload(pszContentLocation);
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetPreloadLimits(_In_ INT64 capacity, _In_ UINT32 maxEntries)
+{
+    return SetPreloadLimits(capacity, maxEntries);
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerClearPreloads()
+{
+    ClearPreloads();
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetPreloadStats(_Out_ PLAYBACK_PRELOAD_STATS* pStats)
+{
+    NULL_CHK(pStats);
+
+    GetPreloadStats(pStats);
+
+    return S_OK;
+}
+
+// --------------------------------------------------------------------------
+// Media devices, see MediaDevicePool.h. Players on the same adapter share one
+// media device, kept after the last player is released for the next one.
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetDeviceStats(_Out_ PLAYBACK_DEVICE_STATS* pStats)
+{
+    NULL_CHK(pStats);
+
+    GetMediaDeviceStats(pStats);
+
+    return S_OK;
+}
+
+// releases the devices no player holds, the next player created on their adapter makes a new one
+extern "C" UINT32 UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerTrimDevices()
+{
+    return TrimMediaDevices();
+}
+
+// --------------------------------------------------------------------------
+// Texture pool, see TexturePool.h. Output textures a player lets go of are
+// kept for the next CreatePlaybackTexture of the same size and format.
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerSetTexturePoolBudget(_In_ INT64 budget)
+{
+    return CMediaPlayerPlayback::SetTexturePoolBudget(budget);
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerClearTexturePool()
+{
+    CMediaPlayerPlayback::ClearTexturePool();
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PlayerGetTexturePoolStats(_Out_ PLAYBACK_TEXTURE_POOL_STATS* pStats)
+{
+    NULL_CHK(pStats);
+
+    CMediaPlayerPlayback::GetTexturePoolStats(pStats);
+
+    return S_OK;
+}
+
+// --------------------------------------------------------------------------
+// Single player api, kept for existing scripts. Forwards to the player
+// registered under s_hDefaultPlayback.
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreateMediaPlayback(_In_ StateChangedCallback fnCallback)
+{
+    HPLAYBACK hPlayback = HPLAYBACK_INVALID;
+    IFR(PlayerCreate(fnCallback, &hPlayback));
+
+    HPLAYBACK hPrevious = s_hDefaultPlayback.exchange(hPlayback);
+    if (HPLAYBACK_INVALID != hPrevious)
+    {
+        UnregisterPlayback(hPrevious);
+    }
+
+    return S_OK;
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API ReleaseMediaPlayback()
+{
+    HPLAYBACK hPrevious = s_hDefaultPlayback.exchange(HPLAYBACK_INVALID);
+    if (HPLAYBACK_INVALID != hPrevious)
+    {
+        UnregisterPlayback(hPrevious);
+    }
+}
+
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API CreatePlaybackTexture(_In_ UINT32 width, _In_ UINT32 height, _COM_Outptr_ void** ppvTexture)
+{
+    return PlayerCreatePlaybackTexture(s_hDefaultPlayback, width, height, ppvTexture);
 }
 
 extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API LoadContent(_In_ LPCWSTR pszContentLocation)
 {
-    NULL_CHK(s_spMediaPlayback);
+    return PlayerLoadContent(s_hDefaultPlayback, pszContentLocation);
+}
 
-    return s_spMediaPlayback->LoadContent(pszContentLocation);
+extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API PreloadContent(_In_ LPCWSTR pszContentLocation)
+{
+    return PlayerPreloadContent(pszContentLocation);
 }
 
 extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Play()
 {
-    NULL_CHK(s_spMediaPlayback);
-
-    return s_spMediaPlayback->Play();
+    return PlayerPlay(s_hDefaultPlayback);
 }
 
 extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Pause()
 {
-    NULL_CHK(s_spMediaPlayback);
-
-    return s_spMediaPlayback->Pause();
+    return PlayerPause(s_hDefaultPlayback);
 }
 
 extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API Stop()
 {
-    NULL_CHK(s_spMediaPlayback);
-
-    return s_spMediaPlayback->Stop();
+    return PlayerStop(s_hDefaultPlayback);
 }
 
 extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPosition(_Out_ LONGLONG* position)
 {
-	NULL_CHK(s_spMediaPlayback);
-
-	return s_spMediaPlayback->GetPosition(position);
+    return PlayerGetPosition(s_hDefaultPlayback, position);
 }
 
 extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetDuration(_Out_ LONGLONG* duration)
 {
-	NULL_CHK(s_spMediaPlayback);
-
-	return s_spMediaPlayback->GetDuration(duration);
+    return PlayerGetDuration(s_hDefaultPlayback, duration);
 }
 
 extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetPosition(_In_ LONGLONG position)
 {
-	NULL_CHK(s_spMediaPlayback);
-
-	return s_spMediaPlayback->SetPosition(position);
+    return PlayerSetPosition(s_hDefaultPlayback, position);
 }
 
 extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API GetPlaybackRate(_Out_ DOUBLE* rate)
 {
-	NULL_CHK(s_spMediaPlayback);
-
-	return s_spMediaPlayback->GetPlaybackRate(rate);
+    return PlayerGetPlaybackRate(s_hDefaultPlayback, rate);
 }
 
 extern "C" HRESULT UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetPlaybackRate(_In_ DOUBLE rate)
 {
-	NULL_CHK(s_spMediaPlayback);
-
-	return s_spMediaPlayback->SetPlaybackRate(rate);
+    return PlayerSetPlaybackRate(s_hDefaultPlayback, rate);
 }
 
 // --------------------------------------------------------------------------
@@ -180,23 +805,85 @@ extern "C" void	UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnit
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginUnload()
 {
     s_Graphics->UnregisterDeviceEventCallback(OnGraphicsDeviceEvent);
+
+    // release the warmed sources while media foundation is still around
+    ClearPreloads();
+
+    // and the pooled textures and devices, players still alive keep theirs
+    CMediaPlayerPlayback::ClearTexturePool();
+    TrimMediaDevices();
 }
 
 
 // --------------------------------------------------------------------------
-// SetTimeFromUnity, an example function we export which is called by one of the scripts.
+// SetTimeFromUnity, called by the scripts once per frame before the render event.
+// Every player paces its frames against this clock from then on.
+static void SetPlaybackClock(_In_ HPLAYBACK hPlayback, _In_ IMediaPlayerPlayback* pMediaPlayback, _In_opt_ void* pContext)
+{
+    UNREFERENCED_PARAMETER(hPlayback);
+
+    ComPtr<IMediaPlayerPlaybackOutput> spPlaybackOutput;
+    if (SUCCEEDED(pMediaPlayback->QueryInterface(IID_PPV_ARGS(&spPlaybackOutput))))
+    {
+        LOG_RESULT(spPlaybackOutput->SetPresentationClock(*static_cast<INT64*>(pContext)));
+    }
+}
+
 extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API SetTimeFromUnity(float t)
 { 
     g_Time = t;
+
+    // seconds to 100ns units
+    INT64 clock = static_cast<INT64>(static_cast<double>(t) * 10000000.0);
+    ForEachPlayback(SetPlaybackClock, &clock);
 }
 
 // --------------------------------------------------------------------------
 // OnRenderEvent
 // This will be called for GL.IssuePluginEvent script calls; eventID will
-// be the integer passed to IssuePluginEvent. In this example, we just ignore
-// that value.
+// be the integer passed to IssuePluginEvent. Runs on unity's render thread,
+// which owns the unity device context, so this is where players move their
+// output to the newest decoded slot. See PlaybackRenderOp for the id layout.
+static void LatchPlaybackFrame(_In_ HPLAYBACK hPlayback, _In_ IMediaPlayerPlayback* pMediaPlayback, _In_opt_ void* pContext)
+{
+    UNREFERENCED_PARAMETER(hPlayback);
+    UNREFERENCED_PARAMETER(pContext);
+
+    ComPtr<IMediaPlayerPlaybackOutput> spPlaybackOutput;
+    if (SUCCEEDED(pMediaPlayback->QueryInterface(IID_PPV_ARGS(&spPlaybackOutput))))
+    {
+        LOG_RESULT(spPlaybackOutput->LatchFrame());
+    }
+}
+
 static void UNITY_INTERFACE_API OnRenderEvent(int eventID)
 {
+    PlaybackRenderOp op;
+    UINT32 handleBits;
+    ParseRenderEventId(eventID, &op, &handleBits);
+
+    switch (op)
+    {
+    case PlaybackRenderOp::PlaybackRenderOp_LatchAll:
+        ForEachPlayback(LatchPlaybackFrame, nullptr);
+        break;
+
+    case PlaybackRenderOp::PlaybackRenderOp_Latch:
+    {
+        // the player may have been released since script queued the event
+        ComPtr<IMediaPlayerPlayback> spMediaPlayback;
+        ComPtr<IMediaPlayerPlaybackOutput> spPlaybackOutput;
+        if (SUCCEEDED(LookupRenderEventPlayback(handleBits, &spMediaPlayback))
+            && SUCCEEDED(spMediaPlayback.As(&spPlaybackOutput)))
+        {
+            LOG_RESULT(spPlaybackOutput->LatchFrame());
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
 }
 
 // --------------------------------------------------------------------------
@@ -18,7 +18,10 @@
 #endif
 
 // std c++
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 #include <vector>
 #include <map>
 
@@ -0,0 +1,367 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "BundleIndex.h"
+#include "Mp4TestFiles.h"
+
+#include <memory>
+#include <random>
+#include <string>
+
+// appends to a vector, failing once it would grow past a limit
+class CMemoryBundleWriter : public IVideoBundleWriter
+{
+public:
+    explicit CMemoryBundleWriter(size_t limit = SIZE_MAX)
+        : m_limit(limit)
+    {
+    }
+
+    bool Write(const void* pData, size_t size) override
+    {
+        if (size > m_limit - m_bytes.size())
+        {
+            return false;
+        }
+
+        const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+        m_bytes.insert(m_bytes.end(), pBytes, pBytes + size);
+
+        return true;
+    }
+
+    const MP4_BYTES& Bytes() const
+    {
+        return m_bytes;
+    }
+
+private:
+    size_t m_limit;
+    MP4_BYTES m_bytes;
+};
+
+// clips as they'd sit in a folder, some of them not mp4 at all
+class CTestClips
+{
+public:
+    CTestClips()
+    {
+        Add("intro.mp4", "video/mp4", Clip(1280, 720, 90, 30, 5000));
+        Add("levels/01/boss.mp4", "video/mp4", Clip(1920, 1080, 300, 60, 20000));
+        Add("levels/01/attract.mp4", "video/mp4", Clip(640, 360, 45, 15, 100));
+        Add("levels/02.mov", "video/quicktime", Clip(3840, 2160, 12, 12, 9000));
+        Add("notes.txt", "text/plain", MP4_BYTES({ 'n', 'o', 't', 'e', 's' }));
+        Add("outro.mp4", "video/mp4", Clip(1280, 720, 600, 30, 70000));
+    }
+
+    // unsorted, the writer sorts them
+    std::vector<VIDEO_BUNDLE_INPUT> Inputs() const
+    {
+        std::vector<VIDEO_BUNDLE_INPUT> inputs;
+        for (size_t i = m_names.size(); i-- > 0; )
+        {
+            inputs.push_back({ m_names[i], m_contentTypes[i], m_readers[i].get() });
+        }
+
+        return inputs;
+    }
+
+    size_t Count() const
+    {
+        return m_names.size();
+    }
+
+    const std::string& Name(size_t i) const
+    {
+        return m_names[i];
+    }
+
+    const std::string& ContentType(size_t i) const
+    {
+        return m_contentTypes[i];
+    }
+
+    const MP4_BYTES& Bytes(size_t i) const
+    {
+        return *m_files[i];
+    }
+
+    IKeyframeIndexReader* Reader(size_t i) const
+    {
+        return m_readers[i].get();
+    }
+
+private:
+    // 29.97 fps with a keyframe every gop samples, mdat of the given size
+    static MP4_BYTES Clip(uint32_t width, uint32_t height, uint32_t frames, uint32_t gop, size_t mediaDataSize)
+    {
+        MP4_TEST_TRACK video;
+        video.timeToSample = { { frames, 1001 } };
+        video.hasSyncSamples = true;
+        for (uint32_t sample = 1; sample <= frames; sample += gop)
+        {
+            video.syncSamples.push_back(sample);
+        }
+        video.width = width;
+        video.height = height;
+
+        return Mp4File(Mp4Movie(1000, frames * 1001 / 30, 0, { Mp4Track(video) }), true, false, mediaDataSize);
+    }
+
+    void Add(const char* pName, const char* pContentType, MP4_BYTES&& bytes)
+    {
+        m_names.push_back(pName);
+        m_contentTypes.push_back(pContentType);
+        m_files.emplace_back(new MP4_BYTES(std::move(bytes)));
+        m_readers.emplace_back(new CMp4MemoryReader(*m_files.back()));
+    }
+
+    std::vector<std::string> m_names;
+    std::vector<std::string> m_contentTypes;
+    std::vector<std::unique_ptr<MP4_BYTES>> m_files;
+    std::vector<std::unique_ptr<CMp4MemoryReader>> m_readers;
+};
+
+static MP4_BYTES WriteBundle(const CTestClips& clips)
+{
+    std::vector<VIDEO_BUNDLE_INPUT> inputs = clips.Inputs();
+    CMemoryBundleWriter writer;
+    CHECK(WriteVideoBundle(&inputs, &writer));
+
+    return writer.Bytes();
+}
+
+static uint64_t IndexSize(const MP4_BYTES& bundle)
+{
+    uint64_t size = 0;
+    for (int i = 7; i >= 0; --i)
+    {
+        size = (size << 8) | bundle[24 + i];
+    }
+
+    return size;
+}
+
+// every pointer and range a clip hands out is inside the view
+static bool IsInside(const VIDEO_BUNDLE_CLIP& clip, const uint8_t* pView, uint64_t size)
+{
+    const uint8_t* pEnd = pView + size;
+    const uint8_t* pName = reinterpret_cast<const uint8_t*>(clip.name);
+    const uint8_t* pContentType = reinterpret_cast<const uint8_t*>(clip.contentType);
+
+    return pName >= pView && pName + clip.nameLength <= pEnd
+        && pContentType >= pView && pContentType + clip.contentTypeLength <= pEnd
+        && clip.keyframes >= pView && clip.keyframes + clip.keyframeCount * sizeof(int64_t) <= pEnd
+        && clip.offset <= size && clip.size <= size - clip.offset;
+}
+
+TEST(BundleIndex, RoundTrip)
+{
+    CTestClips clips;
+    const MP4_BYTES bundle = WriteBundle(clips);
+
+    CVideoBundleIndex index;
+    CHECK(index.Attach(bundle.data(), bundle.size()));
+    CHECK_EQ(clips.Count(), index.GetCount());
+
+    for (size_t i = 0; i < clips.Count(); ++i)
+    {
+        const std::string& name = clips.Name(i);
+        VIDEO_BUNDLE_CLIP clip;
+        CHECK(index.Find(name.data(), name.size(), &clip));
+        CHECK(IsInside(clip, bundle.data(), bundle.size()));
+
+        CHECK(name == std::string(clip.name, clip.nameLength));
+        CHECK(clips.ContentType(i) == std::string(clip.contentType, clip.contentTypeLength));
+
+        // the file as it was, on a page of its own
+        CHECK_EQ(0u, clip.offset % VIDEO_BUNDLE_DATA_ALIGNMENT);
+        CHECK_EQ(clips.Bytes(i).size(), clip.size);
+        CHECK(0 == memcmp(clips.Bytes(i).data(), bundle.data() + clip.offset, static_cast<size_t>(clip.size)));
+
+        // what a probe of the loose file finds
+        MP4_VIDEO_INFO info = {};
+        std::vector<int64_t> times;
+        std::vector<int64_t> bundledTimes;
+        CVideoBundleIndex::GetKeyframeTimes(clip, &bundledTimes);
+        if (ReadMp4VideoInfo(clips.Reader(i), &info, &times))
+        {
+            CHECK(info.width > 0 && info.duration > 0 && !times.empty());
+            CHECK_EQ(info.width, clip.width);
+            CHECK_EQ(info.height, clip.height);
+            CHECK_EQ(info.duration, clip.duration);
+            CHECK_EQ(info.frameDuration, clip.frameDuration);
+            CHECK(times == bundledTimes);
+        }
+        else
+        {
+            CHECK_EQ(0u, clip.width);
+            CHECK_EQ(0, clip.duration);
+            CHECK(bundledTimes.empty());
+        }
+    }
+
+    // clips don't overlap, sorted by name bytewise
+    VIDEO_BUNDLE_CLIP previous = {};
+    for (uint32_t i = 0; i < index.GetCount(); ++i)
+    {
+        VIDEO_BUNDLE_CLIP clip;
+        CHECK(index.GetClip(i, &clip));
+        if (i > 0)
+        {
+            CHECK(std::string(previous.name, previous.nameLength) < std::string(clip.name, clip.nameLength));
+            CHECK(previous.offset + previous.size <= clip.offset);
+        }
+        previous = clip;
+    }
+
+    VIDEO_BUNDLE_CLIP clip;
+    CHECK(!index.GetClip(index.GetCount(), &clip));
+}
+
+TEST(BundleIndex, FindMisses)
+{
+    CTestClips clips;
+    const MP4_BYTES bundle = WriteBundle(clips);
+
+    CVideoBundleIndex index;
+    CHECK(index.Attach(bundle.data(), bundle.size()));
+
+    const char* misses[] = { "", "a", "intro.mp", "intro.mp4x", "levels/01", "levels/01/", "LEVELS/02.mov", "zzz" };
+    for (const char* pName : misses)
+    {
+        VIDEO_BUNDLE_CLIP clip;
+        CHECK(!index.Find(pName, strlen(pName), &clip));
+    }
+
+    // the length counts, not a terminator
+    VIDEO_BUNDLE_CLIP clip;
+    CHECK(index.Find("notes.txt and more", 9, &clip));
+    CHECK(!index.Find(nullptr, 0, &clip));
+
+    // nothing attached, nothing found
+    CVideoBundleIndex empty;
+    CHECK_EQ(0u, empty.GetCount());
+    CHECK(!empty.Find("intro.mp4", 9, &clip));
+}
+
+TEST(BundleIndex, WriteFailures)
+{
+    CTestClips clips;
+
+    std::vector<VIDEO_BUNDLE_INPUT> duplicate = { { "a", "t", clips.Reader(0) }, { "a", "t", clips.Reader(1) } };
+    CMemoryBundleWriter writer;
+    CHECK(!WriteVideoBundle(&duplicate, &writer));
+
+    std::vector<VIDEO_BUNDLE_INPUT> unnamed = { { "", "t", clips.Reader(0) } };
+    CHECK(!WriteVideoBundle(&unnamed, &writer));
+
+    std::vector<VIDEO_BUNDLE_INPUT> unread = { { "a", "t", nullptr } };
+    CHECK(!WriteVideoBundle(&unread, &writer));
+
+    // the disk filling up, in the index and in the data
+    std::vector<VIDEO_BUNDLE_INPUT> inputs = clips.Inputs();
+    CMemoryBundleWriter noRoom(16);
+    CHECK(!WriteVideoBundle(&inputs, &noRoom));
+
+    CMemoryBundleWriter filled(3 * VIDEO_BUNDLE_DATA_ALIGNMENT);
+    CHECK(!WriteVideoBundle(&inputs, &filled));
+
+    // no clips at all is a bundle of its own
+    std::vector<VIDEO_BUNDLE_INPUT> none;
+    CMemoryBundleWriter emptyWriter;
+    CHECK(WriteVideoBundle(&none, &emptyWriter));
+
+    CVideoBundleIndex index;
+    CHECK(index.Attach(emptyWriter.Bytes().data(), emptyWriter.Bytes().size()));
+    CHECK_EQ(0u, index.GetCount());
+}
+
+TEST(BundleIndex, AttachRejectsTruncated)
+{
+    CTestClips clips;
+    const MP4_BYTES bundle = WriteBundle(clips);
+    const uint64_t indexSize = IndexSize(bundle);
+    CHECK(indexSize > VIDEO_BUNDLE_HEADER_SIZE && indexSize < bundle.size());
+
+    // every cut through the index, then through the data; the last clip always loses bytes
+    CVideoBundleIndex index;
+    for (size_t size = 0; size < bundle.size(); size += (size < indexSize + 64) ? 1 : 97)
+    {
+        CHECK(!index.Attach(bundle.data(), size));
+        CHECK_EQ(0u, index.GetCount());
+    }
+
+    CHECK(!index.Attach(nullptr, bundle.size()));
+    CHECK(index.Attach(bundle.data(), bundle.size()));
+}
+
+TEST(BundleIndex, CorruptIndexStaysInsideView)
+{
+    CTestClips clips;
+    const MP4_BYTES bundle = WriteBundle(clips);
+    const size_t indexSize = static_cast<size_t>(IndexSize(bundle));
+
+    // every byte of the index set to a few values, then random multi byte damage.
+    // Whatever Attach accepts must only point into the view.
+    std::mt19937 random(5);
+    MP4_BYTES damaged = bundle;
+    uint32_t accepted = 0;
+    for (uint32_t round = 0; round < indexSize * 4 + 20000; ++round)
+    {
+        std::vector<std::pair<size_t, uint8_t>> changes;
+        if (round < indexSize * 4)
+        {
+            const uint8_t values[] = { 0x00, 0xFF, 0x80, static_cast<uint8_t>(bundle[round / 4] ^ 0x01) };
+            changes.push_back({ round / 4, values[round % 4] });
+        }
+        else
+        {
+            for (uint32_t flips = 1 + random() % 4; flips > 0; --flips)
+            {
+                changes.push_back({ random() % indexSize, static_cast<uint8_t>(random()) });
+            }
+        }
+
+        for (const auto& change : changes)
+        {
+            damaged[change.first] = change.second;
+        }
+
+        CVideoBundleIndex index;
+        if (index.Attach(damaged.data(), damaged.size()))
+        {
+            ++accepted;
+            for (uint32_t i = 0; i < index.GetCount(); ++i)
+            {
+                VIDEO_BUNDLE_CLIP clip;
+                CHECK(index.GetClip(i, &clip));
+                CHECK(IsInside(clip, damaged.data(), damaged.size()));
+
+                std::vector<int64_t> times;
+                CVideoBundleIndex::GetKeyframeTimes(clip, &times);
+
+                VIDEO_BUNDLE_CLIP found;
+                CHECK(index.Find(clip.name, clip.nameLength, &found));
+            }
+        }
+
+        for (const auto& change : changes)
+        {
+            damaged[change.first] = bundle[change.first];
+        }
+    }
+
+    // changes to fields Attach can't check, sizes and times, still attach
+    CHECK(accepted > 0);
+}
@@ -0,0 +1,161 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "EventQueue.h"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// the size of a PLAYBACK_STATE
+struct BENCH_EVENT
+{
+    uint32_t type;
+    uint32_t producer;
+    uint64_t values[3];
+};
+
+// what the queue replaced: a locked deque, bounded the same way
+class CLockedQueue
+{
+public:
+    bool TryPush(const BENCH_EVENT& event)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_events.size() >= 1024)
+        {
+            return false;
+        }
+
+        m_events.push_back(event);
+        return true;
+    }
+
+    uint32_t Drain(BENCH_EVENT* pEvents, uint32_t capacity)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        uint32_t count = 0;
+        while (count < capacity && !m_events.empty())
+        {
+            pEvents[count++] = m_events.front();
+            m_events.pop_front();
+        }
+
+        return count;
+    }
+
+private:
+    std::mutex m_lock;
+    std::deque<BENCH_EVENT> m_events;
+};
+
+// million records a second from producers to one draining thread, every push retried until it lands
+template <typename Queue>
+static double MeasureThroughput(Queue& queue, uint32_t producerCount, uint32_t perProducer)
+{
+    std::atomic<uint32_t> running(producerCount);
+    std::atomic<bool> go(false);
+
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < producerCount; ++p)
+    {
+        producers.emplace_back([&, p]()
+        {
+            while (!go.load())
+            {
+                std::this_thread::yield();
+            }
+
+            BENCH_EVENT event = { 1, p, { 0, 0, 0 } };
+            for (uint32_t i = 0; i < perProducer; ++i)
+            {
+                event.values[0] = i;
+                while (!queue.TryPush(event))
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            --running;
+        });
+    }
+
+    const double start = BenchmarkNow();
+    go = true;
+
+    uint64_t delivered = 0;
+    BENCH_EVENT events[64];
+    for (;;)
+    {
+        bool finished = (0 == running.load());
+        uint32_t count = queue.Drain(events, 64);
+        delivered += count;
+        if (0 == count)
+        {
+            if (finished)
+            {
+                break;
+            }
+
+            std::this_thread::yield();
+        }
+    }
+
+    const double elapsed = BenchmarkNow() - start;
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    return delivered / elapsed / 1e6;
+}
+
+BENCHMARK(EventQueue, Throughput)
+{
+    const uint32_t perProducer = 500000;
+    const uint32_t producerCounts[] = { 1, 2, 4, 8 };
+
+    printf("%-9s %14s %14s\n", "producers", "lock-free M/s", "locked M/s");
+
+    for (uint32_t producerCount : producerCounts)
+    {
+        std::unique_ptr<CEventQueue<BENCH_EVENT, 1024>> spQueue(new CEventQueue<BENCH_EVENT, 1024>());
+        double lockFree = MeasureThroughput(*spQueue, producerCount, perProducer);
+
+        CLockedQueue locked;
+        double lockedRate = MeasureThroughput(locked, producerCount, perProducer);
+
+        printf("%-9u %14.2f %14.2f\n", producerCount, lockFree, lockedRate);
+    }
+
+    // one push with nobody contending, what a media foundation callback pays
+    std::unique_ptr<CEventQueue<BENCH_EVENT, 1024>> spQueue(new CEventQueue<BENCH_EVENT, 1024>());
+    BENCH_EVENT event = {};
+    BENCH_EVENT events[1024];
+    const uint32_t rounds = 2000;
+    const double start = BenchmarkNow();
+    for (uint32_t round = 0; round < rounds; ++round)
+    {
+        for (uint32_t i = 0; i < 1024; ++i)
+        {
+            event.values[0] = i;
+            spQueue->TryPush(event);
+        }
+        BenchmarkKeep(spQueue->Drain(events, 1024));
+    }
+    const double elapsed = BenchmarkNow() - start;
+    printf("uncontended push + pop: %.1f ns\n", elapsed / (rounds * 1024.0) * 1e9);
+}
@@ -0,0 +1,192 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "EventQueue.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+// big enough that a torn copy would show up in the check field
+struct TEST_EVENT
+{
+    uint32_t producer;
+    uint32_t index;
+    uint64_t payload[4];
+    uint64_t check;
+};
+
+static TEST_EVENT MakeEvent(uint32_t producer, uint32_t index)
+{
+    TEST_EVENT event = {};
+    event.producer = producer;
+    event.index = index;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        event.payload[i] = (static_cast<uint64_t>(producer) << 32) ^ (index * 0x9E3779B97F4A7C15ull + i);
+    }
+    event.check = event.payload[0] ^ event.payload[1] ^ event.payload[2] ^ event.payload[3];
+
+    return event;
+}
+
+static bool IsIntact(const TEST_EVENT& event)
+{
+    const TEST_EVENT expected = MakeEvent(event.producer, event.index);
+    return 0 == memcmp(&expected, &event, sizeof(event));
+}
+
+TEST(EventQueue, FifoAndWrap)
+{
+    CEventQueue<TEST_EVENT, 8> queue;
+
+    // many times around the ring
+    uint32_t next = 0;
+    for (uint32_t round = 0; round < 100; ++round)
+    {
+        for (uint32_t i = 0; i < 5; ++i)
+        {
+            CHECK(queue.TryPush(MakeEvent(0, round * 5 + i)));
+        }
+
+        TEST_EVENT event;
+        while (queue.TryPop(&event))
+        {
+            CHECK(IsIntact(event));
+            CHECK_EQ(next, event.index);
+            ++next;
+        }
+    }
+
+    CHECK_EQ(500u, next);
+    CHECK_EQ(0u, queue.Dropped());
+}
+
+TEST(EventQueue, FullQueueDropsNewest)
+{
+    CEventQueue<TEST_EVENT, 4> queue;
+
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        CHECK(queue.TryPush(MakeEvent(0, i)));
+    }
+
+    CHECK(!queue.TryPush(MakeEvent(0, 4)));
+    CHECK(!queue.TryPush(MakeEvent(0, 5)));
+    CHECK_EQ(2u, queue.Dropped());
+
+    // the queued records are untouched, and there is room again after a pop
+    TEST_EVENT events[8];
+    CHECK_EQ(2u, queue.Drain(events, 2));
+    CHECK_EQ(0u, events[0].index);
+    CHECK_EQ(1u, events[1].index);
+
+    CHECK(queue.TryPush(MakeEvent(0, 6)));
+    CHECK_EQ(3u, queue.Drain(events, 8));
+    CHECK_EQ(2u, events[0].index);
+    CHECK_EQ(6u, events[2].index);
+
+    CHECK_EQ(0u, queue.Drain(events, 8));
+    CHECK_EQ(0u, queue.Drain(nullptr, 8));
+}
+
+// runs producers against one draining thread, returns false on a lost, repeated, reordered or torn record
+template <uint32_t Capacity>
+static bool RunProducers(uint32_t producerCount, uint32_t perProducer, bool retry, uint64_t* pDelivered, uint64_t* pDropped)
+{
+    std::unique_ptr<CEventQueue<TEST_EVENT, Capacity>> spQueue(new CEventQueue<TEST_EVENT, Capacity>());
+    CEventQueue<TEST_EVENT, Capacity>& queue = *spQueue;
+
+    std::atomic<uint32_t> running(producerCount);
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < producerCount; ++p)
+    {
+        producers.emplace_back([&, p]()
+        {
+            for (uint32_t i = 0; i < perProducer; ++i)
+            {
+                while (!queue.TryPush(MakeEvent(p, i)) && retry)
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            --running;
+        });
+    }
+
+    bool ok = true;
+    std::vector<int64_t> last(producerCount, -1);
+    uint64_t delivered = 0;
+    TEST_EVENT events[32];
+    for (;;)
+    {
+        bool finished = (0 == running.load());
+
+        uint32_t count = queue.Drain(events, 32);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const TEST_EVENT& event = events[i];
+            if (event.producer >= producerCount || !IsIntact(event) || static_cast<int64_t>(event.index) <= last[event.producer])
+            {
+                ok = false;
+                continue;
+            }
+
+            last[event.producer] = event.index;
+        }
+        delivered += count;
+
+        if (0 == count && finished)
+        {
+            break;
+        }
+    }
+
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    *pDelivered = delivered;
+    *pDropped = queue.Dropped();
+
+    return ok;
+}
+
+TEST(EventQueue, ManyProducersNoLoss)
+{
+    const uint32_t producerCount = 8;
+    const uint32_t perProducer = 20000;
+
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+    CHECK(RunProducers<64>(producerCount, perProducer, true, &delivered, &dropped));
+
+    // a retried push never gets lost, the failed attempts are still counted
+    CHECK_EQ(static_cast<uint64_t>(producerCount) * perProducer, delivered);
+}
+
+TEST(EventQueue, ManyProducersWithDrops)
+{
+    const uint32_t producerCount = 8;
+    const uint32_t perProducer = 20000;
+
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+    CHECK(RunProducers<16>(producerCount, perProducer, false, &delivered, &dropped));
+
+    // every push either arrived or was counted as dropped
+    CHECK_EQ(static_cast<uint64_t>(producerCount) * perProducer, delivered + dropped);
+}
@@ -0,0 +1,198 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "FrameCache.h"
+
+#include <algorithm>
+
+// 30 fps in 100ns units
+static const int64_t s_frame = 333333;
+
+// the frame at timestamp copied in and kept, returns its slot
+static int Cache(CFrameCache& cache, int64_t timestamp, int64_t playhead)
+{
+    const int slot = cache.BeginInsert(timestamp, playhead);
+    if (CFrameCache::InvalidSlot != slot)
+    {
+        cache.EndInsert(slot, timestamp, true);
+    }
+
+    return slot;
+}
+
+TEST(FrameCache, HitAndMiss)
+{
+    CFrameCache cache;
+    cache.Reset(8);
+    cache.SetFrameDuration(s_frame);
+
+    int slots[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        slots[i] = Cache(cache, i * s_frame, 0);
+        CHECK(CFrameCache::InvalidSlot != slots[i]);
+    }
+
+    int64_t timestamp = -1;
+    CHECK_EQ(slots[3], cache.Find(2 * s_frame, 1, &timestamp));
+    CHECK_EQ(3 * s_frame, timestamp);
+    CHECK_EQ(slots[0], cache.Find(2 * s_frame, -2, &timestamp));
+    CHECK_EQ(0, timestamp);
+
+    // the frame on screen is matched within half a frame
+    CHECK_EQ(slots[2], cache.Find(s_frame + s_frame / 3, 1, &timestamp));
+
+    // past either end, or from a time nothing is cached near
+    CHECK_EQ(CFrameCache::InvalidSlot, cache.Find(2 * s_frame, 2, &timestamp));
+    CHECK_EQ(CFrameCache::InvalidSlot, cache.Find(0, -1, &timestamp));
+    CHECK_EQ(CFrameCache::InvalidSlot, cache.Find(10 * s_frame, 1, &timestamp));
+
+    CFrameCache::STATS stats = cache.GetStats(true);
+    CHECK_EQ(8u, stats.slots);
+    CHECK_EQ(4u, stats.frames);
+    CHECK_EQ(3u, stats.hits);
+    CHECK_EQ(3u, stats.misses);
+    CHECK_EQ(4u, stats.inserts);
+    CHECK_EQ(0u, stats.evictions);
+
+    stats = cache.GetStats(false);
+    CHECK_EQ(0u, stats.hits);
+    CHECK_EQ(4u, stats.frames);
+}
+
+TEST(FrameCache, GapIsAMiss)
+{
+    CFrameCache cache;
+    cache.Reset(8);
+
+    // duration learnt from the frames, 2 was never decoded
+    Cache(cache, 0, 0);
+    Cache(cache, s_frame, 0);
+    Cache(cache, 3 * s_frame, 0);
+    CHECK_EQ(s_frame, cache.GetFrameDuration());
+
+    int64_t timestamp = 0;
+    CHECK(CFrameCache::InvalidSlot != cache.Find(0, 1, &timestamp));
+    CHECK_EQ(CFrameCache::InvalidSlot, cache.Find(s_frame, 1, &timestamp));
+    CHECK_EQ(CFrameCache::InvalidSlot, cache.Find(3 * s_frame, -1, &timestamp));
+
+    // nothing known yet, every step decodes
+    CFrameCache empty;
+    empty.Reset(8);
+    CHECK_EQ(0, empty.GetFrameDuration());
+    CHECK_EQ(CFrameCache::InvalidSlot, empty.Find(0, 1, &timestamp));
+}
+
+TEST(FrameCache, EvictsFarthestFromPlayhead)
+{
+    CFrameCache cache;
+    cache.Reset(3);
+    cache.SetFrameDuration(s_frame);
+
+    const int first = Cache(cache, 0, 0);
+    Cache(cache, s_frame, 0);
+    Cache(cache, 2 * s_frame, 0);
+
+    // stepping forward, the oldest frame behind the playhead goes
+    CHECK_EQ(first, Cache(cache, 3 * s_frame, 3 * s_frame));
+    CHECK_EQ(1u, cache.GetStats(false).evictions);
+
+    int64_t timestamp = 0;
+    CHECK_EQ(CFrameCache::InvalidSlot, cache.Find(s_frame, -1, &timestamp));
+    CHECK(CFrameCache::InvalidSlot != cache.Find(s_frame, 2, &timestamp));
+    CHECK_EQ(3 * s_frame, timestamp);
+
+    // stepping back from 1, the frame at 3 is the farthest
+    const int last = cache.Find(3 * s_frame, 0, &timestamp);
+    CHECK_EQ(last, Cache(cache, 0, s_frame));
+
+    // a frame farther than all of them is not cached at all
+    CHECK_EQ(CFrameCache::InvalidSlot, cache.BeginInsert(20 * s_frame, s_frame));
+    CHECK_EQ(2u, cache.GetStats(false).evictions);
+    CHECK_EQ(3u, cache.GetStats(false).frames);
+}
+
+TEST(FrameCache, Capacity)
+{
+    CFrameCache cache;
+    cache.Reset(4);
+    cache.SetFrameDuration(s_frame);
+
+    // slots being written count against the capacity too
+    std::vector<int> writing;
+    for (int i = 0; i < 4; ++i)
+    {
+        writing.push_back(cache.BeginInsert(i * s_frame, 0));
+        CHECK(CFrameCache::InvalidSlot != writing.back());
+    }
+    std::vector<int> sorted(writing);
+    std::sort(sorted.begin(), sorted.end());
+    CHECK(std::vector<int>({ 0, 1, 2, 3 }) == sorted);
+    CHECK_EQ(CFrameCache::InvalidSlot, cache.BeginInsert(4 * s_frame, 0));
+
+    // a failed copy frees its slot
+    cache.EndInsert(writing[3], 3 * s_frame, false);
+    for (int i = 0; i < 3; ++i)
+    {
+        cache.EndInsert(writing[i], i * s_frame, true);
+    }
+    CHECK_EQ(3u, cache.GetStats(false).frames);
+    CHECK_EQ(writing[3], Cache(cache, 3 * s_frame, 0));
+
+    // the same time again reuses its slot instead of a second one
+    CHECK_EQ(writing[1], Cache(cache, s_frame, 0));
+    CHECK_EQ(4u, cache.GetStats(false).frames);
+
+    // ending a slot twice, or one never handed out, is ignored
+    cache.EndInsert(writing[1], 9 * s_frame, true);
+    cache.EndInsert(7, 9 * s_frame, true);
+    cache.EndInsert(CFrameCache::InvalidSlot, 9 * s_frame, true);
+    CHECK_EQ(4u, cache.GetStats(false).frames);
+
+    // no slots, no caching
+    cache.Reset(0);
+    CHECK_EQ(CFrameCache::InvalidSlot, cache.BeginInsert(0, 0));
+}
+
+TEST(FrameCache, SeekInvalidates)
+{
+    CFrameCache cache;
+    cache.Reset(4);
+    cache.SetFrameDuration(s_frame);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        Cache(cache, i * s_frame, 0);
+    }
+
+    int64_t timestamp = 0;
+    CHECK(CFrameCache::InvalidSlot != cache.Find(0, 1, &timestamp));
+
+    // a seek or a new source clears the frames, the counters keep going
+    cache.Clear();
+    CHECK_EQ(CFrameCache::InvalidSlot, cache.Find(0, 1, &timestamp));
+    CHECK_EQ(0, cache.GetFrameDuration());
+
+    const CFrameCache::STATS stats = cache.GetStats(false);
+    CHECK_EQ(4u, stats.slots);
+    CHECK_EQ(0u, stats.frames);
+    CHECK_EQ(1u, stats.hits);
+    CHECK_EQ(1u, stats.misses);
+    CHECK_EQ(4u, stats.inserts);
+
+    // every slot is free again
+    for (int i = 0; i < 4; ++i)
+    {
+        CHECK(CFrameCache::InvalidSlot != cache.BeginInsert((10 + i) * s_frame, 10 * s_frame));
+    }
+}
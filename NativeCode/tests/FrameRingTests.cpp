@@ -0,0 +1,252 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "FrameRing.h"
+
+#include <atomic>
+#include <thread>
+
+typedef CFrameRing::SlotState SlotState;
+
+TEST(FrameRing, ProducerSkipsReadingSlot)
+{
+    CFrameRing ring(3);
+    ring.SetReadingSlot(0);
+
+    int first = ring.BeginWrite();
+    CHECK_EQ(1, first);
+    ring.EndWrite(first, 100);
+
+    int second = ring.BeginWrite();
+    CHECK_EQ(2, second);
+    ring.EndWrite(second, 200);
+
+    // no free slot left, the oldest Ready frame is reclaimed, never the Reading one
+    int third = ring.BeginWrite();
+    CHECK_EQ(1, third);
+    CHECK_EQ(1u, ring.FramesDropped());
+    ring.EndWrite(third, 300);
+
+    CHECK(SlotState::Reading == ring.GetState(0));
+    CHECK_EQ(3u, ring.FramesWritten());
+}
+
+TEST(FrameRing, LatchTakesNewestAndFreesOlder)
+{
+    CFrameRing ring(4);
+    ring.SetReadingSlot(0);
+
+    for (int64_t timestamp = 1; timestamp <= 3; ++timestamp)
+    {
+        int slot = ring.BeginWrite();
+        CHECK(CFrameRing::InvalidSlot != slot);
+        ring.EndWrite(slot, timestamp);
+    }
+
+    int latched = ring.BeginLatch();
+    CHECK_EQ(3, latched);
+    CHECK_EQ(3, ring.GetTimestamp(latched));
+    CHECK_EQ(0, ring.EndLatch(latched, true));
+
+    // the previous reading slot and both older frames went back to the free list
+    CHECK(SlotState::Free == ring.GetState(0));
+    CHECK(SlotState::Free == ring.GetState(1));
+    CHECK(SlotState::Free == ring.GetState(2));
+    CHECK_EQ(3, ring.ReadingSlot());
+    CHECK_EQ(2u, ring.FramesDropped());
+    CHECK_EQ(1u, ring.FramesLatched());
+
+    // nothing new arrived
+    CHECK_EQ(CFrameRing::InvalidSlot, ring.BeginLatch());
+}
+
+TEST(FrameRing, RollbackKeepsFrameReady)
+{
+    CFrameRing ring(3);
+    ring.SetReadingSlot(0);
+
+    int slot = ring.BeginWrite();
+    ring.EndWrite(slot, 10);
+
+    int latched = ring.BeginLatch();
+    CHECK_EQ(slot, latched);
+    CHECK(SlotState::Reading == ring.GetState(latched));
+
+    // e.g. the keyed mutex acquire timed out on the render thread
+    CHECK_EQ(CFrameRing::InvalidSlot, ring.EndLatch(latched, false));
+    CHECK(SlotState::Ready == ring.GetState(latched));
+    CHECK_EQ(0, ring.ReadingSlot());
+    CHECK_EQ(0u, ring.FramesLatched());
+
+    CHECK_EQ(latched, ring.BeginLatch());
+}
+
+TEST(FrameRing, CancelWriteReturnsSlot)
+{
+    CFrameRing ring(3);
+    ring.SetReadingSlot(0);
+
+    int slot = ring.BeginWrite();
+    ring.CancelWrite(slot);
+
+    CHECK(SlotState::Free == ring.GetState(slot));
+    CHECK_EQ(0u, ring.FramesWritten());
+    CHECK_EQ(CFrameRing::InvalidSlot, ring.BeginLatch());
+
+    // a publish after cancel is ignored
+    ring.EndWrite(slot, 5);
+    CHECK(SlotState::Free == ring.GetState(slot));
+}
+
+TEST(FrameRing, ReadyFramesOldestFirst)
+{
+    CFrameRing ring(5);
+    ring.SetReadingSlot(2);
+
+    int64_t timestamps[] = { 40, 10, 30, 20 };
+    for (int64_t timestamp : timestamps)
+    {
+        ring.EndWrite(ring.BeginWrite(), timestamp);
+    }
+
+    CFrameRing::ReadyFrame frames[CFrameRing::MaxSlots];
+    uint32_t count = ring.GetReadyFrames(frames, CFrameRing::MaxSlots);
+    CHECK_EQ(4u, count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        // ordered by publish sequence, not by timestamp
+        CHECK_EQ(timestamps[i], frames[i].timestamp);
+        CHECK(i == 0 || frames[i - 1].sequence < frames[i].sequence);
+    }
+
+    // capacity is honoured
+    CHECK_EQ(2u, ring.GetReadyFrames(frames, 2));
+}
+
+TEST(FrameRing, LatchFrameFailsAfterReclaim)
+{
+    CFrameRing ring(3);
+    ring.SetReadingSlot(0);
+
+    ring.EndWrite(ring.BeginWrite(), 1);
+    ring.EndWrite(ring.BeginWrite(), 2);
+
+    CFrameRing::ReadyFrame frames[CFrameRing::MaxSlots];
+    CHECK_EQ(2u, ring.GetReadyFrames(frames, CFrameRing::MaxSlots));
+
+    // the producer reclaims the oldest frame between snapshot and latch
+    int reclaimed = ring.BeginWrite();
+    CHECK_EQ(frames[0].slot, reclaimed);
+    ring.EndWrite(reclaimed, 3);
+
+    CHECK(!ring.BeginLatchFrame(frames[0]));
+    CHECK(ring.BeginLatchFrame(frames[1]));
+    CHECK_EQ(0, ring.EndLatch(frames[1].slot, true));
+
+    // the re-published slot is newer than the one just latched and stays Ready
+    CHECK(SlotState::Ready == ring.GetState(reclaimed));
+}
+
+TEST(FrameRing, ResetClampsSlotCount)
+{
+    CFrameRing ring(3);
+    ring.Reset(CFrameRing::MaxSlots + 4);
+    CHECK_EQ(CFrameRing::MaxSlots, ring.SlotCount());
+    CHECK_EQ(CFrameRing::InvalidSlot, ring.ReadingSlot());
+
+    // out of range slots read as Free and are ignored
+    CHECK(SlotState::Free == ring.GetState(CFrameRing::MaxSlots));
+    ring.SetReadingSlot(CFrameRing::MaxSlots);
+    CHECK_EQ(CFrameRing::InvalidSlot, ring.ReadingSlot());
+}
+
+// one decoder thread, one render thread; the slot being read must never be handed to the producer
+TEST(FrameRing, ProducerConsumerStress)
+{
+    const int64_t frameCount = 200000;
+
+    CFrameRing ring(3);
+    ring.SetReadingSlot(0);
+
+    std::atomic<bool> reading[CFrameRing::MaxSlots] = {};
+    reading[0] = true;
+
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> ownershipErrors(0);
+    std::atomic<uint32_t> orderErrors(0);
+
+    std::thread producer([&]()
+    {
+        for (int64_t timestamp = 1; timestamp <= frameCount; ++timestamp)
+        {
+            int slot = ring.BeginWrite();
+            if (CFrameRing::InvalidSlot == slot || reading[slot])
+            {
+                ++ownershipErrors;
+                continue;
+            }
+
+            ring.EndWrite(slot, timestamp);
+        }
+
+        done = true;
+    });
+
+    int current = 0;
+    int64_t lastTimestamp = 0;
+    uint64_t latched = 0;
+    for (;;)
+    {
+        bool finished = done;
+
+        int slot = ring.BeginLatch();
+        if (CFrameRing::InvalidSlot == slot)
+        {
+            if (finished)
+            {
+                break;
+            }
+
+            std::this_thread::yield();
+            continue;
+        }
+
+        int64_t timestamp = ring.GetTimestamp(slot);
+        if (timestamp <= lastTimestamp)
+        {
+            ++orderErrors;
+        }
+        lastTimestamp = timestamp;
+
+        // the previous slot stays Reading until EndLatch, so clearing the flag first is safe
+        reading[slot] = true;
+        reading[current] = false;
+        if (current != ring.EndLatch(slot, true))
+        {
+            ++ownershipErrors;
+        }
+        current = slot;
+        ++latched;
+    }
+
+    producer.join();
+
+    CHECK_EQ(0u, ownershipErrors.load());
+    CHECK_EQ(0u, orderErrors.load());
+    CHECK_EQ(frameCount, lastTimestamp);
+    CHECK_EQ(static_cast<uint64_t>(frameCount), ring.FramesWritten());
+    CHECK_EQ(latched, ring.FramesLatched());
+
+    // every published frame was either shown or counted as dropped
+    CHECK_EQ(ring.FramesWritten(), ring.FramesLatched() + ring.FramesDropped());
+}
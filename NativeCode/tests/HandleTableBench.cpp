@@ -0,0 +1,132 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "HandleTable.h"
+
+#include <atomic>
+#include <memory>
+#include <random>
+
+// stands in for a player: reference counted like the ComPtr the registry holds,
+// with a call as cheap as GetPosition so the table's own cost shows
+class CStubPlayer
+{
+public:
+    CStubPlayer()
+        : m_position(0)
+    {
+    }
+
+    int64_t GetPosition() const
+    {
+        return m_position.load(std::memory_order_relaxed);
+    }
+
+    void LatchFrame()
+    {
+        m_position.fetch_add(166666, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> m_position;
+};
+
+typedef CHandleTable<std::shared_ptr<CStubPlayer>> CStubTable;
+
+// the player exports: PlayerCreate, a Player* call per player and frame, the
+// LatchAll render event over every player, then PlayerRelease of each
+BENCHMARK(HandleTable, Players)
+{
+    const uint32_t playerCounts[] = { 1, 16, 256, 4096 };
+
+    printf("players   create ns   lookup+call ns   latch all ns/player   release ns\n");
+
+    for (uint32_t playerCount : playerCounts)
+    {
+        // enough rounds that the smallest table still runs for a while
+        const uint32_t rounds = (1 << 18) / playerCount + 4;
+
+        double createTime = 0.0;
+        double lookupTime = 0.0;
+        double latchTime = 0.0;
+        double releaseTime = 0.0;
+        uint64_t lookups = 0;
+        uint64_t latches = 0;
+        int64_t sum = 0;
+
+        std::mt19937 random(playerCount);
+        std::vector<uint32_t> handles(playerCount);
+        std::vector<uint32_t> order(playerCount);
+
+        for (uint32_t round = 0; round < rounds; ++round)
+        {
+            CStubTable table;
+
+            double start = BenchmarkNow();
+            for (uint32_t i = 0; i < playerCount; ++i)
+            {
+                CHECK(table.Insert(std::make_shared<CStubPlayer>(), &handles[i]));
+            }
+            createTime += BenchmarkNow() - start;
+
+            // script calls into players in no particular order
+            for (uint32_t i = 0; i < playerCount; ++i)
+            {
+                order[i] = handles[random() % playerCount];
+            }
+
+            start = BenchmarkNow();
+            for (uint32_t frame = 0; frame < 4; ++frame)
+            {
+                for (uint32_t handle : order)
+                {
+                    std::shared_ptr<CStubPlayer> spPlayer;
+                    if (table.Lookup(handle, &spPlayer))
+                    {
+                        sum += spPlayer->GetPosition();
+                    }
+                }
+            }
+            lookupTime += BenchmarkNow() - start;
+            lookups += 4ull * playerCount;
+
+            start = BenchmarkNow();
+            for (uint32_t frame = 0; frame < 4; ++frame)
+            {
+                table.ForEach([](uint32_t, const std::shared_ptr<CStubPlayer>& spPlayer)
+                {
+                    spPlayer->LatchFrame();
+                });
+            }
+            latchTime += BenchmarkNow() - start;
+            latches += 4ull * playerCount;
+
+            start = BenchmarkNow();
+            for (uint32_t handle : handles)
+            {
+                std::shared_ptr<CStubPlayer> spPlayer;
+                CHECK(table.Remove(handle, &spPlayer));
+            }
+            releaseTime += BenchmarkNow() - start;
+        }
+        BenchmarkKeep(sum);
+
+        const double created = static_cast<double>(rounds) * playerCount;
+        printf("%7u   %9.1f   %14.1f   %19.1f   %10.1f\n",
+            playerCount,
+            createTime * 1e9 / created,
+            lookupTime * 1e9 / lookups,
+            latchTime * 1e9 / latches,
+            releaseTime * 1e9 / created);
+    }
+}
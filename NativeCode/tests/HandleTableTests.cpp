@@ -0,0 +1,183 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "HandleTable.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+TEST(HandleTable, InsertLookupRemove)
+{
+    CHandleTable<int> table;
+
+    uint32_t handle = CHandleTable<int>::InvalidHandle;
+    CHECK(table.Insert(5, &handle));
+    CHECK(CHandleTable<int>::InvalidHandle != handle);
+    CHECK_EQ(1u, table.Count());
+
+    int value = 0;
+    CHECK(table.Lookup(handle, &value));
+    CHECK_EQ(5, value);
+
+    value = 0;
+    CHECK(table.Remove(handle, &value));
+    CHECK_EQ(5, value);
+    CHECK_EQ(0u, table.Count());
+
+    CHECK(!table.Lookup(handle, &value));
+    CHECK(!table.Remove(handle, &value));
+    CHECK(!table.Lookup(CHandleTable<int>::InvalidHandle, &value));
+    CHECK(!table.Insert(1, nullptr));
+}
+
+TEST(HandleTable, StaleHandleMissesReusedSlot)
+{
+    CHandleTable<int> table;
+
+    uint32_t first = 0;
+    CHECK(table.Insert(1, &first));
+    CHECK(table.Remove(first, nullptr));
+
+    uint32_t second = 0;
+    CHECK(table.Insert(2, &second));
+
+    // same slot, new generation
+    CHECK_EQ(CHandleTable<int>::IndexOf(first), CHandleTable<int>::IndexOf(second));
+    CHECK(first != second);
+
+    int value = 0;
+    CHECK(!table.Lookup(first, &value));
+    CHECK(!table.Remove(first, nullptr));
+    CHECK(table.Lookup(second, &value));
+    CHECK_EQ(2, value);
+}
+
+TEST(HandleTable, LookupMasked)
+{
+    const uint32_t mask = 0x0FFFFFFF;
+
+    CHandleTable<int> table;
+
+    uint32_t first = 0;
+    CHECK(table.Insert(5, &first));
+
+    int value = 0;
+    uint32_t handle = 0;
+    CHECK(table.LookupMasked(first & mask, mask, &value, &handle));
+    CHECK_EQ(5, value);
+    CHECK_EQ(first, handle);
+
+    CHECK(table.Remove(first, nullptr));
+
+    uint32_t second = 0;
+    CHECK(table.Insert(6, &second));
+    CHECK(!table.LookupMasked(first & mask, mask, &value, &handle));
+    CHECK(table.LookupMasked(second & mask, mask, &value, &handle));
+    CHECK_EQ(6, value);
+    CHECK_EQ(second, handle);
+
+    // the mask has to keep the index bits
+    CHECK(!table.LookupMasked(second & 0xFFFF0000, 0xFFFF0000, &value, &handle));
+}
+
+TEST(HandleTable, RemoveHandsBackOwnership)
+{
+    CHandleTable<std::shared_ptr<int>> table;
+
+    std::shared_ptr<int> player = std::make_shared<int>(7);
+    uint32_t handle = 0;
+    CHECK(table.Insert(player, &handle));
+    CHECK_EQ(2, player.use_count());
+
+    std::shared_ptr<int> removed;
+    CHECK(table.Remove(handle, &removed));
+
+    // the table dropped its reference, the caller releases outside the lock
+    CHECK_EQ(2, player.use_count());
+    removed.reset();
+    CHECK_EQ(1, player.use_count());
+}
+
+TEST(HandleTable, ForEachVisitsLiveEntries)
+{
+    CHandleTable<int> table;
+
+    uint32_t handles[4] = {};
+    for (int i = 0; i < 4; ++i)
+    {
+        CHECK(table.Insert(i * 10, &handles[i]));
+    }
+    CHECK(table.Remove(handles[1], nullptr));
+
+    int sum = 0;
+    uint32_t visited = 0;
+    table.ForEach([&](uint32_t handle, int value)
+    {
+        int lookedUp = -1;
+        CHECK(table.Lookup(handle, &lookedUp));
+        CHECK_EQ(value, lookedUp);
+        sum += value;
+        ++visited;
+    });
+
+    CHECK_EQ(3u, visited);
+    CHECK_EQ(0 + 20 + 30, sum);
+}
+
+TEST(HandleTable, ConcurrentInsertRemove)
+{
+    const int threadCount = 4;
+    const int iterations = 20000;
+
+    CHandleTable<int> table;
+    std::atomic<uint32_t> errors(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            for (int i = 0; i < iterations; ++i)
+            {
+                int expected = t * iterations + i;
+
+                uint32_t handle = 0;
+                if (!table.Insert(expected, &handle))
+                {
+                    ++errors;
+                    continue;
+                }
+
+                int value = -1;
+                if (!table.Lookup(handle, &value) || expected != value)
+                {
+                    ++errors;
+                }
+
+                if (!table.Remove(handle, nullptr) || table.Lookup(handle, nullptr))
+                {
+                    ++errors;
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    CHECK_EQ(0u, errors.load());
+    CHECK_EQ(0u, table.Count());
+}
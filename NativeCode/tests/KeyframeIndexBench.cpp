@@ -0,0 +1,74 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "Mp4TestFiles.h"
+
+#include <random>
+
+// what opening a long file costs: two hours at 60 fps with a keyframe every
+// two seconds and a ctts entry per sample, as b-frame encoders write it
+BENCHMARK(KeyframeIndex, ParseAndSnap)
+{
+    const uint32_t sampleCount = 2 * 3600 * 60;
+
+    MP4_TEST_TRACK video;
+    video.timescale = 60000;
+    video.timeToSample = { { sampleCount, 1000 } };
+    video.hasSyncSamples = true;
+    for (uint32_t sample = 1; sample <= sampleCount; sample += 120)
+    {
+        video.syncSamples.push_back(sample);
+    }
+    video.compositionOffsets.reserve(sampleCount);
+    for (uint32_t sample = 0; sample < sampleCount; ++sample)
+    {
+        video.compositionOffsets.push_back({ 1, (0 == sample % 3) ? 2000 : 0 });
+    }
+    video.hasEdits = true;
+    video.edits = { { 7200000, 2000 } };
+
+    const MP4_BYTES file = Mp4File(Mp4Movie(1000, 7200000, 0, { Mp4Track(video) }), true, false, 1000);
+
+    std::vector<int64_t> times;
+    int64_t frameDuration = 0;
+    uint32_t iterations = 0;
+    double start = BenchmarkNow();
+    double elapsed = 0.0;
+    do
+    {
+        CMp4MemoryReader reader(file);
+        times.clear();
+        CHECK(ReadMp4KeyframeTimes(&reader, &times, &frameDuration));
+        ++iterations;
+        elapsed = BenchmarkNow() - start;
+    } while (iterations < 3 || elapsed < 0.5);
+
+    printf("parse   %zu kb moov, %zu keyframes  %8.2f ms\n", file.size() / 1024, times.size(), elapsed * 1000.0 / iterations);
+
+    CKeyframeIndex index;
+    index.SetTimes(std::move(times), frameDuration);
+
+    // seeks land anywhere in the two hours
+    const uint32_t snaps = 10000000;
+    std::mt19937_64 random(1);
+    int64_t sum = 0;
+    start = BenchmarkNow();
+    for (uint32_t i = 0; i < snaps; ++i)
+    {
+        sum += index.SnapNearest(static_cast<int64_t>(random() % 72000000000ull));
+    }
+    elapsed = BenchmarkNow() - start;
+    BenchmarkKeep(sum);
+
+    printf("snap    %u random times            %8.1f ns\n", snaps, elapsed * 1e9 / snaps);
+}
@@ -0,0 +1,185 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "Mp4TestFiles.h"
+
+static const std::vector<int64_t> s_everySecond = { 0, 10000000, 20000000, 30000000 };
+
+// 30 fps, 100 samples, a keyframe every 30, 333333 rounded down from 333333.3
+static MP4_TEST_TRACK ThirtyFpsTrack()
+{
+    MP4_TEST_TRACK video;
+    video.timescale = 30000;
+    video.timeToSample = { { 100, 1000 } };
+    video.hasSyncSamples = true;
+    video.syncSamples = { 1, 31, 61, 91 };
+
+    return video;
+}
+
+static MP4_TEST_TRACK AudioTrack()
+{
+    MP4_TEST_TRACK audio;
+    audio.pHandler = "soun";
+    audio.timescale = 48000;
+    audio.timeToSample = { { 10, 1024 } };
+
+    return audio;
+}
+
+static bool ReadTimes(const MP4_BYTES& file, std::vector<int64_t>* pTimes, int64_t* pFrameDuration)
+{
+    CMp4MemoryReader reader(file);
+    return ReadMp4KeyframeTimes(&reader, pTimes, pFrameDuration);
+}
+
+TEST(KeyframeIndex, SyncSamplesOfFirstVideoTrack)
+{
+    // the audio track comes first and has to be skipped
+    const MP4_BYTES file = Mp4File(Mp4Movie(1000, 3333, 0, { Mp4Track(AudioTrack()), Mp4Track(ThirtyFpsTrack()) }), true, false, 1000);
+
+    std::vector<int64_t> times;
+    int64_t frameDuration = 0;
+    CHECK(ReadTimes(file, &times, &frameDuration));
+    CHECK_EQ(333333, frameDuration);
+    CHECK(s_everySecond == times);
+}
+
+TEST(KeyframeIndex, CompositionOffsetAndEditList)
+{
+    // every sample is shown 2000 ticks late and the edit starts at 2000, which
+    // cancel out. moov after a 64 bit mdat, version 1 mvhd and mdhd.
+    MP4_TEST_TRACK video = ThirtyFpsTrack();
+    video.mediaHeaderVersion = 1;
+    video.compositionOffsets = { { 50, 2000 }, { 50, 2000 } };
+    video.hasEdits = true;
+    video.edits = { { 3333, 2000 } };
+
+    const MP4_BYTES file = Mp4File(Mp4Movie(1000, 3333, 1, { Mp4Track(video) }), false, true, 1000);
+
+    std::vector<int64_t> times;
+    int64_t frameDuration = 0;
+    CHECK(ReadTimes(file, &times, &frameDuration));
+    CHECK_EQ(333333, frameDuration);
+    CHECK(s_everySecond == times);
+}
+
+TEST(KeyframeIndex, EmptyEditAndNoSyncTable)
+{
+    // no stss makes every sample a keyframe, the empty edit delays them all by
+    // half a second. 3003 / 90000 doesn't divide into 100ns, times round up.
+    MP4_TEST_TRACK video;
+    video.timescale = 90000;
+    video.timeToSample = { { 5, 3003 } };
+    video.hasEdits = true;
+    video.editListVersion = 1;
+    video.edits = { { 500, -1 }, { 1000, 0 } };
+
+    const MP4_BYTES file = Mp4File(Mp4Movie(1000, 1500, 0, { Mp4Track(video) }), true, false, 1000);
+
+    std::vector<int64_t> times;
+    int64_t frameDuration = 0;
+    CHECK(ReadTimes(file, &times, &frameDuration));
+    CHECK_EQ(333667, frameDuration);
+    CHECK(std::vector<int64_t>({ 5000000, 5333667, 5667334, 6001000, 6334667 }) == times);
+}
+
+TEST(KeyframeIndex, RejectsFilesWithoutVideo)
+{
+    std::vector<int64_t> times;
+    int64_t frameDuration = 0;
+
+    const MP4_BYTES audioOnly = Mp4File(Mp4Movie(1000, 3333, 0, { Mp4Track(AudioTrack()) }), true, false, 1000);
+    CHECK(!ReadTimes(audioOnly, &times, &frameDuration));
+    CHECK(times.empty());
+
+    const MP4_BYTES cutShort = { 0, 0, 0, 0x20, 'f', 't', 'y', 'p', 'i', 's', 'o', 'm' };
+    CHECK(!ReadTimes(cutShort, &times, &frameDuration));
+
+    // moov runs past the end of the file
+    MP4_BYTES truncated = Mp4File(Mp4Movie(1000, 3333, 0, { Mp4Track(ThirtyFpsTrack()) }), false, false, 1000);
+    truncated.resize(truncated.size() - 40);
+    CHECK(!ReadTimes(truncated, &times, &frameDuration));
+
+    CHECK(!ReadTimes(MP4_BYTES(), &times, &frameDuration));
+}
+
+TEST(KeyframeIndex, VideoInfo)
+{
+    MP4_TEST_TRACK video = ThirtyFpsTrack();
+    video.width = 1920;
+    video.height = 1080;
+
+    // 3.5s in a movie timescale of 600
+    const MP4_BYTES file = Mp4File(Mp4Movie(600, 2100, 0, { Mp4Track(AudioTrack()), Mp4Track(video) }), true, false, 1000);
+    CMp4MemoryReader reader(file);
+
+    MP4_VIDEO_INFO info = {};
+    std::vector<int64_t> times;
+    CHECK(ReadMp4VideoInfo(&reader, &info, &times));
+    CHECK_EQ(1920u, info.width);
+    CHECK_EQ(1080u, info.height);
+    CHECK_EQ(35000000, info.duration);
+    CHECK_EQ(333333, info.frameDuration);
+    CHECK(s_everySecond == times);
+
+    // only the index is read, not the media data
+    CHECK(reader.BytesRead() < file.size());
+}
+
+TEST(KeyframeIndex, SnapBeforeReady)
+{
+    CKeyframeIndex index;
+    CHECK(!index.IsReady());
+    CHECK_EQ(0u, index.GetCount());
+    CHECK_EQ(0, index.GetFrameDuration());
+    CHECK_EQ(5, index.SnapPrevious(5));
+    CHECK_EQ(5, index.SnapNearest(5));
+
+    // an empty index is ready but snaps nothing
+    index.SetTimes(std::vector<int64_t>(), 0);
+    CHECK(index.IsReady());
+    CHECK_EQ(12345, index.SnapNearest(12345));
+}
+
+TEST(KeyframeIndex, Snap)
+{
+    CKeyframeIndex index;
+    index.SetTimes(std::vector<int64_t>(s_everySecond), 333333);
+    CHECK(index.IsReady());
+    CHECK_EQ(4u, index.GetCount());
+    CHECK_EQ(333333, index.GetFrameDuration());
+
+    CHECK_EQ(10000000, index.SnapPrevious(15000000));
+    CHECK_EQ(20000000, index.SnapPrevious(20000000));
+    CHECK_EQ(0, index.SnapPrevious(-5));
+    CHECK_EQ(30000000, index.SnapPrevious(99999999));
+
+    // the earlier one on a tie
+    CHECK_EQ(10000000, index.SnapNearest(15000000));
+    CHECK_EQ(20000000, index.SnapNearest(15000001));
+    CHECK_EQ(20000000, index.SnapNearest(20000000));
+    CHECK_EQ(0, index.SnapNearest(-5));
+    CHECK_EQ(30000000, index.SnapNearest(99999999));
+
+    int64_t copied[2] = {};
+    CHECK_EQ(4u, index.GetTimes(copied, 2));
+    CHECK_EQ(0, copied[0]);
+    CHECK_EQ(10000000, copied[1]);
+    CHECK_EQ(4u, index.GetTimes(nullptr, 0));
+
+    // set once, later times are ignored
+    index.SetTimes(std::vector<int64_t>({ 1, 2 }), 1);
+    CHECK_EQ(4u, index.GetCount());
+    CHECK_EQ(333333, index.GetFrameDuration());
+}
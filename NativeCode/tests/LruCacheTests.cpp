@@ -0,0 +1,247 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "LruCache.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+typedef CLruCache<std::string, int> CTestCache;
+
+static CTestCache::STATS GetStats(const CTestCache& cache)
+{
+    CTestCache::STATS stats;
+    cache.GetStats(&stats);
+
+    return stats;
+}
+
+TEST(LruCache, EvictsLeastRecentlyUsed)
+{
+    CTestCache cache(100, 10);
+    std::vector<int> evicted;
+
+    cache.Insert("a", 1, 40, &evicted);
+    cache.Insert("b", 2, 40, &evicted);
+    CHECK(evicted.empty());
+
+    // over capacity, the oldest goes
+    cache.Insert("c", 3, 40, &evicted);
+    CHECK(std::vector<int>({ 1 }) == evicted);
+
+    // touching b makes c the oldest
+    CHECK(cache.Touch("b"));
+    CHECK(!cache.Touch("a"));
+    cache.Insert("d", 4, 40, &evicted);
+    CHECK(std::vector<int>({ 1, 3 }) == evicted);
+
+    const CTestCache::STATS stats = GetStats(cache);
+    CHECK_EQ(2u, stats.entries);
+    CHECK_EQ(80, stats.cost);
+    CHECK_EQ(2u, stats.evictions);
+
+    int value = 0;
+    CHECK(cache.Take("b", &value));
+    CHECK_EQ(2, value);
+    CHECK(cache.Take("d", &value));
+    CHECK_EQ(4, value);
+}
+
+TEST(LruCache, EntryLimit)
+{
+    CTestCache cache(1000, 3);
+    std::vector<int> evicted;
+
+    for (int i = 0; i < 5; ++i)
+    {
+        cache.Insert(std::to_string(i), i, 1, &evicted);
+    }
+    CHECK(std::vector<int>({ 0, 1 }) == evicted);
+    CHECK_EQ(3u, GetStats(cache).entries);
+
+    // lowering either limit trims at once
+    evicted.clear();
+    cache.SetLimits(1000, 1, &evicted);
+    CHECK(std::vector<int>({ 2, 3 }) == evicted);
+
+    evicted.clear();
+    cache.SetLimits(0, 10, &evicted);
+    CHECK(std::vector<int>({ 4 }) == evicted);
+    CHECK_EQ(0u, GetStats(cache).entries);
+    CHECK_EQ(0, GetStats(cache).cost);
+}
+
+TEST(LruCache, ValueOverCapacity)
+{
+    CTestCache cache(100, 10);
+    std::vector<int> evicted;
+
+    cache.Insert("small", 1, 10, &evicted);
+
+    // handed straight back, nothing cached is pushed out for it
+    CHECK_EQ(0u, cache.Insert("huge", 2, 101, &evicted));
+    CHECK(std::vector<int>({ 2 }) == evicted);
+
+    const CTestCache::STATS stats = GetStats(cache);
+    CHECK_EQ(1u, stats.entries);
+    CHECK_EQ(10, stats.cost);
+    CHECK_EQ(1u, stats.evictions);
+}
+
+TEST(LruCache, TakeCountsHitsAndMisses)
+{
+    CTestCache cache(100, 10);
+    std::vector<int> evicted;
+
+    cache.Insert("a", 1, 30, &evicted);
+    cache.Insert("a", 2, 30, &evicted);
+
+    // the newest entry of a key first
+    int value = 0;
+    CHECK(cache.Take("a", &value));
+    CHECK_EQ(2, value);
+    CHECK(cache.Take("a", &value));
+    CHECK_EQ(1, value);
+    CHECK(!cache.Take("a", &value));
+    CHECK(!cache.Take("b", &value));
+
+    const CTestCache::STATS stats = GetStats(cache);
+    CHECK_EQ(0u, stats.entries);
+    CHECK_EQ(0, stats.cost);
+    CHECK_EQ(2u, stats.hits);
+    CHECK_EQ(2u, stats.misses);
+}
+
+TEST(LruCache, IdsOutliveKeyReuse)
+{
+    CTestCache cache(100, 10);
+    std::vector<int> evicted;
+
+    const uint64_t first = cache.Insert("frame", 1, 10, &evicted);
+    CHECK(0 != first);
+
+    int value = 0;
+    CHECK(cache.Take("frame", &value));
+    const uint64_t second = cache.Insert("frame", 2, 10, &evicted);
+    CHECK(first != second);
+
+    // the first entry is gone even though its key is back
+    CHECK(!cache.Find(first, &value));
+    CHECK(!cache.Remove(first, &value));
+    CHECK(!cache.SetCost(first, 50, &evicted));
+
+    CHECK(cache.Find(second, &value));
+    CHECK_EQ(2, value);
+
+    // growing an entry trims others first, oldest first, then itself
+    const uint64_t third = cache.Insert("other", 3, 10, &evicted);
+    CHECK(cache.SetCost(third, 95, &evicted));
+    CHECK(std::vector<int>({ 2 }) == evicted);
+    CHECK_EQ(95, GetStats(cache).cost);
+
+    CHECK(cache.SetCost(third, 101, &evicted));
+    CHECK(std::vector<int>({ 2, 3 }) == evicted);
+    CHECK(!cache.Find(third, &value));
+
+    const uint64_t fourth = cache.Insert("last", 4, 10, &evicted);
+    CHECK(cache.Remove(fourth, &value));
+    CHECK_EQ(4, value);
+    CHECK_EQ(0, GetStats(cache).cost);
+}
+
+TEST(LruCache, Clear)
+{
+    CTestCache cache(100, 10);
+    std::vector<int> evicted;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        cache.Insert(std::to_string(i), i, 5, &evicted);
+    }
+
+    std::vector<int> removed;
+    cache.Clear(&removed);
+    std::sort(removed.begin(), removed.end());
+    CHECK(std::vector<int>({ 0, 1, 2, 3 }) == removed);
+
+    const CTestCache::STATS stats = GetStats(cache);
+    CHECK_EQ(0u, stats.entries);
+    CHECK_EQ(0, stats.cost);
+
+    // clears aren't evictions
+    CHECK_EQ(0u, stats.evictions);
+}
+
+TEST(LruCache, ConcurrentUseKeepsEveryValue)
+{
+    // every value inserted comes back out exactly once: taken, evicted or cleared
+    const int threadCount = 4;
+    const int valuesPerThread = 20000;
+    CTestCache cache(64, 16);
+
+    std::vector<std::vector<int>> outs(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&cache, &outs, t]()
+        {
+            std::vector<int>& out = outs[t];
+            for (int i = 0; i < valuesPerThread; ++i)
+            {
+                const int value = t * valuesPerThread + i;
+                const std::string key = std::to_string(value % 13);
+
+                const uint64_t id = cache.Insert(key, value, 1 + value % 7, &out);
+
+                int taken = 0;
+                if (0 == i % 3 && cache.Take(key, &taken))
+                {
+                    out.push_back(taken);
+                }
+
+                if (0 == i % 5 && cache.Remove(id, &taken))
+                {
+                    out.push_back(taken);
+                }
+
+                if (0 == i % 11)
+                {
+                    cache.SetCost(id, 1 + i % 5, &out);
+                    cache.Touch(key);
+                }
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<int> all;
+    cache.Clear(&all);
+    for (const std::vector<int>& out : outs)
+    {
+        all.insert(all.end(), out.begin(), out.end());
+    }
+
+    std::sort(all.begin(), all.end());
+    CHECK_EQ(static_cast<size_t>(threadCount * valuesPerThread), all.size());
+    for (size_t i = 0; i < all.size(); ++i)
+    {
+        CHECK_EQ(static_cast<int>(i), all[i]);
+    }
+
+    CHECK_EQ(0, GetStats(cache).cost);
+}
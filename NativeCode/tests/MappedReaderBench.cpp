@@ -0,0 +1,172 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "MappedReader.h"
+
+#if !defined(_WIN32)
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// CMappedByteStream against the plain file stream it replaces, on a temp file.
+// Both copy into the caller's buffer like IMFByteStream::Read; the mapped
+// side hints with madvise where the plugin calls PrefetchVirtualMemory.
+
+static const size_t s_fileSize = 128 * 1024 * 1024;
+
+// best effort, pages that can't be dropped just make the cold numbers warm
+static void DropPageCache(int fd)
+{
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+// the offsets read, front to back or all over the file
+static std::vector<uint64_t> GetOffsets(MappedReadPolicy policy, size_t chunk)
+{
+    std::vector<uint64_t> offsets;
+    for (uint64_t offset = 0; offset + chunk <= s_fileSize; offset += chunk)
+    {
+        offsets.push_back(offset);
+    }
+
+    if (MappedReadPolicy::MappedReadPolicy_Random == policy)
+    {
+        std::mt19937 random(static_cast<uint32_t>(chunk));
+        std::shuffle(offsets.begin(), offsets.end(), random);
+    }
+
+    return offsets;
+}
+
+static double ReadFile(int fd, const std::vector<uint64_t>& offsets, size_t chunk, std::vector<uint8_t>* pBuffer)
+{
+    const double start = BenchmarkNow();
+    for (uint64_t offset : offsets)
+    {
+        CHECK_EQ(static_cast<ssize_t>(chunk), pread(fd, pBuffer->data(), chunk, static_cast<off_t>(offset)));
+    }
+
+    return BenchmarkNow() - start;
+}
+
+// mapped per pass, so a cold pass faults its page tables in again too
+static double ReadMapped(int fd, MappedReadPolicy policy, const std::vector<uint64_t>& offsets, size_t chunk, std::vector<uint8_t>* pBuffer)
+{
+    const double start = BenchmarkNow();
+
+    void* pView = mmap(nullptr, s_fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    CHECK(MAP_FAILED != pView);
+
+    CMappedReader reader;
+    reader.Attach(static_cast<const uint8_t*>(pView), s_fileSize, policy, 0);
+    for (uint64_t offset : offsets)
+    {
+        size_t read = 0;
+        CHECK(reader.SetPosition(offset));
+        const uint8_t* pData = reader.Read(chunk, &read);
+
+        CMappedReader::RANGE hint;
+        if (reader.TakeHint(&hint))
+        {
+            madvise(static_cast<uint8_t*>(pView) + hint.offset, static_cast<size_t>(hint.size), MADV_WILLNEED);
+        }
+
+        memcpy(pBuffer->data(), pData, read);
+    }
+
+    munmap(pView, s_fileSize);
+
+    return BenchmarkNow() - start;
+}
+
+BENCHMARK(MappedReader, MappedVersusRead)
+{
+    char path[] = "/tmp/MappedReaderBenchXXXXXX";
+    const int fd = mkstemp(path);
+    CHECK(-1 != fd);
+    unlink(path);
+
+    std::vector<uint8_t> block(1024 * 1024);
+    for (size_t i = 0; i < block.size(); ++i)
+    {
+        block[i] = static_cast<uint8_t>(i * 7);
+    }
+    for (size_t written = 0; written < s_fileSize; written += block.size())
+    {
+        CHECK_EQ(static_cast<ssize_t>(block.size()), write(fd, block.data(), block.size()));
+    }
+
+    struct Pattern
+    {
+        const char* name;
+        MappedReadPolicy policy;
+        size_t chunk;
+    };
+    const Pattern patterns[] =
+    {
+        { "sequential", MappedReadPolicy::MappedReadPolicy_Sequential, 64 * 1024 },
+        { "sequential", MappedReadPolicy::MappedReadPolicy_Sequential, 1024 * 1024 },
+        { "random", MappedReadPolicy::MappedReadPolicy_Random, 4 * 1024 },
+        { "random", MappedReadPolicy::MappedReadPolicy_Random, 64 * 1024 },
+    };
+
+    printf("%zu mb file, MB/s\n", s_fileSize >> 20);
+    printf("pattern      chunk kb   read() cold   mmap cold   read() warm   mmap warm\n");
+
+    std::vector<uint8_t> buffer(1024 * 1024);
+    for (const Pattern& pattern : patterns)
+    {
+        const std::vector<uint64_t> offsets = GetOffsets(pattern.policy, pattern.chunk);
+        const double megabytes = static_cast<double>(offsets.size() * pattern.chunk) / (1024 * 1024);
+
+        DropPageCache(fd);
+        const double readCold = ReadFile(fd, offsets, pattern.chunk, &buffer);
+        DropPageCache(fd);
+        const double mappedCold = ReadMapped(fd, pattern.policy, offsets, pattern.chunk, &buffer);
+
+        // best of a few once the file is in the page cache
+        double readWarm = readCold;
+        double mappedWarm = mappedCold;
+        for (int pass = 0; pass < 3; ++pass)
+        {
+            readWarm = std::min(readWarm, ReadFile(fd, offsets, pattern.chunk, &buffer));
+            mappedWarm = std::min(mappedWarm, ReadMapped(fd, pattern.policy, offsets, pattern.chunk, &buffer));
+        }
+        BenchmarkKeep(buffer[0]);
+
+        printf("%-10s   %8zu   %11.0f   %9.0f   %11.0f   %9.0f\n",
+            pattern.name,
+            pattern.chunk / 1024,
+            megabytes / readCold,
+            megabytes / mappedCold,
+            megabytes / readWarm,
+            megabytes / mappedWarm);
+    }
+
+    close(fd);
+}
+
+#else
+
+BENCHMARK(MappedReader, MappedVersusRead)
+{
+    // the plugin's own stream is the windows side of this, see MappedByteStream.cpp
+    printf("posix only, skipped\n");
+}
+
+#endif
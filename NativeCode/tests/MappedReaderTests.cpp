@@ -0,0 +1,172 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "MappedReader.h"
+
+static const uint64_t s_mb = 1024 * 1024;
+
+// stands in for the view of a 40mb file, reads are checked by where they point
+static const std::vector<uint8_t>& GetView()
+{
+    static const std::vector<uint8_t> s_view(40 * s_mb);
+
+    return s_view;
+}
+
+static bool IsHint(CMappedReader& reader, uint64_t offset, uint64_t size)
+{
+    CMappedReader::RANGE hint = {};
+
+    return reader.TakeHint(&hint) && offset == hint.offset && size == hint.size;
+}
+
+static void ReadTo(CMappedReader& reader, uint64_t end)
+{
+    size_t read = 0;
+    reader.Read(static_cast<size_t>(end - reader.GetPosition()), &read);
+    CHECK_EQ(end, reader.GetPosition());
+}
+
+TEST(MappedReader, ReadsInPlace)
+{
+    const std::vector<uint8_t>& view = GetView();
+    CMappedReader reader;
+    reader.Attach(view.data(), view.size(), MappedReadPolicy::MappedReadPolicy_Sequential, 0);
+    CHECK_EQ(view.size(), reader.GetSize());
+
+    size_t read = 0;
+    CHECK(view.data() == reader.Read(100, &read));
+    CHECK_EQ(100u, read);
+    CHECK(reader.SetPosition(view.size() - 10));
+    CHECK(view.data() + view.size() - 10 == reader.Read(100, &read));
+    CHECK_EQ(10u, read);
+    CHECK(reader.IsEnd());
+
+    // nothing past the end
+    CHECK(nullptr == reader.Read(100, &read));
+    CHECK_EQ(0u, read);
+    CHECK(!reader.SetPosition(view.size() + 1));
+    CHECK(reader.SetPosition(view.size()));
+
+    CMappedReader::STATS stats;
+    reader.GetStats(&stats);
+    CHECK_EQ(2u, stats.reads);
+    CHECK_EQ(110u, stats.bytesRead);
+    CHECK_EQ(1u, stats.seeks);
+}
+
+TEST(MappedReader, SequentialWindow)
+{
+    const std::vector<uint8_t>& view = GetView();
+    CMappedReader reader;
+
+    // 7mb rounds up to 8, the large page size
+    reader.Attach(view.data(), view.size(), MappedReadPolicy::MappedReadPolicy_Sequential, 7 * s_mb);
+
+    // the first read hints a window past it, rounded out to large pages
+    ReadTo(reader, 64 * 1024);
+    CHECK(IsHint(reader, 0, 10 * s_mb));
+    CHECK(!IsHint(reader, 0, 10 * s_mb));
+
+    // nothing more until the reads are within half a window of its end
+    ReadTo(reader, 6 * s_mb);
+    CHECK(!IsHint(reader, 0, 0));
+    ReadTo(reader, 6 * s_mb + 1);
+    CHECK(IsHint(reader, 10 * s_mb, 6 * s_mb));
+
+    // a seek into the window keeps it
+    CHECK(reader.SetPosition(12 * s_mb));
+    ReadTo(reader, 12 * s_mb + 1);
+    CHECK(IsHint(reader, 16 * s_mb, 6 * s_mb));
+
+    // a seek past it starts a new window where it lands
+    CHECK(reader.SetPosition(31 * s_mb));
+    ReadTo(reader, 31 * s_mb + 1);
+    CHECK(IsHint(reader, 30 * s_mb, 10 * s_mb));
+
+    // clamped to the end of the file, nothing left to hint there
+    ReadTo(reader, 39 * s_mb);
+    CHECK(!IsHint(reader, 0, 0));
+
+    CMappedReader::STATS stats;
+    reader.GetStats(&stats);
+    CHECK_EQ(4u, stats.hints);
+    CHECK_EQ(32 * s_mb, stats.hintBytes);
+    CHECK_EQ(2u, stats.seeks);
+}
+
+TEST(MappedReader, ReadsOutrunTheWindow)
+{
+    const std::vector<uint8_t>& view = GetView();
+    CMappedReader reader;
+    reader.Attach(view.data(), view.size(), MappedReadPolicy::MappedReadPolicy_Sequential, 2 * s_mb);
+
+    // a read longer than the window hints from its own start
+    ReadTo(reader, 1);
+    CHECK(IsHint(reader, 0, 4 * s_mb));
+    ReadTo(reader, 5 * s_mb);
+    CHECK(IsHint(reader, 0, 8 * s_mb));
+
+    // the default is used for 0
+    reader.Attach(view.data(), view.size(), MappedReadPolicy::MappedReadPolicy_Sequential, 0);
+    ReadTo(reader, 1);
+    CHECK(IsHint(reader, 0, 34 * s_mb));
+}
+
+TEST(MappedReader, RandomHintsTouchedPages)
+{
+    const std::vector<uint8_t>& view = GetView();
+    const uint64_t page = MAPPED_READ_RANDOM_ALIGNMENT;
+    CMappedReader reader;
+    reader.Attach(view.data(), view.size(), MappedReadPolicy::MappedReadPolicy_Random, 0);
+
+    // only the pages a read touches, at the small alignment
+    CHECK(reader.SetPosition(5 * s_mb + 100));
+    size_t read = 0;
+    const uint8_t* pData = reader.Read(10, &read);
+    CHECK(view.data() + 5 * s_mb + 100 == pData);
+    CHECK(IsHint(reader, 5 * s_mb, page));
+
+    // within the last hint, nothing new
+    reader.Read(10, &read);
+    CHECK(!IsHint(reader, 0, 0));
+
+    // across a page boundary, both pages
+    CHECK(reader.SetPosition(5 * s_mb + page - 5));
+    reader.Read(10, &read);
+    CHECK(IsHint(reader, 5 * s_mb, 2 * page));
+
+    // back near the start
+    CHECK(reader.SetPosition(3));
+    reader.Read(page, &read);
+    CHECK(IsHint(reader, 0, 2 * page));
+
+    // the last page is clamped to the end of the file
+    CHECK(reader.SetPosition(view.size() - 1));
+    reader.Read(10, &read);
+    CHECK_EQ(1u, read);
+    CHECK(IsHint(reader, view.size() - page, page));
+}
+
+TEST(MappedReader, Unattached)
+{
+    CMappedReader reader;
+    reader.Attach(nullptr, 1000, MappedReadPolicy::MappedReadPolicy_Sequential, 0);
+    CHECK_EQ(0u, reader.GetSize());
+    CHECK(reader.IsEnd());
+
+    size_t read = 1;
+    CHECK(nullptr == reader.Read(10, &read));
+    CHECK_EQ(0u, read);
+    CHECK(!reader.SetPosition(1));
+}
@@ -0,0 +1,287 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "KeyframeIndex.h"
+
+#include <cstring>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+// MP4 files built in memory, just the boxes KeyframeIndex reads, so the
+// tests don't need sample media on disk
+
+typedef std::vector<uint8_t> MP4_BYTES;
+
+inline void Mp4PutU32(MP4_BYTES* pBytes, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        pBytes->push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+inline void Mp4PutU64(MP4_BYTES* pBytes, uint64_t value)
+{
+    Mp4PutU32(pBytes, static_cast<uint32_t>(value >> 32));
+    Mp4PutU32(pBytes, static_cast<uint32_t>(value));
+}
+
+inline void Mp4PutZeros(MP4_BYTES* pBytes, size_t count)
+{
+    pBytes->insert(pBytes->end(), count, 0);
+}
+
+inline MP4_BYTES Mp4Concat(std::initializer_list<MP4_BYTES> parts)
+{
+    MP4_BYTES bytes;
+    for (const MP4_BYTES& part : parts)
+    {
+        bytes.insert(bytes.end(), part.begin(), part.end());
+    }
+
+    return bytes;
+}
+
+inline MP4_BYTES Mp4Box(const char* pType, const MP4_BYTES& payload)
+{
+    MP4_BYTES bytes;
+    Mp4PutU32(&bytes, static_cast<uint32_t>(8 + payload.size()));
+    bytes.insert(bytes.end(), pType, pType + 4);
+    bytes.insert(bytes.end(), payload.begin(), payload.end());
+
+    return bytes;
+}
+
+inline MP4_BYTES Mp4FullBox(const char* pType, uint32_t version, uint32_t flags, const MP4_BYTES& payload)
+{
+    MP4_BYTES bytes;
+    Mp4PutU32(&bytes, (version << 24) | flags);
+    bytes.insert(bytes.end(), payload.begin(), payload.end());
+
+    return Mp4Box(pType, bytes);
+}
+
+// mvhd and mdhd share the layout up to the duration
+inline MP4_BYTES Mp4HeaderBox(const char* pType, uint32_t version, uint32_t timescale, uint64_t duration, size_t trailing)
+{
+    MP4_BYTES payload;
+    if (1 == version)
+    {
+        Mp4PutU64(&payload, 0);
+        Mp4PutU64(&payload, 0);
+        Mp4PutU32(&payload, timescale);
+        Mp4PutU64(&payload, duration);
+    }
+    else
+    {
+        Mp4PutU32(&payload, 0);
+        Mp4PutU32(&payload, 0);
+        Mp4PutU32(&payload, timescale);
+        Mp4PutU32(&payload, static_cast<uint32_t>(duration));
+    }
+    Mp4PutZeros(&payload, trailing);
+
+    return Mp4FullBox(pType, version, 0, payload);
+}
+
+inline MP4_BYTES Mp4Movie(uint32_t timescale, uint64_t duration, uint32_t version, std::initializer_list<MP4_BYTES> tracks)
+{
+    MP4_BYTES payload = Mp4HeaderBox("mvhd", version, timescale, duration, 80);
+    for (const MP4_BYTES& track : tracks)
+    {
+        payload.insert(payload.end(), track.begin(), track.end());
+    }
+
+    return Mp4Box("moov", payload);
+}
+
+typedef struct _MP4_TEST_EDIT
+{
+    uint64_t duration;          // movie timescale
+    int64_t mediaTime;          // -1 for an empty edit
+} MP4_TEST_EDIT;
+
+typedef struct _MP4_TEST_TRACK
+{
+    _MP4_TEST_TRACK()
+        : pHandler("vide")
+        , timescale(30000)
+        , mediaHeaderVersion(0)
+        , hasSyncSamples(false)
+        , hasEdits(false)
+        , editListVersion(0)
+        , width(0)
+        , height(0)
+    {
+    }
+
+    const char* pHandler;
+    uint32_t timescale;
+    uint32_t mediaHeaderVersion;
+    std::vector<std::pair<uint32_t, uint32_t>> timeToSample;        // count, delta
+    std::vector<std::pair<uint32_t, int32_t>> compositionOffsets;   // count, offset, ctts when not empty
+    bool hasSyncSamples;                                            // without stss every sample is one
+    std::vector<uint32_t> syncSamples;                              // 1 based
+    bool hasEdits;
+    uint32_t editListVersion;
+    std::vector<MP4_TEST_EDIT> edits;
+    uint32_t width;
+    uint32_t height;
+} MP4_TEST_TRACK;
+
+inline MP4_BYTES Mp4Track(const MP4_TEST_TRACK& track)
+{
+    MP4_BYTES sampleTable = Mp4FullBox("stsd", 0, 0, MP4_BYTES(4, 0));
+
+    MP4_BYTES stts;
+    Mp4PutU32(&stts, static_cast<uint32_t>(track.timeToSample.size()));
+    for (const auto& entry : track.timeToSample)
+    {
+        Mp4PutU32(&stts, entry.first);
+        Mp4PutU32(&stts, entry.second);
+    }
+    sampleTable = Mp4Concat({ sampleTable, Mp4FullBox("stts", 0, 0, stts) });
+
+    if (!track.compositionOffsets.empty())
+    {
+        MP4_BYTES ctts;
+        Mp4PutU32(&ctts, static_cast<uint32_t>(track.compositionOffsets.size()));
+        for (const auto& entry : track.compositionOffsets)
+        {
+            Mp4PutU32(&ctts, entry.first);
+            Mp4PutU32(&ctts, static_cast<uint32_t>(entry.second));
+        }
+        sampleTable = Mp4Concat({ sampleTable, Mp4FullBox("ctts", 1, 0, ctts) });
+    }
+
+    if (track.hasSyncSamples)
+    {
+        MP4_BYTES stss;
+        Mp4PutU32(&stss, static_cast<uint32_t>(track.syncSamples.size()));
+        for (uint32_t sample : track.syncSamples)
+        {
+            Mp4PutU32(&stss, sample);
+        }
+        sampleTable = Mp4Concat({ sampleTable, Mp4FullBox("stss", 0, 0, stss) });
+    }
+
+    MP4_BYTES handler;
+    Mp4PutU32(&handler, 0);
+    handler.insert(handler.end(), track.pHandler, track.pHandler + 4);
+    Mp4PutZeros(&handler, 12);
+    handler.push_back('x');
+    handler.push_back(0);
+
+    const MP4_BYTES media = Mp4Box("mdia", Mp4Concat({
+        Mp4HeaderBox("mdhd", track.mediaHeaderVersion, track.timescale, 0, 4),
+        Mp4FullBox("hdlr", 0, 0, handler),
+        Mp4Box("minf", Mp4Box("stbl", sampleTable)) }));
+
+    // version 0 tkhd, 84 bytes with the size at the end in 16.16
+    MP4_BYTES trackHeader;
+    Mp4PutZeros(&trackHeader, 72);
+    Mp4PutU32(&trackHeader, track.width << 16);
+    Mp4PutU32(&trackHeader, track.height << 16);
+
+    MP4_BYTES payload = Mp4FullBox("tkhd", 0, 3, trackHeader);
+    if (track.hasEdits)
+    {
+        MP4_BYTES elst;
+        Mp4PutU32(&elst, static_cast<uint32_t>(track.edits.size()));
+        for (const MP4_TEST_EDIT& edit : track.edits)
+        {
+            if (1 == track.editListVersion)
+            {
+                Mp4PutU64(&elst, edit.duration);
+                Mp4PutU64(&elst, static_cast<uint64_t>(edit.mediaTime));
+            }
+            else
+            {
+                Mp4PutU32(&elst, static_cast<uint32_t>(edit.duration));
+                Mp4PutU32(&elst, static_cast<uint32_t>(edit.mediaTime));
+            }
+            Mp4PutU32(&elst, 0x10000);
+        }
+        payload = Mp4Concat({ payload, Mp4Box("edts", Mp4FullBox("elst", track.editListVersion, 0, elst)) });
+    }
+
+    return Mp4Box("trak", Mp4Concat({ payload, media }));
+}
+
+// ftyp, then moov and mdat in either order, mdat with a 64 bit size if large
+inline MP4_BYTES Mp4File(const MP4_BYTES& movie, bool movieFirst, bool largeMediaData, size_t mediaDataSize)
+{
+    const MP4_BYTES fileType = Mp4Box("ftyp", MP4_BYTES({ 'i', 's', 'o', 'm', 0, 0, 0, 0, 'i', 's', 'o', 'm' }));
+
+    MP4_BYTES mediaData;
+    if (largeMediaData)
+    {
+        Mp4PutU32(&mediaData, 1);
+        mediaData.insert(mediaData.end(), { 'm', 'd', 'a', 't' });
+        Mp4PutU64(&mediaData, 16 + mediaDataSize);
+        Mp4PutZeros(&mediaData, mediaDataSize);
+    }
+    else
+    {
+        mediaData = Mp4Box("mdat", MP4_BYTES(mediaDataSize, 0));
+    }
+
+    return movieFirst ? Mp4Concat({ fileType, movie, mediaData }) : Mp4Concat({ fileType, mediaData, movie });
+}
+
+// reads a file held in memory, counting the reads and bytes asked for
+class CMp4MemoryReader : public IKeyframeIndexReader
+{
+public:
+    explicit CMp4MemoryReader(const MP4_BYTES& bytes)
+        : m_bytes(bytes)
+        , m_reads(0)
+        , m_bytesRead(0)
+    {
+    }
+
+    bool Read(uint64_t offset, void* buffer, size_t size) override
+    {
+        ++m_reads;
+        if (offset > m_bytes.size() || size > m_bytes.size() - offset)
+        {
+            return false;
+        }
+
+        memcpy(buffer, m_bytes.data() + offset, size);
+        m_bytesRead += size;
+
+        return true;
+    }
+
+    uint64_t GetSize() override
+    {
+        return m_bytes.size();
+    }
+
+    uint32_t Reads() const
+    {
+        return m_reads;
+    }
+
+    uint64_t BytesRead() const
+    {
+        return m_bytesRead;
+    }
+
+private:
+    const MP4_BYTES& m_bytes;
+    uint32_t m_reads;
+    uint64_t m_bytesRead;
+};
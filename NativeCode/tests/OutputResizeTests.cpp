@@ -0,0 +1,236 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "OutputResize.h"
+
+#include <memory>
+
+// slots are shared_ptrs numbered as they are made, like the ComPtrs of the
+// player's textures, so a test can tell which one it was handed
+typedef std::shared_ptr<int> CSlot;
+typedef COutputResize<CSlot> CTestResize;
+
+static const uint32_t s_slotCount = 3;
+
+static uint64_t VideoSize(uint32_t width, uint32_t height)
+{
+    return (static_cast<uint64_t>(width) << 32) | height;
+}
+
+// stands in for the player's output slots and what they were made for
+class COutput
+{
+public:
+    COutput()
+        : count(0)
+        , key()
+        , slotSize(0)
+        , m_nextId(1)
+    {
+    }
+
+    void Make(uint32_t width, uint32_t height)
+    {
+        for (uint32_t i = 0; i < s_slotCount; ++i)
+        {
+            slots[i] = std::make_shared<int>(m_nextId++);
+        }
+
+        count = s_slotCount;
+        key.width = width;
+        key.height = height;
+        slotSize = static_cast<int64_t>(width) * height * 4;
+    }
+
+    bool Owns(const CSlot* pSlot) const
+    {
+        return pSlot >= slots && pSlot < slots + s_slotCount;
+    }
+
+    CSlot slots[CFrameRing::MaxSlots];
+    uint32_t count;
+    TEXTURE_POOL_KEY key;
+    int64_t slotSize;
+
+private:
+    int m_nextId;
+};
+
+// what ReleaseRetired handed back
+struct Released
+{
+    std::vector<int> ids;
+    int held;
+    uint32_t width;
+    int64_t slotSize;
+};
+
+static Released ReleaseRetired(CTestResize& resize)
+{
+    Released released = { {}, -1, 0, 0 };
+    resize.ReleaseRetired([&released](CSlot& slot, bool held, const TEXTURE_POOL_KEY& key, int64_t slotSize)
+    {
+        if (held)
+        {
+            released.held = *slot;
+        }
+
+        released.ids.push_back(*slot);
+        released.width = key.width;
+        released.slotSize = slotSize;
+    });
+
+    return released;
+}
+
+TEST(OutputResize, MidStreamResize)
+{
+    COutput output;
+    CTestResize resize;
+    output.Make(1920, 1080);
+    resize.Reset(&output.slots[0], VideoSize(1920, 1080), VideoSize(1920, 1080));
+
+    CHECK(OutputResizeAction::OutputResizeAction_None == resize.OnVideoSize(VideoSize(1920, 1080), true));
+    resize.Latch(&output.slots[1]);
+    CHECK(&output.slots[1] == resize.Fetch());
+
+    // the video shrinks, unity keeps sampling the slot it has until a resized one is latched
+    CHECK(OutputResizeAction::OutputResizeAction_Resize == resize.OnVideoSize(VideoSize(1280, 720), true));
+    resize.Retire(output.slots, output.count, 1, output.key, output.slotSize);
+    CHECK_EQ(3u, resize.GetRetiredCount());
+    CHECK(nullptr == output.slots[1]);
+
+    output.Make(1280, 720);
+    resize.Commit();
+
+    CSlot* pFetched = resize.Fetch();
+    CHECK(!output.Owns(pFetched));
+    CHECK_EQ(2, **pFetched);
+    CHECK(!resize.CanReleaseRetired(false));
+
+    // another change waits for the retired slots, however often it is seen
+    CHECK(OutputResizeAction::OutputResizeAction_None == resize.OnVideoSize(VideoSize(640, 360), true));
+    CHECK(OutputResizeAction::OutputResizeAction_None == resize.OnVideoSize(VideoSize(640, 360), true));
+
+    // a resized slot latched but not fetched yet, script may still draw with the old one
+    resize.Latch(&output.slots[0]);
+    CHECK(!resize.CanReleaseRetired(false));
+    CHECK(&output.slots[0] == resize.Fetch());
+    CHECK(resize.CanReleaseRetired(false));
+
+    const Released released = ReleaseRetired(resize);
+    CHECK(std::vector<int>({ 1, 2, 3 }) == released.ids);
+    CHECK_EQ(2, released.held);
+    CHECK_EQ(1920u, released.width);
+    CHECK_EQ(1920 * 1080 * 4, released.slotSize);
+    CHECK_EQ(0u, resize.GetRetiredCount());
+    CHECK(!resize.CanReleaseRetired(true));
+
+    // the size that waited goes ahead now
+    CHECK(&output.slots[0] == resize.Fetch());
+    CHECK(OutputResizeAction::OutputResizeAction_Resize == resize.OnVideoSize(VideoSize(640, 360), true));
+}
+
+TEST(OutputResize, NoStaleSlotHandedOut)
+{
+    COutput output;
+    CTestResize resize;
+    output.Make(1920, 1080);
+    resize.Reset(&output.slots[0], VideoSize(1920, 1080), VideoSize(1920, 1080));
+
+    CHECK(OutputResizeAction::OutputResizeAction_Resize == resize.OnVideoSize(VideoSize(1280, 720), false));
+    resize.Retire(output.slots, output.count, CTestResize::InvalidSlot, output.key, output.slotSize);
+    output.Make(1280, 720);
+    resize.Commit();
+
+    // slots unity never draws with go at once, before anything of the new size is latched
+    CHECK(resize.CanReleaseRetired(true));
+    const Released released = ReleaseRetired(resize);
+    CHECK_EQ(3u, released.ids.size());
+    CHECK_EQ(-1, released.held);
+
+    // script gets nothing rather than the slot that was released
+    CHECK(nullptr == resize.Fetch());
+    resize.Latch(&output.slots[2]);
+    CHECK(&output.slots[2] == resize.Fetch());
+
+    // releasing the player's textures, and none are handed out after
+    resize.Clear();
+    CHECK(nullptr == resize.Fetch());
+    CHECK(OutputResizeAction::OutputResizeAction_None == resize.OnVideoSize(VideoSize(640, 360), false));
+}
+
+TEST(OutputResize, FailedResizeIsRetried)
+{
+    COutput output;
+    CTestResize resize;
+    output.Make(1920, 1080);
+    resize.Reset(&output.slots[0], VideoSize(1920, 1080), VideoSize(1920, 1080));
+    resize.Latch(&output.slots[2]);
+
+    CHECK(OutputResizeAction::OutputResizeAction_Resize == resize.OnVideoSize(VideoSize(3840, 2160), true));
+    const TEXTURE_POOL_KEY key = output.key;
+    resize.Retire(output.slots, output.count, 2, output.key, output.slotSize);
+
+    // out of video memory, the new slots were never made. Everything goes back as it was.
+    output.key.width = 3840;
+    output.count = 0;
+    int heldSlot = CTestResize::InvalidSlot;
+    resize.Restore(output.slots, &output.count, &heldSlot, &output.key, &output.slotSize);
+    CHECK_EQ(3u, output.count);
+    CHECK_EQ(2, heldSlot);
+    CHECK(key == output.key);
+    CHECK_EQ(1920 * 1080 * 4, output.slotSize);
+    CHECK_EQ(1, *output.slots[0]);
+    CHECK_EQ(3, *output.slots[2]);
+    CHECK_EQ(0u, resize.GetRetiredCount());
+
+    // the slot unity samples is the same one, back in the output
+    CHECK(&output.slots[2] == resize.Fetch());
+    CHECK(!resize.CanReleaseRetired(true));
+
+    // the size is reported once, still following, the next size tries again
+    CHECK(OutputResizeAction::OutputResizeAction_None == resize.OnVideoSize(VideoSize(3840, 2160), true));
+    CHECK(OutputResizeAction::OutputResizeAction_Resize == resize.OnVideoSize(VideoSize(2560, 1440), true));
+    resize.Retire(output.slots, output.count, 2, output.key, output.slotSize);
+    output.Make(2560, 1440);
+    resize.Commit();
+
+    // the failure did not start a generation, the first latch of this one releases
+    resize.Latch(&output.slots[0]);
+    resize.Fetch();
+    CHECK(resize.CanReleaseRetired(false));
+}
+
+TEST(OutputResize, ReportOnly)
+{
+    COutput output;
+    CTestResize resize;
+    output.Make(1024, 1024);
+
+    // made at a size of the caller's choosing, the output never follows
+    resize.Reset(&output.slots[0], VideoSize(1920, 1080), VideoSize(1024, 1024));
+    CHECK(OutputResizeAction::OutputResizeAction_Report == resize.OnVideoSize(VideoSize(1280, 720), true));
+    CHECK(OutputResizeAction::OutputResizeAction_None == resize.OnVideoSize(VideoSize(1280, 720), true));
+
+    // made before the video opened, its first size is no change
+    resize.Reset(&output.slots[0], 0, VideoSize(1024, 1024));
+    CHECK(OutputResizeAction::OutputResizeAction_None == resize.OnVideoSize(0, true));
+    CHECK(OutputResizeAction::OutputResizeAction_None == resize.OnVideoSize(VideoSize(1920, 1080), true));
+    CHECK(OutputResizeAction::OutputResizeAction_Report == resize.OnVideoSize(VideoSize(1280, 720), true));
+
+    // 4:2:0 needs even dimensions, bgra does not
+    resize.Reset(&output.slots[0], VideoSize(1920, 1080), VideoSize(1920, 1080));
+    CHECK(OutputResizeAction::OutputResizeAction_Report == resize.OnVideoSize(VideoSize(1279, 720), true));
+    CHECK(OutputResizeAction::OutputResizeAction_Resize == resize.OnVideoSize(VideoSize(1280, 719), false));
+}
@@ -0,0 +1,200 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "PlaybackCounters.h"
+
+#include <thread>
+
+// p99 of 99 samples of value and one far above, which is the upper bound of value's bucket
+static int64_t BucketUpperBound(int64_t value)
+{
+    CLatencyHistogram histogram;
+    for (int i = 0; i < 99; ++i)
+    {
+        histogram.Add(value);
+    }
+    histogram.Add(INT64_MAX / 2);
+
+    CLatencyHistogram::SNAPSHOT snapshot;
+    histogram.Snapshot(&snapshot, false);
+
+    return snapshot.p99;
+}
+
+TEST(PlaybackCounters, BucketBoundaries)
+{
+    // exact below 8, then four buckets per power of two
+    for (int64_t value = 0; value < 8; ++value)
+    {
+        CHECK_EQ(value, BucketUpperBound(value));
+    }
+    CHECK_EQ(9, BucketUpperBound(8));
+    CHECK_EQ(9, BucketUpperBound(9));
+    CHECK_EQ(11, BucketUpperBound(10));
+    CHECK_EQ(15, BucketUpperBound(15));
+    CHECK_EQ(19, BucketUpperBound(16));
+    CHECK_EQ(1023, BucketUpperBound(896));
+    CHECK_EQ(1023, BucketUpperBound(1000));
+    CHECK_EQ(1279, BucketUpperBound(1024));
+
+    // never below the value, never more than 25% above it
+    for (int64_t value = 8; value < (int64_t(1) << 40); value = value * 3 / 2 + 1)
+    {
+        const int64_t upper = BucketUpperBound(value);
+        CHECK(upper >= value);
+        CHECK(upper - value <= value / 4);
+    }
+
+    // negative durations count as 0
+    CHECK_EQ(0, BucketUpperBound(-5));
+}
+
+TEST(PlaybackCounters, Percentiles)
+{
+    CLatencyHistogram histogram;
+    CLatencyHistogram::SNAPSHOT snapshot;
+
+    histogram.Snapshot(&snapshot, false);
+    CHECK_EQ(0u, snapshot.count);
+    CHECK_EQ(0, snapshot.min);
+    CHECK_EQ(0, snapshot.max);
+    CHECK_EQ(0, snapshot.mean);
+    CHECK_EQ(0, snapshot.p99);
+
+    // 1..1000, the 990th sits in the bucket 896..1023
+    for (int64_t value = 1; value <= 1000; ++value)
+    {
+        histogram.Add(value);
+    }
+
+    histogram.Snapshot(&snapshot, false);
+    CHECK_EQ(1000u, snapshot.count);
+    CHECK_EQ(1, snapshot.min);
+    CHECK_EQ(1000, snapshot.max);
+    CHECK_EQ(500, snapshot.mean);
+    CHECK_EQ(1000, snapshot.p99);
+
+    // a single sample reports itself, the bucket bound is capped by the max
+    CLatencyHistogram single;
+    single.Add(1000);
+    single.Snapshot(&snapshot, false);
+    CHECK_EQ(1000, snapshot.p99);
+    CHECK_EQ(1000, snapshot.min);
+
+    // 1% of outliers don't move the p99
+    CLatencyHistogram tail;
+    for (int i = 0; i < 990; ++i)
+    {
+        tail.Add(100);
+    }
+    for (int i = 0; i < 10; ++i)
+    {
+        tail.Add(1000000);
+    }
+    tail.Snapshot(&snapshot, false);
+    CHECK_EQ(111, snapshot.p99);
+    CHECK_EQ(1000000, snapshot.max);
+}
+
+TEST(PlaybackCounters, SnapshotResets)
+{
+    CPlaybackCounters counters;
+    counters.OnFrameAvailable();
+    counters.OnFrameDropped();
+    counters.OnFrameCopied(CPlaybackCounters::Now(), true);
+    counters.OnFrameCopied(CPlaybackCounters::Now(), false);
+
+    CPlaybackCounters::SNAPSHOT snapshot;
+    counters.Snapshot(&snapshot, false);
+    CHECK_EQ(1u, snapshot.framesAvailable);
+    CHECK_EQ(1u, snapshot.framesCopied);
+    CHECK_EQ(1u, snapshot.framesDropped);
+    CHECK_EQ(1u, snapshot.copyFailures);
+    CHECK_EQ(1u, snapshot.copyTime.count);
+
+    // the resetting snapshot still reports the interval it ends
+    counters.Snapshot(&snapshot, true);
+    CHECK_EQ(1u, snapshot.framesCopied);
+    CHECK_EQ(1u, snapshot.copyTime.count);
+
+    counters.Snapshot(&snapshot, false);
+    CHECK_EQ(0u, snapshot.framesAvailable);
+    CHECK_EQ(0u, snapshot.framesCopied);
+    CHECK_EQ(0u, snapshot.framesDropped);
+    CHECK_EQ(0u, snapshot.copyFailures);
+    CHECK_EQ(0u, snapshot.copyTime.count);
+    CHECK_EQ(0, snapshot.copyTime.min);
+    CHECK_EQ(0, snapshot.copyTime.max);
+}
+
+TEST(PlaybackCounters, ResetWhileIncrementing)
+{
+    // every increment is reported by exactly one of the resetting snapshots
+    const uint32_t threadCount = 4;
+    const uint64_t perThread = 200000;
+
+    CPlaybackCounters counters;
+    CReadAheadCounters readAhead;
+    std::atomic<uint32_t> running(threadCount);
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&]()
+        {
+            for (uint64_t i = 0; i < perThread; ++i)
+            {
+                counters.OnFrameAvailable();
+                counters.OnEventDelivered(CPlaybackCounters::Now() - static_cast<int64_t>(i % 1000));
+                readAhead.OnRead(3);
+                readAhead.OnWait(static_cast<int64_t>(i % 50), 0 == i % 2);
+            }
+            running.fetch_sub(1);
+        });
+    }
+
+    uint64_t frames = 0;
+    uint64_t events = 0;
+    uint64_t bytes = 0;
+    uint64_t waits = 0;
+    auto take = [&]()
+    {
+        CPlaybackCounters::SNAPSHOT snapshot;
+        counters.Snapshot(&snapshot, true);
+        frames += snapshot.framesAvailable;
+        events += snapshot.eventLatency.count;
+
+        CReadAheadCounters::SNAPSHOT readAheadSnapshot;
+        readAhead.Snapshot(&readAheadSnapshot, true);
+        bytes += readAheadSnapshot.bytesRead;
+        waits += readAheadSnapshot.underrun.count + readAheadSnapshot.seekFill.count;
+    };
+
+    while (0 != running.load())
+    {
+        take();
+        std::this_thread::yield();
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    take();
+
+    const uint64_t total = threadCount * perThread;
+    CHECK_EQ(total, frames);
+    CHECK_EQ(total, events);
+    CHECK_EQ(total * 3, bytes);
+    CHECK_EQ(total, waits);
+}
@@ -0,0 +1,174 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "PreloadLru.h"
+
+#include <memory>
+
+// items are shared_ptrs, like the ComPtrs the plugin caches, so a test can
+// tell whether the cache still holds one
+typedef std::shared_ptr<int> CItem;
+typedef CPreloadLru<CItem> CTestPreloads;
+
+static CTestPreloads::STATS GetStats(const CTestPreloads& preloads)
+{
+    CTestPreloads::STATS stats;
+    preloads.GetStats(&stats);
+
+    return stats;
+}
+
+TEST(PreloadCache, HitAfterPreload)
+{
+    CTestPreloads preloads(PLAYBACK_PRELOAD_CAPACITY, PLAYBACK_PRELOAD_MAX_ENTRIES);
+    std::vector<CItem> evicted;
+
+    CHECK(!preloads.Touch(L"a.mp4"));
+    const uint64_t id = preloads.Insert(L"a.mp4", std::make_shared<int>(1), &evicted);
+    CHECK(0 != id);
+
+    // a second preload of the same url is a no-op
+    CHECK(preloads.Touch(L"a.mp4"));
+
+    // LoadContent takes it, once
+    CItem item;
+    CHECK(preloads.Take(L"a.mp4", &item));
+    CHECK_EQ(1, *item);
+    CHECK(!preloads.Take(L"a.mp4", &item));
+    CHECK(!preloads.Take(L"b.mp4", &item));
+
+    // the open completing after the take finds nothing to charge
+    CHECK(!preloads.Find(id, &item));
+    preloads.OnOpened(id, 8000000, &evicted);
+
+    const CTestPreloads::STATS stats = GetStats(preloads);
+    CHECK_EQ(0u, stats.entries);
+    CHECK_EQ(0, stats.cost);
+    CHECK_EQ(1u, stats.hits);
+    CHECK_EQ(2u, stats.misses);
+    CHECK(evicted.empty());
+}
+
+TEST(PreloadCache, ChargedByBitrateOnceOpened)
+{
+    CTestPreloads preloads(PLAYBACK_PRELOAD_CAPACITY, PLAYBACK_PRELOAD_MAX_ENTRIES);
+    std::vector<CItem> evicted;
+
+    const uint64_t id = preloads.Insert(L"a.mp4", std::make_shared<int>(1), &evicted);
+    CHECK_EQ(PLAYBACK_PRELOAD_BASE_COST, GetStats(preloads).cost);
+
+    // 8 mbit/s reads 2 mb ahead on top of the headers
+    preloads.OnOpened(id, 8000000, &evicted);
+    CHECK_EQ(PLAYBACK_PRELOAD_BASE_COST + 2000000, GetStats(preloads).cost);
+    CHECK_EQ(GetPreloadCost(8000000), GetStats(preloads).cost);
+
+    // no video track, headers only
+    CHECK_EQ(PLAYBACK_PRELOAD_BASE_COST, GetPreloadCost(0));
+}
+
+TEST(PreloadCache, ByteBudget)
+{
+    // room for two opened 8 mbit/s sources and one still opening
+    const int64_t opened = GetPreloadCost(8000000);
+    const int64_t capacity = opened * 2 + PLAYBACK_PRELOAD_BASE_COST;
+    CTestPreloads preloads(capacity, 16);
+    std::vector<CItem> evicted;
+
+    uint64_t ids[4];
+    const wchar_t* urls[] = { L"0.mp4", L"1.mp4", L"2.mp4", L"3.mp4" };
+    for (int i = 0; i < 2; ++i)
+    {
+        ids[i] = preloads.Insert(urls[i], std::make_shared<int>(i), &evicted);
+        preloads.OnOpened(ids[i], 8000000, &evicted);
+    }
+
+    // touching the oldest makes the second one go first
+    CHECK(preloads.Touch(urls[0]));
+
+    // a third fits at the base cost while it opens, then pushes one out when charged in full
+    ids[2] = preloads.Insert(urls[2], std::make_shared<int>(2), &evicted);
+    CHECK(evicted.empty());
+    CHECK_EQ(capacity, GetStats(preloads).cost);
+
+    preloads.OnOpened(ids[2], 8000000, &evicted);
+    CHECK_EQ(1u, evicted.size());
+    CHECK_EQ(1, *evicted[0]);
+    CHECK_EQ(opened * 2, GetStats(preloads).cost);
+
+    ids[3] = preloads.Insert(urls[3], std::make_shared<int>(3), &evicted);
+    preloads.OnOpened(ids[3], 8000000, &evicted);
+    CHECK_EQ(2u, evicted.size());
+    CHECK_EQ(0, *evicted[1]);
+
+    CTestPreloads::STATS stats = GetStats(preloads);
+    CHECK_EQ(2u, stats.entries);
+    CHECK_EQ(opened * 2, stats.cost);
+    CHECK_EQ(capacity, stats.capacity);
+    CHECK_EQ(2u, stats.evictions);
+
+    CItem item;
+    CHECK(preloads.Take(urls[2], &item));
+    CHECK(preloads.Take(urls[3], &item));
+    CHECK(!preloads.Take(urls[0], &item));
+    CHECK(!preloads.Take(urls[1], &item));
+
+    // lowering the budget evicts at once, below a single source nothing is kept
+    preloads.Insert(urls[1], std::make_shared<int>(1), &evicted);
+    preloads.SetLimits(PLAYBACK_PRELOAD_BASE_COST - 1, 16, &evicted);
+    CHECK_EQ(3u, evicted.size());
+    CHECK_EQ(0u, preloads.Insert(urls[2], std::make_shared<int>(2), &evicted));
+    CHECK_EQ(4u, evicted.size());
+
+    stats = GetStats(preloads);
+    CHECK_EQ(0u, stats.entries);
+    CHECK_EQ(PLAYBACK_PRELOAD_BASE_COST - 1, stats.capacity);
+    CHECK_EQ(16u, stats.maxEntries);
+}
+
+TEST(PreloadCache, EntryLimit)
+{
+    CTestPreloads preloads(PLAYBACK_PRELOAD_CAPACITY, 2);
+    std::vector<CItem> evicted;
+
+    preloads.Insert(L"0.mp4", std::make_shared<int>(0), &evicted);
+    preloads.Insert(L"1.mp4", std::make_shared<int>(1), &evicted);
+    preloads.Insert(L"2.mp4", std::make_shared<int>(2), &evicted);
+    CHECK_EQ(1u, evicted.size());
+    CHECK_EQ(0, *evicted[0]);
+    CHECK_EQ(2u, GetStats(preloads).entries);
+}
+
+TEST(PreloadCache, FailedOpen)
+{
+    CTestPreloads preloads(PLAYBACK_PRELOAD_CAPACITY, PLAYBACK_PRELOAD_MAX_ENTRIES);
+    std::vector<CItem> evicted;
+
+    const uint64_t id = preloads.Insert(L"missing.mp4", std::make_shared<int>(1), &evicted);
+
+    // handed back for release, LoadContent opens the url itself
+    CItem item;
+    preloads.OnOpenFailed(id, &item);
+    CHECK(nullptr != item);
+    CHECK(!preloads.Take(L"missing.mp4", &item));
+
+    const CTestPreloads::STATS stats = GetStats(preloads);
+    CHECK_EQ(0u, stats.entries);
+    CHECK_EQ(1u, stats.failures);
+
+    // clearing hands every item back
+    preloads.Insert(L"a.mp4", std::make_shared<int>(2), &evicted);
+    std::vector<CItem> removed;
+    preloads.Clear(&removed);
+    CHECK_EQ(1u, removed.size());
+    CHECK_EQ(0u, GetStats(preloads).entries);
+}
@@ -0,0 +1,286 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "PresentationScheduler.h"
+
+#include <random>
+
+// a decoder keeping up to two frames ready, as the output ring does with three slots,
+// stamped the way the player stamps them: by a position read some time after the frame's pts
+class CSimulatedDecoder
+{
+public:
+    CSimulatedDecoder(int64_t frameDuration, int64_t maxLatency)
+        : m_frameDuration(frameDuration)
+        , m_maxLatency(maxLatency)
+        , m_nextPts(0)
+        , m_lastStamp(0)
+        , m_random(3)
+        , m_count(0)
+    {
+    }
+
+    void Decode()
+    {
+        while (m_count < 2)
+        {
+            int64_t latency = (0 == m_maxLatency) ? 0 : static_cast<int64_t>(m_random() % m_maxLatency);
+            m_lastStamp = CPresentationScheduler::OrderTimestamp(m_nextPts + latency, m_lastStamp);
+            m_frames[m_count].id = static_cast<int>(m_nextPts / m_frameDuration);
+            m_frames[m_count].pts = m_lastStamp;
+            ++m_count;
+            m_nextPts += m_frameDuration;
+        }
+    }
+
+    // the next frame decoded is at pts, as after a seek
+    void Seek(int64_t pts)
+    {
+        m_count = 0;
+        m_nextPts = pts;
+    }
+
+    // frame id shown, or -1 to keep the current one. Older frames are freed as the ring does on latch.
+    int Display(CPresentationScheduler& scheduler, int64_t clock)
+    {
+        int selected = scheduler.Select(clock, m_frames, m_count);
+        if (CPresentationScheduler::KeepCurrent == selected)
+        {
+            return -1;
+        }
+
+        const PRESENTATION_CANDIDATE shown = m_frames[selected];
+
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < m_count; ++i)
+        {
+            if (m_frames[i].pts > shown.pts)
+            {
+                m_frames[kept++] = m_frames[i];
+            }
+        }
+        m_count = kept;
+
+        return shown.id;
+    }
+
+private:
+    int64_t m_frameDuration;
+    int64_t m_maxLatency;
+    int64_t m_nextPts;
+    int64_t m_lastStamp;
+    std::mt19937 m_random;
+    PRESENTATION_CANDIDATE m_frames[2];
+    uint32_t m_count;
+};
+
+static const int64_t Display60Hz = 166667;
+static const int64_t Frame30p = 333333;
+static const int64_t Frame24p = 416667;
+
+// displays from one frame to the next shown, for the steady part of a run
+static std::vector<int> RunCadence(CPresentationScheduler& scheduler, CSimulatedDecoder& decoder, int displays)
+{
+    std::vector<int> intervals;
+    int lastShown = -1;
+    int lastDisplay = 0;
+    for (int display = 0; display < displays; ++display)
+    {
+        decoder.Decode();
+        int shown = decoder.Display(scheduler, display * Display60Hz);
+        if (shown < 0)
+        {
+            continue;
+        }
+
+        if (lastShown >= 0 && display > 60)
+        {
+            intervals.push_back(display - lastDisplay);
+        }
+        lastShown = shown;
+        lastDisplay = display;
+    }
+
+    return intervals;
+}
+
+TEST(PresentationScheduler, Cadence30pOn60Hz)
+{
+    CPresentationScheduler scheduler;
+    CSimulatedDecoder decoder(Frame30p, 0);
+
+    std::vector<int> intervals = RunCadence(scheduler, decoder, 600);
+
+    // every frame held for exactly two displays
+    CHECK(!intervals.empty());
+    for (int interval : intervals)
+    {
+        CHECK_EQ(2, interval);
+    }
+
+    CHECK_EQ(0u, scheduler.FramesDropped());
+    CHECK_EQ(0u, scheduler.FramesRepeated());
+    CHECK_EQ(0u, scheduler.Resyncs());
+}
+
+TEST(PresentationScheduler, Cadence24pOn60Hz)
+{
+    CPresentationScheduler scheduler;
+    CSimulatedDecoder decoder(Frame24p, 0);
+
+    std::vector<int> intervals = RunCadence(scheduler, decoder, 600);
+
+    // 3:2 pulldown, never two equal holds in a row
+    CHECK(intervals.size() > 2);
+    for (size_t i = 0; i < intervals.size(); ++i)
+    {
+        CHECK(2 == intervals[i] || 3 == intervals[i]);
+        CHECK(0 == i || intervals[i] != intervals[i - 1]);
+    }
+
+    CHECK_EQ(0u, scheduler.FramesDropped());
+    CHECK_EQ(0u, scheduler.Resyncs());
+}
+
+// stamps trail the pts by up to 8ms of callback latency, no frame may be lost to it
+TEST(PresentationScheduler, PositionJitter)
+{
+    CPresentationScheduler scheduler;
+    CSimulatedDecoder decoder(Frame30p, 80000);
+
+    std::vector<int> intervals = RunCadence(scheduler, decoder, 1200);
+
+    CHECK(!intervals.empty());
+    for (int interval : intervals)
+    {
+        CHECK(interval >= 1 && interval <= 3);
+    }
+
+    CHECK_EQ(0u, scheduler.FramesDropped());
+    CHECK_EQ(0u, scheduler.FramesRepeated());
+    CHECK_EQ(0u, scheduler.Resyncs());
+}
+
+TEST(PresentationScheduler, DecoderStallResyncs)
+{
+    CPresentationScheduler scheduler;
+    CSimulatedDecoder decoder(Frame30p, 0);
+
+    int display = 0;
+    for (; display < 100; ++display)
+    {
+        decoder.Decode();
+        decoder.Display(scheduler, display * Display60Hz);
+    }
+
+    // nothing decoded for half a second, then frames carry on where they stopped
+    for (; display < 130; ++display)
+    {
+        decoder.Display(scheduler, display * Display60Hz);
+    }
+
+    int shownAfterStall = 0;
+    for (; display < 200; ++display)
+    {
+        decoder.Decode();
+        shownAfterStall += (decoder.Display(scheduler, display * Display60Hz) >= 0) ? 1 : 0;
+    }
+
+    // re-anchored once instead of racing through the backlog
+    CHECK_EQ(1u, scheduler.Resyncs());
+    CHECK(shownAfterStall >= 30);
+    CHECK_EQ(0u, scheduler.FramesDropped());
+}
+
+TEST(PresentationScheduler, SeekResyncs)
+{
+    CPresentationScheduler scheduler;
+    CSimulatedDecoder decoder(Frame30p, 0);
+
+    int display = 0;
+    for (; display < 100; ++display)
+    {
+        decoder.Decode();
+        decoder.Display(scheduler, display * Display60Hz);
+    }
+
+    // forward a minute, then back to the start
+    decoder.Seek(600000000);
+    for (; display < 200; ++display)
+    {
+        decoder.Decode();
+        decoder.Display(scheduler, display * Display60Hz);
+    }
+    CHECK_EQ(1u, scheduler.Resyncs());
+
+    decoder.Seek(0);
+    int firstShown = -1;
+    for (; display < 300; ++display)
+    {
+        decoder.Decode();
+        int shown = decoder.Display(scheduler, display * Display60Hz);
+        firstShown = (firstShown < 0) ? shown : firstShown;
+    }
+    CHECK_EQ(2u, scheduler.Resyncs());
+    CHECK_EQ(0, firstShown);
+}
+
+TEST(PresentationScheduler, BackwardsBeyondJitterResyncs)
+{
+    CPresentationScheduler scheduler;
+
+    PRESENTATION_CANDIDATE frame = { 0, 10000000 };
+    CHECK_EQ(0, scheduler.Select(0, &frame, 1));
+
+    // a stamp a little older than the one on screen is jitter, skipped
+    frame.pts = 10000000 - CPresentationScheduler::JitterTolerance / 2;
+    CHECK_EQ(CPresentationScheduler::KeepCurrent, scheduler.Select(Display60Hz, &frame, 1));
+    CHECK_EQ(0u, scheduler.Resyncs());
+
+    // 100ms back is a seek, even though it is within the resync threshold
+    frame.pts = 10000000 - 1000000;
+    CHECK_EQ(0, scheduler.Select(2 * Display60Hz, &frame, 1));
+    CHECK_EQ(1u, scheduler.Resyncs());
+}
+
+TEST(PresentationScheduler, OrderTimestamp)
+{
+    const int64_t previous = 50000000;
+
+    CHECK_EQ(previous + 10, CPresentationScheduler::OrderTimestamp(previous + 10, previous));
+    CHECK_EQ(previous + 1, CPresentationScheduler::OrderTimestamp(previous, previous));
+    CHECK_EQ(previous + 1, CPresentationScheduler::OrderTimestamp(previous - 50000, previous));
+
+    // beyond jitter it is a seek back and kept
+    CHECK_EQ(previous - CPresentationScheduler::JitterTolerance, CPresentationScheduler::OrderTimestamp(previous - CPresentationScheduler::JitterTolerance, previous));
+    CHECK_EQ(0, CPresentationScheduler::OrderTimestamp(0, previous));
+}
+
+TEST(PresentationScheduler, DoubleRate)
+{
+    CPresentationScheduler scheduler;
+    scheduler.SetRate(2.0);
+    CSimulatedDecoder decoder(Frame30p, 0);
+
+    std::vector<int> intervals = RunCadence(scheduler, decoder, 600);
+
+    // 60 frames a second of content on 60Hz, a new frame every display
+    CHECK(!intervals.empty());
+    for (int interval : intervals)
+    {
+        CHECK_EQ(1, interval);
+    }
+
+    CHECK_EQ(0u, scheduler.FramesDropped());
+    CHECK_EQ(0u, scheduler.Resyncs());
+}
@@ -0,0 +1,394 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "ReadAheadBuffer.h"
+
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+
+static const uint64_t s_fileSize = 16 * 1024 * 1024;
+
+static uint8_t ExpectedByte(uint64_t offset)
+{
+    return static_cast<uint8_t>((offset * 2654435761u) >> 13);
+}
+
+static bool IsExpected(uint64_t offset, const uint8_t* pData, size_t size)
+{
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (ExpectedByte(offset + i) != pData[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// a temporary file of s_fileSize bytes, shared by the tests and gone at exit
+class CTestFile
+{
+public:
+    static CTestFile& Get()
+    {
+        static CTestFile s_file;
+        return s_file;
+    }
+
+    bool ReadAt(uint64_t offset, void* pBuffer, size_t size, size_t* pRead)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (nullptr == m_pFile || 0 != fseek(m_pFile, static_cast<long>(offset), SEEK_SET))
+        {
+            return false;
+        }
+
+        *pRead = fread(pBuffer, 1, size, m_pFile);
+        return 0 == ferror(m_pFile);
+    }
+
+private:
+    CTestFile()
+        : m_pFile(tmpfile())
+    {
+        std::vector<uint8_t> chunk(1024 * 1024);
+        for (uint64_t offset = 0; nullptr != m_pFile && offset < s_fileSize; offset += chunk.size())
+        {
+            for (size_t i = 0; i < chunk.size(); ++i)
+            {
+                chunk[i] = ExpectedByte(offset + i);
+            }
+            fwrite(chunk.data(), 1, chunk.size(), m_pFile);
+        }
+    }
+
+    ~CTestFile()
+    {
+        if (nullptr != m_pFile)
+        {
+            fclose(m_pFile);
+        }
+    }
+
+    std::mutex m_lock;
+    FILE* m_pFile;
+};
+
+// the test file behind a slow disk: a latency per request plus a bandwidth,
+// optionally one stall or failing from an offset on
+class CThrottledSource : public IReadAheadSource
+{
+public:
+    CThrottledSource(uint32_t latencyUs, uint32_t megabytesPerSecond)
+        : m_latencyUs(latencyUs)
+        , m_megabytesPerSecond(megabytesPerSecond)
+        , m_stallOffset(UINT64_MAX)
+        , m_stallMs(0)
+        , m_failOffset(UINT64_MAX)
+        , m_reads(0)
+    {
+    }
+
+    // the first read at or past offset takes ms longer
+    void StallAt(uint64_t offset, uint32_t ms)
+    {
+        m_stallOffset = offset;
+        m_stallMs = ms;
+    }
+
+    void FailFrom(uint64_t offset)
+    {
+        m_failOffset = offset;
+    }
+
+    uint32_t Reads() const
+    {
+        return m_reads.load();
+    }
+
+    bool ReadAt(uint64_t offset, void* pBuffer, size_t size, size_t* pRead) override
+    {
+        ++m_reads;
+
+        uint64_t delayUs = m_latencyUs + size / m_megabytesPerSecond;
+        if (offset >= m_stallOffset.load())
+        {
+            m_stallOffset = UINT64_MAX;
+            delayUs += m_stallMs * 1000ull;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+
+        if (offset + size > m_failOffset)
+        {
+            return false;
+        }
+
+        return CTestFile::Get().ReadAt(offset, pBuffer, size, pRead);
+    }
+
+private:
+    const uint32_t m_latencyUs;
+    const uint32_t m_megabytesPerSecond;
+    std::atomic<uint64_t> m_stallOffset;
+    uint32_t m_stallMs;
+    uint64_t m_failOffset;
+    std::atomic<uint32_t> m_reads;
+};
+
+static void StartBuffer(CReadAheadBuffer* pBuffer, CThrottledSource* pSource, uint64_t window, const std::shared_ptr<CReadAheadCounters>& spCounters)
+{
+    CHECK(pBuffer->Start(std::unique_ptr<IReadAheadSource>(pSource), s_fileSize, window, spCounters));
+}
+
+TEST(ReadAheadBuffer, SequentialReadsMatchTheFile)
+{
+    // odd sized reads through a file four windows long wrap the ring at every offset
+    auto spCounters = std::make_shared<CReadAheadCounters>();
+    CReadAheadBuffer buffer;
+    StartBuffer(&buffer, new CThrottledSource(200, 500), READ_AHEAD_MIN_WINDOW, spCounters);
+    CHECK_EQ(s_fileSize, buffer.GetSize());
+
+    std::vector<uint8_t> data(100003);
+    uint64_t offset = 0;
+    for (;;)
+    {
+        size_t read = 0;
+        CHECK(buffer.Read(offset, data.data(), data.size(), &read));
+        if (0 == read)
+        {
+            break;
+        }
+
+        CHECK(IsExpected(offset, data.data(), read));
+        offset += read;
+    }
+    CHECK_EQ(s_fileSize, offset);
+
+    CReadAheadCounters::SNAPSHOT snapshot;
+    spCounters->Snapshot(&snapshot, false);
+    CHECK_EQ(s_fileSize, snapshot.bytesRead);
+    CHECK_EQ(s_fileSize, snapshot.bytesPrefetched);
+    CHECK_EQ(0u, snapshot.seeks);
+    CHECK_EQ(0u, snapshot.readErrors);
+}
+
+TEST(ReadAheadBuffer, SeeksReadTheRightBytes)
+{
+    auto spCounters = std::make_shared<CReadAheadCounters>();
+    CReadAheadBuffer buffer;
+    StartBuffer(&buffer, new CThrottledSource(200, 500), READ_AHEAD_MIN_WINDOW, spCounters);
+
+    // demuxer like: mostly on from the last read, some steps back into what is
+    // kept behind, some jumps anywhere
+    std::mt19937 random(11);
+    std::vector<uint8_t> data(256 * 1024);
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < 300; ++i)
+    {
+        const uint32_t kind = random() % 10;
+        if (kind == 0)
+        {
+            offset = random() % s_fileSize;
+        }
+        else if (kind == 1)
+        {
+            offset -= (offset < 65536) ? offset : random() % 65536;
+        }
+
+        const size_t size = 1 + random() % data.size();
+        size_t read = 0;
+        CHECK(buffer.Read(offset, data.data(), size, &read));
+        CHECK(IsExpected(offset, data.data(), read));
+        CHECK(read <= size);
+        CHECK((read > 0) || (offset + size > s_fileSize));
+
+        offset = (offset + read < s_fileSize) ? offset + read : 0;
+    }
+
+    CReadAheadCounters::SNAPSHOT snapshot;
+    spCounters->Snapshot(&snapshot, false);
+    CHECK(snapshot.seeks > 0);
+    CHECK_EQ(0u, snapshot.readErrors);
+}
+
+TEST(ReadAheadBuffer, EndOfFile)
+{
+    auto spCounters = std::make_shared<CReadAheadCounters>();
+    CReadAheadBuffer buffer;
+    StartBuffer(&buffer, new CThrottledSource(0, 1000), READ_AHEAD_MIN_WINDOW, spCounters);
+
+    // a read across the end is cut short, one at it reads nothing
+    uint8_t data[1000];
+    size_t read = 1;
+    CHECK(buffer.Read(s_fileSize - 100, data, sizeof(data), &read));
+    CHECK_EQ(100u, read);
+    CHECK(IsExpected(s_fileSize - 100, data, read));
+
+    CHECK(buffer.Read(s_fileSize, data, sizeof(data), &read));
+    CHECK_EQ(0u, read);
+    CHECK(buffer.Read(s_fileSize + 5, data, sizeof(data), &read));
+    CHECK_EQ(0u, read);
+}
+
+TEST(ReadAheadBuffer, StallIsAbsorbed)
+{
+    // 8 mb/s played from a 50 mb/s disk that stalls for 150ms past 6 mb. At the
+    // low watermark half the window, 250ms of playback, is still ahead.
+    const uint32_t stallMs = 150;
+    CThrottledSource* pSource = new CThrottledSource(2000, 50);
+    pSource->StallAt(6 * 1024 * 1024, stallMs);
+
+    auto spCounters = std::make_shared<CReadAheadCounters>();
+    CReadAheadBuffer buffer;
+    StartBuffer(&buffer, pSource, READ_AHEAD_MIN_WINDOW, spCounters);
+
+    // preroll, as the player does before it starts
+    CReadAheadBuffer::OCCUPANCY occupancy = {};
+    const double prerollStart = BenchmarkNow();
+    do
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        buffer.GetOccupancy(&occupancy);
+    } while (occupancy.ahead < occupancy.window * 3 / 4 && BenchmarkNow() - prerollStart < 10.0);
+    CHECK_EQ(static_cast<uint64_t>(READ_AHEAD_MIN_WINDOW), occupancy.window);
+
+    std::vector<uint8_t> data(64 * 1024);
+    double slowest = 0.0;
+    for (uint64_t offset = 0; offset < 10 * 1024 * 1024; )
+    {
+        size_t read = 0;
+        const double readStart = BenchmarkNow();
+        CHECK(buffer.Read(offset, data.data(), data.size(), &read));
+        const double elapsed = BenchmarkNow() - readStart;
+        slowest = (elapsed > slowest) ? elapsed : slowest;
+
+        CHECK(IsExpected(offset, data.data(), read));
+        offset += read;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(8));
+    }
+
+    CReadAheadCounters::SNAPSHOT snapshot;
+    spCounters->Snapshot(&snapshot, false);
+    printf("slowest read %.2f ms, %llu underruns, %u source reads\n",
+        slowest * 1000.0, static_cast<unsigned long long>(snapshot.underrun.count), pSource->Reads());
+
+    CHECK(slowest < stallMs / 2 / 1000.0);
+    CHECK_EQ(0u, snapshot.underrun.count);
+}
+
+TEST(ReadAheadBuffer, ReadErrorFailsUntilSeek)
+{
+    const uint64_t failOffset = 2 * 1024 * 1024;
+    CThrottledSource* pSource = new CThrottledSource(0, 1000);
+    pSource->FailFrom(failOffset);
+
+    auto spCounters = std::make_shared<CReadAheadCounters>();
+    CReadAheadBuffer buffer;
+    StartBuffer(&buffer, pSource, READ_AHEAD_MIN_WINDOW, spCounters);
+
+    // reads succeed up to where the prefetch thread failed, then fail there
+    std::vector<uint8_t> data(64 * 1024);
+    uint64_t offset = 0;
+    size_t read = 0;
+    while (buffer.Read(offset, data.data(), data.size(), &read))
+    {
+        CHECK(read > 0);
+        CHECK(IsExpected(offset, data.data(), read));
+        offset += read;
+        CHECK(offset <= failOffset);
+    }
+    CHECK(offset < failOffset);
+    CHECK_EQ(0u, read);
+
+    CReadAheadCounters::SNAPSHOT snapshot;
+    spCounters->Snapshot(&snapshot, false);
+    CHECK(snapshot.readErrors > 0);
+
+    // a seek back before the range starts over from there
+    CHECK(buffer.Read(0, data.data(), data.size(), &read));
+    CHECK_EQ(data.size(), read);
+    CHECK(IsExpected(0, data.data(), read));
+}
+
+TEST(ReadAheadBuffer, StopWakesWaitingReader)
+{
+    // every source read takes 300ms, the first read waits on the prefetch thread
+    auto spCounters = std::make_shared<CReadAheadCounters>();
+    CReadAheadBuffer buffer;
+    StartBuffer(&buffer, new CThrottledSource(300000, 1000), READ_AHEAD_MIN_WINDOW, spCounters);
+
+    std::atomic<bool> done(false);
+    bool succeeded = true;
+    std::thread reader([&]()
+    {
+        uint8_t data[4096];
+        size_t read = 0;
+        succeeded = buffer.Read(0, data, sizeof(data), &read);
+        done = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!done);
+
+    buffer.Stop();
+    reader.join();
+    CHECK(!succeeded);
+
+    uint8_t data[16];
+    size_t read = 1;
+    CHECK(!buffer.Read(0, data, sizeof(data), &read));
+    CHECK_EQ(0u, read);
+}
+
+TEST(ReadAheadBuffer, SetWindowKeepsBufferedBytes)
+{
+    CThrottledSource* pSource = new CThrottledSource(200, 500);
+    auto spCounters = std::make_shared<CReadAheadCounters>();
+    CReadAheadBuffer buffer;
+    StartBuffer(&buffer, pSource, 8 * 1024 * 1024, spCounters);
+
+    const uint64_t windows[] = { READ_AHEAD_MIN_WINDOW, 12 * 1024 * 1024, 1, READ_AHEAD_MIN_WINDOW + 12345 };
+
+    std::vector<uint8_t> data(77777);
+    uint64_t offset = 0;
+    for (uint32_t round = 0; round < 4; ++round)
+    {
+        for (uint32_t i = 0; i < 40; ++i)
+        {
+            size_t read = 0;
+            CHECK(buffer.Read(offset, data.data(), data.size(), &read));
+            CHECK(read > 0);
+            CHECK(IsExpected(offset, data.data(), read));
+            offset += read;
+        }
+
+        // windows below the minimum are raised to it
+        buffer.SetWindow(windows[round]);
+
+        CReadAheadBuffer::OCCUPANCY occupancy = {};
+        buffer.GetOccupancy(&occupancy);
+        CHECK_EQ((windows[round] < READ_AHEAD_MIN_WINDOW) ? READ_AHEAD_MIN_WINDOW : windows[round], occupancy.window);
+        CHECK(occupancy.ahead <= occupancy.window);
+    }
+
+    // reads carried on in the kept range, none of them were seeks
+    CReadAheadCounters::SNAPSHOT snapshot;
+    spCounters->Snapshot(&snapshot, false);
+    CHECK_EQ(0u, snapshot.seeks);
+    CHECK_EQ(offset, snapshot.bytesRead);
+}
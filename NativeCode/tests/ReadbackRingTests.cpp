@@ -0,0 +1,323 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "ReadbackRing.h"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+// stands in for the staging textures: a copy writes the source's timestamp into the
+// slot's memory and finishes when the test says so, misuse is counted
+class CFakeReadbackDevice : public IReadbackDevice
+{
+public:
+    CFakeReadbackDevice()
+        : m_finished()
+        , m_mapped()
+        , m_memory()
+        , m_errors(0)
+    {
+        FinishAll();
+    }
+
+    bool CopyToSlot(uint32_t slot, void* pSource) override
+    {
+        // the ring never copies into memory that is still mapped
+        if (m_mapped[slot])
+        {
+            ++m_errors;
+        }
+
+        m_finished[slot] = m_finishImmediately.load();
+        memcpy(m_memory[slot], pSource, sizeof(int64_t));
+
+        return true;
+    }
+
+    MapResult MapSlot(uint32_t slot, READBACK_MAPPING* pMapping) override
+    {
+        if (!m_finished[slot])
+        {
+            return MapResult::StillDrawing;
+        }
+
+        if (m_mapped[slot])
+        {
+            ++m_errors;
+        }
+
+        m_mapped[slot] = true;
+        pMapping->pData = m_memory[slot];
+        pMapping->rowPitch = sizeof(m_memory[slot]);
+
+        return MapResult::Mapped;
+    }
+
+    void UnmapSlot(uint32_t slot) override
+    {
+        if (!m_mapped[slot])
+        {
+            ++m_errors;
+        }
+
+        m_mapped[slot] = false;
+    }
+
+    void Finish(uint32_t slot)
+    {
+        m_finished[slot] = true;
+    }
+
+    void FinishAll()
+    {
+        for (uint32_t i = 0; i < CReadbackRing::MaxSlots; ++i)
+        {
+            m_finished[i] = true;
+        }
+    }
+
+    void HoldCopies(bool hold)
+    {
+        m_finishImmediately = !hold;
+    }
+
+    uint32_t MappedCount() const
+    {
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < CReadbackRing::MaxSlots; ++i)
+        {
+            count += m_mapped[i] ? 1 : 0;
+        }
+
+        return count;
+    }
+
+    uint32_t Errors() const
+    {
+        return m_errors;
+    }
+
+private:
+    bool m_finished[CReadbackRing::MaxSlots];
+    bool m_mapped[CReadbackRing::MaxSlots];
+    uint8_t m_memory[CReadbackRing::MaxSlots][16];
+    std::atomic<bool> m_finishImmediately{ false };
+    uint32_t m_errors;
+};
+
+static bool SubmitFrame(CReadbackRing& ring, int64_t timestamp)
+{
+    return ring.Submit(&timestamp, timestamp);
+}
+
+static int64_t FrameContent(const READBACK_FRAME& frame)
+{
+    int64_t content = 0;
+    memcpy(&content, frame.pData, sizeof(content));
+    return content;
+}
+
+TEST(ReadbackRing, MapsOnceCopyFinished)
+{
+    CFakeReadbackDevice device;
+    device.HoldCopies(true);
+
+    CReadbackRing ring;
+    ring.Reset(&device, 3);
+
+    READBACK_FRAME frame;
+    CHECK(SubmitFrame(ring, 10));
+    CHECK(!ring.Poll());
+    CHECK(!ring.Acquire(&frame));
+
+    device.Finish(0);
+    CHECK(ring.Poll());
+    CHECK(ring.Acquire(&frame));
+    CHECK_EQ(10, frame.timestamp);
+    CHECK_EQ(10, FrameContent(frame));
+
+    // nothing newer
+    READBACK_FRAME other;
+    CHECK(!ring.Acquire(&other));
+
+    CHECK(ring.Release(frame.frameId));
+    CHECK(!ring.Release(frame.frameId));
+
+    // unmapped on the render thread's next poll
+    CHECK_EQ(1u, device.MappedCount());
+    ring.Poll();
+    CHECK_EQ(0u, device.MappedCount());
+    CHECK_EQ(0u, device.Errors());
+}
+
+TEST(ReadbackRing, OverwritesOldestWhileGpuBusy)
+{
+    CFakeReadbackDevice device;
+    device.HoldCopies(true);
+
+    CReadbackRing ring;
+    ring.Reset(&device, 3);
+
+    CHECK(SubmitFrame(ring, 10));
+    device.Finish(0);
+    ring.Poll();
+
+    READBACK_FRAME held;
+    CHECK(ring.Acquire(&held));
+
+    // two free slots, the third submit goes over the oldest copy in flight
+    CHECK(SubmitFrame(ring, 20));
+    CHECK(SubmitFrame(ring, 30));
+    CHECK(SubmitFrame(ring, 40));
+    CHECK_EQ(1u, ring.FramesSkipped());
+
+    device.FinishAll();
+    CHECK(ring.Poll());
+
+    READBACK_FRAME newest;
+    CHECK(ring.Acquire(&newest));
+    CHECK_EQ(40, newest.timestamp);
+    CHECK_EQ(40, FrameContent(newest));
+
+    // the held frame was never touched
+    CHECK_EQ(10, FrameContent(held));
+
+    CHECK(ring.Release(held.frameId));
+    CHECK(ring.Release(newest.frameId));
+    ring.Poll();
+    CHECK_EQ(0u, device.MappedCount());
+    CHECK_EQ(0u, device.Errors());
+}
+
+TEST(ReadbackRing, SkipsStaleFrames)
+{
+    CFakeReadbackDevice device;
+    device.HoldCopies(true);
+
+    CReadbackRing ring;
+    ring.Reset(&device, 3);
+
+    CHECK(SubmitFrame(ring, 50));
+    CHECK(SubmitFrame(ring, 60));
+    device.FinishAll();
+    CHECK(ring.Poll());
+
+    READBACK_FRAME frame;
+    CHECK(ring.Acquire(&frame));
+    CHECK_EQ(60, frame.timestamp);
+    CHECK_EQ(1u, ring.FramesSkipped());
+
+    READBACK_FRAME other;
+    CHECK(!ring.Acquire(&other));
+
+    // reset unmaps the held frame too
+    ring.Reset(nullptr, 3);
+    CHECK_EQ(0u, device.MappedCount());
+    CHECK_EQ(0u, device.Errors());
+
+    // a late release after reset is ignored
+    CHECK(!ring.Release(frame.frameId));
+    CHECK(!SubmitFrame(ring, 70));
+}
+
+TEST(ReadbackRing, ClientHoldingEverySlot)
+{
+    CFakeReadbackDevice device;
+    device.HoldCopies(false);
+
+    CReadbackRing ring;
+    ring.Reset(&device, 2);
+
+    READBACK_FRAME frames[2];
+    for (int64_t i = 0; i < 2; ++i)
+    {
+        CHECK(SubmitFrame(ring, i));
+        CHECK(ring.Poll());
+        CHECK(ring.Acquire(&frames[i]));
+    }
+
+    // nowhere to copy to, the frame is skipped rather than waiting
+    CHECK(!SubmitFrame(ring, 2));
+    CHECK_EQ(1u, ring.FramesSkipped());
+
+    CHECK(ring.Release(frames[0].frameId));
+    ring.Poll();
+    CHECK(SubmitFrame(ring, 3));
+    CHECK_EQ(0u, device.Errors());
+}
+
+// render thread submits and polls, a client thread acquires and reads
+TEST(ReadbackRing, RenderAndClientThreads)
+{
+    const int64_t frameCount = 50000;
+
+    CFakeReadbackDevice device;
+    device.HoldCopies(false);
+
+    CReadbackRing ring;
+    ring.Reset(&device, 3);
+
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> contentErrors(0);
+    std::atomic<uint64_t> framesRead(0);
+
+    std::thread client([&]()
+    {
+        int64_t last = -1;
+        for (;;)
+        {
+            bool finished = done;
+
+            READBACK_FRAME frame;
+            if (!ring.Acquire(&frame))
+            {
+                if (finished)
+                {
+                    break;
+                }
+
+                std::this_thread::yield();
+                continue;
+            }
+
+            // the mapped memory still holds the frame it was acquired as, and frames only move forward
+            if (FrameContent(frame) != frame.timestamp || frame.timestamp <= last)
+            {
+                ++contentErrors;
+            }
+            last = frame.timestamp;
+            ++framesRead;
+
+            ring.Release(frame.frameId);
+        }
+    });
+
+    for (int64_t timestamp = 0; timestamp < frameCount; ++timestamp)
+    {
+        SubmitFrame(ring, timestamp);
+        ring.Poll();
+    }
+
+    done = true;
+    client.join();
+
+    // the render thread unmaps the last released frame
+    ring.Poll();
+
+    CHECK_EQ(0u, contentErrors.load());
+    CHECK_EQ(0u, device.Errors());
+    CHECK_EQ(0u, device.MappedCount());
+    CHECK(framesRead.load() > 0);
+    CHECK_EQ(framesRead.load(), ring.FramesRead());
+}
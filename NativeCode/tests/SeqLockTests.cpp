@@ -0,0 +1,125 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "SeqLock.h"
+
+#include <atomic>
+#include <thread>
+
+// packed like PLAYBACK_STATUS, fields that are only consistent with each other
+#pragma pack(push, 4)
+struct TEST_STATUS
+{
+    uint32_t counter;
+    int64_t negated;
+    double half;
+    uint32_t tripled;
+};
+#pragma pack(pop)
+
+static bool IsConsistent(const TEST_STATUS& status)
+{
+    return status.negated == -static_cast<int64_t>(status.counter)
+        && status.half == status.counter * 0.5
+        && status.tripled == status.counter * 3;
+}
+
+TEST(SeqLock, ReadsLatestUpdate)
+{
+    CSeqLock<TEST_STATUS> status;
+
+    TEST_STATUS value;
+    uint32_t version = 1;
+    CHECK(status.TryRead(&value, &version));
+    CHECK_EQ(0u, version);
+    CHECK_EQ(0u, value.counter);
+
+    status.Update([](TEST_STATUS& s) { s.counter = 7; s.negated = -7; });
+    status.Update([](TEST_STATUS& s) { s.half = 3.5; s.tripled = 21; });
+
+    // updates edit the record in place, fields not touched keep their value
+    status.Read(&value, &version);
+    CHECK_EQ(2u, version);
+    CHECK(IsConsistent(value));
+}
+
+// writers on several threads, readers must only ever see whole records and versions that never go back
+TEST(SeqLock, ConcurrentWritersAndReaders)
+{
+    const uint32_t writerCount = 4;
+    const uint32_t updates = 50000;
+
+    CSeqLock<TEST_STATUS> status;
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> errors(0);
+    std::atomic<uint64_t> reads(0);
+
+    std::vector<std::thread> readers;
+    for (uint32_t r = 0; r < 2; ++r)
+    {
+        readers.emplace_back([&]()
+        {
+            uint32_t lastVersion = 0;
+            while (!stop.load())
+            {
+                TEST_STATUS value;
+                uint32_t version = 0;
+                status.Read(&value, &version);
+                if (!IsConsistent(value) || version < lastVersion)
+                {
+                    ++errors;
+                }
+                lastVersion = version;
+                ++reads;
+            }
+        });
+    }
+
+    std::vector<std::thread> writers;
+    for (uint32_t w = 0; w < writerCount; ++w)
+    {
+        writers.emplace_back([&]()
+        {
+            for (uint32_t i = 1; i <= updates; ++i)
+            {
+                status.Update([i](TEST_STATUS& s)
+                {
+                    s.counter = i;
+                    s.negated = -static_cast<int64_t>(i);
+                    s.half = i * 0.5;
+                    s.tripled = i * 3;
+                });
+            }
+        });
+    }
+
+    for (auto& writer : writers)
+    {
+        writer.join();
+    }
+
+    stop = true;
+    for (auto& reader : readers)
+    {
+        reader.join();
+    }
+
+    TEST_STATUS value;
+    uint32_t version = 0;
+    status.Read(&value, &version);
+
+    CHECK_EQ(0u, errors.load());
+    CHECK(reads.load() > 0);
+    CHECK_EQ(writerCount * updates, version);
+    CHECK(IsConsistent(value));
+}
@@ -0,0 +1,83 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+// portable, std only - no windows headers
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Tests and benchmarks of the portable parts of the plugin, see CMakeLists.txt.
+// A TEST fails on its first failed CHECK, a BENCHMARK prints its own numbers.
+
+typedef void(*TestFunction)();
+
+struct TEST_ENTRY
+{
+    const char* suite;
+    const char* name;
+    TestFunction function;
+};
+
+std::vector<TEST_ENTRY>& GetTests();
+std::vector<TEST_ENTRY>& GetBenchmarks();
+
+struct CTestRegistration
+{
+    CTestRegistration(std::vector<TEST_ENTRY>& entries, const char* suite, const char* name, TestFunction function)
+    {
+        entries.push_back({ suite, name, function });
+    }
+};
+
+// thrown by CHECK, caught by the runner
+struct TEST_FAILURE
+{
+    const char* expression;
+    const char* file;
+    int line;
+};
+
+[[noreturn]] inline void FailCheck(const char* expression, const char* file, int line)
+{
+    throw TEST_FAILURE{ expression, file, line };
+}
+
+#define TEST(Suite, Name) \
+    static void Suite##_##Name(); \
+    static CTestRegistration s_test##Suite##_##Name(GetTests(), #Suite, #Name, &Suite##_##Name); \
+    static void Suite##_##Name()
+
+#define BENCHMARK(Suite, Name) \
+    static void Suite##_##Name(); \
+    static CTestRegistration s_benchmark##Suite##_##Name(GetBenchmarks(), #Suite, #Name, &Suite##_##Name); \
+    static void Suite##_##Name()
+
+#define CHECK(expression) \
+    do { if (!(expression)) FailCheck(#expression, __FILE__, __LINE__); } while (false)
+
+#define CHECK_EQ(expected, actual) CHECK((expected) == (actual))
+
+// seconds on a monotonic clock, for benchmarks
+inline double BenchmarkNow()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// keeps the optimizer from dropping work whose result is otherwise unused
+template <typename T>
+inline void BenchmarkKeep(const T& value)
+{
+    static volatile uint8_t s_sink;
+    s_sink = s_sink ^ static_cast<uint8_t>(sizeof(value) + reinterpret_cast<const volatile uint8_t*>(&value)[0]);
+}
@@ -0,0 +1,74 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include <cstring>
+
+std::vector<TEST_ENTRY>& GetTests()
+{
+    static std::vector<TEST_ENTRY> s_tests;
+    return s_tests;
+}
+
+std::vector<TEST_ENTRY>& GetBenchmarks()
+{
+    static std::vector<TEST_ENTRY> s_benchmarks;
+    return s_benchmarks;
+}
+
+// NativeTests [suite], NativeBench [suite]. Every suite runs when none is given.
+int main(int argc, char** argv)
+{
+#if defined(NATIVE_BENCH)
+    const std::vector<TEST_ENTRY>& entries = GetBenchmarks();
+#else
+    const std::vector<TEST_ENTRY>& entries = GetTests();
+#endif
+    const char* suite = (argc > 1) ? argv[1] : nullptr;
+
+    int run = 0;
+    int failed = 0;
+    for (const TEST_ENTRY& entry : entries)
+    {
+        if (nullptr != suite && 0 != strcmp(suite, entry.suite))
+        {
+            continue;
+        }
+
+        ++run;
+        printf("[ RUN    ] %s.%s\n", entry.suite, entry.name);
+        fflush(stdout);
+
+        try
+        {
+            entry.function();
+            printf("[     OK ] %s.%s\n", entry.suite, entry.name);
+        }
+        catch (const TEST_FAILURE& failure)
+        {
+            ++failed;
+            printf("%s(%d): CHECK(%s) failed\n", failure.file, failure.line, failure.expression);
+            printf("[ FAILED ] %s.%s\n", entry.suite, entry.name);
+        }
+        fflush(stdout);
+    }
+
+    if (0 == run)
+    {
+        printf("no %s in suite %s\n", (&entries == &GetTests()) ? "tests" : "benchmarks", (nullptr != suite) ? suite : "(all)");
+        return 1;
+    }
+
+    printf("%d run, %d failed\n", run, failed);
+
+    return (0 == failed) ? 0 : 1;
+}
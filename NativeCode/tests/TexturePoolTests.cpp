@@ -0,0 +1,292 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "TexturePool.h"
+
+#include <algorithm>
+#include <thread>
+
+// sets are numbered in the order they were allocated, from 1
+class CCountingAllocator : public ITexturePoolAllocator<uint32_t>
+{
+public:
+    CCountingAllocator()
+        : m_allocated(0)
+        , m_failing(false)
+    {
+    }
+
+    bool Allocate(const TEXTURE_POOL_KEY&, uint32_t* pValue) override
+    {
+        if (m_failing)
+        {
+            return false;
+        }
+
+        *pValue = ++m_allocated;
+
+        return true;
+    }
+
+    uint32_t Allocated() const
+    {
+        return m_allocated;
+    }
+
+    void SetFailing(bool failing)
+    {
+        m_failing = failing;
+    }
+
+private:
+    std::atomic<uint32_t> m_allocated;
+    bool m_failing;
+};
+
+// stand ins for two devices, only their addresses are used
+static int s_devices[2];
+
+static TEXTURE_POOL_KEY MakeKey(uint32_t width, uint32_t height)
+{
+    TEXTURE_POOL_KEY key = {};
+    key.pDevice = &s_devices[0];
+    key.width = width;
+    key.height = height;
+    key.format = 87;            // DXGI_FORMAT_B8G8R8A8_UNORM
+    key.bindFlags = 0x28;       // shader resource | render target
+
+    return key;
+}
+
+static int64_t SizeOf(const TEXTURE_POOL_KEY& key)
+{
+    return static_cast<int64_t>(key.width) * key.height * 4;
+}
+
+TEST(TexturePool, ReleasedSetsGoBackOutForTheirKey)
+{
+    CTexturePool<uint32_t> pool(64 * 1024 * 1024);
+    CCountingAllocator allocator;
+    std::vector<uint32_t> evicted;
+
+    const TEXTURE_POOL_KEY key = MakeKey(1920, 1080);
+    uint32_t set = 0;
+    CHECK(pool.Acquire(key, &allocator, &set));
+    CHECK_EQ(1u, set);
+    pool.Release(key, set, SizeOf(key), &evicted);
+
+    // every field of the key counts
+    TEXTURE_POOL_KEY others[6] = { key, key, key, key, key, key };
+    others[0].pDevice = &s_devices[1];
+    others[1].pSharedDevice = &s_devices[1];
+    others[2].width = 1280;
+    others[3].height = 720;
+    others[4].format = 28;
+    others[5].bindFlags = 0x8;
+    for (const TEXTURE_POOL_KEY& other : others)
+    {
+        uint32_t otherSet = 0;
+        CHECK(pool.Acquire(other, &allocator, &otherSet));
+        CHECK(1u != otherSet);
+    }
+
+    CHECK(pool.Acquire(key, &allocator, &set));
+    CHECK_EQ(1u, set);
+    CHECK_EQ(7u, allocator.Allocated());
+
+    const CTexturePool<uint32_t>::STATS stats = pool.GetStats();
+    CHECK_EQ(0u, stats.entries);
+    CHECK_EQ(0, stats.bytes);
+    CHECK_EQ(1u, stats.hits);
+    CHECK_EQ(7u, stats.misses);
+    CHECK(evicted.empty());
+}
+
+TEST(TexturePool, MostRecentlyReleasedFirst)
+{
+    CTexturePool<uint32_t> pool(64 * 1024 * 1024);
+    CCountingAllocator allocator;
+    std::vector<uint32_t> evicted;
+
+    const TEXTURE_POOL_KEY key = MakeKey(640, 360);
+    for (uint32_t set = 1; set <= 3; ++set)
+    {
+        pool.Release(key, set, SizeOf(key), &evicted);
+    }
+
+    for (uint32_t expected = 3; expected >= 1; --expected)
+    {
+        uint32_t set = 0;
+        CHECK(pool.Acquire(key, &allocator, &set));
+        CHECK_EQ(expected, set);
+    }
+    CHECK_EQ(0u, allocator.Allocated());
+}
+
+TEST(TexturePool, Budget)
+{
+    const TEXTURE_POOL_KEY key = MakeKey(1920, 1080);
+    const int64_t size = SizeOf(key);
+
+    CTexturePool<uint32_t> pool(size * 2);
+    std::vector<uint32_t> evicted;
+
+    // the least recently released go first
+    for (uint32_t set = 1; set <= 3; ++set)
+    {
+        pool.Release(key, set, size, &evicted);
+    }
+    CHECK(std::vector<uint32_t>({ 1 }) == evicted);
+
+    // larger than the whole budget, freed right away
+    const TEXTURE_POOL_KEY big = MakeKey(3840, 2160);
+    pool.Release(big, 4, SizeOf(big), &evicted);
+    CHECK(std::vector<uint32_t>({ 1, 4 }) == evicted);
+
+    CTexturePool<uint32_t>::STATS stats = pool.GetStats();
+    CHECK_EQ(2u, stats.entries);
+    CHECK_EQ(size * 2, stats.bytes);
+    CHECK_EQ(size * 2, stats.budget);
+    CHECK_EQ(2u, stats.evictions);
+
+    pool.SetBudget(size, &evicted);
+    CHECK(std::vector<uint32_t>({ 1, 4, 2 }) == evicted);
+
+    // no budget, no pooling
+    pool.SetBudget(0, &evicted);
+    CHECK(std::vector<uint32_t>({ 1, 4, 2, 3 }) == evicted);
+    pool.Release(key, 5, size, &evicted);
+    CHECK_EQ(5u, evicted.back());
+
+    stats = pool.GetStats();
+    CHECK_EQ(0u, stats.entries);
+    CHECK_EQ(0, stats.bytes);
+    CHECK_EQ(0, stats.budget);
+}
+
+TEST(TexturePool, AllocatorFailure)
+{
+    CTexturePool<uint32_t> pool(64 * 1024 * 1024);
+    CCountingAllocator allocator;
+    allocator.SetFailing(true);
+
+    uint32_t set = 42;
+    CHECK(!pool.Acquire(MakeKey(16, 16), &allocator, &set));
+    CHECK_EQ(42u, set);
+
+    // a pooled set doesn't need the allocator
+    std::vector<uint32_t> evicted;
+    pool.Release(MakeKey(16, 16), 7, 1024, &evicted);
+    CHECK(pool.Acquire(MakeKey(16, 16), &allocator, &set));
+    CHECK_EQ(7u, set);
+}
+
+TEST(TexturePool, Clear)
+{
+    CTexturePool<uint32_t> pool(64 * 1024 * 1024);
+    std::vector<uint32_t> evicted;
+
+    pool.Release(MakeKey(16, 16), 1, 1024, &evicted);
+    pool.Release(MakeKey(32, 32), 2, 4096, &evicted);
+
+    std::vector<uint32_t> removed;
+    pool.Clear(&removed);
+    std::sort(removed.begin(), removed.end());
+    CHECK(std::vector<uint32_t>({ 1, 2 }) == removed);
+    CHECK(evicted.empty());
+
+    const CTexturePool<uint32_t>::STATS stats = pool.GetStats();
+    CHECK_EQ(0u, stats.entries);
+    CHECK_EQ(0, stats.bytes);
+}
+
+TEST(TexturePool, PlayersChurningConcurrently)
+{
+    // players opening and closing at a few sizes, with the budget changing under
+    // them. No set is lost or handed to two players at once.
+    const uint32_t playerCount = 4;
+    const uint32_t iterations = 20000;
+    const TEXTURE_POOL_KEY keys[] = { MakeKey(1920, 1080), MakeKey(1280, 720), MakeKey(640, 360) };
+
+    CTexturePool<uint32_t> pool(SizeOf(keys[0]) * 4);
+    CCountingAllocator allocator;
+
+    std::vector<std::vector<uint32_t>> freed(playerCount + 1);
+    std::vector<std::atomic<uint32_t>> holders(playerCount * iterations + 1);
+    std::atomic<bool> sharedTwice(false);
+    std::atomic<bool> failed(false);
+
+    std::vector<std::thread> players;
+    for (uint32_t p = 0; p < playerCount; ++p)
+    {
+        players.emplace_back([&, p]()
+        {
+            for (uint32_t i = 0; i < iterations; ++i)
+            {
+                const TEXTURE_POOL_KEY& key = keys[(p + i) % 3];
+                uint32_t set = 0;
+                if (!pool.Acquire(key, &allocator, &set) || set >= holders.size())
+                {
+                    failed = true;
+                    return;
+                }
+
+                if (0 != holders[set].fetch_add(1))
+                {
+                    sharedTwice = true;
+                }
+                std::this_thread::yield();
+                holders[set].fetch_sub(1);
+
+                pool.Release(key, set, SizeOf(key), &freed[p]);
+            }
+        });
+    }
+
+    std::thread budget([&]()
+    {
+        for (uint32_t i = 0; i < 200; ++i)
+        {
+            pool.SetBudget(SizeOf(keys[0]) * (i % 5), &freed[playerCount]);
+            std::this_thread::yield();
+        }
+    });
+
+    for (std::thread& player : players)
+    {
+        player.join();
+    }
+    budget.join();
+
+    CHECK(!failed);
+    CHECK(!sharedTwice);
+
+    // every set allocated is either freed or still pooled, once
+    std::vector<uint32_t> all;
+    pool.Clear(&all);
+    for (const std::vector<uint32_t>& sets : freed)
+    {
+        all.insert(all.end(), sets.begin(), sets.end());
+    }
+
+    std::sort(all.begin(), all.end());
+    CHECK_EQ(allocator.Allocated(), all.size());
+    for (size_t i = 0; i < all.size(); ++i)
+    {
+        CHECK_EQ(i + 1, all[i]);
+    }
+
+    const CTexturePool<uint32_t>::STATS stats = pool.GetStats();
+    CHECK_EQ(static_cast<uint64_t>(playerCount) * iterations, stats.hits + stats.misses);
+    CHECK_EQ(stats.misses, allocator.Allocated());
+}
@@ -0,0 +1,226 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "ThumbnailAtlas.h"
+
+static bool IsCellRect(const CThumbnailAtlas& atlas, uint32_t index, uint32_t left, uint32_t top)
+{
+    THUMBNAIL_CELL_RECT rect = {};
+
+    return atlas.GetCellRect(index, &rect)
+        && left == rect.left
+        && top == rect.top
+        && atlas.GetCellWidth() == rect.width
+        && atlas.GetCellHeight() == rect.height;
+}
+
+// a width x height picture of one colour, top row first
+static std::vector<uint8_t> MakePicture(uint32_t width, uint32_t height, uint8_t b, uint8_t g, uint8_t r)
+{
+    std::vector<uint8_t> picture(static_cast<size_t>(width) * height * 4);
+    for (size_t i = 0; i < picture.size(); i += 4)
+    {
+        picture[i + 0] = b;
+        picture[i + 1] = g;
+        picture[i + 2] = r;
+        picture[i + 3] = 0xff;
+    }
+
+    return picture;
+}
+
+TEST(ThumbnailAtlas, StripLayout)
+{
+    CThumbnailAtlas atlas;
+    CHECK(atlas.Initialize(8, 160, 90));
+    CHECK_EQ(8u, atlas.GetColumns());
+    CHECK_EQ(1u, atlas.GetRows());
+    CHECK_EQ(1280u, atlas.GetWidth());
+    CHECK_EQ(90u, atlas.GetHeight());
+    CHECK_EQ(1280u * 4 * 90, atlas.GetPixelsSize());
+
+    CHECK(IsCellRect(atlas, 0, 0, 0));
+    CHECK(IsCellRect(atlas, 7, 1120, 0));
+
+    // unplaced cells are opaque black and have no time
+    CHECK_EQ(0u, atlas.GetPixels()[0]);
+    CHECK_EQ(0xffu, atlas.GetPixels()[3]);
+    CHECK(std::vector<int64_t>(8, -1) == atlas.GetTimes());
+}
+
+TEST(ThumbnailAtlas, WrappedLayout)
+{
+    // four of these fit across, so eight make two full rows
+    CThumbnailAtlas atlas;
+    CHECK(atlas.Initialize(8, 4096, 2));
+    CHECK_EQ(4u, atlas.GetColumns());
+    CHECK_EQ(2u, atlas.GetRows());
+    CHECK(IsCellRect(atlas, 3, 12288, 0));
+    CHECK(IsCellRect(atlas, 4, 0, 2));
+    CHECK(IsCellRect(atlas, 7, 12288, 2));
+
+    // six leave the second row half empty, the cells past the last have no rect
+    CHECK(atlas.Initialize(6, 4096, 2));
+    CHECK_EQ(4u, atlas.GetColumns());
+    CHECK_EQ(2u, atlas.GetRows());
+    CHECK_EQ(16384u, atlas.GetWidth());
+    CHECK_EQ(4u, atlas.GetHeight());
+    CHECK(IsCellRect(atlas, 5, 4096, 2));
+
+    THUMBNAIL_CELL_RECT rect = {};
+    CHECK(!atlas.GetCellRect(6, &rect));
+    CHECK(!atlas.GetCellRect(7, &rect));
+    CHECK(!atlas.GetCellRect(THUMBNAIL_INVALID_CELL, &rect));
+    CHECK(!atlas.GetCellRect(0, nullptr));
+}
+
+TEST(ThumbnailAtlas, InitializeLimits)
+{
+    CThumbnailAtlas atlas;
+    CHECK(!atlas.Initialize(0, 160, 90));
+    CHECK(!atlas.Initialize(8, 0, 90));
+    CHECK(!atlas.Initialize(8, THUMBNAIL_ATLAS_MAX_SIZE + 1, 90));
+
+    // 64 rows of one column, each taller than a 64th of the limit
+    CHECK(!atlas.Initialize(64, THUMBNAIL_ATLAS_MAX_SIZE, THUMBNAIL_ATLAS_MAX_SIZE / 64 + 1));
+    CHECK_EQ(0u, atlas.GetCount());
+
+    THUMBNAIL_CELL_RECT rect = {};
+    CHECK(!atlas.GetCellRect(0, &rect));
+    CHECK_EQ(THUMBNAIL_INVALID_CELL, atlas.FindCell(0));
+}
+
+TEST(ThumbnailAtlas, OutOfRangeCells)
+{
+    CThumbnailAtlas atlas;
+    CHECK(atlas.Initialize(3, 4, 4));
+
+    const std::vector<uint8_t> before(atlas.GetPixels(), atlas.GetPixels() + atlas.GetPixelsSize());
+    const std::vector<uint8_t> picture = MakePicture(4, 4, 10, 20, 30);
+    atlas.Place(3, 100, picture.data(), 16, 4, 4);
+    atlas.CopyCell(atlas, 0, 3);
+    atlas.CopyCell(atlas, 3, 0);
+
+    const std::vector<uint8_t> after(atlas.GetPixels(), atlas.GetPixels() + atlas.GetPixelsSize());
+    CHECK(before == after);
+    CHECK(std::vector<int64_t>(3, -1) == atlas.GetTimes());
+
+    // an atlas with another cell size is not copied from
+    CThumbnailAtlas other;
+    CHECK(other.Initialize(3, 8, 4));
+    other.Place(0, 100, picture.data(), 16, 4, 4);
+    atlas.CopyCell(other, 0, 0);
+    CHECK_EQ(-1, atlas.GetTimes()[0]);
+}
+
+TEST(ThumbnailAtlas, PlaceKeepsAspect)
+{
+    CThumbnailAtlas atlas;
+    CHECK(atlas.Initialize(2, 4, 4));
+
+    // 2:1 fits as 4x2, centred with a black row above and below
+    uint32_t fitWidth = 0;
+    uint32_t fitHeight = 0;
+    atlas.GetFitSize(8, 4, &fitWidth, &fitHeight);
+    CHECK_EQ(4u, fitWidth);
+    CHECK_EQ(2u, fitHeight);
+
+    const std::vector<uint8_t> picture = MakePicture(8, 4, 10, 20, 30);
+    atlas.Place(1, 500, picture.data(), 32, 8, 4);
+    CHECK_EQ(500, atlas.GetTimes()[1]);
+
+    const uint32_t pitch = atlas.GetRowPitch();
+    const uint8_t* pPixels = atlas.GetPixels();
+    for (uint32_t y = 0; y < 4; ++y)
+    {
+        const uint8_t* pRow = pPixels + y * pitch + 4 * 4;
+        const bool inPicture = (1 == y || 2 == y);
+        for (uint32_t x = 0; x < 4; ++x)
+        {
+            CHECK_EQ(inPicture ? 10u : 0u, pRow[x * 4 + 0]);
+            CHECK_EQ(inPicture ? 30u : 0u, pRow[x * 4 + 2]);
+            CHECK_EQ(0xffu, pRow[x * 4 + 3]);
+        }
+
+        // the cell to its left is untouched
+        CHECK_EQ(0u, pPixels[y * pitch]);
+    }
+
+    // bottom up sources come in with a negative pitch from their last row
+    const std::vector<uint8_t> tall = MakePicture(2, 4, 50, 60, 70);
+    atlas.Place(0, 0, tall.data() + 3 * 8, -8, 2, 4);
+    CHECK_EQ(50u, pPixels[pitch + 1 * 4]);
+    CHECK_EQ(0u, pPixels[pitch + 0 * 4]);
+}
+
+TEST(ThumbnailAtlas, TimeToCell)
+{
+    // 100 split four ways is sampled at the middle of each share
+    std::vector<int64_t> times;
+    GetThumbnailTimes(100, 4, std::vector<int64_t>(), &times);
+    CHECK(std::vector<int64_t>({ 12, 37, 62, 87 }) == times);
+
+    // snapped back to the keyframe before each, or the first one
+    GetThumbnailTimes(100, 4, std::vector<int64_t>({ 20, 30, 60 }), &times);
+    CHECK(std::vector<int64_t>({ 20, 30, 60, 60 }) == times);
+
+    CThumbnailAtlas atlas;
+    CHECK(atlas.Initialize(4, 2, 2));
+    CHECK_EQ(THUMBNAIL_INVALID_CELL, atlas.FindCell(50));
+
+    // the workers fill cells out of order, the last one shares a keyframe
+    const std::vector<uint8_t> picture = MakePicture(2, 2, 1, 2, 3);
+    atlas.Place(2, times[2], picture.data(), 8, 2, 2);
+    CHECK_EQ(2u, atlas.FindCell(0));
+    CHECK_EQ(2u, atlas.FindCell(99));
+
+    atlas.Place(0, times[0], picture.data(), 8, 2, 2);
+    atlas.CopyCell(atlas, 2, 3);
+    CHECK_EQ(0u, atlas.FindCell(0));
+    CHECK_EQ(0u, atlas.FindCell(20));
+    CHECK_EQ(0u, atlas.FindCell(59));
+    CHECK_EQ(3u, atlas.FindCell(60));
+    CHECK_EQ(3u, atlas.FindCell(1000));
+
+    atlas.Place(1, times[1], picture.data(), 8, 2, 2);
+    CHECK_EQ(0u, atlas.FindCell(29));
+    CHECK_EQ(1u, atlas.FindCell(30));
+    CHECK_EQ(1u, atlas.FindCell(59));
+}
+
+TEST(ThumbnailAtlas, CacheRoundTrip)
+{
+    CThumbnailAtlas atlas;
+    CHECK(atlas.Initialize(3, 2, 2));
+    const std::vector<uint8_t> picture = MakePicture(2, 2, 1, 2, 3);
+    atlas.Place(1, 42, picture.data(), 8, 2, 2);
+
+    const char name[] = "clip.mp4";
+    const uint64_t key = HashThumbnailKey(THUMBNAIL_KEY_SEED, name, sizeof(name) - 1);
+    CHECK(THUMBNAIL_KEY_SEED != key);
+
+    std::vector<uint8_t> data;
+    atlas.Serialize(key, &data);
+
+    CThumbnailAtlas loaded;
+    CHECK(loaded.Initialize(3, 2, 2));
+    CHECK(loaded.Deserialize(key, data.data(), data.size()));
+    CHECK(atlas.GetTimes() == loaded.GetTimes());
+    CHECK_EQ(1u, loaded.FindCell(42));
+
+    // another video, another cell size or a truncated file read back false
+    CHECK(!loaded.Deserialize(key + 1, data.data(), data.size()));
+    CHECK(!loaded.Deserialize(key, data.data(), data.size() - 1));
+    CHECK(loaded.Initialize(3, 4, 2));
+    CHECK(!loaded.Deserialize(key, data.data(), data.size()));
+}
@@ -0,0 +1,69 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "Trace.h"
+
+// what a trace point costs the thread it sits on, off and on, and what a dump costs
+BENCHMARK(Trace, Overhead)
+{
+    const int iterations = 5000000;
+
+    TraceSetEnabled(false);
+    double start = BenchmarkNow();
+    for (int i = 0; i < iterations; ++i)
+    {
+        TraceInstant("TraceBench.Off", 1, i);
+    }
+    const double disabled = (BenchmarkNow() - start) / iterations;
+
+    {
+        start = BenchmarkNow();
+        for (int i = 0; i < iterations; ++i)
+        {
+            TRACE_SCOPE("TraceBench.OffScope", 1);
+        }
+    }
+    const double disabledScope = (BenchmarkNow() - start) / iterations;
+
+    TraceSetEnabled(true);
+    start = BenchmarkNow();
+    for (int i = 0; i < iterations; ++i)
+    {
+        TraceInstant("TraceBench.On", 1, i);
+    }
+    const double instant = (BenchmarkNow() - start) / iterations;
+
+    start = BenchmarkNow();
+    for (int i = 0; i < iterations; ++i)
+    {
+        TRACE_SCOPE("TraceBench.OnScope", 1);
+    }
+    const double scope = (BenchmarkNow() - start) / iterations;
+
+    // a full ring on this thread
+    const int dumps = 20;
+    size_t bytes = 0;
+    start = BenchmarkNow();
+    for (int i = 0; i < dumps; ++i)
+    {
+        bytes = TraceToJson().size();
+    }
+    const double dump = (BenchmarkNow() - start) / dumps;
+    TraceSetEnabled(false);
+
+    printf("disabled instant    %8.2f ns\n", disabled * 1e9);
+    printf("disabled scope      %8.2f ns\n", disabledScope * 1e9);
+    printf("instant             %8.2f ns\n", instant * 1e9);
+    printf("scope (begin + end) %8.2f ns\n", scope * 1e9);
+    printf("TraceToJson         %8.2f ms for %zu bytes\n", dump * 1e3, bytes);
+}
@@ -0,0 +1,207 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "Trace.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// the rings are process wide, every test records under names of its own
+struct TRACED_EVENT
+{
+    char phase;
+    uint32_t player;
+    int64_t value;
+};
+
+static std::vector<TRACED_EVENT> FindEvents(const std::string& json, const char* name)
+{
+    std::vector<TRACED_EVENT> events;
+
+    const std::string key = std::string("{\"name\":\"") + name + "\",";
+    for (size_t at = json.find(key); std::string::npos != at; at = json.find(key, at + 1))
+    {
+        const char* pEvent = json.c_str() + at;
+        const char* pPhase = strstr(pEvent, "\"ph\":\"");
+        const char* pPlayer = strstr(pEvent, "\"player\":");
+        const char* pValue = strstr(pEvent, "\"value\":");
+        if (nullptr == pPhase || nullptr == pPlayer || nullptr == pValue)
+        {
+            break;
+        }
+
+        TRACED_EVENT event;
+        event.phase = pPhase[6];
+        event.player = static_cast<uint32_t>(strtoul(pPlayer + 9, nullptr, 10));
+        event.value = strtoll(pValue + 8, nullptr, 10);
+        events.push_back(event);
+    }
+
+    return events;
+}
+
+TEST(Trace, DisabledRecordsNothing)
+{
+    TraceSetEnabled(false);
+
+    TraceInstant("TraceTest.Disabled", 1, 1);
+    {
+        TRACE_SCOPE("TraceTest.DisabledScope", 1);
+    }
+
+    const std::string json = TraceToJson();
+    CHECK(FindEvents(json, "TraceTest.Disabled").empty());
+    CHECK(FindEvents(json, "TraceTest.DisabledScope").empty());
+}
+
+TEST(Trace, InstantAndScope)
+{
+    TraceSetEnabled(true);
+
+    TraceInstant("TraceTest.Instant", 3, 42);
+    {
+        TRACE_SCOPE_ARG("TraceTest.Scope", 4, 7);
+    }
+
+    TraceSetEnabled(false);
+
+    const std::string json = TraceToJson();
+    CHECK_EQ(0u, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+
+    std::vector<TRACED_EVENT> instants = FindEvents(json, "TraceTest.Instant");
+    CHECK_EQ(1u, instants.size());
+    CHECK_EQ('i', instants[0].phase);
+    CHECK_EQ(3u, instants[0].player);
+    CHECK_EQ(42, instants[0].value);
+
+    std::vector<TRACED_EVENT> scope = FindEvents(json, "TraceTest.Scope");
+    CHECK_EQ(2u, scope.size());
+    CHECK_EQ('B', scope[0].phase);
+    CHECK_EQ(7, scope[0].value);
+    CHECK_EQ('E', scope[1].phase);
+    CHECK_EQ(4u, scope[1].player);
+}
+
+TEST(Trace, ScopesPairUp)
+{
+    // turned on mid scope: neither begin nor end
+    TraceSetEnabled(false);
+    {
+        TRACE_SCOPE("TraceTest.LateEnable", 1);
+        TraceSetEnabled(true);
+    }
+
+    // turned off mid scope: the end is still recorded
+    {
+        TRACE_SCOPE("TraceTest.EarlyDisable", 1);
+        TraceSetEnabled(false);
+    }
+
+    const std::string json = TraceToJson();
+    CHECK(FindEvents(json, "TraceTest.LateEnable").empty());
+    CHECK_EQ(2u, FindEvents(json, "TraceTest.EarlyDisable").size());
+}
+
+TEST(Trace, EscapesNames)
+{
+    TraceSetEnabled(true);
+    TraceInstant("TraceTest.\"Quoted\\\"", 1);
+    TraceSetEnabled(false);
+
+    const std::string json = TraceToJson();
+    CHECK(std::string::npos != json.find("\"name\":\"TraceTest.\\\"Quoted\\\\\\\"\""));
+}
+
+TEST(Trace, RingKeepsNewest)
+{
+    const int64_t extra = 100;
+
+    // a thread of its own, so the ring holds nothing else
+    TraceSetEnabled(true);
+    std::thread writer([]()
+    {
+        for (int64_t i = 0; i < TRACE_THREAD_CAPACITY + extra; ++i)
+        {
+            TraceInstant("TraceTest.Ring", 1, i);
+        }
+    });
+    writer.join();
+    TraceSetEnabled(false);
+
+    std::vector<TRACED_EVENT> events = FindEvents(TraceToJson(), "TraceTest.Ring");
+    CHECK_EQ(static_cast<size_t>(TRACE_THREAD_CAPACITY), events.size());
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        CHECK_EQ(extra + static_cast<int64_t>(i), events[i].value);
+    }
+}
+
+// dumps while threads keep writing, a slot being overwritten must never come out as a mix of two events
+TEST(Trace, DumpWhileWriting)
+{
+    TraceSetEnabled(true);
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> writers;
+    for (uint32_t t = 0; t < 3; ++t)
+    {
+        writers.emplace_back([&]()
+        {
+            for (int64_t i = 0; !stop.load(); ++i)
+            {
+                TraceInstant((i & 1) ? "TraceTest.Odd" : "TraceTest.Even", 9, i);
+
+                // lets the dumping thread in on a single core
+                if (0 == (i & 255))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // parsed once the writers stopped, only the dumps race them
+    std::vector<std::string> dumps;
+    for (uint32_t dump = 0; dump < 5; ++dump)
+    {
+        dumps.push_back(TraceToJson());
+    }
+
+    stop = true;
+    for (auto& writer : writers)
+    {
+        writer.join();
+    }
+    TraceSetEnabled(false);
+
+    size_t checked = 0;
+    size_t torn = 0;
+    for (const std::string& json : dumps)
+    {
+        for (const TRACED_EVENT& event : FindEvents(json, "TraceTest.Odd"))
+        {
+            torn += (1 != (event.value & 1) || 9 != event.player) ? 1 : 0;
+            ++checked;
+        }
+        for (const TRACED_EVENT& event : FindEvents(json, "TraceTest.Even"))
+        {
+            torn += (0 != (event.value & 1) || 9 != event.player) ? 1 : 0;
+            ++checked;
+        }
+    }
+
+    CHECK(checked > 0);
+    CHECK_EQ(0u, torn);
+}
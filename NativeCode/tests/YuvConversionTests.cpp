@@ -0,0 +1,151 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "YuvConversion.h"
+
+#include <cstdlib>
+
+// the reference conversion against values worked out from the standards,
+// where YuvKernelsTests only compares the simd kernels to the reference
+
+static const YuvMatrix s_matrices[] =
+{
+    YuvMatrix::YuvMatrix_BT601,
+    YuvMatrix::YuvMatrix_BT709,
+    YuvMatrix::YuvMatrix_BT2020,
+};
+
+static bool IsBgr(const uint8_t* pBgra, int b, int g, int r, int tolerance)
+{
+    return std::abs(pBgra[0] - b) <= tolerance
+        && std::abs(pBgra[1] - g) <= tolerance
+        && std::abs(pBgra[2] - r) <= tolerance
+        && 0xFF == pBgra[3];
+}
+
+static bool Converts(YuvMatrix matrix, YuvRange range, int32_t y, int32_t cb, int32_t cr, int b, int g, int r, int tolerance)
+{
+    uint8_t bgra[4] = {};
+    YuvToBgra(GetYuvCoefficients(matrix, range, 8), y, cb, cr, bgra);
+
+    return IsBgr(bgra, b, g, r, tolerance);
+}
+
+TEST(YuvConversion, LimitedRangeBlackAndWhite)
+{
+    for (YuvMatrix matrix : s_matrices)
+    {
+        CHECK(Converts(matrix, YuvRange::YuvRange_Limited, 16, 128, 128, 0, 0, 0, 0));
+        CHECK(Converts(matrix, YuvRange::YuvRange_Limited, 235, 128, 128, 255, 255, 255, 0));
+
+        // mid grey, and the footroom and headroom clamp
+        CHECK(Converts(matrix, YuvRange::YuvRange_Limited, 126, 128, 128, 128, 128, 128, 1));
+        CHECK(Converts(matrix, YuvRange::YuvRange_Limited, 0, 128, 128, 0, 0, 0, 0));
+        CHECK(Converts(matrix, YuvRange::YuvRange_Limited, 255, 128, 128, 255, 255, 255, 0));
+    }
+}
+
+TEST(YuvConversion, FullRangeBlackAndWhite)
+{
+    for (YuvMatrix matrix : s_matrices)
+    {
+        CHECK(Converts(matrix, YuvRange::YuvRange_Full, 0, 128, 128, 0, 0, 0, 0));
+        CHECK(Converts(matrix, YuvRange::YuvRange_Full, 255, 128, 128, 255, 255, 255, 0));
+        CHECK(Converts(matrix, YuvRange::YuvRange_Full, 128, 128, 128, 128, 128, 128, 0));
+    }
+}
+
+TEST(YuvConversion, RedPrimaries)
+{
+    // 8 bit limited range codes of full red, from each standard's Kr and Kb.
+    // A matrix with the wrong constants is off by tens in green or blue.
+    CHECK(Converts(YuvMatrix::YuvMatrix_BT709, YuvRange::YuvRange_Limited, 63, 102, 240, 0, 0, 255, 1));
+    CHECK(Converts(YuvMatrix::YuvMatrix_BT601, YuvRange::YuvRange_Limited, 81, 90, 240, 0, 0, 255, 1));
+    CHECK(Converts(YuvMatrix::YuvMatrix_BT2020, YuvRange::YuvRange_Limited, 74, 97, 240, 0, 0, 255, 1));
+
+    CHECK(!Converts(YuvMatrix::YuvMatrix_BT601, YuvRange::YuvRange_Limited, 63, 102, 240, 0, 0, 255, 8));
+
+    // blue and green of BT.709, full range
+    CHECK(Converts(YuvMatrix::YuvMatrix_BT709, YuvRange::YuvRange_Full, 18, 255, 116, 255, 0, 0, 1));
+    CHECK(Converts(YuvMatrix::YuvMatrix_BT709, YuvRange::YuvRange_Full, 182, 30, 12, 0, 255, 0, 1));
+}
+
+TEST(YuvConversion, P010WhiteAndBlack)
+{
+    YUV_PLANE_LAYOUT layout;
+    CHECK(GetYuvPlaneLayout(YuvPlanarFormat::YuvPlanarFormat_P010, 4, 2, 0, &layout));
+
+    // left half white, right half black, 10 bit codes in the high bits of each sample
+    std::vector<uint16_t> frame(layout.totalSize / 2);
+    for (uint32_t row = 0; row < 2; ++row)
+    {
+        frame[row * 4 + 0] = frame[row * 4 + 1] = 940 << 6;
+        frame[row * 4 + 2] = frame[row * 4 + 3] = 64 << 6;
+    }
+    for (size_t i = layout.chromaOffset / 2; i < frame.size(); ++i)
+    {
+        frame[i] = 512 << 6;
+    }
+
+    const YUV_COEFFICIENTS coefficients = GetYuvCoefficients(YuvMatrix::YuvMatrix_BT2020, YuvRange::YuvRange_Limited, 10);
+    CHECK_EQ(64, coefficients.yOffset);
+    CHECK_EQ(512, coefficients.cOffset);
+
+    uint8_t bgra[2 * 4 * 4] = {};
+    CHECK(ConvertYuvPlanarToBgra(YuvPlanarFormat::YuvPlanarFormat_P010, layout, reinterpret_cast<const uint8_t*>(frame.data()), coefficients, bgra, 16));
+    for (uint32_t row = 0; row < 2; ++row)
+    {
+        CHECK(IsBgr(&bgra[row * 16 + 0], 255, 255, 255, 0));
+        CHECK(IsBgr(&bgra[row * 16 + 4], 255, 255, 255, 0));
+        CHECK(IsBgr(&bgra[row * 16 + 8], 0, 0, 0, 0));
+        CHECK(IsBgr(&bgra[row * 16 + 12], 0, 0, 0, 0));
+    }
+}
+
+TEST(YuvConversion, PlaneLayouts)
+{
+    YUV_PLANE_LAYOUT layout;
+
+    CHECK(GetYuvPlaneLayout(YuvPlanarFormat::YuvPlanarFormat_NV12, 64, 32, 0, &layout));
+    CHECK_EQ(1u, layout.bytesPerSample);
+    CHECK_EQ(64u, layout.lumaPitch);
+    CHECK_EQ(32u, layout.chromaWidth);
+    CHECK_EQ(16u, layout.chromaHeight);
+    CHECK_EQ(64u * 32, layout.chromaOffset);
+    CHECK_EQ(64u * 32 * 3 / 2, layout.totalSize);
+
+    // rows padded to the pitch in both planes
+    CHECK(GetYuvPlaneLayout(YuvPlanarFormat::YuvPlanarFormat_NV12, 64, 32, 128, &layout));
+    CHECK_EQ(128u, layout.lumaPitch);
+    CHECK_EQ(128u, layout.chromaPitch);
+    CHECK_EQ(128u * 32, layout.chromaOffset);
+    CHECK_EQ(128u * 32 + 128u * 16, layout.totalSize);
+
+    CHECK(GetYuvPlaneLayout(YuvPlanarFormat::YuvPlanarFormat_P010, 1920, 1080, 4096, &layout));
+    CHECK_EQ(2u, layout.bytesPerSample);
+    CHECK_EQ(960u, layout.chromaWidth);
+    CHECK_EQ(540u, layout.chromaHeight);
+    CHECK_EQ(4096u * 1080, layout.chromaOffset);
+    CHECK_EQ(4096u * 1080 + 4096u * 540, layout.totalSize);
+
+    // a P010 row is twice as wide, so this pitch is too short for it
+    CHECK(GetYuvPlaneLayout(YuvPlanarFormat::YuvPlanarFormat_NV12, 64, 32, 100, &layout));
+    CHECK(!GetYuvPlaneLayout(YuvPlanarFormat::YuvPlanarFormat_P010, 64, 32, 100, &layout));
+
+    // chroma is subsampled in both directions, odd sizes have no layout
+    CHECK(!GetYuvPlaneLayout(YuvPlanarFormat::YuvPlanarFormat_NV12, 63, 32, 0, &layout));
+    CHECK(!GetYuvPlaneLayout(YuvPlanarFormat::YuvPlanarFormat_NV12, 64, 31, 0, &layout));
+    CHECK(!GetYuvPlaneLayout(YuvPlanarFormat::YuvPlanarFormat_P010, 1919, 1080, 0, &layout));
+    CHECK(!GetYuvPlaneLayout(YuvPlanarFormat::YuvPlanarFormat_NV12, 0, 32, 0, &layout));
+    CHECK(!GetYuvPlaneLayout(YuvPlanarFormat::YuvPlanarFormat_NV12, 64, 32, 0, nullptr));
+}
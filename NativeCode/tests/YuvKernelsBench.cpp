@@ -0,0 +1,89 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "YuvTestFrames.h"
+
+// GB/s of planes read plus pixels written, per isa, at the sizes the player decodes
+BENCHMARK(YuvKernels, Throughput)
+{
+    struct FRAME_SIZE
+    {
+        const char* name;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    const FRAME_SIZE sizes[] =
+    {
+        { "1080p", 1920, 1080 },
+        { "4K", 3840, 2160 },
+        { "8K", 7680, 4320 },
+    };
+
+    const YuvKernelIsa isas[] =
+    {
+        YuvKernelIsa::YuvKernelIsa_Scalar,
+        YuvKernelIsa::YuvKernelIsa_SSE41,
+        YuvKernelIsa::YuvKernelIsa_AVX2,
+        YuvKernelIsa::YuvKernelIsa_NEON,
+    };
+
+    printf("%-6s %-5s %-8s %-7s %8s %8s\n", "size", "src", "dst", "isa", "ms", "GB/s");
+
+    for (const FRAME_SIZE& size : sizes)
+    {
+        for (YuvSourceFormat source : g_yuvSourceFormats)
+        {
+            CYuvTestFrame frame(source, size.width, size.height, 7);
+            const YUV_COEFFICIENTS coefficients = frame.Coefficients(YuvMatrix::YuvMatrix_BT709, YuvRange::YuvRange_Limited);
+
+            for (RgbDestinationFormat destination : g_rgbDestinationFormats)
+            {
+                const uint32_t pitch = size.width * CYuvTestFrame::PixelSize(destination);
+                std::vector<uint8_t> converted(static_cast<size_t>(pitch) * size.height);
+
+                for (YuvKernelIsa isa : isas)
+                {
+                    if (!IsYuvKernelIsaSupported(isa))
+                    {
+                        continue;
+                    }
+
+                    // at least a few frames and a quarter second, first one warms the caches
+                    ConvertYuvFrame(frame.Frame(), coefficients, destination, converted.data(), pitch, isa);
+
+                    uint32_t iterations = 0;
+                    const double start = BenchmarkNow();
+                    double elapsed = 0.0;
+                    do
+                    {
+                        ConvertYuvFrame(frame.Frame(), coefficients, destination, converted.data(), pitch, isa);
+                        ++iterations;
+                        elapsed = BenchmarkNow() - start;
+                    } while (iterations < 3 || elapsed < 0.25);
+
+                    BenchmarkKeep(converted[converted.size() / 2]);
+
+                    const double perFrame = elapsed / iterations;
+                    printf("%-6s %-5s %-8s %-7s %8.2f %8.2f\n",
+                        size.name,
+                        (YuvSourceFormat::YuvSourceFormat_NV12 == source) ? "NV12" : (YuvSourceFormat::YuvSourceFormat_I420 == source) ? "I420" : "P010",
+                        (RgbDestinationFormat::RgbDestinationFormat_BGRA8 == destination) ? "BGRA8" : "RGBA16F",
+                        GetYuvKernelIsaName(isa),
+                        perFrame * 1000.0,
+                        frame.BytesTouched(destination) / perFrame / 1e9);
+                }
+            }
+        }
+    }
+}
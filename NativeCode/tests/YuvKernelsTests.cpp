@@ -0,0 +1,132 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "TestHarness.h"
+
+#include "YuvTestFrames.h"
+
+// every simd kernel has to produce the bytes of the scalar reference
+TEST(YuvKernels, SimdMatchesScalar)
+{
+    const uint32_t widths[] = { 2, 8, 14, 16, 30, 34, 66, 130 };
+
+    for (YuvSourceFormat source : g_yuvSourceFormats)
+    {
+        for (RgbDestinationFormat destination : g_rgbDestinationFormats)
+        {
+            for (uint32_t matrix = 0; matrix < 3; ++matrix)
+            {
+                for (uint32_t range = 0; range < 2; ++range)
+                {
+                    for (uint32_t width : widths)
+                    {
+                        CYuvTestFrame frame(source, width, 4, width * 31 + matrix * 7 + range);
+                        const YUV_COEFFICIENTS coefficients = frame.Coefficients(static_cast<YuvMatrix>(matrix), static_cast<YuvRange>(range));
+
+                        std::vector<uint8_t> reference;
+                        CHECK(frame.Convert(coefficients, destination, YuvKernelIsa::YuvKernelIsa_Scalar, &reference));
+
+                        for (YuvKernelIsa isa : g_yuvSimdIsas)
+                        {
+                            if (!IsYuvKernelIsaSupported(isa))
+                            {
+                                continue;
+                            }
+
+                            std::vector<uint8_t> converted;
+                            CHECK(frame.Convert(coefficients, destination, isa, &converted));
+                            CHECK(reference == converted);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// rows may start at an odd pixel, which is never aligned for the simd loads
+TEST(YuvKernels, UnalignedRowStart)
+{
+    for (YuvSourceFormat source : g_yuvSourceFormats)
+    {
+        for (RgbDestinationFormat destination : g_rgbDestinationFormats)
+        {
+            const uint32_t width = 130;
+            CYuvTestFrame frame(source, width, 2, 99);
+            const YUV_COEFFICIENTS coefficients = frame.Coefficients(YuvMatrix::YuvMatrix_BT709, YuvRange::YuvRange_Limited);
+            const uint32_t pixelSize = (RgbDestinationFormat::RgbDestinationFormat_BGRA8 == destination) ? 4 : 8;
+
+            YuvRowKernel scalar = GetYuvRowKernel(YuvKernelIsa::YuvKernelIsa_Scalar, source, destination);
+            CHECK(nullptr != scalar);
+
+            std::vector<uint8_t> reference(width * pixelSize, 0);
+            frame.ConvertRow(scalar, 1, width, coefficients, reference.data());
+
+            for (YuvKernelIsa isa : g_yuvSimdIsas)
+            {
+                YuvRowKernel kernel = GetYuvRowKernel(isa, source, destination);
+                if (nullptr == kernel)
+                {
+                    continue;
+                }
+
+                std::vector<uint8_t> converted(width * pixelSize, 0);
+                frame.ConvertRow(kernel, 1, width, coefficients, converted.data());
+                CHECK(reference == converted);
+            }
+        }
+    }
+}
+
+TEST(YuvKernels, BestIsaIsSupported)
+{
+    YuvKernelIsa best = GetBestYuvKernelIsa();
+    CHECK(IsYuvKernelIsaSupported(best));
+    CHECK(IsYuvKernelIsaSupported(YuvKernelIsa::YuvKernelIsa_Scalar));
+    CHECK(nullptr != GetYuvKernelIsaName(best));
+
+    for (YuvSourceFormat source : g_yuvSourceFormats)
+    {
+        for (RgbDestinationFormat destination : g_rgbDestinationFormats)
+        {
+            CHECK(nullptr != GetYuvRowKernel(YuvKernelIsa::YuvKernelIsa_Best, source, destination));
+        }
+    }
+}
+
+TEST(YuvKernels, FloatToHalf)
+{
+    CHECK_EQ(0x3C00, YuvFloatToHalf(1.0f));
+    CHECK_EQ(0x3800, YuvFloatToHalf(0.5f));
+    CHECK_EQ(0x0000, YuvFloatToHalf(0.0f));
+
+    // smallest half denormal is 2^-24, round to nearest
+    CHECK_EQ(0x0001, YuvFloatToHalf(1.0f / 16777216.0f));
+    CHECK_EQ(0x0011, YuvFloatToHalf(1e-6f));
+
+    // ties go to even: 1 + 2^-11 is halfway between 0x3C00 and 0x3C01
+    CHECK_EQ(0x3C00, YuvFloatToHalf(1.0f + 1.0f / 2048.0f));
+}
+
+TEST(YuvKernels, RejectsBadFrames)
+{
+    CYuvTestFrame frame(YuvSourceFormat::YuvSourceFormat_NV12, 16, 4, 1);
+    const YUV_COEFFICIENTS coefficients = frame.Coefficients(YuvMatrix::YuvMatrix_BT601, YuvRange::YuvRange_Limited);
+
+    // odd sizes cannot be 4:2:0
+    YUV_FRAME odd = frame.Frame();
+    odd.width = 15;
+    std::vector<uint8_t> destination(16 * 4 * 4);
+    CHECK(!ConvertYuvFrame(odd, coefficients, RgbDestinationFormat::RgbDestinationFormat_BGRA8, destination.data(), 16 * 4));
+
+    // destination pitch smaller than a row
+    CHECK(!ConvertYuvFrame(frame.Frame(), coefficients, RgbDestinationFormat::RgbDestinationFormat_BGRA8, destination.data(), 16));
+}
@@ -0,0 +1,135 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "YuvKernels.h"
+
+#include <random>
+#include <vector>
+
+static const YuvSourceFormat g_yuvSourceFormats[] =
+{
+    YuvSourceFormat::YuvSourceFormat_NV12,
+    YuvSourceFormat::YuvSourceFormat_I420,
+    YuvSourceFormat::YuvSourceFormat_P010,
+};
+
+static const RgbDestinationFormat g_rgbDestinationFormats[] =
+{
+    RgbDestinationFormat::RgbDestinationFormat_BGRA8,
+    RgbDestinationFormat::RgbDestinationFormat_RGBA16F,
+};
+
+static const YuvKernelIsa g_yuvSimdIsas[] =
+{
+    YuvKernelIsa::YuvKernelIsa_SSE41,
+    YuvKernelIsa::YuvKernelIsa_AVX2,
+    YuvKernelIsa::YuvKernelIsa_NEON,
+};
+
+// random planes in the layout the decoder hands out, P010 samples keep their low 6 bits clear
+class CYuvTestFrame
+{
+public:
+    CYuvTestFrame(YuvSourceFormat format, uint32_t width, uint32_t height, uint32_t seed)
+        : m_format(format)
+    {
+        const bool wide = (YuvSourceFormat::YuvSourceFormat_P010 == format);
+        const uint32_t sampleSize = wide ? 2 : 1;
+
+        m_frame = YUV_FRAME();
+        m_frame.format = format;
+        m_frame.width = width;
+        m_frame.height = height;
+        m_frame.pitches[0] = width * sampleSize;
+
+        // NV12/P010 interleave Cb and Cr, I420 has a plane for each
+        if (YuvSourceFormat::YuvSourceFormat_I420 == format)
+        {
+            m_frame.pitches[1] = width / 2;
+            m_frame.pitches[2] = width / 2;
+        }
+        else
+        {
+            m_frame.pitches[1] = width * sampleSize;
+        }
+
+        std::mt19937 random(seed);
+        for (uint32_t plane = 0; plane < 3; ++plane)
+        {
+            const uint32_t rows = (0 == plane) ? height : height / 2;
+            m_planes[plane].resize(static_cast<size_t>(m_frame.pitches[plane]) * rows);
+
+            for (size_t i = 0; i + sampleSize <= m_planes[plane].size(); i += sampleSize)
+            {
+                uint32_t value = random();
+                if (wide)
+                {
+                    uint16_t sample = static_cast<uint16_t>((value & 0x3FF) << 6);
+                    memcpy(&m_planes[plane][i], &sample, sizeof(sample));
+                }
+                else
+                {
+                    m_planes[plane][i] = static_cast<uint8_t>(value);
+                }
+            }
+
+            m_frame.planes[plane] = m_planes[plane].empty() ? nullptr : m_planes[plane].data();
+        }
+    }
+
+    const YUV_FRAME& Frame() const
+    {
+        return m_frame;
+    }
+
+    YUV_COEFFICIENTS Coefficients(YuvMatrix matrix, YuvRange range) const
+    {
+        return GetYuvCoefficients(matrix, range, (YuvSourceFormat::YuvSourceFormat_P010 == m_format) ? 10 : 8);
+    }
+
+    static uint32_t PixelSize(RgbDestinationFormat destination)
+    {
+        return (RgbDestinationFormat::RgbDestinationFormat_BGRA8 == destination) ? 4 : 8;
+    }
+
+    bool Convert(const YUV_COEFFICIENTS& coefficients, RgbDestinationFormat destination, YuvKernelIsa isa, std::vector<uint8_t>* pConverted) const
+    {
+        const uint32_t pitch = m_frame.width * PixelSize(destination);
+        pConverted->assign(static_cast<size_t>(pitch) * m_frame.height, 0);
+
+        return ConvertYuvFrame(m_frame, coefficients, destination, pConverted->data(), pitch, isa);
+    }
+
+    // first row only, pixels [begin, end)
+    void ConvertRow(YuvRowKernel kernel, uint32_t begin, uint32_t end, const YUV_COEFFICIENTS& coefficients, uint8_t* pDestination) const
+    {
+        kernel(m_frame.planes[0], m_frame.planes[1], m_frame.planes[2], pDestination, begin, end, coefficients);
+    }
+
+    // bytes read and written by one conversion, for throughput
+    uint64_t BytesTouched(RgbDestinationFormat destination) const
+    {
+        uint64_t bytes = 0;
+        for (const std::vector<uint8_t>& plane : m_planes)
+        {
+            bytes += plane.size();
+        }
+
+        return bytes + static_cast<uint64_t>(m_frame.width) * m_frame.height * PixelSize(destination);
+    }
+
+private:
+    YuvSourceFormat m_format;
+    YUV_FRAME m_frame;
+    std::vector<uint8_t> m_planes[3];
+};